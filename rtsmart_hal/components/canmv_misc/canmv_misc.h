@@ -35,6 +35,8 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "hal_io.h"
+
 #define MISC_DEV_CMD_READ_HEAP              _IOWR('M', 0x00, void*)
 #define MISC_DEV_CMD_READ_PAGE              _IOWR('M', 0x01, void*)
 #define MISC_DEV_CMD_GET_MEMORY_SIZE        _IOWR('M', 0x02, void*)
@@ -100,17 +102,17 @@ static inline __attribute__((always_inline)) int canmv_misc_dev_ioctl(int cmd, v
 {
     int result = 0, misc_dev_fd = -1;
 
-    if (0 > (misc_dev_fd = open("/dev/canmv_misc", O_RDWR))) {
+    if (0 > (misc_dev_fd = hal_io_open("/dev/canmv_misc", O_RDWR))) {
         printf("can not misc device");
         return -1;
     }
 
-    if (0x00 != (result = ioctl(misc_dev_fd, cmd, args))) {
+    if (0x00 != (result = hal_io_ioctl(misc_dev_fd, cmd, args))) {
         printf("ioctl misc device failed, cmd %x\n", cmd);
     }
 
     if (0 <= misc_dev_fd) {
-        close(misc_dev_fd);
+        hal_io_close(misc_dev_fd);
     }
 
     return result;
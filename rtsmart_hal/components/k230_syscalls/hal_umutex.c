@@ -0,0 +1,153 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "hal_umutex.h"
+
+#ifdef __GLIBC__
+/* host build, Linux futex stands in for the RT-Smart one */
+#include <sys/syscall.h>
+#define NR_FUTEX         SYS_futex
+#define FUTEX_OP_WAIT    (0 | 128) /* FUTEX_WAIT_PRIVATE */
+#define FUTEX_OP_WAKE    (1 | 128) /* FUTEX_WAKE_PRIVATE */
+#else
+#include "hal_syscall.h"
+#define NR_FUTEX         _NRSYS_futex
+#define FUTEX_OP_WAIT    (0) /* FUTEX_WAIT */
+#define FUTEX_OP_WAKE    (1) /* FUTEX_WAKE */
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+static struct hal_umutex_stats umutex_stats;
+static int                     umutex_ncpu; /* 0 until probed */
+
+static int spin_limit(int* spin)
+{
+    int ncpu = __atomic_load_n(&umutex_ncpu, __ATOMIC_RELAXED);
+    int limit;
+
+    if (0 == ncpu) {
+        ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        ncpu = (0 < ncpu) ? ncpu : 1;
+        __atomic_store_n(&umutex_ncpu, ncpu, __ATOMIC_RELAXED);
+    }
+    if (1 == ncpu) {
+        return 0;
+    }
+
+    limit = __atomic_load_n(spin, __ATOMIC_RELAXED) * 2 + 10;
+
+    return (limit < HAL_UMUTEX_SPIN_MAX) ? limit : HAL_UMUTEX_SPIN_MAX;
+}
+
+static int futex_wait(volatile int* addr, int val, clockid_t clk, const struct timespec* abstime)
+{
+    struct timespec now, rel, *timeout = NULL;
+
+    if (abstime) {
+        if ((0 > abstime->tv_nsec) || (1000000000L <= abstime->tv_nsec)) {
+            return EINVAL;
+        }
+        clock_gettime(clk, &now);
+        rel.tv_sec  = abstime->tv_sec - now.tv_sec;
+        rel.tv_nsec = abstime->tv_nsec - now.tv_nsec;
+        if (0 > rel.tv_nsec) {
+            rel.tv_nsec += 1000000000L;
+            rel.tv_sec--;
+        }
+        if (0 > rel.tv_sec) {
+            return ETIMEDOUT;
+        }
+        timeout = &rel;
+    }
+
+    if ((0 != syscall(NR_FUTEX, addr, FUTEX_OP_WAIT, val, timeout, NULL, 0)) && (ETIMEDOUT == errno)) {
+        return ETIMEDOUT;
+    }
+
+    return 0;
+}
+
+int hal_umutex_lock_slow(volatile int* lock, int* spin, clockid_t clk, const struct timespec* abstime)
+{
+    int limit = spin_limit(spin);
+    int est, n, ret;
+
+    /* spin while the owner is likely running and nobody sleeps on the lock yet */
+    for (n = 0; (n < limit) && (HAL_UMUTEX_OWNED == __atomic_load_n(lock, __ATOMIC_RELAXED)); n++) {
+        cpu_relax();
+    }
+    if (limit) {
+        /* move the estimate 1/8 of the way towards what this attempt needed */
+        est = __atomic_load_n(spin, __ATOMIC_RELAXED);
+        __atomic_store_n(spin, est + (n - est) / 8, __ATOMIC_RELAXED);
+    }
+    if (0 == hal_umutex_trylock_word(lock)) {
+        if (limit) {
+            __atomic_fetch_add(&umutex_stats.spin_acquired, 1, __ATOMIC_RELAXED);
+        }
+        return 0;
+    }
+
+    /*
+     * Mark contended so the owner wakes us on unlock. A thread taking the lock
+     * from here on keeps the mark, other sleepers may still be queued.
+     */
+    while (0 != __atomic_exchange_n(lock, HAL_UMUTEX_OWNED | HAL_UMUTEX_CONTENDED, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&umutex_stats.futex_waits, 1, __ATOMIC_RELAXED);
+        if (0 != (ret = futex_wait(lock, HAL_UMUTEX_OWNED | HAL_UMUTEX_CONTENDED, clk, abstime))) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+void hal_umutex_wake(volatile int* lock)
+{
+    __atomic_fetch_add(&umutex_stats.futex_wakes, 1, __ATOMIC_RELAXED);
+    syscall(NR_FUTEX, lock, FUTEX_OP_WAKE, 1, NULL, NULL, 0);
+}
+
+void hal_umutex_get_stats(struct hal_umutex_stats* stats)
+{
+    stats->spin_acquired = __atomic_load_n(&umutex_stats.spin_acquired, __ATOMIC_RELAXED);
+    stats->futex_waits   = __atomic_load_n(&umutex_stats.futex_waits, __ATOMIC_RELAXED);
+    stats->futex_wakes   = __atomic_load_n(&umutex_stats.futex_wakes, __ATOMIC_RELAXED);
+}
+
+void hal_umutex_reset_stats(void)
+{
+    __atomic_store_n(&umutex_stats.spin_acquired, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&umutex_stats.futex_waits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&umutex_stats.futex_wakes, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,130 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * User-space mutex, the kernel is entered only under contention.
+ *
+ * Locking is one compare-and-swap of the lock word when it is free. A busy
+ * lock is spun on for a bounded, self-tuning number of iterations (never on a
+ * single cpu, the owner can not run while we spin), then the thread marks the
+ * lock contended and sleeps on a futex. Unlock is one atomic swap, plus a
+ * futex wake only when the contended bit was set.
+ *
+ * The lock word values are musl's ones for PTHREAD_MUTEX_NORMAL: EBUSY while
+ * held, bit 31 set while contended. That lets the pthread_mutex_* overrides in
+ * k230_syscalls.c work on musl's mutex layout without upsetting
+ * pthread_cond_wait(), which requeues its waiters onto the mutex lock word and
+ * counts them in _m_waiters, the @waiters word of hal_umutex_unlock_word().
+ */
+
+#define HAL_UMUTEX_OWNED     (EBUSY)
+#define HAL_UMUTEX_CONTENDED ((int)0x80000000)
+#define HAL_UMUTEX_SPIN_MAX  (200)
+
+struct hal_umutex {
+    volatile int lock;
+    int          spin; /**< adaptive spin estimate */
+};
+
+#define HAL_UMUTEX_INITIALIZER { 0, 0 }
+
+struct hal_umutex_stats {
+    uint64_t spin_acquired; /**< contended locks taken while spinning */
+    uint64_t futex_waits; /**< times a locker slept in the kernel */
+    uint64_t futex_wakes; /**< unlocks that entered the kernel */
+};
+
+/**
+ * @brief Contended path, spin then sleep until the lock word is acquired.
+ * @param abstime Deadline on @clk, NULL waits forever.
+ * @return 0 on success, ETIMEDOUT, EINVAL for a bad deadline.
+ */
+int hal_umutex_lock_slow(volatile int* lock, int* spin, clockid_t clk, const struct timespec* abstime);
+
+/**
+ * @brief Wake one thread sleeping on the lock word.
+ */
+void hal_umutex_wake(volatile int* lock);
+
+void hal_umutex_get_stats(struct hal_umutex_stats* stats);
+void hal_umutex_reset_stats(void);
+
+static inline __attribute__((always_inline)) int hal_umutex_trylock_word(volatile int* lock)
+{
+    int expected = 0;
+
+    return __atomic_compare_exchange_n(lock, &expected, HAL_UMUTEX_OWNED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 0 : EBUSY;
+}
+
+static inline __attribute__((always_inline)) int hal_umutex_lock_word(volatile int* lock, int* spin)
+{
+    if (0 == hal_umutex_trylock_word(lock)) {
+        return 0;
+    }
+
+    return hal_umutex_lock_slow(lock, spin, CLOCK_MONOTONIC, NULL);
+}
+
+/**
+ * @brief Release the lock word.
+ * @param waiters Threads known to sleep on the lock word beside the contended
+ *        bit, may be NULL.
+ */
+static inline __attribute__((always_inline)) void hal_umutex_unlock_word(volatile int* lock, volatile int* waiters)
+{
+    int old = __atomic_exchange_n(lock, 0, __ATOMIC_RELEASE);
+
+    if ((0 > old) || (waiters && __atomic_load_n(waiters, __ATOMIC_RELAXED))) {
+        hal_umutex_wake(lock);
+    }
+}
+
+static inline int hal_umutex_lock(struct hal_umutex* m) { return hal_umutex_lock_word(&m->lock, &m->spin); }
+
+static inline int hal_umutex_trylock(struct hal_umutex* m) { return hal_umutex_trylock_word(&m->lock); }
+
+static inline int hal_umutex_timedlock(struct hal_umutex* m, const struct timespec* abstime)
+{
+    if (0 == hal_umutex_trylock_word(&m->lock)) {
+        return 0;
+    }
+
+    return hal_umutex_lock_slow(&m->lock, &m->spin, CLOCK_MONOTONIC, abstime);
+}
+
+static inline void hal_umutex_unlock(struct hal_umutex* m) { hal_umutex_unlock_word(&m->lock, NULL); }
+
+#ifdef __cplusplus
+}
+#endif
@@ -26,9 +26,12 @@
 #include <sys/statfs.h>
 #include <sys/statvfs.h>
 
+#include <errno.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "hal_syscall.h"
+#include "hal_umutex.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Syscalls for statfs and statvfs ////////////////////////////////////////////
@@ -71,18 +74,137 @@ int statvfs(const char* restrict path, struct statvfs* restrict buf)
 #define PMUTEX_UNLOCK  2
 #define PMUTEX_DESTROY 3
 */
+#define PMUTEX_LOCK   1
+#define PMUTEX_UNLOCK 2
 
-int pthread_mutex_lock(pthread_mutex_t *m)
+///////////////////////////////////////////////////////////////////////////////
+// pthread mutex //////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+static int pmutex_lock(pthread_mutex_t* m)
 {
     int retry = 0;
 
-    while(0x00 != syscall(_NRSYS_pmutex, (long)m, 1, 0)) {
+    while (0x00 != syscall(_NRSYS_pmutex, (long)m, PMUTEX_LOCK, 0)) {
         retry++;
         if (retry > 100) {
-            retry = 0;
             printf("pthread_mutex_lock: failed to lock mutex after %d tries\n", retry);
+            retry = 0;
         }
     }
 
     return 0; // success
 }
+
+#if defined(HAL_FAST_MUTEX) && !defined(__GLIBC__)
+/*
+ * Normal mutexes are locked in user space, see hal_umutex.h, recursive,
+ * errorcheck and robust ones keep going through the kernel pmutex. The
+ * fields are musl's: _m_type, _m_lock and _m_waiters. musl keeps them private,
+ * the checks below fail the build when the layout is not the one read here.
+ */
+#ifndef __DEFINED_pthread_mutex_t
+#error "HAL_FAST_MUTEX reads musl's pthread_mutex_t, build without it for this libc"
+#endif
+_Static_assert(sizeof(pthread_mutex_t) == ((8 == sizeof(long)) ? 40 : 24), "pthread_mutex_t is not musl's");
+_Static_assert(sizeof(((pthread_mutex_t*)0)->__u.__vi[0]) == sizeof(int), "musl mutex words are ints");
+_Static_assert((0 == PTHREAD_MUTEX_NORMAL) && (1 == PTHREAD_MUTEX_RECURSIVE) && (2 == PTHREAD_MUTEX_ERRORCHECK),
+               "_m_type low bits are musl's mutex types");
+
+#define MUTEX_TYPE(m)    ((m)->__u.__i[0] & 15)
+#define MUTEX_LOCK(m)    (&(m)->__u.__vi[1])
+#define MUTEX_WAITERS(m) (&(m)->__u.__vi[2])
+
+static int mutex_spin; /* adaptive spin estimate shared by all mutexes */
+
+int pthread_mutex_lock(pthread_mutex_t* m)
+{
+    if (PTHREAD_MUTEX_NORMAL != MUTEX_TYPE(m)) {
+        return pmutex_lock(m);
+    }
+
+    return hal_umutex_lock_word(MUTEX_LOCK(m), &mutex_spin);
+}
+
+/*
+ * The kernel pmutex takes a relative timeout and fails with ETIMEDOUT when it
+ * runs out, a zero timeout is a trylock.
+ */
+static int pmutex_timedlock(pthread_mutex_t* m, const struct timespec* at)
+{
+    struct timespec now, rel;
+
+    if ((0 > at->tv_nsec) || (1000000000L <= at->tv_nsec)) {
+        return EINVAL;
+    }
+
+    do {
+        clock_gettime(CLOCK_REALTIME, &now);
+        rel.tv_sec  = at->tv_sec - now.tv_sec;
+        rel.tv_nsec = at->tv_nsec - now.tv_nsec;
+        if (0 > rel.tv_nsec) {
+            rel.tv_nsec += 1000000000L;
+            rel.tv_sec--;
+        }
+        if (0 > rel.tv_sec) {
+            /* already expired, still take a free mutex as POSIX requires */
+            rel.tv_sec  = 0;
+            rel.tv_nsec = 0;
+        }
+
+        if (0 == syscall(_NRSYS_pmutex, (long)m, PMUTEX_LOCK, (long)&rel)) {
+            return 0;
+        }
+        /* a signal interrupted the wait, timedlock never fails with EINTR */
+    } while (EINTR == errno);
+
+    return errno;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* m)
+{
+    struct timespec timeout = { 0, 0 };
+
+    if (PTHREAD_MUTEX_NORMAL != MUTEX_TYPE(m)) {
+        if (0 == syscall(_NRSYS_pmutex, (long)m, PMUTEX_LOCK, (long)&timeout)) {
+            return 0;
+        }
+        /* only a held mutex is EBUSY, e.g. EDEADLK or EAGAIN go back to the caller */
+        return ((ETIMEDOUT == errno) || (EBUSY == errno)) ? EBUSY : errno;
+    }
+
+    return hal_umutex_trylock_word(MUTEX_LOCK(m));
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* restrict m, const struct timespec* restrict at)
+{
+    if (PTHREAD_MUTEX_NORMAL != MUTEX_TYPE(m)) {
+        return pmutex_timedlock(m, at);
+    }
+    if (0 == hal_umutex_trylock_word(MUTEX_LOCK(m))) {
+        return 0;
+    }
+
+    return hal_umutex_lock_slow(MUTEX_LOCK(m), &mutex_spin, CLOCK_REALTIME, at);
+}
+
+int pthread_mutex_unlock(pthread_mutex_t* m)
+{
+    if (PTHREAD_MUTEX_NORMAL != MUTEX_TYPE(m)) {
+        /* e.g. EPERM for an errorcheck mutex the caller does not own */
+        return (0 == syscall(_NRSYS_pmutex, (long)m, PMUTEX_UNLOCK, 0)) ? 0 : errno;
+    }
+
+    hal_umutex_unlock_word(MUTEX_LOCK(m), MUTEX_WAITERS(m));
+
+    return 0;
+}
+
+/* libc internals, e.g. pthread_cond_wait(), call these names */
+int __pthread_mutex_lock(pthread_mutex_t* m) __attribute__((alias("pthread_mutex_lock")));
+int __pthread_mutex_trylock(pthread_mutex_t* m) __attribute__((alias("pthread_mutex_trylock")));
+int __pthread_mutex_timedlock(pthread_mutex_t* restrict m, const struct timespec* restrict at)
+    __attribute__((alias("pthread_mutex_timedlock")));
+int __pthread_mutex_unlock(pthread_mutex_t* m) __attribute__((alias("pthread_mutex_unlock")));
+#else
+int pthread_mutex_lock(pthread_mutex_t* m) { return pmutex_lock(m); }
+#endif
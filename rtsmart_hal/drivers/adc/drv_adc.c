@@ -35,6 +35,8 @@
 #include <pthread.h>
 
 #include "drv_adc.h"
+#include "hal_io.h"
+#include "hal_trace.h"
 
 typedef enum {
     RT_ADC_CMD_ENABLE,
@@ -54,8 +56,10 @@ static pthread_spinlock_t _drv_adc_lock = (pthread_spinlock_t)0;
 
 int drv_adc_init()
 {
+    HAL_TRACE_FUNC();
+
     if (0x00 > _drv_adc_fd) {
-        if (0x00 > (_drv_adc_fd = open(DRV_ADC_DEV, O_RDWR))) {
+        if (0x00 > (_drv_adc_fd = hal_io_open(DRV_ADC_DEV, O_RDWR))) {
             printf("[hal_adc]: open device failed\n");
             return -1;
         }
@@ -68,11 +72,13 @@ int drv_adc_init()
 
 int drv_adc_deinit()
 {
+    HAL_TRACE_FUNC();
+
     if (0x00 > _drv_adc_fd) {
         _drv_adc_ref_cnt--;
 
         if (0x00 == _drv_adc_ref_cnt) {
-            close(_drv_adc_fd);
+            hal_io_close(_drv_adc_fd);
             _drv_adc_fd = -1;
 
             memset(&drv_adc_chn_state[0], 0, sizeof(drv_adc_chn_state));
@@ -86,6 +92,8 @@ int drv_adc_deinit()
 
 uint32_t drv_adc_read(int channel)
 {
+    HAL_TRACE_FUNC();
+
     uint32_t value;
 
     if (0x00 > _drv_adc_fd) {
@@ -101,7 +109,7 @@ uint32_t drv_adc_read(int channel)
     pthread_spin_lock(&_drv_adc_lock);
 
     if (0x00 == drv_adc_chn_state[channel]) {
-        if (0x00 != ioctl(_drv_adc_fd, RT_ADC_CMD_ENABLE, channel)) {
+        if (0x00 != hal_io_ioctl(_drv_adc_fd, RT_ADC_CMD_ENABLE, (void*)(intptr_t)channel)) {
             printf("[hal_adc]: enable channel failed\n");
 
             pthread_spin_unlock(&_drv_adc_lock);
@@ -110,8 +118,8 @@ uint32_t drv_adc_read(int channel)
         drv_adc_chn_state[channel] = 1;
     }
 
-    lseek(_drv_adc_fd, channel, SEEK_SET);
-    if (0x00 == read(_drv_adc_fd, &value, sizeof(value))) {
+    hal_io_lseek(_drv_adc_fd, channel, SEEK_SET);
+    if (0x00 == hal_io_read(_drv_adc_fd, &value, sizeof(value))) {
         printf("[hal_adc]: read channel failed\n");
 
         pthread_spin_unlock(&_drv_adc_lock);
@@ -125,6 +133,8 @@ uint32_t drv_adc_read(int channel)
 
 uint32_t drv_adc_read_uv(int channel, uint32_t ref_uv)
 {
+    HAL_TRACE_FUNC();
+
     uint32_t read, result;
     uint64_t read_u64, ref_u64;
 
@@ -27,12 +27,11 @@
 #include <string.h>
 
 #include <errno.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
+#include <pthread.h>
 #include <unistd.h>
 
 #include "drv_fpioa.h"
+#include "hal_utils.h"
 
 #define IOMUX_REG_ADD 0X91105000
 
@@ -235,25 +234,61 @@ static const uint8_t g_pin_func_array[][FPIOA_PIN_MAX_FUNCS] = {
 
 #pragma pack()
 
-static volatile uint32_t* fpioa_reg = NULL;
+/*
+ * Reverse indices of the two tables above, built once on first use: function
+ * to description entry and function to the pins (and selects) that carry it.
+ * Lookups that used to scan both tables are a table access.
+ */
+#define FPIOA_NO_CFG (0xFF)
 
-static volatile uint32_t* check_fpioa(void)
+struct fpioa_func_pin {
+    uint8_t pin;
+    uint8_t sel;
+};
+
+static struct {
+    uint8_t               cfg[FUNC_MAX]; // index into g_func_describ_array, FPIOA_NO_CFG if none
+    uint8_t               pin_cnt[FUNC_MAX];
+    struct fpioa_func_pin pins[FUNC_MAX][FPIOA_PIN_FUNC_ALT_NUM];
+} fpioa_index;
+
+static pthread_once_t fpioa_index_once = PTHREAD_ONCE_INIT;
+
+static void fpioa_index_build(void)
 {
-    if (NULL == fpioa_reg) {
-        int mem_fd = -1;
-        if (0 > mem_fd) {
-            if (0 > (mem_fd = open("/dev/mem", O_RDWR | O_SYNC))) {
-                printf("[hal_fpioa]: open /dev/mem failed\n");
-                return NULL;
+    memset(fpioa_index.cfg, FPIOA_NO_CFG, sizeof(fpioa_index.cfg));
+
+    for (size_t i = 0; i < sizeof(g_func_describ_array) / sizeof(g_func_describ_array[0]); i++) {
+        if (FPIOA_NO_CFG == fpioa_index.cfg[g_func_describ_array[i].func]) {
+            fpioa_index.cfg[g_func_describ_array[i].func] = i;
+        }
+    }
+
+    for (int pin = 0; pin < FPIOA_PIN_MAX_NUM; pin++) {
+        for (int sel = 0; sel < FPIOA_PIN_MAX_FUNCS; sel++) {
+            int func = g_pin_func_array[pin][sel];
+
+            if (FUNC_MAX <= func) {
+                continue;
+            }
+            if (FPIOA_PIN_FUNC_ALT_NUM <= fpioa_index.pin_cnt[func]) {
+                printf("[hal_fpioa]: too many pins\n");
+                continue;
             }
+            fpioa_index.pins[func][fpioa_index.pin_cnt[func]++] = (struct fpioa_func_pin) { .pin = pin, .sel = sel };
         }
+    }
+}
 
-        fpioa_reg = (uint32_t*)mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, IOMUX_REG_ADD);
+static inline void fpioa_index_get(void) { pthread_once(&fpioa_index_once, fpioa_index_build); }
 
-        close(mem_fd);
-        mem_fd = -1;
+static volatile uint32_t* fpioa_reg = NULL;
 
-        if (fpioa_reg == NULL) {
+static volatile uint32_t* check_fpioa(void)
+{
+    if (NULL == fpioa_reg) {
+        fpioa_reg = (volatile uint32_t*)utils_mem_map_get(IOMUX_REG_ADD, FPIOA_PIN_MAX_NUM * sizeof(uint32_t));
+        if (NULL == fpioa_reg) {
             printf("[hal_fpioa]: mmap fpioa failed\n");
             return NULL;
         }
@@ -290,13 +325,16 @@ const fpioa_func_cfg_t* drv_fpioa_get_func_cfg(fpioa_func_t func)
         return &gpio_dft_cfg;
     }
 
-    for (size_t i = 0; i < sizeof(g_func_describ_array) / sizeof(g_func_describ_array[0]); i++) {
-        if (g_func_describ_array[i].func == func) {
-            return &g_func_describ_array[i];
-        }
+    if (FUNC_MAX <= func) {
+        return NULL;
+    }
+
+    fpioa_index_get();
+    if (FPIOA_NO_CFG == fpioa_index.cfg[func]) {
+        return NULL;
     }
 
-    return NULL;
+    return &g_func_describ_array[fpioa_index.cfg[func]];
 }
 
 int drv_fpioa_get_pin_func(int pin, fpioa_func_t* func)
@@ -404,25 +442,16 @@ int drv_fpioa_set_pin_func(int pin, fpioa_func_t func)
 /* Get all pins that a specific function can be assigned to */
 int drv_fpioa_func_available_pins(fpioa_func_t func, int pins[FPIOA_PIN_FUNC_ALT_NUM])
 {
-    int pin_cnt = 0;
-
-    for (size_t i = 0; i < sizeof(g_pin_func_array) / sizeof(g_pin_func_array[0]); i++) {
-        const uint8_t* pin_funcs = &g_pin_func_array[i][0];
-
-        for (int j = 0; j < FPIOA_PIN_MAX_FUNCS; j++) {
-            if (func == pin_funcs[j]) {
-                pins[pin_cnt++] = i;
+    if ((0 > (int)func) || (FUNC_MAX <= func)) {
+        return 0;
+    }
 
-                if (FPIOA_PIN_FUNC_ALT_NUM <= pin_cnt) {
-                    printf("[hal_fpioa]: too many pins\n");
-                    return pin_cnt;
-                }
-                break;
-            }
-        }
+    fpioa_index_get();
+    for (int i = 0; i < fpioa_index.pin_cnt[func]; i++) {
+        pins[i] = fpioa_index.pins[func][i].pin;
     }
 
-    return pin_cnt;
+    return fpioa_index.pin_cnt[func];
 }
 
 /* Get all functions that can be assigned to a specific pin */
@@ -509,13 +538,15 @@ int drv_fpioa_find_pin_by_func(fpioa_func_t func)
         return -1;
     }
 
-    for (int i = 0; i < FPIOA_PIN_MAX_NUM; i++) {
-        if (0x00 != drv_fpioa_get_pin_func(i, &curr_func)) {
+    /* only the pins that can carry the function need reading */
+    fpioa_index_get();
+    for (int i = 0; i < fpioa_index.pin_cnt[func]; i++) {
+        if (0x00 != drv_fpioa_get_pin_func(fpioa_index.pins[func][i].pin, &curr_func)) {
             return -1;
         }
 
         if (curr_func == func) {
-            return i;
+            return fpioa_index.pins[func][i].pin;
         }
     }
 
@@ -567,3 +598,167 @@ fpioa_err_t drv_fpioa_validate_pin(int pin, int func)
 
     return FPIOA_OK;
 }
+
+/** board pin map ************************************************************/
+static void fpioa_map_conflict(fpioa_map_conflict_t* conflicts, size_t max_conflicts, int* cnt, int kind, int index,
+                               int pin, fpioa_func_t func, int other)
+{
+    if (conflicts && ((size_t)*cnt < max_conflicts)) {
+        conflicts[*cnt] = (fpioa_map_conflict_t) { .kind = kind, .index = index, .pin = pin, .func = func, .other = other };
+    }
+    (*cnt)++;
+}
+
+/* registers are read once and only for the pins the map involves */
+static inline uint32_t fpioa_map_reg(uint32_t regs[FPIOA_PIN_MAX_NUM], uint64_t* loaded, int pin)
+{
+    if (!(*loaded & (1ULL << pin))) {
+        regs[pin] = fpioa_reg[pin];
+        *loaded |= 1ULL << pin;
+    }
+
+    return regs[pin];
+}
+
+/* turn the map into new values for the pins in @changed, kept in @regs */
+static int fpioa_map_plan(const fpioa_pin_map_t* map, size_t count, uint32_t flags, fpioa_map_conflict_t* conflicts,
+                          size_t max_conflicts, uint32_t regs[FPIOA_PIN_MAX_NUM], uint64_t* changed)
+{
+    int                     cnt = 0, sel, pin, func;
+    int                     pin_owner[FPIOA_PIN_MAX_NUM];
+    int                     func_owner[FUNC_MAX];
+    uint64_t                loaded = 0, owned = 0;
+    fpioa_iomux_cfg_t       cfg, curr;
+    const fpioa_func_cfg_t* func_cfg;
+
+    if ((NULL == map) && (0x00 != count)) {
+        return -1;
+    }
+
+    if (NULL == check_fpioa()) {
+        return -1;
+    }
+    memset(pin_owner, 0xFF, sizeof(pin_owner));
+    memset(func_owner, 0xFF, sizeof(func_owner));
+    *changed = 0;
+
+    fpioa_index_get();
+
+    for (size_t i = 0; i < count; i++) {
+        pin  = map[i].pin;
+        func = map[i].func;
+
+        if ((0 > pin) || (FPIOA_PIN_MAX_NUM <= pin)) {
+            fpioa_map_conflict(conflicts, max_conflicts, &cnt, FPIOA_MAP_BAD_PIN, i, pin, func, -1);
+            continue;
+        }
+
+        for (sel = 0; sel < FPIOA_PIN_MAX_FUNCS; sel++) {
+            if ((0 <= func) && (func < FUNC_MAX) && (g_pin_func_array[pin][sel] == func)) {
+                break;
+            }
+        }
+        func_cfg = (FPIOA_PIN_MAX_FUNCS > sel) ? drv_fpioa_get_func_cfg(func) : NULL;
+        if (NULL == func_cfg) {
+            fpioa_map_conflict(conflicts, max_conflicts, &cnt, FPIOA_MAP_UNSUPPORTED, i, pin, func, -1);
+            continue;
+        }
+
+        if (0 <= pin_owner[pin]) {
+            if (map[pin_owner[pin]].func != func) {
+                fpioa_map_conflict(conflicts, max_conflicts, &cnt, FPIOA_MAP_PIN_TWICE, i, pin, func, pin_owner[pin]);
+            }
+            continue;
+        }
+
+        if (0 <= func_owner[func]) {
+            fpioa_map_conflict(conflicts, max_conflicts, &cnt, FPIOA_MAP_FUNC_TWICE, i, pin, func, func_owner[func]);
+            continue;
+        }
+        pin_owner[pin]   = i;
+        func_owner[func] = i;
+        owned |= 1ULL << pin;
+
+        curr.u.value     = fpioa_map_reg(regs, &loaded, pin);
+        cfg.u.value      = func_cfg->cfg;
+        cfg.u.bit.io_sel = sel;
+        cfg.u.bit.msc    = curr.u.bit.msc;
+        cfg.u.bit.di     = curr.u.bit.di; // read only, kept so an unchanged pin compares equal
+        if (cfg.u.value != curr.u.value) {
+            regs[pin] = cfg.u.value;
+            *changed |= 1ULL << pin;
+        }
+    }
+
+    /* functions of the map still muxed on a pin the map does not mention */
+    for (uint64_t bits = owned; bits; bits &= bits - 1) {
+        int index = pin_owner[__builtin_ctzll(bits)];
+
+        func = map[index].func;
+        if (GPIO63 >= func) {
+            continue;
+        }
+
+        for (int i = 0; i < fpioa_index.pin_cnt[func]; i++) {
+            pin = fpioa_index.pins[func][i].pin;
+            if (owned & (1ULL << pin)) {
+                continue;
+            }
+
+            curr.u.value = fpioa_map_reg(regs, &loaded, pin);
+            if (curr.u.bit.io_sel != fpioa_index.pins[func][i].sel) {
+                continue;
+            }
+
+            if (FPIOA_MAP_STRICT & flags) {
+                fpioa_map_conflict(conflicts, max_conflicts, &cnt, FPIOA_MAP_FUNC_MOVED, index, map[index].pin, func, pin);
+                continue;
+            }
+            cfg.u.value   = 0;
+            cfg.u.bit.msc = curr.u.bit.msc;
+            regs[pin]     = cfg.u.value;
+            *changed |= 1ULL << pin;
+        }
+    }
+
+    return cnt;
+}
+
+int drv_fpioa_map_check(const fpioa_pin_map_t* map, size_t count, uint32_t flags, fpioa_map_conflict_t* conflicts,
+                        size_t max_conflicts)
+{
+    uint32_t regs[FPIOA_PIN_MAX_NUM];
+    uint64_t changed;
+
+    return fpioa_map_plan(map, count, flags, conflicts, max_conflicts, regs, &changed);
+}
+
+int drv_fpioa_map_apply(const fpioa_pin_map_t* map, size_t count, uint32_t flags)
+{
+    uint32_t             regs[FPIOA_PIN_MAX_NUM];
+    uint64_t             changed;
+    fpioa_map_conflict_t conflicts[8];
+    int                  cnt, written = 0;
+
+    cnt = fpioa_map_plan(map, count, flags, conflicts, sizeof(conflicts) / sizeof(conflicts[0]), regs, &changed);
+    if (0 > cnt) {
+        return -1;
+    }
+
+    if (cnt) {
+        for (int i = 0; (i < cnt) && ((size_t)i < sizeof(conflicts) / sizeof(conflicts[0])); i++) {
+            printf("[hal_fpioa]: map entry %d pin %d func %d conflict %d, other %d\n", conflicts[i].index,
+                   conflicts[i].pin, conflicts[i].func, conflicts[i].kind, conflicts[i].other);
+        }
+        return -1;
+    }
+
+    for (; changed; changed &= changed - 1) {
+        int pin = __builtin_ctzll(changed);
+
+        fpioa_reg[pin] = regs[pin];
+        written++;
+    }
+
+    return written;
+}
@@ -310,6 +310,49 @@ int drv_fpioa_is_func_supported_by_pin(int pin, fpioa_func_t func);
 
 fpioa_err_t drv_fpioa_validate_pin(int pin, int func);
 
+/* board pin map, a whole table of assignments checked and applied at once */
+typedef struct _fpioa_pin_map {
+    int          pin;
+    fpioa_func_t func;
+} fpioa_pin_map_t;
+
+typedef enum {
+    FPIOA_MAP_BAD_PIN     = 1, // pin out of range
+    FPIOA_MAP_UNSUPPORTED = 2, // pin can not carry the function
+    FPIOA_MAP_PIN_TWICE   = 3, // pin given two different functions, @other is the first entry
+    FPIOA_MAP_FUNC_TWICE  = 4, // function given to two pins, @other is the first entry
+    FPIOA_MAP_FUNC_MOVED  = 5, // function taken from pin @other outside the map, only with FPIOA_MAP_STRICT
+} fpioa_map_conflict_kind_t;
+
+typedef struct _fpioa_map_conflict {
+    int          kind; // @ref fpioa_map_conflict_kind_t
+    int          index; // map entry
+    int          pin;
+    fpioa_func_t func;
+    int          other;
+} fpioa_map_conflict_t;
+
+#define FPIOA_MAP_STRICT (1 << 0) /* a function already on a pin outside the map is a conflict, not moved */
+
+/**
+ * @brief Check @count assignments against the pin tables and the current mux
+ *        without touching a register. The same assignment listed twice is
+ *        accepted. Up to @max_conflicts findings are stored in @conflicts.
+ * @return Number of conflicts found (may exceed @max_conflicts), -1 on error.
+ */
+int drv_fpioa_map_check(const fpioa_pin_map_t* map, size_t count, uint32_t flags, fpioa_map_conflict_t* conflicts,
+                        size_t max_conflicts);
+
+/**
+ * @brief Check the map and, when it is free of conflicts, write it in one pass
+ *        over the mux registers. Like drv_fpioa_set_pin_func() a function
+ *        moved off a pin outside the map leaves that pin on GPIO with its
+ *        drive disabled, and the voltage select of every pin is kept. Only
+ *        registers whose value changes are written.
+ * @return Number of registers written, -1 on conflict or error (nothing written).
+ */
+int drv_fpioa_map_apply(const fpioa_pin_map_t* map, size_t count, uint32_t flags);
+
 /* for fpioa configure generator. */
 typedef struct _fpioa_func_cfg {
     fpioa_func_t func;
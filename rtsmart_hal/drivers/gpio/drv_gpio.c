@@ -27,13 +27,21 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 #include "drv_fpioa.h"
 #include "drv_gpio.h"
 #include "drv_timer.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
 
 #define DRV_GPIO_DEV ("/dev/gpio")
 
@@ -46,7 +54,11 @@
 
 #define KD_GPIO_IOCTL_CTRL_IRQ _IOWR('G', 4, gpio_cfg_t*)
 
-#define KD_GPIO_SIG (SIGRTMIN + 1 + KD_TIMER_MAX_NUM)
+#define KD_GPIO_IOCTL_PORT _IOWR('G', 5, gpio_port_cfg_t*)
+
+#define KD_GPIO_SIG       (SIGRTMIN + 1 + KD_TIMER_MAX_NUM)
+#define KD_GPIO_SIG_NUM   (8) /* shared round robin by callback irqs */
+#define KD_GPIO_EVENT_SIG (KD_GPIO_SIG + KD_GPIO_SIG_NUM) /* every pin of every event queue */
 
 typedef struct {
     uint16_t pin;
@@ -62,15 +74,30 @@ typedef struct {
     void*    sigval; // reuse as callback
 } gpio_irqcfg_t;
 
+typedef struct {
+    uint32_t op; // @ref gpio_port_op_t
+    uint32_t reserved;
+    uint64_t mask; // bit n is GPIOn
+    uint64_t value; // levels to write, or the levels read back
+} gpio_port_cfg_t;
+
 static int gpio_fd      = -1;
 static int gpio_ref_cnt = 0;
 
 static const int gpio_inst_type = 0;
+static HAL_SLAB_CACHE_DEFINE(gpio_inst_cache, "drv_gpio", drv_gpio_inst_t);
+
+static const int gpio_port_type = 0;
+static HAL_SLAB_CACHE_DEFINE(gpio_port_cache, "drv_gpio_port", drv_gpio_port_t);
+
+/* instances share signals, the handler stays installed until the last one goes */
+static int             gpio_sig_users[KD_GPIO_SIG_NUM + 1];
+static pthread_mutex_t gpio_sig_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static int drv_gpio_open(void)
 {
     if (0x00 > gpio_fd) {
-        gpio_fd = open(DRV_GPIO_DEV, O_RDWR);
+        gpio_fd = hal_io_open(DRV_GPIO_DEV, O_RDWR);
         if (0x00 > gpio_fd) {
             printf("[hal_gpio]: open gpio device failed.\n");
             return -1;
@@ -84,9 +111,9 @@ static int drv_gpio_open(void)
 
 static void drv_gpio_close(void)
 {
-    if (0x00 > gpio_fd) {
+    if (0x00 <= gpio_fd) {
         if (0x00 == (--gpio_ref_cnt)) {
-            close(gpio_fd);
+            hal_io_close(gpio_fd);
             gpio_fd = -1;
         }
     }
@@ -99,7 +126,7 @@ static inline int drv_gpio_ioctl(int cmd, void* arg)
         return -1;
     }
 
-    if (0x00 != ioctl(gpio_fd, cmd, arg)) {
+    if (0x00 != hal_io_ioctl(gpio_fd, cmd, arg)) {
         return -1;
     }
 
@@ -108,6 +135,8 @@ static inline int drv_gpio_ioctl(int cmd, void* arg)
 
 int drv_gpio_inst_create(int pin, drv_gpio_inst_t** inst)
 {
+    HAL_TRACE_FUNC();
+
     fpioa_func_t pin_curr_func;
 
     if (NULL == inst) {
@@ -133,9 +162,9 @@ int drv_gpio_inst_create(int pin, drv_gpio_inst_t** inst)
         *inst = NULL;
     }
 
-    *inst = malloc(sizeof(drv_gpio_inst_t));
+    *inst = hal_slab_alloc(&gpio_inst_cache);
     if (NULL == *inst) {
-        printf("[hal_gpio]: malloc failed");
+        printf("[hal_gpio]: alloc instance failed");
         drv_gpio_close();
         return -1;
     }
@@ -147,12 +176,16 @@ int drv_gpio_inst_create(int pin, drv_gpio_inst_t** inst)
     (*inst)->curr_irq_mode = GPIO_PE_MAX;
     (*inst)->irq_args      = NULL;
     (*inst)->irq_callback  = NULL;
+    (*inst)->signo         = 0;
+    (*inst)->dispatch      = HAL_DISPATCH_SIGNAL;
 
     return 0;
 }
 
 void drv_gpio_inst_destroy(drv_gpio_inst_t** inst)
 {
+    HAL_TRACE_FUNC();
+
     if (NULL == inst) {
         return;
     }
@@ -169,12 +202,18 @@ void drv_gpio_inst_destroy(drv_gpio_inst_t** inst)
     drv_gpio_mode_set(*inst, GPIO_DM_INPUT);
     drv_gpio_close();
 
-    free(*inst);
+    if (HAL_DISPATCH_THREAD == (*inst)->dispatch) {
+        hal_dispatch_sync();
+    }
+
+    hal_slab_free(&gpio_inst_cache, *inst);
     *inst = NULL;
 }
 
 int drv_gpio_value_set(drv_gpio_inst_t* inst, gpio_pin_value_t val)
 {
+    HAL_TRACE_FUNC();
+
     uint8_t value = val;
 
     if (NULL == inst) {
@@ -191,9 +230,9 @@ int drv_gpio_value_set(drv_gpio_inst_t* inst, gpio_pin_value_t val)
     }
     inst->curr_val = val;
 
-    lseek(gpio_fd, inst->pin, SEEK_SET);
+    hal_io_lseek(gpio_fd, inst->pin, SEEK_SET);
 
-    if (0x01 != write(gpio_fd, &value, 1)) {
+    if (0x01 != hal_io_write(gpio_fd, &value, 1)) {
         printf("[hal_gpio]: set pin%d failed\n", inst->pin);
         return -1;
     }
@@ -203,6 +242,8 @@ int drv_gpio_value_set(drv_gpio_inst_t* inst, gpio_pin_value_t val)
 
 gpio_pin_value_t drv_gpio_value_get(drv_gpio_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     uint8_t value = 0;
 
     if (NULL == inst) {
@@ -214,9 +255,9 @@ gpio_pin_value_t drv_gpio_value_get(drv_gpio_inst_t* inst)
         return -1;
     }
 
-    lseek(gpio_fd, inst->pin, SEEK_SET);
+    hal_io_lseek(gpio_fd, inst->pin, SEEK_SET);
 
-    if (0x01 != read(gpio_fd, &value, 1)) {
+    if (0x01 != hal_io_read(gpio_fd, &value, 1)) {
         printf("[hal_gpio]: get pin%d failed\n", inst->pin);
         return -1;
     }
@@ -227,6 +268,8 @@ gpio_pin_value_t drv_gpio_value_get(drv_gpio_inst_t* inst)
 
 int drv_gpio_mode_set(drv_gpio_inst_t* inst, gpio_drive_mode_t mode)
 {
+    HAL_TRACE_FUNC();
+
     if (NULL == inst) {
         return -1;
     }
@@ -243,6 +286,8 @@ int drv_gpio_mode_set(drv_gpio_inst_t* inst, gpio_drive_mode_t mode)
 
 gpio_drive_mode_t drv_gpio_mode_get(drv_gpio_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     if (NULL == inst) {
         return GPIO_DM_MAX;
     }
@@ -261,6 +306,8 @@ gpio_drive_mode_t drv_gpio_mode_get(drv_gpio_inst_t* inst)
 
 int drv_gpio_set_irq(drv_gpio_inst_t* inst, int enable)
 {
+    HAL_TRACE_FUNC();
+
     if (NULL == inst) {
         return -1;
     }
@@ -271,6 +318,44 @@ int drv_gpio_set_irq(drv_gpio_inst_t* inst, int enable)
     return drv_gpio_ioctl(KD_GPIO_IOCTL_CTRL_IRQ, &cfg);
 }
 
+static int drv_gpio_sig_get(int signo, void (*handler)(int, siginfo_t*, void*))
+{
+    struct sigaction sa;
+    int              ret = 0;
+
+    pthread_mutex_lock(&gpio_sig_lock);
+    if (0x00 == gpio_sig_users[signo - KD_GPIO_SIG]) {
+        sa.sa_flags     = SA_SIGINFO;
+        sa.sa_sigaction = handler;
+        sigemptyset(&sa.sa_mask);
+        if ((-1) == sigaction(signo, &sa, NULL)) {
+            printf("[hal_gpio]: register sigaction failed.\n");
+            ret = -1;
+        }
+    }
+    if (0x00 == ret) {
+        gpio_sig_users[signo - KD_GPIO_SIG]++;
+    }
+    pthread_mutex_unlock(&gpio_sig_lock);
+
+    return ret;
+}
+
+static void drv_gpio_sig_put(int signo)
+{
+    struct sigaction sa;
+
+    pthread_mutex_lock(&gpio_sig_lock);
+    if (gpio_sig_users[signo - KD_GPIO_SIG] && (0x00 == --gpio_sig_users[signo - KD_GPIO_SIG])) {
+        sa.sa_handler   = SIG_IGN;
+        sa.sa_sigaction = NULL;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = 0;
+        sigaction(signo, &sa, NULL);
+    }
+    pthread_mutex_unlock(&gpio_sig_lock);
+}
+
 static void drv_gpio_sig_handler(int sig, siginfo_t* si, void* uc)
 {
     drv_gpio_inst_t* inst = si->si_ptr;
@@ -288,14 +373,15 @@ static void drv_gpio_sig_handler(int sig, siginfo_t* si, void* uc)
     }
 
     if (inst->irq_callback) {
-        inst->irq_callback(inst->irq_args);
+        hal_dispatch_deliver(inst->dispatch, inst->irq_callback, inst->irq_args);
     }
 }
 
 int drv_gpio_register_irq(drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debounce, gpio_irq_callback callback, void* userargs)
 {
-    int              ret;
-    struct sigaction sa;
+    HAL_TRACE_FUNC();
+
+    int        ret;
     static int register_cnt;
 
     if (NULL == inst) {
@@ -328,13 +414,11 @@ int drv_gpio_register_irq(drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debou
     inst->curr_irq_mode = mode;
     inst->irq_args      = userargs;
     inst->irq_callback  = callback;
-    inst->signo = (KD_GPIO_SIG + (register_cnt++ % 8));
+    inst->signo = (KD_GPIO_SIG + (register_cnt++ % KD_GPIO_SIG_NUM));
 
-    sa.sa_flags     = SA_SIGINFO;
-    sa.sa_sigaction = drv_gpio_sig_handler;
-    sigemptyset(&sa.sa_mask);
-    if ((-1) == sigaction(inst->signo, &sa, NULL)) {
-        printf("[hal_gpio]: register sigaction failed.\n");
+    if (0x00 != drv_gpio_sig_get(inst->signo, drv_gpio_sig_handler)) {
+        inst->curr_irq_mode = GPIO_PE_MAX;
+        inst->irq_callback  = NULL;
         return -1;
     }
 
@@ -343,11 +427,9 @@ int drv_gpio_register_irq(drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debou
     if (0x00 != (ret = drv_gpio_ioctl(KD_GPIO_IOCTL_SET_IRQ, &cfg))) {
         printf("[hal_gpio]: set pin %d irq failed %d\n", cfg.pin, ret);
 
-        sa.sa_handler   = SIG_IGN;
-        sa.sa_sigaction = NULL;
-        sigemptyset(&sa.sa_mask);
-        sa.sa_flags = 0;
-        sigaction(inst->signo, &sa, NULL);
+        drv_gpio_sig_put(inst->signo);
+        inst->curr_irq_mode = GPIO_PE_MAX;
+        inst->irq_callback  = NULL;
 
         return -1;
     }
@@ -357,13 +439,14 @@ int drv_gpio_register_irq(drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debou
 
 int drv_gpio_unregister_irq(drv_gpio_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     if (NULL == inst) {
         return -1;
     }
 
-    int              ret;
-    struct sigaction sa;
-    gpio_cfg_t       cfg = { .pin = inst->pin, 0 };
+    int        ret;
+    gpio_cfg_t cfg = { .pin = inst->pin, 0 };
 
     cfg.value |= (1 << 7); // disable irq and detach irq.
 
@@ -371,6 +454,11 @@ int drv_gpio_unregister_irq(drv_gpio_inst_t* inst)
         return 0;
     }
 
+    if (KD_GPIO_EVENT_SIG == inst->signo) {
+        printf("[hal_gpio]: pin %d irq belongs to an event queue\n", inst->pin);
+        return -1;
+    }
+
     if (0x00 != (ret = drv_gpio_ioctl(KD_GPIO_IOCTL_CTRL_IRQ, &cfg))) {
         printf("[hal_gpio]: disable pin %d irq failed %d\n", cfg.pin, ret);
         return -1;
@@ -380,11 +468,794 @@ int drv_gpio_unregister_irq(drv_gpio_inst_t* inst)
     inst->irq_args      = NULL;
     inst->irq_callback  = NULL;
 
-    sa.sa_handler   = SIG_IGN;
-    sa.sa_sigaction = NULL;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(inst->signo, &sa, NULL);
+    drv_gpio_sig_put(inst->signo);
+
+    if (HAL_DISPATCH_THREAD == inst->dispatch) {
+        hal_dispatch_sync();
+    }
+
+    return 0;
+}
+
+int drv_gpio_set_dispatch(drv_gpio_inst_t* inst, hal_dispatch_mode_t mode)
+{
+    HAL_TRACE_FUNC();
+
+    if (NULL == inst) {
+        return -1;
+    }
+
+    if (HAL_DISPATCH_MODE_MAX <= mode) {
+        printf("[hal_gpio]: invalid dispatch mode %d\n", mode);
+        return -1;
+    }
+
+    if ((HAL_DISPATCH_THREAD == mode) && (0x00 != hal_dispatch_start())) {
+        printf("[hal_gpio]: start irq dispatcher failed\n");
+        return -1;
+    }
+
+    inst->dispatch = mode;
+
+    return 0;
+}
+
+/** gpio port ****************************************************************/
+/* kernel without the port request, one lseek plus read or write per pin */
+static int drv_gpio_port_emulate(gpio_port_cfg_t* cfg)
+{
+    uint64_t bits   = cfg->mask;
+    uint64_t levels = 0;
+    uint8_t  value;
+    int      pin;
+
+    for (; bits; bits &= bits - 1) {
+        pin = __builtin_ctzll(bits);
+
+        hal_io_lseek(gpio_fd, pin, SEEK_SET);
+
+        if (GPIO_PORT_OP_READ == cfg->op) {
+            if (0x01 != hal_io_read(gpio_fd, &value, 1)) {
+                printf("[hal_gpio]: get pin%d failed\n", pin);
+                return -1;
+            }
+            levels |= (uint64_t)!!value << pin;
+        } else {
+            /* the caller resolved the operation into plain levels */
+            value = (cfg->value >> pin) & 1;
+            if (0x01 != hal_io_write(gpio_fd, &value, 1)) {
+                printf("[hal_gpio]: set pin%d failed\n", pin);
+                return -1;
+            }
+        }
+    }
+
+    if (GPIO_PORT_OP_READ == cfg->op) {
+        cfg->value = levels;
+    }
+
+    return 0;
+}
+
+static int drv_gpio_port_request(drv_gpio_port_t* port, gpio_port_op_t op, uint64_t mask, uint64_t* value)
+{
+    gpio_port_cfg_t cfg = { .op = op, .mask = mask, .value = value ? *value : 0 };
+    uint64_t        next;
+
+    if ((NULL == port) || ((void*)&gpio_port_type != port->base)) {
+        return -1;
+    }
+
+    if ((0x00 == mask) || (mask & ~port->mask)) {
+        printf("[hal_gpio]: mask 0x%016llx not in port 0x%016llx\n", (unsigned long long)mask,
+               (unsigned long long)port->mask);
+        return -1;
+    }
+
+    switch (op) {
+    case GPIO_PORT_OP_SET:
+        next = port->out | mask;
+        break;
+    case GPIO_PORT_OP_CLEAR:
+        next = port->out & ~mask;
+        break;
+    case GPIO_PORT_OP_TOGGLE:
+        next = port->out ^ mask;
+        break;
+    case GPIO_PORT_OP_WRITE:
+        next = (port->out & ~mask) | (cfg.value & mask);
+        break;
+    default:
+        next = port->out;
+        break;
+    }
+
+    if (port->native) {
+        if (0x00 != hal_io_ioctl(gpio_fd, KD_GPIO_IOCTL_PORT, &cfg)) {
+            printf("[hal_gpio]: port request %d failed\n", op);
+            return -1;
+        }
+    } else {
+        if (GPIO_PORT_OP_READ != op) {
+            cfg.value = next;
+        }
+        if (0x00 != drv_gpio_port_emulate(&cfg)) {
+            return -1;
+        }
+    }
+
+    if (GPIO_PORT_OP_READ == op) {
+        *value = cfg.value & mask;
+    } else {
+        port->out = next;
+    }
+
+    return 0;
+}
+
+int drv_gpio_port_create(uint64_t mask, gpio_drive_mode_t mode, drv_gpio_port_t** port)
+{
+    HAL_TRACE_FUNC();
+
+    fpioa_func_t    pin_curr_func;
+    gpio_cfg_t      cfg;
+    gpio_port_cfg_t probe = { .op = GPIO_PORT_OP_READ };
+
+    if (NULL == port) {
+        return -1;
+    }
+
+    if ((0x00 == mask) || (GPIO_DM_MAX <= mode)) {
+        printf("[hal_gpio]: invalid port mask 0x%016llx or mode %d\n", (unsigned long long)mask, mode);
+        return -1;
+    }
+
+    for (uint64_t bits = mask; bits; bits &= bits - 1) {
+        int pin = __builtin_ctzll(bits);
+
+        if ((0x00 != drv_fpioa_get_pin_func(pin, &pin_curr_func)) || (pin_curr_func != (GPIO0 + pin))) {
+            printf("[hal_gpio]: pin %d current fucntion not GPIO\n", pin);
+            return -1;
+        }
+    }
+
+    if (0x00 != drv_gpio_open()) {
+        return -1;
+    }
+
+    if (*port) {
+        drv_gpio_port_destroy(port);
+        *port = NULL;
+    }
+
+    *port = hal_slab_alloc(&gpio_port_cache);
+    if (NULL == *port) {
+        printf("[hal_gpio]: alloc port failed");
+        drv_gpio_close();
+        return -1;
+    }
+
+    (*port)->base = (void*)&gpio_port_type;
+    (*port)->mask = mask;
+    (*port)->out  = 0;
+    (*port)->mode = mode;
+
+    for (uint64_t bits = mask; bits; bits &= bits - 1) {
+        cfg.pin   = __builtin_ctzll(bits);
+        cfg.value = mode;
+
+        if (0x00 != drv_gpio_ioctl(KD_GPIO_IOCTL_SET_MODE, &cfg)) {
+            printf("[hal_gpio]: set pin %d mode failed\n", cfg.pin);
+            goto err;
+        }
+    }
+
+    /* probe the kernel with a read, it also seeds the output latch for toggle */
+    probe.mask      = mask;
+    (*port)->native = (0x00 == hal_io_ioctl(gpio_fd, KD_GPIO_IOCTL_PORT, &probe));
+    if (!(*port)->native && (0x00 != drv_gpio_port_emulate(&probe))) {
+        goto err;
+    }
+    (*port)->out = probe.value & mask;
 
     return 0;
+
+err:
+    hal_slab_free(&gpio_port_cache, *port);
+    *port = NULL;
+    drv_gpio_close();
+
+    return -1;
+}
+
+void drv_gpio_port_destroy(drv_gpio_port_t** port)
+{
+    HAL_TRACE_FUNC();
+
+    gpio_cfg_t cfg = { .value = GPIO_DM_INPUT };
+
+    if ((NULL == port) || (NULL == *port)) {
+        return;
+    }
+
+    if ((void*)&gpio_port_type != (*port)->base) {
+        printf("[hal_gpio]: inst not gpio port\n");
+        return;
+    }
+
+    for (uint64_t bits = (*port)->mask; bits; bits &= bits - 1) {
+        cfg.pin = __builtin_ctzll(bits);
+        drv_gpio_ioctl(KD_GPIO_IOCTL_SET_MODE, &cfg);
+    }
+    drv_gpio_close();
+
+    hal_slab_free(&gpio_port_cache, *port);
+    *port = NULL;
+}
+
+int drv_gpio_port_set(drv_gpio_port_t* port, uint64_t mask)
+{
+    HAL_TRACE_FUNC();
+
+    return drv_gpio_port_request(port, GPIO_PORT_OP_SET, mask, NULL);
+}
+
+int drv_gpio_port_clear(drv_gpio_port_t* port, uint64_t mask)
+{
+    HAL_TRACE_FUNC();
+
+    return drv_gpio_port_request(port, GPIO_PORT_OP_CLEAR, mask, NULL);
+}
+
+int drv_gpio_port_toggle(drv_gpio_port_t* port, uint64_t mask)
+{
+    HAL_TRACE_FUNC();
+
+    return drv_gpio_port_request(port, GPIO_PORT_OP_TOGGLE, mask, NULL);
+}
+
+int drv_gpio_port_write(drv_gpio_port_t* port, uint64_t mask, uint64_t value)
+{
+    HAL_TRACE_FUNC();
+
+    return drv_gpio_port_request(port, GPIO_PORT_OP_WRITE, mask, &value);
+}
+
+int drv_gpio_port_read(drv_gpio_port_t* port, uint64_t mask, uint64_t* value)
+{
+    HAL_TRACE_FUNC();
+
+    if (NULL == value) {
+        return -1;
+    }
+
+    return drv_gpio_port_request(port, GPIO_PORT_OP_READ, mask, value);
+}
+
+/** gpio event queue *********************************************************/
+/*
+ * Every pin of every queue is registered with KD_GPIO_EVENT_SIG and a cookie of
+ * pin number and registration generation as signal value, real-time signals
+ * queue one siginfo per edge so the handler tells the pins apart by the value
+ * alone. The cookie never points into a queue, a signal still queued after the
+ * pin left its queue fails the generation check instead of touching freed
+ * memory. The handler stamps the edge, runs the user space debounce and pushes
+ * the event on a bounded multi-producer ring (handlers may run on several
+ * threads at once), then writes the wakeup pipe once per drain so the reader
+ * can sleep in poll().
+ */
+struct gpio_event_cell {
+    uint64_t     seq;
+    gpio_event_t ev;
+};
+
+struct gpio_event_pin {
+    drv_gpio_inst_t* inst;
+    uint64_t         filter_ticks;
+    uint64_t         last; // ticks of the last accepted edge
+    gpio_pin_edge_t  mode;
+    uint8_t          level; // both edges, toggled by every edge from the level read at add
+};
+
+struct _drv_gpio_event {
+    void* base;
+
+    uint32_t                depth; // power of 2
+    struct gpio_event_cell* ring;
+    uint64_t                head; // producers, signal handlers
+    uint64_t                tail; // the reader
+
+    int      wake_fd[2]; // pipe, [0] is handed out for poll()
+    int      wake_pending;
+    uint32_t lost; // overflows not yet flagged on a queued event
+
+    uint64_t                pins; // bit n: GPIOn feeds the queue
+    struct gpio_event_pin   pin[GPIO_IRQ_MAX_NUM];
+    gpio_event_stats_t      stats;
+};
+
+/* pin registrations, kept out of the queues so stale signals are checked against live memory */
+struct gpio_event_reg {
+    drv_gpio_event_t* evq;
+    uint32_t          gen; // odd while the pin feeds evq
+};
+
+static const int             gpio_event_type = 0;
+static struct gpio_event_reg gpio_event_regs[GPIO_IRQ_MAX_NUM];
+static int                   gpio_event_handlers; // handlers past the entry, destroy waits for them
+static HAL_SLAB_CACHE_DEFINE(gpio_event_cache, "drv_gpio_event", drv_gpio_event_t);
+
+static int drv_gpio_event_push(drv_gpio_event_t* evq, const gpio_event_t* ev)
+{
+    struct gpio_event_cell* cell;
+    uint64_t                pos, seq;
+    uint32_t                depth, max;
+    int64_t                 diff;
+
+    pos = __atomic_load_n(&evq->head, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &evq->ring[pos & (evq->depth - 1)];
+        seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int64_t)(seq - pos);
+        if (0 == diff) {
+            if (__atomic_compare_exchange_n(&evq->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (0 > diff) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&evq->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->ev = *ev;
+    if (__atomic_load_n(&evq->lost, __ATOMIC_RELAXED) && __atomic_exchange_n(&evq->lost, 0, __ATOMIC_RELAXED)) {
+        cell->ev.flags |= GPIO_EVENT_F_OVERFLOW;
+    }
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    depth = (uint32_t)(pos + 1 - __atomic_load_n(&evq->tail, __ATOMIC_RELAXED));
+    max   = __atomic_load_n(&evq->stats.max_depth, __ATOMIC_RELAXED);
+    while ((depth > max)
+           && !__atomic_compare_exchange_n(&evq->stats.max_depth, &max, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+
+    return 0;
+}
+
+static int drv_gpio_event_pop(drv_gpio_event_t* evq, gpio_event_t* events, int max)
+{
+    struct gpio_event_cell* cell;
+    int                     n;
+
+    for (n = 0; n < max; n++) {
+        cell = &evq->ring[evq->tail & (evq->depth - 1)];
+        if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != (evq->tail + 1)) {
+            break;
+        }
+        events[n] = cell->ev;
+        __atomic_store_n(&cell->seq, evq->tail + evq->depth, __ATOMIC_RELEASE);
+        __atomic_store_n(&evq->tail, evq->tail + 1, __ATOMIC_RELAXED);
+    }
+
+    return n;
+}
+
+static void drv_gpio_event_wake(drv_gpio_event_t* evq)
+{
+    uint8_t token = 0;
+
+    if (0x00 == __atomic_exchange_n(&evq->wake_pending, 1, __ATOMIC_SEQ_CST)) {
+        if (0x01 != write(evq->wake_fd[1], &token, 1)) {
+            /* pipe full means the reader is already woken */
+        }
+    }
+}
+
+static void* drv_gpio_event_cookie(uint32_t pin, uint32_t gen)
+{
+    return (void*)((uintptr_t)gen * GPIO_IRQ_MAX_NUM + pin);
+}
+
+/* async-signal-safe, no locks and no device requests */
+static void drv_gpio_event_deliver(int sig, siginfo_t* si)
+{
+    uint32_t               pin = (uintptr_t)si->si_ptr % GPIO_IRQ_MAX_NUM;
+    uint32_t               gen;
+    struct gpio_event_pin* slot;
+    drv_gpio_event_t*      evq;
+    gpio_event_t           ev = { .ticks = utils_cpu_ticks() };
+    uint64_t               last;
+    uint8_t                level;
+    int                    saved_errno;
+
+    if ((SI_SIGIO != si->si_code) || (KD_GPIO_EVENT_SIG != sig)) {
+        return;
+    }
+
+    /* pairs with the generation bump in remove, see drv_gpio_event_quiesce() */
+    gen = __atomic_load_n(&gpio_event_regs[pin].gen, __ATOMIC_SEQ_CST);
+    if (!(gen & 1) || (drv_gpio_event_cookie(pin, gen) != si->si_ptr)) {
+        return;
+    }
+    evq  = __atomic_load_n(&gpio_event_regs[pin].evq, __ATOMIC_ACQUIRE);
+    slot = &evq->pin[pin];
+
+    /* both edges track the level through every edge, filtered ones included */
+    level = __atomic_xor_fetch(&slot->level, 1, __ATOMIC_RELAXED);
+
+    last = __atomic_load_n(&slot->last, __ATOMIC_RELAXED);
+    if (slot->filter_ticks && last && ((ev.ticks - last) < slot->filter_ticks)) {
+        __atomic_fetch_add(&evq->stats.filtered, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_store_n(&slot->last, ev.ticks, __ATOMIC_RELAXED);
+
+    saved_errno = errno;
+
+    ev.pin = pin;
+    switch (slot->mode) {
+    case GPIO_PE_RISING:
+    case GPIO_PE_HIGH:
+        ev.level = GPIO_PV_HIGH;
+        break;
+    case GPIO_PE_FALLING:
+    case GPIO_PE_LOW:
+        ev.level = GPIO_PV_LOW;
+        break;
+    default:
+        ev.level = level;
+        break;
+    }
+
+    if (0x00 != drv_gpio_event_push(evq, &ev)) {
+        __atomic_fetch_add(&evq->stats.overflows, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&evq->lost, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&evq->stats.events, 1, __ATOMIC_RELAXED);
+    }
+    drv_gpio_event_wake(evq);
+
+    errno = saved_errno;
+}
+
+static void drv_gpio_event_sig_handler(int sig, siginfo_t* si, void* uc)
+{
+    __atomic_fetch_add(&gpio_event_handlers, 1, __ATOMIC_SEQ_CST);
+    drv_gpio_event_deliver(sig, si);
+    __atomic_fetch_sub(&gpio_event_handlers, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Called once every pin of the queue is removed, their generations are even
+ * so no handler entering from now on touches the queue. A handler counts
+ * itself before it checks the generation and remove bumps the generation
+ * before this waits for the count (both sequentially consistent), so a
+ * handler that saw the old generation is seen here. Signals still pending on
+ * this thread are taken and handled right away, the stale ones drop out.
+ */
+static void drv_gpio_event_quiesce(void)
+{
+    struct timespec zero = { 0, 0 };
+    sigset_t        set, old;
+    siginfo_t       si;
+
+    sigemptyset(&set);
+    sigaddset(&set, KD_GPIO_EVENT_SIG);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    while (KD_GPIO_EVENT_SIG == sigtimedwait(&set, &si, &zero)) {
+        drv_gpio_event_deliver(KD_GPIO_EVENT_SIG, &si);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    while (__atomic_load_n(&gpio_event_handlers, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+    }
+}
+
+int drv_gpio_event_create(uint32_t depth, drv_gpio_event_t** evq)
+{
+    HAL_TRACE_FUNC();
+
+    uint32_t size = 1;
+
+    if (NULL == evq) {
+        return -1;
+    }
+
+    if ((0x00 == depth) || ((1U << 31) < depth)) {
+        printf("[hal_gpio]: invalid event queue depth %u\n", depth);
+        return -1;
+    }
+    while (size < depth) {
+        size <<= 1;
+    }
+
+    if (0x00 != drv_gpio_open()) {
+        return -1;
+    }
+
+    if (*evq) {
+        drv_gpio_event_destroy(evq);
+        *evq = NULL;
+    }
+
+    *evq = hal_slab_zalloc(&gpio_event_cache);
+    if (NULL == *evq) {
+        printf("[hal_gpio]: alloc event queue failed\n");
+        goto err_close;
+    }
+
+    (*evq)->base  = (void*)&gpio_event_type;
+    (*evq)->depth = size;
+    (*evq)->ring  = hal_slab_buf_alloc(size * sizeof(struct gpio_event_cell));
+    if (NULL == (*evq)->ring) {
+        printf("[hal_gpio]: alloc %u events failed\n", size);
+        goto err_free;
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        (*evq)->ring[i].seq = i;
+    }
+
+    if (0x00 != pipe((*evq)->wake_fd)) {
+        printf("[hal_gpio]: create event pipe failed\n");
+        goto err_ring;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl((*evq)->wake_fd[i], F_SETFL, fcntl((*evq)->wake_fd[i], F_GETFL) | O_NONBLOCK);
+        fcntl((*evq)->wake_fd[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    if (0x00 != drv_gpio_sig_get(KD_GPIO_EVENT_SIG, drv_gpio_event_sig_handler)) {
+        goto err_pipe;
+    }
+
+    return 0;
+
+err_pipe:
+    close((*evq)->wake_fd[0]);
+    close((*evq)->wake_fd[1]);
+err_ring:
+    hal_slab_buf_free((*evq)->ring);
+err_free:
+    hal_slab_free(&gpio_event_cache, *evq);
+    *evq = NULL;
+err_close:
+    drv_gpio_close();
+
+    return -1;
+}
+
+void drv_gpio_event_destroy(drv_gpio_event_t** evq)
+{
+    HAL_TRACE_FUNC();
+
+    if ((NULL == evq) || (NULL == *evq)) {
+        return;
+    }
+
+    if ((void*)&gpio_event_type != (*evq)->base) {
+        printf("[hal_gpio]: inst not gpio event queue\n");
+        return;
+    }
+
+    for (uint64_t bits = (*evq)->pins; bits; bits &= bits - 1) {
+        drv_gpio_event_remove(*evq, (*evq)->pin[__builtin_ctzll(bits)].inst);
+    }
+    drv_gpio_event_quiesce();
+    drv_gpio_sig_put(KD_GPIO_EVENT_SIG);
+
+    close((*evq)->wake_fd[0]);
+    close((*evq)->wake_fd[1]);
+    hal_slab_buf_free((*evq)->ring);
+    (*evq)->base = NULL;
+    drv_gpio_close();
+
+    hal_slab_free(&gpio_event_cache, *evq);
+    *evq = NULL;
+}
+
+int drv_gpio_event_add(drv_gpio_event_t* evq, drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debounce_ms,
+                       uint32_t filter_us)
+{
+    HAL_TRACE_FUNC();
+
+    struct gpio_event_pin* slot;
+    struct gpio_event_reg* reg;
+    gpio_irqcfg_t          cfg;
+    gpio_cfg_t             ctrl;
+    gpio_port_cfg_t        probe = { .op = GPIO_PORT_OP_READ };
+    uint8_t                value = 0;
+    uint32_t               gen;
+
+    if ((NULL == evq) || ((void*)&gpio_event_type != evq->base) || (NULL == inst)) {
+        return -1;
+    }
+
+    if (GPIO_PE_MAX <= mode) {
+        printf("[hal_gpio]: edge mode only support %d~%d, not %d\n", GPIO_PE_RISING, GPIO_PE_LOW, mode);
+        return -1;
+    }
+
+    if (GPIO_IRQ_MAX_NUM <= inst->pin) {
+        printf("[hal_gpio]: pin irq only support 0~63, not %d\n", inst->pin);
+        return -1;
+    }
+
+    if (GPIO_PE_MAX != inst->curr_irq_mode) {
+        printf("[hal_gpio]: pin %d irq already registered\n", inst->pin);
+        return -1;
+    }
+
+    if (10 > debounce_ms) {
+        debounce_ms = 10;
+    }
+
+    slot               = &evq->pin[inst->pin];
+    reg                = &gpio_event_regs[inst->pin];
+    slot->inst         = inst;
+    slot->mode         = mode;
+    slot->filter_ticks = (uint64_t)filter_us * (CPU_TICKS_PER_SECOND / 1000000);
+    __atomic_store_n(&slot->last, 0, __ATOMIC_RELAXED);
+
+    /* both edges report the level after the edge, the handler toggles it from here */
+    probe.mask = 1ULL << inst->pin;
+    if (0x00 == hal_io_ioctl(gpio_fd, KD_GPIO_IOCTL_PORT, &probe)) {
+        value = !!probe.value;
+    } else {
+        hal_io_lseek(gpio_fd, inst->pin, SEEK_SET);
+        hal_io_read(gpio_fd, &value, 1);
+    }
+    __atomic_store_n(&slot->level, value, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&reg->evq, evq, __ATOMIC_RELAXED);
+    gen = __atomic_add_fetch(&reg->gen, 1, __ATOMIC_SEQ_CST);
+
+    cfg = (gpio_irqcfg_t) {
+        .pin         = inst->pin,
+        .mode        = mode,
+        .debounce_ms = debounce_ms,
+        .signo       = KD_GPIO_EVENT_SIG,
+        .sigval      = drv_gpio_event_cookie(inst->pin, gen),
+    };
+    if (0x00 != drv_gpio_ioctl(KD_GPIO_IOCTL_SET_IRQ, &cfg)) {
+        printf("[hal_gpio]: set pin %d irq failed\n", inst->pin);
+        goto err;
+    }
+
+    inst->curr_irq_mode = mode;
+    inst->irq_callback  = NULL;
+    inst->irq_args      = NULL;
+    inst->signo         = KD_GPIO_EVENT_SIG;
+    evq->pins |= 1ULL << inst->pin;
+
+    ctrl = (gpio_cfg_t) { .pin = inst->pin, .value = 1 };
+    if (0x00 != drv_gpio_ioctl(KD_GPIO_IOCTL_CTRL_IRQ, &ctrl)) {
+        printf("[hal_gpio]: enable pin %d irq failed\n", inst->pin);
+        drv_gpio_event_remove(evq, inst);
+        return -1;
+    }
+
+    return 0;
+
+err:
+    __atomic_add_fetch(&reg->gen, 1, __ATOMIC_SEQ_CST);
+    slot->inst = NULL;
+
+    return -1;
+}
+
+int drv_gpio_event_remove(drv_gpio_event_t* evq, drv_gpio_inst_t* inst)
+{
+    HAL_TRACE_FUNC();
+
+    gpio_cfg_t cfg;
+
+    if ((NULL == evq) || ((void*)&gpio_event_type != evq->base) || (NULL == inst)) {
+        return -1;
+    }
+
+    if ((GPIO_IRQ_MAX_NUM <= inst->pin) || !(evq->pins & (1ULL << inst->pin)) || (inst != evq->pin[inst->pin].inst)) {
+        printf("[hal_gpio]: pin %d not in the event queue\n", inst->pin);
+        return -1;
+    }
+
+    cfg = (gpio_cfg_t) { .pin = inst->pin, .value = (1 << 7) }; // disable irq and detach irq.
+    if (0x00 != drv_gpio_ioctl(KD_GPIO_IOCTL_CTRL_IRQ, &cfg)) {
+        printf("[hal_gpio]: disable pin %d irq failed\n", inst->pin);
+        return -1;
+    }
+
+    /* signals still queued for the pin are ignored from here on */
+    __atomic_add_fetch(&gpio_event_regs[inst->pin].gen, 1, __ATOMIC_SEQ_CST);
+    evq->pin[inst->pin].inst = NULL;
+    evq->pins &= ~(1ULL << inst->pin);
+
+    inst->curr_irq_mode = GPIO_PE_MAX;
+    inst->signo         = 0;
+
+    return 0;
+}
+
+int drv_gpio_event_fd(drv_gpio_event_t* evq)
+{
+    if ((NULL == evq) || ((void*)&gpio_event_type != evq->base)) {
+        return -1;
+    }
+
+    return evq->wake_fd[0];
+}
+
+int drv_gpio_event_read(drv_gpio_event_t* evq, gpio_event_t* events, int max, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    struct pollfd pfd;
+    uint8_t       drain[16];
+    int           n;
+
+    if ((NULL == evq) || ((void*)&gpio_event_type != evq->base) || (NULL == events) || (0 >= max)) {
+        return -1;
+    }
+
+    for (;;) {
+        n = drv_gpio_event_pop(evq, events, max);
+        if (n < max) {
+            /* drained, re-arm the wakeup before looking once more so no push is missed */
+            __atomic_store_n(&evq->wake_pending, 0, __ATOMIC_SEQ_CST);
+            while (0 < read(evq->wake_fd[0], drain, sizeof(drain))) { }
+            n += drv_gpio_event_pop(evq, events + n, max - n);
+            if (n == max) {
+                drv_gpio_event_wake(evq);
+            }
+        }
+
+        if (n || (0x00 == timeout_ms)) {
+            break;
+        }
+
+        pfd.fd      = evq->wake_fd[0];
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        n           = poll(&pfd, 1, timeout_ms);
+        if (0x00 == n) {
+            break;
+        }
+        if ((0x00 > n) && (EINTR != errno)) {
+            printf("[hal_gpio]: wait event failed %d\n", errno);
+            return -1;
+        }
+        /* woken or interrupted, an interrupted wait restarts with the full timeout */
+    }
+    __atomic_fetch_add(&evq->stats.read, n, __ATOMIC_RELAXED);
+
+    return n;
+}
+
+int drv_gpio_event_get_stats(drv_gpio_event_t* evq, gpio_event_stats_t* stats)
+{
+    if ((NULL == evq) || ((void*)&gpio_event_type != evq->base) || (NULL == stats)) {
+        return -1;
+    }
+
+    stats->events    = __atomic_load_n(&evq->stats.events, __ATOMIC_RELAXED);
+    stats->read      = __atomic_load_n(&evq->stats.read, __ATOMIC_RELAXED);
+    stats->overflows = __atomic_load_n(&evq->stats.overflows, __ATOMIC_RELAXED);
+    stats->filtered  = __atomic_load_n(&evq->stats.filtered, __ATOMIC_RELAXED);
+    stats->max_depth = __atomic_load_n(&evq->stats.max_depth, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+void drv_gpio_event_reset_stats(drv_gpio_event_t* evq)
+{
+    if ((NULL == evq) || ((void*)&gpio_event_type != evq->base)) {
+        return;
+    }
+
+    /* handlers keep counting while this runs, clear field by field */
+    __atomic_store_n(&evq->stats.events, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&evq->stats.read, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&evq->stats.overflows, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&evq->stats.filtered, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&evq->stats.max_depth, 0, __ATOMIC_RELAXED);
 }
@@ -24,8 +24,13 @@
  */
 #pragma once
 
-#define GPIO_IRQ_MAX_NUM (64)
-#define GPIO_MAX_NUM     (64 + 8)
+#include <stdint.h>
+
+#include "hal_dispatch.h"
+
+#define GPIO_IRQ_MAX_NUM  (64)
+#define GPIO_MAX_NUM      (64 + 8)
+#define GPIO_PORT_MAX_NUM (64) /* a port mask covers GPIO0~GPIO63 */
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,8 +56,36 @@ typedef enum _gpio_drive_mode {
 
 typedef enum _gpio_pin_value { GPIO_PV_LOW, GPIO_PV_HIGH } gpio_pin_value_t;
 
+typedef enum _gpio_port_op {
+    GPIO_PORT_OP_SET    = 0,
+    GPIO_PORT_OP_CLEAR  = 1,
+    GPIO_PORT_OP_TOGGLE = 2,
+    GPIO_PORT_OP_WRITE  = 3, // masked write
+    GPIO_PORT_OP_READ   = 4,
+    GPIO_PORT_OP_MAX,
+} gpio_port_op_t;
+
 typedef void (*gpio_irq_callback)(void* args);
 
+#define GPIO_EVENT_F_OVERFLOW (1 << 0) /* events were lost right before this one */
+
+typedef struct _gpio_event {
+    uint64_t ticks; // utils_cpu_ticks() when the edge reached user space
+    uint16_t pin;
+    uint8_t  level; // pin level after the edge
+    uint8_t  flags; // GPIO_EVENT_F_*
+} gpio_event_t;
+
+typedef struct _gpio_event_stats {
+    uint64_t events; // edges queued
+    uint64_t read; // events handed to the reader
+    uint64_t overflows; // edges lost because the ring was full
+    uint64_t filtered; // edges dropped by the user space debounce
+    uint32_t max_depth; // most events waiting at once
+} gpio_event_stats_t;
+
+typedef struct _drv_gpio_event drv_gpio_event_t;
+
 typedef struct _drv_gpio_inst {
     void* base;
 
@@ -65,8 +98,20 @@ typedef struct _drv_gpio_inst {
     void*             irq_args;
     gpio_irq_callback irq_callback;
     int signo;
+
+    hal_dispatch_mode_t dispatch;
 } drv_gpio_inst_t;
 
+typedef struct _drv_gpio_port {
+    void* base;
+
+    uint64_t mask; // pins owned by the port, bit n is GPIOn
+    uint64_t out; // output levels last written through the port
+
+    gpio_drive_mode_t mode;
+    int               native; // 1: one request per operation, 0: emulated per pin
+} drv_gpio_port_t;
+
 int  drv_gpio_inst_create(int pin, drv_gpio_inst_t** inst);
 void drv_gpio_inst_destroy(drv_gpio_inst_t** inst);
 
@@ -82,6 +127,75 @@ int drv_gpio_register_irq(drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debou
                           void* userargs);
 int drv_gpio_unregister_irq(drv_gpio_inst_t* inst);
 
+/**
+ * @brief Select how the irq callback is delivered, in the signal handler
+ *        (default) or on the dispatcher thread, see hal_dispatch.h.
+ */
+int drv_gpio_set_dispatch(drv_gpio_inst_t* inst, hal_dispatch_mode_t mode);
+
+/**
+ * @brief Claim the pins in @mask as one port, all set to @mode. Every pin must
+ *        already be muxed to its GPIO function. Pins of a port should not be
+ *        driven through a drv_gpio_inst_t at the same time, its value cache
+ *        would go stale.
+ */
+int  drv_gpio_port_create(uint64_t mask, gpio_drive_mode_t mode, drv_gpio_port_t** port);
+void drv_gpio_port_destroy(drv_gpio_port_t** port);
+
+/**
+ * @brief Drive the pins in @mask (a subset of the port) in a single request:
+ *        set drives them high, clear low, toggle inverts them and write gives
+ *        each the matching bit of @value. When the kernel driver does not know
+ *        the port request the pins are written one by one.
+ */
+int drv_gpio_port_set(drv_gpio_port_t* port, uint64_t mask);
+int drv_gpio_port_clear(drv_gpio_port_t* port, uint64_t mask);
+int drv_gpio_port_toggle(drv_gpio_port_t* port, uint64_t mask);
+int drv_gpio_port_write(drv_gpio_port_t* port, uint64_t mask, uint64_t value);
+
+/**
+ * @brief Sample the pins in @mask in a single request, bit n of @value is the
+ *        level of GPIOn, bits outside @mask read 0.
+ */
+int drv_gpio_port_read(drv_gpio_port_t* port, uint64_t mask, uint64_t* value);
+
+/**
+ * @brief Create an edge event queue holding up to @depth events (rounded up to
+ *        a power of 2). Pins added to it report every edge as a timestamped
+ *        event instead of calling back, all of them through one signal, so
+ *        every irq capable pin can be added without the signals colliding.
+ */
+int  drv_gpio_event_create(uint32_t depth, drv_gpio_event_t** evq);
+void drv_gpio_event_destroy(drv_gpio_event_t** evq);
+
+/**
+ * @brief Feed the edges of @inst into the queue. @debounce_ms is handed to the
+ *        kernel like drv_gpio_register_irq(), on top of it edges closer than
+ *        @filter_us to the last accepted edge of the pin are dropped in user
+ *        space. The pin irq is enabled on return and must not be registered
+ *        with a callback at the same time.
+ */
+int drv_gpio_event_add(drv_gpio_event_t* evq, drv_gpio_inst_t* inst, gpio_pin_edge_t mode, int debounce_ms,
+                       uint32_t filter_us);
+int drv_gpio_event_remove(drv_gpio_event_t* evq, drv_gpio_inst_t* inst);
+
+/**
+ * @brief File descriptor that polls readable while events are queued, it may
+ *        wake once more after the queue was drained.
+ */
+int drv_gpio_event_fd(drv_gpio_event_t* evq);
+
+/**
+ * @brief Take up to @max events in arrival order, waiting at most @timeout_ms
+ *        (-1 forever, 0 not at all) for the first one. Only one thread may read
+ *        a queue at a time.
+ * @return Number of events copied to @events, 0 on timeout, -1 on error.
+ */
+int drv_gpio_event_read(drv_gpio_event_t* evq, gpio_event_t* events, int max, int timeout_ms);
+
+int  drv_gpio_event_get_stats(drv_gpio_event_t* evq, gpio_event_stats_t* stats);
+void drv_gpio_event_reset_stats(drv_gpio_event_t* evq);
+
 static inline int drv_gpio_get_pin_id(drv_gpio_inst_t* inst)
 {
     if (!inst) {
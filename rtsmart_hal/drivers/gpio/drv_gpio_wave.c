@@ -0,0 +1,264 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "drv_gpio_wave.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+static const int gpio_wave_type = 0;
+static HAL_SLAB_CACHE_DEFINE(gpio_wave_cache, "drv_gpio_wave", drv_gpio_wave_t);
+
+static int drv_gpio_wave_add(drv_gpio_wave_t* wave, uint32_t op, uint64_t at_ns, uint64_t mask, uint64_t level)
+{
+    gpio_wave_step_t* step;
+
+    if ((NULL == wave) || ((void*)&gpio_wave_type != wave->base)) {
+        return -1;
+    }
+
+    if ((0x00 == mask) || (mask & ~wave->port->mask)) {
+        printf("[hal_gpio_wave]: mask 0x%016llx not in port 0x%016llx\n", (unsigned long long)mask,
+               (unsigned long long)wave->port->mask);
+        return -1;
+    }
+
+    if (wave->compiled) {
+        printf("[hal_gpio_wave]: schedule already compiled, clear it first\n");
+        return -1;
+    }
+
+    if (wave->num_steps >= wave->max_steps) {
+        printf("[hal_gpio_wave]: schedule full, %u entries\n", wave->max_steps);
+        return -1;
+    }
+
+    step        = &wave->steps[wave->num_steps++];
+    step->at    = at_ns;
+    step->mask  = mask;
+    step->level = level & mask;
+    step->op    = op;
+
+    if (GPIO_WAVE_OP_CAPTURE == op) {
+        wave->num_captures++;
+    }
+
+    return 0;
+}
+
+int drv_gpio_wave_create(drv_gpio_port_t* port, uint32_t max_steps, drv_gpio_wave_t** wave)
+{
+    HAL_TRACE_FUNC();
+
+    if ((NULL == port) || (NULL == wave) || (0x00 == max_steps)) {
+        return -1;
+    }
+
+    if (*wave) {
+        drv_gpio_wave_destroy(wave);
+        *wave = NULL;
+    }
+
+    *wave = hal_slab_zalloc(&gpio_wave_cache);
+    if (NULL == *wave) {
+        printf("[hal_gpio_wave]: alloc instance failed\n");
+        return -1;
+    }
+
+    (*wave)->steps = hal_slab_buf_alloc((size_t)max_steps * sizeof(gpio_wave_step_t));
+    if (NULL == (*wave)->steps) {
+        printf("[hal_gpio_wave]: alloc %u entries failed\n", max_steps);
+        hal_slab_free(&gpio_wave_cache, *wave);
+        *wave = NULL;
+        return -1;
+    }
+
+    (*wave)->base      = (void*)&gpio_wave_type;
+    (*wave)->port      = port;
+    (*wave)->max_steps = max_steps;
+
+    return 0;
+}
+
+void drv_gpio_wave_destroy(drv_gpio_wave_t** wave)
+{
+    HAL_TRACE_FUNC();
+
+    if ((NULL == wave) || (NULL == *wave)) {
+        return;
+    }
+
+    if ((void*)&gpio_wave_type != (*wave)->base) {
+        printf("[hal_gpio_wave]: inst not gpio wave\n");
+        return;
+    }
+
+    hal_slab_buf_free((*wave)->steps);
+    (*wave)->base = NULL;
+
+    hal_slab_free(&gpio_wave_cache, *wave);
+    *wave = NULL;
+}
+
+int drv_gpio_wave_add_write(drv_gpio_wave_t* wave, uint64_t at_ns, uint64_t mask, uint64_t level)
+{
+    return drv_gpio_wave_add(wave, GPIO_WAVE_OP_WRITE, at_ns, mask, level);
+}
+
+int drv_gpio_wave_add_capture(drv_gpio_wave_t* wave, uint64_t at_ns, uint64_t mask)
+{
+    return drv_gpio_wave_add(wave, GPIO_WAVE_OP_CAPTURE, at_ns, mask, 0);
+}
+
+int drv_gpio_wave_clear(drv_gpio_wave_t* wave)
+{
+    if ((NULL == wave) || ((void*)&gpio_wave_type != wave->base)) {
+        return -1;
+    }
+
+    wave->num_steps    = 0;
+    wave->num_captures = 0;
+    wave->compiled     = 0;
+
+    return 0;
+}
+
+int drv_gpio_wave_compile(drv_gpio_wave_t* wave)
+{
+    HAL_TRACE_FUNC();
+
+    gpio_wave_step_t step, *prev;
+    uint32_t         i, j, n;
+
+    if ((NULL == wave) || ((void*)&gpio_wave_type != wave->base)) {
+        return -1;
+    }
+
+    if (wave->compiled) {
+        return 0;
+    }
+
+    /* insertion sort, stable and linear for the usual already ordered schedule */
+    for (i = 1; i < wave->num_steps; i++) {
+        step = wave->steps[i];
+        for (j = i; (j > 0) && (wave->steps[j - 1].at > step.at); j--) {
+            wave->steps[j] = wave->steps[j - 1];
+        }
+        wave->steps[j] = step;
+    }
+
+    /* writes due together become one request, the later entry wins per pin */
+    for (i = 0, n = 0; i < wave->num_steps; i++) {
+        step = wave->steps[i];
+        prev = n ? &wave->steps[n - 1] : NULL;
+
+        if (prev && (GPIO_WAVE_OP_WRITE == step.op) && (GPIO_WAVE_OP_WRITE == prev->op) && (prev->at == step.at)) {
+            prev->level = (prev->level & ~step.mask) | step.level;
+            prev->mask |= step.mask;
+            continue;
+        }
+        wave->steps[n++] = step;
+    }
+    wave->num_steps = n;
+
+    for (i = 0; i < wave->num_steps; i++) {
+        wave->steps[i].at = utils_ns_to_cpu_ticks(wave->steps[i].at);
+    }
+    wave->compiled = 1;
+
+    return 0;
+}
+
+int drv_gpio_wave_run(drv_gpio_wave_t* wave, uint64_t* samples, uint32_t max_samples, gpio_wave_result_t* result)
+{
+    HAL_TRACE_FUNC();
+
+    const gpio_wave_step_t* step;
+    drv_gpio_port_t*        port;
+    uint64_t                start, due, now, late, late_max = 0, late_sum = 0, req, req_max = 0, value;
+    uint32_t                i, worst = 0, captures = 0;
+    int                     ret = 0;
+
+    if ((NULL == wave) || ((void*)&gpio_wave_type != wave->base)) {
+        return -1;
+    }
+
+    if ((0x00 != max_samples) && (NULL == samples)) {
+        return -1;
+    }
+
+    if (0x00 != drv_gpio_wave_compile(wave)) {
+        return -1;
+    }
+    port = wave->port;
+
+    start = now = utils_cpu_ticks();
+    for (i = 0; i < wave->num_steps; i++) {
+        step = &wave->steps[i];
+        due  = start + step->at;
+
+        while ((now = utils_cpu_ticks()) < due) { }
+
+        if (GPIO_WAVE_OP_WRITE == step->op) {
+            ret = drv_gpio_port_write(port, step->mask, step->level);
+        } else {
+            ret = drv_gpio_port_read(port, step->mask, &value);
+            if ((0x00 == ret) && (captures < max_samples)) {
+                samples[captures++] = value;
+            }
+        }
+        req = utils_cpu_ticks() - now;
+
+        late = now - due;
+        late_sum += late;
+        if (late > late_max) {
+            late_max = late;
+            worst    = i;
+        }
+        if (req > req_max) {
+            req_max = req;
+        }
+
+        if (0x00 != ret) {
+            printf("[hal_gpio_wave]: entry %u failed\n", i);
+            i++;
+            break;
+        }
+    }
+
+    if (result) {
+        result->steps          = i;
+        result->captures       = captures;
+        result->worst_step     = worst;
+        result->duration_ns    = wave->num_steps ? utils_cpu_ticks_to_ns(wave->steps[wave->num_steps - 1].at) : 0;
+        result->elapsed_ns     = i ? utils_cpu_ticks_to_ns(now - start) : 0;
+        result->late_ns_max    = utils_cpu_ticks_to_ns(late_max);
+        result->late_ns_mean   = i ? utils_cpu_ticks_to_ns(late_sum / i) : 0;
+        result->request_ns_max = utils_cpu_ticks_to_ns(req_max);
+    }
+
+    return ret ? -1 : 0;
+}
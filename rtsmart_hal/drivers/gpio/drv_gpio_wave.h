@@ -0,0 +1,119 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "drv_gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bit-bang waveform engine.
+ *
+ * A schedule of (time offset, pin mask, level) writes and (time offset, pin
+ * mask) captures is built once against a gpio port and compiled: entries are
+ * sorted, offsets converted to cpu ticks and writes due at the same time merged
+ * into one port request. Running it busy-waits on utils_cpu_ticks() from one
+ * loop, nothing is computed between the entries, and reports how late each
+ * entry was issued. The calling thread spins for the whole waveform, keep
+ * schedules short or run them from a high priority thread.
+ */
+
+typedef enum _gpio_wave_op {
+    GPIO_WAVE_OP_WRITE   = 0, // drive the masked pins to the levels
+    GPIO_WAVE_OP_CAPTURE = 1, // sample the masked pins
+    GPIO_WAVE_OP_MAX,
+} gpio_wave_op_t;
+
+typedef struct _gpio_wave_step {
+    uint64_t at; // ns from the start until compiled, ticks after
+    uint64_t mask;
+    uint64_t level;
+    uint32_t op; // @ref gpio_wave_op_t
+    uint32_t reserved;
+} gpio_wave_step_t;
+
+typedef struct _gpio_wave_result {
+    uint32_t steps; // port requests issued
+    uint32_t captures; // samples stored
+    uint32_t worst_step; // index of the latest request in the compiled schedule
+    uint64_t duration_ns; // offset of the last entry, what was asked for
+    uint64_t elapsed_ns; // start to the last request, what was achieved
+    uint64_t late_ns_max; // request issued after its offset
+    uint64_t late_ns_mean;
+    uint64_t request_ns_max; // cost of one port request
+} gpio_wave_result_t;
+
+typedef struct _drv_gpio_wave {
+    void* base;
+
+    drv_gpio_port_t*  port;
+    gpio_wave_step_t* steps;
+    uint32_t          max_steps;
+    uint32_t          num_steps;
+    uint32_t          num_captures;
+    int               compiled;
+} drv_gpio_wave_t;
+
+/**
+ * @brief Create an empty schedule of at most @max_steps entries for @port, the
+ *        port must stay alive while the schedule is used.
+ */
+int  drv_gpio_wave_create(drv_gpio_port_t* port, uint32_t max_steps, drv_gpio_wave_t** wave);
+void drv_gpio_wave_destroy(drv_gpio_wave_t** wave);
+
+/**
+ * @brief Append an entry @at_ns after the start of the waveform. Entries may be
+ *        added in any order, equal offsets keep the order they were added in.
+ *        A compiled schedule has to be cleared before adding again.
+ */
+int drv_gpio_wave_add_write(drv_gpio_wave_t* wave, uint64_t at_ns, uint64_t mask, uint64_t level);
+int drv_gpio_wave_add_capture(drv_gpio_wave_t* wave, uint64_t at_ns, uint64_t mask);
+
+/**
+ * @brief Empty the schedule, keeping its port and size.
+ */
+int drv_gpio_wave_clear(drv_gpio_wave_t* wave);
+
+/**
+ * @brief Sort, convert and merge the entries, done by drv_gpio_wave_run() when
+ *        the schedule is not compiled yet.
+ */
+int drv_gpio_wave_compile(drv_gpio_wave_t* wave);
+
+/**
+ * @brief Play the schedule once. The levels of every capture entry go to
+ *        @samples in schedule order, bit n is GPIOn, up to @max_samples of them.
+ *        @result may be NULL.
+ * @return 0 on success, -1 if a port request failed, the waveform stops there.
+ */
+int drv_gpio_wave_run(drv_gpio_wave_t* wave, uint64_t* samples, uint32_t max_samples, gpio_wave_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -37,6 +37,9 @@
 #include "drv_fpioa.h"
 
 #include "drv_i2c.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
 
 #define RT_I2C_DEV_CTRL_10BIT (8 * 0x100 + 0x01)
 // #define RT_I2C_DEV_CTRL_ADDR    (8 * 0x100 + 0x02)
@@ -46,6 +49,7 @@
 #define RT_I2C_DEV_CTRL_7BIT    (8 * 0x100 + 0x06)
 
 static const int i2c_master_inst_type = 0;
+static HAL_SLAB_CACHE_DEFINE(i2c_inst_cache, "drv_i2c", drv_i2c_inst_t);
 
 static int hard_i2c_in_use[KD_HARD_I2C_MAX_NUM];
 
@@ -56,11 +60,13 @@ static int drv_i2c_ioctl(drv_i2c_inst_t* inst, int cmd, void* arg)
         return -1;
     }
 
-    return ioctl(inst->fd, cmd, arg);
+    return hal_io_ioctl(inst->fd, cmd, arg);
 }
 
 int drv_i2c_inst_create(int id, uint32_t freq, uint32_t timeout_ms, uint8_t scl, uint8_t sda, drv_i2c_inst_t** inst)
 {
+    HAL_TRACE_FUNC();
+
     int  fd = -1;
     char dev_name[64];
     int  dev_type = DRV_I2C_TYPE_HARD;
@@ -107,16 +113,16 @@ int drv_i2c_inst_create(int id, uint32_t freq, uint32_t timeout_ms, uint8_t scl,
     }
     snprintf(dev_name, sizeof(dev_name), "/dev/i2c%d", id);
 
-    if (0 > (fd = open(dev_name, O_RDWR))) {
+    if (0 > (fd = hal_io_open(dev_name, O_RDWR))) {
         printf("[hal_i2c]: open %s failed\n", dev_name);
         return -1;
     }
 
-    *inst = malloc(sizeof(drv_i2c_inst_t));
+    *inst = hal_slab_alloc(&i2c_inst_cache);
     if (NULL == *inst) {
-        printf("[hal_i2c]: malloc failed");
+        printf("[hal_i2c]: alloc instance failed");
 
-        close(fd);
+        hal_io_close(fd);
         return -1;
     }
     memset(*inst, 0x00, sizeof(drv_i2c_inst_t));
@@ -139,6 +145,8 @@ int drv_i2c_inst_create(int id, uint32_t freq, uint32_t timeout_ms, uint8_t scl,
 
 void drv_i2c_inst_destroy(drv_i2c_inst_t** inst)
 {
+    HAL_TRACE_FUNC();
+
     int id, type, fd;
     if (NULL == (*inst)) {
         return;
@@ -153,11 +161,11 @@ void drv_i2c_inst_destroy(drv_i2c_inst_t** inst)
     fd   = (*inst)->fd;
     id   = (*inst)->id;
 
-    free(*inst);
+    hal_slab_free(&i2c_inst_cache, *inst);
     *inst = NULL;
 
     if (0 <= fd) {
-        close(fd);
+        hal_io_close(fd);
     }
 
     if (DRV_I2C_TYPE_SOFT == type) {
@@ -175,6 +183,8 @@ void drv_i2c_inst_destroy(drv_i2c_inst_t** inst)
 
 int drv_i2c_set_7b_addr(drv_i2c_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     if (!inst) {
         return -1;
     }
@@ -184,6 +194,8 @@ int drv_i2c_set_7b_addr(drv_i2c_inst_t* inst)
 
 int drv_i2c_set_10b_addr(drv_i2c_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     if (!inst) {
         return -1;
     }
@@ -193,6 +205,8 @@ int drv_i2c_set_10b_addr(drv_i2c_inst_t* inst)
 
 int drv_i2c_set_freq(drv_i2c_inst_t* inst, uint32_t freq)
 {
+    HAL_TRACE_FUNC();
+
     uint32_t _freq = freq;
 
     if (!inst) {
@@ -215,6 +229,8 @@ int drv_i2c_set_freq(drv_i2c_inst_t* inst, uint32_t freq)
 
 int drv_i2c_set_timeout(drv_i2c_inst_t* inst, uint32_t timeout_ms)
 {
+    HAL_TRACE_FUNC();
+
     uint32_t _timeout_ms = timeout_ms;
 
     if (!inst) {
@@ -237,6 +253,8 @@ int drv_i2c_set_timeout(drv_i2c_inst_t* inst, uint32_t timeout_ms)
 
 int drv_i2c_transfer(drv_i2c_inst_t* inst, i2c_msg_t* msgs, int msg_cnt)
 {
+    HAL_TRACE_FUNC();
+
     struct rt_i2c_priv_data {
         i2c_msg_t* msgs;
         size_t     number;
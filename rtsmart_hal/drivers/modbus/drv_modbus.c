@@ -0,0 +1,627 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "drv_modbus.h"
+#include "drv_uart.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define MODBUS_CHAR_BITS    (11) // start, 8 data, parity or second stop, stop
+#define MODBUS_FAST_BAUD    (19200)
+#define MODBUS_GAP_SLACK_MS (20) // scheduling and driver fifo latency on top of the line time
+#define MODBUS_SPIN_US      (200) // sleep for longer waits, spin the rest
+
+/* a merged read of one poll round */
+struct modbus_poll_req {
+    uint8_t  adu[8];
+    uint8_t  slave, func;
+    uint16_t addr, count;
+    int      first, num; // items in poll->order
+};
+
+struct _drv_modbus_poll {
+    void* base;
+
+    drv_modbus_t*       mb;
+    modbus_poll_item_t* items;
+    int*                order; // item indices sorted by slave, function and address
+    int                 num_items;
+
+    struct modbus_poll_req* reqs;
+    int                     num_reqs;
+};
+
+static const int modbus_type;
+static const int modbus_poll_type;
+static HAL_SLAB_CACHE_DEFINE(modbus_cache, "drv_modbus", drv_modbus_t);
+static HAL_SLAB_CACHE_DEFINE(modbus_poll_cache, "drv_modbus_poll", drv_modbus_poll_t);
+
+static const uint16_t modbus_crc_table[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+void drv_modbus_frame_timing(uint32_t baud_rate, uint32_t* t15_us, uint32_t* t35_us)
+{
+    uint32_t t15 = 750, t35 = 1750;
+
+    if ((0x00 != baud_rate) && (MODBUS_FAST_BAUD >= baud_rate)) {
+        t15 = (uint32_t)((15ULL * MODBUS_CHAR_BITS * 1000000ULL + 10ULL * baud_rate - 1) / (10ULL * baud_rate));
+        t35 = (uint32_t)((35ULL * MODBUS_CHAR_BITS * 1000000ULL + 10ULL * baud_rate - 1) / (10ULL * baud_rate));
+    }
+
+    if (t15_us) {
+        *t15_us = t15;
+    }
+    if (t35_us) {
+        *t35_us = t35;
+    }
+}
+
+uint16_t drv_modbus_crc16(const uint8_t* data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc = (crc >> 8) ^ modbus_crc_table[(crc ^ *data++) & 0xFF];
+    }
+
+    return crc;
+}
+
+static size_t modbus_put_crc(uint8_t* adu, size_t len)
+{
+    uint16_t crc = drv_modbus_crc16(adu, len);
+
+    adu[len]     = crc & 0xFF;
+    adu[len + 1] = crc >> 8;
+
+    return len + 2;
+}
+
+static void modbus_wait_until(uint64_t ticks)
+{
+    uint64_t now = utils_cpu_ticks();
+
+    if (now >= ticks) {
+        return;
+    }
+    if ((ticks - now) > (uint64_t)MODBUS_SPIN_US * CPU_TICKS_PER_SECOND / 1000000) {
+        usleep((ticks - now) * 1000000ULL / CPU_TICKS_PER_SECOND - MODBUS_SPIN_US);
+    }
+    while (utils_cpu_ticks() < ticks) {
+    }
+}
+
+/*
+ * Send @adu and read an answer of @expect bytes (5 for an exception) into
+ * @rsp. The bus silence comes from the line time, not fixed sleeps: the
+ * request goes out as soon as t3.5 passed after the last frame and the
+ * response is complete once the expected length arrived. A silence of more
+ * than t1.5 (plus the scheduling slack) inside the response is a frame error.
+ */
+static int modbus_transact(drv_modbus_t* mb, const uint8_t* adu, size_t len, uint8_t* rsp, size_t expect)
+{
+    uint64_t start, now, deadline, line, rtt;
+    uint8_t  junk[64];
+    size_t   got = 0, n;
+    int      wait, ret;
+
+    modbus_wait_until(mb->idle_ticks);
+
+    /* late answers and line noise of the previous transaction */
+    while (0 < drv_uart_poll(mb->uart, 0)) {
+        n = drv_uart_read(mb->uart, junk, sizeof(junk));
+        if ((0 == n) || ((size_t)-1 == n) || ((size_t)-2 == n)) {
+            break;
+        }
+    }
+
+    start    = utils_cpu_ticks();
+    deadline = start + (uint64_t)mb->timeout_ms * CPU_TICKS_PER_SECOND / 1000;
+    mb->stats.transactions++;
+    for (size_t sent = 0; sent < len;) {
+        n = drv_uart_write(mb->uart, adu + sent, len - sent);
+        if (((size_t)-1 == n) || ((size_t)-2 == n)) {
+            /* tx fifo full, or the uart is gone */
+            if (utils_cpu_ticks() >= deadline) {
+                mb->stats.timeouts++;
+                return MODBUS_ERR_TIMEOUT;
+            }
+            usleep(100);
+            continue;
+        }
+        sent += n;
+    }
+
+    /* the request is on the line until its last character left */
+    line = (uint64_t)len * mb->char_ns * CPU_TICKS_PER_SECOND / 1000000000ULL;
+    if (0x00 == adu[0]) {
+        mb->idle_ticks = start + line + (uint64_t)mb->t35_us * CPU_TICKS_PER_SECOND / 1000000;
+        mb->stats.ok++;
+        return 0;
+    }
+
+    deadline = start + line + (uint64_t)mb->timeout_ms * CPU_TICKS_PER_SECOND / 1000;
+    while (got < expect) {
+        now = utils_cpu_ticks();
+        if (0x00 == got) {
+            wait = (now < deadline) ? (int)((deadline - now) * 1000 / CPU_TICKS_PER_SECOND) + 1 : 0;
+        } else {
+            /* inside a frame the next character follows within t1.5, a longer silence breaks the frame */
+            wait = (int)((mb->t15_us + 999) / 1000) + MODBUS_GAP_SLACK_MS;
+        }
+
+        ret = drv_uart_poll(mb->uart, wait);
+        if (0 >= ret) {
+            break;
+        }
+        n = drv_uart_read(mb->uart, rsp + got, expect - got);
+        if (((size_t)-1 == n) || ((size_t)-2 == n)) {
+            continue;
+        }
+        got += n;
+        if ((2 <= got) && (rsp[1] & 0x80)) {
+            expect = 5;
+        }
+    }
+
+    now            = utils_cpu_ticks();
+    mb->idle_ticks = now + (uint64_t)mb->t35_us * CPU_TICKS_PER_SECOND / 1000000;
+
+    if (0x00 == got) {
+        mb->stats.timeouts++;
+        return MODBUS_ERR_TIMEOUT;
+    }
+    if ((got < expect) || (rsp[0] != adu[0]) || ((rsp[1] & 0x7F) != adu[1])
+        || (drv_modbus_crc16(rsp, expect - 2) != (rsp[expect - 2] | (rsp[expect - 1] << 8)))) {
+        mb->stats.frame_errors++;
+        return MODBUS_ERR_FRAME;
+    }
+
+    /* reads answer with their byte count, writes repeat address and value or count */
+    if (!(rsp[1] & 0x80)
+        && (((MODBUS_FC_READ_HOLDING == adu[1]) || (MODBUS_FC_READ_INPUT == adu[1])) ? (rsp[2] != expect - 5)
+                                                                                      : (0x00 != memcmp(rsp, adu, 6)))) {
+        mb->stats.frame_errors++;
+        return MODBUS_ERR_FRAME;
+    }
+
+    rtt = utils_cpu_ticks_to_ns(now - start);
+    if (mb->stats.rtt_ns_max < rtt) {
+        mb->stats.rtt_ns_max = rtt;
+    }
+    mb->rtt_sum += rtt;
+    mb->rtt_samples++;
+
+    if (rsp[1] & 0x80) {
+        mb->exception = rsp[2];
+        mb->stats.exceptions++;
+        return MODBUS_ERR_EXCEPTION;
+    }
+    mb->stats.ok++;
+
+    return 0;
+}
+
+int drv_modbus_update_timing(drv_modbus_t* mb)
+{
+    struct uart_configure cfg;
+
+    if ((NULL == mb) || ((void*)&modbus_type != mb->base)) {
+        return -1;
+    }
+
+    if (0x00 != drv_uart_get_config(mb->uart, &cfg)) {
+        printf("[hal_modbus]: get uart config failed\n");
+        return -1;
+    }
+    if (0x00 == cfg.baud_rate) {
+        printf("[hal_modbus]: uart has no baud rate\n");
+        return -1;
+    }
+
+    mb->baud_rate = cfg.baud_rate;
+    mb->char_ns   = (uint32_t)(MODBUS_CHAR_BITS * 1000000000ULL / cfg.baud_rate);
+    drv_modbus_frame_timing(cfg.baud_rate, &mb->t15_us, &mb->t35_us);
+
+    return 0;
+}
+
+int drv_modbus_create(drv_uart_inst_t* uart, int timeout_ms, drv_modbus_t** mb)
+{
+    HAL_TRACE_FUNC();
+
+    if ((NULL == uart) || (NULL == mb) || (0 >= timeout_ms)) {
+        return -1;
+    }
+
+    if (*mb) {
+        drv_modbus_destroy(mb);
+        *mb = NULL;
+    }
+
+    *mb = hal_slab_zalloc(&modbus_cache);
+    if (NULL == *mb) {
+        printf("[hal_modbus]: alloc instance failed\n");
+        return -3;
+    }
+    (*mb)->base       = (void*)&modbus_type;
+    (*mb)->uart       = uart;
+    (*mb)->timeout_ms = timeout_ms;
+
+    if (0x00 != drv_modbus_update_timing(*mb)) {
+        hal_slab_free(&modbus_cache, *mb);
+        *mb = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void drv_modbus_destroy(drv_modbus_t** mb)
+{
+    HAL_TRACE_FUNC();
+
+    if ((NULL == mb) || (NULL == *mb)) {
+        return;
+    }
+
+    if ((void*)&modbus_type != (*mb)->base) {
+        printf("[hal_modbus]: inst not modbus master\n");
+        return;
+    }
+
+    (*mb)->base = NULL;
+    hal_slab_free(&modbus_cache, *mb);
+    *mb = NULL;
+}
+
+static size_t modbus_encode_read(uint8_t* adu, uint8_t slave, uint8_t func, uint16_t addr, uint16_t count)
+{
+    adu[0] = slave;
+    adu[1] = func;
+    adu[2] = addr >> 8;
+    adu[3] = addr & 0xFF;
+    adu[4] = count >> 8;
+    adu[5] = count & 0xFF;
+
+    return modbus_put_crc(adu, 6);
+}
+
+static int modbus_read_valid(drv_modbus_t* mb, uint8_t slave, uint8_t func, uint16_t addr, uint16_t count)
+{
+    return mb && ((void*)&modbus_type == mb->base) && (0x00 != slave) && (0xF7 >= slave)
+           && ((MODBUS_FC_READ_HOLDING == func) || (MODBUS_FC_READ_INPUT == func)) && (0x00 != count)
+           && (MODBUS_MAX_READ_REGS >= count) && (0x10000 >= (uint32_t)addr + count);
+}
+
+int drv_modbus_read_registers(drv_modbus_t* mb, uint8_t slave, uint8_t func, uint16_t addr, uint16_t count,
+                              uint16_t* regs)
+{
+    HAL_TRACE_FUNC();
+
+    uint8_t adu[8], rsp[MODBUS_ADU_MAX];
+    int     ret;
+
+    if (!modbus_read_valid(mb, slave, func, addr, count) || (NULL == regs)) {
+        return MODBUS_ERR_PARAM;
+    }
+
+    modbus_encode_read(adu, slave, func, addr, count);
+    if (0x00 != (ret = modbus_transact(mb, adu, sizeof(adu), rsp, 5 + 2 * count))) {
+        return ret;
+    }
+    for (int i = 0; i < count; i++) {
+        regs[i] = (rsp[3 + 2 * i] << 8) | rsp[4 + 2 * i];
+    }
+
+    return 0;
+}
+
+int drv_modbus_write_register(drv_modbus_t* mb, uint8_t slave, uint16_t addr, uint16_t value)
+{
+    HAL_TRACE_FUNC();
+
+    uint8_t adu[8], rsp[8];
+
+    if ((NULL == mb) || ((void*)&modbus_type != mb->base) || (0xF7 < slave)) {
+        return MODBUS_ERR_PARAM;
+    }
+
+    adu[0] = slave;
+    adu[1] = MODBUS_FC_WRITE_SINGLE;
+    adu[2] = addr >> 8;
+    adu[3] = addr & 0xFF;
+    adu[4] = value >> 8;
+    adu[5] = value & 0xFF;
+    modbus_put_crc(adu, 6);
+
+    return modbus_transact(mb, adu, sizeof(adu), rsp, sizeof(rsp));
+}
+
+int drv_modbus_write_registers(drv_modbus_t* mb, uint8_t slave, uint16_t addr, uint16_t count, const uint16_t* values)
+{
+    HAL_TRACE_FUNC();
+
+    uint8_t adu[MODBUS_ADU_MAX], rsp[8];
+    size_t  len;
+
+    if ((NULL == mb) || ((void*)&modbus_type != mb->base) || (0xF7 < slave) || (NULL == values) || (0x00 == count)
+        || (MODBUS_MAX_WRITE_REGS < count) || (0x10000 < (uint32_t)addr + count)) {
+        return MODBUS_ERR_PARAM;
+    }
+
+    adu[0] = slave;
+    adu[1] = MODBUS_FC_WRITE_MULTI;
+    adu[2] = addr >> 8;
+    adu[3] = addr & 0xFF;
+    adu[4] = count >> 8;
+    adu[5] = count & 0xFF;
+    adu[6] = 2 * count;
+    for (int i = 0; i < count; i++) {
+        adu[7 + 2 * i] = values[i] >> 8;
+        adu[8 + 2 * i] = values[i] & 0xFF;
+    }
+    len = modbus_put_crc(adu, 7 + 2 * count);
+
+    return modbus_transact(mb, adu, len, rsp, sizeof(rsp));
+}
+
+/* qsort has no context argument, order by a copy of the keys instead */
+static int modbus_poll_cmp(const void* a, const void* b)
+{
+    const uint64_t* ka = a;
+    const uint64_t* kb = b;
+
+    return (*ka > *kb) - (*ka < *kb);
+}
+
+int drv_modbus_poll_create(drv_modbus_t* mb, modbus_poll_item_t* items, int count, uint16_t max_gap,
+                           drv_modbus_poll_t** poll)
+{
+    HAL_TRACE_FUNC();
+
+    drv_modbus_poll_t*      p;
+    struct modbus_poll_req* req = NULL;
+    uint64_t*               keys;
+    uint32_t                end;
+
+    if ((NULL == mb) || ((void*)&modbus_type != mb->base) || (NULL == items) || (0 >= count) || (NULL == poll)) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!modbus_read_valid(mb, items[i].slave, items[i].func, items[i].addr, items[i].count)
+            || (NULL == items[i].regs)) {
+            printf("[hal_modbus]: invalid poll item %d\n", i);
+            return -1;
+        }
+    }
+
+    if (*poll) {
+        drv_modbus_poll_destroy(poll);
+        *poll = NULL;
+    }
+
+    p = hal_slab_zalloc(&modbus_poll_cache);
+    if (NULL == p) {
+        printf("[hal_modbus]: alloc poll plan failed\n");
+        return -3;
+    }
+    keys     = hal_slab_buf_alloc(count * sizeof(*keys));
+    p->order = hal_slab_buf_alloc(count * sizeof(int));
+    p->reqs  = hal_slab_buf_alloc(count * sizeof(struct modbus_poll_req));
+    if ((NULL == keys) || (NULL == p->order) || (NULL == p->reqs)) {
+        printf("[hal_modbus]: alloc %d poll items failed\n", count);
+        hal_slab_buf_free(keys);
+        hal_slab_buf_free(p->order);
+        hal_slab_buf_free(p->reqs);
+        hal_slab_free(&modbus_poll_cache, p);
+        return -3;
+    }
+    p->base      = (void*)&modbus_poll_type;
+    p->mb        = mb;
+    p->items     = items;
+    p->num_items = count;
+
+    /* slave, function, address and item index packed into one sortable key */
+    for (int i = 0; i < count; i++) {
+        keys[i] = ((uint64_t)items[i].slave << 56) | ((uint64_t)items[i].func << 48) | ((uint64_t)items[i].addr << 32)
+                  | (uint32_t)i;
+    }
+    qsort(keys, count, sizeof(*keys), modbus_poll_cmp);
+
+    for (int i = 0; i < count; i++) {
+        modbus_poll_item_t* item = &items[(uint32_t)keys[i]];
+
+        p->order[i] = (uint32_t)keys[i];
+
+        if (req && (req->slave == item->slave) && (req->func == item->func)
+            && ((uint32_t)req->addr + req->count + max_gap >= item->addr)) {
+            end = (uint32_t)item->addr + item->count;
+            if (end < (uint32_t)req->addr + req->count) {
+                end = (uint32_t)req->addr + req->count;
+            }
+            if (MODBUS_MAX_READ_REGS >= end - req->addr) {
+                req->count = end - req->addr;
+                req->num++;
+                continue;
+            }
+        }
+
+        req        = &p->reqs[p->num_reqs++];
+        req->slave = item->slave;
+        req->func  = item->func;
+        req->addr  = item->addr;
+        req->count = item->count;
+        req->first = i;
+        req->num   = 1;
+    }
+    hal_slab_buf_free(keys);
+
+    for (int i = 0; i < p->num_reqs; i++) {
+        req = &p->reqs[i];
+        modbus_encode_read(req->adu, req->slave, req->func, req->addr, req->count);
+    }
+
+    *poll = p;
+
+    return 0;
+}
+
+void drv_modbus_poll_destroy(drv_modbus_poll_t** poll)
+{
+    HAL_TRACE_FUNC();
+
+    if ((NULL == poll) || (NULL == *poll)) {
+        return;
+    }
+
+    if ((void*)&modbus_poll_type != (*poll)->base) {
+        printf("[hal_modbus]: inst not modbus poll plan\n");
+        return;
+    }
+
+    (*poll)->base = NULL;
+    hal_slab_buf_free((*poll)->order);
+    hal_slab_buf_free((*poll)->reqs);
+    hal_slab_free(&modbus_poll_cache, *poll);
+    *poll = NULL;
+}
+
+int drv_modbus_poll_requests(drv_modbus_poll_t* poll)
+{
+    if ((NULL == poll) || ((void*)&modbus_poll_type != poll->base)) {
+        return -1;
+    }
+
+    return poll->num_reqs;
+}
+
+int drv_modbus_poll_round(drv_modbus_poll_t* poll)
+{
+    HAL_TRACE_FUNC();
+
+    uint32_t      dead[256 / 32] = { 0 };
+    uint8_t       rsp[MODBUS_ADU_MAX];
+    drv_modbus_t* mb;
+    int           failed = 0, ret;
+
+    if ((NULL == poll) || ((void*)&modbus_poll_type != poll->base)) {
+        return -1;
+    }
+    mb = poll->mb;
+
+    for (int r = 0; r < poll->num_reqs; r++) {
+        struct modbus_poll_req* req = &poll->reqs[r];
+
+        if (dead[req->slave / 32] & (1U << (req->slave % 32))) {
+            ret = MODBUS_ERR_SKIPPED;
+            mb->stats.skipped++;
+        } else {
+            ret = modbus_transact(mb, req->adu, sizeof(req->adu), rsp, 5 + 2 * req->count);
+            if (MODBUS_ERR_TIMEOUT == ret) {
+                dead[req->slave / 32] |= 1U << (req->slave % 32);
+            }
+        }
+
+        for (int i = req->first; i < req->first + req->num; i++) {
+            modbus_poll_item_t* item = &poll->items[poll->order[i]];
+            const uint8_t*      src  = rsp + 3 + 2 * (item->addr - req->addr);
+
+            item->status = ret;
+            if (0x00 != ret) {
+                failed++;
+                continue;
+            }
+            for (int j = 0; j < item->count; j++) {
+                item->regs[j] = (src[2 * j] << 8) | src[2 * j + 1];
+            }
+        }
+    }
+
+    return failed;
+}
+
+int drv_modbus_get_stats(drv_modbus_t* mb, modbus_stats_t* stats)
+{
+    if ((NULL == mb) || ((void*)&modbus_type != mb->base) || (NULL == stats)) {
+        return -1;
+    }
+
+    /* broadcasts count as ok but have no round trip */
+    *stats             = mb->stats;
+    stats->rtt_ns_mean = mb->rtt_samples ? (mb->rtt_sum / mb->rtt_samples) : 0;
+
+    return 0;
+}
+
+void drv_modbus_reset_stats(drv_modbus_t* mb)
+{
+    if ((NULL == mb) || ((void*)&modbus_type != mb->base)) {
+        return;
+    }
+
+    memset(&mb->stats, 0, sizeof(mb->stats));
+    mb->rtt_sum     = 0;
+    mb->rtt_samples = 0;
+}
@@ -0,0 +1,150 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "drv_uart.h"
+
+#define MODBUS_ADU_MAX        (256)
+#define MODBUS_MAX_READ_REGS  (125)
+#define MODBUS_MAX_WRITE_REGS (123)
+
+#define MODBUS_FC_READ_HOLDING (0x03)
+#define MODBUS_FC_READ_INPUT   (0x04)
+#define MODBUS_FC_WRITE_SINGLE (0x06)
+#define MODBUS_FC_WRITE_MULTI  (0x10)
+
+/* error codes of the transactions, also left in modbus_poll_item_t.status */
+#define MODBUS_ERR_PARAM     (-1)
+#define MODBUS_ERR_TIMEOUT   (-2) // no answer within the response timeout
+#define MODBUS_ERR_FRAME     (-3) // bad CRC, address, function or length, or a silence over t1.5 inside the frame
+#define MODBUS_ERR_EXCEPTION (-4) // the slave answered with an exception, see drv_modbus_t.exception
+#define MODBUS_ERR_SKIPPED   (-5) // poll round: the slave already timed out in this round
+
+typedef struct _modbus_stats {
+    uint64_t transactions; // requests sent
+    uint64_t ok;
+    uint64_t timeouts;
+    uint64_t frame_errors;
+    uint64_t exceptions;
+    uint64_t skipped; // poll requests not sent because their slave timed out earlier in the round
+    uint64_t rtt_ns_max; // first request byte written to last response byte read
+    uint64_t rtt_ns_mean;
+} modbus_stats_t;
+
+typedef struct _drv_modbus {
+    void* base;
+
+    drv_uart_inst_t* uart;
+
+    uint32_t baud_rate;
+    uint32_t char_ns; // one 11 bit character on the line
+    uint32_t t15_us, t35_us; // inter character and inter frame silence
+    int      timeout_ms; // response timeout
+
+    uint64_t idle_ticks; // the bus is quiet for t3.5 from here on
+    uint8_t  exception; // code of the last exception response
+
+    modbus_stats_t stats;
+    uint64_t       rtt_sum, rtt_samples; // answered transactions, broadcasts have no round trip
+} drv_modbus_t;
+
+typedef struct _modbus_poll_item {
+    uint8_t   slave;
+    uint8_t   func; // MODBUS_FC_READ_HOLDING or MODBUS_FC_READ_INPUT
+    uint16_t  addr;
+    uint16_t  count;
+    uint16_t* regs; // count registers, refreshed by every round
+    int       status; // last round, 0 or MODBUS_ERR_*
+} modbus_poll_item_t;
+
+typedef struct _drv_modbus_poll drv_modbus_poll_t;
+
+/**
+ * @brief Character time based silences of Modbus RTU: 1.5 and 3.5 characters
+ *        of 11 bits, fixed at 750us and 1750us above 19200 baud.
+ */
+void drv_modbus_frame_timing(uint32_t baud_rate, uint32_t* t15_us, uint32_t* t35_us);
+
+/** @brief Modbus CRC16 (poly 0xA001, init 0xFFFF), sent low byte first. */
+uint16_t drv_modbus_crc16(const uint8_t* data, size_t len);
+
+/**
+ * @brief Modbus RTU master on @uart, the frame timing follows the baud rate
+ *        the uart is configured with, call drv_modbus_update_timing() after
+ *        changing it. The master does not own @uart.
+ * @param timeout_ms how long to wait for the first byte of a response
+ * @return 0 on success, -1 on invalid parameters, -3 on allocation failure.
+ */
+int  drv_modbus_create(drv_uart_inst_t* uart, int timeout_ms, drv_modbus_t** mb);
+void drv_modbus_destroy(drv_modbus_t** mb);
+
+int drv_modbus_update_timing(drv_modbus_t* mb);
+
+/**
+ * @brief One transaction each, waiting only the t3.5 bus silence before the
+ *        request and until the expected response length arrived after it.
+ *        Slave 0 broadcasts a write and does not wait for an answer.
+ * @return 0 on success or MODBUS_ERR_*.
+ */
+int drv_modbus_read_registers(drv_modbus_t* mb, uint8_t slave, uint8_t func, uint16_t addr, uint16_t count,
+                              uint16_t* regs);
+int drv_modbus_write_register(drv_modbus_t* mb, uint8_t slave, uint16_t addr, uint16_t value);
+int drv_modbus_write_registers(drv_modbus_t* mb, uint8_t slave, uint16_t addr, uint16_t count, const uint16_t* values);
+
+/**
+ * @brief Plan a polling round over @items, which must stay valid until the
+ *        plan is destroyed. Reads of the same slave and function whose ranges
+ *        touch, overlap or lie at most @max_gap registers apart are merged
+ *        into one request of up to MODBUS_MAX_READ_REGS registers, and every
+ *        request is encoded once here.
+ */
+int  drv_modbus_poll_create(drv_modbus_t* mb, modbus_poll_item_t* items, int count, uint16_t max_gap,
+                            drv_modbus_poll_t** poll);
+void drv_modbus_poll_destroy(drv_modbus_poll_t** poll);
+
+/** @brief Requests one round sends. */
+int drv_modbus_poll_requests(drv_modbus_poll_t* poll);
+
+/**
+ * @brief Send every request of the plan back to back and scatter the answers
+ *        into the items. A slave that timed out is skipped for the rest of the
+ *        round instead of costing a timeout per request.
+ * @return Number of items that failed, -1 on invalid parameters.
+ */
+int drv_modbus_poll_round(drv_modbus_poll_t* poll);
+
+int  drv_modbus_get_stats(drv_modbus_t* mb, modbus_stats_t* stats);
+void drv_modbus_reset_stats(drv_modbus_t* mb);
+
+#ifdef __cplusplus
+}
+#endif
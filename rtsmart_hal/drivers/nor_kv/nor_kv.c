@@ -0,0 +1,1329 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "list.h"
+#include "nor_kv.h"
+#include "w25qxx.h"
+
+#define SECTOR_MAGIC 0x31564B4E /* "NKV1" */
+#define CKPT_MAGIC 0x43564B4E /* "NKVC" */
+
+#define COMMIT_DONE 0x00
+#define REC_PUT 0x50
+#define REC_DEL 0x44
+
+#define NO_SECTOR UINT32_MAX
+
+enum { SECTOR_FREE = 0, SECTOR_DIRTY, SECTOR_USED };
+
+/*
+ * first bytes of every log sector. erase_count is programmed right after the
+ * erase, the rest when the sector joins the log.
+ */
+struct kv_sector_hdr {
+    uint32_t erase_count;
+    uint32_t magic;
+    uint32_t seq; /* log order */
+    uint32_t crc; /* of magic and seq */
+};
+
+/* a record, followed by the key and the value, padded to 4 bytes */
+struct kv_rec_hdr {
+    uint8_t commit; /* programmed to COMMIT_DONE once the rest is on the chip */
+    uint8_t type;
+    uint8_t key_len;
+    uint8_t pad;
+    uint16_t val_len;
+    uint16_t pad2;
+    uint32_t crc; /* type to pad2, key and value */
+};
+
+struct kv_ckpt_hdr {
+    uint8_t commit;
+    uint8_t pad[3];
+    uint32_t magic;
+    uint32_t seq; /* the newer of the two slots wins */
+    uint32_t count;
+    uint32_t head_sector; /* log position the checkpoint covers */
+    uint32_t head_seq;
+    uint32_t head_off;
+    uint32_t crc; /* magic to head_off and the entries */
+};
+
+struct kv_ckpt_entry {
+    uint32_t hash;
+    uint32_t addr;
+    uint32_t size;
+};
+
+#define REC_HDR_SIZE ((uint32_t)sizeof(struct kv_rec_hdr))
+#define SECTOR_HDR_SIZE ((uint32_t)sizeof(struct kv_sector_hdr))
+#define REC_SIZE(klen, vlen) ((REC_HDR_SIZE + (klen) + (vlen) + 3) & ~3U)
+#define REC_MAX REC_SIZE(NOR_KV_KEY_MAX, NOR_KV_VALUE_MAX)
+
+struct kv_entry {
+    struct hlist_node node;
+    uint32_t hash;
+    uint32_t addr; /* record in the region */
+    uint32_t size;
+};
+
+struct nor_kv {
+    void *base;
+    struct nor_kv_flash fl;
+    struct nor_kv_config cfg;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_t thread;
+    int running;
+
+    uint32_t num_sectors;
+    uint32_t first_log; /* sectors before it hold the two checkpoint slots */
+    uint32_t usable; /* record bytes per sector */
+    uint8_t *state;
+    uint32_t *seq;
+    uint32_t *erases;
+    uint32_t *live; /* bytes of indexed records */
+    uint32_t free_count;
+    uint32_t next_seq;
+    uint32_t head; /* sector appended to */
+    uint32_t head_off;
+
+    struct hlist_head *buckets;
+    uint32_t bucket_bits;
+    uint32_t keys;
+    uint32_t live_bytes;
+
+    int ckpt_slot; /* slot of the newest valid checkpoint, -1: none */
+    uint32_t ckpt_seq;
+    uint32_t ckpt_head;
+    uint32_t since_ckpt; /* records appended after the checkpoint */
+
+    uint8_t *sbuf; /* one sector, mount scans and GC */
+    uint32_t sbuf_sector;
+    uint8_t *rbuf; /* one record */
+
+    nor_kv_stats_t stats;
+};
+
+static const int nor_kv_type;
+static HAL_SLAB_CACHE_DEFINE(nor_kv_cache, "nor_kv", struct nor_kv);
+static HAL_SLAB_CACHE_DEFINE(kv_entry_cache, "nor_kv_entry", struct kv_entry);
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+        }
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t kv_crc(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    crc = ~crc;
+    while (len--) {
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+/* FNV-1a */
+static uint32_t kv_hash(const char *key, size_t len)
+{
+    uint32_t h = 2166136261U;
+
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)key[i]) * 16777619U;
+    }
+
+    return h;
+}
+
+static uint64_t kv_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int fl_read(nor_kv_t *kv, uint32_t addr, void *buf, size_t len)
+{
+    return kv->fl.read(kv->fl.ctx, kv->fl.offset + addr, buf, len) ? -2 : 0;
+}
+
+static int fl_prog(nor_kv_t *kv, uint32_t addr, const void *buf, size_t len)
+{
+    return kv->fl.prog(kv->fl.ctx, kv->fl.offset + addr, buf, len) ? -2 : 0;
+}
+
+static int fl_sync(nor_kv_t *kv) { return (kv->fl.sync && kv->fl.sync(kv->fl.ctx)) ? -2 : 0; }
+
+static int fl_erase(nor_kv_t *kv, uint32_t sector, uint32_t count)
+{
+    if (kv->sbuf_sector >= sector && kv->sbuf_sector < sector + count) {
+        kv->sbuf_sector = NO_SECTOR;
+    }
+
+    return kv->fl.erase(kv->fl.ctx, kv->fl.offset + sector * kv->fl.sector_size, count * kv->fl.sector_size) ? -2 : 0;
+}
+
+static uint32_t rec_crc(const struct kv_rec_hdr *hdr, const void *key, const void *val)
+{
+    uint32_t crc = kv_crc(0, &hdr->type, offsetof(struct kv_rec_hdr, crc) - offsetof(struct kv_rec_hdr, type));
+
+    crc = kv_crc(crc, key, hdr->key_len);
+
+    return kv_crc(crc, val, hdr->val_len);
+}
+
+static uint32_t sector_crc(const struct kv_sector_hdr *hdr)
+{
+    return kv_crc(0, &hdr->magic, offsetof(struct kv_sector_hdr, crc) - offsetof(struct kv_sector_hdr, magic));
+}
+
+/*
+ * the header and key of the record at @addr, from the scan buffer when it holds the sector.
+ * -1 when @addr is not in a log sector or holds no key, an index entry can outlive its record.
+ */
+static int rec_read_key(nor_kv_t *kv, uint32_t addr, struct kv_rec_hdr *hdr, char *key)
+{
+    uint32_t sector = addr / kv->fl.sector_size;
+    uint32_t off = addr % kv->fl.sector_size;
+    uint8_t buf[REC_HDR_SIZE + NOR_KV_KEY_MAX];
+    const uint8_t *p = buf;
+
+    if (sector < kv->first_log || sector >= kv->num_sectors || kv->state[sector] != SECTOR_USED ||
+        off < SECTOR_HDR_SIZE || off + REC_HDR_SIZE > kv->fl.sector_size) {
+        return -1;
+    }
+
+    if (sector == kv->sbuf_sector) {
+        p = kv->sbuf + off;
+    } else if (fl_read(kv, addr, buf,
+                       (off + sizeof(buf) > kv->fl.sector_size) ? kv->fl.sector_size - off : sizeof(buf))) {
+        return -2;
+    }
+    memcpy(hdr, p, REC_HDR_SIZE);
+    if (!hdr->key_len || hdr->key_len > NOR_KV_KEY_MAX || off + REC_HDR_SIZE + hdr->key_len > kv->fl.sector_size) {
+        return -1;
+    }
+    memcpy(key, p + REC_HDR_SIZE, hdr->key_len);
+
+    return 0;
+}
+
+static struct kv_entry *entry_find(nor_kv_t *kv, const char *key, size_t klen, uint32_t hash, struct kv_rec_hdr *hdr)
+{
+    struct kv_entry *e;
+    struct kv_rec_hdr h;
+    char stored[NOR_KV_KEY_MAX];
+
+    hlist_for_each_entry(e, &kv->buckets[hash_32(hash, kv->bucket_bits)], node) {
+        if (e->hash != hash || rec_read_key(kv, e->addr, &h, stored)) {
+            continue;
+        }
+        if (h.key_len == klen && !memcmp(stored, key, klen)) {
+            if (hdr) {
+                *hdr = h;
+            }
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+static struct kv_entry *entry_by_addr(nor_kv_t *kv, uint32_t hash, uint32_t addr)
+{
+    struct kv_entry *e;
+
+    hlist_for_each_entry(e, &kv->buckets[hash_32(hash, kv->bucket_bits)], node) {
+        if (e->addr == addr) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+static struct kv_entry *entry_add(nor_kv_t *kv, uint32_t hash)
+{
+    struct kv_entry *e = hal_slab_zalloc(&kv_entry_cache);
+
+    if (e) {
+        e->hash = hash;
+        hlist_add_head(&e->node, &kv->buckets[hash_32(hash, kv->bucket_bits)]);
+        kv->keys++;
+    }
+
+    return e;
+}
+
+static void entry_del(nor_kv_t *kv, struct kv_entry *e)
+{
+    hlist_del(&e->node);
+    hal_slab_free(&kv_entry_cache, e);
+    kv->keys--;
+}
+
+/* point @e at a new record, moving its live bytes along */
+static void entry_move(nor_kv_t *kv, struct kv_entry *e, uint32_t addr, uint32_t size, int known)
+{
+    if (known) {
+        kv->live[e->addr / kv->fl.sector_size] -= e->size;
+        kv->live_bytes -= e->size;
+    }
+    e->addr = addr;
+    e->size = size;
+    kv->live[addr / kv->fl.sector_size] += size;
+    kv->live_bytes += size;
+}
+
+/* all erased but the erase count */
+static int sector_blank(nor_kv_t *kv, uint32_t sector)
+{
+    uint32_t words[64];
+    uint32_t addr = sector * kv->fl.sector_size;
+
+    for (uint32_t off = 0; off < kv->fl.sector_size; off += sizeof(words)) {
+        if (fl_read(kv, addr + off, words, sizeof(words))) {
+            return -2;
+        }
+        for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+            if (words[i] != UINT32_MAX && (off || i)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* erase @sector and note its erase count on it */
+static int sector_erase(nor_kv_t *kv, uint32_t sector)
+{
+    uint32_t count = ++kv->erases[sector];
+
+    if (kv->state[sector] == SECTOR_USED) {
+        kv->free_count++;
+    }
+    kv->state[sector] = SECTOR_DIRTY;
+    kv->seq[sector] = 0;
+    kv->live[sector] = 0;
+
+    if (fl_erase(kv, sector, 1) || fl_prog(kv, sector * kv->fl.sector_size, &count, sizeof(count))) {
+        return -2;
+    }
+    kv->state[sector] = SECTOR_FREE;
+
+    return 0;
+}
+
+/* the next free sector after the head becomes the head */
+static int sector_open(nor_kv_t *kv)
+{
+    uint32_t n_log = kv->num_sectors - kv->first_log;
+    uint32_t start = (kv->head == NO_SECTOR) ? 0 : kv->head - kv->first_log + 1;
+    uint32_t sector = NO_SECTOR;
+    struct kv_sector_hdr hdr;
+    int ret;
+
+    for (uint32_t i = 0; i < n_log; i++) {
+        uint32_t s = kv->first_log + (start + i) % n_log;
+
+        if (kv->state[s] != SECTOR_USED) {
+            sector = s;
+            break;
+        }
+    }
+    if (sector == NO_SECTOR) {
+        return -4;
+    }
+
+    /* an erase cut short can leave an erased header over old data */
+    if (kv->state[sector] == SECTOR_DIRTY || (ret = sector_blank(kv, sector)) == 0) {
+        if (kv->state[sector] == SECTOR_FREE) {
+            kv->state[sector] = SECTOR_DIRTY;
+        }
+        if ((ret = sector_erase(kv, sector))) {
+            return ret;
+        }
+    } else if (ret < 0) {
+        return ret;
+    }
+
+    hdr.erase_count = kv->erases[sector];
+    hdr.magic = SECTOR_MAGIC;
+    hdr.seq = kv->next_seq++;
+    hdr.crc = sector_crc(&hdr);
+    if (fl_prog(kv, sector * kv->fl.sector_size + offsetof(struct kv_sector_hdr, magic), &hdr.magic,
+                SECTOR_HDR_SIZE - offsetof(struct kv_sector_hdr, magic))) {
+        kv->state[sector] = SECTOR_DIRTY;
+        return -2;
+    }
+
+    kv->state[sector] = SECTOR_USED;
+    kv->seq[sector] = hdr.seq;
+    kv->free_count--;
+    kv->head = sector;
+    kv->head_off = SECTOR_HDR_SIZE;
+
+    return 0;
+}
+
+/* append the @size bytes of a record, commit byte still erased, and commit it */
+static int log_append(nor_kv_t *kv, const uint8_t *rec, uint32_t size, uint32_t *addr)
+{
+    static const uint8_t commit = COMMIT_DONE;
+    int ret;
+
+    if (kv->head == NO_SECTOR || kv->head_off + size > kv->fl.sector_size) {
+        if ((ret = sector_open(kv))) {
+            return ret;
+        }
+    }
+
+    *addr = kv->head * kv->fl.sector_size + kv->head_off;
+    if (fl_prog(kv, *addr, rec, size) || fl_prog(kv, *addr, &commit, 1)) {
+        /* what is on the chip now is unknown, leave the rest of the sector alone */
+        kv->head_off = kv->fl.sector_size;
+        return -2;
+    }
+    if (kv->sbuf_sector == kv->head) {
+        memcpy(kv->sbuf + kv->head_off, rec, size);
+        kv->sbuf[kv->head_off] = COMMIT_DONE;
+    }
+    kv->head_off += size;
+    kv->since_ckpt++;
+    kv->stats.log_bytes += size;
+
+    return 0;
+}
+
+/* bytes a full compaction would give back, sector tails included */
+static uint32_t log_dead_bytes(nor_kv_t *kv)
+{
+    uint32_t used = 0;
+
+    for (uint32_t s = kv->first_log; s < kv->num_sectors; s++) {
+        if (kv->state[s] == SECTOR_USED) {
+            used += (s == kv->head) ? kv->head_off - SECTOR_HDR_SIZE : kv->usable;
+        }
+    }
+
+    return used - kv->live_bytes;
+}
+
+static int ckpt_write(nor_kv_t *kv)
+{
+    uint32_t slot = (kv->ckpt_slot == 0) ? 1 : 0;
+    uint32_t addr = slot * kv->cfg.ckpt_sectors * kv->fl.sector_size;
+    size_t len = sizeof(struct kv_ckpt_hdr) + (size_t)kv->keys * sizeof(struct kv_ckpt_entry);
+    struct kv_ckpt_hdr *hdr;
+    struct kv_ckpt_entry *ent;
+    struct kv_entry *e;
+    static const uint8_t commit = COMMIT_DONE;
+    int ret = -2;
+
+    hdr = hal_slab_buf_alloc(len);
+    if (!hdr) {
+        return -3;
+    }
+    memset(hdr, 0xFF, sizeof(*hdr));
+    hdr->magic = CKPT_MAGIC;
+    hdr->seq = kv->ckpt_seq + 1;
+    hdr->count = kv->keys;
+    hdr->head_sector = kv->head;
+    hdr->head_seq = (kv->head == NO_SECTOR) ? 0 : kv->seq[kv->head];
+    hdr->head_off = kv->head_off;
+
+    ent = (struct kv_ckpt_entry *)(hdr + 1);
+    for (uint32_t b = 0; b < (1U << kv->bucket_bits); b++) {
+        hlist_for_each_entry(e, &kv->buckets[b], node) {
+            ent->hash = e->hash;
+            ent->addr = e->addr;
+            ent->size = e->size;
+            ent++;
+        }
+    }
+    hdr->crc = kv_crc(0, &hdr->magic, offsetof(struct kv_ckpt_hdr, crc) - offsetof(struct kv_ckpt_hdr, magic));
+    hdr->crc = kv_crc(hdr->crc, hdr + 1, len - sizeof(*hdr));
+
+    /* the other slot stays valid until the commit byte of this one is on the chip */
+    if (!fl_erase(kv, slot * kv->cfg.ckpt_sectors, kv->cfg.ckpt_sectors) && !fl_prog(kv, addr, hdr, len) &&
+        !fl_sync(kv) && !fl_prog(kv, addr, &commit, 1) && !fl_sync(kv)) {
+        kv->ckpt_slot = slot;
+        kv->ckpt_seq = hdr->seq;
+        kv->ckpt_head = kv->head;
+        kv->since_ckpt = 0;
+        kv->stats.checkpoints++;
+        ret = 0;
+    } else if (kv->ckpt_slot == (int)slot) {
+        kv->ckpt_slot = -1;
+    }
+    hal_slab_buf_free(hdr);
+
+    return ret;
+}
+
+static int ckpt_wanted(nor_kv_t *kv)
+{
+    return kv->cfg.ckpt_sectors && kv->cfg.ckpt_every && kv->since_ckpt >= kv->cfg.ckpt_every;
+}
+
+/* clear the magic of both slots so no checkpoint is trusted until the next one is written */
+static int ckpt_invalidate(nor_kv_t *kv)
+{
+    static const uint32_t magic = 0;
+
+    for (uint32_t slot = 0; slot < 2; slot++) {
+        if (fl_prog(kv, slot * kv->cfg.ckpt_sectors * kv->fl.sector_size + offsetof(struct kv_ckpt_hdr, magic),
+                    &magic, sizeof(magic))) {
+            return -2;
+        }
+    }
+    kv->ckpt_slot = -1;
+
+    return fl_sync(kv);
+}
+
+static int sector_load(nor_kv_t *kv, uint32_t sector)
+{
+    if (kv->sbuf_sector != sector) {
+        kv->sbuf_sector = NO_SECTOR;
+        if (fl_read(kv, sector * kv->fl.sector_size, kv->sbuf, kv->fl.sector_size)) {
+            return -2;
+        }
+        kv->sbuf_sector = sector;
+    }
+
+    return 0;
+}
+
+/*
+ * the committed record at @off of the loaded sector, 0 at the end of the
+ * records, -1 for a record torn by a power cut
+ */
+static int sector_rec(nor_kv_t *kv, uint32_t off, struct kv_rec_hdr *hdr)
+{
+    const uint8_t *p = kv->sbuf + off;
+
+    if (off + REC_HDR_SIZE > kv->fl.sector_size) {
+        return 0;
+    }
+    memcpy(hdr, p, REC_HDR_SIZE);
+    if (hdr->commit == 0xFF && hdr->type == 0xFF && hdr->key_len == 0xFF && hdr->crc == UINT32_MAX) {
+        return 0;
+    }
+    if (hdr->commit != COMMIT_DONE || (hdr->type != REC_PUT && hdr->type != REC_DEL) || !hdr->key_len ||
+        hdr->key_len > NOR_KV_KEY_MAX || hdr->val_len > NOR_KV_VALUE_MAX ||
+        off + REC_SIZE(hdr->key_len, hdr->val_len) > kv->fl.sector_size ||
+        hdr->crc != rec_crc(hdr, p + REC_HDR_SIZE, p + REC_HDR_SIZE + hdr->key_len)) {
+        return -1;
+    }
+
+    return 1;
+}
+
+/* compact the oldest sector, 1 when there is none besides the head */
+static int gc_step(nor_kv_t *kv)
+{
+    uint32_t victim = NO_SECTOR;
+    struct kv_rec_hdr hdr;
+    uint32_t off, addr;
+    int ret;
+
+    for (uint32_t s = kv->first_log; s < kv->num_sectors; s++) {
+        if (kv->state[s] == SECTOR_USED && s != kv->head && (victim == NO_SECTOR || kv->seq[s] < kv->seq[victim])) {
+            victim = s;
+        }
+    }
+    if (victim == NO_SECTOR) {
+        return 1;
+    }
+
+    if (kv->live[victim]) {
+        if ((ret = sector_load(kv, victim))) {
+            return ret;
+        }
+        for (off = SECTOR_HDR_SIZE; sector_rec(kv, off, &hdr) > 0; off += REC_SIZE(hdr.key_len, hdr.val_len)) {
+            uint32_t size = REC_SIZE(hdr.key_len, hdr.val_len);
+            const uint8_t *rec = kv->sbuf + off;
+            struct kv_entry *e;
+
+            /* delete records go, nothing older than this sector is left */
+            if (hdr.type != REC_PUT ||
+                !(e = entry_by_addr(kv, kv_hash((const char *)rec + REC_HDR_SIZE, hdr.key_len),
+                                    victim * kv->fl.sector_size + off))) {
+                continue;
+            }
+
+            /* copied with the commit byte erased, committed like a new record */
+            memcpy(kv->rbuf, rec, size);
+            kv->rbuf[0] = 0xFF;
+            if ((ret = log_append(kv, kv->rbuf, size, &addr))) {
+                return ret;
+            }
+            entry_move(kv, e, addr, size, 1);
+            kv->stats.gc_copied_bytes += size;
+        }
+    }
+
+    /*
+     * the checkpoint lists records in every sector up to its head, after this
+     * erase it could point at erased or reused space. Write a newer one when
+     * one is due anyway, else stop trusting it, mount scans the log meanwhile.
+     */
+    if (kv->cfg.ckpt_sectors && kv->ckpt_slot >= 0 && kv->ckpt_head != NO_SECTOR &&
+        kv->seq[victim] <= kv->seq[kv->ckpt_head] &&
+        (ret = ckpt_wanted(kv) ? ckpt_write(kv) : ckpt_invalidate(kv))) {
+        return ret;
+    }
+
+    if ((ret = sector_erase(kv, victim))) {
+        return ret;
+    }
+    kv->stats.gc_runs++;
+
+    return 0;
+}
+
+/*
+ * make room for @size more bytes in the log. One free sector is always kept
+ * back, GC copies into it.
+ */
+static int log_reserve(nor_kv_t *kv, uint32_t size)
+{
+    uint32_t n_log = kv->num_sectors - kv->first_log;
+    int ret;
+
+    for (uint32_t i = 0; kv->free_count <= 1 && (kv->head == NO_SECTOR || kv->head_off + size > kv->fl.sector_size);
+         i++) {
+        if (i > n_log || log_dead_bytes(kv) < size) {
+            return -4;
+        }
+        if ((ret = gc_step(kv))) {
+            return (ret > 0) ? -4 : ret;
+        }
+    }
+
+    return 0;
+}
+
+static int gc_wanted(nor_kv_t *kv)
+{
+    return kv->free_count < kv->cfg.gc_free_sectors && log_dead_bytes(kv) >= kv->usable;
+}
+
+static void *gc_thread(void *arg)
+{
+    nor_kv_t *kv = arg;
+
+    pthread_mutex_lock(&kv->lock);
+    while (kv->running) {
+        if (ckpt_wanted(kv)) {
+            ckpt_write(kv);
+        } else if (!gc_wanted(kv) || gc_step(kv)) {
+            pthread_cond_wait(&kv->work, &kv->lock);
+            continue;
+        }
+
+        /* one sector per lock hold, puts get in between */
+        pthread_mutex_unlock(&kv->lock);
+        sched_yield();
+        pthread_mutex_lock(&kv->lock);
+    }
+    pthread_mutex_unlock(&kv->lock);
+
+    return NULL;
+}
+
+static void kv_kick(nor_kv_t *kv)
+{
+    if (kv->running && (gc_wanted(kv) || ckpt_wanted(kv))) {
+        pthread_cond_signal(&kv->work);
+    }
+}
+
+/* apply one record found at mount */
+static int replay_rec(nor_kv_t *kv, uint32_t addr, const struct kv_rec_hdr *hdr, const uint8_t *rec)
+{
+    const char *key = (const char *)rec + REC_HDR_SIZE;
+    uint32_t hash = kv_hash(key, hdr->key_len);
+    struct kv_entry *e = entry_find(kv, key, hdr->key_len, hash, NULL);
+
+    kv->stats.mount_records++;
+    if (hdr->type == REC_DEL) {
+        if (e) {
+            entry_del(kv, e);
+        }
+        return 0;
+    }
+
+    if (!e) {
+        if (kv->keys >= kv->cfg.max_keys) {
+            return -4;
+        }
+        if (!(e = entry_add(kv, hash))) {
+            return -3;
+        }
+    }
+    e->addr = addr;
+    e->size = REC_SIZE(hdr->key_len, hdr->val_len);
+
+    return 0;
+}
+
+/* replay @sector from @off, the end of its records becomes the head position */
+static int replay_sector(nor_kv_t *kv, uint32_t sector, uint32_t off)
+{
+    struct kv_rec_hdr hdr;
+    int ret;
+
+    if ((ret = sector_load(kv, sector))) {
+        return ret;
+    }
+
+    while ((ret = sector_rec(kv, off, &hdr)) > 0) {
+        if ((ret = replay_rec(kv, sector * kv->fl.sector_size + off, &hdr, kv->sbuf + off))) {
+            return ret;
+        }
+        off += REC_SIZE(hdr.key_len, hdr.val_len);
+    }
+
+    kv->head = sector;
+    kv->head_off = off;
+
+    /* after a torn record, or bytes a cut program left, nothing more goes into this sector */
+    for (uint32_t i = off; ret == 0 && i < kv->fl.sector_size; i++) {
+        ret = (kv->sbuf[i] == 0xFF) ? 0 : -1;
+    }
+    if (ret < 0) {
+        kv->head_off = kv->fl.sector_size;
+    }
+
+    return 0;
+}
+
+/*
+ * index the newest usable checkpoint and the rest of the sector it ends in.
+ * @from_seq is set to the first sector sequence still to replay.
+ */
+static int ckpt_load(nor_kv_t *kv, uint32_t *from_seq)
+{
+    struct kv_ckpt_hdr hdr[2];
+    struct kv_ckpt_entry *ent;
+    uint32_t slot_bytes = kv->cfg.ckpt_sectors * kv->fl.sector_size;
+    int order[2], valid[2];
+
+    *from_seq = 0;
+    for (int i = 0; i < 2; i++) {
+        if (fl_read(kv, i * slot_bytes, &hdr[i], sizeof(hdr[i]))) {
+            return -2;
+        }
+        valid[i] = hdr[i].commit == COMMIT_DONE && hdr[i].magic == CKPT_MAGIC && hdr[i].count <= kv->cfg.max_keys;
+        if (valid[i] && hdr[i].seq > kv->ckpt_seq) {
+            kv->ckpt_seq = hdr[i].seq;
+        }
+    }
+    order[0] = (valid[1] && (!valid[0] || hdr[1].seq > hdr[0].seq)) ? 1 : 0;
+    order[1] = !order[0];
+
+    for (int i = 0; i < 2; i++) {
+        struct kv_ckpt_hdr *h = &hdr[order[i]];
+        size_t len = (size_t)h->count * sizeof(*ent);
+        uint32_t crc;
+
+        if (!valid[order[i]]) {
+            continue;
+        }
+
+        /* its head sector erased since means records it lists may be gone */
+        if (h->head_sector != NO_SECTOR &&
+            (h->head_sector < kv->first_log || h->head_sector >= kv->num_sectors ||
+             kv->state[h->head_sector] != SECTOR_USED || kv->seq[h->head_sector] != h->head_seq ||
+             h->head_off < SECTOR_HDR_SIZE || h->head_off > kv->fl.sector_size)) {
+            continue;
+        }
+
+        ent = hal_slab_buf_alloc(len ? len : 1);
+        if (!ent) {
+            return -3;
+        }
+        if (fl_read(kv, order[i] * slot_bytes + sizeof(*h), ent, len)) {
+            hal_slab_buf_free(ent);
+            return -2;
+        }
+        crc = kv_crc(0, &h->magic, offsetof(struct kv_ckpt_hdr, crc) - offsetof(struct kv_ckpt_hdr, magic));
+        if (kv_crc(crc, ent, len) != h->crc) {
+            hal_slab_buf_free(ent);
+            continue;
+        }
+
+        for (uint32_t k = 0; k < h->count; k++) {
+            struct kv_entry *e = entry_add(kv, ent[k].hash);
+
+            if (!e) {
+                hal_slab_buf_free(ent);
+                return -3;
+            }
+            e->addr = ent[k].addr;
+            e->size = ent[k].size;
+        }
+        hal_slab_buf_free(ent);
+
+        kv->ckpt_slot = order[i];
+        kv->ckpt_head = h->head_sector;
+        kv->stats.mount_from_ckpt = true;
+        if (h->head_sector == NO_SECTOR) {
+            return 0;
+        }
+
+        /* the rest of the sector the checkpoint ends in, newer sectors follow */
+        *from_seq = h->head_seq + 1;
+        return replay_sector(kv, h->head_sector, h->head_off);
+    }
+
+    return 0;
+}
+
+static int u64_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int kv_scan(nor_kv_t *kv)
+{
+    struct kv_sector_hdr hdr;
+    struct kv_entry *e;
+    struct hlist_node *tmp;
+    uint64_t *order;
+    uint32_t from_seq, n = 0;
+    int ret;
+
+    for (uint32_t s = kv->first_log; s < kv->num_sectors; s++) {
+        if (fl_read(kv, s * kv->fl.sector_size, &hdr, sizeof(hdr))) {
+            return -2;
+        }
+        kv->erases[s] = (hdr.erase_count == UINT32_MAX) ? 0 : hdr.erase_count;
+        if (hdr.magic == SECTOR_MAGIC && hdr.crc == sector_crc(&hdr)) {
+            kv->state[s] = SECTOR_USED;
+            kv->seq[s] = hdr.seq;
+            kv->next_seq = (hdr.seq >= kv->next_seq) ? hdr.seq + 1 : kv->next_seq;
+            n++;
+        } else {
+            /* anything but an erased header is left over from something else */
+            kv->state[s] = (hdr.magic == UINT32_MAX && hdr.seq == UINT32_MAX && hdr.crc == UINT32_MAX) ? SECTOR_FREE
+                                                                                                      : SECTOR_DIRTY;
+            kv->free_count++;
+        }
+    }
+
+    from_seq = 0;
+    if (kv->cfg.ckpt_sectors && (ret = ckpt_load(kv, &from_seq))) {
+        return ret;
+    }
+
+    /* the log in sequence order */
+    order = hal_slab_buf_alloc((n ? n : 1) * sizeof(*order));
+    if (!order) {
+        return -3;
+    }
+    n = 0;
+    for (uint32_t s = kv->first_log; s < kv->num_sectors; s++) {
+        if (kv->state[s] == SECTOR_USED && kv->seq[s] >= from_seq) {
+            order[n++] = ((uint64_t)kv->seq[s] << 32) | s;
+        }
+    }
+    qsort(order, n, sizeof(*order), u64_cmp);
+    for (uint32_t i = 0; i < n; i++) {
+        if ((ret = replay_sector(kv, (uint32_t)order[i], SECTOR_HDR_SIZE))) {
+            hal_slab_buf_free(order);
+            return ret;
+        }
+    }
+    hal_slab_buf_free(order);
+
+    for (uint32_t b = 0; b < (1U << kv->bucket_bits); b++) {
+        hlist_for_each_entry_safe(e, tmp, &kv->buckets[b], node) {
+            uint32_t s = e->addr / kv->fl.sector_size;
+
+            if (s < kv->first_log || s >= kv->num_sectors || kv->state[s] != SECTOR_USED) {
+                entry_del(kv, e);
+                continue;
+            }
+            kv->live[s] += e->size;
+            kv->live_bytes += e->size;
+        }
+    }
+
+    return 0;
+}
+
+static void kv_free(nor_kv_t *kv)
+{
+    struct kv_entry *e;
+    struct hlist_node *tmp;
+
+    if (kv->buckets) {
+        for (uint32_t b = 0; b < (1U << kv->bucket_bits); b++) {
+            hlist_for_each_entry_safe(e, tmp, &kv->buckets[b], node) {
+                entry_del(kv, e);
+            }
+        }
+    }
+    hal_slab_buf_free(kv->buckets);
+    hal_slab_buf_free(kv->state);
+    hal_slab_buf_free(kv->seq);
+    hal_slab_buf_free(kv->erases);
+    hal_slab_buf_free(kv->live);
+    hal_slab_buf_free(kv->sbuf);
+    hal_slab_buf_free(kv->rbuf);
+    pthread_cond_destroy(&kv->work);
+    pthread_mutex_destroy(&kv->lock);
+    kv->base = NULL;
+    hal_slab_free(&nor_kv_cache, kv);
+}
+
+static int fl_w25qxx_read(void *ctx, uint32_t addr, void *buf, size_t len) { return w25qxx_read(ctx, addr, buf, len); }
+
+static int fl_w25qxx_prog(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+    return w25qxx_write(ctx, addr, buf, len);
+}
+
+static int fl_w25qxx_erase(void *ctx, uint32_t addr, size_t len) { return w25qxx_erase(ctx, addr, len); }
+
+static int fl_w25qxx_sync(void *ctx) { return w25qxx_sync(ctx); }
+
+int nor_kv_flash_w25qxx(struct nor_kv_flash *fl, w25qxx_t *flash, uint32_t offset, uint32_t size)
+{
+    w25qxx_info_t info;
+
+    if (!fl || w25qxx_get_info(flash, &info) || !size || (offset | size) % info.sector_size ||
+        offset > info.size || size > info.size - offset) {
+        printf("[nor_kv]: invalid w25qxx region\n");
+        return -1;
+    }
+
+    fl->ctx = flash;
+    fl->offset = offset;
+    fl->size = size;
+    fl->sector_size = info.sector_size;
+    fl->read = fl_w25qxx_read;
+    fl->prog = fl_w25qxx_prog;
+    fl->erase = fl_w25qxx_erase;
+    fl->sync = fl_w25qxx_sync;
+
+    return 0;
+}
+
+int nor_kv_format(const struct nor_kv_flash *fl)
+{
+    HAL_TRACE_FUNC();
+
+    if (!fl || !fl->erase || !fl->sector_size || !fl->size || fl->size % fl->sector_size) {
+        return -1;
+    }
+
+    if (fl->erase(fl->ctx, fl->offset, fl->size) || (fl->sync && fl->sync(fl->ctx))) {
+        return -2;
+    }
+
+    return 0;
+}
+
+int nor_kv_mount(const struct nor_kv_flash *fl, const struct nor_kv_config *cfg, nor_kv_t **kv)
+{
+    HAL_TRACE_FUNC();
+
+    nor_kv_t *k;
+    uint32_t sectors;
+    uint64_t start = kv_now_ns();
+    int ret;
+
+    if (!fl || !cfg || !kv || !fl->read || !fl->prog || !fl->erase || !fl->sector_size || fl->sector_size % 4 ||
+        fl->size % fl->sector_size || fl->sector_size < SECTOR_HDR_SIZE + REC_MAX || !cfg->max_keys) {
+        printf("[nor_kv]: invalid parameters\n");
+        return -1;
+    }
+    sectors = fl->size / fl->sector_size;
+    if (sectors < 2 * cfg->ckpt_sectors + 3) {
+        printf("[nor_kv]: %u sectors, need 3 for the log besides %u for checkpoints\n", sectors,
+               2 * cfg->ckpt_sectors);
+        return -1;
+    }
+    if (cfg->ckpt_sectors &&
+        (uint64_t)cfg->max_keys * sizeof(struct kv_ckpt_entry) + sizeof(struct kv_ckpt_hdr) >
+            (uint64_t)cfg->ckpt_sectors * fl->sector_size) {
+        printf("[nor_kv]: %u keys do not fit %u checkpoint sectors\n", cfg->max_keys, cfg->ckpt_sectors);
+        return -1;
+    }
+
+    pthread_once(&crc_once, crc_init);
+
+    k = hal_slab_zalloc(&nor_kv_cache);
+    if (!k) {
+        printf("[nor_kv]: alloc store fail\n");
+        return -3;
+    }
+    k->base = (void *)&nor_kv_type;
+    k->fl = *fl;
+    k->cfg = *cfg;
+    k->num_sectors = sectors;
+    k->first_log = 2 * cfg->ckpt_sectors;
+    k->usable = fl->sector_size - SECTOR_HDR_SIZE;
+    k->head = NO_SECTOR;
+    k->next_seq = 1;
+    k->ckpt_slot = -1;
+    k->ckpt_head = NO_SECTOR;
+    k->sbuf_sector = NO_SECTOR;
+    pthread_mutex_init(&k->lock, NULL);
+    pthread_cond_init(&k->work, NULL);
+
+    while ((1U << k->bucket_bits) < cfg->max_keys) {
+        k->bucket_bits++;
+    }
+    k->bucket_bits = k->bucket_bits ? k->bucket_bits : 1;
+
+    k->buckets = hal_slab_buf_alloc(sizeof(struct hlist_head) << k->bucket_bits);
+    k->state = hal_slab_buf_alloc(sectors);
+    k->seq = hal_slab_buf_alloc(sectors * sizeof(uint32_t));
+    k->erases = hal_slab_buf_alloc(sectors * sizeof(uint32_t));
+    k->live = hal_slab_buf_alloc(sectors * sizeof(uint32_t));
+    k->sbuf = hal_slab_buf_alloc(fl->sector_size);
+    k->rbuf = hal_slab_buf_alloc(REC_MAX);
+    if (!k->buckets || !k->state || !k->seq || !k->erases || !k->live || !k->sbuf || !k->rbuf) {
+        printf("[nor_kv]: alloc index fail\n");
+        kv_free(k);
+        return -3;
+    }
+    for (uint32_t b = 0; b < (1U << k->bucket_bits); b++) {
+        INIT_HLIST_HEAD(&k->buckets[b]);
+    }
+    memset(k->state, 0, sectors);
+    memset(k->seq, 0, sectors * sizeof(uint32_t));
+    memset(k->erases, 0, sectors * sizeof(uint32_t));
+    memset(k->live, 0, sectors * sizeof(uint32_t));
+
+    if ((ret = kv_scan(k))) {
+        printf("[nor_kv]: mount fail %d\n", ret);
+        kv_free(k);
+        return ret;
+    }
+
+    if (cfg->gc_free_sectors) {
+        k->running = 1;
+        if (pthread_create(&k->thread, NULL, gc_thread, k)) {
+            printf("[nor_kv]: create gc thread fail\n");
+            k->running = 0;
+            kv_free(k);
+            return -3;
+        }
+        pthread_mutex_lock(&k->lock);
+        kv_kick(k);
+        pthread_mutex_unlock(&k->lock);
+    }
+
+    k->stats.mount_us = (kv_now_ns() - start) / 1000;
+    *kv = k;
+
+    return 0;
+}
+
+void nor_kv_unmount(nor_kv_t **kv)
+{
+    HAL_TRACE_FUNC();
+
+    nor_kv_t *k;
+
+    if (!kv || !*kv || (void *)&nor_kv_type != (*kv)->base) {
+        return;
+    }
+    k = *kv;
+
+    if (k->running) {
+        pthread_mutex_lock(&k->lock);
+        k->running = 0;
+        pthread_cond_signal(&k->work);
+        pthread_mutex_unlock(&k->lock);
+        pthread_join(k->thread, NULL);
+    }
+
+    if (k->cfg.ckpt_sectors && (k->since_ckpt || k->ckpt_slot < 0)) {
+        ckpt_write(k);
+    }
+    fl_sync(k);
+
+    kv_free(k);
+    *kv = NULL;
+}
+
+static int kv_check(nor_kv_t *kv, const char *key, size_t *klen)
+{
+    if (!kv || (void *)&nor_kv_type != kv->base || !key) {
+        return -1;
+    }
+    *klen = strnlen(key, NOR_KV_KEY_MAX + 1);
+    if (!*klen || *klen > NOR_KV_KEY_MAX) {
+        printf("[nor_kv]: key length must be 1~%d\n", NOR_KV_KEY_MAX);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* build the record in rbuf, commit byte erased */
+static uint32_t rec_build(nor_kv_t *kv, uint8_t type, const char *key, size_t klen, const void *val, size_t vlen)
+{
+    struct kv_rec_hdr *hdr = (struct kv_rec_hdr *)kv->rbuf;
+    uint32_t size = REC_SIZE(klen, vlen);
+
+    memset(kv->rbuf, 0xFF, size);
+    hdr->type = type;
+    hdr->key_len = klen;
+    hdr->val_len = vlen;
+    hdr->crc = rec_crc(hdr, key, val);
+    memcpy(kv->rbuf + REC_HDR_SIZE, key, klen);
+    if (vlen) {
+        memcpy(kv->rbuf + REC_HDR_SIZE + klen, val, vlen);
+    }
+
+    return size;
+}
+
+static int kv_commit_done(nor_kv_t *kv)
+{
+    int ret = kv->cfg.sync_commits ? fl_sync(kv) : 0;
+
+    kv_kick(kv);
+
+    return ret;
+}
+
+int nor_kv_put(nor_kv_t *kv, const char *key, const void *value, size_t len)
+{
+    HAL_TRACE_FUNC();
+
+    struct kv_entry *e;
+    size_t klen;
+    uint32_t hash, size, addr;
+    int ret;
+
+    if ((ret = kv_check(kv, key, &klen)) || (len && !value) || len > NOR_KV_VALUE_MAX) {
+        return ret ? ret : -1;
+    }
+    hash = kv_hash(key, klen);
+    size = REC_SIZE(klen, len);
+
+    pthread_mutex_lock(&kv->lock);
+    e = entry_find(kv, key, klen, hash, NULL);
+    if (!e && kv->keys >= kv->cfg.max_keys) {
+        ret = -4;
+        goto out;
+    }
+    if ((ret = log_reserve(kv, size))) {
+        goto out;
+    }
+
+    /* GC in log_reserve may have moved @e, the entry itself stays */
+    if (!e && !(e = entry_add(kv, hash))) {
+        ret = -3;
+        goto out;
+    }
+    rec_build(kv, REC_PUT, key, klen, value, len);
+    if ((ret = log_append(kv, kv->rbuf, size, &addr))) {
+        if (!e->size) {
+            entry_del(kv, e);
+        }
+        goto out;
+    }
+    entry_move(kv, e, addr, size, e->size != 0);
+    kv->stats.puts++;
+    kv->stats.user_bytes += klen + len;
+    ret = kv_commit_done(kv);
+
+out:
+    pthread_mutex_unlock(&kv->lock);
+
+    return ret;
+}
+
+int nor_kv_get(nor_kv_t *kv, const char *key, void *buf, size_t size)
+{
+    HAL_TRACE_FUNC();
+
+    struct kv_entry *e;
+    struct kv_rec_hdr hdr;
+    size_t klen;
+    int ret;
+
+    if ((ret = kv_check(kv, key, &klen)) || (size && !buf)) {
+        return ret ? ret : -1;
+    }
+
+    pthread_mutex_lock(&kv->lock);
+    kv->stats.gets++;
+    if (!(e = entry_find(kv, key, klen, kv_hash(key, klen), &hdr))) {
+        ret = -5;
+    } else if (size && fl_read(kv, e->addr + REC_HDR_SIZE + klen, buf, (size < hdr.val_len) ? size : hdr.val_len)) {
+        ret = -2;
+    } else {
+        ret = hdr.val_len;
+    }
+    pthread_mutex_unlock(&kv->lock);
+
+    return ret;
+}
+
+int nor_kv_delete(nor_kv_t *kv, const char *key)
+{
+    HAL_TRACE_FUNC();
+
+    struct kv_entry *e;
+    size_t klen;
+    uint32_t size, addr;
+    int ret;
+
+    if ((ret = kv_check(kv, key, &klen))) {
+        return ret;
+    }
+    size = REC_SIZE(klen, 0);
+
+    pthread_mutex_lock(&kv->lock);
+    if (!(e = entry_find(kv, key, klen, kv_hash(key, klen), NULL))) {
+        ret = -5;
+        goto out;
+    }
+    rec_build(kv, REC_DEL, key, klen, NULL, 0);
+    if ((ret = log_reserve(kv, size)) || (ret = log_append(kv, kv->rbuf, size, &addr))) {
+        goto out;
+    }
+    kv->live[e->addr / kv->fl.sector_size] -= e->size;
+    kv->live_bytes -= e->size;
+    entry_del(kv, e);
+    kv->stats.deletes++;
+    ret = kv_commit_done(kv);
+
+out:
+    pthread_mutex_unlock(&kv->lock);
+
+    return ret;
+}
+
+int nor_kv_checkpoint(nor_kv_t *kv)
+{
+    HAL_TRACE_FUNC();
+
+    int ret;
+
+    if (!kv || (void *)&nor_kv_type != kv->base || !kv->cfg.ckpt_sectors) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&kv->lock);
+    ret = ckpt_write(kv);
+    pthread_mutex_unlock(&kv->lock);
+
+    return ret;
+}
+
+int nor_kv_gc(nor_kv_t *kv)
+{
+    HAL_TRACE_FUNC();
+
+    int ret;
+
+    if (!kv || (void *)&nor_kv_type != kv->base) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&kv->lock);
+    ret = gc_step(kv);
+    pthread_mutex_unlock(&kv->lock);
+
+    return ret;
+}
+
+int nor_kv_sync(nor_kv_t *kv)
+{
+    int ret;
+
+    if (!kv || (void *)&nor_kv_type != kv->base) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&kv->lock);
+    ret = fl_sync(kv);
+    pthread_mutex_unlock(&kv->lock);
+
+    return ret;
+}
+
+int nor_kv_get_stats(nor_kv_t *kv, nor_kv_stats_t *stats)
+{
+    if (!kv || (void *)&nor_kv_type != kv->base || !stats) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&kv->lock);
+    *stats = kv->stats;
+    stats->keys = kv->keys;
+    stats->live_bytes = kv->live_bytes;
+    stats->log_sectors = kv->num_sectors - kv->first_log;
+    stats->free_sectors = kv->free_count;
+    stats->erase_min = UINT32_MAX;
+    stats->erase_max = 0;
+    for (uint32_t s = kv->first_log; s < kv->num_sectors; s++) {
+        stats->erase_min = (kv->erases[s] < stats->erase_min) ? kv->erases[s] : stats->erase_min;
+        stats->erase_max = (kv->erases[s] > stats->erase_max) ? kv->erases[s] : stats->erase_max;
+    }
+    pthread_mutex_unlock(&kv->lock);
+
+    return 0;
+}
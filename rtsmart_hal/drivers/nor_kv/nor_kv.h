@@ -0,0 +1,179 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "w25qxx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Log structured key-value store for SPI NOR flash.
+ *
+ * Records are appended to a circular log of sectors. A put or delete programs
+ * the record with its commit byte left erased, then programs the commit byte,
+ * so a record torn by a power cut is ignored at the next mount. The index is a
+ * hash table in RAM from key hash to record address, rebuilt at mount from the
+ * newest checkpoint plus the records written after it, or from the whole log
+ * when no checkpoint is usable. Two checkpoint slots take turns so one is
+ * always intact.
+ *
+ * Garbage collection always compacts the oldest sector: its live records are
+ * copied to the head and it is erased. Every sector is erased in turn, which
+ * levels wear, and a delete record can be dropped once its sector is the
+ * oldest since no older value of the key is left behind it. Erasing a sector
+ * the checkpoint covers first writes a new checkpoint when one is due, else
+ * invalidates both slots until the next one.
+ */
+
+#define NOR_KV_KEY_MAX (63) /* key length, without the NUL */
+#define NOR_KV_VALUE_MAX (2048)
+
+/**
+ * @brief Block interface below the store. The callbacks get chip addresses,
+ *        @offset plus the address in the region. prog follows NOR rules
+ *        (bits only go from 1 to 0), erase takes whole sectors.
+ */
+struct nor_kv_flash {
+    void *ctx;
+    uint32_t offset; /* region start on the chip */
+    uint32_t size; /* region bytes, a multiple of sector_size */
+    uint32_t sector_size;
+    int (*read)(void *ctx, uint32_t addr, void *buf, size_t len);
+    int (*prog)(void *ctx, uint32_t addr, const void *buf, size_t len);
+    int (*erase)(void *ctx, uint32_t addr, size_t len);
+    int (*sync)(void *ctx); /* wait for programs and erases, may be NULL */
+};
+
+struct nor_kv_config {
+    uint32_t max_keys; /* index and checkpoint capacity */
+    uint32_t ckpt_sectors; /* per checkpoint slot, 0: no checkpoints. Part of the layout, keep it per region */
+    uint32_t ckpt_every; /* records between automatic checkpoints, 0: only explicit and at unmount */
+    uint32_t gc_free_sectors; /* the GC thread keeps this many sectors erased, 0: no thread */
+    bool sync_commits; /* a put returns after the chip finished the commit */
+};
+
+typedef struct nor_kv nor_kv_t;
+
+typedef struct {
+    uint32_t keys;
+    uint32_t live_bytes; /* records the index points at */
+    uint32_t log_sectors;
+    uint32_t free_sectors;
+    uint64_t puts;
+    uint64_t deletes;
+    uint64_t gets;
+    uint64_t user_bytes; /* key and value bytes of puts */
+    uint64_t log_bytes; /* record bytes programmed, GC copies included */
+    uint64_t gc_runs; /* sectors compacted */
+    uint64_t gc_copied_bytes;
+    uint64_t checkpoints;
+    uint32_t erase_min; /* erase counts over the log sectors */
+    uint32_t erase_max;
+    uint32_t mount_us;
+    uint32_t mount_records; /* records replayed at mount */
+    bool mount_from_ckpt;
+} nor_kv_stats_t;
+
+/**
+ * @brief Fill @fl with a region of @flash starting at @offset, both @offset
+ *        and @size sector aligned.
+ *
+ * @return 0 on success, -1 on invalid parameters
+ */
+int nor_kv_flash_w25qxx(struct nor_kv_flash *fl, w25qxx_t *flash, uint32_t offset, uint32_t size);
+
+/**
+ * @brief Erase the whole region, the next mount starts empty.
+ */
+int nor_kv_format(const struct nor_kv_flash *fl);
+
+/**
+ * @brief Mount the store in the region of @fl. Sectors that do not hold a
+ *        valid log sector are erased when the log reaches them, so a region
+ *        with foreign data mounts empty. @fl is copied.
+ *
+ * @return 0 on success, negative on error:
+ *         -1: Invalid parameters, or the region is smaller than 3 log sectors
+ *             next to the checkpoint slots
+ *         -2: Flash access failed
+ *         -3: Memory allocation failed
+ *         -4: The log holds more keys than @cfg->max_keys
+ */
+int nor_kv_mount(const struct nor_kv_flash *fl, const struct nor_kv_config *cfg, nor_kv_t **kv);
+
+/**
+ * @brief Stop the GC thread, write a checkpoint when records were added
+ *        since the last one and free the store.
+ */
+void nor_kv_unmount(nor_kv_t **kv);
+
+/**
+ * @brief Store @len bytes of @value under @key, replacing an older value.
+ *
+ * @return 0 on success, negative on error, -4 when the log or index is full
+ */
+int nor_kv_put(nor_kv_t *kv, const char *key, const void *value, size_t len);
+
+/**
+ * @brief Copy at most @size bytes of the value of @key into @buf.
+ *
+ * @return length of the stored value, -5 when the key is not found
+ */
+int nor_kv_get(nor_kv_t *kv, const char *key, void *buf, size_t size);
+
+/**
+ * @return 0 on success, -5 when the key is not found
+ */
+int nor_kv_delete(nor_kv_t *kv, const char *key);
+
+/**
+ * @brief Write the index to the older checkpoint slot.
+ */
+int nor_kv_checkpoint(nor_kv_t *kv);
+
+/**
+ * @brief Compact the oldest sector now.
+ *
+ * @return 0 on success, 1 when nothing is left to compact, negative on error
+ */
+int nor_kv_gc(nor_kv_t *kv);
+
+/**
+ * @brief Wait until every record written so far is on the chip.
+ */
+int nor_kv_sync(nor_kv_t *kv);
+
+int nor_kv_get_stats(nor_kv_t *kv, nor_kv_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
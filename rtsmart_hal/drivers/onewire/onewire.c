@@ -35,6 +35,7 @@
 #include <unistd.h>
 
 #include "onewire.h"
+#include "hal_io.h"
 
 #define ONEWIRE_IOCTL_RESET      _IOWR('o', 0x00, struct onewire_rdwr_t*)
 #define ONEWIRE_IOCTL_WRITE_BYTE _IOWR('o', 0x01, struct onewire_rdwr_t*)
@@ -69,14 +70,14 @@ static int onewire_ioctl(int cmd, void* data)
     static int onewire_dev_fd = -1;
 
     if (onewire_dev_fd < 0) {
-        onewire_dev_fd = open("/dev/onewire", O_RDWR);
+        onewire_dev_fd = hal_io_open("/dev/onewire", O_RDWR);
         if (onewire_dev_fd < 0) {
             printf("[hal_onewire] Failed to open device: %d\n", errno);
             return -1; // Failed to open device
         }
     }
 
-    int ret = ioctl(onewire_dev_fd, cmd, data);
+    int ret = hal_io_ioctl(onewire_dev_fd, cmd, data);
 
     if (0x00 != ret) {
         printf("[hal_onewire]: ioctl failed with cmd 0x%08X\n", cmd);
@@ -35,6 +35,8 @@
 
 #include "canmv_misc.h"
 #include "drv_pwm.h"
+#include "hal_io.h"
+#include "hal_trace.h"
 
 #define DRV_PWM_DEV "/dev/pwm"
 
@@ -64,13 +66,13 @@ static int _drv_pwm_ref_cnt = 0;
 static int pwm_ioctl(int cmd, void* arg)
 {
     if (0 > _drv_pwm_fd) {
-        if (0 > (_drv_pwm_fd = open(DRV_PWM_DEV, O_RDWR))) {
+        if (0 > (_drv_pwm_fd = hal_io_open(DRV_PWM_DEV, O_RDWR))) {
             printf("[hal_pwm]: open device failed\n");
             return -1;
         }
     }
 
-    int ret = ioctl(_drv_pwm_fd, cmd, arg);
+    int ret = hal_io_ioctl(_drv_pwm_fd, cmd, arg);
     if (ret < 0) {
         printf("[hal_pwm]: ioctl failed\n");
     }
@@ -101,6 +103,8 @@ static int drv_pwm_get_cfg(int channel, uint32_t* period, uint32_t* pulse)
 
 int drv_pwm_set_freq(int channel, uint32_t freq)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     struct rt_pwm_configuration cfg;
@@ -131,6 +135,8 @@ int drv_pwm_set_freq(int channel, uint32_t freq)
 
 int drv_pwm_get_freq(int channel, uint32_t* freq)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     uint32_t period;
@@ -147,6 +153,8 @@ int drv_pwm_get_freq(int channel, uint32_t* freq)
 
 int drv_pwm_set_duty(int channel, uint32_t duty)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     struct rt_pwm_configuration cfg;
@@ -175,6 +183,8 @@ int drv_pwm_set_duty(int channel, uint32_t duty)
 
 int drv_pwm_get_duty(int channel, uint32_t* duty)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     uint32_t period, pulse;
@@ -198,6 +208,8 @@ int drv_pwm_get_duty(int channel, uint32_t* duty)
 
 int drv_pwm_set_duty_u16(int channel, uint16_t duty_u16)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     struct rt_pwm_configuration cfg;
@@ -221,6 +233,8 @@ int drv_pwm_set_duty_u16(int channel, uint16_t duty_u16)
 
 int drv_pwm_get_duty_u16(int channel, uint16_t* duty_u16)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     uint32_t period, pulse;
@@ -251,6 +265,8 @@ int drv_pwm_get_duty_u16(int channel, uint16_t* duty_u16)
  */
 int drv_pwm_set_duty_ns(int channel, uint32_t pulse_ns)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     struct rt_pwm_configuration cfg;
@@ -287,6 +303,8 @@ int drv_pwm_set_duty_ns(int channel, uint32_t pulse_ns)
  */
 int drv_pwm_get_duty_ns(int channel, uint32_t* pulse_ns)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     uint32_t period, pulse;
@@ -303,6 +321,8 @@ int drv_pwm_get_duty_ns(int channel, uint32_t* pulse_ns)
 
 int drv_pwm_enable(int channel)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     struct rt_pwm_configuration cfg = { .channel = channel };
@@ -318,6 +338,8 @@ int drv_pwm_enable(int channel)
 
 int drv_pwm_disable(int channel)
 {
+    HAL_TRACE_FUNC();
+
     PWM_CHECK_CHANNEL(channel);
 
     struct rt_pwm_configuration cfg = { .channel = channel };
@@ -329,7 +351,7 @@ int drv_pwm_disable(int channel)
 
     _drv_pwm_ref_cnt--;
     if (_drv_pwm_ref_cnt <= 0) {
-        close(_drv_pwm_fd);
+        hal_io_close(_drv_pwm_fd);
         _drv_pwm_fd      = -1;
         _drv_pwm_ref_cnt = 0;
     }
@@ -338,9 +360,11 @@ int drv_pwm_disable(int channel)
 
 int drv_pwm_init(void)
 {
+    HAL_TRACE_FUNC();
+
     // Open device on first init
     if (_drv_pwm_fd < 0) {
-        _drv_pwm_fd = open(DRV_PWM_DEV, O_RDWR);
+        _drv_pwm_fd = hal_io_open(DRV_PWM_DEV, O_RDWR);
         if (_drv_pwm_fd < 0) {
             printf("[hal_pwm]: init failed - could not open device\n");
             return -1;
@@ -351,8 +375,10 @@ int drv_pwm_init(void)
 
 int drv_pwm_deinit(void)
 {
+    HAL_TRACE_FUNC();
+
     if (_drv_pwm_fd >= 0) {
-        close(_drv_pwm_fd);
+        hal_io_close(_drv_pwm_fd);
         _drv_pwm_fd      = -1;
         _drv_pwm_ref_cnt = 0;
     }
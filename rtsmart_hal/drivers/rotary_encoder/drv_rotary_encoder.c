@@ -32,6 +32,8 @@
 #include <unistd.h>
 
 #include "drv_rotary_encoder.h"
+#include "hal_io.h"
+#include "hal_slab.h"
 
 /* IOCTL commands */
 #define ENCODER_CMD_GET_DATA  _IOR('E', 1, struct encoder_data*)
@@ -48,6 +50,7 @@ struct encoder_dev_inst_t {
 };
 
 static uint32_t encoder_dev_type;
+static HAL_SLAB_CACHE_DEFINE(encoder_inst_cache, "drv_encoder", struct encoder_dev_inst_t);
 
 #define CHECK_ENCODER_INST(inst)                                                                                               \
     do {                                                                                                                       \
@@ -91,16 +94,16 @@ int rotary_encoder_inst_create(struct encoder_dev_inst_t** inst, int index, stru
 
     snprintf(dev_name, sizeof(dev_name), "/dev/encoder%d", index);
 
-    if (0 > (dev_fd = open(dev_name, O_RDWR | O_NONBLOCK))) {
+    if (0 > (dev_fd = hal_io_open(dev_name, O_RDWR | O_NONBLOCK))) {
         printf("[hal_encoder]: open %s failed\n", dev_name);
         return -1;
     }
 
     /* Allocate and initialize instance */
-    *inst = (struct encoder_dev_inst_t*)malloc(sizeof(struct encoder_dev_inst_t));
+    *inst = hal_slab_alloc(&encoder_inst_cache);
     if (*inst == NULL) {
-        printf("[hal_encoder]: malloc instance failed");
-        close(dev_fd);
+        printf("[hal_encoder]: alloc instance failed");
+        hal_io_close(dev_fd);
         return -3;
     }
     memset(*inst, 0, sizeof(struct encoder_dev_inst_t));
@@ -126,13 +129,13 @@ int rotary_encoder_inst_destroy(struct encoder_dev_inst_t** inst)
     fd  = (*inst)->fd;
 
     if (0 <= fd) {
-        close(fd);
+        hal_io_close(fd);
     }
 
     printf("[hal_encoder]: delete /dev/encoder%d with clk_pin %d, dt_pin %d, sw_pin %d\n", id, cfg->cfg.clk_pin,
            cfg->cfg.dt_pin, cfg->cfg.sw_pin);
 
-    free(*inst);
+    hal_slab_free(&encoder_inst_cache, *inst);
     *inst = NULL;
 
     if (0x00 != canmv_misc_delete_encode_dev(id)) {
@@ -152,7 +155,7 @@ int rotary_encoder_config(struct encoder_dev_inst_t* inst, struct encoder_pin_cf
     cfg.index = inst->cfg.index;
     memcpy(&cfg.cfg, pin, sizeof(struct encoder_pin_cfg_t));
 
-    if (ioctl(inst->fd, ENCODER_CMD_CONFIG, cfg) < 0) {
+    if (hal_io_ioctl(inst->fd, ENCODER_CMD_CONFIG, &cfg) < 0) {
         printf("[hal_encoder] Failed to configure encoder: %d\n", errno);
         return -1;
     }
@@ -168,7 +171,7 @@ int rotary_encoder_read(struct encoder_dev_inst_t* inst, struct encoder_data* da
         return -1;
     }
 
-    if (ioctl(inst->fd, ENCODER_CMD_GET_DATA, data) < 0) {
+    if (hal_io_ioctl(inst->fd, ENCODER_CMD_GET_DATA, data) < 0) {
         printf("[hal_encoder] Failed to read encoder data: %d\n", errno);
         return -1;
     }
@@ -185,7 +188,7 @@ int rotary_encoder_wait_event(struct encoder_dev_inst_t* inst, struct encoder_da
     }
 
     /* Wait for data available */
-    if (ioctl(inst->fd, ENCODER_CMD_WAIT_DATA, &timeout_ms) < 0) {
+    if (hal_io_ioctl(inst->fd, ENCODER_CMD_WAIT_DATA, &timeout_ms) < 0) {
         // printf("[hal_encoder] Failed to wait for data: %d\n", errno);
         return -1;
     }
@@ -198,7 +201,7 @@ int rotary_encoder_reset(struct encoder_dev_inst_t* inst)
 {
     CHECK_ENCODER_INST(inst);
 
-    if (ioctl(inst->fd, ENCODER_CMD_RESET, NULL) < 0) {
+    if (hal_io_ioctl(inst->fd, ENCODER_CMD_RESET, NULL) < 0) {
         printf("[hal_encoder] Failed to reset encoder: %d\n", errno);
         return -1;
     }
@@ -210,7 +213,7 @@ int rotary_encoder_set_count(struct encoder_dev_inst_t* inst, int64_t count)
 {
     CHECK_ENCODER_INST(inst);
 
-    if (ioctl(inst->fd, ENCODER_CMD_SET_COUNT, &count) < 0) {
+    if (hal_io_ioctl(inst->fd, ENCODER_CMD_SET_COUNT, &count) < 0) {
         printf("[hal_encoder] Failed to set encoder count: %d\n", errno);
         return -1;
     }
@@ -26,27 +26,104 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 
 #include "drv_uart.h"
 #include "drv_sbus.h"
+#include "hal_utils.h"
 
 #define IOC_SET_BAUDRATE            _IOW('U', 0x40, int)
 
-#define SBUS_CHANNEL_NUM 16
-#define SBUS_FRAME_SIZE 25
-
 #define SBUS_MIN 172
 #define SBUS_MAX 1811
 #define SBUS_NEUTRAL 1024
 
+#define SBUS_HEADER 0x0F
+#define SBUS_RX_POLL_MS 50
+#define SBUS_TX_SPIN_US 200
+#define SBUS_TX_MIN_PERIOD_US 3000 /* 25 characters of 12 bits at 100000 baud */
+
+/* sbus_tx.state */
+#define SBUS_SNAP_FRONT   (1 << 0) /* snapshot the transmitter sends from */
+#define SBUS_SNAP_DIRTY   (1 << 1) /* the other one holds a newer update */
+#define SBUS_SNAP_WRITING (1 << 2) /* a writer owns the other one */
+
+struct sbus_snapshot
+{
+    uint16_t channels[SBUS_CHANNEL_NUM];
+    sbus_flag_t flags;
+};
+
+struct sbus_rx
+{
+    pthread_t thread;
+    bool running;
+    volatile bool stop;
+
+    /* parser window, buf[0] is always a frame start candidate */
+    uint8_t buf[SBUS_FRAME_SIZE];
+    uint8_t len;
+    uint64_t last_ticks;
+
+    /* odd while the parser writes latest */
+    uint32_t seq;
+    uint32_t count; /* frames published, latest.count, sbus_rx_reset_stats() leaves it alone */
+    sbus_frame_t latest;
+
+    /* only the parser writes the counters, it zeroes them when reset_req moved past reset_done */
+    uint32_t reset_req;
+    uint32_t reset_done;
+    sbus_rx_stats_t stats;
+};
+
+/* transmitter counters, periods and lateness in ticks */
+struct sbus_tx_counters
+{
+    uint64_t frames;
+    uint64_t updates;
+    uint64_t overruns;
+    uint64_t write_errors;
+    uint64_t period_min;
+    uint64_t period_max;
+    uint64_t period_sum;
+    uint64_t late_max;
+};
+
+/*
+ * Writers fill the back snapshot and mark it dirty, the transmitter flips
+ * front and back at a frame boundary when the back one is dirty and no writer
+ * holds it. The transmitter never waits, writers only wait for each other.
+ */
+struct sbus_tx
+{
+    struct sbus_snapshot snap[2];
+    uint32_t state;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    bool running;
+    volatile bool stop;
+
+    uint64_t period_ticks;
+    uint64_t last_ticks;
+
+    /* only the frame sender writes the counters, odd while it does */
+    uint32_t seq;
+    uint32_t reset; /* sbus_tx_reset_stats() asked for zeroed counters */
+    struct sbus_tx_counters cnt;
+};
+
 struct sbus_device
 {
     bool debug;
     drv_uart_inst_t *uart_inst;
-    uint16_t channels[SBUS_CHANNEL_NUM];
-    sbus_flag_t flags;
+
+    struct sbus_tx tx;
+    struct sbus_rx rx;
 };
 
 sbus_dev_t sbus_create(int uart_id)
@@ -104,55 +181,100 @@ void sbus_destroy(sbus_dev_t dev)
         printf("[hal_sbus]: %s: pls ensure sbus_create called\n", __func__);
         return;
     } else {
+        sbus_tx_stop(dev);
+        sbus_rx_stop(dev);
         drv_uart_inst_destroy(&dev->uart_inst);
         free(dev);
     }
 }
 
+static struct sbus_snapshot *sbus_snap_begin(sbus_dev_t dev)
+{
+    uint32_t state = __atomic_load_n(&dev->tx.state, __ATOMIC_RELAXED) & ~SBUS_SNAP_WRITING;
+    struct sbus_snapshot *back;
+
+    while (!__atomic_compare_exchange_n(&dev->tx.state, &state, state | SBUS_SNAP_WRITING, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+        state &= ~SBUS_SNAP_WRITING;
+    }
+
+    /* the transmitter took the last update, start from what it sends */
+    back = &dev->tx.snap[!(state & SBUS_SNAP_FRONT)];
+    if (!(state & SBUS_SNAP_DIRTY)) {
+        *back = dev->tx.snap[state & SBUS_SNAP_FRONT];
+    }
+
+    return back;
+}
+
+static void sbus_snap_end(sbus_dev_t dev, bool changed)
+{
+    /* nobody else changes the state while we hold the writing bit */
+    uint32_t state = __atomic_load_n(&dev->tx.state, __ATOMIC_RELAXED) & ~SBUS_SNAP_WRITING;
+
+    __atomic_store_n(&dev->tx.state, state | (changed ? SBUS_SNAP_DIRTY : 0), __ATOMIC_RELEASE);
+}
+
+/* frame boundary: take a complete update if there is one */
+static const struct sbus_snapshot *sbus_snap_take(sbus_dev_t dev, bool *updated)
+{
+    uint32_t state = __atomic_load_n(&dev->tx.state, __ATOMIC_ACQUIRE);
+
+    if ((SBUS_SNAP_DIRTY == (state & (SBUS_SNAP_DIRTY | SBUS_SNAP_WRITING))) &&
+        __atomic_compare_exchange_n(&dev->tx.state, &state, (state ^ SBUS_SNAP_FRONT) & ~SBUS_SNAP_DIRTY, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        state ^= SBUS_SNAP_FRONT;
+        *updated = true;
+    }
+
+    return &dev->tx.snap[state & SBUS_SNAP_FRONT];
+}
+
 int sbus_set_channel(sbus_dev_t dev, uint8_t channel_index, uint16_t value)
 {
-    int ret = 0;
+    struct sbus_snapshot *snap;
 
     if (!dev) {
         printf("[hal_sbus]: %s: pls ensure sbus_create called\n", __func__);
-        ret = -1;
-        goto out;
+        return -1;
     }
 
     if (channel_index >= SBUS_CHANNEL_NUM) {
         printf("[hal_sbus]: channel index is over range\n");
-        ret = -1;
-        goto out;
-    }
-
-#if 0
-    if (value > 2047) {
-        value = 2047;
-    }
-
-    if (value < 172) {
-        value = 172;
+        return -1;
     }
-#endif
 
-    dev->channels[channel_index] = value;
+    snap = sbus_snap_begin(dev);
+    snap->channels[channel_index] = value;
+    sbus_snap_end(dev, true);
 
-out:
-    return ret;
+    return 0;
 }
 
 int sbus_set_all_channels(sbus_dev_t dev, uint16_t *channels)
 {
-    int ret = 0;
+    return sbus_update(dev, channels, NULL);
+}
 
-    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
-        ret = sbus_set_channel(dev, i, channels[i]);
-        if (ret != 0) {
-            break;
-        }
+int sbus_update(sbus_dev_t dev, const uint16_t *channels, const sbus_flag_t *flags)
+{
+    struct sbus_snapshot *snap;
+
+    if (!dev) {
+        printf("[hal_sbus]: %s: pls ensure sbus_create called\n", __func__);
+        return -1;
+    }
+
+    snap = sbus_snap_begin(dev);
+    if (channels) {
+        memcpy(snap->channels, channels, sizeof(snap->channels));
+    }
+    if (flags) {
+        snap->flags = *flags;
     }
+    sbus_snap_end(dev, channels || flags);
 
-    return ret;
+    return 0;
 }
 
 void sbus_set_flags(sbus_dev_t dev, const sbus_flag_t *flags)
@@ -162,56 +284,141 @@ void sbus_set_flags(sbus_dev_t dev, const sbus_flag_t *flags)
         return;
     }
 
-    if (flags) {
-        dev->flags = *flags;
-    }
+    sbus_update(dev, NULL, flags);
 }
 
 void sbus_get_flags(sbus_dev_t dev, sbus_flag_t *flags_out)
 {
+    struct sbus_snapshot *snap;
+
     if (!dev) {
         printf("[hal_sbus]: %s: pls ensure sbus_create called\n", __func__);
         return;
     }
 
     if (flags_out) {
-        *flags_out = dev->flags;
+        snap = sbus_snap_begin(dev);
+        *flags_out = snap->flags;
+        sbus_snap_end(dev, false);
     }
 }
 
-static void sbus_decode_frame(uint8_t *sbus_frame, uint16_t *ch, sbus_flag_t *flags)
+static inline uint64_t sbus_load_le64(const uint8_t *p)
 {
-    if (!sbus_frame || !ch || sbus_frame[0] != 0x0F || sbus_frame[24] != 0x00) {
-        return;
-    }
+    uint64_t w;
 
-    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
-        int byte_pos = 1 + (i * 11) / 8;
-        int bit_pos = (i * 11) % 8;
+    memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
 
-        ch[i] = (sbus_frame[byte_pos] >> bit_pos) |
-            (sbus_frame[byte_pos + 1] << (8 - bit_pos));
+static inline void sbus_store_le64(uint8_t *p, uint64_t w)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    memcpy(p, &w, sizeof(w));
+}
 
-        if (bit_pos > 5) {
-            ch[i] |= (sbus_frame[byte_pos + 2] << (16 - bit_pos));
-        }
+/*
+ * Eight 11 bit channels are 88 bits, 11 bytes: bits 0..63 in one word, the
+ * rest in a 24 bit one. Channel 5 straddles the two.
+ */
+static inline void sbus_unpack8(const uint8_t *p, uint16_t *ch)
+{
+    uint64_t w0 = sbus_load_le64(p);
+    uint32_t w1 = p[8] | (p[9] << 8) | (p[10] << 16);
+
+    ch[0] = w0 & 0x7FF;
+    ch[1] = (w0 >> 11) & 0x7FF;
+    ch[2] = (w0 >> 22) & 0x7FF;
+    ch[3] = (w0 >> 33) & 0x7FF;
+    ch[4] = (w0 >> 44) & 0x7FF;
+    ch[5] = ((w0 >> 55) | (w1 << 9)) & 0x7FF;
+    ch[6] = (w1 >> 2) & 0x7FF;
+    ch[7] = (w1 >> 13) & 0x7FF;
+}
 
-        ch[i] &= 0x07FF;
+static inline void sbus_pack8(uint8_t *p, const uint16_t *ch)
+{
+    uint64_t c5 = ch[5] & 0x7FF;
+    uint64_t w0;
+    uint32_t w1;
+
+    w0 = (uint64_t)(ch[0] & 0x7FF) | ((uint64_t)(ch[1] & 0x7FF) << 11) | ((uint64_t)(ch[2] & 0x7FF) << 22) |
+         ((uint64_t)(ch[3] & 0x7FF) << 33) | ((uint64_t)(ch[4] & 0x7FF) << 44) | (c5 << 55);
+    w1 = (c5 >> 9) | ((ch[6] & 0x7FF) << 2) | ((ch[7] & 0x7FF) << 13);
+
+    sbus_store_le64(p, w0);
+    p[8] = w1 & 0xFF;
+    p[9] = (w1 >> 8) & 0xFF;
+    p[10] = (w1 >> 16) & 0xFF;
+}
+
+/*
+ * SBUS has no checksum, the only checks are the start byte, the unused upper
+ * half of the flags byte, and the end byte: 0x00 for SBUS, 0x04/0x14/0x24/0x34
+ * carry the SBUS2 telemetry slot.
+ */
+static inline bool sbus_frame_valid(const uint8_t *frame)
+{
+    uint8_t end = frame[SBUS_FRAME_SIZE - 1];
+
+    return (SBUS_HEADER == frame[0]) && (0 == (frame[23] & 0xF0)) &&
+           ((0x00 == end) || ((0x04 == (end & 0x0F)) && (0x34 >= end)));
+}
+
+void sbus_pack_frame(const uint16_t *channels, sbus_flag_t flags, uint8_t *frame)
+{
+    frame[0] = SBUS_HEADER;
+    sbus_pack8(&frame[1], &channels[0]);
+    sbus_pack8(&frame[12], &channels[8]);
+    frame[23] = flags.val & 0x0F;
+    frame[24] = 0x00;
+}
+
+int sbus_unpack_frame(const uint8_t *frame, uint16_t *channels, sbus_flag_t *flags)
+{
+    if (!frame || !channels || !sbus_frame_valid(frame)) {
+        return -1;
     }
 
+    sbus_unpack8(&frame[1], &channels[0]);
+    sbus_unpack8(&frame[12], &channels[8]);
     if (flags) {
-        uint8_t flag_byte = sbus_frame[23];
-        flags->bit.ch17       = ((flag_byte >> 0) & 0x01) ? true : false;
-        flags->bit.ch18       = ((flag_byte >> 1) & 0x01) ? true : false;
-        flags->bit.frame_lost = ((flag_byte >> 2) & 0x01) ? true : false;
-        flags->bit.failsafe   = ((flag_byte >> 3) & 0x01) ? true : false;
+        flags->val = frame[23] & 0x0F;
+    }
+
+    return 0;
+}
+
+/* open the counters for the frame sender, a pending reset is applied first */
+static struct sbus_tx_counters *sbus_tx_count_begin(struct sbus_tx *tx)
+{
+    uint32_t seq = tx->seq;
+
+    __atomic_store_n(&tx->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (__atomic_exchange_n(&tx->reset, 0, __ATOMIC_ACQUIRE)) {
+        memset(&tx->cnt, 0, sizeof(tx->cnt));
     }
+
+    return &tx->cnt;
+}
+
+static void sbus_tx_count_end(struct sbus_tx *tx)
+{
+    __atomic_store_n(&tx->seq, tx->seq + 1, __ATOMIC_RELEASE);
 }
 
 int sbus_send_frame(sbus_dev_t dev)
 {
-    uint8_t flags = 0;
+    const struct sbus_snapshot *snap;
     uint8_t sbus_frame[SBUS_FRAME_SIZE];
+    bool updated = false;
     int len;
 
     if (!dev) {
@@ -219,43 +426,21 @@ int sbus_send_frame(sbus_dev_t dev)
         return -1;
     }
 
-    sbus_frame[0] = 0x0F;
-    memset(&sbus_frame[1], 0, 22);
-
-    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
-        uint16_t val = dev->channels[i];
-
-        int byte_pos = 1 + (i * 11) / 8;
-        int bit_pos = (i * 11) % 8;
-
-        sbus_frame[byte_pos] |= (val << bit_pos) & 0xFF;
-        sbus_frame[byte_pos + 1] |= (val >> (8 - bit_pos)) & 0xFF;
-        if (bit_pos > 5) {
-            sbus_frame[byte_pos + 2] |= (val >> (16 - bit_pos)) & 0xFF;
-        }
-    }
-
-    if (dev->flags.bit.ch17) {
-        flags |= (1 << 0);
-    }
-    if (dev->flags.bit.ch18) {
-        flags |= (1 << 1);
-    }
-    if (dev->flags.bit.frame_lost) {
-        flags |= (1 << 2);
-    }
-    if (dev->flags.bit.failsafe) {
-        flags |= (1 << 3);
+    if (dev->tx.running) {
+        printf("[hal_sbus]: periodic transmitter owns the uart\n");
+        return -1;
     }
 
-    sbus_frame[23] = flags;
-    sbus_frame[24] = 0x00;
+    snap = sbus_snap_take(dev, &updated);
+    sbus_pack_frame(snap->channels, snap->flags, sbus_frame);
+    sbus_tx_count_begin(&dev->tx)->updates += updated;
+    sbus_tx_count_end(&dev->tx);
 
     if (dev->debug) {
         sbus_flag_t flag;
         uint16_t ch[SBUS_CHANNEL_NUM];
 
-        sbus_decode_frame(sbus_frame, ch, &flag);
+        sbus_unpack_frame(sbus_frame, ch, &flag);
         for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
             printf("[hal_sbus]: CH[%02d] = 0x%-3x(%4d)\n", i, ch[i], ch[i]);
         }
@@ -281,3 +466,421 @@ void sbus_set_debug(sbus_dev_t dev, bool val)
 
     dev->debug = val;
 }
+
+/* a frame passed both checks in rx->buf, publish it */
+static void sbus_rx_publish(struct sbus_rx *rx, uint64_t ticks)
+{
+    uint32_t seq = rx->seq;
+
+    __atomic_store_n(&rx->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    sbus_unpack8(&rx->buf[1], &rx->latest.channels[0]);
+    sbus_unpack8(&rx->buf[12], &rx->latest.channels[8]);
+    rx->latest.flags.val = rx->buf[23];
+    rx->latest.count = ++rx->count;
+    rx->latest.ticks = ticks;
+
+    __atomic_store_n(&rx->seq, seq + 2, __ATOMIC_RELEASE);
+
+    rx->stats.frames++;
+    rx->stats.frame_lost += rx->latest.flags.bit.frame_lost;
+    rx->stats.failsafe += rx->latest.flags.bit.failsafe;
+}
+
+/* apply a pending sbus_rx_reset_stats() before the parser counts again */
+static void sbus_rx_take_reset(struct sbus_rx *rx)
+{
+    uint32_t req = __atomic_load_n(&rx->reset_req, __ATOMIC_ACQUIRE);
+
+    if (req != rx->reset_done) {
+        memset(&rx->stats, 0, sizeof(rx->stats));
+        __atomic_store_n(&rx->reset_done, req, __ATOMIC_RELEASE);
+    }
+}
+
+static int sbus_rx_parse(struct sbus_rx *rx, const uint8_t *data, size_t len, uint64_t ticks)
+{
+    const uint8_t *end = data + len;
+    const uint8_t *start;
+    size_t n;
+    int frames = 0;
+
+    sbus_rx_take_reset(rx);
+    rx->stats.bytes += len;
+
+    while (data < end) {
+        if (0 == rx->len) {
+            /* hunting, skip to the next start byte in one go */
+            start = memchr(data, SBUS_HEADER, end - data);
+            if (!start) {
+                rx->stats.dropped += end - data;
+                break;
+            }
+            rx->stats.dropped += start - data;
+            data = start;
+        }
+
+        n = SBUS_FRAME_SIZE - rx->len;
+        if (n > (size_t)(end - data)) {
+            n = end - data;
+        }
+        memcpy(&rx->buf[rx->len], data, n);
+        rx->len += n;
+        data += n;
+
+        if (SBUS_FRAME_SIZE != rx->len) {
+            break;
+        }
+
+        if (sbus_frame_valid(rx->buf)) {
+            sbus_rx_publish(rx, ticks);
+            rx->len = 0;
+            frames++;
+            continue;
+        }
+
+        /* misaligned, the real start can only be a later 0x0F in the window */
+        rx->stats.bad_frames++;
+        start = memchr(&rx->buf[1], SBUS_HEADER, SBUS_FRAME_SIZE - 1);
+        n = start ? (size_t)(start - rx->buf) : SBUS_FRAME_SIZE;
+        memmove(rx->buf, &rx->buf[n], SBUS_FRAME_SIZE - n);
+        rx->len = SBUS_FRAME_SIZE - n;
+        rx->stats.dropped += n;
+    }
+
+    return frames;
+}
+
+static void *sbus_rx_thread(void *arg)
+{
+    sbus_dev_t dev = arg;
+    struct sbus_rx *rx = &dev->rx;
+    uint8_t buf[256];
+    uint64_t now;
+    size_t len;
+
+    while (!rx->stop) {
+        if (0 >= drv_uart_poll(dev->uart_inst, SBUS_RX_POLL_MS)) {
+            continue;
+        }
+
+        len = drv_uart_read(dev->uart_inst, buf, sizeof(buf));
+        if (0 == len || (size_t)-1 == len || (size_t)-2 == len) {
+            continue;
+        }
+
+        now = utils_cpu_ticks();
+        sbus_rx_take_reset(rx);
+        if (rx->len && (now - rx->last_ticks) > (uint64_t)SBUS_RX_GAP_US * CPU_TICKS_PER_SECOND / 1000000) {
+            /* frames are sent back to back, a pause inside one means bytes were lost */
+            rx->stats.gap_resyncs++;
+            rx->stats.dropped += rx->len;
+            rx->len = 0;
+        }
+        rx->last_ticks = now;
+
+        sbus_rx_parse(rx, buf, len, now);
+    }
+
+    return NULL;
+}
+
+int sbus_rx_start(sbus_dev_t dev)
+{
+    if (!dev) {
+        printf("[hal_sbus]: %s: pls ensure sbus_create called\n", __func__);
+        return -1;
+    }
+
+    if (dev->rx.running) {
+        return 0;
+    }
+
+    dev->rx.stop = false;
+    dev->rx.len = 0;
+    if (0 != pthread_create(&dev->rx.thread, NULL, sbus_rx_thread, dev)) {
+        printf("[hal_sbus]: create rx thread failed\n");
+        return -1;
+    }
+    dev->rx.running = true;
+
+    return 0;
+}
+
+void sbus_rx_stop(sbus_dev_t dev)
+{
+    if (!dev || !dev->rx.running) {
+        return;
+    }
+
+    dev->rx.stop = true;
+    pthread_join(dev->rx.thread, NULL);
+    dev->rx.running = false;
+}
+
+int sbus_rx_feed(sbus_dev_t dev, const uint8_t *data, size_t len)
+{
+    if (!dev || (!data && len)) {
+        printf("[hal_sbus]: %s: invalid parameters\n", __func__);
+        return -1;
+    }
+
+    if (dev->rx.running) {
+        printf("[hal_sbus]: rx thread owns the parser\n");
+        return -1;
+    }
+
+    return sbus_rx_parse(&dev->rx, data, len, utils_cpu_ticks());
+}
+
+int sbus_rx_get_latest(sbus_dev_t dev, sbus_frame_t *frame, uint32_t max_age_ms)
+{
+    uint32_t seq0, seq1;
+
+    if (!dev || !frame) {
+        return -1;
+    }
+
+    do {
+        seq0 = __atomic_load_n(&dev->rx.seq, __ATOMIC_ACQUIRE);
+        if (seq0 & 1) {
+            continue;
+        }
+        *frame = dev->rx.latest;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq1 = __atomic_load_n(&dev->rx.seq, __ATOMIC_RELAXED);
+    } while ((seq0 & 1) || seq0 != seq1);
+
+    if (0 == frame->count) {
+        return -1;
+    }
+    if (max_age_ms && (utils_cpu_ticks() - frame->ticks) > (uint64_t)max_age_ms * (CPU_TICKS_PER_SECOND / 1000)) {
+        return -2;
+    }
+
+    return 0;
+}
+
+void sbus_rx_get_stats(sbus_dev_t dev, sbus_rx_stats_t *stats)
+{
+    uint32_t req;
+
+    if (!dev || !stats) {
+        return;
+    }
+
+    req = __atomic_load_n(&dev->rx.reset_req, __ATOMIC_ACQUIRE);
+    *stats = dev->rx.stats;
+    if (req != __atomic_load_n(&dev->rx.reset_done, __ATOMIC_ACQUIRE)) {
+        /* not applied by the parser yet */
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void sbus_rx_reset_stats(sbus_dev_t dev)
+{
+    if (!dev) {
+        return;
+    }
+
+    /* the parser zeroes the counters, the frame count of sbus_rx_get_latest() keeps going */
+    __atomic_add_fetch(&dev->rx.reset_req, 1, __ATOMIC_RELEASE);
+}
+
+/* sleep close to @deadline, spin the rest, false if stopped */
+static bool sbus_tx_wait(struct sbus_tx *tx, uint64_t deadline)
+{
+    uint64_t spin = (uint64_t)SBUS_TX_SPIN_US * (CPU_TICKS_PER_SECOND / 1000000);
+    uint64_t now, ns;
+    struct timespec ts;
+
+    pthread_mutex_lock(&tx->lock);
+    while (!tx->stop && (now = utils_cpu_ticks()) + spin < deadline) {
+        /* utils_cpu_ticks() is not the condvar clock, convert the distance */
+        ns = (deadline - spin - now) * 1000000000ULL / CPU_TICKS_PER_SECOND;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ns += ts.tv_nsec;
+        ts.tv_sec += ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+        pthread_cond_timedwait(&tx->wakeup, &tx->lock, &ts);
+    }
+    pthread_mutex_unlock(&tx->lock);
+
+    while (!tx->stop && utils_cpu_ticks() < deadline) {
+    }
+
+    return !tx->stop;
+}
+
+static void *sbus_tx_thread(void *arg)
+{
+    sbus_dev_t dev = arg;
+    struct sbus_tx *tx = &dev->tx;
+    const struct sbus_snapshot *snap;
+    struct sbus_tx_counters *cnt;
+    uint8_t frame[SBUS_FRAME_SIZE];
+    uint64_t deadline = utils_cpu_ticks();
+    uint64_t now, period, missed;
+    bool updated, failed;
+
+    while (sbus_tx_wait(tx, deadline)) {
+        updated = false;
+        snap = sbus_snap_take(dev, &updated);
+        sbus_pack_frame(snap->channels, snap->flags, frame);
+
+        now = utils_cpu_ticks();
+        failed = (SBUS_FRAME_SIZE != drv_uart_write(dev->uart_inst, frame, SBUS_FRAME_SIZE));
+
+        cnt = sbus_tx_count_begin(tx);
+        cnt->updates += updated;
+        cnt->write_errors += failed;
+        if (cnt->frames) {
+            period = now - tx->last_ticks;
+            cnt->period_sum += period;
+            if (period < cnt->period_min || 0 == cnt->period_min) {
+                cnt->period_min = period;
+            }
+            if (period > cnt->period_max) {
+                cnt->period_max = period;
+            }
+        }
+        if (now - deadline > cnt->late_max) {
+            cnt->late_max = now - deadline;
+        }
+        tx->last_ticks = now;
+        cnt->frames++;
+
+        /* deadlines stay on the grid of the start time, a missed slot is skipped, not shifted */
+        deadline += tx->period_ticks;
+        now = utils_cpu_ticks();
+        if (now >= deadline) {
+            missed = (now - deadline) / tx->period_ticks + 1;
+            cnt->overruns += missed;
+            deadline += missed * tx->period_ticks;
+        }
+        sbus_tx_count_end(tx);
+    }
+
+    return NULL;
+}
+
+int sbus_tx_start(sbus_dev_t dev, uint32_t period_us)
+{
+    struct sbus_tx *tx;
+    pthread_condattr_t attr;
+
+    if (!dev) {
+        printf("[hal_sbus]: %s: pls ensure sbus_create called\n", __func__);
+        return -1;
+    }
+
+    if (period_us < SBUS_TX_MIN_PERIOD_US) {
+        printf("[hal_sbus]: period %u us shorter than a frame\n", period_us);
+        return -1;
+    }
+
+    tx = &dev->tx;
+    if (tx->running) {
+        return 0;
+    }
+
+    pthread_mutex_init(&tx->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&tx->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+
+    tx->stop = false;
+    tx->period_ticks = (uint64_t)period_us * (CPU_TICKS_PER_SECOND / 1000000);
+    memset(&tx->cnt, 0, sizeof(tx->cnt));
+    tx->reset = 0;
+
+    if (0 != pthread_create(&tx->thread, NULL, sbus_tx_thread, dev)) {
+        printf("[hal_sbus]: create tx thread failed\n");
+        pthread_cond_destroy(&tx->wakeup);
+        pthread_mutex_destroy(&tx->lock);
+        return -1;
+    }
+    tx->running = true;
+
+    return 0;
+}
+
+void sbus_tx_stop(sbus_dev_t dev)
+{
+    struct sbus_tx *tx;
+
+    if (!dev || !dev->tx.running) {
+        return;
+    }
+
+    tx = &dev->tx;
+    pthread_mutex_lock(&tx->lock);
+    tx->stop = true;
+    pthread_cond_signal(&tx->wakeup);
+    pthread_mutex_unlock(&tx->lock);
+
+    pthread_join(tx->thread, NULL);
+    pthread_cond_destroy(&tx->wakeup);
+    pthread_mutex_destroy(&tx->lock);
+    tx->running = false;
+}
+
+void sbus_tx_get_stats(sbus_dev_t dev, sbus_tx_stats_t *stats)
+{
+    struct sbus_tx *tx;
+    struct sbus_tx_counters cnt;
+    uint32_t seq0, seq1, reset;
+    uint64_t nominal;
+
+    if (!dev || !stats) {
+        return;
+    }
+
+    tx = &dev->tx;
+    do {
+        seq0 = __atomic_load_n(&tx->seq, __ATOMIC_ACQUIRE);
+        if (seq0 & 1) {
+            continue;
+        }
+        cnt = tx->cnt;
+        reset = __atomic_load_n(&tx->reset, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq1 = __atomic_load_n(&tx->seq, __ATOMIC_RELAXED);
+    } while ((seq0 & 1) || seq0 != seq1);
+
+    if (reset) {
+        /* not applied by the sender yet */
+        memset(&cnt, 0, sizeof(cnt));
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    nominal = tx->period_ticks;
+    stats->frames = cnt.frames;
+    stats->updates = cnt.updates;
+    stats->overruns = cnt.overruns;
+    stats->write_errors = cnt.write_errors;
+    stats->period_ns = utils_cpu_ticks_to_ns(nominal);
+    stats->period_ns_min = utils_cpu_ticks_to_ns(cnt.period_min);
+    stats->period_ns_max = utils_cpu_ticks_to_ns(cnt.period_max);
+    stats->period_ns_mean = (1 < cnt.frames) ? utils_cpu_ticks_to_ns(cnt.period_sum / (cnt.frames - 1)) : 0;
+    stats->late_ns_max = utils_cpu_ticks_to_ns(cnt.late_max);
+
+    if (1 < cnt.frames) {
+        uint64_t below = (nominal > cnt.period_min) ? nominal - cnt.period_min : 0;
+        uint64_t above = (cnt.period_max > nominal) ? cnt.period_max - nominal : 0;
+
+        stats->jitter_ns_max = utils_cpu_ticks_to_ns((below > above) ? below : above);
+    }
+}
+
+void sbus_tx_reset_stats(sbus_dev_t dev)
+{
+    if (!dev) {
+        return;
+    }
+
+    /* the frame sender zeroes the counters, the next frame starts a new period series */
+    __atomic_store_n(&dev->tx.reset, 1, __ATOMIC_RELEASE);
+}
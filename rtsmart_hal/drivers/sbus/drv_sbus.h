@@ -25,6 +25,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -44,6 +45,43 @@ typedef struct
     };
 } sbus_flag_t;
 
+#define SBUS_CHANNEL_NUM 16
+#define SBUS_FRAME_SIZE  25
+
+/* latest received frame, see sbus_rx_get_latest() */
+typedef struct
+{
+    uint16_t channels[SBUS_CHANNEL_NUM];
+    sbus_flag_t flags;
+    uint32_t count;     /* frames received so far, tells a new frame from a repeated read, not reset with the stats */
+    uint64_t ticks;     /* utils_cpu_ticks() when the frame completed */
+} sbus_frame_t;
+
+typedef struct
+{
+    uint64_t bytes;
+    uint64_t frames;
+    uint64_t dropped;       /* bytes skipped while searching for a frame start */
+    uint64_t bad_frames;    /* 0x0F start that did not pass the frame checks */
+    uint64_t gap_resyncs;   /* partial frames dropped because the line went quiet */
+    uint64_t frame_lost;    /* frames carrying the frame lost flag */
+    uint64_t failsafe;      /* frames carrying the failsafe flag */
+} sbus_rx_stats_t;
+
+typedef struct
+{
+    uint64_t frames;
+    uint64_t updates;       /* snapshots taken over at a frame boundary */
+    uint64_t overruns;      /* frame slots missed, the schedule skips them */
+    uint64_t write_errors;
+    uint64_t period_ns;     /* nominal */
+    uint64_t period_ns_min; /* between the writes of consecutive frames */
+    uint64_t period_ns_max;
+    uint64_t period_ns_mean;
+    uint64_t jitter_ns_max; /* largest distance of a period from nominal */
+    uint64_t late_ns_max;   /* deadline to the write of the frame */
+} sbus_tx_stats_t;
+
 typedef struct sbus_device *sbus_dev_t;
 
 sbus_dev_t sbus_create(int uart_id);
@@ -55,6 +93,57 @@ void sbus_get_flags(sbus_dev_t dev, sbus_flag_t *flags_out);
 int sbus_send_frame(sbus_dev_t dev);
 void sbus_set_debug(sbus_dev_t dev, bool val);
 
+/*
+ * Channels and flags live in two snapshots. Setters write the one not being
+ * sent and a frame takes it over only once the update is complete, so
+ * sbus_update() changes any set of channels and the flags atomically and the
+ * transmitter never waits for a writer. @channels or @flags may be NULL.
+ */
+int sbus_update(sbus_dev_t dev, const uint16_t *channels, const sbus_flag_t *flags);
+
+/*
+ * Periodic transmitter: a thread sends a frame at start + n * @period_us
+ * (7000 or 14000 for the usual SBUS rates), sleeping until shortly before each
+ * deadline and spinning the rest. Deadlines never drift with the send time, a
+ * missed slot is counted and skipped. sbus_send_frame() is refused while it
+ * runs.
+ */
+int sbus_tx_start(sbus_dev_t dev, uint32_t period_us);
+void sbus_tx_stop(sbus_dev_t dev);
+void sbus_tx_get_stats(sbus_dev_t dev, sbus_tx_stats_t *stats);
+void sbus_tx_reset_stats(sbus_dev_t dev);
+
+/*
+ * Frame codec. Channels are packed eight at a time through one 64 bit and one
+ * 24 bit little endian word instead of bit by bit. Unpack returns -1 unless the
+ * frame starts with 0x0F, the upper half of the flags byte is clear, and it
+ * ends with 0x00 or one of the SBUS2 end bytes 0x04/0x14/0x24/0x34.
+ */
+void sbus_pack_frame(const uint16_t *channels, sbus_flag_t flags, uint8_t *frame);
+int sbus_unpack_frame(const uint8_t *frame, uint16_t *channels, sbus_flag_t *flags);
+
+/*
+ * Receive path. sbus_rx_start() runs a reader thread on the uart of @dev that
+ * feeds the streaming parser, sbus_rx_feed() feeds it by hand instead (only
+ * while the thread is stopped) and returns the frames it completed. The parser
+ * hunts for 0x0F, checks the frame 25 bytes later and on a mismatch
+ * restarts at the next 0x0F inside the window rather than dropping the whole
+ * window. A quiet line of more than SBUS_RX_GAP_US mid frame also restarts it.
+ *
+ * The latest frame is published through a sequence counter, readers never
+ * block the parser and never see a torn frame. sbus_rx_get_latest() returns
+ * 0, -1 before the first frame, -2 if the frame is older than @max_age_ms
+ * (0 accepts any age): treat that like failsafe.
+ */
+#define SBUS_RX_GAP_US 1000
+
+int sbus_rx_start(sbus_dev_t dev);
+void sbus_rx_stop(sbus_dev_t dev);
+int sbus_rx_feed(sbus_dev_t dev, const uint8_t *data, size_t len);
+int sbus_rx_get_latest(sbus_dev_t dev, sbus_frame_t *frame, uint32_t max_age_ms);
+void sbus_rx_get_stats(sbus_dev_t dev, sbus_rx_stats_t *stats);
+void sbus_rx_reset_stats(sbus_dev_t dev);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
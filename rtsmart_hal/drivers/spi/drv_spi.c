@@ -34,6 +34,9 @@
 #include "drv_spi.h"
 #include "drv_fpioa.h"
 #include "drv_gpio.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
 
 /* SPI control commands */
 #define RT_SPI_DEV_CTRL_CONFIG      (12 * 0x100 + 0x01)
@@ -85,10 +88,21 @@ struct rt_qspi_configuration {
 
 static uint64_t g_handle_id[SPI_HAL_MAX_DEVICES];
 static pthread_spinlock_t lock[SPI_HAL_MAX_DEVICES];
+static pthread_once_t lock_once = PTHREAD_ONCE_INIT;
+static HAL_SLAB_CACHE_DEFINE(spi_inst_cache, "drv_spi", struct drv_spi_inst);
+
+static void lock_init(void)
+{
+    for (int i = 0; i < SPI_HAL_MAX_DEVICES; i++) {
+        pthread_spin_init(&lock[i], PTHREAD_PROCESS_PRIVATE);
+    }
+}
 
 int drv_spi_inst_create(int spi_id, bool active_low, int mode, uint32_t baudrate,
                         uint8_t data_bits, int cs_pin, uint8_t data_line, drv_spi_inst_t *inst)
 {
+    HAL_TRACE_FUNC();
+
     int ret = -1;
     static uint64_t idx;
 
@@ -129,9 +143,12 @@ int drv_spi_inst_create(int spi_id, bool active_low, int mode, uint32_t baudrate
         goto err_0;
     }
 
-    *inst = malloc(sizeof(struct drv_spi_inst));
+    /* a zeroed spinlock is not unlocked on every libc */
+    pthread_once(&lock_once, lock_init);
+
+    *inst = hal_slab_alloc(&spi_inst_cache);
     if (!(*inst)) {
-        printf("[hal_spi]: malloc drv_spi_inst fail\n");
+        printf("[hal_spi]: alloc drv_spi_inst fail\n");
         goto err_0;
     }
 
@@ -172,7 +189,7 @@ int drv_spi_inst_create(int spi_id, bool active_low, int mode, uint32_t baudrate
     char dev_name[32];
     snprintf(dev_name, sizeof(dev_name), "/dev/spi%d", spi_id);
 
-    (*inst)->dev_fd = open(dev_name, O_RDWR);
+    (*inst)->dev_fd = hal_io_open(dev_name, O_RDWR);
     if ((*inst)->dev_fd < 0) {
         printf("[hal_spi]: open %s fail in function %s\n", dev_name, __func__);
         goto err_2;
@@ -195,7 +212,7 @@ int drv_spi_inst_create(int spi_id, bool active_low, int mode, uint32_t baudrate
     spi_config.qspi_dl_width = data_line;
     (*inst)->handle_id = idx++;
 
-    if ((ret = ioctl((*inst)->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
+    if ((ret = hal_io_ioctl((*inst)->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
         printf("[hal_spi]: spi config fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
         goto err_3;
     }
@@ -207,20 +224,31 @@ int drv_spi_inst_create(int spi_id, bool active_low, int mode, uint32_t baudrate
     return ret;
 
 err_3:
-    close((*inst)->dev_fd);
+    hal_io_close((*inst)->dev_fd);
 err_2:
     if (cs_pin != -1) {
         drv_gpio_inst_destroy(&(*inst)->gpio_cs);
     }
 err_1:
-    free(*inst);
+    hal_slab_free(&spi_inst_cache, *inst);
 err_0:
 
     return ret;
 }
 
+int drv_spi_get_id(drv_spi_inst_t inst)
+{
+    if (!inst || inst->dev_fd < 0) {
+        return -1;
+    }
+
+    return inst->spi_id;
+}
+
 void drv_spi_inst_destroy(drv_spi_inst_t *inst)
 {
+    HAL_TRACE_FUNC();
+
     if (inst != NULL) {
         if (*inst) {
 
@@ -230,34 +258,19 @@ void drv_spi_inst_destroy(drv_spi_inst_t *inst)
             }
 
             if ((*inst)->dev_fd >= 0) {
-                close((*inst)->dev_fd);
+                hal_io_close((*inst)->dev_fd);
             }
-            free((*inst));
+            hal_slab_free(&spi_inst_cache, *inst);
         }
     }
 }
 
-int drv_spi_transfer(drv_spi_inst_t inst, const void *tx_data,
-                        void *rx_data, size_t len, bool cs_change)
+/* load the configuration of @inst if another instance used the bus last */
+static int drv_spi_bind_config(drv_spi_inst_t inst)
 {
     int ret = 0;
-    int cs_pin;
-
-    struct rt_qspi_message msg;
-
-    if (!inst || inst->dev_fd < 0) {
-        printf("[hal_spi]: pls drv_spi_inst_create first\n");
-        ret = -1;
-        goto out;
-    }
-
-    if (len == 0) {
-        printf("[hal_spi]: zero len\n");
-        goto out;
-    }
 
     pthread_spin_lock(&lock[inst->spi_id]);
-    cs_pin = inst->cs_pin;
     if (g_handle_id[inst->spi_id] != inst->handle_id) {
         struct rt_qspi_configuration spi_config;
         memset(&spi_config, 0, sizeof(spi_config));
@@ -266,8 +279,8 @@ int drv_spi_transfer(drv_spi_inst_t inst, const void *tx_data,
         spi_config.parent.data_width = inst->data_bits;
 
         spi_config.parent.hard_cs = 0;
-        if (cs_pin != -1) {
-            spi_config.parent.soft_cs = cs_pin | 0x80;
+        if (inst->cs_pin != -1) {
+            spi_config.parent.soft_cs = inst->cs_pin | 0x80;
         } else {
             spi_config.parent.soft_cs = 0;
         }
@@ -275,15 +288,43 @@ int drv_spi_transfer(drv_spi_inst_t inst, const void *tx_data,
         spi_config.parent.max_hz = inst->baudrate;
         spi_config.qspi_dl_width = inst->data_line;
 
-        if ((ret = ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
+        if ((ret = hal_io_ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
             printf("[hal_spi]: spi config fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
-            pthread_spin_unlock(&lock[inst->spi_id]);
-            goto out;
+        } else {
+            g_handle_id[inst->spi_id] = inst->handle_id;
         }
-        g_handle_id[inst->spi_id] = inst->handle_id;
     }
     pthread_spin_unlock(&lock[inst->spi_id]);
 
+    return ret;
+}
+
+int drv_spi_transfer(drv_spi_inst_t inst, const void *tx_data,
+                        void *rx_data, size_t len, bool cs_change)
+{
+    HAL_TRACE_FUNC();
+
+    int ret = 0;
+    int cs_pin;
+
+    struct rt_qspi_message msg;
+
+    if (!inst || inst->dev_fd < 0) {
+        printf("[hal_spi]: pls drv_spi_inst_create first\n");
+        ret = -1;
+        goto out;
+    }
+
+    if (len == 0) {
+        printf("[hal_spi]: zero len\n");
+        goto out;
+    }
+
+    cs_pin = inst->cs_pin;
+    if ((ret = drv_spi_bind_config(inst))) {
+        goto out;
+    }
+
     memset(&msg, 0, sizeof(msg));
 
     msg.parent.send_buf = tx_data;
@@ -312,7 +353,7 @@ int drv_spi_transfer(drv_spi_inst_t inst, const void *tx_data,
 
     msg.qspi_data_lines = inst->data_line;
 
-    ret = ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_RW, &msg);
+    ret = hal_io_ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_RW, &msg);
     if (ret != (int)len) {
         printf("[hal_spi]: spi transfer fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
     }
@@ -321,20 +362,123 @@ out:
     return ret;
 }
 
+int drv_spi_transfer_segments(drv_spi_inst_t inst, const drv_spi_seg_t *segs, int count)
+{
+    HAL_TRACE_FUNC();
+
+    int ret = 0;
+    int num = 0;
+    size_t total = 0;
+    struct rt_qspi_message stack_msgs[SPI_HAL_CHAIN_SEGS];
+    struct rt_qspi_message *msgs = stack_msgs;
+    struct rt_spi_message *prev = NULL;
+
+    if (!inst || inst->dev_fd < 0) {
+        printf("[hal_spi]: pls drv_spi_inst_create first\n");
+        ret = -1;
+        goto out;
+    }
+
+    if (!segs || count <= 0) {
+        printf("[hal_spi]: no segments\n");
+        ret = -1;
+        goto out;
+    }
+
+    if (count > SPI_HAL_CHAIN_SEGS) {
+        msgs = hal_slab_buf_alloc(count * sizeof(struct rt_qspi_message));
+        if (!msgs) {
+            printf("[hal_spi]: alloc %d messages fail\n", count);
+            ret = -1;
+            goto out;
+        }
+    }
+
+    if ((ret = drv_spi_bind_config(inst))) {
+        goto out_free;
+    }
+
+    /*
+     * every link is a full qspi message with empty instruction and address
+     * stages, the driver may look at any of them as one
+     */
+    memset(msgs, 0, count * sizeof(struct rt_qspi_message));
+    for (int i = 0; i < count; i++) {
+        struct rt_qspi_message *msg = &msgs[num];
+
+        if (segs[i].len == 0) {
+            /* nothing to shift, its cs release moves to the segment before */
+            if (segs[i].cs_change && prev && inst->cs_status == CS_ACTIVE) {
+                prev->cs_release = 1;
+                inst->cs_status = CS_INACTIVE;
+            }
+            continue;
+        }
+
+        msg->parent.send_buf = segs[i].tx;
+        msg->parent.recv_buf = segs[i].rx;
+        msg->parent.length = segs[i].len;
+        msg->qspi_data_lines = inst->data_line;
+
+        if (inst->cs_pin != -1) {
+            if (inst->cs_status != CS_ACTIVE) {
+                msg->parent.cs_take = 1;
+                inst->cs_status = CS_ACTIVE;
+            }
+            if (segs[i].cs_change) {
+                msg->parent.cs_release = 1;
+                inst->cs_status = CS_INACTIVE;
+            }
+        }
+
+        if (prev) {
+            prev->next = &msg->parent;
+        }
+        prev = &msg->parent;
+        total += segs[i].len;
+        num++;
+    }
+
+    if (num == 0) {
+        printf("[hal_spi]: zero len\n");
+        goto out_free;
+    }
+
+    ret = hal_io_ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_RW, &msgs[0]);
+    if (ret != (int)total) {
+        printf("[hal_spi]: spi transfer segments fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
+        if (ret >= 0) {
+            ret = -1;
+        }
+    }
+
+out_free:
+    if (msgs != stack_msgs) {
+        hal_slab_buf_free(msgs);
+    }
+out:
+    return ret;
+}
+
 int drv_spi_read(drv_spi_inst_t inst, void *rx_data, size_t len, bool cs_change)
 {
+    HAL_TRACE_FUNC();
+
     return drv_spi_transfer(inst, NULL, rx_data, len, cs_change);
 }
 
 int drv_spi_write(drv_spi_inst_t inst, const void *tx_data, size_t len, bool cs_change)
 {
+    HAL_TRACE_FUNC();
+
     return drv_spi_transfer(inst, tx_data, NULL, len, cs_change);
 }
 
 int drv_spi_transfer_message(drv_spi_inst_t inst, struct rt_qspi_message *msg)
 {
+    HAL_TRACE_FUNC();
+
     int ret;
-    int cs_pin;
 
     if (!inst || inst->dev_fd < 0) {
         printf("[hal_spi]: pls drv_spi_inst_create first\n");
@@ -342,36 +486,16 @@ int drv_spi_transfer_message(drv_spi_inst_t inst, struct rt_qspi_message *msg)
         goto out;
     }
 
-    pthread_spin_lock(&lock[inst->spi_id]);
-    cs_pin = inst->cs_pin;
-    if (g_handle_id[inst->spi_id] != inst->handle_id) {
-        struct rt_qspi_configuration spi_config;
-        memset(&spi_config, 0, sizeof(spi_config));
-
-        spi_config.parent.mode = inst->mode;
-        spi_config.parent.data_width = inst->data_bits;
-
-        spi_config.parent.hard_cs = 0;
-        if (cs_pin != -1) {
-            spi_config.parent.soft_cs = cs_pin | 0x80;
-        } else {
-            spi_config.parent.soft_cs = 0;
-        }
-
-        spi_config.parent.max_hz = inst->baudrate;
-        spi_config.qspi_dl_width = inst->data_line;
-
-        if ((ret = ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
-            printf("[hal_spi]: spi config fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
-            pthread_spin_unlock(&lock[inst->spi_id]);
-            goto out;
-        }
-        g_handle_id[inst->spi_id] = inst->handle_id;
+    if ((ret = drv_spi_bind_config(inst))) {
+        goto out;
     }
-    pthread_spin_unlock(&lock[inst->spi_id]);
 
-    msg->qspi_data_lines = inst->data_line;
-    ret = ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_RW, msg);
+    /* a message may narrow its data stage, e.g. single line commands on a quad instance */
+    if ((msg->qspi_data_lines != SPI_HAL_DATA_LINE_1 && msg->qspi_data_lines != SPI_HAL_DATA_LINE_2 &&
+         msg->qspi_data_lines != SPI_HAL_DATA_LINE_4) || msg->qspi_data_lines > inst->data_line) {
+        msg->qspi_data_lines = inst->data_line;
+    }
+    ret = hal_io_ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_RW, msg);
     if (ret != (int)msg->parent.length) {
         printf("[hal_spi]: spi transfer message fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
     }
@@ -404,7 +528,7 @@ static int drv_spi_update_config(drv_spi_inst_t inst)
     spi_config.parent.max_hz = inst->baudrate;
     spi_config.qspi_dl_width = inst->data_line;
 
-    if ((ret = ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
+    if ((ret = hal_io_ioctl(inst->dev_fd, RT_SPI_DEV_CTRL_CONFIG, &spi_config))) {
         printf("[hal_spi]: spi config fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
     }
 
@@ -414,6 +538,8 @@ out:
 
 int drv_spi_set_baudrate(drv_spi_inst_t inst, uint32_t baudrate)
 {
+    HAL_TRACE_FUNC();
+
     int ret = 0;
 
     if (!inst || inst->dev_fd < 0) {
@@ -433,6 +559,8 @@ out:
 
 int drv_spi_set_datamode(drv_spi_inst_t inst, uint8_t mode)
 {
+    HAL_TRACE_FUNC();
+
     int ret = 0;
 
     if (!inst || inst->dev_fd < 0) {
@@ -452,6 +580,8 @@ out:
 
 int drv_spi_set_cs_polarity(drv_spi_inst_t inst, bool is_active_hi)
 {
+    HAL_TRACE_FUNC();
+
     int ret = 0;
 
     if (!inst || inst->dev_fd < 0) {
@@ -479,6 +609,8 @@ out:
 
 int drv_spi_set_cs_mode(drv_spi_inst_t inst, bool use_hw_cs)
 {
+    HAL_TRACE_FUNC();
+
     int ret = 0;
 
     if (!inst || inst->dev_fd < 0) {
@@ -506,6 +638,8 @@ out:
 
 int drv_spi_set_data_bits(drv_spi_inst_t inst, uint8_t data_bits)
 {
+    HAL_TRACE_FUNC();
+
     int ret = 0;
 
     if (!inst || inst->dev_fd < 0) {
@@ -112,6 +112,15 @@ struct rt_qspi_message {
 int drv_spi_inst_create(int spi_id, bool active_low, int mode, uint32_t baudrate,
                         uint8_t data_bits, int cs_pin, uint8_t data_line, drv_spi_inst_t *inst);
 
+/**
+ * @brief Bus of an instance
+ *
+ * @param inst: SPI inst
+ *
+ * @return SPI controller ID, negative on error
+ */
+int drv_spi_get_id(drv_spi_inst_t inst);
+
 /**
  * @brief Destroy SPI HAL instance
  *
@@ -161,12 +170,42 @@ int drv_spi_write(drv_spi_inst_t inst, const void *tx_data, size_t len, bool cs_
  * @brief advance operation for transfer customized qspi message
  *
  * @param inst: SPI inst
- * @param msg: qmsg to transfer
+ * @param msg: qmsg to transfer, qspi_data_lines of 1, 2 or 4 up to the
+ *             data lines of @inst is kept, anything else is replaced by them
  *
  * @return int Number of bytes written, negative on error
  */
 int drv_spi_transfer_message(drv_spi_inst_t inst, struct rt_qspi_message *msg);
 
+/**
+ * One segment of a chained transfer, the arguments of one drv_spi_transfer()
+ * call. @tx or @rx may be NULL.
+ */
+typedef struct {
+    const void *tx;
+    void *rx;
+    size_t len;
+    bool cs_change; /* deselect cs after this segment */
+} drv_spi_seg_t;
+
+/* segments chained on the stack, longer chains are allocated */
+#define SPI_HAL_CHAIN_SEGS 16
+
+/**
+ * @brief Transfer @count segments as one chain of messages in a single
+ *        ioctl, cs is taken and released per segment like a sequence of
+ *        drv_spi_transfer() calls with the same arguments would.
+ *        A command, address and data sequence costs one syscall and one
+ *        configuration check instead of one per segment.
+ *
+ * @param inst: SPI inst
+ * @param segs: segments in bus order, zero length ones are skipped
+ * @param count: number of segments
+ *
+ * @return int Number of bytes transferred, negative on error
+ */
+int drv_spi_transfer_segments(drv_spi_inst_t inst, const drv_spi_seg_t *segs, int count);
+
 /**
  * @brief set spi baudrate(frequency)
  *
@@ -0,0 +1,361 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_spi.h"
+#include "drv_spi_queue.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define SPI_QUEUE_DFT_DEPTH (64)
+#define SPI_QUEUE_MAX_DEPTH (65536)
+
+struct drv_spi_queue {
+    void *base;
+
+    /* submitted transfers, oldest first */
+    drv_spi_xfer_t *head;
+    drv_spi_xfer_t **tail;
+    uint32_t queued;
+    uint32_t active; /* taken by the thread, callbacks not yet run */
+    uint32_t depth;
+
+    drv_spi_seg_t segs[SPI_QUEUE_BATCH_SEGS];
+
+    pthread_mutex_t lock;
+    pthread_cond_t work, space, idle;
+    pthread_t thread;
+    int running;
+
+    uint64_t submitted, completed, errors, ioctls, waits, bytes;
+    uint64_t busy, latency_max, latency_sum, start;
+    uint32_t max_queued;
+};
+
+static const int spi_queue_type;
+static HAL_SLAB_CACHE_DEFINE(spi_queue_cache, "drv_spi_queue", struct drv_spi_queue);
+
+/*
+ * run @first and the transfers behind it that go to the same instance and
+ * fit into one chain, returns the first transfer not run
+ */
+static drv_spi_xfer_t *queue_run_batch(drv_spi_queue_t *q, drv_spi_xfer_t *first)
+{
+    drv_spi_xfer_t *xfer, *end;
+    uint64_t start;
+    int num = 0;
+    int ret;
+
+    if (first->count > SPI_QUEUE_BATCH_SEGS) {
+        end = first->next;
+        start = utils_cpu_ticks();
+        ret = drv_spi_transfer_segments(first->inst, first->segs, first->count);
+    } else {
+        for (end = first; end && end->inst == first->inst && num + end->count <= SPI_QUEUE_BATCH_SEGS;
+             end = end->next) {
+            memcpy(&q->segs[num], end->segs, end->count * sizeof(drv_spi_seg_t));
+            num += end->count;
+        }
+        start = utils_cpu_ticks();
+        ret = drv_spi_transfer_segments(first->inst, q->segs, num);
+    }
+    start = utils_cpu_ticks() - start;
+
+    pthread_mutex_lock(&q->lock);
+    q->busy += start;
+    q->ioctls++;
+    pthread_mutex_unlock(&q->lock);
+
+    /* a failed chain fails every transfer in it */
+    for (xfer = first; xfer != end; xfer = xfer->next) {
+        size_t len = 0;
+
+        for (int i = 0; i < xfer->count; i++) {
+            len += xfer->segs[i].len;
+        }
+        xfer->result = (ret < 0) ? ret : (int)len;
+    }
+
+    return end;
+}
+
+static void *queue_thread(void *args)
+{
+    drv_spi_queue_t *q = (drv_spi_queue_t *)args;
+    drv_spi_xfer_t *list, *xfer, *next;
+    uint64_t now, latency;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->running || q->head) {
+        if (!q->head) {
+            pthread_cond_wait(&q->work, &q->lock);
+            continue;
+        }
+
+        /* take the whole list, submitters refill the queue meanwhile */
+        list = q->head;
+        q->head = NULL;
+        q->tail = &q->head;
+        q->active += q->queued;
+        q->queued = 0;
+        pthread_cond_broadcast(&q->space);
+        pthread_mutex_unlock(&q->lock);
+
+        for (xfer = list; xfer;) {
+            drv_spi_xfer_t *end = queue_run_batch(q, xfer);
+
+            now = utils_cpu_ticks();
+            pthread_mutex_lock(&q->lock);
+            for (next = xfer; next != end; next = next->next) {
+                latency = now - next->ticks;
+                q->completed++;
+                q->errors += (next->result < 0);
+                q->bytes += (next->result < 0) ? 0 : next->result;
+                q->latency_sum += latency;
+                if (q->latency_max < latency) {
+                    q->latency_max = latency;
+                }
+            }
+            pthread_mutex_unlock(&q->lock);
+
+            for (; xfer != end; xfer = next) {
+                /* the callback may reuse the descriptor */
+                next = xfer->next;
+                if (xfer->done) {
+                    xfer->done(xfer, xfer->result);
+                }
+            }
+        }
+
+        pthread_mutex_lock(&q->lock);
+        q->active = 0;
+        pthread_cond_broadcast(&q->idle);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return NULL;
+}
+
+int drv_spi_queue_create(uint32_t depth, drv_spi_queue_t **queue)
+{
+    HAL_TRACE_FUNC();
+
+    pthread_condattr_t attr;
+    drv_spi_queue_t *q;
+
+    if (queue == NULL || depth > SPI_QUEUE_MAX_DEPTH) {
+        printf("[hal_spi]: invalid queue parameters\n");
+        return -1;
+    }
+
+    q = hal_slab_zalloc(&spi_queue_cache);
+    if (q == NULL) {
+        printf("[hal_spi]: alloc queue fail\n");
+        return -3;
+    }
+    q->base = (void *)&spi_queue_type;
+    q->tail = &q->head;
+    q->depth = depth ? depth : SPI_QUEUE_DFT_DEPTH;
+    q->start = utils_cpu_ticks();
+
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->work, &attr);
+    pthread_cond_init(&q->space, &attr);
+    pthread_cond_init(&q->idle, &attr);
+    pthread_condattr_destroy(&attr);
+
+    q->running = 1;
+    if (pthread_create(&q->thread, NULL, queue_thread, q) != 0) {
+        printf("[hal_spi]: create queue thread fail\n");
+        pthread_cond_destroy(&q->work);
+        pthread_cond_destroy(&q->space);
+        pthread_cond_destroy(&q->idle);
+        pthread_mutex_destroy(&q->lock);
+        hal_slab_free(&spi_queue_cache, q);
+        return -4;
+    }
+
+    *queue = q;
+
+    return 0;
+}
+
+void drv_spi_queue_destroy(drv_spi_queue_t **queue)
+{
+    HAL_TRACE_FUNC();
+
+    drv_spi_queue_t *q;
+
+    if (queue == NULL || *queue == NULL) {
+        return;
+    }
+    q = *queue;
+
+    if ((void *)&spi_queue_type != q->base) {
+        printf("[hal_spi]: inst not spi queue\n");
+        return;
+    }
+
+    /* the thread runs the queue empty before it leaves */
+    pthread_mutex_lock(&q->lock);
+    q->running = 0;
+    pthread_cond_signal(&q->work);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+
+    pthread_cond_destroy(&q->work);
+    pthread_cond_destroy(&q->space);
+    pthread_cond_destroy(&q->idle);
+    pthread_mutex_destroy(&q->lock);
+    q->base = NULL;
+
+    hal_slab_free(&spi_queue_cache, q);
+    *queue = NULL;
+}
+
+int drv_spi_queue_submit(drv_spi_queue_t *queue, drv_spi_xfer_t *xfer, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_spi_queue_t *q = queue;
+    struct timespec deadline;
+    int waited = 0;
+
+    if (q == NULL || (void *)&spi_queue_type != q->base || xfer == NULL || xfer->inst == NULL ||
+        xfer->segs == NULL || xfer->count <= 0) {
+        return -1;
+    }
+
+    if (timeout_ms >= 0) {
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->running && q->queued >= q->depth) {
+        waited = (timeout_ms != 0);
+        if (utils_cond_wait(&q->space, &q->lock, (timeout_ms < 0) ? NULL : &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    q->waits += waited;
+
+    if (!q->running || q->queued >= q->depth) {
+        pthread_mutex_unlock(&q->lock);
+        return q->running ? -2 : -1;
+    }
+
+    xfer->result = 0;
+    xfer->ticks = utils_cpu_ticks();
+    xfer->next = NULL;
+    *q->tail = xfer;
+    q->tail = &xfer->next;
+    if (q->queued++ == 0) {
+        pthread_cond_signal(&q->work);
+    }
+    q->submitted++;
+    if (q->max_queued < q->queued) {
+        q->max_queued = q->queued;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return 0;
+}
+
+int drv_spi_queue_flush(drv_spi_queue_t *queue, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_spi_queue_t *q = queue;
+    struct timespec deadline;
+    int ret = 0;
+
+    if (q == NULL || (void *)&spi_queue_type != q->base) {
+        return -1;
+    }
+
+    if (timeout_ms >= 0) {
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->queued || q->active) {
+        if (utils_cond_wait(&q->idle, &q->lock, (timeout_ms < 0) ? NULL : &deadline) == ETIMEDOUT) {
+            ret = (q->queued || q->active) ? -1 : 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return ret;
+}
+
+int drv_spi_queue_get_stats(drv_spi_queue_t *queue, spi_queue_stats_t *stats)
+{
+    uint64_t elapsed;
+
+    if (queue == NULL || (void *)&spi_queue_type != queue->base || stats == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    elapsed = utils_cpu_ticks() - queue->start;
+
+    stats->submitted = queue->submitted;
+    stats->completed = queue->completed;
+    stats->errors = queue->errors;
+    stats->ioctls = queue->ioctls;
+    stats->waits = queue->waits;
+    stats->bytes = queue->bytes;
+    stats->xfer_per_sec = elapsed ? (queue->completed * CPU_TICKS_PER_SECOND / elapsed) : 0;
+    stats->busy_ns = utils_cpu_ticks_to_ns(queue->busy);
+    stats->latency_ns_max = utils_cpu_ticks_to_ns(queue->latency_max);
+    stats->latency_ns_mean = queue->completed ? utils_cpu_ticks_to_ns(queue->latency_sum / queue->completed) : 0;
+    stats->max_queued = queue->max_queued;
+    pthread_mutex_unlock(&queue->lock);
+
+    return 0;
+}
+
+void drv_spi_queue_reset_stats(drv_spi_queue_t *queue)
+{
+    if (queue == NULL || (void *)&spi_queue_type != queue->base) {
+        return;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    queue->submitted = queue->completed = queue->errors = queue->ioctls = queue->waits = queue->bytes = 0;
+    queue->busy = queue->latency_max = queue->latency_sum = 0;
+    queue->max_queued = queue->queued;
+    queue->start = utils_cpu_ticks();
+    pthread_mutex_unlock(&queue->lock);
+}
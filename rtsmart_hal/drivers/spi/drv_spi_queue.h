@@ -0,0 +1,126 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "drv_spi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct drv_spi_queue drv_spi_queue_t;
+typedef struct drv_spi_xfer drv_spi_xfer_t;
+
+/**
+ * @brief Completion callback, runs on the queue thread.
+ *
+ * @param xfer: the finished transfer, the caller owns it again
+ * @param result: bytes transferred, negative on error
+ */
+typedef void (*drv_spi_xfer_cb_t)(drv_spi_xfer_t *xfer, int result);
+
+/**
+ * A queued transfer. The descriptor and its segments belong to the queue
+ * from drv_spi_queue_submit() until the callback runs, they are not copied.
+ */
+struct drv_spi_xfer {
+    drv_spi_inst_t inst;
+    const drv_spi_seg_t *segs;
+    int count;
+    drv_spi_xfer_cb_t done; /* NULL for none */
+    void *user;
+
+    /* owned by the queue */
+    int result;
+    uint64_t ticks;
+    drv_spi_xfer_t *next;
+};
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t errors; /* transfers completed with a negative result */
+    uint64_t ioctls; /* chains handed to the driver */
+    uint64_t waits; /* submits that waited for room */
+    uint64_t bytes;
+    uint64_t xfer_per_sec; /* since create or reset */
+    uint64_t busy_ns; /* time spent in the driver */
+    uint64_t latency_ns_max; /* submit to completion */
+    uint64_t latency_ns_mean;
+    uint32_t max_queued;
+} spi_queue_stats_t;
+
+/* segments of consecutive transfers to one instance merged into one chain */
+#define SPI_QUEUE_BATCH_SEGS 64
+
+/**
+ * @brief Create a submission queue served by its own thread. Transfers run
+ *        in submission order. Consecutive ones for the same instance are
+ *        chained into one drv_spi_transfer_segments() call, so a display or
+ *        flash writer that keeps the queue filled keeps the bus busy. The
+ *        queue may mix instances of several buses.
+ *
+ * @param depth: transfers waiting besides the chain running, 0 for 64
+ * @param queue: the new queue
+ *
+ * @return 0 on success, negative on error:
+ *         -1: Invalid parameters
+ *         -3: Memory allocation failed
+ *         -4: Queue thread creation failed
+ */
+int drv_spi_queue_create(uint32_t depth, drv_spi_queue_t **queue);
+
+/**
+ * @brief Run what is queued, then stop the queue thread and free the queue.
+ */
+void drv_spi_queue_destroy(drv_spi_queue_t **queue);
+
+/**
+ * @brief Queue @xfer, waiting at most @timeout_ms (-1 forever, 0 not at all)
+ *        for room. A callback may submit again, with timeout 0 as a full
+ *        queue would wait on its own thread.
+ *
+ * @return 0 on success, -1 on invalid parameters, -2 on timeout
+ */
+int drv_spi_queue_submit(drv_spi_queue_t *queue, drv_spi_xfer_t *xfer, int timeout_ms);
+
+/**
+ * @brief Wait at most @timeout_ms for every submitted transfer to complete,
+ *        callbacks included. Not from a callback.
+ *
+ * @return 0 once idle, -1 on timeout or error
+ */
+int drv_spi_queue_flush(drv_spi_queue_t *queue, int timeout_ms);
+
+int drv_spi_queue_get_stats(drv_spi_queue_t *queue, spi_queue_stats_t *stats);
+void drv_spi_queue_reset_stats(drv_spi_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
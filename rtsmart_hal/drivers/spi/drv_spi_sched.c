@@ -0,0 +1,504 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_spi.h"
+#include "drv_spi_queue.h"
+#include "drv_spi_sched.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define SPI_SCHED_DFT_DEPTH (64)
+#define SPI_SCHED_MAX_DEPTH (65536)
+#define SPI_SCHED_DFT_BURST (8)
+
+struct spi_sched_level {
+    /* waiting transfers, oldest first */
+    drv_spi_xfer_t *head;
+    drv_spi_xfer_t **tail;
+    uint32_t queued;
+    uint64_t max_wait; /* ticks, 0 never promoted */
+
+    uint64_t submitted, completed, wait_max, wait_sum;
+};
+
+struct drv_spi_sched {
+    void *base;
+    int spi_id;
+
+    struct spi_sched_level level[SPI_SCHED_PRIO_NUM];
+    uint32_t depth;
+    uint32_t max_burst;
+    uint32_t queued;
+    uint32_t active; /* taken by the thread, callbacks not yet run */
+
+    /* the chain that ran last */
+    drv_spi_inst_t last;
+    uint32_t burst;
+    int frame_open; /* it left cs selected */
+
+    drv_spi_seg_t segs[SPI_QUEUE_BATCH_SEGS];
+
+    pthread_mutex_t lock;
+    pthread_cond_t work, space, idle;
+    pthread_t thread;
+    int running;
+
+    uint64_t submitted, completed, errors, chains, switches, promotions, waits;
+    uint64_t busy, start;
+    uint32_t max_queued;
+};
+
+static const int spi_sched_type;
+static HAL_SLAB_CACHE_DEFINE(spi_sched_cache, "drv_spi_sched", struct drv_spi_sched);
+
+/* link to the oldest transfer of @inst at @l, NULL if it has none waiting */
+static drv_spi_xfer_t **sched_find(struct spi_sched_level *l, drv_spi_inst_t inst)
+{
+    drv_spi_xfer_t **link;
+
+    for (link = &l->head; *link; link = &(*link)->next) {
+        if ((*link)->inst == inst) {
+            return link;
+        }
+    }
+
+    return NULL;
+}
+
+static drv_spi_xfer_t *sched_unlink(struct spi_sched_level *l, drv_spi_xfer_t **link)
+{
+    drv_spi_xfer_t *xfer = *link;
+
+    *link = xfer->next;
+    if (l->tail == &xfer->next) {
+        l->tail = link;
+    }
+    l->queued--;
+
+    return xfer;
+}
+
+/* whether @xfer leaves cs selected, its last non empty segment keeps it */
+static int sched_leaves_frame_open(const drv_spi_xfer_t *xfer)
+{
+    for (int i = xfer->count - 1; i >= 0; i--) {
+        if (xfer->segs[i].len) {
+            return !xfer->segs[i].cs_change;
+        }
+    }
+
+    return 0;
+}
+
+/* choose the transfer to run next, NULL if an open frame waits for its end */
+static drv_spi_xfer_t **sched_pick(drv_spi_sched_t *s, int *prio)
+{
+    drv_spi_xfer_t **link, **best = NULL;
+    uint64_t now;
+    int top = -1;
+
+    if (s->frame_open && s->running) {
+        for (int p = 0; p < SPI_SCHED_PRIO_NUM; p++) {
+            link = sched_find(&s->level[p], s->last);
+            if (link && (!best || (*link)->ticks < (*best)->ticks)) {
+                best = link;
+                *prio = p;
+            }
+        }
+        return best;
+    }
+
+    now = utils_cpu_ticks();
+    for (int p = 0; p < SPI_SCHED_PRIO_NUM; p++) {
+        struct spi_sched_level *l = &s->level[p];
+
+        if (!l->head) {
+            continue;
+        }
+        if (top < 0) {
+            top = p;
+        }
+        if (l->max_wait && now - l->head->ticks > l->max_wait) {
+            s->promotions += (p != top);
+            *prio = p;
+            return &l->head;
+        }
+    }
+
+    *prio = top;
+    if (s->last && s->burst < s->max_burst && (link = sched_find(&s->level[top], s->last))) {
+        return link;
+    }
+
+    return &s->level[top].head;
+}
+
+/*
+ * take the transfer at @link and the ones of its instance behind it that fit
+ * into one chain, linked through next, @num returns their segments
+ */
+static drv_spi_xfer_t *sched_take(drv_spi_sched_t *s, int prio, drv_spi_xfer_t **link, int *num)
+{
+    struct spi_sched_level *l = &s->level[prio];
+    drv_spi_xfer_t *first = sched_unlink(l, link);
+    drv_spi_xfer_t *last = first;
+
+    *num = first->count;
+    if (first->count <= SPI_QUEUE_BATCH_SEGS) {
+        memcpy(s->segs, first->segs, first->count * sizeof(drv_spi_seg_t));
+
+        /* an open frame ends the chain, its end may come from another priority */
+        while (*link && !sched_leaves_frame_open(last)) {
+            if ((*link)->inst != first->inst) {
+                link = &(*link)->next;
+                continue;
+            }
+            if (*num + (*link)->count > SPI_QUEUE_BATCH_SEGS) {
+                break;
+            }
+            last->next = sched_unlink(l, link);
+            last = last->next;
+            memcpy(&s->segs[*num], last->segs, last->count * sizeof(drv_spi_seg_t));
+            *num += last->count;
+        }
+    }
+    last->next = NULL;
+    s->frame_open = sched_leaves_frame_open(last);
+
+    return first;
+}
+
+static void *sched_thread(void *args)
+{
+    drv_spi_sched_t *s = (drv_spi_sched_t *)args;
+    drv_spi_xfer_t **link, *batch, *xfer, *next;
+    struct spi_sched_level *l;
+    uint64_t start, end, wait;
+    int prio, num, taken, ret;
+
+    pthread_mutex_lock(&s->lock);
+    while (s->running || s->queued) {
+        link = s->queued ? sched_pick(s, &prio) : NULL;
+        if (!link) {
+            pthread_cond_wait(&s->work, &s->lock);
+            continue;
+        }
+
+        l = &s->level[prio];
+        taken = l->queued;
+        batch = sched_take(s, prio, link, &num);
+        taken -= l->queued;
+        s->queued -= taken;
+        s->active += taken;
+        pthread_cond_broadcast(&s->space);
+
+        s->switches += (batch->inst != s->last);
+        s->burst = (batch->inst == s->last) ? s->burst + 1 : 1;
+        s->last = batch->inst;
+        pthread_mutex_unlock(&s->lock);
+
+        start = utils_cpu_ticks();
+        if (batch->count > SPI_QUEUE_BATCH_SEGS) {
+            ret = drv_spi_transfer_segments(batch->inst, batch->segs, batch->count);
+        } else {
+            ret = drv_spi_transfer_segments(batch->inst, s->segs, num);
+        }
+        end = utils_cpu_ticks();
+
+        /* a failed chain fails every transfer in it */
+        pthread_mutex_lock(&s->lock);
+        s->chains++;
+        s->busy += end - start;
+        for (xfer = batch; xfer; xfer = xfer->next) {
+            size_t len = 0;
+
+            for (int i = 0; i < xfer->count; i++) {
+                len += xfer->segs[i].len;
+            }
+            xfer->result = (ret < 0) ? ret : (int)len;
+
+            wait = start - xfer->ticks;
+            l->completed++;
+            l->wait_sum += wait;
+            if (l->wait_max < wait) {
+                l->wait_max = wait;
+            }
+            s->completed++;
+            s->errors += (ret < 0);
+        }
+        pthread_mutex_unlock(&s->lock);
+
+        for (xfer = batch; xfer; xfer = next) {
+            /* the callback may reuse the descriptor */
+            next = xfer->next;
+            if (xfer->done) {
+                xfer->done(xfer, xfer->result);
+            }
+        }
+
+        pthread_mutex_lock(&s->lock);
+        s->active -= taken;
+        if (!s->queued && !s->active) {
+            pthread_cond_broadcast(&s->idle);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+int drv_spi_sched_create(int spi_id, const struct spi_sched_config *cfg, drv_spi_sched_t **sched)
+{
+    HAL_TRACE_FUNC();
+
+    pthread_condattr_t attr;
+    drv_spi_sched_t *s;
+
+    if (spi_id < 0 || spi_id >= SPI_HAL_MAX_DEVICES || sched == NULL ||
+        (cfg && cfg->depth > SPI_SCHED_MAX_DEPTH)) {
+        printf("[hal_spi]: invalid scheduler parameters\n");
+        return -1;
+    }
+
+    s = hal_slab_zalloc(&spi_sched_cache);
+    if (s == NULL) {
+        printf("[hal_spi]: alloc scheduler fail\n");
+        return -3;
+    }
+    s->base = (void *)&spi_sched_type;
+    s->spi_id = spi_id;
+    s->depth = (cfg && cfg->depth) ? cfg->depth : SPI_SCHED_DFT_DEPTH;
+    s->max_burst = (cfg && cfg->max_burst) ? cfg->max_burst : SPI_SCHED_DFT_BURST;
+    for (int p = 0; p < SPI_SCHED_PRIO_NUM; p++) {
+        s->level[p].tail = &s->level[p].head;
+        s->level[p].max_wait = cfg ? (uint64_t)cfg->max_wait_us[p] * CPU_TICKS_PER_SECOND / 1000000 : 0;
+    }
+    s->start = utils_cpu_ticks();
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->work, &attr);
+    pthread_cond_init(&s->space, &attr);
+    pthread_cond_init(&s->idle, &attr);
+    pthread_condattr_destroy(&attr);
+
+    s->running = 1;
+    if (pthread_create(&s->thread, NULL, sched_thread, s) != 0) {
+        printf("[hal_spi]: create scheduler thread fail\n");
+        pthread_cond_destroy(&s->work);
+        pthread_cond_destroy(&s->space);
+        pthread_cond_destroy(&s->idle);
+        pthread_mutex_destroy(&s->lock);
+        hal_slab_free(&spi_sched_cache, s);
+        return -4;
+    }
+
+    *sched = s;
+
+    return 0;
+}
+
+void drv_spi_sched_destroy(drv_spi_sched_t **sched)
+{
+    HAL_TRACE_FUNC();
+
+    drv_spi_sched_t *s;
+
+    if (sched == NULL || *sched == NULL) {
+        return;
+    }
+    s = *sched;
+
+    if ((void *)&spi_sched_type != s->base) {
+        printf("[hal_spi]: inst not spi scheduler\n");
+        return;
+    }
+
+    /* the thread runs the queue empty before it leaves, open frames or not */
+    pthread_mutex_lock(&s->lock);
+    s->running = 0;
+    pthread_cond_signal(&s->work);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+
+    pthread_cond_destroy(&s->work);
+    pthread_cond_destroy(&s->space);
+    pthread_cond_destroy(&s->idle);
+    pthread_mutex_destroy(&s->lock);
+    s->base = NULL;
+
+    hal_slab_free(&spi_sched_cache, s);
+    *sched = NULL;
+}
+
+int drv_spi_sched_submit(drv_spi_sched_t *sched, drv_spi_xfer_t *xfer, int prio, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_spi_sched_t *s = sched;
+    struct spi_sched_level *l;
+    struct timespec deadline;
+    int waited = 0;
+
+    if (s == NULL || (void *)&spi_sched_type != s->base || xfer == NULL || xfer->segs == NULL ||
+        xfer->count <= 0 || prio < 0 || prio >= SPI_SCHED_PRIO_NUM) {
+        return -1;
+    }
+
+    if (drv_spi_get_id(xfer->inst) != s->spi_id) {
+        printf("[hal_spi]: transfer not for spi%d\n", s->spi_id);
+        return -1;
+    }
+    l = &s->level[prio];
+
+    if (timeout_ms >= 0) {
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (s->running && l->queued >= s->depth) {
+        waited = (timeout_ms != 0);
+        if (utils_cond_wait(&s->space, &s->lock, (timeout_ms < 0) ? NULL : &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    s->waits += waited;
+
+    if (!s->running || l->queued >= s->depth) {
+        pthread_mutex_unlock(&s->lock);
+        return s->running ? -2 : -1;
+    }
+
+    xfer->result = 0;
+    xfer->ticks = utils_cpu_ticks();
+    xfer->next = NULL;
+    *l->tail = xfer;
+    l->tail = &xfer->next;
+    l->queued++;
+    l->submitted++;
+    s->submitted++;
+    if (s->queued++ == 0) {
+        pthread_cond_signal(&s->work);
+    } else if (s->frame_open && xfer->inst == s->last) {
+        /* the end of the frame the thread waits for */
+        pthread_cond_signal(&s->work);
+    }
+    if (s->max_queued < s->queued) {
+        s->max_queued = s->queued;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int drv_spi_sched_flush(drv_spi_sched_t *sched, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_spi_sched_t *s = sched;
+    struct timespec deadline;
+    int ret = 0;
+
+    if (s == NULL || (void *)&spi_sched_type != s->base) {
+        return -1;
+    }
+
+    if (timeout_ms >= 0) {
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (s->queued || s->active) {
+        if (utils_cond_wait(&s->idle, &s->lock, (timeout_ms < 0) ? NULL : &deadline) == ETIMEDOUT) {
+            ret = (s->queued || s->active) ? -1 : 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ret;
+}
+
+int drv_spi_sched_get_stats(drv_spi_sched_t *sched, spi_sched_stats_t *stats)
+{
+    uint64_t elapsed;
+
+    if (sched == NULL || (void *)&spi_sched_type != sched->base || stats == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sched->lock);
+    elapsed = utils_cpu_ticks() - sched->start;
+
+    stats->submitted = sched->submitted;
+    stats->completed = sched->completed;
+    stats->errors = sched->errors;
+    stats->chains = sched->chains;
+    stats->config_switches = sched->switches;
+    stats->promotions = sched->promotions;
+    stats->waits = sched->waits;
+    stats->busy_ns = utils_cpu_ticks_to_ns(sched->busy);
+    stats->util_permille = elapsed ? (uint32_t)(sched->busy * 1000 / elapsed) : 0;
+    stats->queued = sched->queued;
+    stats->max_queued = sched->max_queued;
+
+    for (int p = 0; p < SPI_SCHED_PRIO_NUM; p++) {
+        struct spi_sched_level *l = &sched->level[p];
+
+        stats->prio[p].submitted = l->submitted;
+        stats->prio[p].completed = l->completed;
+        stats->prio[p].wait_ns_max = utils_cpu_ticks_to_ns(l->wait_max);
+        stats->prio[p].wait_ns_mean = l->completed ? utils_cpu_ticks_to_ns(l->wait_sum / l->completed) : 0;
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return 0;
+}
+
+void drv_spi_sched_reset_stats(drv_spi_sched_t *sched)
+{
+    if (sched == NULL || (void *)&spi_sched_type != sched->base) {
+        return;
+    }
+
+    pthread_mutex_lock(&sched->lock);
+    sched->submitted = sched->completed = sched->errors = sched->chains = 0;
+    sched->switches = sched->promotions = sched->waits = sched->busy = 0;
+    for (int p = 0; p < SPI_SCHED_PRIO_NUM; p++) {
+        sched->level[p].submitted = sched->level[p].completed = 0;
+        sched->level[p].wait_max = sched->level[p].wait_sum = 0;
+    }
+    sched->max_queued = sched->queued;
+    sched->start = utils_cpu_ticks();
+    pthread_mutex_unlock(&sched->lock);
+}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "drv_spi.h"
+#include "drv_spi_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* priority levels, 0 is the most urgent */
+#define SPI_SCHED_PRIO_NUM 4
+
+typedef struct drv_spi_sched drv_spi_sched_t;
+
+struct spi_sched_config {
+    uint32_t depth; /* waiting transfers per priority before submitters wait, 0: 64 */
+    uint32_t max_burst; /* chains in a row for one instance while others of its priority wait, 0: 8 */
+    uint32_t max_wait_us[SPI_SCHED_PRIO_NUM]; /* run a transfer that waited this long next, 0: never */
+};
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t wait_ns_max; /* submit to the start of its chain */
+    uint64_t wait_ns_mean;
+} spi_sched_prio_stats_t;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t errors; /* transfers completed with a negative result */
+    uint64_t chains; /* drv_spi_transfer_segments() calls */
+    uint64_t config_switches; /* chains for another instance than the chain before */
+    uint64_t promotions; /* transfers run ahead of higher priorities after max_wait_us */
+    uint64_t waits; /* submits that waited for room */
+    uint64_t busy_ns; /* time the bus spent in chains */
+    uint32_t util_permille; /* busy time per elapsed time since create or reset */
+    uint32_t queued; /* waiting now */
+    uint32_t max_queued;
+    spi_sched_prio_stats_t prio[SPI_SCHED_PRIO_NUM];
+} spi_sched_stats_t;
+
+/**
+ * @brief Create the scheduler of bus @spi_id. Transfers of the instances on
+ *        that bus are submitted with a priority and run on the scheduler
+ *        thread:
+ *         - the most urgent priority with work goes first, a running chain
+ *           is not preempted, so priority 0 waits at most for one chain
+ *         - within a priority the instance the controller is configured for
+ *           keeps the bus for up to max_burst chains, then the oldest
+ *           transfer goes, so few RT_SPI_DEV_CTRL_CONFIG switches are needed
+ *         - a transfer waiting past max_wait_us of its priority runs next,
+ *           lower priorities are delayed but not starved
+ *         - a transfer that ends with cs selected keeps the bus for its
+ *           instance until the transfer that ends the frame
+ *        Transfers of one instance and priority keep their order, transfers
+ *        of other instances may be moved around them.
+ *
+ * @param spi_id: SPI controller ID (0-2)
+ * @param cfg: scheduling parameters, NULL for the defaults
+ * @param sched: the new scheduler
+ *
+ * @return 0 on success, negative on error:
+ *         -1: Invalid parameters
+ *         -3: Memory allocation failed
+ *         -4: Scheduler thread creation failed
+ */
+int drv_spi_sched_create(int spi_id, const struct spi_sched_config *cfg, drv_spi_sched_t **sched);
+
+/**
+ * @brief Run what is queued, then stop the scheduler thread and free it.
+ */
+void drv_spi_sched_destroy(drv_spi_sched_t **sched);
+
+/**
+ * @brief Queue @xfer at @prio, waiting at most @timeout_ms (-1 forever,
+ *        0 not at all) for room at that priority. The descriptor belongs to
+ *        the scheduler until its callback runs, on the scheduler thread.
+ *        A callback may submit again with timeout 0.
+ *
+ * @return 0 on success, -1 on invalid parameters or an instance of another
+ *         bus, -2 on timeout
+ */
+int drv_spi_sched_submit(drv_spi_sched_t *sched, drv_spi_xfer_t *xfer, int prio, int timeout_ms);
+
+/**
+ * @brief Wait at most @timeout_ms for every submitted transfer to complete,
+ *        callbacks included. Not from a callback.
+ *
+ * @return 0 once idle, -1 on timeout or error
+ */
+int drv_spi_sched_flush(drv_spi_sched_t *sched, int timeout_ms);
+
+int drv_spi_sched_get_stats(drv_spi_sched_t *sched, spi_sched_stats_t *stats);
+void drv_spi_sched_reset_stats(drv_spi_sched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
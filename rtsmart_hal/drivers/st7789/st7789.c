@@ -0,0 +1,781 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_gpio.h"
+#include "drv_spi.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "st7789.h"
+
+#define CMD_SWRESET 0x01
+#define CMD_CASET 0x2A
+#define CMD_RASET 0x2B
+#define CMD_RAMWR 0x2C
+#define CMD_MADCTL 0x36
+
+#define MADCTL_MY (1 << 7)
+#define MADCTL_MX (1 << 6)
+#define MADCTL_MV (1 << 5)
+#define MADCTL_BGR (1 << 3)
+
+/* controller RAM is 240 x 320 */
+#define LCD_MAX_SIDE 320
+
+/*
+ * what one more window costs on the bus in pixels: three commands, two
+ * parameter writes and their dc toggles. Two windows closer than that are
+ * cheaper sent as their bounding box.
+ */
+#define WINDOW_COST 128
+
+struct st7789_rect {
+    int x, y, w, h;
+};
+
+struct st7789 {
+    void *base;
+    drv_spi_inst_t spi;
+    drv_gpio_inst_t *dc;
+    drv_gpio_inst_t *rst;
+    drv_gpio_inst_t *bl;
+
+    int width, height;
+    size_t stride; /* bytes per framebuffer row */
+    uint8_t madctl;
+
+    /* RGB565 high byte first, sent as they are */
+    uint8_t *fb[2];
+    int draw; /* framebuffer drawn into */
+    struct st7789_rect dirty[ST7789_MAX_DIRTY];
+    int num_dirty;
+
+    /* frame handed to the sending thread */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int running;
+    int tx_pending;
+    int tx_result;
+    const uint8_t *tx_fb;
+    struct st7789_rect tx_rects[ST7789_MAX_DIRTY];
+    int tx_num;
+
+    st7789_stats_t stats;
+};
+
+static const int st7789_type;
+static HAL_SLAB_CACHE_DEFINE(st7789_cache, "st7789", struct st7789);
+
+/* command, parameter count, parameters; 0x00 and a count of ms is a delay */
+static const uint8_t init_seq[] = {
+    0x11, 0, /* sleep out */
+    0x00, 5,
+    0x11, 0, /* sleep out, sent twice */
+    0x00, 30,
+    0x3A, 1, 0x65, /* RGB565 */
+    0xB2, 5, 0x0C, 0x0C, 0x00, 0x33, 0x33, /* porch */
+    0xB7, 1, 0x75, /* gate */
+    0xBB, 1, 0x1A, /* VCOM */
+    0xC0, 1, 0x2C, /* LCM */
+    0xC2, 1, 0x01, /* VDV and VRH enable */
+    0xC3, 1, 0x13, /* VRH */
+    0xC4, 1, 0x20, /* VDV */
+    0xC6, 1, 0x0F, /* 60 Hz */
+    0xD0, 2, 0xA4, 0xA1, /* power control 1 */
+    0xD6, 1, 0xA1, /* power control 2 */
+    0xE0, 14, 0xD0, 0x0D, 0x14, 0x0D, 0x0D, 0x09, 0x38, 0x44, 0x4E, 0x3A, 0x17, 0x18, 0x2F, 0x30,
+    0xE1, 14, 0xD0, 0x09, 0x0F, 0x08, 0x07, 0x14, 0x37, 0x44, 0x4D, 0x38, 0x15, 0x16, 0x2C, 0x2E,
+    0x20, 0, /* inversion off */
+    0x29, 0, /* display on */
+};
+
+static uint64_t lcd_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * conversion, in byte lanes so no pixel is widened: the high byte is red and
+ * the top of green, the low byte the rest of green and blue. Both targets are
+ * little endian, the first byte of a pixel goes to the low bits.
+ */
+static inline uint64_t be565(const uint8_t *px, int bgr)
+{
+    uint8_t r = px[bgr ? 2 : 0], g = px[1], b = px[bgr ? 0 : 2];
+
+    return ((r & 0xF8) | (g >> 5)) | ((uint64_t)(((g << 3) & 0xE0) | (b >> 3)) << 8);
+}
+
+static void convert_888(uint8_t *restrict dst, const uint8_t *restrict src, size_t pixels, int bgr)
+{
+    uint64_t out;
+
+    /* four pixels per step, stored as one word */
+    for (; pixels >= 4; pixels -= 4, src += 12, dst += 8) {
+        out = be565(src, bgr) | (be565(src + 3, bgr) << 16) | (be565(src + 6, bgr) << 32) |
+              (be565(src + 9, bgr) << 48);
+        memcpy(dst, &out, sizeof(out));
+    }
+    for (; pixels; pixels--, src += 3, dst += 2) {
+        out = be565(src, bgr);
+        dst[0] = out;
+        dst[1] = out >> 8;
+    }
+}
+
+static void convert_565(uint8_t *dst, const uint8_t *src, size_t pixels)
+{
+    uint64_t w;
+
+    for (; pixels >= 4; pixels -= 4, src += 8, dst += 8) {
+        memcpy(&w, src, sizeof(w));
+        w = ((w & 0x00FF00FF00FF00FFULL) << 8) | ((w >> 8) & 0x00FF00FF00FF00FFULL);
+        memcpy(dst, &w, sizeof(w));
+    }
+    for (; pixels; pixels--, src += 2, dst += 2) {
+        dst[0] = src[1];
+        dst[1] = src[0];
+    }
+}
+
+void st7789_convert(uint8_t *dst, const void *src, size_t pixels, st7789_pixel_fmt_t fmt)
+{
+    if (!dst || !src) {
+        return;
+    }
+
+    if (fmt == ST7789_PIXEL_RGB888) {
+        convert_888(dst, src, pixels, 0);
+    } else if (fmt == ST7789_PIXEL_BGR888) {
+        convert_888(dst, src, pixels, 1);
+    } else {
+        convert_565(dst, src, pixels);
+    }
+}
+
+/* bus, called by one thread at a time */
+static int lcd_write(st7789_t *lcd, int dc, const void *data, size_t len, int keep_cs)
+{
+    drv_gpio_value_set(lcd->dc, dc ? GPIO_PV_HIGH : GPIO_PV_LOW);
+
+    return (drv_spi_write(lcd->spi, data, len, !keep_cs) == (int)len) ? 0 : -2;
+}
+
+static int lcd_cmd(st7789_t *lcd, uint8_t cmd, const uint8_t *data, size_t len, int keep_cs)
+{
+    int ret = lcd_write(lcd, 0, &cmd, 1, len || keep_cs);
+
+    if (!ret && len) {
+        ret = lcd_write(lcd, 1, data, len, keep_cs);
+    }
+
+    return ret;
+}
+
+static int lcd_cmd_seq(st7789_t *lcd, const uint8_t *seq, size_t size)
+{
+    const uint8_t *end = seq + size;
+
+    while (seq < end) {
+        if (seq[0] == 0x00) {
+            usleep(seq[1] * 1000);
+            seq += 2;
+            continue;
+        }
+        if (lcd_cmd(lcd, seq[0], &seq[2], seq[1], 0)) {
+            return -2;
+        }
+        seq += 2 + seq[1];
+    }
+
+    return 0;
+}
+
+/* one window: CASET, RASET, RAMWR, then its rows chained in one cs frame */
+static int lcd_window(st7789_t *lcd, const uint8_t *fb, const struct st7789_rect *r)
+{
+    drv_spi_seg_t segs[SPI_HAL_CHAIN_SEGS];
+    uint8_t caset[4] = { r->x >> 8, r->x, (r->x + r->w - 1) >> 8, r->x + r->w - 1 };
+    uint8_t raset[4] = { r->y >> 8, r->y, (r->y + r->h - 1) >> 8, r->y + r->h - 1 };
+    const uint8_t *row = fb + r->y * lcd->stride + r->x * 2;
+    size_t len = r->w * 2;
+    int rows = r->h, num;
+
+    if (lcd_cmd(lcd, CMD_CASET, caset, sizeof(caset), 0) || lcd_cmd(lcd, CMD_RASET, raset, sizeof(raset), 0) ||
+        lcd_cmd(lcd, CMD_RAMWR, NULL, 0, 1)) {
+        return -2;
+    }
+    drv_gpio_value_set(lcd->dc, GPIO_PV_HIGH);
+
+    /* full width rows are one block */
+    if (r->w == lcd->width) {
+        len *= rows;
+        rows = 1;
+    }
+
+    while (rows) {
+        for (num = 0; num < SPI_HAL_CHAIN_SEGS && rows; num++, rows--, row += lcd->stride) {
+            segs[num].tx = row;
+            segs[num].rx = NULL;
+            segs[num].len = len;
+            segs[num].cs_change = (rows == 1);
+        }
+        if (drv_spi_transfer_segments(lcd->spi, segs, num) != (int)(len * num)) {
+            return -2;
+        }
+    }
+
+    return 0;
+}
+
+static int lcd_send(st7789_t *lcd, const uint8_t *fb, const struct st7789_rect *rects, int num)
+{
+    uint64_t start = lcd_now_ns();
+    uint64_t pixels = 0;
+    int ret = 0;
+
+    for (int i = 0; i < num && !ret; i++) {
+        ret = lcd_window(lcd, fb, &rects[i]);
+        pixels += rects[i].w * rects[i].h;
+    }
+
+    pthread_mutex_lock(&lcd->lock);
+    lcd->stats.frames++;
+    lcd->stats.windows += num;
+    lcd->stats.pixels += pixels;
+    lcd->stats.tx_ns += lcd_now_ns() - start;
+    pthread_mutex_unlock(&lcd->lock);
+
+    return ret;
+}
+
+static void *lcd_tx_thread(void *arg)
+{
+    st7789_t *lcd = arg;
+    int ret;
+
+    pthread_mutex_lock(&lcd->lock);
+    while (lcd->running || lcd->tx_pending) {
+        if (!lcd->tx_pending) {
+            pthread_cond_wait(&lcd->cond, &lcd->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&lcd->lock);
+
+        ret = lcd_send(lcd, lcd->tx_fb, lcd->tx_rects, lcd->tx_num);
+
+        pthread_mutex_lock(&lcd->lock);
+        lcd->tx_result = lcd->tx_result ? lcd->tx_result : ret;
+        lcd->tx_pending = 0;
+        pthread_cond_broadcast(&lcd->cond);
+    }
+    pthread_mutex_unlock(&lcd->lock);
+
+    return NULL;
+}
+
+/* with the lock held, returns and clears the result of the frames sent since the last call */
+static int lcd_idle(st7789_t *lcd)
+{
+    int ret;
+
+    while (lcd->tx_pending) {
+        pthread_cond_wait(&lcd->cond, &lcd->lock);
+    }
+    ret = lcd->tx_result;
+    lcd->tx_result = 0;
+
+    return ret;
+}
+
+/* dirty rectangles */
+static inline int rect_area(const struct st7789_rect *r) { return r->w * r->h; }
+
+static void rect_union(const struct st7789_rect *a, const struct st7789_rect *b, struct st7789_rect *u)
+{
+    int x2 = (a->x + a->w > b->x + b->w) ? a->x + a->w : b->x + b->w;
+    int y2 = (a->y + a->h > b->y + b->h) ? a->y + a->h : b->y + b->h;
+
+    u->x = (a->x < b->x) ? a->x : b->x;
+    u->y = (a->y < b->y) ? a->y : b->y;
+    u->w = x2 - u->x;
+    u->h = y2 - u->y;
+}
+
+static void dirty_add(st7789_t *lcd, struct st7789_rect r)
+{
+    struct st7789_rect u = r;
+    int i, grow, best_grow;
+
+    for (;;) {
+        for (i = 0; i < lcd->num_dirty; i++) {
+            rect_union(&lcd->dirty[i], &r, &u);
+            if (rect_area(&u) <= rect_area(&lcd->dirty[i]) + rect_area(&r) + WINDOW_COST) {
+                break;
+            }
+        }
+
+        if (i == lcd->num_dirty) {
+            if (lcd->num_dirty < ST7789_MAX_DIRTY) {
+                lcd->dirty[lcd->num_dirty++] = r;
+                return;
+            }
+
+            /* full, take the one the bounding box grows least with */
+            best_grow = 0;
+            for (int j = 0; j < lcd->num_dirty; j++) {
+                rect_union(&lcd->dirty[j], &r, &u);
+                grow = rect_area(&u) - rect_area(&lcd->dirty[j]) - rect_area(&r);
+                if (!j || grow < best_grow) {
+                    i = j;
+                    best_grow = grow;
+                }
+            }
+            rect_union(&lcd->dirty[i], &r, &u);
+        }
+
+        /* the union may reach others now, go round again with it */
+        lcd->dirty[i] = lcd->dirty[--lcd->num_dirty];
+        r = u;
+
+        pthread_mutex_lock(&lcd->lock);
+        lcd->stats.merges++;
+        pthread_mutex_unlock(&lcd->lock);
+    }
+}
+
+/* clip to the screen, 0 when nothing is left */
+static int rect_clip(st7789_t *lcd, int *x, int *y, int *w, int *h)
+{
+    if (*x < 0) {
+        *w += *x;
+        *x = 0;
+    }
+    if (*y < 0) {
+        *h += *y;
+        *y = 0;
+    }
+    if (*w > lcd->width - *x) {
+        *w = lcd->width - *x;
+    }
+    if (*h > lcd->height - *y) {
+        *h = lcd->height - *y;
+    }
+
+    return (*w > 0 && *h > 0);
+}
+
+static int lcd_check(st7789_t *lcd) { return (!lcd || (void *)&st7789_type != lcd->base) ? -1 : 0; }
+
+static void lcd_free(st7789_t *lcd)
+{
+    if (lcd->bl) {
+        drv_gpio_inst_destroy(&lcd->bl);
+    }
+    if (lcd->rst) {
+        drv_gpio_inst_destroy(&lcd->rst);
+    }
+    if (lcd->dc) {
+        drv_gpio_inst_destroy(&lcd->dc);
+    }
+    if (lcd->spi) {
+        drv_spi_inst_destroy(&lcd->spi);
+    }
+    hal_slab_buf_free(lcd->fb[0]);
+    hal_slab_buf_free(lcd->fb[1]);
+    pthread_cond_destroy(&lcd->cond);
+    pthread_mutex_destroy(&lcd->lock);
+    lcd->base = NULL;
+    hal_slab_free(&st7789_cache, lcd);
+}
+
+static int lcd_gpio(int pin, gpio_pin_value_t val, drv_gpio_inst_t **inst)
+{
+    if (drv_gpio_inst_create(pin, inst)) {
+        *inst = NULL;
+        printf("[st7789]: gpio %d create fail\n", pin);
+        return -2;
+    }
+    drv_gpio_mode_set(*inst, GPIO_DM_OUTPUT);
+    drv_gpio_value_set(*inst, val);
+
+    return 0;
+}
+
+int st7789_create(const struct st7789_config *cfg, st7789_t **lcd)
+{
+    HAL_TRACE_FUNC();
+
+    st7789_t *l;
+    size_t size;
+    int ret;
+
+    if (!cfg || !lcd || cfg->dc_pin < 0 || !cfg->baudrate || !cfg->width || !cfg->height ||
+        cfg->width > LCD_MAX_SIDE || cfg->height > LCD_MAX_SIDE) {
+        printf("[st7789]: invalid parameters\n");
+        return -1;
+    }
+
+    l = hal_slab_zalloc(&st7789_cache);
+    if (!l) {
+        printf("[st7789]: alloc lcd fail\n");
+        return -3;
+    }
+    l->base = (void *)&st7789_type;
+    l->width = cfg->width;
+    l->height = cfg->height;
+    l->stride = cfg->width * 2;
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->cond, NULL);
+
+    size = l->stride * l->height;
+    l->fb[0] = hal_slab_buf_alloc(size);
+    l->fb[1] = cfg->double_buffer ? hal_slab_buf_alloc(size) : NULL;
+    if (!l->fb[0] || (cfg->double_buffer && !l->fb[1])) {
+        printf("[st7789]: alloc %zu byte framebuffer fail\n", size);
+        ret = -3;
+        goto err;
+    }
+    memset(l->fb[0], 0, size);
+    if (l->fb[1]) {
+        memset(l->fb[1], 0, size);
+    }
+
+    if (drv_spi_inst_create(cfg->spi_id, true, SPI_HAL_MODE_3, cfg->baudrate, 8, cfg->cs_pin, SPI_HAL_DATA_LINE_1,
+                            &l->spi)) {
+        l->spi = NULL;
+        ret = -2;
+        goto err;
+    }
+    if ((ret = lcd_gpio(cfg->dc_pin, GPIO_PV_HIGH, &l->dc)) ||
+        (cfg->rst_pin >= 0 && (ret = lcd_gpio(cfg->rst_pin, GPIO_PV_HIGH, &l->rst))) ||
+        (cfg->bl_pin >= 0 && (ret = lcd_gpio(cfg->bl_pin, GPIO_PV_LOW, &l->bl)))) {
+        goto err;
+    }
+
+    if (l->rst) {
+        drv_gpio_value_set(l->rst, GPIO_PV_LOW);
+        usleep(10 * 1000);
+        drv_gpio_value_set(l->rst, GPIO_PV_HIGH);
+    } else if (lcd_cmd(l, CMD_SWRESET, NULL, 0, 0)) {
+        ret = -2;
+        goto err;
+    }
+    usleep(120 * 1000);
+
+    l->madctl = (cfg->vflip ? MADCTL_MY : 0) | (cfg->hmirror ? MADCTL_MX : 0) |
+                (cfg->width > cfg->height ? MADCTL_MV : 0) | (cfg->bgr ? MADCTL_BGR : 0);
+    if (lcd_cmd_seq(l, init_seq, sizeof(init_seq)) || lcd_cmd(l, CMD_MADCTL, &l->madctl, 1, 0)) {
+        printf("[st7789]: init sequence fail\n");
+        ret = -2;
+        goto err;
+    }
+    if (l->bl) {
+        drv_gpio_value_set(l->bl, GPIO_PV_HIGH);
+    }
+
+    if (cfg->double_buffer) {
+        l->running = 1;
+        if (pthread_create(&l->thread, NULL, lcd_tx_thread, l)) {
+            printf("[st7789]: create tx thread fail\n");
+            l->running = 0;
+            ret = -3;
+            goto err;
+        }
+    }
+
+    l->dirty[0].w = l->width;
+    l->dirty[0].h = l->height;
+    l->num_dirty = 1;
+    *lcd = l;
+
+    return 0;
+
+err:
+    lcd_free(l);
+
+    return ret;
+}
+
+void st7789_destroy(st7789_t **lcd)
+{
+    HAL_TRACE_FUNC();
+
+    st7789_t *l;
+
+    if (!lcd || lcd_check(*lcd)) {
+        return;
+    }
+    l = *lcd;
+
+    if (l->running) {
+        pthread_mutex_lock(&l->lock);
+        l->running = 0;
+        pthread_cond_broadcast(&l->cond);
+        pthread_mutex_unlock(&l->lock);
+        pthread_join(l->thread, NULL);
+    }
+
+    lcd_free(l);
+    *lcd = NULL;
+}
+
+int st7789_get_size(st7789_t *lcd, int *width, int *height)
+{
+    if (lcd_check(lcd)) {
+        return -1;
+    }
+    if (width) {
+        *width = lcd->width;
+    }
+    if (height) {
+        *height = lcd->height;
+    }
+
+    return 0;
+}
+
+uint8_t *st7789_get_framebuffer(st7789_t *lcd) { return lcd_check(lcd) ? NULL : lcd->fb[lcd->draw]; }
+
+int st7789_mark_dirty(st7789_t *lcd, int x, int y, int w, int h)
+{
+    struct st7789_rect r;
+
+    if (lcd_check(lcd)) {
+        return -1;
+    }
+    if (rect_clip(lcd, &x, &y, &w, &h)) {
+        r.x = x;
+        r.y = y;
+        r.w = w;
+        r.h = h;
+        dirty_add(lcd, r);
+    }
+
+    return 0;
+}
+
+int st7789_fill_rect(st7789_t *lcd, int x, int y, int w, int h, uint16_t color)
+{
+    uint8_t *row;
+    uint8_t px[2];
+
+    if (lcd_check(lcd)) {
+        return -1;
+    }
+    if (!rect_clip(lcd, &x, &y, &w, &h)) {
+        return 0;
+    }
+
+    convert_565(px, (const uint8_t *)&color, 1);
+    row = lcd->fb[lcd->draw] + y * lcd->stride + x * 2;
+    for (int i = 0; i < w; i++) {
+        memcpy(row + i * 2, px, sizeof(px));
+    }
+    for (int j = 1; j < h; j++) {
+        memcpy(row + j * lcd->stride, row, w * 2);
+    }
+
+    return st7789_mark_dirty(lcd, x, y, w, h);
+}
+
+int st7789_draw_pixel(st7789_t *lcd, int x, int y, uint16_t color) { return st7789_fill_rect(lcd, x, y, 1, 1, color); }
+
+int st7789_blit(st7789_t *lcd, int x, int y, int w, int h, const void *pixels, size_t stride,
+                st7789_pixel_fmt_t fmt)
+{
+    const uint8_t *src = pixels;
+    size_t bpp = (fmt == ST7789_PIXEL_RGB565) ? 2 : 3;
+    int cx = x, cy = y, cw = w, ch = h;
+    uint8_t *dst;
+
+    if (lcd_check(lcd) || !pixels || fmt > ST7789_PIXEL_BGR888 || w < 0 || h < 0) {
+        return -1;
+    }
+    if (!rect_clip(lcd, &cx, &cy, &cw, &ch)) {
+        return 0;
+    }
+
+    stride = stride ? stride : w * bpp;
+    src += (cy - y) * stride + (cx - x) * bpp;
+    dst = lcd->fb[lcd->draw] + cy * lcd->stride + cx * 2;
+    if (cw == lcd->width && stride == cw * bpp) {
+        st7789_convert(dst, src, (size_t)cw * ch, fmt);
+    } else {
+        for (int j = 0; j < ch; j++, src += stride, dst += lcd->stride) {
+            st7789_convert(dst, src, cw, fmt);
+        }
+    }
+
+    return st7789_mark_dirty(lcd, cx, cy, cw, ch);
+}
+
+int st7789_flush(st7789_t *lcd)
+{
+    HAL_TRACE_FUNC();
+
+    const uint8_t *src;
+    uint8_t *dst;
+    uint64_t start, copied = 0;
+    int ret;
+
+    if (lcd_check(lcd)) {
+        return -1;
+    }
+    if (!lcd->num_dirty) {
+        return 0;
+    }
+
+    if (!lcd->running) {
+        ret = lcd_send(lcd, lcd->fb[0], lcd->dirty, lcd->num_dirty);
+        lcd->num_dirty = 0;
+        return ret;
+    }
+
+    start = lcd_now_ns();
+    pthread_mutex_lock(&lcd->lock);
+    ret = lcd_idle(lcd);
+    lcd->stats.wait_ns += lcd_now_ns() - start;
+    lcd->tx_fb = lcd->fb[lcd->draw];
+    memcpy(lcd->tx_rects, lcd->dirty, lcd->num_dirty * sizeof(lcd->dirty[0]));
+    lcd->tx_num = lcd->num_dirty;
+    lcd->tx_pending = 1;
+    pthread_cond_broadcast(&lcd->cond);
+    pthread_mutex_unlock(&lcd->lock);
+
+    /* both only read the frame on the bus, the next one starts out equal to it */
+    for (int i = 0; i < lcd->num_dirty; i++) {
+        const struct st7789_rect *r = &lcd->dirty[i];
+
+        src = lcd->fb[lcd->draw] + r->y * lcd->stride + r->x * 2;
+        dst = lcd->fb[!lcd->draw] + r->y * lcd->stride + r->x * 2;
+        for (int j = 0; j < r->h; j++) {
+            memcpy(dst + j * lcd->stride, src + j * lcd->stride, r->w * 2);
+        }
+        copied += rect_area(r);
+    }
+    lcd->draw = !lcd->draw;
+    lcd->num_dirty = 0;
+
+    pthread_mutex_lock(&lcd->lock);
+    lcd->stats.copied_pixels += copied;
+    pthread_mutex_unlock(&lcd->lock);
+
+    return ret;
+}
+
+int st7789_wait(st7789_t *lcd)
+{
+    int ret;
+
+    if (lcd_check(lcd)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lcd->lock);
+    ret = lcd_idle(lcd);
+    pthread_mutex_unlock(&lcd->lock);
+
+    return ret;
+}
+
+int st7789_lvgl_flush(st7789_t *lcd, int x1, int y1, int x2, int y2, const uint8_t *px_map, size_t stride,
+                      st7789_pixel_fmt_t fmt, int last)
+{
+    size_t bpp = (fmt == ST7789_PIXEL_RGB565) ? 2 : 3;
+    int ret;
+
+    if (stride && px_map) {
+        px_map += y1 * stride + x1 * bpp;
+    }
+    if ((ret = st7789_blit(lcd, x1, y1, x2 - x1 + 1, y2 - y1 + 1, px_map, stride, fmt))) {
+        return ret;
+    }
+
+    return last ? st7789_flush(lcd) : 0;
+}
+
+int st7789_command(st7789_t *lcd, uint8_t cmd, const uint8_t *data, size_t len)
+{
+    HAL_TRACE_FUNC();
+
+    int ret;
+
+    if (lcd_check(lcd) || (len && !data)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lcd->lock);
+    /* a failed frame is reported here, the command waits for the caller to retry */
+    if (!(ret = lcd_idle(lcd))) {
+        ret = lcd_cmd(lcd, cmd, data, len, 0);
+    }
+    pthread_mutex_unlock(&lcd->lock);
+
+    return ret;
+}
+
+int st7789_set_backlight(st7789_t *lcd, int on)
+{
+    if (lcd_check(lcd) || !lcd->bl) {
+        return -1;
+    }
+
+    return drv_gpio_value_set(lcd->bl, on ? GPIO_PV_HIGH : GPIO_PV_LOW);
+}
+
+int st7789_get_stats(st7789_t *lcd, st7789_stats_t *stats)
+{
+    if (lcd_check(lcd) || !stats) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lcd->lock);
+    *stats = lcd->stats;
+    pthread_mutex_unlock(&lcd->lock);
+
+    return 0;
+}
+
+void st7789_reset_stats(st7789_t *lcd)
+{
+    if (lcd_check(lcd)) {
+        return;
+    }
+
+    pthread_mutex_lock(&lcd->lock);
+    memset(&lcd->stats, 0, sizeof(lcd->stats));
+    pthread_mutex_unlock(&lcd->lock);
+}
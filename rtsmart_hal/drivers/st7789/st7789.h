@@ -0,0 +1,186 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* dirty windows kept per frame, the closest two merge when one more comes */
+#define ST7789_MAX_DIRTY 16
+
+typedef struct st7789 st7789_t;
+
+typedef enum {
+    ST7789_PIXEL_RGB565 = 0, /* uint16_t in cpu byte order */
+    ST7789_PIXEL_RGB888, /* r, g, b bytes */
+    ST7789_PIXEL_BGR888, /* b, g, r bytes, LVGL's RGB888 with LV_COLOR_DEPTH 24 */
+} st7789_pixel_fmt_t;
+
+struct st7789_config {
+    int spi_id;
+    int cs_pin; /* driven by the HAL, -1 when the board selects the panel itself */
+    int dc_pin; /* low for command bytes */
+    int rst_pin; /* -1: no reset line, a software reset is sent */
+    int bl_pin; /* -1: no backlight control */
+    uint32_t baudrate;
+    uint16_t width; /* as mounted, landscape (MADCTL MV) when wider than high */
+    uint16_t height;
+    uint8_t hmirror;
+    uint8_t vflip;
+    uint8_t bgr;
+    uint8_t double_buffer; /* draw into one framebuffer while the other is sent */
+};
+
+typedef struct {
+    uint64_t frames; /* flushes that sent something */
+    uint64_t windows; /* CASET/RASET/RAMWR sequences */
+    uint64_t pixels; /* pixels sent */
+    uint64_t merges; /* dirty rectangles merged into another */
+    uint64_t copied_pixels; /* kept in step between the two framebuffers */
+    uint64_t tx_ns; /* time on the bus */
+    uint64_t wait_ns; /* time a flush waited for the frame before */
+} st7789_stats_t;
+
+/**
+ * @brief Convert @pixels pixels of @fmt to RGB565 in panel byte order, high
+ *        byte first. Each byte is computed from the source bytes alone and
+ *        four pixels go out in one 8 byte store, a loop the compiler turns
+ *        into vector code.
+ */
+void st7789_convert(uint8_t *dst, const void *src, size_t pixels, st7789_pixel_fmt_t fmt);
+
+/**
+ * @brief Reset and initialise an ST7789 panel, clear the framebuffers and
+ *        mark the whole screen dirty, so the first flush clears the panel.
+ *        With double_buffer a thread sends the frames.
+ *
+ * @return 0 on success, negative on error:
+ *         -1: Invalid parameters
+ *         -2: SPI or GPIO setup failed
+ *         -3: Memory allocation failed
+ */
+int st7789_create(const struct st7789_config *cfg, st7789_t **lcd);
+
+/**
+ * @brief Wait for the frame on the bus, then close the panel. The display is
+ *        left on.
+ */
+void st7789_destroy(st7789_t **lcd);
+
+int st7789_get_size(st7789_t *lcd, int *width, int *height);
+
+/**
+ * @brief Framebuffer the next frame is drawn into, @width * 2 bytes per row
+ *        of RGB565 in panel byte order. It changes with every double buffered
+ *        flush. Writes to it need st7789_mark_dirty() to be sent.
+ */
+uint8_t *st7789_get_framebuffer(st7789_t *lcd);
+
+/**
+ * @brief Have the next flush send the window @w x @h at (@x, @y), clipped to
+ *        the screen. A window overlapping or next to one already dirty merges
+ *        with it when one bigger window costs less than two on the bus.
+ *
+ * @return 0 on success, -1 on invalid parameters
+ */
+int st7789_mark_dirty(st7789_t *lcd, int x, int y, int w, int h);
+
+/**
+ * @brief Fill a window with @color, RGB565 in cpu byte order.
+ */
+int st7789_fill_rect(st7789_t *lcd, int x, int y, int w, int h, uint16_t color);
+
+int st7789_draw_pixel(st7789_t *lcd, int x, int y, uint16_t color);
+
+/**
+ * @brief Convert the @w x @h pixels at @pixels into the framebuffer at
+ *        (@x, @y). @stride is the bytes from one source row to the next, 0 for
+ *        packed rows. Parts outside the screen are dropped.
+ *
+ * @return 0 on success, -1 on invalid parameters
+ */
+int st7789_blit(st7789_t *lcd, int x, int y, int w, int h, const void *pixels, size_t stride,
+                st7789_pixel_fmt_t fmt);
+
+/**
+ * @brief Send the dirty windows. Double buffered the frame is handed to the
+ *        sending thread after the one before is out, its windows are copied
+ *        into the other framebuffer and drawing goes on there while it is sent.
+ *        Single buffered it returns once the frame is on the panel.
+ *
+ * @return 0 on success or nothing dirty, -2 when a transfer failed, the frame
+ *         before for a double buffered flush
+ */
+int st7789_flush(st7789_t *lcd);
+
+/**
+ * @brief Wait until the last flushed frame is on the panel.
+ *
+ * @return 0 on success, -2 when a transfer failed
+ */
+int st7789_wait(st7789_t *lcd);
+
+/**
+ * @brief Body of an LVGL flush_cb. The area is LVGL's, corners included.
+ *        @stride is 0 in partial render mode, where px_map holds just the
+ *        area, and the row pitch of the screen buffer in direct mode, where
+ *        px_map is the whole screen. The frame goes out when @last is set:
+ *
+ *   static void flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+ *   {
+ *       st7789_lvgl_flush(lv_display_get_user_data(disp), area->x1, area->y1, area->x2, area->y2, px_map,
+ *                         0, ST7789_PIXEL_BGR888, lv_display_flush_is_last(disp));
+ *       lv_display_flush_ready(disp);
+ *   }
+ *
+ *        px_map is converted before it returns, so LVGL may render on right
+ *        away, with double_buffer while the frame is still on the bus.
+ *
+ * @return 0 on success, negative on error like st7789_flush()
+ */
+int st7789_lvgl_flush(st7789_t *lcd, int x1, int y1, int x2, int y2, const uint8_t *px_map, size_t stride,
+                      st7789_pixel_fmt_t fmt, int last);
+
+/**
+ * @brief Send a command and its parameters, after the frame on the bus.
+ *
+ * @return 0 on success, -2 when the command failed, or when the frame before
+ *         failed, then the command is not sent
+ */
+int st7789_command(st7789_t *lcd, uint8_t cmd, const uint8_t *data, size_t len);
+
+int st7789_set_backlight(st7789_t *lcd, int on);
+
+int st7789_get_stats(st7789_t *lcd, st7789_stats_t *stats);
+void st7789_reset_stats(st7789_t *lcd);
+
+#ifdef __cplusplus
+}
+#endif
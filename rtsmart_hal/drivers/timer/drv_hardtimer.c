@@ -34,6 +34,8 @@
 #include <unistd.h>
 
 #include "drv_timer.h"
+#include "hal_io.h"
+#include "hal_slab.h"
 
 #define KD_TIMER_SIG (SIGRTMIN + 1)
 
@@ -68,9 +70,12 @@ struct _drv_hard_timer_inst {
 
     void*              irq_args;
     timer_irq_callback irq_callback;
+
+    hal_dispatch_mode_t dispatch;
 };
 
 static const int timer_inst_type = 0;
+static HAL_SLAB_CACHE_DEFINE(timer_inst_cache, "drv_hard_timer", drv_hard_timer_inst_t);
 
 static int timer_in_use[KD_TIMER_MAX_NUM];
 
@@ -85,7 +90,7 @@ static int drv_timer_open(int id)
 
     snprintf(dev_name, sizeof(dev_name), "/dev/hwtimer%d", id);
 
-    return open(dev_name, O_RDWR);
+    return hal_io_open(dev_name, O_RDWR);
 }
 
 static int drv_timer_ioctl(drv_hard_timer_inst_t* inst, int cmd, void* arg)
@@ -95,7 +100,7 @@ static int drv_timer_ioctl(drv_hard_timer_inst_t* inst, int cmd, void* arg)
         return -1;
     }
 
-    return ioctl(inst->fd, cmd, arg);
+    return hal_io_ioctl(inst->fd, cmd, arg);
 }
 
 int drv_hard_timer_inst_create(int id, drv_hard_timer_inst_t** inst)
@@ -125,9 +130,9 @@ int drv_hard_timer_inst_create(int id, drv_hard_timer_inst_t** inst)
         return -2;
     }
 
-    *inst = malloc(sizeof(drv_hard_timer_inst_t));
+    *inst = hal_slab_alloc(&timer_inst_cache);
     if (NULL == *inst) {
-        printf("[hal_hdtimer]: malloc failed");
+        printf("[hal_hdtimer]: alloc instance failed");
         return -1;
     }
     memset(*inst, 0x00, sizeof(drv_hard_timer_inst_t));
@@ -139,6 +144,7 @@ int drv_hard_timer_inst_create(int id, drv_hard_timer_inst_t** inst)
     (*inst)->curr_mode      = HWTIMER_MODE_ONESHOT;
     (*inst)->curr_period_ms = 1000; /* 1000ms */
     (*inst)->curr_freq_hz   = 12500 * 1000;
+    (*inst)->dispatch       = HAL_DISPATCH_SIGNAL;
 
     timer_in_use[id] = 1;
 
@@ -162,9 +168,9 @@ void drv_hard_timer_inst_destroy(drv_hard_timer_inst_t** inst)
     drv_hard_timer_stop(*inst);
     drv_hard_timer_unregister_irq(*inst);
 
-    close((*inst)->fd);
+    hal_io_close((*inst)->fd);
 
-    free(*inst);
+    hal_slab_free(&timer_inst_cache, *inst);
     *inst = NULL;
 
     timer_in_use[id] = 0;
@@ -312,7 +318,7 @@ int drv_hard_timer_start(drv_hard_timer_inst_t* inst)
     tv.sec  = period_ms / 1000;
     tv.usec = (period_ms % 1000) * 1000;
 
-    if (sizeof(tv) != write(inst->fd, &tv, sizeof(tv))) {
+    if (sizeof(tv) != hal_io_write(inst->fd, &tv, sizeof(tv))) {
         printf("[hal_hdtimer]: start timer failed\n");
         return -1;
     }
@@ -345,7 +351,7 @@ static void drv_timer_sig_handler(int sig, siginfo_t* si, void* uc)
     }
 
     if (inst->irq_callback) {
-        inst->irq_callback(inst->irq_args);
+        hal_dispatch_deliver(inst->dispatch, inst->irq_callback, inst->irq_args);
     }
 }
 
@@ -421,6 +427,31 @@ int drv_hard_timer_unregister_irq(drv_hard_timer_inst_t* inst)
     sa.sa_flags = 0;
     sigaction(KD_TIMER_SIG + (inst->id), &sa, NULL);
 
+    if (HAL_DISPATCH_THREAD == inst->dispatch) {
+        hal_dispatch_sync();
+    }
+
+    return 0;
+}
+
+int drv_hard_timer_set_dispatch(drv_hard_timer_inst_t* inst, hal_dispatch_mode_t mode)
+{
+    if (NULL == inst) {
+        return -1;
+    }
+
+    if (HAL_DISPATCH_MODE_MAX <= mode) {
+        printf("[hal_hdtimer]: invalid dispatch mode %d\n", mode);
+        return -1;
+    }
+
+    if ((HAL_DISPATCH_THREAD == mode) && (0x00 != hal_dispatch_start())) {
+        printf("[hal_hdtimer]: start irq dispatcher failed\n");
+        return -1;
+    }
+
+    inst->dispatch = mode;
+
     return 0;
 }
 
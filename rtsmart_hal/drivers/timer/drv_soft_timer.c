@@ -28,56 +28,409 @@
 #include <string.h>
 
 #include <errno.h>
-#include <fcntl.h>
-#include <math.h>
 #include <pthread.h>
 #include <signal.h>
-#include <sys/ioctl.h>
-#include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "drv_timer.h"
+#include "hal_slab.h"
+#include "list.h"
+
+/*
+ * Hierarchical timing wheel, 5 levels of 64 slots. Level n slots are
+ * 64^n ticks wide, timers are cascaded down one level each time the level
+ * below wraps, so every timer is touched at most 5 times over its lifetime.
+ * With a 1ms tick the wheel covers ~12 days, longer timeouts are clamped and
+ * re-armed when they reach the top.
+ *
+ * Timers with a nanosecond period or an absolute start are kept apart on a
+ * deadline ordered list, the service thread sleeps until whichever of the
+ * two comes first. Their deadlines are absolute CLOCK_MONOTONIC times and a
+ * period advances the previous deadline, so they never drift.
+ */
+#define WHEEL_BITS      (6)
+#define WHEEL_SIZE      (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS    (5)
+#define WHEEL_MAX_DELTA ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
 
-static int soft_timer_type = 0;
+#define TICK_NS     (DRV_SOFT_TIMER_TICK_US * 1000ULL)
+#define TICK_IDLE   (UINT64_MAX)
 
-static int soft_timer_in_used = 0;
+static int soft_timer_type = 0;
 
 struct _drv_soft_timer_inst {
     void*              base;
-    timer_t            timerid;
     int                started;
     rt_hwtimer_mode_t  mode;
     uint32_t           period_ms;
+    uint64_t           period_ns; /* non zero selects the deadline list */
     void*              irq_args;
     timer_irq_callback irq_callback;
+
+    struct list_head   node;
+    struct list_head*  slot; /* slot queued on, NULL when not pending */
+    uint64_t           expires; /* wheel tick, or monotonic ns on the deadline list */
+    uint64_t           period_ticks; /* wheel ticks, or ns on the deadline list */
+    uint32_t           overruns; /* periods skipped since start */
 };
 
-static void soft_timer_sig_handler(int sig, siginfo_t* si, void* uc)
+struct soft_timer_wheel {
+    pthread_mutex_t        lock;
+    pthread_cond_t         wakeup; /* wheel changed, service thread re-evaluates */
+    pthread_cond_t         idle; /* running callback returned */
+    pthread_t              thread;
+    int                    ready;
+
+    uint64_t               base_ns; /* monotonic time of tick 0 */
+    uint64_t               clk; /* next tick to process */
+    uint64_t               sleep_until; /* monotonic ns the service thread sleeps until */
+    uint64_t               l0_bitmap; /* non-empty level 0 slots */
+    uint32_t               upper; /* timers queued on level 1 and up */
+    uint32_t               active; /* timers queued anywhere, including the work list */
+    drv_soft_timer_inst_t* running;
+
+    drv_soft_timer_stats_t stats;
+    struct list_head       hres; /* deadline ordered */
+    struct list_head       slots[WHEEL_LEVELS][WHEEL_SIZE];
+};
+
+static struct soft_timer_wheel wheel = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static pthread_once_t wheel_once = PTHREAD_ONCE_INIT;
+static HAL_SLAB_CACHE_DEFINE(soft_timer_cache, "drv_soft_timer", drv_soft_timer_inst_t);
+
+static uint64_t wheel_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline int wheel_slot_level0(struct list_head* slot)
+{
+    return (slot >= &wheel.slots[0][0]) && (slot < &wheel.slots[1][0]);
+}
+
+static void wheel_enqueue(drv_soft_timer_inst_t* t)
+{
+    struct list_head* slot;
+    uint64_t          expires = t->expires;
+    int64_t           delta   = (int64_t)(expires - wheel.clk);
+    int               level;
+
+    if (delta < WHEEL_SIZE) {
+        /* already due timers go to the slot processed next */
+        if (delta < 0) {
+            expires = wheel.clk;
+        }
+        slot = &wheel.slots[0][expires & WHEEL_MASK];
+        wheel.l0_bitmap |= 1ULL << (expires & WHEEL_MASK);
+    } else {
+        if ((uint64_t)delta > WHEEL_MAX_DELTA) {
+            delta   = WHEEL_MAX_DELTA;
+            expires = wheel.clk + WHEEL_MAX_DELTA;
+        }
+        for (level = 1; level < WHEEL_LEVELS - 1; level++) {
+            if ((uint64_t)delta < (1ULL << (WHEEL_BITS * (level + 1)))) {
+                break;
+            }
+        }
+        slot = &wheel.slots[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+        wheel.upper++;
+    }
+
+    list_add_tail(&t->node, slot);
+    t->slot = slot;
+}
+
+static void wheel_dequeue(drv_soft_timer_inst_t* t)
 {
-    drv_soft_timer_inst_t* inst = si->si_ptr;
+    struct list_head* slot = t->slot;
+
+    if (NULL == slot) {
+        return;
+    }
+
+    list_del_init(&t->node);
+    t->slot = NULL;
 
-    if (SIGALRM != sig) {
+    if (&wheel.hres == slot) {
         return;
+    } else if (wheel_slot_level0(slot)) {
+        if (list_empty(slot)) {
+            wheel.l0_bitmap &= ~(1ULL << (slot - &wheel.slots[0][0]));
+        }
+    } else {
+        wheel.upper--;
+    }
+}
+
+static void hres_enqueue(drv_soft_timer_inst_t* t)
+{
+    struct list_head* pos;
+
+    /* re-armed periodic timers usually land near the end, scan from there */
+    for (pos = wheel.hres.prev; pos != &wheel.hres; pos = pos->prev) {
+        if (list_entry(pos, drv_soft_timer_inst_t, node)->expires <= t->expires) {
+            break;
+        }
+    }
+    __list_add(&t->node, pos, pos->next);
+    t->slot = &wheel.hres;
+}
+
+static int wheel_cascade(int level, int index)
+{
+    struct list_head       pending;
+    drv_soft_timer_inst_t* t;
+
+    if (list_empty(&wheel.slots[level][index])) {
+        return index;
+    }
+
+    list_replace_init(&wheel.slots[level][index], &pending);
+    while (!list_empty(&pending)) {
+        t = list_entry(pending.next, drv_soft_timer_inst_t, node);
+        list_del_init(&t->node);
+        wheel.upper--;
+        wheel_enqueue(t);
+        wheel.stats.cascaded++;
+    }
+
+    return index;
+}
+
+/* first tick that may have work, never beyond the next level 0 wrap while upper levels hold timers */
+static uint64_t wheel_next_tick(void)
+{
+    uint64_t bitmap = wheel.l0_bitmap;
+    uint64_t limit  = (wheel.clk + WHEEL_MASK) & ~(uint64_t)WHEEL_MASK;
+    int      idx    = wheel.clk & WHEEL_MASK;
+
+    if (bitmap) {
+        bitmap = idx ? ((bitmap >> idx) | (bitmap << (WHEEL_SIZE - idx))) : bitmap;
+        uint64_t next = wheel.clk + __builtin_ctzll(bitmap);
+        if ((0 == wheel.upper) || (next < limit)) {
+            return next;
+        }
     }
 
-    if (SI_TIMER != si->si_code) {
+    return wheel.upper ? limit : TICK_IDLE;
+}
+
+/* called with the lock held, drops it around the callback */
+static void wheel_fire(drv_soft_timer_inst_t* t, uint64_t due_ns)
+{
+    timer_irq_callback callback;
+    void*              args;
+    uint64_t           late = wheel_now_ns() - due_ns;
+
+    if ((int64_t)late < 0) {
+        late = 0;
+    }
+    wheel.stats.expired++;
+    wheel.stats.late_ns_sum += late;
+    if (late > wheel.stats.late_ns_max) {
+        wheel.stats.late_ns_max = late;
+    }
+
+    if (NULL == (callback = t->irq_callback)) {
         return;
     }
+    args          = t->irq_args;
+    wheel.running = t;
+    pthread_mutex_unlock(&wheel.lock);
+
+    callback(args);
+
+    pthread_mutex_lock(&wheel.lock);
+    wheel.running = NULL;
+    pthread_cond_broadcast(&wheel.idle);
+}
+
+static void hres_run(uint64_t now_ns)
+{
+    drv_soft_timer_inst_t* t;
+    uint64_t               due, missed;
+
+    while (!list_empty(&wheel.hres)) {
+        t = list_entry(wheel.hres.next, drv_soft_timer_inst_t, node);
+        if (t->expires > now_ns) {
+            break;
+        }
+        list_del_init(&t->node);
+        t->slot = NULL;
+        due     = t->expires;
+
+        if (HWTIMER_MODE_PERIOD == t->mode) {
+            /* next deadline is relative to the previous one, not to when we got here */
+            t->expires += t->period_ticks;
+            if (t->expires <= now_ns) {
+                missed = (now_ns - t->expires) / t->period_ticks + 1;
+                t->expires += missed * t->period_ticks;
+                t->overruns += missed;
+                wheel.stats.overruns += missed;
+            }
+            hres_enqueue(t);
+        } else {
+            wheel.active--;
+        }
+
+        wheel_fire(t, due);
+    }
+}
+
+static void wheel_run_tick(uint64_t now_tick)
+{
+    struct list_head       work;
+    drv_soft_timer_inst_t* t;
+    uint64_t               due, missed;
+    int                    idx = wheel.clk & WHEEL_MASK;
+
+    if (0 == idx) {
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if (0 != wheel_cascade(level, (wheel.clk >> (WHEEL_BITS * level)) & WHEEL_MASK)) {
+                break;
+            }
+        }
+    }
 
-    if (!inst || (&soft_timer_type != inst->base)) {
+    if (list_empty(&wheel.slots[0][idx])) {
+        wheel.clk++;
         return;
     }
 
-    if (inst->irq_callback) {
-        inst->irq_callback(inst->irq_args);
+    /* timers keep pointing at their slot while on the work list, so stop() still unlinks them */
+    list_replace_init(&wheel.slots[0][idx], &work);
+    wheel.l0_bitmap &= ~(1ULL << idx);
+    wheel.clk++;
+
+    while (!list_empty(&work)) {
+        t = list_entry(work.next, drv_soft_timer_inst_t, node);
+        list_del_init(&t->node);
+        t->slot = NULL;
+        due     = t->expires;
+
+        if (HWTIMER_MODE_PERIOD == t->mode) {
+            /* keep the phase, drop the periods that were missed while we ran late */
+            t->expires += t->period_ticks;
+            if (t->expires <= now_tick) {
+                missed = (now_tick - t->expires) / t->period_ticks + 1;
+                t->expires += missed * t->period_ticks;
+                t->overruns += missed;
+                wheel.stats.overruns += missed;
+            }
+            wheel_enqueue(t);
+        } else {
+            wheel.active--;
+        }
+
+        wheel_fire(t, wheel.base_ns + due * TICK_NS);
+    }
+}
+
+static void* wheel_thread(void* args)
+{
+    struct timespec ts;
+    uint64_t        now_ns, now_tick, next, start, deadline;
+    sigset_t        mask;
+
+    (void)args;
+
+    /* signals are for the application threads, callbacks here are plain function calls */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    pthread_mutex_lock(&wheel.lock);
+    for (;;) {
+        now_ns   = wheel_now_ns();
+        now_tick = (now_ns - wheel.base_ns) / TICK_NS;
+        next     = wheel_next_tick();
+
+        if (!list_empty(&wheel.hres)
+            && (list_entry(wheel.hres.next, drv_soft_timer_inst_t, node)->expires <= now_ns)) {
+            wheel.stats.wakeups++;
+            hres_run(now_ns);
+            wheel.stats.busy_ns += wheel_now_ns() - now_ns;
+            continue;
+        }
+
+        if (next > now_tick) {
+            deadline = (TICK_IDLE == next) ? TICK_IDLE : wheel.base_ns + next * TICK_NS;
+            if (!list_empty(&wheel.hres)) {
+                uint64_t hres_next = list_entry(wheel.hres.next, drv_soft_timer_inst_t, node)->expires;
+                deadline           = (hres_next < deadline) ? hres_next : deadline;
+            }
+
+            wheel.sleep_until = deadline;
+            if (TICK_IDLE == deadline) {
+                pthread_cond_wait(&wheel.wakeup, &wheel.lock);
+            } else {
+                ts.tv_sec  = deadline / 1000000000ULL;
+                ts.tv_nsec = deadline % 1000000000ULL;
+                pthread_cond_timedwait(&wheel.wakeup, &wheel.lock, &ts);
+            }
+            continue;
+        }
+
+        wheel.stats.wakeups++;
+        start = now_ns;
+        /* jump straight to the ticks that carry timers or a cascade, empty slots are never walked */
+        while (next <= now_tick) {
+            wheel.clk = next;
+            wheel_run_tick(now_tick);
+            next = wheel_next_tick();
+        }
+        if (wheel.clk <= now_tick) {
+            wheel.clk = now_tick + 1;
+        }
+        wheel.stats.busy_ns += wheel_now_ns() - start;
+    }
+
+    return NULL;
+}
+
+static void wheel_init(void)
+{
+    pthread_condattr_t attr;
+    pthread_attr_t     thread_attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wheel.wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&wheel.idle, NULL);
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int i = 0; i < WHEEL_SIZE; i++) {
+            INIT_LIST_HEAD(&wheel.slots[level][i]);
+        }
     }
+    INIT_LIST_HEAD(&wheel.hres);
+    wheel.base_ns     = wheel_now_ns();
+    wheel.clk         = 0;
+    wheel.sleep_until = TICK_IDLE;
+
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+    if (0 == pthread_create(&wheel.thread, &thread_attr, wheel_thread, NULL)) {
+        wheel.ready = 1;
+    } else {
+        printf("[hal_sfttimer]: create service thread failed\n");
+    }
+    pthread_attr_destroy(&thread_attr);
 }
 
 int drv_soft_timer_create(drv_soft_timer_inst_t** inst)
 {
-    if (soft_timer_in_used) {
-        printf("[hal_sfttimer]: soft timer in use\n");
+    pthread_once(&wheel_once, wheel_init);
+    if (!wheel.ready) {
         return -1;
     }
 
@@ -86,9 +439,9 @@ int drv_soft_timer_create(drv_soft_timer_inst_t** inst)
         *inst = NULL;
     }
 
-    *inst = malloc(sizeof(drv_soft_timer_inst_t));
+    *inst = hal_slab_alloc(&soft_timer_cache);
     if (NULL == (*inst)) {
-        printf("[hal_sfttimer]: malloc failed");
+        printf("[hal_sfttimer]: alloc instance failed");
         return -1;
     }
     memset(*inst, 0x00, sizeof(drv_soft_timer_inst_t));
@@ -99,30 +452,14 @@ int drv_soft_timer_create(drv_soft_timer_inst_t** inst)
     (*inst)->period_ms    = 1000;
     (*inst)->irq_args     = NULL;
     (*inst)->irq_callback = NULL;
-
-    struct sigaction sa;
-    sa.sa_flags     = SA_SIGINFO;
-    sa.sa_sigaction = soft_timer_sig_handler;
-    sigemptyset(&sa.sa_mask);
-    sigaction(SIGALRM, &sa, NULL);
-
-    struct sigevent sev;
-    sev.sigev_notify          = SIGEV_SIGNAL;
-    sev.sigev_signo           = SIGALRM;
-    sev.sigev_value.sival_ptr = (*inst);
-    if (timer_create(CLOCK_REALTIME, &sev, &(*inst)->timerid)) {
-        printf("[hal_sfttimer]: create soft timer failed.\n");
-        return -1;
-    }
-    soft_timer_in_used = 1;
+    (*inst)->slot         = NULL;
+    INIT_LIST_HEAD(&(*inst)->node);
 
     return 0;
 }
 
 void drv_soft_timer_destroy(drv_soft_timer_inst_t** inst)
 {
-    struct sigaction sa;
-
     if(NULL == *inst) {
         return;
     }
@@ -135,21 +472,16 @@ void drv_soft_timer_destroy(drv_soft_timer_inst_t** inst)
     drv_soft_timer_stop(*inst);
     drv_soft_timer_unregister_irq(*inst);
 
-    if ((*inst)->timerid) {
-        timer_delete((*inst)->timerid);
-        (*inst)->timerid = NULL;
+    /* the callback may still be running on the service thread, unless it is destroying itself */
+    pthread_mutex_lock(&wheel.lock);
+    while ((wheel.running == *inst) && !pthread_equal(pthread_self(), wheel.thread)) {
+        pthread_cond_wait(&wheel.idle, &wheel.lock);
     }
+    pthread_mutex_unlock(&wheel.lock);
 
-    sa.sa_handler   = SIG_IGN;
-    sa.sa_sigaction = NULL;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGALRM, &sa, NULL);
-
-    free(*inst);
+    (*inst)->base = NULL;
+    hal_slab_free(&soft_timer_cache, *inst);
     *inst = NULL;
-
-    soft_timer_in_used = 0;
 }
 
 int drv_soft_timer_set_mode(drv_soft_timer_inst_t* inst, rt_hwtimer_mode_t mode)
@@ -171,58 +503,129 @@ int drv_soft_timer_set_period(drv_soft_timer_inst_t* inst, int period_ms)
         return -1;
     }
 
+    if (0 >= period_ms) {
+        printf("[hal_sfttimer]: invalid period %d\n", period_ms);
+        return -1;
+    }
+
     inst->period_ms = period_ms;
+    inst->period_ns = 0;
+
+    return 0;
+}
+
+int drv_soft_timer_set_period_ns(drv_soft_timer_inst_t* inst, uint64_t period_ns)
+{
+    if ((NULL == inst) || (inst->started)) {
+        printf("[hal_sfttimer]: timer not created or started\n");
+        return -1;
+    }
+
+    if (DRV_SOFT_TIMER_MIN_PERIOD_NS > period_ns) {
+        printf("[hal_sfttimer]: invalid period %llu ns, minimum %d ns\n", (unsigned long long)period_ns,
+               DRV_SOFT_TIMER_MIN_PERIOD_NS);
+        return -1;
+    }
+
+    inst->period_ns = period_ns;
+    inst->period_ms = (period_ns + 999999ULL) / 1000000ULL;
+
+    return 0;
+}
+
+static void hres_start(drv_soft_timer_inst_t* inst, uint64_t deadline_ns)
+{
+    inst->period_ticks = inst->period_ns ? inst->period_ns : (uint64_t)inst->period_ms * 1000000ULL;
+    inst->expires      = deadline_ns;
+    inst->overruns     = 0;
+    hres_enqueue(inst);
+    wheel.active++;
+    inst->started = 1;
+
+    if (deadline_ns < wheel.sleep_until) {
+        pthread_cond_signal(&wheel.wakeup);
+    }
+}
+
+int drv_soft_timer_start_abs(drv_soft_timer_inst_t* inst, const struct timespec* deadline)
+{
+    if ((NULL == inst) || (inst->started)) {
+        printf("[hal_sfttimer]: timer not created or started\n");
+        return -1;
+    }
+
+    if ((NULL == deadline) || (0 > deadline->tv_sec) || (1000000000L <= (unsigned long)deadline->tv_nsec)) {
+        printf("[hal_sfttimer]: invalid deadline\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&wheel.lock);
+    hres_start(inst, (uint64_t)deadline->tv_sec * 1000000000ULL + deadline->tv_nsec);
+    pthread_mutex_unlock(&wheel.lock);
 
     return 0;
 }
 
 int drv_soft_timer_start(drv_soft_timer_inst_t* inst)
 {
-    struct itimerspec its      = {};
-    const uint64_t    ms_to_ns = 1000000ULL; // 1ms = 1,000,000ns
+    uint64_t now_ns, ticks;
 
     if ((NULL == inst) || (inst->started)) {
         printf("[hal_sfttimer]: timer not created or started\n");
         return -1;
     }
-    uint64_t ns = (uint64_t)inst->period_ms * ms_to_ns;
 
-    memset(&its, 0x00, sizeof(its));
+    if (inst->period_ns) {
+        pthread_mutex_lock(&wheel.lock);
+        hres_start(inst, wheel_now_ns() + inst->period_ns);
+        pthread_mutex_unlock(&wheel.lock);
 
-    its.it_value.tv_sec  = ns / 1000000000ULL;
-    its.it_value.tv_nsec = ns % 1000000000ULL;
+        return 0;
+    }
 
-    if (inst->mode == HWTIMER_MODE_PERIOD) {
-        its.it_interval = its.it_value;
+    ticks = ((uint64_t)inst->period_ms * 1000ULL + DRV_SOFT_TIMER_TICK_US - 1) / DRV_SOFT_TIMER_TICK_US;
+    if (0 == ticks) {
+        ticks = 1;
     }
 
-    if (timer_settime(inst->timerid, 0, &its, NULL)) {
-        printf("[hal_sfttimer]: start soft timer failed\n");
-        return -1;
+    pthread_mutex_lock(&wheel.lock);
+    now_ns = wheel_now_ns() - wheel.base_ns;
+
+    /* an empty wheel may have been idle for long, catch its clock up instead of walking the gap */
+    if ((0 == wheel.l0_bitmap) && (0 == wheel.upper) && (NULL == wheel.running)) {
+        wheel.clk = now_ns / TICK_NS;
     }
+
+    /* round the start up to the next tick boundary, timers never fire early */
+    inst->period_ticks = ticks;
+    inst->expires      = (now_ns + TICK_NS - 1) / TICK_NS + ticks;
+    inst->overruns     = 0;
+    wheel_enqueue(inst);
+    wheel.active++;
     inst->started = 1;
 
+    if (wheel.base_ns + inst->expires * TICK_NS < wheel.sleep_until) {
+        pthread_cond_signal(&wheel.wakeup);
+    }
+    pthread_mutex_unlock(&wheel.lock);
+
     return 0;
 }
 
 int drv_soft_timer_stop(drv_soft_timer_inst_t* inst)
 {
-    struct itimerspec its = {};
-
     if ((NULL == inst)) {
         printf("[hal_sfttimer]: timer not created or started\n");
         return -1;
     }
 
-    if (inst->started) {
-        its.it_value.tv_sec  = 0;
-        its.it_value.tv_nsec = 0;
-        if (timer_settime(inst->timerid, 0, &its, NULL)) {
-            printf("[hal_sfttimer]: stop soft timer failed\n");
-            return -1;
-        }
+    pthread_mutex_lock(&wheel.lock);
+    if (inst->slot) {
+        wheel_dequeue(inst);
+        wheel.active--;
     }
     inst->started = 0;
+    pthread_mutex_unlock(&wheel.lock);
 
     return 0;
 }
@@ -261,3 +664,39 @@ int drv_soft_timer_is_started(drv_soft_timer_inst_t* inst)
 
     return inst->started;
 }
+
+uint32_t drv_soft_timer_get_overrun(drv_soft_timer_inst_t* inst)
+{
+    uint32_t overruns;
+
+    if (NULL == inst) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&wheel.lock);
+    overruns = inst->overruns;
+    pthread_mutex_unlock(&wheel.lock);
+
+    return overruns;
+}
+
+int drv_soft_timer_get_stats(drv_soft_timer_stats_t* stats)
+{
+    if (NULL == stats) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&wheel.lock);
+    *stats        = wheel.stats;
+    stats->active = wheel.active;
+    pthread_mutex_unlock(&wheel.lock);
+
+    return 0;
+}
+
+void drv_soft_timer_reset_stats(void)
+{
+    pthread_mutex_lock(&wheel.lock);
+    memset(&wheel.stats, 0x00, sizeof(wheel.stats));
+    pthread_mutex_unlock(&wheel.lock);
+}
@@ -25,6 +25,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <time.h>
+
+#include "hal_dispatch.h"
 
 #define KD_TIMER_MAX_NUM (6)
 
@@ -73,25 +76,77 @@ int drv_hard_timer_register_irq(drv_hard_timer_inst_t* inst, timer_irq_callback
 int drv_hard_timer_unregister_irq(drv_hard_timer_inst_t* inst);
 
 int drv_hard_timer_get_id(drv_hard_timer_inst_t* inst);
+
+/**
+ * @brief Select how the irq callback is delivered, in the signal handler
+ *        (default) or on the dispatcher thread, see hal_dispatch.h.
+ */
+int drv_hard_timer_set_dispatch(drv_hard_timer_inst_t* inst, hal_dispatch_mode_t mode);
 int drv_hard_timer_is_started(drv_hard_timer_inst_t* inst);
 
 /** soft timer ***************************************************************/
+/*
+ * Soft timers are multiplexed on a hierarchical timing wheel, serviced by one
+ * thread sleeping on CLOCK_MONOTONIC. Any number of instances can be created,
+ * insert and cancel are O(1), callbacks run on the service thread.
+ *
+ * A period set with drv_soft_timer_set_period_ns()/_us(), or a start with
+ * drv_soft_timer_start_abs(), bypasses the wheel tick: deadlines are absolute
+ * CLOCK_MONOTONIC nanoseconds and each period advances the previous deadline,
+ * so periodic timers do not drift and are immune to wall clock steps.
+ */
+#define DRV_SOFT_TIMER_TICK_US       (1000) /* wheel resolution */
+#define DRV_SOFT_TIMER_MIN_PERIOD_NS (10000) /* shortest nanosecond period */
+
 typedef struct _drv_soft_timer_inst drv_soft_timer_inst_t;
 
+typedef struct {
+    uint32_t active; /* armed timers */
+    uint64_t expired; /* callbacks dispatched */
+    uint64_t overruns; /* periods skipped because the service ran late */
+    uint64_t cascaded; /* timers moved to a lower wheel level */
+    uint64_t wakeups; /* service thread wakeups */
+    uint64_t busy_ns; /* time spent servicing the wheel, callbacks included */
+    uint64_t late_ns_max; /* worst callback lateness against the expiry tick */
+    uint64_t late_ns_sum; /* sum of callback lateness, divide by expired */
+} drv_soft_timer_stats_t;
+
 int  drv_soft_timer_create(drv_soft_timer_inst_t** inst);
 void drv_soft_timer_destroy(drv_soft_timer_inst_t** inst);
 
 int drv_soft_timer_set_mode(drv_soft_timer_inst_t* inst, rt_hwtimer_mode_t mode);
 int drv_soft_timer_set_period(drv_soft_timer_inst_t* inst, int period_ms);
+int drv_soft_timer_set_period_ns(drv_soft_timer_inst_t* inst, uint64_t period_ns);
+
+static inline int drv_soft_timer_set_period_us(drv_soft_timer_inst_t* inst, uint32_t period_us)
+{
+    return drv_soft_timer_set_period_ns(inst, (uint64_t)period_us * 1000ULL);
+}
 
 int drv_soft_timer_start(drv_soft_timer_inst_t* inst);
 int drv_soft_timer_stop(drv_soft_timer_inst_t* inst);
 
+/**
+ * @brief Start with the first expiry at an absolute CLOCK_MONOTONIC time,
+ *        later periods follow at deadline + n * period. A deadline in the
+ *        past fires at once.
+ */
+int drv_soft_timer_start_abs(drv_soft_timer_inst_t* inst, const struct timespec* deadline);
+
+/**
+ * @brief Periods skipped since the last start because the callback could not
+ *        be run in time, like timer_getoverrun() but cumulative.
+ */
+uint32_t drv_soft_timer_get_overrun(drv_soft_timer_inst_t* inst);
+
 int drv_soft_timer_register_irq(drv_soft_timer_inst_t* inst, timer_irq_callback callback, void* userargs);
 int drv_soft_timer_unregister_irq(drv_soft_timer_inst_t* inst);
 
 int drv_soft_timer_is_started(drv_soft_timer_inst_t* inst);
 
+int  drv_soft_timer_get_stats(drv_soft_timer_stats_t* stats);
+void drv_soft_timer_reset_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,7 @@
 #include <stdio.h>
 
 #include "drv_tsensor.h"
+#include "hal_io.h"
 
 struct tsensor_dev {
     int fd;
@@ -54,7 +55,7 @@ static int open_ts_dev()
         goto out;
     }
 
-    ts_dev.fd = open("/dev/ts", O_RDWR);
+    ts_dev.fd = hal_io_open("/dev/ts", O_RDWR);
     if (ts_dev.fd < 0) {
         printf("[hal_tsensor]: open dev fail: %s (errno: %d)\n", strerror(errno), errno);
         goto out;
@@ -76,7 +77,7 @@ int drv_tsensor_read_temperature(double *temp)
         goto out;
     }
 
-    ret = read(fd, temp, sizeof(*temp));
+    ret = hal_io_read(fd, temp, sizeof(*temp));
     if (ret != sizeof(*temp)) {
         printf("[hal_tsensor]: read temperature fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
         ret = -1;
@@ -88,7 +89,7 @@ out:
     return ret;
 
 err:
-    close(fd);
+    hal_io_close(fd);
 
     return ret;
 }
@@ -111,7 +112,7 @@ int drv_tsensor_set_mode(uint8_t mode)
         goto err;
     }
 
-    ret = ioctl(fd, RT_DEVICE_TS_CTRL_SET_MODE, &_mode);
+    ret = hal_io_ioctl(fd, RT_DEVICE_TS_CTRL_SET_MODE, &_mode);
     if (ret) {
         printf("[hal_tsensor]: ts set mode fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
         ret = -1;
@@ -122,7 +123,7 @@ out:
     return ret;
 
 err:
-    close(fd);
+    hal_io_close(fd);
 
     return ret;
 }
@@ -144,7 +145,7 @@ int drv_tsensor_set_trim(uint8_t trim)
         goto err;
     }
 
-    ret = ioctl(fd, RT_DEVICE_TS_CTRL_SET_TRIM, &_trim);
+    ret = hal_io_ioctl(fd, RT_DEVICE_TS_CTRL_SET_TRIM, &_trim);
     if (ret) {
         printf("[hal_tsensor]: ts set trim fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
         ret = -1;
@@ -155,7 +156,7 @@ out:
     return ret;
 
 err:
-    close(fd);
+    hal_io_close(fd);
 
     return ret;
 }
@@ -170,7 +171,7 @@ int drv_tsensor_get_mode(uint8_t *mode)
         goto out;
     }
 
-    ret = ioctl(fd, RT_DEVICE_TS_CTRL_GET_MODE, mode);
+    ret = hal_io_ioctl(fd, RT_DEVICE_TS_CTRL_GET_MODE, mode);
     if (ret) {
         printf("[hal_tsensor]: ts get mode fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
         ret = -1;
@@ -180,7 +181,7 @@ out:
     return ret;
 
 err:
-    close(fd);
+    hal_io_close(fd);
 
     return ret;
 }
@@ -195,7 +196,7 @@ int drv_tsensor_get_trim(uint8_t *trim)
         goto out;
     }
 
-    ret = ioctl(fd, RT_DEVICE_TS_CTRL_GET_TRIM, trim);
+    ret = hal_io_ioctl(fd, RT_DEVICE_TS_CTRL_GET_TRIM, trim);
     if (ret) {
         printf("[hal_tsensor]: ts get trim fail: %s (errno: %d, ret: %d)\n", strerror(errno), errno, ret);
         ret = -1;
@@ -205,7 +206,7 @@ out:
     return ret;
 
 err:
-    close(fd);
+    hal_io_close(fd);
 
     return ret;
 }
@@ -38,6 +38,9 @@
 #include "hal_syscall.h"
 
 #include "drv_uart.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
 
 #define UART_IOCTL_SET_CONFIG _IOW('U', 0, void*)
 #define UART_IOCTL_GET_CONFIG _IOR('U', 1, void*)
@@ -46,6 +49,7 @@
 
 static const int _drv_uart_inst_type; /**< Unique identifier for UART instance type */
 static int       _drv_uart_state[KD_HARD_UART_MAX_NUM]; /**< Tracks usage state of each UART interface */
+static HAL_SLAB_CACHE_DEFINE(uart_inst_cache, "drv_uart", drv_uart_inst_t);
 
 /**
  * @brief Create a UART driver instance
@@ -59,6 +63,8 @@ static int       _drv_uart_state[KD_HARD_UART_MAX_NUM]; /**< Tracks usage state
  */
 int _drv_uart_inst_create(int id, const char* dev, drv_uart_inst_t** inst)
 {
+    HAL_TRACE_FUNC();
+
     int  fd = -1;
     char dev_name[64];
 
@@ -94,16 +100,16 @@ int _drv_uart_inst_create(int id, const char* dev, drv_uart_inst_t** inst)
     }
 
     /* Open UART device */
-    if (0 > (fd = open(dev_name, O_RDWR | O_NONBLOCK))) {
+    if (0 > (fd = hal_io_open(dev_name, O_RDWR | O_NONBLOCK))) {
         printf("[hal_uart]: open %s failed\n", dev_name);
         return -1;
     }
 
     /* Allocate and initialize instance */
-    *inst = (drv_uart_inst_t*)malloc(sizeof(drv_uart_inst_t));
+    *inst = hal_slab_alloc(&uart_inst_cache);
     if (*inst == NULL) {
-        printf("[hal_uart]: malloc instance failed");
-        close(fd);
+        printf("[hal_uart]: alloc instance failed");
+        hal_io_close(fd);
         return -3;
     }
     memset(*inst, 0, sizeof(drv_uart_inst_t));
@@ -127,6 +133,8 @@ int _drv_uart_inst_create(int id, const char* dev, drv_uart_inst_t** inst)
  */
 void drv_uart_inst_destroy(drv_uart_inst_t** inst)
 {
+    HAL_TRACE_FUNC();
+
     int id, fd;
 
     /* Parameter validation */
@@ -147,7 +155,7 @@ void drv_uart_inst_destroy(drv_uart_inst_t** inst)
 
     /* Close file descriptor if open */
     if (0 <= fd) {
-        close(fd);
+        hal_io_close(fd);
     }
 
     /* Mark UART as available */
@@ -156,7 +164,7 @@ void drv_uart_inst_destroy(drv_uart_inst_t** inst)
     }
 
     /* Free instance memory */
-    free(*inst);
+    hal_slab_free(&uart_inst_cache, *inst);
     *inst = NULL;
 }
 
@@ -171,6 +179,8 @@ void drv_uart_inst_destroy(drv_uart_inst_t** inst)
  */
 size_t drv_uart_read(drv_uart_inst_t* inst, uint8_t* buffer, size_t size)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || inst->fd == -1 || buffer == NULL) {
         return -1;
@@ -180,7 +190,7 @@ size_t drv_uart_read(drv_uart_inst_t* inst, uint8_t* buffer, size_t size)
     }
 
     /* Perform read operation */
-    size_t bytes_read = read(inst->fd, (void*)buffer, size);
+    size_t bytes_read = hal_io_read(inst->fd, (void*)buffer, size);
     if (bytes_read < 0) {
         return -2;
     }
@@ -199,6 +209,8 @@ size_t drv_uart_read(drv_uart_inst_t* inst, uint8_t* buffer, size_t size)
  */
 size_t drv_uart_write(drv_uart_inst_t* inst, const uint8_t* buffer, size_t size)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || inst->fd == -1 || buffer == NULL) {
         return -1;
@@ -208,7 +220,7 @@ size_t drv_uart_write(drv_uart_inst_t* inst, const uint8_t* buffer, size_t size)
     }
 
     /* Perform write operation */
-    size_t bytes_written = write(inst->fd, buffer, size);
+    size_t bytes_written = hal_io_write(inst->fd, buffer, size);
     if (bytes_written < 0) {
         return -2;
     }
@@ -227,6 +239,8 @@ size_t drv_uart_write(drv_uart_inst_t* inst, const uint8_t* buffer, size_t size)
  */
 int drv_uart_poll(drv_uart_inst_t* inst, int timeout_ms)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || inst->fd < 0) {
         errno = EINVAL;
@@ -239,7 +253,7 @@ int drv_uart_poll(drv_uart_inst_t* inst, int timeout_ms)
                           .revents = 0 };
 
     /* Perform poll operation */
-    int ret = poll(&fds, 1, timeout_ms);
+    int ret = hal_io_poll(&fds, 1, timeout_ms);
     if (ret < 0) {
         return -errno;
     }
@@ -261,6 +275,8 @@ int drv_uart_poll(drv_uart_inst_t* inst, int timeout_ms)
  */
 size_t drv_uart_recv_available(drv_uart_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || inst->fd == -1) {
         return -1;
@@ -268,7 +284,7 @@ size_t drv_uart_recv_available(drv_uart_inst_t* inst)
 
     /* Get available bytes count */
     size_t bytes_available;
-    if (ioctl(inst->fd, FIONREAD, &bytes_available) < 0) {
+    if (hal_io_ioctl(inst->fd, FIONREAD, &bytes_available) < 0) {
         return -2;
     }
 
@@ -295,6 +311,8 @@ size_t drv_uart_recv_available(drv_uart_inst_t* inst)
  */
 int drv_uart_is_dtr_asserted(drv_uart_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || inst->fd == -1) {
         return -1;
@@ -306,7 +324,7 @@ int drv_uart_is_dtr_asserted(drv_uart_inst_t* inst)
     }
 
     int dtr = 0;
-    if (ioctl(inst->fd, UART_IOCTL_GET_DTR, &dtr) < 0) {
+    if (hal_io_ioctl(inst->fd, UART_IOCTL_GET_DTR, &dtr) < 0) {
         return -2;
     }
 
@@ -331,13 +349,15 @@ int drv_uart_is_dtr_asserted(drv_uart_inst_t* inst)
  */
 int drv_uart_send_break(drv_uart_inst_t* inst)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || inst->fd == -1) {
         return -1;
     }
 
     /* Send break via IOCTL */
-    if (ioctl(inst->fd, UART_IOCTL_SEND_BREAK, NULL) < 0) {
+    if (hal_io_ioctl(inst->fd, UART_IOCTL_SEND_BREAK, NULL) < 0) {
         return -2;
     }
 
@@ -355,6 +375,8 @@ int drv_uart_send_break(drv_uart_inst_t* inst)
  */
 int drv_uart_set_config(drv_uart_inst_t* inst, struct uart_configure* cfg)
 {
+    HAL_TRACE_FUNC();
+
     struct uart_configure curr;
 
     /* Parameter validation */
@@ -368,7 +390,7 @@ int drv_uart_set_config(drv_uart_inst_t* inst, struct uart_configure* cfg)
     cfg->bufsz = curr.bufsz;
 
     /* Set configuration via IOCTL */
-    if (ioctl(inst->fd, UART_IOCTL_SET_CONFIG, cfg) < 0) {
+    if (hal_io_ioctl(inst->fd, UART_IOCTL_SET_CONFIG, cfg) < 0) {
         return -2;
     }
 
@@ -385,13 +407,15 @@ int drv_uart_set_config(drv_uart_inst_t* inst, struct uart_configure* cfg)
  */
 int drv_uart_get_config(drv_uart_inst_t* inst, struct uart_configure* cfg)
 {
+    HAL_TRACE_FUNC();
+
     /* Parameter validation */
     if (inst == NULL || cfg == NULL || inst->fd == -1) {
         return -1;
     }
 
     /* Get configuration via IOCTL */
-    if (ioctl(inst->fd, UART_IOCTL_GET_CONFIG, cfg) < 0) {
+    if (hal_io_ioctl(inst->fd, UART_IOCTL_GET_CONFIG, cfg) < 0) {
         return -2;
     }
 
@@ -412,6 +436,8 @@ int drv_uart_get_config(drv_uart_inst_t* inst, struct uart_configure* cfg)
  */
 int drv_uart_configure_buffer_size(int id, uint16_t size)
 {
+    HAL_TRACE_FUNC();
+
     char        dev_name[64]; // Buffer to store UART device name (e.g., "uart0")
     rt_device_t device = NULL; // Handle for the UART device
 
@@ -432,7 +458,12 @@ int drv_uart_configure_buffer_size(int id, uint16_t size)
     snprintf(dev_name, sizeof(dev_name), "uart%d", id);
 
     /* Find the UART device by name */
+#ifdef HAL_IO_BACKEND
+    /* simulated nodes have no rt-thread device object behind them */
+    device = NULL;
+#else
     device = rt_device_find(dev_name);
+#endif
     if (NULL == device) {
         printf("[hal_uart]: can not find device %s\n", dev_name);
         return -2; // Error: Device not found
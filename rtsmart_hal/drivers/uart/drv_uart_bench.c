@@ -0,0 +1,335 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_uart.h"
+#include "drv_uart_bench.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define BENCH_CHUNK   (4096)
+#define BENCH_POLL_MS (50)
+
+struct uart_bench_writer {
+    drv_uart_inst_t* uart;
+    uint32_t         msg_size;
+    uint64_t         total;
+    volatile int     stop;
+
+    uint64_t writes, waits;
+};
+
+struct uart_bench_echo {
+    drv_uart_inst_t* uart;
+    volatile int     stop;
+};
+
+/* byte @off of the test stream, not periodic in any power of two below 64 KiB */
+static inline uint8_t bench_pattern(uint64_t off)
+{
+    return (uint8_t)(off + (off >> 8) * 7 + (off >> 16) * 13);
+}
+
+static uint64_t bench_cpu_ns(void)
+{
+    struct timespec ts;
+
+    if (0x00 != clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts)) {
+        return UINT64_MAX;
+    }
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int32_t bench_cpu_permille(uint64_t cpu_start, uint64_t wall_ticks)
+{
+    uint64_t cpu_end = bench_cpu_ns();
+    uint64_t wall_ns = utils_cpu_ticks_to_ns(wall_ticks);
+
+    if ((UINT64_MAX == cpu_start) || (UINT64_MAX == cpu_end) || (0x00 == wall_ns)) {
+        return -1;
+    }
+
+    return (int32_t)((cpu_end - cpu_start) * 1000 / wall_ns);
+}
+
+/* write all of @buf, waiting for room in the tx buffer, 0 or -1 when stopped or broken */
+static int bench_write_all(drv_uart_inst_t* uart, const uint8_t* buf, size_t len, volatile int* stop, uint64_t* writes,
+                           uint64_t* waits)
+{
+    struct pollfd fds = { .fd = uart->fd, .events = POLLOUT };
+    size_t        n;
+
+    while (len) {
+        n = drv_uart_write(uart, buf, len);
+        if (((size_t)-1 == n) || ((size_t)-2 == n) || (0x00 == n)) {
+            if (stop && *stop) {
+                return -1;
+            }
+            if (waits) {
+                (*waits)++;
+            }
+            if (0 > hal_io_poll(&fds, 1, BENCH_POLL_MS)) {
+                return -1;
+            }
+            continue;
+        }
+        if (writes) {
+            (*writes)++;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static void* bench_writer_thread(void* args)
+{
+    struct uart_bench_writer* w = args;
+    uint8_t                   buf[BENCH_CHUNK];
+    uint64_t                  off = 0;
+    size_t                    len;
+
+    while ((off < w->total) && !w->stop) {
+        len = (w->total - off < w->msg_size) ? (size_t)(w->total - off) : w->msg_size;
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = bench_pattern(off + i);
+        }
+        if (0x00 != bench_write_all(w->uart, buf, len, &w->stop, &w->writes, &w->waits)) {
+            break;
+        }
+        off += len;
+    }
+
+    return NULL;
+}
+
+int drv_uart_bench_throughput(drv_uart_inst_t* tx, drv_uart_inst_t* rx, uint32_t msg_size, uint64_t total,
+                              int timeout_ms, uart_bench_tput_t* res)
+{
+    HAL_TRACE_FUNC();
+
+    struct uart_bench_writer w = { 0 };
+    pthread_t                thread;
+    uint8_t                  buf[BENCH_CHUNK];
+    uint64_t                 start, last, cpu;
+    size_t                   n;
+    int                      ret = 0;
+
+    if ((NULL == tx) || (NULL == rx) || (NULL == res) || (0x00 == msg_size) || (BENCH_CHUNK < msg_size)
+        || (0x00 == total) || (0 >= timeout_ms)) {
+        return -1;
+    }
+
+    memset(res, 0, sizeof(*res));
+    res->msg_size = msg_size;
+
+    w.uart     = tx;
+    w.msg_size = msg_size;
+    w.total    = total;
+
+    cpu   = bench_cpu_ns();
+    start = utils_cpu_ticks();
+    last  = start;
+    if (0x00 != pthread_create(&thread, NULL, bench_writer_thread, &w)) {
+        printf("[hal_uart]: create bench writer failed\n");
+        return -4;
+    }
+
+    while (res->bytes < total) {
+        res->polls++;
+        if (0 >= drv_uart_poll(rx, BENCH_POLL_MS)) {
+            if ((utils_cpu_ticks() - last) > (uint64_t)timeout_ms * (CPU_TICKS_PER_SECOND / 1000)) {
+                ret = -2;
+                break;
+            }
+            continue;
+        }
+
+        n = drv_uart_read(rx, buf, (total - res->bytes < msg_size) ? (size_t)(total - res->bytes) : msg_size);
+        if (((size_t)-1 == n) || ((size_t)-2 == n) || (0x00 == n)) {
+            continue;
+        }
+        res->reads++;
+        for (size_t i = 0; i < n; i++) {
+            res->errors += (buf[i] != bench_pattern(res->bytes + i));
+        }
+        res->bytes += n;
+        last = utils_cpu_ticks();
+    }
+
+    w.stop = 1;
+    pthread_join(thread, NULL);
+
+    res->elapsed_ns    = utils_cpu_ticks_to_ns(last - start);
+    res->bytes_per_sec = res->elapsed_ns ? res->bytes * 1000000000ULL / res->elapsed_ns : 0;
+    res->writes        = w.writes;
+    res->write_waits   = w.waits;
+    res->cpu_permille  = bench_cpu_permille(cpu, last - start);
+
+    return ret;
+}
+
+static void* bench_echo_thread(void* args)
+{
+    struct uart_bench_echo* e = args;
+    uint8_t                 buf[BENCH_CHUNK];
+    size_t                  n;
+
+    while (!e->stop) {
+        if (0 >= drv_uart_poll(e->uart, BENCH_POLL_MS)) {
+            continue;
+        }
+        n = drv_uart_read(e->uart, buf, sizeof(buf));
+        if (((size_t)-1 == n) || ((size_t)-2 == n) || (0x00 == n)) {
+            continue;
+        }
+        if (0x00 != bench_write_all(e->uart, buf, n, &e->stop, NULL, NULL)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int bench_cmp_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+/* nearest rank, @p in tenths of a percent */
+static uint64_t bench_percentile(const uint64_t* sorted, uint32_t count, uint32_t p)
+{
+    uint64_t rank = ((uint64_t)count * p + 999) / 1000;
+
+    return sorted[rank ? rank - 1 : 0];
+}
+
+int drv_uart_bench_rtt(drv_uart_inst_t* uart, drv_uart_inst_t* echo, uint32_t msg_size, uint32_t count,
+                       int timeout_ms, uart_bench_rtt_t* res)
+{
+    HAL_TRACE_FUNC();
+
+    struct uart_bench_echo e = { 0 };
+    pthread_t              thread;
+    uint8_t                msg[BENCH_CHUNK], back[BENCH_CHUNK], junk[64];
+    uint64_t*              samples;
+    uint64_t               start, deadline, t0, sum = 0, cpu;
+    size_t                 got, n;
+
+    if ((NULL == uart) || (NULL == res) || (0x00 == msg_size) || (BENCH_CHUNK < msg_size) || (0x00 == count)
+        || (0 >= timeout_ms)) {
+        return -1;
+    }
+
+    if (NULL == (samples = hal_slab_buf_alloc(count * sizeof(*samples)))) {
+        printf("[hal_uart]: alloc %u rtt samples failed\n", count);
+        return -3;
+    }
+
+    memset(res, 0, sizeof(*res));
+    res->msg_size = msg_size;
+
+    if (echo) {
+        e.uart = echo;
+        if (0x00 != pthread_create(&thread, NULL, bench_echo_thread, &e)) {
+            printf("[hal_uart]: create bench echo failed\n");
+            hal_slab_buf_free(samples);
+            return -4;
+        }
+    }
+
+    cpu   = bench_cpu_ns();
+    start = utils_cpu_ticks();
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = 0; j < msg_size; j++) {
+            msg[j] = bench_pattern((uint64_t)i * msg_size + j);
+        }
+
+        /* late echoes of an abandoned round trip */
+        while (0 < drv_uart_poll(uart, 0)) {
+            n = drv_uart_read(uart, junk, sizeof(junk));
+            if (((size_t)-1 == n) || ((size_t)-2 == n) || (0x00 == n)) {
+                break;
+            }
+        }
+
+        t0       = utils_cpu_ticks();
+        deadline = t0 + (uint64_t)timeout_ms * (CPU_TICKS_PER_SECOND / 1000);
+        bench_write_all(uart, msg, msg_size, NULL, NULL, NULL);
+
+        for (got = 0; (got < msg_size) && (utils_cpu_ticks() < deadline);) {
+            if (0 >= drv_uart_poll(uart, (int)((deadline - utils_cpu_ticks()) / (CPU_TICKS_PER_SECOND / 1000)) + 1)) {
+                continue;
+            }
+            n = drv_uart_read(uart, back + got, msg_size - got);
+            if (((size_t)-1 == n) || ((size_t)-2 == n)) {
+                continue;
+            }
+            got += n;
+        }
+
+        if (got < msg_size) {
+            res->timeouts++;
+            continue;
+        }
+        samples[res->count] = utils_cpu_ticks_to_ns(utils_cpu_ticks() - t0);
+        sum += samples[res->count++];
+        res->errors += (0x00 != memcmp(msg, back, msg_size));
+    }
+    res->cpu_permille = bench_cpu_permille(cpu, utils_cpu_ticks() - start);
+
+    if (echo) {
+        e.stop = 1;
+        pthread_join(thread, NULL);
+    }
+
+    if (res->count) {
+        qsort(samples, res->count, sizeof(*samples), bench_cmp_u64);
+        res->rtt_ns_min  = samples[0];
+        res->rtt_ns_p50  = bench_percentile(samples, res->count, 500);
+        res->rtt_ns_p90  = bench_percentile(samples, res->count, 900);
+        res->rtt_ns_p99  = bench_percentile(samples, res->count, 990);
+        res->rtt_ns_p999 = bench_percentile(samples, res->count, 999);
+        res->rtt_ns_max  = samples[res->count - 1];
+        res->rtt_ns_mean = sum / res->count;
+    }
+    hal_slab_buf_free(samples);
+
+    return 0;
+}
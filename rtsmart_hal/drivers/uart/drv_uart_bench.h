@@ -0,0 +1,88 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "drv_uart.h"
+
+typedef struct _uart_bench_tput {
+    uint32_t msg_size; // bytes per write and per read
+    uint64_t bytes; // bytes received and checked
+    uint64_t elapsed_ns; // first write to last byte read
+    uint64_t bytes_per_sec;
+    uint64_t writes; // drv_uart_write() calls that took data
+    uint64_t write_waits; // writes refused with a full tx buffer
+    uint64_t reads; // drv_uart_read() calls that returned data
+    uint64_t polls; // drv_uart_poll() calls
+    uint64_t errors; // bytes that did not match the sent pattern
+    int32_t  cpu_permille; // process cpu time per wall time, all cores, -1 unknown
+} uart_bench_tput_t;
+
+typedef struct _uart_bench_rtt {
+    uint32_t msg_size;
+    uint32_t count; // round trips completed
+    uint32_t timeouts; // round trips abandoned
+    uint32_t errors; // echoes that did not match
+    uint64_t rtt_ns_min; // first byte written to last echoed byte read
+    uint64_t rtt_ns_p50;
+    uint64_t rtt_ns_p90;
+    uint64_t rtt_ns_p99;
+    uint64_t rtt_ns_p999;
+    uint64_t rtt_ns_max;
+    uint64_t rtt_ns_mean;
+    int32_t  cpu_permille;
+} uart_bench_rtt_t;
+
+/**
+ * @brief Stream @total bytes of a counting pattern from @tx to @rx, @msg_size
+ *        bytes per drv_uart_write() from a writer thread and up to @msg_size
+ *        per drv_uart_read() after a drv_uart_poll() in the caller, and check
+ *        every byte. @tx and @rx may be the same instance on a loopback.
+ * @return 0 on success, -1 on invalid parameters, -2 if the stream stalled
+ *         for @timeout_ms (@res holds what arrived until then), -4 if the
+ *         writer thread could not be created.
+ */
+int drv_uart_bench_throughput(drv_uart_inst_t* tx, drv_uart_inst_t* rx, uint32_t msg_size, uint64_t total,
+                              int timeout_ms, uart_bench_tput_t* res);
+
+/**
+ * @brief Send @count messages of @msg_size bytes on @uart one at a time and
+ *        wait for each to come back. @echo is served by an echo thread, NULL
+ *        when the far end echoes by itself (loopback plug, remote echo).
+ * @return 0 on success, -1 on invalid parameters, -3 on allocation failure,
+ *         -4 if the echo thread could not be created.
+ */
+int drv_uart_bench_rtt(drv_uart_inst_t* uart, drv_uart_inst_t* echo, uint32_t msg_size, uint32_t count,
+                       int timeout_ms, uart_bench_rtt_t* res);
+
+#ifdef __cplusplus
+}
+#endif
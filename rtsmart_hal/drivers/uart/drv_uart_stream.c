@@ -0,0 +1,680 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_uart.h"
+#include "drv_uart_stream.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define STREAM_DFT_BUF_SIZE   (4096)
+#define STREAM_DFT_MAX_FRAME  (256)
+#define STREAM_DFT_MAX_FRAMES (64)
+#define STREAM_MAX_SIZE       (1U << 30)
+
+/* a frame found by the parser, waiting to be handed out or released */
+struct uart_stream_desc {
+    uint64_t start, end; // stream offsets, end includes the delimiter
+    uint64_t ticks;
+    uint32_t len;
+};
+
+struct _drv_uart_stream {
+    void* base;
+
+    drv_uart_inst_t*   uart;
+    struct uart_framer framer;
+
+    /*
+     * Every position is a stream offset, the ring index is offset & (size - 1).
+     * tail <= parse <= head, bytes below tail are free, frames between tail and
+     * parse belong to the reader, the reader thread only writes at head.
+     */
+    uint8_t* ring; // size bytes plus max_frame of mirror for frames that wrap
+    uint32_t size, max_frame;
+    uint64_t head, tail, parse;
+    uint64_t scan; // DELIM and COBS: searched for the delimiter up to here
+    int      discard; // dropping an oversize frame up to the next delimiter
+    uint64_t last_ticks; // when the last read returned
+
+    struct uart_stream_desc* desc;
+    uint32_t                 desc_size;
+    uint64_t                 desc_tail, desc_next, desc_head; // released, handed out, queued
+
+    pthread_mutex_t lock;
+    pthread_cond_t  ready, space;
+    pthread_t       thread;
+    int             threaded, running;
+    int             wake_fd[2];
+
+    uint64_t rx_bytes, reads, frames, errors, dropped, stalls;
+    uint64_t latency_max, latency_sum, start;
+    uint32_t max_fill;
+};
+
+static const int uart_stream_type;
+static HAL_SLAB_CACHE_DEFINE(uart_stream_cache, "drv_uart_stream", drv_uart_stream_t);
+
+static uint32_t round_pow2(uint32_t value)
+{
+    uint32_t size = 1;
+
+    while (size < value) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+static int stream_full(drv_uart_stream_t* s)
+{
+    return (s->size == (s->head - s->tail)) || (s->desc_size == (s->desc_head - s->desc_tail));
+}
+
+/* stream offset of the first @c in [from, to) */
+static int stream_find(drv_uart_stream_t* s, uint8_t c, uint64_t from, uint64_t to, uint64_t* at)
+{
+    while (from < to) {
+        uint32_t off = from & (s->size - 1);
+        size_t   len = s->size - off;
+        uint8_t* hit;
+
+        if (len > to - from) {
+            len = to - from;
+        }
+        if (NULL != (hit = memchr(s->ring + off, c, len))) {
+            *at = from + (hit - (s->ring + off));
+            return 1;
+        }
+        from += len;
+    }
+
+    return 0;
+}
+
+static void stream_push(drv_uart_stream_t* s, uint64_t start, uint32_t len, uint64_t end)
+{
+    struct uart_stream_desc* d = &s->desc[s->desc_head & (s->desc_size - 1)];
+
+    d->start = start;
+    d->end   = end;
+    d->len   = len;
+    d->ticks = s->last_ticks;
+    s->desc_head++;
+
+    pthread_cond_signal(&s->ready);
+}
+
+/* cut the bytes between parse and head into frames, with the lock held */
+static void stream_parse(drv_uart_stream_t* s)
+{
+    struct uart_framer* f = &s->framer;
+    uint64_t            at, field;
+    int64_t             total, hdr;
+
+    while (s->desc_size != (s->desc_head - s->desc_tail)) {
+        switch (f->type) {
+        case UART_FRAMER_DELIM:
+        case UART_FRAMER_COBS:
+            if (!stream_find(s, f->delim, s->scan, s->head, &at)) {
+                s->scan = s->head;
+                if (!s->discard && (s->max_frame < (s->head - s->parse))) {
+                    s->errors++;
+                    s->discard = 1;
+                }
+                if (s->discard) {
+                    s->dropped += s->head - s->parse;
+                    s->parse = s->head;
+                }
+                goto out;
+            }
+            if (s->discard || (s->max_frame < (at - s->parse))) {
+                s->errors += s->discard ? 0 : 1;
+                s->dropped += at - s->parse;
+                s->discard = 0;
+            } else if (at != s->parse) {
+                /* back to back delimiters are idle fill, not empty frames */
+                stream_push(s, s->parse, at - s->parse, at + 1);
+            }
+            s->parse = s->scan = at + 1;
+            break;
+
+        case UART_FRAMER_LENGTH:
+            hdr = f->len_offset + f->len_size;
+            if (hdr > (int64_t)(s->head - s->parse)) {
+                goto out;
+            }
+            field = 0;
+            for (int i = 0; i < f->len_size; i++) {
+                int n = f->len_big_endian ? i : (f->len_size - 1 - i);
+                field = (field << 8) | s->ring[(s->parse + f->len_offset + n) & (s->size - 1)];
+            }
+            total = hdr + (int64_t)field + f->len_adjust;
+            if ((total < hdr) || (total > s->max_frame)) {
+                /* not a header, slide by one byte to find the next one */
+                s->errors++;
+                s->dropped++;
+                s->parse++;
+                break;
+            }
+            if (total > (int64_t)(s->head - s->parse)) {
+                goto out;
+            }
+            stream_push(s, s->parse, total, s->parse + total);
+            s->parse += total;
+            break;
+
+        case UART_FRAMER_FIXED:
+            if (f->size > (s->head - s->parse)) {
+                goto out;
+            }
+            stream_push(s, s->parse, f->size, s->parse + f->size);
+            s->parse += f->size;
+            break;
+
+        default:
+            if (s->head == s->parse) {
+                goto out;
+            }
+            total = s->head - s->parse;
+            total = (total > s->max_frame) ? s->max_frame : total;
+            stream_push(s, s->parse, total, s->parse + total);
+            s->parse += total;
+            break;
+        }
+    }
+
+out:
+    /* nothing left to release, dropped bytes are free right away */
+    if (s->desc_tail == s->desc_head) {
+        s->tail = s->parse;
+    }
+}
+
+/*
+ * Read once into the free part of the ring, with the lock held, the lock is
+ * dropped around the read itself.
+ */
+static int stream_read(drv_uart_stream_t* s)
+{
+    uint32_t off = s->head & (s->size - 1);
+    size_t   room;
+    ssize_t  got;
+
+    stream_parse(s);
+    if (stream_full(s)) {
+        s->stalls++;
+        return 0;
+    }
+
+    room = s->size - (s->head - s->tail);
+    if (room > s->size - off) {
+        room = s->size - off;
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    got = hal_io_read(s->uart->fd, s->ring + off, room);
+    pthread_mutex_lock(&s->lock);
+
+    if (0 >= got) {
+        return ((0 > got) && (EAGAIN != errno) && (EWOULDBLOCK != errno)) ? -1 : 0;
+    }
+
+    s->last_ticks = utils_cpu_ticks();
+    s->head += got;
+    s->rx_bytes += got;
+    s->reads++;
+    if (s->max_fill < (s->head - s->tail)) {
+        s->max_fill = s->head - s->tail;
+    }
+    stream_parse(s);
+
+    return got;
+}
+
+static void* stream_thread(void* args)
+{
+    drv_uart_stream_t* s      = (drv_uart_stream_t*)args;
+    struct pollfd      fds[2] = {
+        { .fd = s->uart->fd, .events = POLLIN },
+        { .fd = s->wake_fd[0], .events = POLLIN },
+    };
+    int ret;
+
+    pthread_mutex_lock(&s->lock);
+    while (s->running) {
+        if (0 < (ret = stream_read(s))) {
+            continue;
+        }
+        if (0 > ret) {
+            pthread_mutex_unlock(&s->lock);
+            usleep(10 * 1000);
+            pthread_mutex_lock(&s->lock);
+            continue;
+        }
+        if (stream_full(s)) {
+            pthread_cond_wait(&s->space, &s->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&s->lock);
+        ret = hal_io_poll(fds, 2, -1);
+        if ((0 < ret) && (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            /* cdc port unplugged or hung up, do not spin on it */
+            usleep(10 * 1000);
+        }
+        pthread_mutex_lock(&s->lock);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+/* decode a COBS frame in place, the terminating 0x00 is already stripped */
+static int cobs_decode(uint8_t* buf, size_t len)
+{
+    size_t in = 0, out = 0;
+
+    while (in < len) {
+        uint8_t code = buf[in++];
+
+        if ((0x00 == code) || (in + code - 1 > len)) {
+            return -1;
+        }
+        memmove(buf + out, buf + in, code - 1);
+        out += code - 1;
+        in += code - 1;
+        if ((0xFF != code) && (in < len)) {
+            buf[out++] = 0x00;
+        }
+    }
+
+    return out;
+}
+
+int drv_uart_stream_create(drv_uart_inst_t* uart, const struct uart_stream_config* cfg, drv_uart_stream_t** stream)
+{
+    HAL_TRACE_FUNC();
+
+    struct uart_framer  framer;
+    pthread_condattr_t  attr;
+    uint32_t            size, max_frame, max_frames;
+    drv_uart_stream_t*  s;
+
+    if ((NULL == uart) || (0 > uart->fd) || (NULL == cfg) || (NULL == stream)) {
+        return -1;
+    }
+
+    size       = cfg->buf_size ? cfg->buf_size : STREAM_DFT_BUF_SIZE;
+    max_frame  = cfg->max_frame ? cfg->max_frame : STREAM_DFT_MAX_FRAME;
+    max_frames = cfg->max_frames ? cfg->max_frames : STREAM_DFT_MAX_FRAMES;
+    if ((STREAM_MAX_SIZE < size) || (STREAM_MAX_SIZE < max_frames)) {
+        printf("[hal_uart]: stream buffer too large\n");
+        return -1;
+    }
+    size       = round_pow2(size);
+    max_frames = round_pow2(max_frames);
+    if (size < max_frame) {
+        printf("[hal_uart]: max frame %u larger than the %u byte ring\n", max_frame, size);
+        return -1;
+    }
+
+    framer = cfg->framer;
+    switch (framer.type) {
+    case UART_FRAMER_RAW:
+    case UART_FRAMER_DELIM:
+        break;
+    case UART_FRAMER_COBS:
+        framer.delim = 0x00;
+        break;
+    case UART_FRAMER_LENGTH:
+        if (((1 != framer.len_size) && (2 != framer.len_size) && (4 != framer.len_size))
+            || (max_frame < (uint32_t)framer.len_offset + framer.len_size)) {
+            printf("[hal_uart]: invalid length field\n");
+            return -2;
+        }
+        break;
+    case UART_FRAMER_FIXED:
+        if ((0x00 == framer.size) || (max_frame < framer.size)) {
+            printf("[hal_uart]: invalid fixed frame size %u\n", framer.size);
+            return -2;
+        }
+        break;
+    default:
+        printf("[hal_uart]: invalid framer %d\n", framer.type);
+        return -2;
+    }
+
+    if (*stream) {
+        drv_uart_stream_destroy(stream);
+        *stream = NULL;
+    }
+
+    s = hal_slab_zalloc(&uart_stream_cache);
+    if (NULL == s) {
+        printf("[hal_uart]: alloc stream failed\n");
+        return -3;
+    }
+    s->base       = (void*)&uart_stream_type;
+    s->uart       = uart;
+    s->framer     = framer;
+    s->size       = size;
+    s->max_frame  = max_frame;
+    s->desc_size  = max_frames;
+    s->wake_fd[0] = s->wake_fd[1] = -1;
+    s->start      = utils_cpu_ticks();
+
+    s->ring = hal_slab_buf_alloc(size + max_frame);
+    s->desc = hal_slab_buf_alloc(max_frames * sizeof(struct uart_stream_desc));
+    if ((NULL == s->ring) || (NULL == s->desc)) {
+        printf("[hal_uart]: alloc %u byte stream buffer failed\n", size);
+        hal_slab_buf_free(s->ring);
+        hal_slab_buf_free(s->desc);
+        hal_slab_free(&uart_stream_cache, s);
+        return -3;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->ready, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&s->space, NULL);
+
+    if (cfg->thread) {
+        if (0x00 != pipe(s->wake_fd)) {
+            printf("[hal_uart]: create stream pipe failed\n");
+            goto err_thread;
+        }
+        fcntl(s->wake_fd[0], F_SETFL, fcntl(s->wake_fd[0], F_GETFL) | O_NONBLOCK);
+
+        s->threaded = 1;
+        s->running  = 1;
+        if (0x00 != pthread_create(&s->thread, NULL, stream_thread, s)) {
+            printf("[hal_uart]: create stream reader thread failed\n");
+            goto err_thread;
+        }
+    }
+
+    *stream = s;
+
+    return 0;
+
+err_thread:
+    if (0 <= s->wake_fd[0]) {
+        close(s->wake_fd[0]);
+        close(s->wake_fd[1]);
+    }
+    pthread_cond_destroy(&s->ready);
+    pthread_cond_destroy(&s->space);
+    pthread_mutex_destroy(&s->lock);
+    hal_slab_buf_free(s->ring);
+    hal_slab_buf_free(s->desc);
+    hal_slab_free(&uart_stream_cache, s);
+
+    return -4;
+}
+
+void drv_uart_stream_destroy(drv_uart_stream_t** stream)
+{
+    HAL_TRACE_FUNC();
+
+    drv_uart_stream_t* s;
+
+    if ((NULL == stream) || (NULL == *stream)) {
+        return;
+    }
+    s = *stream;
+
+    if ((void*)&uart_stream_type != s->base) {
+        printf("[hal_uart]: inst not uart stream\n");
+        return;
+    }
+
+    if (s->threaded) {
+        pthread_mutex_lock(&s->lock);
+        s->running = 0;
+        pthread_cond_signal(&s->space);
+        pthread_mutex_unlock(&s->lock);
+        if (0 > write(s->wake_fd[1], "", 1)) {
+            printf("[hal_uart]: wake stream reader failed\n");
+        }
+        pthread_join(s->thread, NULL);
+
+        close(s->wake_fd[0]);
+        close(s->wake_fd[1]);
+    }
+
+    pthread_cond_destroy(&s->ready);
+    pthread_cond_destroy(&s->space);
+    pthread_mutex_destroy(&s->lock);
+    hal_slab_buf_free(s->ring);
+    hal_slab_buf_free(s->desc);
+    s->base = NULL;
+
+    hal_slab_free(&uart_stream_cache, s);
+    *stream = NULL;
+}
+
+int drv_uart_stream_fill(drv_uart_stream_t* stream)
+{
+    HAL_TRACE_FUNC();
+
+    int got, total = 0;
+
+    if ((NULL == stream) || ((void*)&uart_stream_type != stream->base) || stream->threaded) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    while (0 < (got = stream_read(stream))) {
+        total += got;
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    return (0 > got) ? -1 : total;
+}
+
+int drv_uart_stream_next(drv_uart_stream_t* stream, uart_frame_t* frame, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_uart_stream_t*       s = stream;
+    struct uart_stream_desc* d;
+    struct timespec          deadline;
+    uint64_t                 until = 0, now;
+    uint32_t                 off;
+    int                      len, ret = 0;
+
+    if ((NULL == s) || ((void*)&uart_stream_type != s->base) || (NULL == frame)) {
+        return -1;
+    }
+
+    if (0 < timeout_ms) {
+        until = utils_cpu_ticks_ms() + timeout_ms;
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (s->desc_next != s->desc_head) {
+            d = &s->desc[s->desc_next & (s->desc_size - 1)];
+            s->desc_next++;
+
+            /* mirror the wrapped part behind the ring so the frame is contiguous */
+            off = d->start & (s->size - 1);
+            if (s->size < off + d->len) {
+                memcpy(s->ring + s->size, s->ring, off + d->len - s->size);
+            }
+
+            len = d->len;
+            if ((UART_FRAMER_COBS == s->framer.type) && (0 > (len = cobs_decode(s->ring + off, d->len)))) {
+                s->errors++;
+                s->dropped += d->end - d->start;
+                if (s->desc_tail + 1 == s->desc_next) {
+                    s->desc_tail++;
+                    s->tail = (s->desc_tail == s->desc_head) ? s->parse : d->end;
+                    pthread_cond_signal(&s->space);
+                }
+                continue;
+            }
+
+            now = utils_cpu_ticks();
+            s->frames++;
+            s->latency_sum += now - d->ticks;
+            if (s->latency_max < now - d->ticks) {
+                s->latency_max = now - d->ticks;
+            }
+
+            frame->data  = s->ring + off;
+            frame->len   = len;
+            frame->ticks = d->ticks;
+            frame->end   = d->end;
+            pthread_mutex_unlock(&s->lock);
+
+            return 1;
+        }
+
+        if (0x00 == timeout_ms) {
+            break;
+        }
+
+        if (s->threaded) {
+            if (ETIMEDOUT == utils_cond_wait(&s->ready, &s->lock, (0 > timeout_ms) ? NULL : &deadline)) {
+                timeout_ms = 0;
+            }
+            continue;
+        }
+
+        if (0 > (ret = stream_read(s))) {
+            break;
+        }
+        if ((0 < ret) || (s->desc_next != s->desc_head)) {
+            continue;
+        }
+        if (stream_full(s)) {
+            /* only releasing frames makes room */
+            break;
+        }
+
+        now = utils_cpu_ticks_ms();
+        if ((0 < timeout_ms) && (now >= until)) {
+            break;
+        }
+        pthread_mutex_unlock(&s->lock);
+        ret = drv_uart_poll(s->uart, (0 > timeout_ms) ? -1 : (int)(until - now));
+        pthread_mutex_lock(&s->lock);
+        if (0 >= ret) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return (0 > ret) ? -1 : 0;
+}
+
+int drv_uart_stream_release(drv_uart_stream_t* stream, const uart_frame_t* frame)
+{
+    HAL_TRACE_FUNC();
+
+    drv_uart_stream_t* s = stream;
+
+    if ((NULL == s) || ((void*)&uart_stream_type != s->base) || (NULL == frame)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (frame->end > s->parse) {
+        pthread_mutex_unlock(&s->lock);
+        printf("[hal_uart]: release of a frame not taken\n");
+        return -1;
+    }
+
+    while ((s->desc_tail != s->desc_next) && (frame->end >= s->desc[s->desc_tail & (s->desc_size - 1)].end)) {
+        s->desc_tail++;
+    }
+    if (s->desc_tail == s->desc_head) {
+        s->tail = s->parse;
+    } else if (s->tail < frame->end) {
+        s->tail = frame->end;
+    }
+    pthread_cond_signal(&s->space);
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+int drv_uart_stream_get_stats(drv_uart_stream_t* stream, uart_stream_stats_t* stats)
+{
+    uint64_t elapsed;
+
+    if ((NULL == stream) || ((void*)&uart_stream_type != stream->base) || (NULL == stats)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    elapsed = utils_cpu_ticks() - stream->start;
+
+    stats->rx_bytes        = stream->rx_bytes;
+    stats->reads           = stream->reads;
+    stats->frames          = stream->frames;
+    stats->errors          = stream->errors;
+    stats->dropped         = stream->dropped;
+    stats->stalls          = stream->stalls;
+    stats->rx_bps          = elapsed ? (stream->rx_bytes * CPU_TICKS_PER_SECOND / elapsed) : 0;
+    stats->latency_ns_max  = utils_cpu_ticks_to_ns(stream->latency_max);
+    stats->latency_ns_mean = stream->frames ? utils_cpu_ticks_to_ns(stream->latency_sum / stream->frames) : 0;
+    stats->max_fill        = stream->max_fill;
+    pthread_mutex_unlock(&stream->lock);
+
+    return 0;
+}
+
+void drv_uart_stream_reset_stats(drv_uart_stream_t* stream)
+{
+    if ((NULL == stream) || ((void*)&uart_stream_type != stream->base)) {
+        return;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    stream->rx_bytes = stream->reads = stream->frames = 0;
+    stream->errors = stream->dropped = stream->stalls = 0;
+    stream->latency_max = stream->latency_sum = 0;
+    stream->max_fill = stream->head - stream->tail;
+    stream->start    = utils_cpu_ticks();
+    pthread_mutex_unlock(&stream->lock);
+}
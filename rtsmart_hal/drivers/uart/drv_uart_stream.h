@@ -0,0 +1,128 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "drv_uart.h"
+
+typedef enum _uart_framer_type {
+    UART_FRAMER_RAW = 0, // whatever arrived, at most max_frame bytes per frame
+    UART_FRAMER_DELIM, // frames end with framer.delim, the delimiter is not part of the frame
+    UART_FRAMER_LENGTH, // header with a 1, 2 or 4 byte length field, the frame keeps the header
+    UART_FRAMER_COBS, // COBS encoded, 0x00 terminated, the frame is decoded in place
+    UART_FRAMER_FIXED, // framer.size bytes each
+} uart_framer_type_t;
+
+struct uart_framer {
+    uart_framer_type_t type;
+
+    uint8_t  delim; // DELIM: end of frame byte
+    uint8_t  len_size; // LENGTH: 1, 2 or 4
+    uint8_t  len_big_endian; // LENGTH: field byte order
+    uint16_t len_offset; // LENGTH: header bytes before the field
+    int32_t  len_adjust; // LENGTH: frame size is len_offset + len_size + field + len_adjust
+    uint32_t size; // FIXED: frame size
+};
+
+struct uart_stream_config {
+    uint32_t buf_size; // ring bytes, rounded up to a power of 2, 0: 4096
+    uint32_t max_frame; // longest frame, longer ones are dropped, 0: 256
+    uint32_t max_frames; // frames parsed ahead of the reader, rounded up to a power of 2, 0: 64
+    int      thread; // 1: a reader thread fills the ring, 0: drv_uart_stream_next() and _fill() do
+
+    struct uart_framer framer;
+};
+
+typedef struct _uart_frame {
+    uint8_t* data; // inside the ring, valid until released
+    size_t   len;
+    uint64_t ticks; // utils_cpu_ticks() of the read that completed the frame
+    uint64_t end; // stream offset after the frame
+} uart_frame_t;
+
+typedef struct _uart_stream_stats {
+    uint64_t rx_bytes; // bytes read from the port
+    uint64_t reads; // read() calls that returned data
+    uint64_t frames; // frames handed out
+    uint64_t errors; // oversize frames, bad length fields and bad COBS
+    uint64_t dropped; // bytes thrown away by the framer
+    uint64_t stalls; // times the reader stopped because the ring or frame queue was full
+    uint64_t rx_bps; // bytes per second since create or reset
+    uint64_t latency_ns_max; // last byte read to frame handed out
+    uint64_t latency_ns_mean;
+    uint32_t max_fill; // most ring bytes in use at once
+} uart_stream_stats_t;
+
+typedef struct _drv_uart_stream drv_uart_stream_t;
+
+/**
+ * @brief Frame the bytes of @uart, a /dev/uartN or a CDC/LTE device opened
+ *        with drv_uart_inst_create_usb(). The stream does not own @uart, it
+ *        must outlive the stream and should not be read by anybody else.
+ *        Without a reader thread, poll drv_uart_get_fd() and call
+ *        drv_uart_stream_fill() or just call drv_uart_stream_next().
+ * @return 0 on success, negative error code on failure:
+ *         -1: Invalid parameters
+ *         -2: Invalid framer
+ *         -3: Memory allocation failed
+ *         -4: Reader thread creation failed
+ */
+int  drv_uart_stream_create(drv_uart_inst_t* uart, const struct uart_stream_config* cfg, drv_uart_stream_t** stream);
+void drv_uart_stream_destroy(drv_uart_stream_t** stream);
+
+/**
+ * @brief Read what the port has into the ring and frame it, without waiting.
+ *        Only for streams without a reader thread.
+ * @return Bytes taken from the port, -1 on error.
+ */
+int drv_uart_stream_fill(drv_uart_stream_t* stream);
+
+/**
+ * @brief Take the next frame, waiting at most @timeout_ms (-1 forever, 0 not
+ *        at all). @frame points into the ring, nothing is copied, except the
+ *        part of a frame that wraps around the end of the ring which is
+ *        mirrored behind it. Frames may be held and are released in order,
+ *        only one thread may take frames at a time.
+ * @return 1 with a frame, 0 on timeout, -1 on error.
+ */
+int drv_uart_stream_next(drv_uart_stream_t* stream, uart_frame_t* frame, int timeout_ms);
+
+/**
+ * @brief Give @frame and every frame taken before it back to the ring.
+ */
+int drv_uart_stream_release(drv_uart_stream_t* stream, const uart_frame_t* frame);
+
+int  drv_uart_stream_get_stats(drv_uart_stream_t* stream, uart_stream_stats_t* stats);
+void drv_uart_stream_reset_stats(drv_uart_stream_t* stream);
+
+#ifdef __cplusplus
+}
+#endif
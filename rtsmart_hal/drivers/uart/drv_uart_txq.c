@@ -0,0 +1,459 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_uart.h"
+#include "drv_uart_txq.h"
+#include "hal_io.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define TXQ_DFT_BUF_SIZE       (16384)
+#define TXQ_DFT_MAX_MSGS       (256)
+#define TXQ_DFT_COALESCE_BYTES (1024)
+#define TXQ_MAX_SIZE           (1U << 30)
+#define TXQ_DRAIN_MS           (1000)
+#define TXQ_POLL_MS            (100)
+
+/* end of a queued message, for the latency counters */
+struct uart_txq_msg {
+    uint64_t end; // queue offset after the last byte
+    uint64_t ticks; // when the message was queued
+};
+
+struct _drv_uart_txq {
+    void* base;
+
+    drv_uart_inst_t* uart;
+
+    /* head and tail are queue offsets, the ring index is offset & (size - 1) */
+    uint8_t* ring;
+    uint32_t size;
+    uint64_t head, tail;
+    uint64_t first_ticks; // when the queue last went from empty to not empty
+
+    struct uart_txq_msg* msg;
+    uint32_t             msg_size;
+    uint64_t             msg_head, msg_tail;
+
+    uint64_t coalesce_ticks;
+    uint32_t coalesce_bytes;
+    int      flushing;
+
+    pthread_mutex_t lock;
+    pthread_mutex_t writer; // keeps the messages of concurrent writers apart
+    pthread_cond_t  data, space;
+    pthread_t       thread;
+    int             running;
+
+    uint64_t tx_bytes, messages, writes, waits, timeouts;
+    uint64_t latency_max, latency_sum, latency_cnt, start;
+    uint32_t max_queued;
+};
+
+static const int uart_txq_type;
+static HAL_SLAB_CACHE_DEFINE(uart_txq_cache, "drv_uart_txq", drv_uart_txq_t);
+
+static uint32_t round_pow2(uint32_t value)
+{
+    uint32_t size = 1;
+
+    while (size < value) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+/* account the bytes up to tail as sent, with the lock held */
+static void txq_complete(drv_uart_txq_t* q, uint64_t now)
+{
+    while ((q->msg_tail != q->msg_head) && (q->msg[q->msg_tail & (q->msg_size - 1)].end <= q->tail)) {
+        uint64_t latency = now - q->msg[q->msg_tail & (q->msg_size - 1)].ticks;
+
+        q->latency_sum += latency;
+        q->latency_cnt++;
+        if (q->latency_max < latency) {
+            q->latency_max = latency;
+        }
+        q->msg_tail++;
+    }
+    pthread_cond_broadcast(&q->space);
+}
+
+static void* txq_thread(void* args)
+{
+    drv_uart_txq_t* q = (drv_uart_txq_t*)args;
+    struct pollfd   fds = { .fd = q->uart->fd, .events = POLLOUT };
+    struct timespec deadline;
+    uint64_t        queued, now, due;
+    uint32_t        off;
+    size_t          len;
+    ssize_t         ret;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->running) {
+        if (q->head == q->tail) {
+            pthread_cond_wait(&q->data, &q->lock);
+            continue;
+        }
+
+        /* hold a short queue for more data, unless someone waits for room */
+        queued = q->head - q->tail;
+        if (q->coalesce_ticks && (queued < q->coalesce_bytes) && !q->flushing
+            && (q->msg_size != (q->msg_head - q->msg_tail))) {
+            now = utils_cpu_ticks();
+            due = q->first_ticks + q->coalesce_ticks;
+            if (now < due) {
+                utils_cond_deadline(&deadline, utils_cpu_ticks_to_ns(due - now));
+                utils_cond_wait(&q->data, &q->lock, &deadline);
+                continue;
+            }
+        }
+
+        off = q->tail & (q->size - 1);
+        len = q->size - off;
+        if (len > queued) {
+            len = queued;
+        }
+
+        pthread_mutex_unlock(&q->lock);
+        ret = hal_io_write(q->uart->fd, q->ring + off, len);
+        if ((0 > ret) && ((EAGAIN == errno) || (EWOULDBLOCK == errno))) {
+            /* driver buffer full, wait until it takes more */
+            hal_io_poll(&fds, 1, TXQ_POLL_MS);
+        } else if (0 > ret) {
+            /* cdc port unplugged, keep the data until it comes back */
+            usleep(10 * 1000);
+        }
+        pthread_mutex_lock(&q->lock);
+
+        if (0 < ret) {
+            q->tail += ret;
+            q->tx_bytes += ret;
+            q->writes++;
+            txq_complete(q, utils_cpu_ticks());
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return NULL;
+}
+
+int drv_uart_txq_create(drv_uart_inst_t* uart, const struct uart_txq_config* cfg, drv_uart_txq_t** txq)
+{
+    HAL_TRACE_FUNC();
+
+    pthread_condattr_t attr;
+    uint32_t           size, max_msgs;
+    drv_uart_txq_t*    q;
+
+    if ((NULL == uart) || (0 > uart->fd) || (NULL == cfg) || (NULL == txq)) {
+        return -1;
+    }
+
+    size     = cfg->buf_size ? cfg->buf_size : TXQ_DFT_BUF_SIZE;
+    max_msgs = cfg->max_msgs ? cfg->max_msgs : TXQ_DFT_MAX_MSGS;
+    if ((TXQ_MAX_SIZE < size) || (TXQ_MAX_SIZE < max_msgs)) {
+        printf("[hal_uart]: tx queue too large\n");
+        return -1;
+    }
+
+    if (*txq) {
+        drv_uart_txq_destroy(txq);
+        *txq = NULL;
+    }
+
+    q = hal_slab_zalloc(&uart_txq_cache);
+    if (NULL == q) {
+        printf("[hal_uart]: alloc tx queue failed\n");
+        return -3;
+    }
+    q->base           = (void*)&uart_txq_type;
+    q->uart           = uart;
+    q->size           = round_pow2(size);
+    q->msg_size       = round_pow2(max_msgs);
+    q->coalesce_ticks = (uint64_t)cfg->coalesce_us * CPU_TICKS_PER_SECOND / 1000000;
+    q->coalesce_bytes = cfg->coalesce_bytes ? cfg->coalesce_bytes : TXQ_DFT_COALESCE_BYTES;
+    q->start          = utils_cpu_ticks();
+
+    /* a full queue goes out at once, waiting would only stall the writers */
+    if (q->coalesce_bytes > q->size) {
+        q->coalesce_bytes = q->size;
+    }
+
+    q->ring = hal_slab_buf_alloc(q->size);
+    q->msg  = hal_slab_buf_alloc(q->msg_size * sizeof(struct uart_txq_msg));
+    if ((NULL == q->ring) || (NULL == q->msg)) {
+        printf("[hal_uart]: alloc %u byte tx queue failed\n", q->size);
+        hal_slab_buf_free(q->ring);
+        hal_slab_buf_free(q->msg);
+        hal_slab_free(&uart_txq_cache, q);
+        return -3;
+    }
+
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_mutex_init(&q->writer, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->data, &attr);
+    pthread_cond_init(&q->space, &attr);
+    pthread_condattr_destroy(&attr);
+
+    q->running = 1;
+    if (0x00 != pthread_create(&q->thread, NULL, txq_thread, q)) {
+        printf("[hal_uart]: create tx queue writer thread failed\n");
+        pthread_cond_destroy(&q->data);
+        pthread_cond_destroy(&q->space);
+        pthread_mutex_destroy(&q->writer);
+        pthread_mutex_destroy(&q->lock);
+        hal_slab_buf_free(q->ring);
+        hal_slab_buf_free(q->msg);
+        hal_slab_free(&uart_txq_cache, q);
+        return -4;
+    }
+
+    *txq = q;
+
+    return 0;
+}
+
+void drv_uart_txq_destroy(drv_uart_txq_t** txq)
+{
+    HAL_TRACE_FUNC();
+
+    drv_uart_txq_t* q;
+
+    if ((NULL == txq) || (NULL == *txq)) {
+        return;
+    }
+    q = *txq;
+
+    if ((void*)&uart_txq_type != q->base) {
+        printf("[hal_uart]: inst not uart tx queue\n");
+        return;
+    }
+
+    if (0x00 != drv_uart_txq_flush(q, TXQ_DRAIN_MS)) {
+        printf("[hal_uart]: tx queue dropped %llu bytes\n", (unsigned long long)(q->head - q->tail));
+    }
+
+    pthread_mutex_lock(&q->lock);
+    q->running = 0;
+    pthread_cond_signal(&q->data);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+
+    pthread_cond_destroy(&q->data);
+    pthread_cond_destroy(&q->space);
+    pthread_mutex_destroy(&q->writer);
+    pthread_mutex_destroy(&q->lock);
+    hal_slab_buf_free(q->ring);
+    hal_slab_buf_free(q->msg);
+    q->base = NULL;
+
+    hal_slab_free(&uart_txq_cache, q);
+    *txq = NULL;
+}
+
+ssize_t drv_uart_txq_writev(drv_uart_txq_t* txq, const struct iovec* iov, int iovcnt, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_uart_txq_t* q = txq;
+    struct timespec deadline;
+    uint64_t        start;
+    size_t          total = 0, done = 0, room, off, len;
+    int             i, ret = 0;
+
+    if ((NULL == q) || ((void*)&uart_txq_type != q->base) || ((NULL == iov) && (0 < iovcnt)) || (0 > iovcnt)) {
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (0x00 == total) {
+        return 0;
+    }
+    if (0 < timeout_ms) {
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&q->writer);
+    pthread_mutex_lock(&q->lock);
+    start = utils_cpu_ticks();
+
+    /* one message record per call, taken before the first byte goes in */
+    while ((q->msg_size == (q->msg_head - q->msg_tail)) && (0 == ret) && (0 != timeout_ms)) {
+        q->waits++;
+        pthread_cond_signal(&q->data);
+        ret = utils_cond_wait(&q->space, &q->lock, (0 > timeout_ms) ? NULL : &deadline);
+    }
+
+    i   = 0;
+    off = 0;
+    while ((q->msg_size != (q->msg_head - q->msg_tail)) && (done < total)) {
+        room = q->size - (q->head - q->tail);
+        if (0x00 == room) {
+            if ((0 == timeout_ms) || (0 != ret)) {
+                break;
+            }
+            q->waits++;
+            q->flushing++;
+            pthread_cond_signal(&q->data);
+            ret = utils_cond_wait(&q->space, &q->lock, (0 > timeout_ms) ? NULL : &deadline);
+            q->flushing--;
+            continue;
+        }
+
+        /* copy as much of the current buffer as fits before the ring wraps */
+        len = iov[i].iov_len - off;
+        if (len > room) {
+            len = room;
+        }
+        if (len > q->size - (q->head & (q->size - 1))) {
+            len = q->size - (q->head & (q->size - 1));
+        }
+        if (q->head == q->tail) {
+            q->first_ticks = start;
+        }
+        memcpy(q->ring + (q->head & (q->size - 1)), (const uint8_t*)iov[i].iov_base + off, len);
+        q->head += len;
+        done += len;
+        off += len;
+        if (off == iov[i].iov_len) {
+            i++;
+            off = 0;
+        }
+        pthread_cond_signal(&q->data);
+    }
+
+    if (0 < done) {
+        q->msg[q->msg_head & (q->msg_size - 1)].end   = q->head;
+        q->msg[q->msg_head & (q->msg_size - 1)].ticks = start;
+        q->msg_head++;
+        q->messages++;
+        if (q->max_queued < (q->head - q->tail)) {
+            q->max_queued = q->head - q->tail;
+        }
+        pthread_cond_signal(&q->data);
+    }
+    if (done < total) {
+        q->timeouts++;
+    }
+
+    pthread_mutex_unlock(&q->lock);
+    pthread_mutex_unlock(&q->writer);
+
+    return done;
+}
+
+ssize_t drv_uart_txq_write(drv_uart_txq_t* txq, const void* buf, size_t size, int timeout_ms)
+{
+    struct iovec iov = { .iov_base = (void*)buf, .iov_len = size };
+
+    if (NULL == buf) {
+        return -1;
+    }
+
+    return drv_uart_txq_writev(txq, &iov, 1, timeout_ms);
+}
+
+int drv_uart_txq_flush(drv_uart_txq_t* txq, int timeout_ms)
+{
+    HAL_TRACE_FUNC();
+
+    drv_uart_txq_t* q = txq;
+    struct timespec deadline;
+    int             ret = 0;
+
+    if ((NULL == q) || ((void*)&uart_txq_type != q->base)) {
+        return -1;
+    }
+    if (0 < timeout_ms) {
+        utils_cond_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+    }
+
+    pthread_mutex_lock(&q->lock);
+    q->flushing++;
+    pthread_cond_signal(&q->data);
+    while ((q->head != q->tail) && (0 == ret) && (0 != timeout_ms)) {
+        ret = utils_cond_wait(&q->space, &q->lock, (0 > timeout_ms) ? NULL : &deadline);
+    }
+    q->flushing--;
+    ret = (q->head == q->tail) ? 0 : -1;
+    pthread_mutex_unlock(&q->lock);
+
+    return ret;
+}
+
+int drv_uart_txq_get_stats(drv_uart_txq_t* txq, uart_txq_stats_t* stats)
+{
+    uint64_t elapsed;
+
+    if ((NULL == txq) || ((void*)&uart_txq_type != txq->base) || (NULL == stats)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&txq->lock);
+    elapsed = utils_cpu_ticks() - txq->start;
+
+    stats->tx_bytes        = txq->tx_bytes;
+    stats->messages        = txq->messages;
+    stats->writes          = txq->writes;
+    stats->waits           = txq->waits;
+    stats->timeouts        = txq->timeouts;
+    stats->tx_bps          = elapsed ? (txq->tx_bytes * CPU_TICKS_PER_SECOND / elapsed) : 0;
+    stats->latency_ns_max  = utils_cpu_ticks_to_ns(txq->latency_max);
+    stats->latency_ns_mean = txq->latency_cnt ? utils_cpu_ticks_to_ns(txq->latency_sum / txq->latency_cnt) : 0;
+    stats->max_queued      = txq->max_queued;
+    pthread_mutex_unlock(&txq->lock);
+
+    return 0;
+}
+
+void drv_uart_txq_reset_stats(drv_uart_txq_t* txq)
+{
+    if ((NULL == txq) || ((void*)&uart_txq_type != txq->base)) {
+        return;
+    }
+
+    pthread_mutex_lock(&txq->lock);
+    txq->tx_bytes = txq->messages = txq->writes = txq->waits = txq->timeouts = 0;
+    txq->latency_max = txq->latency_sum = txq->latency_cnt = 0;
+    txq->max_queued = txq->head - txq->tail;
+    txq->start      = utils_cpu_ticks();
+    pthread_mutex_unlock(&txq->lock);
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "drv_uart.h"
+
+struct uart_txq_config {
+    uint32_t buf_size; // queued bytes before writers wait, rounded up to a power of 2, 0: 16384
+    uint32_t max_msgs; // queued messages before writers wait, rounded up to a power of 2, 0: 256
+    uint32_t coalesce_us; // hold a short queue this long for more data, 0: write at once
+    uint32_t coalesce_bytes; // write without holding once this much is queued, 0: 1024
+};
+
+typedef struct _uart_txq_stats {
+    uint64_t tx_bytes; // bytes handed to the driver
+    uint64_t messages; // write calls queued
+    uint64_t writes; // write() calls to the driver that took data
+    uint64_t waits; // times a writer waited for room
+    uint64_t timeouts; // writes that gave up with part of the message queued
+    uint64_t tx_bps; // bytes per second since create or reset
+    uint64_t latency_ns_max; // message queued to its last byte handed to the driver
+    uint64_t latency_ns_mean;
+    uint32_t max_queued; // most bytes queued at once
+} uart_txq_stats_t;
+
+typedef struct _drv_uart_txq drv_uart_txq_t;
+
+/**
+ * @brief Queue writes to @uart, a /dev/uartN or a CDC/LTE device opened with
+ *        drv_uart_inst_create_usb(), and send them from a writer thread.
+ *        Short writes are held up to coalesce_us so that several of them go
+ *        out in one driver write. The queue does not own @uart, nothing else
+ *        should write to it while the queue exists.
+ * @return 0 on success, negative error code on failure:
+ *         -1: Invalid parameters
+ *         -3: Memory allocation failed
+ *         -4: Writer thread creation failed
+ */
+int drv_uart_txq_create(drv_uart_inst_t* uart, const struct uart_txq_config* cfg, drv_uart_txq_t** txq);
+
+/**
+ * @brief Give queued bytes up to a second to drain, then stop the writer
+ *        thread and drop what is left.
+ */
+void drv_uart_txq_destroy(drv_uart_txq_t** txq);
+
+/**
+ * @brief Gather @iovcnt buffers into the queue as one message, waiting at most
+ *        @timeout_ms (-1 forever, 0 not at all) for room. A message larger
+ *        than the queue is fed in as the writer thread drains it. Messages of
+ *        concurrent writers are not interleaved.
+ * @return Bytes queued, less than the message size on timeout, -1 on error.
+ */
+ssize_t drv_uart_txq_writev(drv_uart_txq_t* txq, const struct iovec* iov, int iovcnt, int timeout_ms);
+ssize_t drv_uart_txq_write(drv_uart_txq_t* txq, const void* buf, size_t size, int timeout_ms);
+
+/**
+ * @brief Send what is queued without holding it back and wait at most
+ *        @timeout_ms for the queue to drain.
+ * @return 0 once empty, -1 on timeout or error.
+ */
+int drv_uart_txq_flush(drv_uart_txq_t* txq, int timeout_ms);
+
+int  drv_uart_txq_get_stats(drv_uart_txq_t* txq, uart_txq_stats_t* stats);
+void drv_uart_txq_reset_stats(drv_uart_txq_t* txq);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,751 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_spi.h"
+#include "hal_slab.h"
+#include "hal_trace.h"
+#include "list.h"
+#include "w25qxx.h"
+
+#define CMD_WRITE_ENABLE 0x06
+#define CMD_READ_SR1 0x05
+#define CMD_READ_SR2 0x35
+#define CMD_WRITE_SR2 0x31
+#define CMD_READ_JEDEC 0x9F
+#define CMD_READ_UNIQUE_ID 0x4B
+#define CMD_RELEASE_POWER_DOWN 0xAB
+#define CMD_CHIP_ERASE 0xC7
+
+#define SR1_BUSY (1 << 0)
+#define SR2_QE (1 << 1)
+
+/* one read command at most, longer reads are split */
+#define READ_CHUNK (64 * 1024)
+
+/* datasheet maxima, a chip busy longer than that is broken */
+#define PROG_TIMEOUT_US (5 * 1000)
+#define SECTOR_TIMEOUT_US (500 * 1000)
+#define BLOCK_TIMEOUT_US (3000 * 1000)
+#define CHIP_TIMEOUT_US (400 * 1000 * 1000)
+
+/* status polls back off up to this interval, shorter ones yield instead of sleeping */
+#define POLL_SLEEP_NS (50 * 1000)
+#define POLL_MAX_US (1000)
+
+enum { OP_NONE = -1, OP_PROG = 0, OP_SECTOR, OP_BLOCK, OP_CHIP, OP_NUM };
+
+/* 3 and 4 byte address opcodes */
+struct w25qxx_cmds {
+    uint8_t read[5]; /* by w25qxx_read_mode_t, 0 unused */
+    uint8_t prog, quad_prog, sector_erase, block_erase;
+};
+
+static const struct w25qxx_cmds cmds_3b = { { 0, 0x03, 0x0B, 0x3B, 0x6B }, 0x02, 0x32, 0x20, 0xD8 };
+static const struct w25qxx_cmds cmds_4b = { { 0, 0x13, 0x0C, 0x3C, 0x6C }, 0x12, 0x34, 0x21, 0xDC };
+
+static const uint32_t op_timeout_us[OP_NUM] = { PROG_TIMEOUT_US, SECTOR_TIMEOUT_US, BLOCK_TIMEOUT_US, CHIP_TIMEOUT_US };
+
+struct w25qxx_line {
+    struct list_head lru; /* most recent first */
+    struct hlist_node node;
+    uint32_t sector;
+    uint8_t *data;
+};
+
+struct w25qxx {
+    void *base;
+    drv_spi_inst_t spi;
+    pthread_mutex_t lock;
+
+    w25qxx_info_t info;
+    const struct w25qxx_cmds *cmds;
+    uint8_t data_lines;
+
+    /* program or erase started and not yet seen finished */
+    int pending;
+    uint64_t pending_start;
+    uint64_t op_avg_ns[OP_NUM];
+
+    /* sector cache, lines hashed by sector */
+    struct w25qxx_line *lines;
+    uint8_t *cache;
+    uint32_t num_lines;
+    struct list_head lru;
+    struct hlist_head *buckets;
+    uint32_t bucket_bits;
+
+    w25qxx_stats_t stats;
+};
+
+static const int w25qxx_type;
+static HAL_SLAB_CACHE_DEFINE(w25qxx_cache, "w25qxx", struct w25qxx);
+
+static uint64_t w25q_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * one command in its own cs frame: instruction, optional address, dummy
+ * clocks, then @len data bytes out of @tx or into @rx on @lines lines
+ */
+static int w25q_cmd(w25qxx_t *f, uint8_t cmd, int with_addr, uint32_t addr, uint32_t dummy, const void *tx, void *rx,
+                    size_t len, uint8_t lines)
+{
+    struct rt_qspi_message msg;
+    int ret;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.instruction.content = cmd;
+    msg.instruction.size = 8;
+    msg.instruction.qspi_lines = 1;
+    if (with_addr) {
+        msg.address.content = addr;
+        msg.address.size = f->info.addr_bytes * 8;
+        msg.address.qspi_lines = 1;
+    }
+    msg.dummy_cycles = dummy;
+    msg.parent.send_buf = tx;
+    msg.parent.recv_buf = rx;
+    msg.parent.length = len;
+    msg.parent.cs_take = 1;
+    msg.parent.cs_release = 1;
+    msg.qspi_data_lines = lines;
+
+    ret = drv_spi_transfer_message(f->spi, &msg);
+
+    return (ret == (int)len) ? 0 : -2;
+}
+
+static int w25q_read_sr(w25qxx_t *f, uint8_t cmd, uint8_t *sr) { return w25q_cmd(f, cmd, 0, 0, 0, NULL, sr, 1, 1); }
+
+static int w25q_write_enable(w25qxx_t *f) { return w25q_cmd(f, CMD_WRITE_ENABLE, 0, 0, 0, NULL, NULL, 0, 1); }
+
+/*
+ * wait for the operation started last. The sleep before the first poll and
+ * the poll interval follow the time the operation took recently, a page
+ * program polls every few us, a chip erase sleeps most of the time.
+ */
+static int w25q_settle(w25qxx_t *f)
+{
+    uint64_t start = w25q_now_ns();
+    uint64_t expect, elapsed, interval, timeout;
+    uint8_t sr;
+    int op = f->pending, busy = 0;
+
+    if (op == OP_NONE) {
+        return 0;
+    }
+
+    expect = f->op_avg_ns[op];
+    timeout = (uint64_t)op_timeout_us[op] * 1000;
+    elapsed = start - f->pending_start;
+
+    /* sleep through most of the expected time, then poll */
+    if (expect * 7 / 8 > elapsed + POLL_SLEEP_NS) {
+        usleep((expect * 7 / 8 - elapsed) / 1000);
+    }
+    interval = expect ? expect / 16 : 1000;
+
+    for (;;) {
+        if (w25q_read_sr(f, CMD_READ_SR1, &sr)) {
+            return -2;
+        }
+        elapsed = w25q_now_ns() - f->pending_start;
+        if (!(sr & SR1_BUSY)) {
+            break;
+        }
+        f->stats.busy_polls++;
+        busy = 1;
+        if (elapsed > timeout) {
+            printf("[w25qxx]: busy for %llu us\n", (unsigned long long)(elapsed / 1000));
+            f->stats.busy_wait_ns += w25q_now_ns() - start;
+            return -4;
+        }
+        if (interval >= POLL_SLEEP_NS) {
+            usleep(interval / 1000);
+        } else {
+            sched_yield();
+        }
+        interval = (interval * 2 > POLL_MAX_US * 1000ULL) ? POLL_MAX_US * 1000ULL : interval * 2;
+    }
+
+    /*
+     * ready at the first poll only bounds the time from above, the chip may
+     * have been idle long before, that may lower the estimate but not raise it
+     */
+    if (busy && !expect) {
+        f->op_avg_ns[op] = elapsed;
+    } else if (busy || elapsed < expect) {
+        f->op_avg_ns[op] = (expect * 7 + elapsed) / 8;
+    }
+    f->stats.busy_wait_ns += w25q_now_ns() - start;
+    f->pending = OP_NONE;
+
+    return 0;
+}
+
+static void w25q_start_op(w25qxx_t *f, int op)
+{
+    f->pending = op;
+    f->pending_start = w25q_now_ns();
+}
+
+static struct w25qxx_line *cache_find(w25qxx_t *f, uint32_t sector)
+{
+    struct w25qxx_line *line;
+
+    if (!f->num_lines) {
+        return NULL;
+    }
+
+    hlist_for_each_entry(line, &f->buckets[hash_32(sector, f->bucket_bits)], node) {
+        if (line->sector == sector) {
+            return line;
+        }
+    }
+
+    return NULL;
+}
+
+/* the least recently used line, rehashed for @sector, its data still stale */
+static struct w25qxx_line *cache_claim(w25qxx_t *f, uint32_t sector)
+{
+    struct w25qxx_line *line = list_entry(f->lru.prev, struct w25qxx_line, lru);
+
+    if (!hlist_unhashed(&line->node)) {
+        hlist_del_init(&line->node);
+    }
+    line->sector = sector;
+    hlist_add_head(&line->node, &f->buckets[hash_32(sector, f->bucket_bits)]);
+    list_del(&line->lru);
+    __list_add(&line->lru, &f->lru, f->lru.next);
+
+    return line;
+}
+
+static void cache_drop(w25qxx_t *f, struct w25qxx_line *line)
+{
+    hlist_del_init(&line->node);
+    list_del(&line->lru);
+    list_add_tail(&line->lru, &f->lru);
+}
+
+static int w25q_read_flash(w25qxx_t *f, uint32_t addr, uint8_t *buf, size_t len)
+{
+    w25qxx_read_mode_t mode = f->info.read_mode;
+    uint8_t lines = (mode == W25QXX_READ_QUAD) ? 4 : (mode == W25QXX_READ_DUAL) ? 2 : 1;
+    uint32_t dummy = (mode == W25QXX_READ_NORMAL) ? 0 : 8;
+    size_t n;
+
+    while (len) {
+        n = (len > READ_CHUNK) ? READ_CHUNK : len;
+        if (w25q_cmd(f, f->cmds->read[mode], 1, addr, dummy, NULL, buf, n, lines)) {
+            return -2;
+        }
+        f->stats.read_bytes += n;
+        f->stats.read_cmds++;
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int w25q_check(w25qxx_t *f, uint32_t addr, size_t len)
+{
+    if (!f || (void *)&w25qxx_type != f->base) {
+        return -1;
+    }
+    if (addr > f->info.size || len > f->info.size - addr) {
+        printf("[w25qxx]: 0x%x + %zu beyond the %u byte flash\n", addr, len, f->info.size);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int w25q_enable_quad(w25qxx_t *f)
+{
+    uint8_t sr2;
+
+    if (w25q_read_sr(f, CMD_READ_SR2, &sr2)) {
+        return -2;
+    }
+    if (sr2 & SR2_QE) {
+        return 0;
+    }
+
+    sr2 |= SR2_QE;
+    if (w25q_write_enable(f) || w25q_cmd(f, CMD_WRITE_SR2, 0, 0, 0, &sr2, NULL, 1, 1)) {
+        return -2;
+    }
+    w25q_start_op(f, OP_PROG);
+    if (w25q_settle(f) || w25q_read_sr(f, CMD_READ_SR2, &sr2)) {
+        return -2;
+    }
+
+    return (sr2 & SR2_QE) ? 0 : -2;
+}
+
+/* JEDEC capacity byte, 0x20 and up continue at 64 MiB */
+static uint32_t w25q_capacity(uint8_t code)
+{
+    if (code >= 0x10 && code <= 0x1F) {
+        return 1U << code;
+    }
+    if (code >= 0x20 && code <= 0x21) {
+        return 1U << (code - 6);
+    }
+
+    return 0;
+}
+
+static void w25q_free(w25qxx_t *f)
+{
+    if (f->spi) {
+        drv_spi_inst_destroy(&f->spi);
+    }
+    hal_slab_buf_free(f->lines);
+    hal_slab_buf_free(f->cache);
+    hal_slab_buf_free(f->buckets);
+    pthread_mutex_destroy(&f->lock);
+    f->base = NULL;
+    hal_slab_free(&w25qxx_cache, f);
+}
+
+int w25qxx_create(const struct w25qxx_config *cfg, w25qxx_t **flash)
+{
+    HAL_TRACE_FUNC();
+
+    w25qxx_t *f;
+    uint8_t id[3];
+    w25qxx_read_mode_t mode;
+    int ret;
+
+    if (!cfg || !flash ||
+        (cfg->data_lines != SPI_HAL_DATA_LINE_1 && cfg->data_lines != SPI_HAL_DATA_LINE_2 &&
+         cfg->data_lines != SPI_HAL_DATA_LINE_4) ||
+        cfg->read_mode > W25QXX_READ_QUAD) {
+        printf("[w25qxx]: invalid parameters\n");
+        return -1;
+    }
+
+    mode = cfg->read_mode;
+    if (mode == W25QXX_READ_AUTO) {
+        mode = (cfg->data_lines == 4) ? W25QXX_READ_QUAD : (cfg->data_lines == 2) ? W25QXX_READ_DUAL : W25QXX_READ_FAST;
+    }
+    if ((mode == W25QXX_READ_QUAD && cfg->data_lines < 4) || (mode == W25QXX_READ_DUAL && cfg->data_lines < 2)) {
+        printf("[w25qxx]: read mode needs more than %u data lines\n", cfg->data_lines);
+        return -1;
+    }
+
+    f = hal_slab_zalloc(&w25qxx_cache);
+    if (!f) {
+        printf("[w25qxx]: alloc flash fail\n");
+        return -3;
+    }
+    f->base = (void *)&w25qxx_type;
+    f->pending = OP_NONE;
+    f->data_lines = cfg->data_lines;
+    pthread_mutex_init(&f->lock, NULL);
+    INIT_LIST_HEAD(&f->lru);
+
+    if (drv_spi_inst_create(cfg->spi_id, true, SPI_HAL_MODE_0, cfg->baudrate, 8, cfg->cs_pin, cfg->data_lines,
+                            &f->spi)) {
+        f->spi = NULL;
+        ret = -2;
+        goto err;
+    }
+
+    /* a chip left in power down answers nothing else */
+    f->info.addr_bytes = 3;
+    w25q_cmd(f, CMD_RELEASE_POWER_DOWN, 0, 0, 0, NULL, NULL, 0, 1);
+    usleep(30);
+
+    if (w25q_cmd(f, CMD_READ_JEDEC, 0, 0, 0, NULL, id, sizeof(id), 1)) {
+        ret = -2;
+        goto err;
+    }
+    f->info.jedec_id = (id[0] << 16) | (id[1] << 8) | id[2];
+    f->info.size = w25q_capacity(id[2]);
+    if (id[0] == 0x00 || id[0] == 0xFF || !f->info.size) {
+        printf("[w25qxx]: no flash, JEDEC id 0x%06X\n", f->info.jedec_id);
+        ret = -2;
+        goto err;
+    }
+    f->info.page_size = W25QXX_PAGE_SIZE;
+    f->info.sector_size = W25QXX_SECTOR_SIZE;
+    f->info.block_size = W25QXX_BLOCK_SIZE;
+    f->info.addr_bytes = (f->info.size > (16U << 20)) ? 4 : 3;
+    f->info.read_mode = mode;
+    f->cmds = (f->info.addr_bytes == 4) ? &cmds_4b : &cmds_3b;
+
+    if (mode == W25QXX_READ_QUAD && w25q_enable_quad(f)) {
+        printf("[w25qxx]: can not set the quad enable bit\n");
+        ret = -2;
+        goto err;
+    }
+
+    if (cfg->cache_sectors) {
+        f->num_lines = cfg->cache_sectors;
+        while ((1U << f->bucket_bits) < f->num_lines * 2) {
+            f->bucket_bits++;
+        }
+        f->lines = hal_slab_buf_alloc(f->num_lines * sizeof(struct w25qxx_line));
+        f->cache = hal_slab_buf_alloc((size_t)f->num_lines * W25QXX_SECTOR_SIZE);
+        f->buckets = hal_slab_buf_alloc(sizeof(struct hlist_head) << f->bucket_bits);
+        if (!f->lines || !f->cache || !f->buckets) {
+            printf("[w25qxx]: alloc %u sector cache fail\n", f->num_lines);
+            ret = -3;
+            goto err;
+        }
+        for (uint32_t i = 0; i < (1U << f->bucket_bits); i++) {
+            INIT_HLIST_HEAD(&f->buckets[i]);
+        }
+        for (uint32_t i = 0; i < f->num_lines; i++) {
+            f->lines[i].data = f->cache + (size_t)i * W25QXX_SECTOR_SIZE;
+            INIT_HLIST_NODE(&f->lines[i].node);
+            list_add_tail(&f->lines[i].lru, &f->lru);
+        }
+    }
+
+    *flash = f;
+
+    return 0;
+
+err:
+    w25q_free(f);
+
+    return ret;
+}
+
+void w25qxx_destroy(w25qxx_t **flash)
+{
+    HAL_TRACE_FUNC();
+
+    if (!flash || !*flash || (void *)&w25qxx_type != (*flash)->base) {
+        return;
+    }
+
+    pthread_mutex_lock(&(*flash)->lock);
+    w25q_settle(*flash);
+    pthread_mutex_unlock(&(*flash)->lock);
+
+    w25q_free(*flash);
+    *flash = NULL;
+}
+
+int w25qxx_get_info(w25qxx_t *flash, w25qxx_info_t *info)
+{
+    if (w25q_check(flash, 0, 0) || !info) {
+        return -1;
+    }
+    *info = flash->info;
+
+    return 0;
+}
+
+int w25qxx_read(w25qxx_t *flash, uint32_t addr, void *buf, size_t len)
+{
+    HAL_TRACE_FUNC();
+
+    w25qxx_t *f = flash;
+    uint8_t *out = buf;
+    uint32_t direct_addr = 0;
+    uint8_t *direct_buf = NULL;
+    size_t direct_len = 0;
+    int ret;
+
+    if ((ret = w25q_check(f, addr, len)) || !buf) {
+        return ret ? ret : -1;
+    }
+
+    pthread_mutex_lock(&f->lock);
+    if ((ret = w25q_settle(f))) {
+        goto out;
+    }
+
+    while (len) {
+        uint32_t sector = addr / W25QXX_SECTOR_SIZE;
+        uint32_t off = addr % W25QXX_SECTOR_SIZE;
+        size_t n = W25QXX_SECTOR_SIZE - off;
+        struct w25qxx_line *line;
+
+        n = (n > len) ? len : n;
+        line = cache_find(f, sector);
+
+        /* whole sectors not cached are gathered into one read */
+        if (!line && (n == W25QXX_SECTOR_SIZE || !f->num_lines)) {
+            if (!direct_len) {
+                direct_addr = addr;
+                direct_buf = out;
+            }
+            direct_len += n;
+            f->stats.cache_misses += (f->num_lines != 0);
+            goto next;
+        }
+
+        if (direct_len) {
+            if ((ret = w25q_read_flash(f, direct_addr, direct_buf, direct_len))) {
+                goto out;
+            }
+            direct_len = 0;
+        }
+
+        if (line) {
+            list_del(&line->lru);
+            __list_add(&line->lru, &f->lru, f->lru.next);
+            f->stats.cache_hits++;
+        } else {
+            line = cache_claim(f, sector);
+            if ((ret = w25q_read_flash(f, sector * W25QXX_SECTOR_SIZE, line->data, W25QXX_SECTOR_SIZE))) {
+                cache_drop(f, line);
+                goto out;
+            }
+            f->stats.cache_misses++;
+        }
+        memcpy(out, line->data + off, n);
+
+    next:
+        addr += n;
+        out += n;
+        len -= n;
+    }
+
+    if (direct_len) {
+        ret = w25q_read_flash(f, direct_addr, direct_buf, direct_len);
+    }
+
+out:
+    pthread_mutex_unlock(&f->lock);
+
+    return ret;
+}
+
+static int w25q_all_ff(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != 0xFF) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int w25qxx_write(w25qxx_t *flash, uint32_t addr, const void *buf, size_t len)
+{
+    HAL_TRACE_FUNC();
+
+    w25qxx_t *f = flash;
+    const uint8_t *in = buf;
+    int quad = (f && f->info.read_mode == W25QXX_READ_QUAD);
+    int ret;
+
+    if ((ret = w25q_check(f, addr, len)) || !buf) {
+        return ret ? ret : -1;
+    }
+
+    pthread_mutex_lock(&f->lock);
+    while (len) {
+        size_t n = W25QXX_PAGE_SIZE - addr % W25QXX_PAGE_SIZE;
+        struct w25qxx_line *line;
+
+        n = (n > len) ? len : n;
+
+        /* programming 0xFF changes nothing */
+        if (w25q_all_ff(in, n)) {
+            f->stats.pages_skipped++;
+        } else {
+            if ((ret = w25q_settle(f)) || (ret = w25q_write_enable(f)) ||
+                (ret = w25q_cmd(f, quad ? f->cmds->quad_prog : f->cmds->prog, 1, addr, 0, in, NULL, n,
+                                quad ? 4 : 1))) {
+                goto out;
+            }
+            w25q_start_op(f, OP_PROG);
+            f->stats.prog_bytes += n;
+            f->stats.pages_programmed++;
+
+            /* the chip ANDs the data in, so does the cached copy */
+            if ((line = cache_find(f, addr / W25QXX_SECTOR_SIZE))) {
+                uint8_t *dst = line->data + addr % W25QXX_SECTOR_SIZE;
+
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] &= in[i];
+                }
+            }
+        }
+
+        addr += n;
+        in += n;
+        len -= n;
+    }
+
+out:
+    pthread_mutex_unlock(&f->lock);
+
+    return ret;
+}
+
+int w25qxx_erase(w25qxx_t *flash, uint32_t addr, size_t len)
+{
+    HAL_TRACE_FUNC();
+
+    w25qxx_t *f = flash;
+    int ret;
+
+    if ((ret = w25q_check(f, addr, len))) {
+        return ret;
+    }
+    if ((addr | len) % W25QXX_SECTOR_SIZE) {
+        printf("[w25qxx]: erase 0x%x + %zu not sector aligned\n", addr, len);
+        return -1;
+    }
+
+    pthread_mutex_lock(&f->lock);
+    while (len) {
+        int block = !(addr % W25QXX_BLOCK_SIZE) && len >= W25QXX_BLOCK_SIZE;
+        size_t n = block ? W25QXX_BLOCK_SIZE : W25QXX_SECTOR_SIZE;
+
+        if ((ret = w25q_settle(f)) || (ret = w25q_write_enable(f)) ||
+            (ret = w25q_cmd(f, block ? f->cmds->block_erase : f->cmds->sector_erase, 1, addr, 0, NULL, NULL, 0, 1))) {
+            goto out;
+        }
+        w25q_start_op(f, block ? OP_BLOCK : OP_SECTOR);
+        f->stats.erased_bytes += n;
+
+        for (uint32_t s = addr / W25QXX_SECTOR_SIZE; s < (addr + n) / W25QXX_SECTOR_SIZE; s++) {
+            struct w25qxx_line *line = cache_find(f, s);
+
+            if (line) {
+                memset(line->data, 0xFF, W25QXX_SECTOR_SIZE);
+            }
+        }
+
+        addr += n;
+        len -= n;
+    }
+
+out:
+    pthread_mutex_unlock(&f->lock);
+
+    return ret;
+}
+
+int w25qxx_erase_chip(w25qxx_t *flash)
+{
+    HAL_TRACE_FUNC();
+
+    int ret;
+
+    if ((ret = w25q_check(flash, 0, 0))) {
+        return ret;
+    }
+
+    pthread_mutex_lock(&flash->lock);
+    if (!(ret = w25q_settle(flash)) && !(ret = w25q_write_enable(flash)) &&
+        !(ret = w25q_cmd(flash, CMD_CHIP_ERASE, 0, 0, 0, NULL, NULL, 0, 1))) {
+        w25q_start_op(flash, OP_CHIP);
+        flash->stats.erased_bytes += flash->info.size;
+        for (uint32_t i = 0; i < flash->num_lines; i++) {
+            memset(flash->lines[i].data, 0xFF, W25QXX_SECTOR_SIZE);
+        }
+    }
+    pthread_mutex_unlock(&flash->lock);
+
+    return ret;
+}
+
+int w25qxx_sync(w25qxx_t *flash)
+{
+    int ret;
+
+    if ((ret = w25q_check(flash, 0, 0))) {
+        return ret;
+    }
+
+    pthread_mutex_lock(&flash->lock);
+    ret = w25q_settle(flash);
+    pthread_mutex_unlock(&flash->lock);
+
+    return ret;
+}
+
+int w25qxx_read_unique_id(w25qxx_t *flash, uint8_t id[8])
+{
+    int ret;
+
+    if ((ret = w25q_check(flash, 0, 0)) || !id) {
+        return ret ? ret : -1;
+    }
+
+    /* four dummy bytes, then the id */
+    pthread_mutex_lock(&flash->lock);
+    if (!(ret = w25q_settle(flash))) {
+        ret = w25q_cmd(flash, CMD_READ_UNIQUE_ID, 0, 0, 32, NULL, id, 8, 1);
+    }
+    pthread_mutex_unlock(&flash->lock);
+
+    return ret;
+}
+
+int w25qxx_get_stats(w25qxx_t *flash, w25qxx_stats_t *stats)
+{
+    if (w25q_check(flash, 0, 0) || !stats) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&flash->lock);
+    *stats = flash->stats;
+    stats->prog_us_avg = flash->op_avg_ns[OP_PROG] / 1000;
+    stats->erase_us_avg = flash->op_avg_ns[OP_SECTOR] / 1000;
+    pthread_mutex_unlock(&flash->lock);
+
+    return 0;
+}
+
+void w25qxx_reset_stats(w25qxx_t *flash)
+{
+    if (w25q_check(flash, 0, 0)) {
+        return;
+    }
+
+    pthread_mutex_lock(&flash->lock);
+    memset(&flash->stats, 0, sizeof(flash->stats));
+    pthread_mutex_unlock(&flash->lock);
+}
@@ -0,0 +1,144 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* erase and cache unit */
+#define W25QXX_SECTOR_SIZE 4096
+#define W25QXX_PAGE_SIZE 256
+#define W25QXX_BLOCK_SIZE (64 * 1024)
+
+typedef struct w25qxx w25qxx_t;
+
+typedef enum {
+    W25QXX_READ_AUTO = 0, /* the widest the data lines allow */
+    W25QXX_READ_NORMAL, /* 0x03, no dummy clocks */
+    W25QXX_READ_FAST, /* 0x0B, 8 dummy clocks */
+    W25QXX_READ_DUAL, /* 0x3B, fast read with dual output */
+    W25QXX_READ_QUAD, /* 0x6B, fast read with quad output, sets QE */
+} w25qxx_read_mode_t;
+
+struct w25qxx_config {
+    int spi_id;
+    int cs_pin; /* driven by the HAL, -1 when the board selects the flash itself */
+    uint32_t baudrate;
+    uint8_t data_lines; /* 1, 2 or 4 lines wired to the flash */
+    w25qxx_read_mode_t read_mode;
+    uint32_t cache_sectors; /* LRU read cache in sectors, 0: no cache */
+};
+
+typedef struct {
+    uint32_t jedec_id;
+    uint32_t size; /* bytes, from the capacity byte of the JEDEC id */
+    uint32_t page_size;
+    uint32_t sector_size;
+    uint32_t block_size;
+    uint8_t addr_bytes; /* 4 above 16 MiB, with the 4 byte address commands */
+    w25qxx_read_mode_t read_mode; /* the mode reads use */
+} w25qxx_info_t;
+
+typedef struct {
+    uint64_t read_bytes; /* from the flash, cache fills included */
+    uint64_t read_cmds;
+    uint64_t prog_bytes;
+    uint64_t pages_programmed;
+    uint64_t pages_skipped; /* all 0xFF, nothing to program */
+    uint64_t erased_bytes;
+    uint64_t cache_hits; /* sectors served from the cache */
+    uint64_t cache_misses;
+    uint64_t busy_polls; /* status reads while busy */
+    uint64_t busy_wait_ns;
+    uint32_t prog_us_avg; /* learned page program time */
+    uint32_t erase_us_avg; /* learned sector erase time */
+} w25qxx_stats_t;
+
+/**
+ * @brief Open a W25Qxx compatible SPI NOR flash. Size and addressing come
+ *        from the JEDEC id, chips above 16 MiB use the 4 byte address
+ *        commands, so no address mode state is left in the chip.
+ *
+ * @return 0 on success, negative on error:
+ *         -1: Invalid parameters
+ *         -2: SPI transfer failed or no flash answers
+ *         -3: Memory allocation failed
+ */
+int w25qxx_create(const struct w25qxx_config *cfg, w25qxx_t **flash);
+
+/**
+ * @brief Wait for a running program or erase, then close the flash.
+ */
+void w25qxx_destroy(w25qxx_t **flash);
+
+int w25qxx_get_info(w25qxx_t *flash, w25qxx_info_t *info);
+
+/**
+ * @brief Read @len bytes at @addr. Sectors in the cache are copied from it,
+ *        parts of a sector fill the cache, whole sectors not cached are read
+ *        straight into @buf with as few commands as possible.
+ *
+ * @return 0 on success, negative on error
+ */
+int w25qxx_read(w25qxx_t *flash, uint32_t addr, void *buf, size_t len);
+
+/**
+ * @brief Program @len bytes at @addr, split at page boundaries. Like on the
+ *        chip bits only go from 1 to 0, erase first. Pages of all 0xFF are
+ *        skipped. The last page is not waited for, the next access is.
+ *
+ * @return 0 on success, negative on error, -4 when the chip stays busy
+ */
+int w25qxx_write(w25qxx_t *flash, uint32_t addr, const void *buf, size_t len);
+
+/**
+ * @brief Erase the sectors of [@addr, @addr + @len), both sector aligned.
+ *        Aligned 64 KiB runs use block erase.
+ *
+ * @return 0 on success, negative on error, -4 when the chip stays busy
+ */
+int w25qxx_erase(w25qxx_t *flash, uint32_t addr, size_t len);
+int w25qxx_erase_chip(w25qxx_t *flash);
+
+/**
+ * @brief Wait for a running program or erase to finish.
+ *
+ * @return 0 on success, -4 when the chip stays busy
+ */
+int w25qxx_sync(w25qxx_t *flash);
+
+int w25qxx_read_unique_id(w25qxx_t *flash, uint8_t id[8]);
+
+int w25qxx_get_stats(w25qxx_t *flash, w25qxx_stats_t *stats);
+void w25qxx_reset_stats(w25qxx_t *flash);
+
+#ifdef __cplusplus
+}
+#endif
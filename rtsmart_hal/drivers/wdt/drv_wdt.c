@@ -34,6 +34,8 @@
 
 #include <pthread.h>
 
+#include "hal_io.h"
+
 #define DRV_WDT_DEV "/dev/watchdog1"
 
 #define KD_DEVICE_CTRL_WDT_GET_TIMEOUT _IOW('W', 1, int) /* get timeout(in seconds) */
@@ -49,14 +51,14 @@ static int _drv_wdt_fd = -1;
 static int wdt_ioctl(int cmd, void* arg)
 {
     if (0 > _drv_wdt_fd) {
-        if (0 > (_drv_wdt_fd = open(DRV_WDT_DEV, O_RDWR))) {
+        if (0 > (_drv_wdt_fd = hal_io_open(DRV_WDT_DEV, O_RDWR))) {
 
             printf("[hal_wdt]: open wdt device failed\n");
             return -1;
         }
     }
 
-    return ioctl(_drv_wdt_fd, cmd, arg);
+    return hal_io_ioctl(_drv_wdt_fd, cmd, arg);
 }
 
 int wdt_set_timeout(uint32_t timeout_sec)
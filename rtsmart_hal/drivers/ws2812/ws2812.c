@@ -33,6 +33,8 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include "hal_io.h"
+#include "hal_slab.h"
 #include "ws2812.h"
 
 #define WS2812_STREAM_OVER_GPIO 0x00
@@ -60,14 +62,14 @@ static int ws2812_stream(struct ws2812_stream* stream)
     }
 
     if (0 > ws2812_dev_fd) {
-        ws2812_dev_fd = open("/dev/ws2812", O_RDWR);
+        ws2812_dev_fd = hal_io_open("/dev/ws2812", O_RDWR);
         if (0 > ws2812_dev_fd) {
             printf("[hal_ws2812] Failed to open device: %d\n", errno);
             return -1; // Failed to open device
         }
     }
 
-    return ioctl(ws2812_dev_fd, WS2812_IOCTL_STREAM, stream);
+    return hal_io_ioctl(ws2812_dev_fd, WS2812_IOCTL_STREAM, stream);
 }
 
 int ws2812_stream_over_gpio(int pin, uint32_t* timing_ns, const uint8_t* buf, size_t len)
@@ -76,7 +78,7 @@ int ws2812_stream_over_gpio(int pin, uint32_t* timing_ns, const uint8_t* buf, si
     void*                 stream_buffer = NULL;
     struct ws2812_stream* stream        = NULL;
 
-    stream_buffer = malloc(sizeof(struct ws2812_stream) + len);
+    stream_buffer = hal_slab_buf_alloc(sizeof(struct ws2812_stream) + len);
     if (!stream_buffer) {
         printf("[hal_ws2812] Failed to allocate memory for stream buffer\n");
         return -1; // Memory allocation failed
@@ -97,7 +99,7 @@ int ws2812_stream_over_gpio(int pin, uint32_t* timing_ns, const uint8_t* buf, si
     if (ret < 0) {
         printf("[hal_ws2812] Failed to stream over GPIO: %d\n", errno);
     }
-    free(stream_buffer);
+    hal_slab_buf_free(stream_buffer);
 
     return ret;
 }
@@ -105,7 +107,7 @@ int ws2812_stream_over_gpio(int pin, uint32_t* timing_ns, const uint8_t* buf, si
 int ws2812_device_init(void)
 {
     if (ws2812_dev_fd < 0) {
-        ws2812_dev_fd = open("/dev/ws2812", O_RDWR);
+        ws2812_dev_fd = hal_io_open("/dev/ws2812", O_RDWR);
         if (ws2812_dev_fd < 0) {
             printf("[hal_ws2812] Failed to open device: %d\n", errno);
             return -1; // Failed to open device
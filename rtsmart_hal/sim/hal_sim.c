@@ -0,0 +1,391 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "hal_io.h"
+#include "hal_sim.h"
+#include "hal_utils.h"
+
+#define SIM_MEM_SIZE (1ULL << 32) /* covers every K230 register block */
+
+static struct hal_sim_node  sim_nodes[HAL_SIM_MAX_NODES];
+static struct hal_sim_file* sim_files[HAL_SIM_MAX_FDS];
+static pthread_mutex_t      sim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int  sim_inited;
+static int  sim_mem_fd = -1;
+static char sim_mem_path[64];
+
+/** node table ***************************************************************/
+int hal_sim_register(const char* path, const struct hal_sim_node_ops* ops, void* priv)
+{
+    struct hal_sim_node* free_node = NULL;
+
+    if ((NULL == path) || (NULL == ops) || (sizeof(free_node->path) <= strlen(path))) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_lock);
+
+    for (int i = 0; i < HAL_SIM_MAX_NODES; i++) {
+        if (0x00 == strcmp(sim_nodes[i].path, path)) {
+            free_node = &sim_nodes[i];
+            break;
+        }
+        if ((NULL == free_node) && ('\0' == sim_nodes[i].path[0])) {
+            free_node = &sim_nodes[i];
+        }
+    }
+
+    if (NULL == free_node) {
+        pthread_mutex_unlock(&sim_lock);
+        printf("[hal_sim]: node table full\n");
+        return -1;
+    }
+
+    strcpy(free_node->path, path);
+    free_node->ops    = ops;
+    free_node->priv   = priv;
+    free_node->ioctls = 0;
+
+    pthread_mutex_unlock(&sim_lock);
+
+    return 0;
+}
+
+int hal_sim_unregister(const char* path)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&sim_lock);
+    for (int i = 0; i < HAL_SIM_MAX_NODES; i++) {
+        if (0x00 == strcmp(sim_nodes[i].path, path)) {
+            memset(&sim_nodes[i], 0, sizeof(sim_nodes[i]));
+            ret = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    return ret;
+}
+
+const struct hal_sim_node* hal_sim_find(const char* path)
+{
+    for (int i = 0; i < HAL_SIM_MAX_NODES; i++) {
+        if (('\0' != sim_nodes[i].path[0]) && (0x00 == strcmp(sim_nodes[i].path, path))) {
+            return &sim_nodes[i];
+        }
+    }
+
+    return NULL;
+}
+
+static inline struct hal_sim_file* sim_file_get(int fd)
+{
+    if ((0 > fd) || (HAL_SIM_MAX_FDS <= fd)) {
+        return NULL;
+    }
+
+    return __atomic_load_n(&sim_files[fd], __ATOMIC_ACQUIRE);
+}
+
+/** backend ******************************************************************/
+static int sim_open(const char* path, int flags)
+{
+    const struct hal_sim_node* node;
+    struct hal_sim_file*       file;
+
+    pthread_mutex_lock(&sim_lock);
+    node = hal_sim_find(path);
+    pthread_mutex_unlock(&sim_lock);
+
+    if (NULL == node) {
+        return open(path, flags);
+    }
+
+    if (NULL == (file = calloc(1, sizeof(*file)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    file->fd    = -1;
+    file->flags = flags;
+    file->node  = node;
+    file->priv  = node->priv;
+
+    if (node->ops->open && (0x00 != node->ops->open(file))) {
+        free(file);
+        return -1;
+    }
+
+    if (0 > file->fd) {
+        /* a real, pollable descriptor that never becomes readable */
+        file->fd = eventfd(0, EFD_CLOEXEC | ((flags & O_NONBLOCK) ? EFD_NONBLOCK : 0));
+    }
+
+    if ((0 > file->fd) || (HAL_SIM_MAX_FDS <= file->fd)) {
+        if (node->ops->release) {
+            node->ops->release(file);
+        }
+        if (0 <= file->fd) {
+            close(file->fd);
+        }
+        free(file);
+        errno = EMFILE;
+        return -1;
+    }
+
+    __atomic_store_n(&sim_files[file->fd], file, __ATOMIC_RELEASE);
+
+    return file->fd;
+}
+
+static int sim_close(int fd)
+{
+    struct hal_sim_file* file = sim_file_get(fd);
+
+    if (NULL == file) {
+        return close(fd);
+    }
+
+    __atomic_store_n(&sim_files[fd], NULL, __ATOMIC_RELEASE);
+
+    if (file->node->ops->release) {
+        file->node->ops->release(file);
+    }
+    free(file);
+
+    return close(fd);
+}
+
+static ssize_t sim_read(int fd, void* buf, size_t size)
+{
+    struct hal_sim_file* file = sim_file_get(fd);
+
+    if ((NULL == file) || (NULL == file->node->ops->read)) {
+        return read(fd, buf, size);
+    }
+
+    return file->node->ops->read(file, buf, size);
+}
+
+static ssize_t sim_write(int fd, const void* buf, size_t size)
+{
+    struct hal_sim_file* file = sim_file_get(fd);
+
+    if ((NULL == file) || (NULL == file->node->ops->write)) {
+        return write(fd, buf, size);
+    }
+
+    return file->node->ops->write(file, buf, size);
+}
+
+static off_t sim_lseek(int fd, off_t offset, int whence)
+{
+    struct hal_sim_file* file = sim_file_get(fd);
+
+    if ((NULL == file) || (NULL == file->node->ops->read && NULL == file->node->ops->write)) {
+        return lseek(fd, offset, whence);
+    }
+
+    if (SEEK_SET == whence) {
+        file->pos = offset;
+    } else if (SEEK_CUR == whence) {
+        file->pos += offset;
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return file->pos;
+}
+
+static int sim_ioctl(int fd, unsigned long cmd, void* arg)
+{
+    struct hal_sim_file* file = sim_file_get(fd);
+
+    if (NULL == file) {
+        return ioctl(fd, cmd, arg);
+    }
+
+    /* drivers hold requests in an int, like the RT-Smart libc takes them, drop the sign extension */
+    cmd = (unsigned int)cmd;
+
+    __atomic_add_fetch(&((struct hal_sim_node*)file->node)->ioctls, 1, __ATOMIC_RELAXED);
+
+    if (NULL == file->node->ops->ioctl) {
+        errno = ENOTTY;
+        return -1;
+    }
+
+    return file->node->ops->ioctl(file, cmd, arg);
+}
+
+static const struct hal_io_ops sim_io_ops = {
+    .name  = "sim",
+    .open  = sim_open,
+    .close = sim_close,
+    .read  = sim_read,
+    .write = sim_write,
+    .lseek = sim_lseek,
+    .ioctl = sim_ioctl,
+    .poll  = NULL, /* every simulated node has a real descriptor */
+};
+
+/** sink nodes ***************************************************************/
+static int sink_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    (void)file;
+    (void)cmd;
+    (void)arg;
+
+    return 0;
+}
+
+static ssize_t sink_read(struct hal_sim_file* file, void* buf, size_t size)
+{
+    (void)file;
+
+    memset(buf, 0, size);
+
+    return size;
+}
+
+static ssize_t sink_write(struct hal_sim_file* file, const void* buf, size_t size)
+{
+    (void)file;
+    (void)buf;
+
+    return size;
+}
+
+static const struct hal_sim_node_ops sink_ops = {
+    .read  = sink_read,
+    .write = sink_write,
+    .ioctl = sink_ioctl,
+};
+
+int hal_sim_register_sink(const char* path) { return hal_sim_register(path, &sink_ops, NULL); }
+
+/** /dev/mem *****************************************************************/
+static int sim_mem_setup(void)
+{
+    const char* path = getenv("HAL_SIM_MEM");
+    char        tmpl[] = "/tmp/hal_sim_mem.XXXXXX";
+
+    if (path) {
+        sim_mem_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    } else if (0 <= (sim_mem_fd = mkstemp(tmpl))) {
+        unlink(tmpl);
+    }
+
+    if (0 > sim_mem_fd) {
+        printf("[hal_sim]: create memory file failed\n");
+        return -1;
+    }
+
+    /* sparse, only touched register pages take space; all zero means every pin is GPIOn */
+    if (0x00 != ftruncate(sim_mem_fd, SIM_MEM_SIZE)) {
+        printf("[hal_sim]: size memory file failed\n");
+        close(sim_mem_fd);
+        sim_mem_fd = -1;
+        return -1;
+    }
+
+    snprintf(sim_mem_path, sizeof(sim_mem_path), "/proc/self/fd/%d", sim_mem_fd);
+
+    return utils_mem_map_set_device(sim_mem_path);
+}
+
+/** init *********************************************************************/
+int hal_sim_init(void)
+{
+    static const char* const sinks[] = {
+        "/dev/pwm", "/dev/ws2812", "/dev/onewire", "/dev/ts", "/dev/watchdog1",
+    };
+
+    if (sim_inited) {
+        return 0;
+    }
+    sim_inited = 1;
+
+    if (0x00 != sim_mem_setup()) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+        hal_sim_register_sink(sinks[i]);
+    }
+
+    if ((0x00 != hal_sim_uart_setup()) || (0x00 != hal_sim_gpio_setup()) || (0x00 != hal_sim_spi_setup())
+        || (0x00 != hal_sim_i2c_setup()) || (0x00 != hal_sim_adc_setup()) || (0x00 != hal_sim_misc_setup())) {
+        printf("[hal_sim]: setup nodes failed\n");
+        return -1;
+    }
+
+    if ((NULL == getenv("HAL_SIM_BARE")) && (0x00 != hal_sim_board_setup())) {
+        printf("[hal_sim]: setup board failed\n");
+        return -1;
+    }
+
+    return hal_io_set_backend(&sim_io_ops);
+}
+
+void hal_sim_deinit(void)
+{
+    if (!sim_inited) {
+        return;
+    }
+
+    hal_io_set_backend(NULL);
+    hal_sim_board_teardown();
+
+    utils_mem_map_trim();
+    utils_mem_map_set_device(NULL);
+    if (0 <= sim_mem_fd) {
+        close(sim_mem_fd);
+        sim_mem_fd = -1;
+    }
+
+    sim_inited = 0;
+}
+
+__attribute__((constructor)) static void hal_sim_auto_init(void)
+{
+    if (0x00 != hal_sim_init()) {
+        printf("[hal_sim]: init failed, device nodes are not simulated\n");
+    }
+}
@@ -0,0 +1,354 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host simulation of the rtsmart_hal device nodes.
+ *
+ * Linked into a host build (HAL_IO_BACKEND, see testcases/rtsmart_hal/
+ * Makefile.host) it installs itself as the hal_io backend before main() and
+ * serves the nodes the drivers open:
+ *
+ *  /dev/uart0..4   pseudo terminals, the test side is the pty master
+ *  /dev/gpio       72 pins with levels, modes, irq signals and edge injection
+ *  /dev/spi0..2    bus with attachable device models (SPI NOR, ST7789 LCD)
+ *  /dev/i2c0..4    bus with register model devices
+ *  /dev/adc        scripted waveforms per channel
+ *  /dev/canmv_misc soft i2c buses, encoder nodes, memory and time queries
+ *  /dev/mem        a sparse temporary file, so FPIOA starts with every pin GPIO
+ *
+ * and accepts every request on /dev/pwm, /dev/ws2812, /dev/onewire, /dev/ts
+ * and /dev/watchdog1. Unless HAL_SIM_BARE is set in the
+ * environment a default board is populated that matches the wiring of the
+ * existing testcases, see hal_sim_board_setup().
+ *
+ * Every opened node is backed by a real descriptor (the pty slave or an
+ * eventfd), so poll() and the fd numbers behave like on the board.
+ */
+
+#define HAL_SIM_MAX_NODES (64)
+#define HAL_SIM_MAX_FDS   (1024)
+
+/** core *********************************************************************/
+struct hal_sim_node;
+
+struct hal_sim_file {
+    int   fd; /**< real descriptor handed to the driver */
+    int   flags;
+    off_t pos; /**< set by lseek, used as pin or channel by gpio and adc */
+
+    const struct hal_sim_node* node;
+    void*                      priv; /**< node private data */
+};
+
+/*
+ * NULL read/write pass the call to libc on file->fd, a node that sets its own
+ * fd in open() (the uarts) gets the real device semantics for free.
+ */
+struct hal_sim_node_ops {
+    int (*open)(struct hal_sim_file* file);
+    void (*release)(struct hal_sim_file* file);
+    ssize_t (*read)(struct hal_sim_file* file, void* buf, size_t size);
+    ssize_t (*write)(struct hal_sim_file* file, const void* buf, size_t size);
+    int (*ioctl)(struct hal_sim_file* file, unsigned long cmd, void* arg);
+};
+
+struct hal_sim_node {
+    char                           path[32];
+    const struct hal_sim_node_ops* ops;
+    void*                          priv;
+    uint64_t                       ioctls; /**< requests served, for tests */
+};
+
+/**
+ * @brief Set up the simulated nodes and install the backend, runs from a
+ *        constructor, calling it again is harmless.
+ * @return 0 on success, -1 on failure.
+ */
+int  hal_sim_init(void);
+void hal_sim_deinit(void);
+
+/**
+ * @brief Serve @path with @ops, replaces an existing node of the same path.
+ * @return 0 on success, -1 if the node table is full.
+ */
+int hal_sim_register(const char* path, const struct hal_sim_node_ops* ops, void* priv);
+int hal_sim_unregister(const char* path);
+
+const struct hal_sim_node* hal_sim_find(const char* path);
+
+/** @brief Node that accepts every request, for drivers the sim does not model. */
+int hal_sim_register_sink(const char* path);
+
+/** uart *********************************************************************/
+int hal_sim_uart_setup(void);
+
+/**
+ * @brief The pty master of uart @id, what the device on the other end of the
+ *        wire reads and writes. Created on first use.
+ * @return descriptor, -1 on failure.
+ */
+int hal_sim_uart_peer(int id);
+
+/**
+ * @brief Wire the TX of uart @a to the RX of uart @b and back, @a == @b is a
+ *        loopback. A forwarding thread copies between the two masters.
+ * @return 0 on success, -1 on failure.
+ */
+int hal_sim_uart_connect(int a, int b);
+void hal_sim_uart_disconnect(int id);
+
+/* Modbus RTU slaves, holding and input registers share one bank */
+struct hal_sim_modbus_stats {
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t exceptions;
+    uint64_t crc_errors;
+    uint64_t ignored; /**< other slaves and dead ones */
+};
+
+struct hal_sim_modbus;
+
+/**
+ * @brief Serve slaves @first..@first+@slaves-1 with @num_regs registers each
+ *        on the wire of uart @id, which must not be connected to another uart.
+ * @param baud line rate answers are paced at, 0 answers at once
+ */
+struct hal_sim_modbus* hal_sim_modbus_create(int id, uint8_t first, int slaves, uint32_t num_regs, uint32_t baud);
+void                   hal_sim_modbus_destroy(struct hal_sim_modbus* mb);
+
+uint16_t* hal_sim_modbus_regs(struct hal_sim_modbus* mb, uint8_t slave);
+
+/** @brief Extra turnaround before every answer. */
+void hal_sim_modbus_set_delay(struct hal_sim_modbus* mb, uint32_t delay_us);
+/** @brief Stall every answer for @gap_us after its first @after bytes, 0 @gap_us for none. */
+void hal_sim_modbus_set_gap(struct hal_sim_modbus* mb, size_t after, uint32_t gap_us);
+/** @brief A dead slave ignores its requests. */
+void hal_sim_modbus_set_dead(struct hal_sim_modbus* mb, uint8_t slave, int dead);
+void hal_sim_modbus_get_stats(struct hal_sim_modbus* mb, struct hal_sim_modbus_stats* stats);
+
+/** gpio *********************************************************************/
+typedef void (*hal_sim_gpio_watch_fn)(int pin, int level, void* args);
+
+int hal_sim_gpio_setup(void);
+
+/**
+ * @brief Drive an input pin from outside, raises the configured irq edge.
+ *        Level -1 releases the pin to its pull resistor.
+ */
+int hal_sim_gpio_inject(int pin, int level);
+int hal_sim_gpio_get(int pin); /**< current pin level, -1 on invalid pin */
+int hal_sim_gpio_get_mode(int pin);
+
+/** @brief Call @fn on every level change of @pin, returns a watch id. */
+int  hal_sim_gpio_watch(int pin, hal_sim_gpio_watch_fn fn, void* args);
+void hal_sim_gpio_unwatch(int id);
+
+/** @brief Irq signals delivered so far, for one pin or all pins with -1. */
+uint64_t hal_sim_gpio_irq_count(int pin);
+
+/** @brief Answer the multi-pin port request (default), or reject it like an older kernel. */
+void hal_sim_gpio_port_enable(int enable);
+
+/** spi **********************************************************************/
+struct hal_sim_spi_dev {
+    const char* name;
+
+    /* frame start and end, cs edges */
+    void (*select)(struct hal_sim_spi_dev* dev);
+    void (*deselect)(struct hal_sim_spi_dev* dev);
+    /* one full duplex chunk, @tx or @rx may be NULL */
+    void (*xfer)(struct hal_sim_spi_dev* dev, const uint8_t* tx, uint8_t* rx, size_t len);
+
+    /* owned by the bus */
+    int                     bus, cs_pin, watch;
+    struct hal_sim_spi_dev* next;
+};
+
+struct hal_sim_spi_stats {
+    uint64_t transfers; /**< RW requests */
+    uint64_t messages;
+    uint64_t bytes; /**< all stages */
+    uint64_t wire_ns; /**< time the bytes took at the configured clock */
+};
+
+int hal_sim_spi_setup(void);
+
+/**
+ * @brief Attach @dev to bus @bus behind chip select @cs_pin.
+ *
+ * A transfer selects the device whose pin the driver configured as soft cs,
+ * cs_take and cs_release frame it. With a cs pin the HAL does not drive
+ * (soft cs 0) the frame follows the gpio level of @cs_pin instead, active low.
+ * @cs_pin -1 receives every transfer without a soft cs.
+ */
+int  hal_sim_spi_attach(int bus, int cs_pin, struct hal_sim_spi_dev* dev);
+void hal_sim_spi_detach(struct hal_sim_spi_dev* dev);
+
+/**
+ * @brief Make transfers take as long as the bytes need on the wire at the
+ *        configured clock, so throughput numbers resemble the board.
+ */
+void hal_sim_spi_set_pacing(int bus, int enable);
+/** @brief Fail the next @transfers RW requests on @bus with EIO. */
+void hal_sim_spi_fail(int bus, int transfers);
+void hal_sim_spi_get_stats(int bus, struct hal_sim_spi_stats* stats);
+
+/* SPI NOR, W25Qxx command set */
+struct hal_sim_nor_stats {
+    uint64_t read_bytes;
+    uint64_t prog_bytes;
+    uint64_t erases;
+    uint64_t erased_bytes;
+    uint64_t rejected; /**< program/erase without write enable */
+};
+
+struct hal_sim_nor;
+
+/**
+ * @brief Create a NOR flash of @size bytes, erased.
+ * @param path backing file, kept across runs, NULL for memory only
+ * @param jedec_id manufacturer, type and capacity, e.g. 0xEF4018
+ */
+struct hal_sim_nor* hal_sim_nor_create(const char* path, uint32_t size, uint32_t jedec_id);
+void                hal_sim_nor_destroy(struct hal_sim_nor* nor);
+
+struct hal_sim_spi_dev* hal_sim_nor_dev(struct hal_sim_nor* nor);
+uint8_t*                hal_sim_nor_mem(struct hal_sim_nor* nor);
+
+/** @brief Busy times in us, all 0 (default) completes instantly. */
+void hal_sim_nor_set_timing(struct hal_sim_nor* nor, uint32_t page_prog_us, uint32_t sector_erase_us,
+                            uint32_t block_erase_us, uint32_t chip_erase_us);
+void hal_sim_nor_get_stats(struct hal_sim_nor* nor, struct hal_sim_nor_stats* stats);
+
+/* ST7789 style RGB565 LCD */
+struct hal_sim_lcd_stats {
+    uint64_t commands;
+    uint64_t pixels;
+    uint64_t ram_writes; /**< RAMWR commands */
+};
+
+struct hal_sim_lcd;
+
+/** @brief LCD of @width x @height pixels, @dc_pin low selects command bytes. */
+struct hal_sim_lcd* hal_sim_lcd_create(int width, int height, int dc_pin);
+void                hal_sim_lcd_destroy(struct hal_sim_lcd* lcd);
+
+struct hal_sim_spi_dev* hal_sim_lcd_dev(struct hal_sim_lcd* lcd);
+
+uint16_t hal_sim_lcd_pixel(struct hal_sim_lcd* lcd, int x, int y);
+int      hal_sim_lcd_display_on(struct hal_sim_lcd* lcd);
+uint8_t  hal_sim_lcd_madctl(struct hal_sim_lcd* lcd);
+void     hal_sim_lcd_get_stats(struct hal_sim_lcd* lcd, struct hal_sim_lcd_stats* stats);
+
+/** @brief Write the framebuffer as a binary PPM image. */
+int hal_sim_lcd_dump_ppm(struct hal_sim_lcd* lcd, const char* path);
+
+/** i2c **********************************************************************/
+struct hal_sim_i2c_dev {
+    const char* name;
+    uint16_t    addr;
+
+    uint8_t* regs; /**< register file */
+    uint32_t size;
+    uint8_t  addr_bytes; /**< register pointer width, 1 or 2 */
+
+    /* optional behaviour on top of the register file, called with the bus locked */
+    void (*on_write)(struct hal_sim_i2c_dev* dev, uint32_t reg, uint8_t val);
+    void (*on_read)(struct hal_sim_i2c_dev* dev, uint32_t reg);
+
+    /* owned by the bus */
+    uint32_t                ptr;
+    int                     bus;
+    struct hal_sim_i2c_dev* next;
+};
+
+int hal_sim_i2c_setup(void);
+
+/** @brief Add or remove the node of soft i2c bus @id, done by /dev/canmv_misc. */
+int hal_sim_i2c_soft_bus(int id, int create);
+
+/** @brief Attach @dev on bus @bus at dev->addr, the bus NAKs other addresses. */
+int  hal_sim_i2c_attach(int bus, struct hal_sim_i2c_dev* dev);
+void hal_sim_i2c_detach(struct hal_sim_i2c_dev* dev);
+
+/** adc **********************************************************************/
+typedef enum {
+    HAL_SIM_WAVE_CONST,
+    HAL_SIM_WAVE_SINE,
+    HAL_SIM_WAVE_SQUARE,
+    HAL_SIM_WAVE_TRIANGLE,
+    HAL_SIM_WAVE_RAMP,
+    HAL_SIM_WAVE_TABLE,
+} hal_sim_wave_t;
+
+int hal_sim_adc_setup(void);
+
+/** @brief Raw value @min..@max (0..4095) following @wave with @period_us, noise in lsb. */
+int hal_sim_adc_set_wave(int channel, hal_sim_wave_t wave, uint32_t min, uint32_t max, uint32_t period_us,
+                         uint32_t noise);
+
+/** @brief Play @samples (copied) one every @sample_us, looping. */
+int hal_sim_adc_set_table(int channel, const uint16_t* samples, size_t count, uint32_t sample_us);
+
+/** @brief Value the channel reads now. */
+uint32_t hal_sim_adc_sample(int channel);
+
+/** misc *********************************************************************/
+
+/**
+ * @brief /dev/canmv_misc: soft i2c and rotary encoder creation add the matching
+ *        nodes, memory and time queries answer from the host.
+ */
+int hal_sim_misc_setup(void);
+
+/** board ********************************************************************/
+
+/**
+ * @brief Populate the default board:
+ *  - uart2 TX/RX crossed with uart3 (test_uart)
+ *  - W25Q128 on spi2 behind cs 11 and a second one behind cs 14 (test_spi_wq128)
+ *  - 320x240 ST7789 on spi1, cs 19, dc 20 (test_spi_st7789)
+ *  - SSD1306 at 0x3c on i2c0..4 (test_i2c_ssd1306)
+ *  - adc0 1 Hz sine, adc1 ramp, adc2 square, adc3..5 constant
+ */
+int  hal_sim_board_setup(void);
+void hal_sim_board_teardown(void);
+
+struct hal_sim_nor* hal_sim_board_nor(int index);
+struct hal_sim_lcd* hal_sim_board_lcd(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,228 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "drv_adc.h"
+#include "hal_sim.h"
+
+/* must match drv_adc.c */
+#define RT_ADC_CMD_ENABLE  (0)
+#define RT_ADC_CMD_DISABLE (1)
+
+struct sim_adc_chn {
+    hal_sim_wave_t wave;
+    uint32_t       min, max, period_us, noise;
+    uint64_t       start_ns;
+    uint16_t*      table;
+    size_t         count;
+    uint32_t       rand;
+    int            enabled;
+};
+
+static struct sim_adc_chn sim_adc_chns[DRV_ADC_MAX_CHANNEL];
+static pthread_mutex_t    sim_adc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t sim_adc_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t sim_adc_eval(struct sim_adc_chn* chn)
+{
+    uint64_t t_us  = (sim_adc_now_ns() - chn->start_ns) / 1000;
+    double   phase = chn->period_us ? (double)(t_us % chn->period_us) / chn->period_us : 0.0;
+    double   span  = (double)chn->max - chn->min;
+    double   v;
+
+    switch (chn->wave) {
+    case HAL_SIM_WAVE_SINE:
+        v = chn->min + span / 2 + span / 2 * sin(2 * M_PI * phase);
+        break;
+    case HAL_SIM_WAVE_SQUARE:
+        v = (phase < 0.5) ? chn->max : chn->min;
+        break;
+    case HAL_SIM_WAVE_TRIANGLE:
+        v = (phase < 0.5) ? chn->min + span * 2 * phase : chn->max - span * (2 * phase - 1);
+        break;
+    case HAL_SIM_WAVE_RAMP:
+        v = chn->min + span * phase;
+        break;
+    case HAL_SIM_WAVE_TABLE:
+        v = chn->count ? chn->table[(t_us / (chn->period_us ? chn->period_us : 1)) % chn->count] : 0;
+        break;
+    default:
+        v = chn->min;
+        break;
+    }
+
+    if (chn->noise) {
+        /* xorshift32, uniform in +-noise */
+        chn->rand ^= chn->rand << 13;
+        chn->rand ^= chn->rand >> 17;
+        chn->rand ^= chn->rand << 5;
+        v += (double)(chn->rand % (2 * chn->noise + 1)) - chn->noise;
+    }
+
+    if (v < 0) {
+        v = 0;
+    } else if (v > DRV_ADC_RESOLUTION) {
+        v = DRV_ADC_RESOLUTION;
+    }
+
+    return (uint32_t)(v + 0.5);
+}
+
+static ssize_t sim_adc_read(struct hal_sim_file* file, void* buf, size_t size)
+{
+    uint32_t value;
+
+    if ((0 > file->pos) || (DRV_ADC_MAX_CHANNEL <= file->pos) || (sizeof(value) > size)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    value = hal_sim_adc_sample(file->pos);
+    memcpy(buf, &value, sizeof(value));
+
+    return sizeof(value);
+}
+
+static int sim_adc_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    intptr_t channel = (intptr_t)arg;
+
+    (void)file;
+
+    if ((0 > channel) || (DRV_ADC_MAX_CHANNEL <= channel)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (RT_ADC_CMD_ENABLE == cmd) {
+        sim_adc_chns[channel].enabled = 1;
+    } else if (RT_ADC_CMD_DISABLE == cmd) {
+        sim_adc_chns[channel].enabled = 0;
+    } else {
+        errno = ENOTTY;
+        return -1;
+    }
+
+    return 0;
+}
+
+static const struct hal_sim_node_ops sim_adc_ops = {
+    .read  = sim_adc_read,
+    .ioctl = sim_adc_ioctl,
+};
+
+int hal_sim_adc_setup(void)
+{
+    for (int i = 0; i < DRV_ADC_MAX_CHANNEL; i++) {
+        sim_adc_chns[i].rand = 0x12345679u * (i + 1);
+        hal_sim_adc_set_wave(i, HAL_SIM_WAVE_CONST, DRV_ADC_RESOLUTION / 2, DRV_ADC_RESOLUTION / 2, 0, 0);
+    }
+
+    return hal_sim_register("/dev/adc", &sim_adc_ops, NULL);
+}
+
+int hal_sim_adc_set_wave(int channel, hal_sim_wave_t wave, uint32_t min, uint32_t max, uint32_t period_us,
+                         uint32_t noise)
+{
+    struct sim_adc_chn* chn;
+
+    if ((0 > channel) || (DRV_ADC_MAX_CHANNEL <= channel) || (HAL_SIM_WAVE_TABLE <= wave) || (min > max)) {
+        return -1;
+    }
+    chn = &sim_adc_chns[channel];
+
+    pthread_mutex_lock(&sim_adc_lock);
+    free(chn->table);
+    chn->table     = NULL;
+    chn->count     = 0;
+    chn->wave      = wave;
+    chn->min       = min;
+    chn->max       = max;
+    chn->period_us = period_us;
+    chn->noise     = noise;
+    chn->start_ns  = sim_adc_now_ns();
+    pthread_mutex_unlock(&sim_adc_lock);
+
+    return 0;
+}
+
+int hal_sim_adc_set_table(int channel, const uint16_t* samples, size_t count, uint32_t sample_us)
+{
+    struct sim_adc_chn* chn;
+    uint16_t*           table;
+
+    if ((0 > channel) || (DRV_ADC_MAX_CHANNEL <= channel) || (NULL == samples) || (0x00 == count)) {
+        return -1;
+    }
+    chn = &sim_adc_chns[channel];
+
+    if (NULL == (table = malloc(count * sizeof(*table)))) {
+        return -1;
+    }
+    memcpy(table, samples, count * sizeof(*table));
+
+    pthread_mutex_lock(&sim_adc_lock);
+    free(chn->table);
+    chn->table     = table;
+    chn->count     = count;
+    chn->wave      = HAL_SIM_WAVE_TABLE;
+    chn->period_us = sample_us;
+    chn->noise     = 0;
+    chn->start_ns  = sim_adc_now_ns();
+    pthread_mutex_unlock(&sim_adc_lock);
+
+    return 0;
+}
+
+uint32_t hal_sim_adc_sample(int channel)
+{
+    uint32_t value;
+
+    if ((0 > channel) || (DRV_ADC_MAX_CHANNEL <= channel)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&sim_adc_lock);
+    value = sim_adc_eval(&sim_adc_chns[channel]);
+    pthread_mutex_unlock(&sim_adc_lock);
+
+    return value;
+}
@@ -0,0 +1,132 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_sim.h"
+
+#define BOARD_NOR_NUM    (2)
+#define BOARD_NOR_SIZE   (16 * 1024 * 1024)
+#define BOARD_NOR_JEDEC  (0xEF4018) /* W25Q128JV */
+#define BOARD_NOR_BUS    (2)
+#define BOARD_LCD_BUS    (1)
+#define BOARD_LCD_CS     (19)
+#define BOARD_LCD_DC     (20)
+#define BOARD_LCD_WIDTH  (320)
+#define BOARD_LCD_HEIGHT (240)
+#define BOARD_I2C_NUM    (5)
+#define BOARD_OLED_ADDR  (0x3c)
+
+static const int board_nor_cs[BOARD_NOR_NUM] = { 11, 14 };
+
+static struct hal_sim_nor*    board_nor[BOARD_NOR_NUM];
+static struct hal_sim_lcd*    board_lcd;
+static struct hal_sim_i2c_dev board_oled[BOARD_I2C_NUM];
+static uint8_t                board_oled_regs[BOARD_I2C_NUM][256];
+static int                    board_uart_connected;
+
+int hal_sim_board_setup(void)
+{
+    char env[16];
+
+    if (0x00 != hal_sim_uart_connect(2, 3)) {
+        goto err;
+    }
+    board_uart_connected = 1;
+
+    for (int i = 0; i < BOARD_NOR_NUM; i++) {
+        /* HAL_SIM_NOR0/1 name image files that survive the process */
+        snprintf(env, sizeof(env), "HAL_SIM_NOR%d", i);
+
+        if ((NULL == (board_nor[i] = hal_sim_nor_create(getenv(env), BOARD_NOR_SIZE, BOARD_NOR_JEDEC)))
+            || (0x00 != hal_sim_spi_attach(BOARD_NOR_BUS, board_nor_cs[i], hal_sim_nor_dev(board_nor[i])))) {
+            goto err;
+        }
+    }
+
+    if ((NULL == (board_lcd = hal_sim_lcd_create(BOARD_LCD_WIDTH, BOARD_LCD_HEIGHT, BOARD_LCD_DC)))
+        || (0x00 != hal_sim_spi_attach(BOARD_LCD_BUS, BOARD_LCD_CS, hal_sim_lcd_dev(board_lcd)))) {
+        goto err;
+    }
+
+    for (int i = 0; i < BOARD_I2C_NUM; i++) {
+        board_oled[i].name       = "ssd1306";
+        board_oled[i].addr       = BOARD_OLED_ADDR;
+        board_oled[i].regs       = board_oled_regs[i];
+        board_oled[i].size       = sizeof(board_oled_regs[i]);
+        board_oled[i].addr_bytes = 1; /* control byte */
+
+        if (0x00 != hal_sim_i2c_attach(i, &board_oled[i])) {
+            goto err;
+        }
+    }
+
+    hal_sim_adc_set_wave(0, HAL_SIM_WAVE_SINE, 0, 4095, 1000000, 0);
+    hal_sim_adc_set_wave(1, HAL_SIM_WAVE_RAMP, 0, 4095, 1000000, 0);
+    hal_sim_adc_set_wave(2, HAL_SIM_WAVE_SQUARE, 0, 4095, 100000, 0);
+
+    return 0;
+
+err:
+    printf("[hal_sim]: populate board failed\n");
+    hal_sim_board_teardown();
+
+    return -1;
+}
+
+void hal_sim_board_teardown(void)
+{
+    for (int i = 0; i < BOARD_I2C_NUM; i++) {
+        hal_sim_i2c_detach(&board_oled[i]);
+    }
+
+    if (board_lcd) {
+        hal_sim_spi_detach(hal_sim_lcd_dev(board_lcd));
+        hal_sim_lcd_destroy(board_lcd);
+        board_lcd = NULL;
+    }
+
+    for (int i = 0; i < BOARD_NOR_NUM; i++) {
+        if (board_nor[i]) {
+            hal_sim_spi_detach(hal_sim_nor_dev(board_nor[i]));
+            hal_sim_nor_destroy(board_nor[i]);
+            board_nor[i] = NULL;
+        }
+    }
+
+    if (board_uart_connected) {
+        hal_sim_uart_disconnect(2);
+        board_uart_connected = 0;
+    }
+}
+
+struct hal_sim_nor* hal_sim_board_nor(int index)
+{
+    return ((0 <= index) && (BOARD_NOR_NUM > index)) ? board_nor[index] : NULL;
+}
+
+struct hal_sim_lcd* hal_sim_board_lcd(void) { return board_lcd; }
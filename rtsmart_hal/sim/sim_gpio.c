@@ -0,0 +1,467 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "drv_gpio.h"
+#include "hal_sim.h"
+
+/* must match drv_gpio.c */
+#define KD_GPIO_IOCTL_SET_MODE _IOW('G', 0, gpio_cfg_t*)
+#define KD_GPIO_IOCTL_GET_MODE _IOR('G', 1, gpio_cfg_t*)
+#define KD_GPIO_IOCTL_SET_IRQ  _IOW('G', 2, gpio_irqcfg_t*)
+#define KD_GPIO_IOCTL_GET_IRQ  _IOR('G', 3, gpio_irqcfg_t*)
+#define KD_GPIO_IOCTL_CTRL_IRQ _IOWR('G', 4, gpio_cfg_t*)
+#define KD_GPIO_IOCTL_PORT     _IOWR('G', 5, gpio_port_cfg_t*)
+
+#define SIM_GPIO_MAX_WATCH (32)
+
+typedef struct {
+    uint16_t pin;
+    uint16_t value;
+} gpio_cfg_t;
+
+typedef struct {
+    uint16_t pin;
+    uint16_t mode;
+    uint16_t debounce_ms;
+    uint16_t signo;
+    void*    sigval;
+} gpio_irqcfg_t;
+
+typedef struct {
+    uint32_t op;
+    uint32_t reserved;
+    uint64_t mask;
+    uint64_t value;
+} gpio_port_cfg_t;
+
+struct sim_pin {
+    uint8_t mode; /**< gpio_drive_mode_t */
+    int8_t  drive; /**< level forced from outside, -1 released */
+    uint8_t out; /**< output latch */
+    uint8_t level; /**< what the pin reads */
+
+    uint8_t  irq_mode; /**< gpio_pin_edge_t, GPIO_PE_MAX none */
+    uint8_t  irq_en;
+    uint16_t signo;
+    void*    sigval;
+    uint64_t irqs;
+};
+
+struct sim_watch {
+    int                   pin;
+    hal_sim_gpio_watch_fn fn;
+    void*                 args;
+};
+
+/* what to do once the lock is dropped */
+struct sim_event {
+    int   pin, level, signo;
+    void* sigval;
+};
+
+static struct sim_pin   sim_pins[GPIO_MAX_NUM];
+static struct sim_watch sim_watches[SIM_GPIO_MAX_WATCH];
+static pthread_mutex_t  sim_gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+static int              sim_gpio_port = 1;
+
+static int sim_gpio_level(const struct sim_pin* p)
+{
+    switch (p->mode) {
+    case GPIO_DM_OUTPUT:
+        return p->out;
+    case GPIO_DM_OUTPUT_OD:
+        return p->out ? ((0 <= p->drive) ? p->drive : 1) : 0;
+    case GPIO_DM_INPUT_PULLUP:
+        return (0 <= p->drive) ? p->drive : 1;
+    default:
+        return (0 <= p->drive) ? p->drive : 0;
+    }
+}
+
+static int sim_gpio_irq_hit(const struct sim_pin* p, int old, int now)
+{
+    if (!p->irq_en) {
+        return 0;
+    }
+
+    switch (p->irq_mode) {
+    case GPIO_PE_RISING:
+        return !old && now;
+    case GPIO_PE_FALLING:
+        return old && !now;
+    case GPIO_PE_BOTH:
+        return old != now;
+    case GPIO_PE_HIGH:
+        return (old != now) && now;
+    case GPIO_PE_LOW:
+        return (old != now) && !now;
+    default:
+        return 0;
+    }
+}
+
+/* caller holds sim_gpio_lock, returns 1 if @ev needs delivering */
+static int sim_gpio_update_locked(int pin, struct sim_event* ev)
+{
+    struct sim_pin* p   = &sim_pins[pin];
+    int             old = p->level;
+    int             now = sim_gpio_level(p);
+
+    if (old == now) {
+        return 0;
+    }
+    p->level = now;
+
+    ev->pin    = pin;
+    ev->level  = now;
+    ev->signo  = 0;
+    ev->sigval = NULL;
+    if (sim_gpio_irq_hit(p, old, now)) {
+        ev->signo  = p->signo;
+        ev->sigval = p->sigval;
+        p->irqs++;
+    }
+
+    return 1;
+}
+
+static void sim_gpio_raise(int signo, void* sigval)
+{
+    siginfo_t si;
+
+    /* what the kernel sends: SI_SIGIO with the instance as value */
+    memset(&si, 0, sizeof(si));
+    si.si_signo = signo;
+    si.si_code  = SI_SIGIO;
+    si.si_pid   = getpid();
+    si.si_uid   = getuid();
+    si.si_ptr   = sigval;
+
+    syscall(SYS_rt_sigqueueinfo, getpid(), signo, &si);
+}
+
+static void sim_gpio_deliver(const struct sim_event* ev)
+{
+    for (int i = 0; i < SIM_GPIO_MAX_WATCH; i++) {
+        struct sim_watch w = sim_watches[i];
+
+        if (w.fn && (w.pin == ev->pin)) {
+            w.fn(ev->pin, ev->level, w.args);
+        }
+    }
+
+    if (ev->signo) {
+        sim_gpio_raise(ev->signo, ev->sigval);
+    }
+}
+
+static ssize_t sim_gpio_read(struct hal_sim_file* file, void* buf, size_t size)
+{
+    if ((0 > file->pos) || (GPIO_MAX_NUM <= file->pos) || (0x00 == size)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *(uint8_t*)buf = __atomic_load_n(&sim_pins[file->pos].level, __ATOMIC_RELAXED);
+
+    return 1;
+}
+
+static ssize_t sim_gpio_write(struct hal_sim_file* file, const void* buf, size_t size)
+{
+    struct sim_event ev;
+    int              pin = file->pos, fire;
+
+    if ((0 > pin) || (GPIO_MAX_NUM <= pin) || (0x00 == size)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_gpio_lock);
+    sim_pins[pin].out = !!*(const uint8_t*)buf;
+    fire              = sim_gpio_update_locked(pin, &ev);
+    pthread_mutex_unlock(&sim_gpio_lock);
+
+    if (fire) {
+        sim_gpio_deliver(&ev);
+    }
+
+    return 1;
+}
+
+/* the whole request under one lock hold, like the kernel touching the data registers once */
+static int sim_gpio_port_request(gpio_port_cfg_t* cfg)
+{
+    struct sim_event evs[GPIO_PORT_MAX_NUM];
+    int              fired  = 0;
+    uint64_t         levels = 0;
+
+    if (!__atomic_load_n(&sim_gpio_port, __ATOMIC_RELAXED)) {
+        errno = ENOTTY;
+        return -1;
+    }
+
+    if (GPIO_PORT_OP_MAX <= cfg->op) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_gpio_lock);
+    for (uint64_t bits = cfg->mask; bits; bits &= bits - 1) {
+        int             pin = __builtin_ctzll(bits);
+        struct sim_pin* p   = &sim_pins[pin];
+
+        switch (cfg->op) {
+        case GPIO_PORT_OP_SET:
+            p->out = 1;
+            break;
+        case GPIO_PORT_OP_CLEAR:
+            p->out = 0;
+            break;
+        case GPIO_PORT_OP_TOGGLE:
+            p->out = !p->out;
+            break;
+        case GPIO_PORT_OP_WRITE:
+            p->out = (cfg->value >> pin) & 1;
+            break;
+        default:
+            levels |= (uint64_t)p->level << pin;
+            continue;
+        }
+        fired += sim_gpio_update_locked(pin, &evs[fired]);
+    }
+    pthread_mutex_unlock(&sim_gpio_lock);
+
+    if (GPIO_PORT_OP_READ == cfg->op) {
+        cfg->value = levels;
+    }
+
+    for (int i = 0; i < fired; i++) {
+        sim_gpio_deliver(&evs[i]);
+    }
+
+    return 0;
+}
+
+static int sim_gpio_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    gpio_cfg_t*      cfg    = arg;
+    gpio_irqcfg_t*   irqcfg = arg;
+    struct sim_pin*  p;
+    struct sim_event ev;
+    int              fire = 0;
+
+    (void)file;
+
+    if (arg && (KD_GPIO_IOCTL_PORT == cmd)) {
+        return sim_gpio_port_request(arg);
+    }
+
+    if ((NULL == arg) || (GPIO_MAX_NUM <= cfg->pin)) {
+        errno = EINVAL;
+        return -1;
+    }
+    p = &sim_pins[cfg->pin];
+
+    pthread_mutex_lock(&sim_gpio_lock);
+
+    switch (cmd) {
+    case KD_GPIO_IOCTL_SET_MODE:
+        p->mode = cfg->value;
+        fire    = sim_gpio_update_locked(cfg->pin, &ev);
+        break;
+    case KD_GPIO_IOCTL_GET_MODE:
+        cfg->value = p->mode;
+        break;
+    case KD_GPIO_IOCTL_SET_IRQ:
+        if ((GPIO_IRQ_MAX_NUM <= irqcfg->pin) || (GPIO_PE_MAX <= irqcfg->mode)) {
+            pthread_mutex_unlock(&sim_gpio_lock);
+            errno = EINVAL;
+            return -1;
+        }
+        /* debounce is not modelled, injected edges are clean */
+        p->irq_mode = irqcfg->mode;
+        p->signo    = irqcfg->signo;
+        p->sigval   = irqcfg->sigval;
+        p->irq_en   = 0;
+        break;
+    case KD_GPIO_IOCTL_GET_IRQ:
+        irqcfg->mode   = p->irq_mode;
+        irqcfg->signo  = p->signo;
+        irqcfg->sigval = p->sigval;
+        break;
+    case KD_GPIO_IOCTL_CTRL_IRQ:
+        if (cfg->value & (1 << 7)) {
+            p->irq_mode = GPIO_PE_MAX;
+            p->irq_en   = 0;
+            p->signo    = 0;
+            p->sigval   = NULL;
+        } else {
+            p->irq_en = cfg->value & 1;
+            /* a level irq enabled while the level is already there fires at once */
+            if (p->irq_en && p->signo
+                && (((GPIO_PE_HIGH == p->irq_mode) && p->level) || ((GPIO_PE_LOW == p->irq_mode) && !p->level))) {
+                ev.pin    = cfg->pin;
+                ev.level  = p->level;
+                ev.signo  = p->signo;
+                ev.sigval = p->sigval;
+                p->irqs++;
+                fire = 1;
+            }
+        }
+        break;
+    default:
+        pthread_mutex_unlock(&sim_gpio_lock);
+        errno = ENOTTY;
+        return -1;
+    }
+
+    pthread_mutex_unlock(&sim_gpio_lock);
+
+    if (fire) {
+        sim_gpio_deliver(&ev);
+    }
+
+    return 0;
+}
+
+static const struct hal_sim_node_ops sim_gpio_ops = {
+    .read  = sim_gpio_read,
+    .write = sim_gpio_write,
+    .ioctl = sim_gpio_ioctl,
+};
+
+int hal_sim_gpio_setup(void)
+{
+    for (int i = 0; i < GPIO_MAX_NUM; i++) {
+        sim_pins[i].mode     = GPIO_DM_INPUT;
+        sim_pins[i].drive    = -1;
+        sim_pins[i].irq_mode = GPIO_PE_MAX;
+    }
+    sim_gpio_port = 1;
+
+    return hal_sim_register("/dev/gpio", &sim_gpio_ops, NULL);
+}
+
+int hal_sim_gpio_inject(int pin, int level)
+{
+    struct sim_event ev;
+    int              fire;
+
+    if ((0 > pin) || (GPIO_MAX_NUM <= pin)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_gpio_lock);
+    sim_pins[pin].drive = (0 > level) ? -1 : !!level;
+    fire                = sim_gpio_update_locked(pin, &ev);
+    pthread_mutex_unlock(&sim_gpio_lock);
+
+    if (fire) {
+        sim_gpio_deliver(&ev);
+    }
+
+    return 0;
+}
+
+int hal_sim_gpio_get(int pin)
+{
+    if ((0 > pin) || (GPIO_MAX_NUM <= pin)) {
+        return -1;
+    }
+
+    return __atomic_load_n(&sim_pins[pin].level, __ATOMIC_RELAXED);
+}
+
+int hal_sim_gpio_get_mode(int pin)
+{
+    if ((0 > pin) || (GPIO_MAX_NUM <= pin)) {
+        return -1;
+    }
+
+    return sim_pins[pin].mode;
+}
+
+int hal_sim_gpio_watch(int pin, hal_sim_gpio_watch_fn fn, void* args)
+{
+    int id = -1;
+
+    if ((0 > pin) || (GPIO_MAX_NUM <= pin) || (NULL == fn)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_gpio_lock);
+    for (int i = 0; i < SIM_GPIO_MAX_WATCH; i++) {
+        if (NULL == sim_watches[i].fn) {
+            sim_watches[i].pin  = pin;
+            sim_watches[i].args = args;
+            sim_watches[i].fn   = fn;
+            id                  = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_gpio_lock);
+
+    return id;
+}
+
+void hal_sim_gpio_unwatch(int id)
+{
+    if ((0 > id) || (SIM_GPIO_MAX_WATCH <= id)) {
+        return;
+    }
+
+    pthread_mutex_lock(&sim_gpio_lock);
+    memset(&sim_watches[id], 0, sizeof(sim_watches[id]));
+    pthread_mutex_unlock(&sim_gpio_lock);
+}
+
+uint64_t hal_sim_gpio_irq_count(int pin)
+{
+    uint64_t count = 0;
+
+    pthread_mutex_lock(&sim_gpio_lock);
+    for (int i = 0; i < GPIO_MAX_NUM; i++) {
+        if ((0 > pin) || (i == pin)) {
+            count += sim_pins[i].irqs;
+        }
+    }
+    pthread_mutex_unlock(&sim_gpio_lock);
+
+    return count;
+}
+
+void hal_sim_gpio_port_enable(int enable) { __atomic_store_n(&sim_gpio_port, !!enable, __ATOMIC_RELAXED); }
@@ -0,0 +1,230 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <pthread.h>
+
+#include "drv_i2c.h"
+#include "hal_sim.h"
+
+/* must match drv_i2c_master.c */
+#define RT_I2C_DEV_CTRL_10BIT   (8 * 0x100 + 0x01)
+#define RT_I2C_DEV_CTRL_TIMEOUT (8 * 0x100 + 0x03)
+#define RT_I2C_DEV_CTRL_RW      (8 * 0x100 + 0x04)
+#define RT_I2C_DEV_CTRL_CLK     (8 * 0x100 + 0x05)
+#define RT_I2C_DEV_CTRL_7BIT    (8 * 0x100 + 0x06)
+
+#define SIM_I2C_MAX_BUS (16) /* hard buses first, soft buses behind */
+
+struct rt_i2c_priv_data {
+    i2c_msg_t* msgs;
+    size_t     number;
+};
+
+struct sim_i2c_bus {
+    int                     id;
+    struct hal_sim_i2c_dev* devs;
+    uint32_t                clk, timeout;
+    uint64_t                transfers, naks;
+};
+
+static struct sim_i2c_bus sim_i2c_buses[SIM_I2C_MAX_BUS];
+static char               sim_i2c_paths[SIM_I2C_MAX_BUS][16];
+static pthread_mutex_t    sim_i2c_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct hal_sim_i2c_dev* sim_i2c_find(struct sim_i2c_bus* bus, uint16_t addr)
+{
+    struct hal_sim_i2c_dev* dev;
+
+    for (dev = bus->devs; dev; dev = dev->next) {
+        if (dev->addr == addr) {
+            return dev;
+        }
+    }
+
+    return NULL;
+}
+
+static void sim_i2c_msg(struct hal_sim_i2c_dev* dev, i2c_msg_t* msg)
+{
+    uint32_t i = 0;
+
+    if (msg->flags & DRV_I2C_RD) {
+        for (; i < msg->len; i++) {
+            if (dev->on_read) {
+                dev->on_read(dev, dev->ptr);
+            }
+            msg->buf[i] = dev->size ? dev->regs[dev->ptr % dev->size] : 0xff;
+            dev->ptr++;
+        }
+        return;
+    }
+
+    /* a write starts with the register pointer */
+    if (!(msg->flags & DRV_I2C_NO_START)) {
+        dev->ptr = 0;
+        for (; (i < msg->len) && (i < dev->addr_bytes); i++) {
+            dev->ptr = (dev->ptr << 8) | msg->buf[i];
+        }
+    }
+
+    for (; i < msg->len; i++) {
+        if (dev->size) {
+            dev->regs[dev->ptr % dev->size] = msg->buf[i];
+        }
+        if (dev->on_write) {
+            dev->on_write(dev, dev->ptr, msg->buf[i]);
+        }
+        dev->ptr++;
+    }
+}
+
+static int sim_i2c_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    struct sim_i2c_bus*      bus  = file->priv;
+    struct rt_i2c_priv_data* priv = arg;
+    int                      ret  = 0;
+
+    pthread_mutex_lock(&sim_i2c_lock);
+
+    switch (cmd) {
+    case RT_I2C_DEV_CTRL_RW:
+        bus->transfers++;
+        for (size_t i = 0; i < priv->number; i++) {
+            i2c_msg_t*              msg = &priv->msgs[i];
+            struct hal_sim_i2c_dev* dev = sim_i2c_find(bus, msg->addr);
+
+            if (dev) {
+                sim_i2c_msg(dev, msg);
+            } else if (!(msg->flags & DRV_I2C_IGNORE_NACK)) {
+                /* like the i2c device framework, a failed transfer is -EIO and success is 0 */
+                bus->naks++;
+                errno = EIO;
+                ret   = -1;
+                break;
+            }
+        }
+        break;
+    case RT_I2C_DEV_CTRL_CLK:
+        bus->clk = arg ? *(uint32_t*)arg : 0;
+        break;
+    case RT_I2C_DEV_CTRL_TIMEOUT:
+        bus->timeout = arg ? *(uint32_t*)arg : 0;
+        break;
+    case RT_I2C_DEV_CTRL_7BIT:
+    case RT_I2C_DEV_CTRL_10BIT:
+        break;
+    default:
+        errno = ENOTTY;
+        ret   = -1;
+        break;
+    }
+
+    pthread_mutex_unlock(&sim_i2c_lock);
+
+    return ret;
+}
+
+static const struct hal_sim_node_ops sim_i2c_ops = {
+    .ioctl = sim_i2c_ioctl,
+};
+
+static int sim_i2c_add_bus(int id)
+{
+    sim_i2c_buses[id].id = id;
+    snprintf(sim_i2c_paths[id], sizeof(sim_i2c_paths[id]), "/dev/i2c%d", id);
+
+    return hal_sim_register(sim_i2c_paths[id], &sim_i2c_ops, &sim_i2c_buses[id]);
+}
+
+int hal_sim_i2c_setup(void)
+{
+    for (int i = 0; i < KD_HARD_I2C_MAX_NUM; i++) {
+        if (0x00 != sim_i2c_add_bus(i)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* soft i2c buses come and go with MISC_DEV_CMD_CREATE/DELETE_SOFT_I2C */
+int hal_sim_i2c_soft_bus(int id, int create)
+{
+    if ((KD_HARD_I2C_MAX_NUM > id) || (SIM_I2C_MAX_BUS <= id)) {
+        return -1;
+    }
+
+    return create ? sim_i2c_add_bus(id) : hal_sim_unregister(sim_i2c_paths[id]);
+}
+
+int hal_sim_i2c_attach(int bus_id, struct hal_sim_i2c_dev* dev)
+{
+    struct sim_i2c_bus* bus;
+
+    if ((0 > bus_id) || (SIM_I2C_MAX_BUS <= bus_id) || (NULL == dev) || (2 < dev->addr_bytes)) {
+        return -1;
+    }
+    bus = &sim_i2c_buses[bus_id];
+
+    pthread_mutex_lock(&sim_i2c_lock);
+    if (sim_i2c_find(bus, dev->addr)) {
+        pthread_mutex_unlock(&sim_i2c_lock);
+        printf("[hal_sim]: i2c%d address 0x%02x already taken\n", bus_id, dev->addr);
+        return -1;
+    }
+    dev->bus  = bus_id;
+    dev->ptr  = 0;
+    dev->next = bus->devs;
+    bus->devs = dev;
+    pthread_mutex_unlock(&sim_i2c_lock);
+
+    return 0;
+}
+
+void hal_sim_i2c_detach(struct hal_sim_i2c_dev* dev)
+{
+    struct hal_sim_i2c_dev** pp;
+
+    if ((NULL == dev) || (0 > dev->bus) || (SIM_I2C_MAX_BUS <= dev->bus)) {
+        return;
+    }
+
+    pthread_mutex_lock(&sim_i2c_lock);
+    for (pp = &sim_i2c_buses[dev->bus].devs; *pp; pp = &(*pp)->next) {
+        if (*pp == dev) {
+            *pp = dev->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_i2c_lock);
+
+    dev->bus  = -1;
+    dev->next = NULL;
+}
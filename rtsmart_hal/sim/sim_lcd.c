@@ -0,0 +1,263 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_sim.h"
+
+/*
+ * ST7789 style RGB565 panel on 4 wire SPI, the dc pin tells command bytes
+ * from parameter and pixel bytes. The framebuffer is addressed the way the
+ * driver sees it, CASET picks columns and RASET rows; MADCTL is recorded but
+ * the rotation bits are not applied. Writes continue across cs frames, only
+ * a new command ends a RAMWR.
+ */
+
+struct hal_sim_lcd {
+    struct hal_sim_spi_dev dev;
+
+    int       width, height, dc_pin;
+    uint16_t* fb;
+
+    uint8_t  cmd;
+    uint32_t param; /**< parameter bytes since the command */
+    uint16_t xs, xe, ys, ye, x, y;
+    uint8_t  hi;
+
+    uint8_t madctl, colmod;
+    int     display_on, sleeping, inverted;
+
+    struct hal_sim_lcd_stats stats;
+};
+
+static void lcd_reset(struct hal_sim_lcd* lcd)
+{
+    lcd->cmd        = 0x00;
+    lcd->xs         = 0;
+    lcd->xe         = lcd->width - 1;
+    lcd->ys         = 0;
+    lcd->ye         = lcd->height - 1;
+    lcd->madctl     = 0x00;
+    lcd->colmod     = 0x66;
+    lcd->display_on = 0;
+    lcd->sleeping   = 1;
+    lcd->inverted   = 0;
+}
+
+static void lcd_command(struct hal_sim_lcd* lcd, uint8_t cmd)
+{
+    lcd->cmd   = cmd;
+    lcd->param = 0;
+    lcd->stats.commands++;
+
+    switch (cmd) {
+    case 0x01: /* SWRESET */
+        lcd_reset(lcd);
+        break;
+    case 0x10: /* SLPIN */
+        lcd->sleeping = 1;
+        break;
+    case 0x11: /* SLPOUT */
+        lcd->sleeping = 0;
+        break;
+    case 0x20: /* INVOFF */
+        lcd->inverted = 0;
+        break;
+    case 0x21: /* INVON */
+        lcd->inverted = 1;
+        break;
+    case 0x28: /* DISPOFF */
+        lcd->display_on = 0;
+        break;
+    case 0x29: /* DISPON */
+        lcd->display_on = 1;
+        break;
+    case 0x2C: /* RAMWR */
+        lcd->x = lcd->xs;
+        lcd->y = lcd->ys;
+        lcd->stats.ram_writes++;
+        break;
+    default:
+        break;
+    }
+}
+
+static void lcd_param(struct hal_sim_lcd* lcd, uint8_t in)
+{
+    uint32_t idx = lcd->param++;
+
+    switch (lcd->cmd) {
+    case 0x2A: /* CASET */
+    case 0x2B: /* RASET */ {
+        uint16_t* start = (0x2A == lcd->cmd) ? &lcd->xs : &lcd->ys;
+        uint16_t* end   = (0x2A == lcd->cmd) ? &lcd->xe : &lcd->ye;
+
+        if (0 == idx) {
+            *start = (uint16_t)in << 8;
+        } else if (1 == idx) {
+            *start |= in;
+        } else if (2 == idx) {
+            *end = (uint16_t)in << 8;
+        } else if (3 == idx) {
+            *end |= in;
+        }
+        break;
+    }
+    case 0x36: /* MADCTL */
+        lcd->madctl = in;
+        break;
+    case 0x3A: /* COLMOD */
+        lcd->colmod = in;
+        break;
+    case 0x2C: /* RAMWR */
+    case 0x3C: /* RAMWRC */
+        if (0 == (idx & 1)) {
+            lcd->hi = in;
+            break;
+        }
+        if ((lcd->x < lcd->width) && (lcd->y < lcd->height)) {
+            lcd->fb[lcd->y * lcd->width + lcd->x] = ((uint16_t)lcd->hi << 8) | in;
+        }
+        lcd->stats.pixels++;
+        if (lcd->x++ >= lcd->xe) {
+            lcd->x = lcd->xs;
+            if (lcd->y++ >= lcd->ye) {
+                lcd->y = lcd->ys;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void lcd_xfer(struct hal_sim_spi_dev* dev, const uint8_t* tx, uint8_t* rx, size_t len)
+{
+    struct hal_sim_lcd* lcd = (struct hal_sim_lcd*)dev;
+    int                 dc  = hal_sim_gpio_get(lcd->dc_pin);
+
+    if (rx) {
+        memset(rx, 0x00, len);
+    }
+    if (NULL == tx) {
+        return;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (0 == dc) {
+            lcd_command(lcd, tx[i]);
+        } else {
+            lcd_param(lcd, tx[i]);
+        }
+    }
+}
+
+struct hal_sim_lcd* hal_sim_lcd_create(int width, int height, int dc_pin)
+{
+    struct hal_sim_lcd* lcd;
+
+    if ((0 >= width) || (0 >= height) || (0 > dc_pin)) {
+        return NULL;
+    }
+
+    if (NULL == (lcd = calloc(1, sizeof(*lcd)))) {
+        return NULL;
+    }
+    if (NULL == (lcd->fb = calloc((size_t)width * height, sizeof(uint16_t)))) {
+        free(lcd);
+        return NULL;
+    }
+
+    lcd->width  = width;
+    lcd->height = height;
+    lcd->dc_pin = dc_pin;
+    lcd_reset(lcd);
+
+    lcd->dev.name  = "st7789";
+    lcd->dev.xfer  = lcd_xfer;
+    lcd->dev.bus   = -1;
+    lcd->dev.watch = -1;
+
+    return lcd;
+}
+
+void hal_sim_lcd_destroy(struct hal_sim_lcd* lcd)
+{
+    if (NULL == lcd) {
+        return;
+    }
+
+    hal_sim_spi_detach(&lcd->dev);
+    free(lcd->fb);
+    free(lcd);
+}
+
+struct hal_sim_spi_dev* hal_sim_lcd_dev(struct hal_sim_lcd* lcd) { return lcd ? &lcd->dev : NULL; }
+
+uint16_t hal_sim_lcd_pixel(struct hal_sim_lcd* lcd, int x, int y)
+{
+    if ((NULL == lcd) || (0 > x) || (0 > y) || (lcd->width <= x) || (lcd->height <= y)) {
+        return 0;
+    }
+
+    return lcd->fb[y * lcd->width + x];
+}
+
+int hal_sim_lcd_display_on(struct hal_sim_lcd* lcd) { return lcd ? (lcd->display_on && !lcd->sleeping) : 0; }
+
+uint8_t hal_sim_lcd_madctl(struct hal_sim_lcd* lcd) { return lcd ? lcd->madctl : 0; }
+
+void hal_sim_lcd_get_stats(struct hal_sim_lcd* lcd, struct hal_sim_lcd_stats* stats)
+{
+    if (lcd && stats) {
+        *stats = lcd->stats;
+    }
+}
+
+int hal_sim_lcd_dump_ppm(struct hal_sim_lcd* lcd, const char* path)
+{
+    FILE* fp;
+
+    if ((NULL == lcd) || (NULL == (fp = fopen(path, "wb")))) {
+        return -1;
+    }
+
+    fprintf(fp, "P6\n%d %d\n255\n", lcd->width, lcd->height);
+    for (int i = 0; i < lcd->width * lcd->height; i++) {
+        uint16_t c      = lcd->fb[i];
+        uint8_t  rgb[3] = {
+            (uint8_t)(((c >> 11) & 0x1f) << 3),
+            (uint8_t)(((c >> 5) & 0x3f) << 2),
+            (uint8_t)((c & 0x1f) << 3),
+        };
+
+        fwrite(rgb, 1, sizeof(rgb), fp);
+    }
+    fclose(fp);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <errno.h>
+#include <sys/sysinfo.h>
+#include <time.h>
+
+#include "canmv_misc.h"
+#include "hal_sim.h"
+
+static int32_t sim_misc_timezone;
+static int     sim_misc_stage = STAGE_NORMAL;
+
+static int sim_misc_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    struct canmv_misc_dev_meminfo_t* meminfo = arg;
+    struct sysinfo                   si;
+    char                             path[32];
+    time_t                           now;
+
+    (void)file;
+
+    if (NULL == arg) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    switch (cmd) {
+    case MISC_DEV_CMD_READ_HEAP:
+    case MISC_DEV_CMD_READ_PAGE:
+        sysinfo(&si);
+        meminfo->total_size = (size_t)si.totalram * si.mem_unit;
+        meminfo->free_size  = (size_t)si.freeram * si.mem_unit;
+        meminfo->used_size  = meminfo->total_size - meminfo->free_size;
+        return 0;
+    case MISC_DEV_CMD_GET_MEMORY_SIZE:
+        sysinfo(&si);
+        *(uint64_t*)arg = (uint64_t)si.totalram * si.mem_unit;
+        return 0;
+    case MISC_DEV_CMD_CPU_USAGE:
+        *(int*)arg = 0;
+        return 0;
+    case MISC_DEV_CMD_CREATE_SOFT_I2C:
+        return hal_sim_i2c_soft_bus(((struct soft_i2c_configure*)arg)->bus_num, 1);
+    case MISC_DEV_CMD_DELETE_SOFT_I2C:
+        return hal_sim_i2c_soft_bus(*(uint32_t*)arg, 0);
+    case MISC_DEV_CMD_NTP_SYNC:
+        *(int*)arg = 0;
+        return 0;
+    case MISC_DEV_CMD_GET_UTC_TIMESTAMP:
+        *(time_t*)arg = time(NULL);
+        return 0;
+    case MISC_DEV_CMD_SET_UTC_TIMESTAMP:
+        /* the host clock is not ours to change */
+        return 0;
+    case MISC_DEV_CMD_GET_LOCAL_TIME:
+        now = time(NULL) + sim_misc_timezone * 60;
+        gmtime_r(&now, (struct tm*)arg);
+        return 0;
+    case MISC_DEV_CMD_SET_TIMEZONE:
+        sim_misc_timezone = *(int32_t*)arg;
+        return 0;
+    case MISC_DEV_CMD_GET_TIMEZONE:
+        *(int32_t*)arg = sim_misc_timezone;
+        return 0;
+    case MISC_DEV_CMD_SET_AUTO_EXEC_PY_STAGE:
+        sim_misc_stage = *(int*)arg;
+        return 0;
+    case MISC_DEV_CMD_CREATE_ROTARY_ENC_DEV:
+        snprintf(path, sizeof(path), "/dev/encoder%d", ((struct encoder_dev_cfg_t*)arg)->index);
+        return hal_sim_register_sink(path);
+    case MISC_DEV_CMD_DELETE_ROTARY_ENC_DEV:
+        snprintf(path, sizeof(path), "/dev/encoder%d", *(int*)arg);
+        return hal_sim_unregister(path);
+    default:
+        errno = ENOTTY;
+        return -1;
+    }
+}
+
+static const struct hal_sim_node_ops sim_misc_ops = {
+    .ioctl = sim_misc_ioctl,
+};
+
+int hal_sim_misc_setup(void)
+{
+    sim_misc_timezone = 0;
+    sim_misc_stage    = STAGE_NORMAL;
+
+    return hal_sim_register("/dev/canmv_misc", &sim_misc_ops, NULL);
+}
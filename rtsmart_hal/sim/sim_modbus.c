@@ -0,0 +1,343 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+
+/*
+ * Modbus RTU slaves behind the pty of a uart. Requests are framed by the
+ * length their function code implies, anything unknown ends at the first
+ * silence. Answers are held back for the time request and answer need on
+ * the wire at @baud plus the configured turnaround, so transaction rates
+ * resemble a real bus.
+ */
+
+#define MB_FRAME_MAX (256)
+#define MB_SILENCE_MS (5)
+
+struct hal_sim_modbus {
+    int       uart_id;
+    int       fd; /**< pty master of the uart */
+    int       stop_fd;
+    pthread_t thread;
+
+    uint8_t   first;
+    int       slaves;
+    uint32_t  num_regs;
+    uint32_t  baud;
+    uint32_t  delay_us;
+    size_t    gap_after; /**< answers stall after this many bytes */
+    uint32_t  gap_us;
+    uint16_t* regs; /**< @slaves banks of @num_regs */
+    uint8_t   dead[256];
+
+    uint8_t frame[MB_FRAME_MAX];
+    size_t  len;
+
+    struct hal_sim_modbus_stats stats;
+};
+
+static uint16_t mb_crc16(const uint8_t* data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+/* bytes the request needs, 0 while it can not be told yet */
+static size_t mb_request_len(const uint8_t* frame, size_t len)
+{
+    if (2 > len) {
+        return 0;
+    }
+
+    switch (frame[1]) {
+    case 0x03:
+    case 0x04:
+    case 0x06:
+        return 8;
+    case 0x10:
+        return (7 > len) ? 0 : (9 + frame[6]);
+    default:
+        return MB_FRAME_MAX;
+    }
+}
+
+static size_t mb_exception(uint8_t* rsp, const uint8_t* req, uint8_t code)
+{
+    rsp[0] = req[0];
+    rsp[1] = req[1] | 0x80;
+    rsp[2] = code;
+
+    return 3;
+}
+
+static size_t mb_execute(struct hal_sim_modbus* mb, const uint8_t* req, size_t len, uint8_t* rsp)
+{
+    uint16_t* bank  = mb->regs + (size_t)(req[0] - mb->first) * mb->num_regs;
+    uint32_t  addr  = (req[2] << 8) | req[3];
+    uint32_t  count = (req[4] << 8) | req[5];
+
+    switch (req[1]) {
+    case 0x03:
+    case 0x04:
+        if ((0x00 == count) || (125 < count)) {
+            return mb_exception(rsp, req, 0x03);
+        }
+        if (addr + count > mb->num_regs) {
+            return mb_exception(rsp, req, 0x02);
+        }
+        rsp[0] = req[0];
+        rsp[1] = req[1];
+        rsp[2] = 2 * count;
+        for (uint32_t i = 0; i < count; i++) {
+            rsp[3 + 2 * i] = bank[addr + i] >> 8;
+            rsp[4 + 2 * i] = bank[addr + i] & 0xFF;
+        }
+        return 3 + 2 * count;
+    case 0x06:
+        if (addr >= mb->num_regs) {
+            return mb_exception(rsp, req, 0x02);
+        }
+        bank[addr] = count;
+        memcpy(rsp, req, 6);
+        return 6;
+    case 0x10:
+        if ((0x00 == count) || (123 < count) || (req[6] != 2 * count) || (len != (size_t)(9 + req[6]))) {
+            return mb_exception(rsp, req, 0x03);
+        }
+        if (addr + count > mb->num_regs) {
+            return mb_exception(rsp, req, 0x02);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            bank[addr + i] = (req[7 + 2 * i] << 8) | req[8 + 2 * i];
+        }
+        memcpy(rsp, req, 6);
+        return 6;
+    default:
+        return mb_exception(rsp, req, 0x01);
+    }
+}
+
+static void mb_handle(struct hal_sim_modbus* mb, const uint8_t* req, size_t len)
+{
+    uint8_t  rsp[MB_FRAME_MAX];
+    size_t   rsp_len;
+    uint16_t crc;
+    uint64_t wire_us;
+
+    if ((4 > len) || (mb_crc16(req, len - 2) != (req[len - 2] | (req[len - 1] << 8)))) {
+        mb->stats.crc_errors++;
+        return;
+    }
+    mb->stats.requests++;
+
+    /* broadcasts are executed on every slave and never answered */
+    if (0x00 == req[0]) {
+        uint8_t copy[MB_FRAME_MAX];
+
+        memcpy(copy, req, len);
+        for (int i = 0; i < mb->slaves; i++) {
+            copy[0] = mb->first + i;
+            mb_execute(mb, copy, len, rsp);
+        }
+        return;
+    }
+
+    if ((req[0] < mb->first) || (req[0] >= mb->first + mb->slaves) || mb->dead[req[0]]) {
+        mb->stats.ignored++;
+        return;
+    }
+
+    rsp_len = mb_execute(mb, req, len, rsp);
+    if (rsp[1] & 0x80) {
+        mb->stats.exceptions++;
+    }
+    crc            = mb_crc16(rsp, rsp_len);
+    rsp[rsp_len++] = crc & 0xFF;
+    rsp[rsp_len++] = crc >> 8;
+
+    wire_us = mb->baud ? ((len + rsp_len) * 11ULL * 1000000ULL / mb->baud) : 0;
+    if (wire_us + mb->delay_us) {
+        usleep(wire_us + mb->delay_us);
+    }
+
+    for (size_t off = 0; off < rsp_len;) {
+        size_t  end = (mb->gap_us && (off < mb->gap_after) && (mb->gap_after < rsp_len)) ? mb->gap_after : rsp_len;
+        ssize_t n   = write(mb->fd, rsp + off, end - off);
+
+        if (0 > n) {
+            return;
+        }
+        off += n;
+        if (off == mb->gap_after) {
+            usleep(mb->gap_us);
+        }
+    }
+    mb->stats.responses++;
+}
+
+static void* mb_thread(void* args)
+{
+    struct hal_sim_modbus* mb = args;
+    struct pollfd          fds[2] = {
+        { .fd = mb->stop_fd, .events = POLLIN },
+        { .fd = mb->fd, .events = POLLIN },
+    };
+    size_t  need;
+    ssize_t n;
+    int     ret;
+
+    for (;;) {
+        ret = poll(fds, 2, mb->len ? MB_SILENCE_MS : -1);
+        if ((0 > ret) || fds[0].revents) {
+            break;
+        }
+
+        if (0x00 == ret) {
+            /* silence ends a frame of an unknown function */
+            mb_handle(mb, mb->frame, mb->len);
+            mb->len = 0;
+            continue;
+        }
+
+        n = read(mb->fd, mb->frame + mb->len, sizeof(mb->frame) - mb->len);
+        if (0 >= n) {
+            continue;
+        }
+        mb->len += n;
+
+        while ((need = mb_request_len(mb->frame, mb->len)) && (need <= mb->len)) {
+            mb_handle(mb, mb->frame, need);
+            memmove(mb->frame, mb->frame + need, mb->len - need);
+            mb->len -= need;
+        }
+    }
+
+    return NULL;
+}
+
+struct hal_sim_modbus* hal_sim_modbus_create(int id, uint8_t first, int slaves, uint32_t num_regs, uint32_t baud)
+{
+    struct hal_sim_modbus* mb;
+
+    if ((0x00 == first) || (0 >= slaves) || (248 < first + slaves) || (0x00 == num_regs) || (0x10000 < num_regs)) {
+        return NULL;
+    }
+
+    if (NULL == (mb = calloc(1, sizeof(*mb)))) {
+        return NULL;
+    }
+    mb->uart_id  = id;
+    mb->first    = first;
+    mb->slaves   = slaves;
+    mb->num_regs = num_regs;
+    mb->baud     = baud;
+    mb->stop_fd  = -1;
+
+    if ((NULL == (mb->regs = calloc((size_t)slaves * num_regs, sizeof(uint16_t))))
+        || (0 > (mb->fd = hal_sim_uart_peer(id))) || (0 > (mb->stop_fd = eventfd(0, EFD_CLOEXEC)))
+        || (0x00 != pthread_create(&mb->thread, NULL, mb_thread, mb))) {
+        printf("[hal_sim]: create modbus slaves on uart%d failed\n", id);
+        if (0 <= mb->stop_fd) {
+            close(mb->stop_fd);
+        }
+        free(mb->regs);
+        free(mb);
+        return NULL;
+    }
+
+    return mb;
+}
+
+void hal_sim_modbus_destroy(struct hal_sim_modbus* mb)
+{
+    uint64_t one = 1;
+
+    if (NULL == mb) {
+        return;
+    }
+
+    if (sizeof(one) == write(mb->stop_fd, &one, sizeof(one))) {
+        pthread_join(mb->thread, NULL);
+    }
+    close(mb->stop_fd);
+    free(mb->regs);
+    free(mb);
+}
+
+uint16_t* hal_sim_modbus_regs(struct hal_sim_modbus* mb, uint8_t slave)
+{
+    if ((NULL == mb) || (slave < mb->first) || (slave >= mb->first + mb->slaves)) {
+        return NULL;
+    }
+
+    return mb->regs + (size_t)(slave - mb->first) * mb->num_regs;
+}
+
+void hal_sim_modbus_set_delay(struct hal_sim_modbus* mb, uint32_t delay_us)
+{
+    if (mb) {
+        mb->delay_us = delay_us;
+    }
+}
+
+void hal_sim_modbus_set_gap(struct hal_sim_modbus* mb, size_t after, uint32_t gap_us)
+{
+    if (mb) {
+        mb->gap_after = after;
+        mb->gap_us    = gap_us;
+    }
+}
+
+void hal_sim_modbus_set_dead(struct hal_sim_modbus* mb, uint8_t slave, int dead)
+{
+    if (mb) {
+        mb->dead[slave] = !!dead;
+    }
+}
+
+void hal_sim_modbus_get_stats(struct hal_sim_modbus* mb, struct hal_sim_modbus_stats* stats)
+{
+    if (mb && stats) {
+        *stats = mb->stats;
+    }
+}
@@ -0,0 +1,447 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+
+/*
+ * W25Qxx style SPI NOR. Commands are decoded byte by byte as they are shifted
+ * in, program data is ANDed into the array as it arrives, erases and register
+ * writes take effect when cs goes high, like on the chip. Anything but a
+ * status read is ignored while busy or without write enable.
+ */
+
+#define NOR_PAGE_SIZE   (256)
+#define NOR_SECTOR_SIZE (4096)
+#define NOR_BLOCK32     (32 * 1024)
+#define NOR_BLOCK64     (64 * 1024)
+
+#define NOR_SR1_BUSY (1 << 0)
+#define NOR_SR1_WEL  (1 << 1)
+#define NOR_SR3_ADS  (1 << 0) /* current address mode is 4 byte */
+
+struct hal_sim_nor {
+    struct hal_sim_spi_dev dev;
+
+    uint8_t* mem;
+    uint32_t size;
+    int      fd; /**< backing file, -1 for memory only */
+    uint32_t jedec_id;
+
+    uint8_t  sr1, sr2, sr3;
+    int      addr4, reset_enable, power_down;
+    uint64_t busy_until;
+    uint32_t page_prog_us, sector_erase_us, block_erase_us, chip_erase_us;
+
+    /* current frame */
+    uint32_t pos; /**< bytes shifted since cs went low */
+    uint8_t  cmd;
+    uint8_t  addr_len, dummy_len;
+    uint32_t addr;
+    uint32_t programmed;
+    uint8_t  sr_write[3];
+
+    struct hal_sim_nor_stats stats;
+};
+
+static uint64_t nor_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int nor_busy(struct hal_sim_nor* nor) { return nor->busy_until && (nor_now_ns() < nor->busy_until); }
+
+static void nor_set_busy(struct hal_sim_nor* nor, uint32_t us)
+{
+    nor->busy_until = us ? nor_now_ns() + (uint64_t)us * 1000 : 0;
+}
+
+static void nor_decode(struct hal_sim_nor* nor, uint8_t cmd)
+{
+    uint8_t addr = nor->addr4 ? 4 : 3;
+
+    nor->cmd       = cmd;
+    nor->addr_len  = 0;
+    nor->dummy_len = 0;
+
+    switch (cmd) {
+    case 0x03: /* read */
+    case 0x02: /* page program */
+    case 0x32: /* quad page program */
+    case 0x20: /* sector erase */
+    case 0x52: /* 32K block erase */
+    case 0xD8: /* 64K block erase */
+        nor->addr_len = addr;
+        break;
+    case 0x13:
+    case 0x12:
+    case 0x34:
+    case 0x21:
+    case 0xDC:
+        nor->addr_len = 4;
+        break;
+    case 0x0B: /* fast read, dual and quad output */
+    case 0x3B:
+    case 0x6B:
+        nor->addr_len  = addr;
+        nor->dummy_len = 1;
+        break;
+    case 0x0C:
+    case 0x3C:
+    case 0x6C:
+        nor->addr_len  = 4;
+        nor->dummy_len = 1;
+        break;
+    case 0xEB: /* quad io fast read, mode byte and 4 dummy clocks */
+        nor->addr_len  = addr;
+        nor->dummy_len = 3;
+        break;
+    case 0x90: /* manufacturer and device id */
+        nor->addr_len = 3;
+        break;
+    case 0xAB: /* release power down, device id */
+        nor->dummy_len = 3;
+        break;
+    case 0x4B: /* unique id */
+        nor->dummy_len = 4;
+        break;
+    default:
+        break;
+    }
+}
+
+static uint8_t nor_data(struct hal_sim_nor* nor, uint8_t in, uint32_t idx)
+{
+    switch (nor->cmd) {
+    case 0x03:
+    case 0x13:
+    case 0x0B:
+    case 0x0C:
+    case 0x3B:
+    case 0x3C:
+    case 0x6B:
+    case 0x6C:
+    case 0xEB: {
+        uint8_t out = nor->mem[nor->addr % nor->size];
+
+        nor->addr++;
+        nor->stats.read_bytes++;
+        return out;
+    }
+    case 0x02:
+    case 0x12:
+    case 0x32:
+    case 0x34:
+        if (!(nor->sr1 & NOR_SR1_WEL)) {
+            return 0xff;
+        }
+        /* the address wraps inside the page */
+        nor->mem[((nor->addr & ~(NOR_PAGE_SIZE - 1)) + ((nor->addr + idx) & (NOR_PAGE_SIZE - 1))) % nor->size] &= in;
+        nor->programmed++;
+        return 0xff;
+    case 0x05:
+        return nor->sr1 | (nor_busy(nor) ? NOR_SR1_BUSY : 0);
+    case 0x35:
+        return nor->sr2;
+    case 0x15:
+        return nor->sr3 | (nor->addr4 ? NOR_SR3_ADS : 0);
+    case 0x01:
+    case 0x31:
+    case 0x11:
+        if (0 == idx) {
+            nor->sr_write[(0x01 == nor->cmd) ? 0 : (0x31 == nor->cmd) ? 1 : 2] = in;
+        }
+        return 0xff;
+    case 0x9F:
+        return (idx < 3) ? (uint8_t)(nor->jedec_id >> (16 - 8 * idx)) : 0xff;
+    case 0x90:
+        return (idx & 1) ? (uint8_t)(nor->jedec_id - 1) : (uint8_t)(nor->jedec_id >> 16);
+    case 0xAB:
+        return (uint8_t)(nor->jedec_id - 1);
+    case 0x4B:
+        /* stable per chip, derived from the id and the size */
+        return (uint8_t)((nor->jedec_id * 0x9E3779B1u + nor->size) >> (idx % 4 * 8)) ^ (uint8_t)idx;
+    default:
+        return 0xff;
+    }
+}
+
+static void nor_xfer(struct hal_sim_spi_dev* dev, const uint8_t* tx, uint8_t* rx, size_t len)
+{
+    struct hal_sim_nor* nor = (struct hal_sim_nor*)dev;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t  in  = tx ? tx[i] : 0xff;
+        uint8_t  out = 0xff;
+        uint32_t pos = nor->pos++;
+
+        if (0 == pos) {
+            nor_decode(nor, in);
+            /* busy or asleep, the chip only answers a status read or a wake up */
+            if ((nor_busy(nor) && (0x05 != in)) || (nor->power_down && (0xAB != in))) {
+                nor->cmd = 0x00;
+            }
+        } else if (pos <= nor->addr_len) {
+            nor->addr = (nor->addr << 8) | in;
+        } else if (pos <= (uint32_t)nor->addr_len + nor->dummy_len) {
+            /* dummy */
+        } else {
+            out = nor_data(nor, in, pos - 1 - nor->addr_len - nor->dummy_len);
+        }
+
+        if (rx) {
+            rx[i] = out;
+        }
+    }
+}
+
+static void nor_select(struct hal_sim_spi_dev* dev)
+{
+    struct hal_sim_nor* nor = (struct hal_sim_nor*)dev;
+
+    nor->pos        = 0;
+    nor->cmd        = 0x00;
+    nor->addr       = 0;
+    nor->programmed = 0;
+}
+
+static void nor_erase(struct hal_sim_nor* nor, uint32_t unit, uint32_t us)
+{
+    uint32_t start = (unit >= nor->size) ? 0 : (nor->addr % nor->size) & ~(unit - 1);
+    uint32_t len   = (unit >= nor->size) ? nor->size : unit;
+
+    memset(nor->mem + start, 0xff, len);
+    nor->stats.erases++;
+    nor->stats.erased_bytes += len;
+    nor_set_busy(nor, us);
+}
+
+static void nor_deselect(struct hal_sim_spi_dev* dev)
+{
+    struct hal_sim_nor* nor      = (struct hal_sim_nor*)dev;
+    int                 complete = nor->pos >= 1u + nor->addr_len;
+    int                 wel      = nor->sr1 & NOR_SR1_WEL;
+
+    if (0 == nor->pos) {
+        return;
+    }
+
+    switch (nor->cmd) {
+    case 0x06:
+        nor->sr1 |= NOR_SR1_WEL;
+        break;
+    case 0x04:
+        nor->sr1 &= ~NOR_SR1_WEL;
+        break;
+    case 0x02:
+    case 0x12:
+    case 0x32:
+    case 0x34:
+        if (!wel) {
+            nor->stats.rejected++;
+        } else if (nor->programmed) {
+            nor->stats.prog_bytes += nor->programmed;
+            nor_set_busy(nor, nor->page_prog_us);
+        }
+        nor->sr1 &= ~NOR_SR1_WEL;
+        break;
+    case 0x20:
+    case 0x21:
+    case 0x52:
+    case 0xD8:
+    case 0xDC:
+    case 0xC7:
+    case 0x60:
+        if (!wel || !complete) {
+            nor->stats.rejected++;
+        } else if ((0x20 == nor->cmd) || (0x21 == nor->cmd)) {
+            nor_erase(nor, NOR_SECTOR_SIZE, nor->sector_erase_us);
+        } else if (0x52 == nor->cmd) {
+            nor_erase(nor, NOR_BLOCK32, nor->block_erase_us);
+        } else if ((0xD8 == nor->cmd) || (0xDC == nor->cmd)) {
+            nor_erase(nor, NOR_BLOCK64, nor->block_erase_us);
+        } else {
+            nor_erase(nor, nor->size, nor->chip_erase_us);
+        }
+        nor->sr1 &= ~NOR_SR1_WEL;
+        break;
+    case 0x01:
+    case 0x31:
+    case 0x11:
+        if (wel && (1 < nor->pos)) {
+            if (0x01 == nor->cmd) {
+                nor->sr1 = (nor->sr_write[0] & ~(NOR_SR1_BUSY | NOR_SR1_WEL));
+            } else if (0x31 == nor->cmd) {
+                nor->sr2 = nor->sr_write[1];
+            } else {
+                nor->sr3 = nor->sr_write[2] & ~NOR_SR3_ADS;
+            }
+        }
+        nor->sr1 &= ~NOR_SR1_WEL;
+        break;
+    case 0xB7:
+        nor->addr4 = 1;
+        break;
+    case 0xE9:
+        nor->addr4 = 0;
+        break;
+    case 0x66:
+        nor->reset_enable = 1;
+        break;
+    case 0x99:
+        if (nor->reset_enable) {
+            nor->sr1 &= ~NOR_SR1_WEL;
+            nor->addr4      = 0;
+            nor->busy_until = 0;
+        }
+        break;
+    case 0xB9:
+        nor->power_down = 1;
+        break;
+    case 0xAB:
+        nor->power_down = 0;
+        break;
+    default:
+        break;
+    }
+
+    if (0x66 != nor->cmd) {
+        nor->reset_enable = 0;
+    }
+    nor->pos = 0;
+}
+
+struct hal_sim_nor* hal_sim_nor_create(const char* path, uint32_t size, uint32_t jedec_id)
+{
+    struct hal_sim_nor* nor;
+    struct stat         st;
+    int                 fresh = 1;
+
+    if ((0x00 == size) || (size & (NOR_BLOCK64 - 1))) {
+        printf("[hal_sim]: nor size must be a multiple of 64K\n");
+        return NULL;
+    }
+
+    if (NULL == (nor = calloc(1, sizeof(*nor)))) {
+        return NULL;
+    }
+    nor->size     = size;
+    nor->jedec_id = jedec_id;
+    nor->fd       = -1;
+
+    if (path) {
+        if ((0 > (nor->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644))) || (0x00 != fstat(nor->fd, &st))) {
+            printf("[hal_sim]: open nor image %s failed\n", path);
+            goto err;
+        }
+        fresh = (st.st_size != (off_t)size);
+        if (fresh && (0x00 != ftruncate(nor->fd, size))) {
+            goto err;
+        }
+        nor->mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, nor->fd, 0);
+    } else {
+        nor->mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (MAP_FAILED == nor->mem) {
+        printf("[hal_sim]: map nor array failed\n");
+        nor->mem = NULL;
+        goto err;
+    }
+
+    if (fresh) {
+        memset(nor->mem, 0xff, size);
+    }
+
+    nor->dev.name     = "spi-nor";
+    nor->dev.select   = nor_select;
+    nor->dev.deselect = nor_deselect;
+    nor->dev.xfer     = nor_xfer;
+    nor->dev.bus      = -1;
+    nor->dev.watch    = -1;
+
+    return nor;
+
+err:
+    if (0 <= nor->fd) {
+        close(nor->fd);
+    }
+    free(nor);
+
+    return NULL;
+}
+
+void hal_sim_nor_destroy(struct hal_sim_nor* nor)
+{
+    if (NULL == nor) {
+        return;
+    }
+
+    hal_sim_spi_detach(&nor->dev);
+
+    if (0 <= nor->fd) {
+        msync(nor->mem, nor->size, MS_SYNC);
+        close(nor->fd);
+    }
+    munmap(nor->mem, nor->size);
+    free(nor);
+}
+
+struct hal_sim_spi_dev* hal_sim_nor_dev(struct hal_sim_nor* nor) { return nor ? &nor->dev : NULL; }
+
+uint8_t* hal_sim_nor_mem(struct hal_sim_nor* nor) { return nor ? nor->mem : NULL; }
+
+void hal_sim_nor_set_timing(struct hal_sim_nor* nor, uint32_t page_prog_us, uint32_t sector_erase_us,
+                            uint32_t block_erase_us, uint32_t chip_erase_us)
+{
+    if (NULL == nor) {
+        return;
+    }
+
+    nor->page_prog_us    = page_prog_us;
+    nor->sector_erase_us = sector_erase_us;
+    nor->block_erase_us  = block_erase_us;
+    nor->chip_erase_us   = chip_erase_us;
+}
+
+void hal_sim_nor_get_stats(struct hal_sim_nor* nor, struct hal_sim_nor_stats* stats)
+{
+    if (nor && stats) {
+        *stats = nor->stats;
+    }
+}
@@ -0,0 +1,366 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "drv_spi.h"
+#include "hal_sim.h"
+
+/* must match drv_spi.c */
+#define RT_SPI_DEV_CTRL_CONFIG (12 * 0x100 + 0x01)
+#define RT_SPI_DEV_CTRL_RW     (12 * 0x100 + 0x02)
+
+struct rt_spi_configuration {
+    uint8_t mode;
+    uint8_t data_width;
+    union {
+        struct {
+            uint16_t hard_cs : 8;
+            uint16_t soft_cs : 8;
+        };
+        uint16_t reserved;
+    };
+    uint32_t max_hz;
+};
+
+struct rt_qspi_configuration {
+    struct rt_spi_configuration parent;
+    uint32_t                    medium_size;
+    uint8_t                     ddr_mode;
+    uint8_t                     qspi_dl_width;
+};
+
+struct sim_spi_bus {
+    int                          id;
+    pthread_mutex_t              lock;
+    struct rt_qspi_configuration cfg;
+    struct hal_sim_spi_dev*      devs;
+    struct hal_sim_spi_dev*      framed; /**< device inside a soft cs frame */
+    int                          pacing;
+    int                          fail; /**< RW requests still to fail */
+    struct hal_sim_spi_stats     stats;
+};
+
+static struct sim_spi_bus sim_spi_buses[SPI_HAL_MAX_DEVICES];
+static char               sim_spi_paths[SPI_HAL_MAX_DEVICES][16];
+
+static uint64_t sim_spi_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct hal_sim_spi_dev* sim_spi_find(struct sim_spi_bus* bus, int cs_pin)
+{
+    struct hal_sim_spi_dev* dev;
+
+    for (dev = bus->devs; dev; dev = dev->next) {
+        if (dev->cs_pin == cs_pin) {
+            return dev;
+        }
+    }
+
+    return NULL;
+}
+
+/* stage sizes are bits (8/16/24/32), small values are taken as bytes */
+static size_t sim_spi_stage_bytes(uint8_t size) { return (8 <= size) ? (size_t)size / 8 : size; }
+
+static void sim_spi_shift(struct sim_spi_bus* bus, struct hal_sim_spi_dev* dev, const uint8_t* tx, uint8_t* rx,
+                          size_t len, int lines)
+{
+    if (0x00 == len) {
+        return;
+    }
+
+    if (dev) {
+        dev->xfer(dev, tx, rx, len);
+    } else if (rx) {
+        memset(rx, 0xff, len); /* nothing drives MISO, pulled high */
+    }
+
+    bus->stats.bytes += len;
+    if (bus->cfg.parent.max_hz) {
+        bus->stats.wire_ns += (uint64_t)len * 8 * 1000000000ULL / bus->cfg.parent.max_hz / (lines ? lines : 1);
+    }
+}
+
+static void sim_spi_stage(struct sim_spi_bus* bus, struct hal_sim_spi_dev* dev, uint32_t content, uint8_t size)
+{
+    size_t  n = sim_spi_stage_bytes(size);
+    uint8_t buf[4];
+
+    if ((0x00 == n) || (sizeof(buf) < n)) {
+        return;
+    }
+
+    /* most significant byte first, like on the wire */
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = (uint8_t)(content >> (8 * (n - 1 - i)));
+    }
+    sim_spi_shift(bus, dev, buf, NULL, n, 1);
+}
+
+static int sim_spi_rw(struct sim_spi_bus* bus, struct rt_qspi_message* qmsg)
+{
+    struct rt_spi_message*  msg;
+    struct hal_sim_spi_dev* dev;
+    uint8_t                 soft_cs = bus->cfg.parent.soft_cs;
+    int                     total = 0, lines = qmsg->qspi_data_lines;
+    uint64_t                wire  = bus->stats.wire_ns;
+
+    if (soft_cs & 0x80) {
+        dev = sim_spi_find(bus, soft_cs & 0x7f);
+        if (qmsg->parent.cs_take) {
+            bus->framed = dev;
+            if (dev && dev->select) {
+                dev->select(dev);
+            }
+        }
+        dev = bus->framed;
+    } else {
+        /* cs outside the HAL: a device whose gpio cs is low, else the catch-all */
+        for (dev = bus->devs; dev; dev = dev->next) {
+            if ((0 <= dev->cs_pin) && (0 == hal_sim_gpio_get(dev->cs_pin))) {
+                break;
+            }
+        }
+        if ((NULL == dev) && (NULL != (dev = sim_spi_find(bus, -1))) && dev->select) {
+            dev->select(dev);
+        }
+    }
+
+    sim_spi_stage(bus, dev, qmsg->instruction.content, qmsg->instruction.size);
+    sim_spi_stage(bus, dev, qmsg->address.content, qmsg->address.size);
+    sim_spi_stage(bus, dev, qmsg->alternate_bytes.content, qmsg->alternate_bytes.size);
+    if (qmsg->dummy_cycles) {
+        /* dummy clocks run at the address width, 8 of them after a single line address are one byte */
+        uint8_t dummy[32] = { 0 };
+        int     alines    = (qmsg->address.size && qmsg->address.qspi_lines) ? qmsg->address.qspi_lines : 1;
+        size_t  n         = ((size_t)qmsg->dummy_cycles * alines + 7) / 8;
+
+        sim_spi_shift(bus, dev, dummy, NULL, (n < sizeof(dummy)) ? n : sizeof(dummy), 1);
+    }
+
+    /* the first message carries the qspi stages, the chain behind it is plain data */
+    for (msg = &qmsg->parent; msg; msg = msg->next) {
+        if ((msg != &qmsg->parent) && msg->cs_take && (soft_cs & 0x80)) {
+            bus->framed = sim_spi_find(bus, soft_cs & 0x7f);
+            if (bus->framed && bus->framed->select) {
+                bus->framed->select(bus->framed);
+            }
+            dev = bus->framed;
+        }
+
+        sim_spi_shift(bus, dev, msg->send_buf, msg->recv_buf, msg->length, lines);
+        total += msg->length;
+
+        if (msg->cs_release && (soft_cs & 0x80)) {
+            if (dev && dev->deselect) {
+                dev->deselect(dev);
+            }
+            bus->framed = NULL;
+            dev         = NULL;
+        }
+    }
+
+    if (!(soft_cs & 0x80) && dev && (0 > dev->cs_pin) && dev->deselect) {
+        dev->deselect(dev);
+    }
+
+    bus->stats.transfers++;
+    if (bus->pacing) {
+        uint64_t until = sim_spi_now_ns() + (bus->stats.wire_ns - wire);
+
+        while (sim_spi_now_ns() < until) { }
+    }
+
+    return total;
+}
+
+static int sim_spi_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    struct sim_spi_bus* bus = file->priv;
+    int                 ret = 0;
+
+    if (NULL == arg) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    switch (cmd) {
+    case RT_SPI_DEV_CTRL_CONFIG:
+        memcpy(&bus->cfg, arg, sizeof(bus->cfg));
+        break;
+    case RT_SPI_DEV_CTRL_RW:
+        if (bus->fail) {
+            bus->fail--;
+            errno = EIO;
+            ret   = -1;
+            break;
+        }
+        for (struct rt_spi_message* m = arg; m; m = m->next) {
+            bus->stats.messages++;
+        }
+        ret = sim_spi_rw(bus, arg);
+        break;
+    default:
+        errno = ENOTTY;
+        ret   = -1;
+        break;
+    }
+    pthread_mutex_unlock(&bus->lock);
+
+    return ret;
+}
+
+static const struct hal_sim_node_ops sim_spi_ops = {
+    .ioctl = sim_spi_ioctl,
+};
+
+int hal_sim_spi_setup(void)
+{
+    for (int i = 0; i < SPI_HAL_MAX_DEVICES; i++) {
+        sim_spi_buses[i].id = i;
+        pthread_mutex_init(&sim_spi_buses[i].lock, NULL);
+
+        snprintf(sim_spi_paths[i], sizeof(sim_spi_paths[i]), "/dev/spi%d", i);
+        if (0x00 != hal_sim_register(sim_spi_paths[i], &sim_spi_ops, &sim_spi_buses[i])) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* gpio driven cs, frames follow the pin */
+static void sim_spi_cs_watch(int pin, int level, void* args)
+{
+    struct hal_sim_spi_dev* dev = args;
+    struct sim_spi_bus*     bus = &sim_spi_buses[dev->bus];
+
+    (void)pin;
+
+    pthread_mutex_lock(&bus->lock);
+    if ((bus->cfg.parent.soft_cs & 0x80) && ((bus->cfg.parent.soft_cs & 0x7f) == dev->cs_pin)) {
+        /* the HAL itself drives this cs, frames come with the transfers */
+    } else if (!level && dev->select) {
+        dev->select(dev);
+    } else if (level && dev->deselect) {
+        dev->deselect(dev);
+    }
+    pthread_mutex_unlock(&bus->lock);
+}
+
+int hal_sim_spi_attach(int bus_id, int cs_pin, struct hal_sim_spi_dev* dev)
+{
+    struct sim_spi_bus* bus;
+
+    if ((0 > bus_id) || (SPI_HAL_MAX_DEVICES <= bus_id) || (NULL == dev) || (NULL == dev->xfer)) {
+        return -1;
+    }
+    bus = &sim_spi_buses[bus_id];
+
+    pthread_mutex_lock(&bus->lock);
+    if (sim_spi_find(bus, cs_pin)) {
+        pthread_mutex_unlock(&bus->lock);
+        printf("[hal_sim]: spi%d cs %d already taken\n", bus_id, cs_pin);
+        return -1;
+    }
+    dev->bus    = bus_id;
+    dev->cs_pin = cs_pin;
+    dev->next   = bus->devs;
+    bus->devs   = dev;
+    pthread_mutex_unlock(&bus->lock);
+
+    dev->watch = (0 <= cs_pin) ? hal_sim_gpio_watch(cs_pin, sim_spi_cs_watch, dev) : -1;
+
+    return 0;
+}
+
+void hal_sim_spi_detach(struct hal_sim_spi_dev* dev)
+{
+    struct sim_spi_bus*      bus;
+    struct hal_sim_spi_dev** pp;
+
+    if ((NULL == dev) || (0 > dev->bus) || (SPI_HAL_MAX_DEVICES <= dev->bus)) {
+        return;
+    }
+    bus = &sim_spi_buses[dev->bus];
+
+    hal_sim_gpio_unwatch(dev->watch);
+
+    pthread_mutex_lock(&bus->lock);
+    for (pp = &bus->devs; *pp; pp = &(*pp)->next) {
+        if (*pp == dev) {
+            *pp = dev->next;
+            break;
+        }
+    }
+    if (bus->framed == dev) {
+        bus->framed = NULL;
+    }
+    pthread_mutex_unlock(&bus->lock);
+
+    dev->bus  = -1;
+    dev->next = NULL;
+}
+
+void hal_sim_spi_set_pacing(int bus, int enable)
+{
+    if ((0 <= bus) && (SPI_HAL_MAX_DEVICES > bus)) {
+        sim_spi_buses[bus].pacing = enable;
+    }
+}
+
+void hal_sim_spi_fail(int bus, int transfers)
+{
+    if ((0 <= bus) && (SPI_HAL_MAX_DEVICES > bus)) {
+        pthread_mutex_lock(&sim_spi_buses[bus].lock);
+        sim_spi_buses[bus].fail = transfers;
+        pthread_mutex_unlock(&sim_spi_buses[bus].lock);
+    }
+}
+
+void hal_sim_spi_get_stats(int bus, struct hal_sim_spi_stats* stats)
+{
+    if ((0 > bus) || (SPI_HAL_MAX_DEVICES <= bus) || (NULL == stats)) {
+        return;
+    }
+
+    pthread_mutex_lock(&sim_spi_buses[bus].lock);
+    *stats = sim_spi_buses[bus].stats;
+    pthread_mutex_unlock(&sim_spi_buses[bus].lock);
+}
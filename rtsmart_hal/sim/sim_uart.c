@@ -0,0 +1,296 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE /* ptsname_r */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "drv_uart.h"
+#include "hal_sim.h"
+
+/* must match drv_uart.c */
+#define UART_IOCTL_SET_CONFIG _IOW('U', 0, void*)
+#define UART_IOCTL_GET_CONFIG _IOR('U', 1, void*)
+#define UART_IOCTL_SEND_BREAK _IOR('U', 2, void*)
+#define UART_IOCTL_GET_DTR    _IOR('U', 3, void*)
+
+#define SIM_UART_CHUNK (4096)
+
+struct sim_uart {
+    int  id;
+    int  master; /**< the wire, test side */
+    int  slave; /**< kept open so the master never sees a hangup */
+    char slave_path[64];
+
+    struct uart_configure cfg;
+    uint64_t              breaks;
+
+    int       peer; /**< connected uart, -1 if none */
+    int       stop_fd;
+    pthread_t bridge;
+};
+
+static struct sim_uart sim_uarts[KD_HARD_UART_MAX_NUM];
+static char            sim_uart_paths[KD_HARD_UART_MAX_NUM][16];
+static pthread_mutex_t sim_uart_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int sim_uart_pty(struct sim_uart* uart)
+{
+    struct termios tio;
+
+    if (0 <= uart->master) {
+        return 0;
+    }
+
+    if (0 > (uart->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC))) {
+        printf("[hal_sim]: open pty for uart%d failed\n", uart->id);
+        return -1;
+    }
+
+    if ((0x00 != grantpt(uart->master)) || (0x00 != unlockpt(uart->master))
+        || (0x00 != ptsname_r(uart->master, uart->slave_path, sizeof(uart->slave_path)))
+        || (0 > (uart->slave = open(uart->slave_path, O_RDWR | O_NOCTTY | O_CLOEXEC)))) {
+        printf("[hal_sim]: setup pty for uart%d failed\n", uart->id);
+        close(uart->master);
+        uart->master = -1;
+        return -1;
+    }
+
+    /* a raw byte pipe, no echo, no line editing, no newline mangling */
+    tcgetattr(uart->slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(uart->slave, TCSANOW, &tio);
+
+    return 0;
+}
+
+static int sim_uart_open(struct hal_sim_file* file)
+{
+    struct sim_uart* uart = file->priv;
+    int              ret;
+
+    pthread_mutex_lock(&sim_uart_lock);
+    ret = sim_uart_pty(uart);
+    pthread_mutex_unlock(&sim_uart_lock);
+
+    if (0x00 != ret) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    file->fd = open(uart->slave_path, O_RDWR | O_NOCTTY | O_CLOEXEC | (file->flags & O_NONBLOCK));
+
+    return (0 > file->fd) ? -1 : 0;
+}
+
+static int sim_uart_ioctl(struct hal_sim_file* file, unsigned long cmd, void* arg)
+{
+    struct sim_uart* uart = file->priv;
+    int              count;
+
+    switch (cmd) {
+    case FIONREAD:
+        /* the serial framework answers with a size_t, linux with an int */
+        if (0x00 != ioctl(file->fd, FIONREAD, &count)) {
+            return -1;
+        }
+        *(size_t*)arg = count;
+        return 0;
+    case UART_IOCTL_SET_CONFIG:
+        memcpy(&uart->cfg, arg, sizeof(uart->cfg));
+        return 0;
+    case UART_IOCTL_GET_CONFIG:
+        memcpy(arg, &uart->cfg, sizeof(uart->cfg));
+        return 0;
+    case UART_IOCTL_SEND_BREAK:
+        uart->breaks++;
+        return tcsendbreak(file->fd, 0);
+    case UART_IOCTL_GET_DTR:
+        *(int*)arg = 1;
+        return 0;
+    default:
+        /* the rest of the tty requests, the pty answers them */
+        return ioctl(file->fd, cmd, arg);
+    }
+}
+
+static const struct hal_sim_node_ops sim_uart_ops = {
+    .open  = sim_uart_open,
+    .ioctl = sim_uart_ioctl,
+};
+
+int hal_sim_uart_setup(void)
+{
+    for (int i = 0; i < KD_HARD_UART_MAX_NUM; i++) {
+        struct sim_uart* uart = &sim_uarts[i];
+
+        uart->id             = i;
+        uart->master         = -1;
+        uart->slave          = -1;
+        uart->peer           = -1;
+        uart->stop_fd        = -1;
+        uart->cfg.baud_rate  = 115200;
+        uart->cfg.data_bits  = DATA_BITS_8;
+        uart->cfg.stop_bits  = STOP_BITS_1;
+        uart->cfg.parity     = PARITY_NONE;
+        uart->cfg.bufsz      = 4096;
+
+        snprintf(sim_uart_paths[i], sizeof(sim_uart_paths[i]), "/dev/uart%d", i);
+        if (0x00 != hal_sim_register(sim_uart_paths[i], &sim_uart_ops, uart)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int hal_sim_uart_peer(int id)
+{
+    int ret;
+
+    if ((0 > id) || (KD_HARD_UART_MAX_NUM <= id)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_uart_lock);
+    ret = sim_uart_pty(&sim_uarts[id]);
+    pthread_mutex_unlock(&sim_uart_lock);
+
+    return ret ? -1 : sim_uarts[id].master;
+}
+
+static int sim_uart_forward(int from, int to)
+{
+    uint8_t buf[SIM_UART_CHUNK];
+    ssize_t len = read(from, buf, sizeof(buf));
+
+    for (ssize_t off = 0; off < len;) {
+        ssize_t n = write(to, buf + off, len - off);
+
+        if (0 > n) {
+            return -1;
+        }
+        off += n;
+    }
+
+    return (0 > len) ? -1 : 0;
+}
+
+static void* sim_uart_bridge(void* args)
+{
+    struct sim_uart* a = args;
+    struct sim_uart* b = &sim_uarts[a->peer];
+    struct pollfd    fds[3] = {
+        { .fd = a->stop_fd, .events = POLLIN },
+        { .fd = a->master, .events = POLLIN },
+        { .fd = b->master, .events = POLLIN },
+    };
+    nfds_t nfds = (a == b) ? 2 : 3;
+
+    while (0 <= poll(fds, nfds, -1)) {
+        if (fds[0].revents) {
+            break;
+        }
+        if ((fds[1].revents & POLLIN) && (0x00 != sim_uart_forward(a->master, b->master))) {
+            break;
+        }
+        if ((3 == nfds) && (fds[2].revents & POLLIN) && (0x00 != sim_uart_forward(b->master, a->master))) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int hal_sim_uart_connect(int a, int b)
+{
+    struct sim_uart* ua;
+
+    if ((0 > a) || (KD_HARD_UART_MAX_NUM <= a) || (0 > b) || (KD_HARD_UART_MAX_NUM <= b)) {
+        return -1;
+    }
+
+    hal_sim_uart_disconnect(a);
+    hal_sim_uart_disconnect(b);
+
+    if ((0 > hal_sim_uart_peer(a)) || (0 > hal_sim_uart_peer(b))) {
+        return -1;
+    }
+
+    ua = &sim_uarts[a];
+    if (0 > (ua->stop_fd = eventfd(0, EFD_CLOEXEC))) {
+        return -1;
+    }
+
+    ua->peer            = b;
+    sim_uarts[b].peer   = a;
+    if (0x00 != pthread_create(&ua->bridge, NULL, sim_uart_bridge, ua)) {
+        close(ua->stop_fd);
+        ua->stop_fd       = -1;
+        ua->peer          = -1;
+        sim_uarts[b].peer = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void hal_sim_uart_disconnect(int id)
+{
+    struct sim_uart* uart;
+    uint64_t         one = 1;
+
+    if ((0 > id) || (KD_HARD_UART_MAX_NUM <= id) || (0 > sim_uarts[id].peer)) {
+        return;
+    }
+
+    /* the bridge runs on the side that owns the stop fd */
+    uart = &sim_uarts[id];
+    if (0 > uart->stop_fd) {
+        uart = &sim_uarts[uart->peer];
+    }
+
+    if (sizeof(one) != write(uart->stop_fd, &one, sizeof(one))) {
+        printf("[hal_sim]: stop uart%d bridge failed\n", id);
+        return;
+    }
+    pthread_join(uart->bridge, NULL);
+    close(uart->stop_fd);
+    uart->stop_fd = -1;
+
+    sim_uarts[uart->peer].peer = -1;
+    uart->peer                 = -1;
+}
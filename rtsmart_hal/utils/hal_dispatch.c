@@ -0,0 +1,282 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal_dispatch.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define QUEUE_MASK (HAL_DISPATCH_QUEUE_DEPTH - 1)
+
+#if (HAL_DISPATCH_QUEUE_DEPTH & QUEUE_MASK)
+#error "HAL_DISPATCH_QUEUE_DEPTH must be a power of 2"
+#endif
+
+/* bounded multi-producer queue (Vyukov), each cell carries its own sequence */
+struct dispatch_cell {
+    uint64_t        seq;
+    hal_dispatch_fn fn;
+    void*           args;
+    uint64_t        stamp; /* utils_cpu_ticks() at signal time */
+};
+
+static struct dispatch_cell queue[HAL_DISPATCH_QUEUE_DEPTH];
+static uint64_t             queue_head; /* producers, signal handlers */
+static uint64_t             queue_tail; /* consumer, dispatcher thread only */
+
+static struct hal_dispatch_stats dispatch_stats[HAL_DISPATCH_MODE_MAX];
+
+static sem_t           dispatch_sem;
+static pthread_t       dispatch_thread;
+static pthread_once_t  dispatch_once  = PTHREAD_ONCE_INIT;
+static int             dispatch_ready = 0;
+static uint64_t        dispatch_done; /* events run, the queue pops in order so it trails queue_head */
+static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sync_cond = PTHREAD_COND_INITIALIZER;
+
+static void stats_record(struct hal_dispatch_stats* st, uint64_t stamp)
+{
+    uint64_t ns  = utils_cpu_ticks_to_ns(utils_cpu_ticks() - stamp);
+    uint64_t cur = ns / 1000;
+    int      bucket;
+
+    /* handlers of different signals may run concurrently, keep every update atomic */
+    __atomic_fetch_add(&st->events, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&st->latency_ns_sum, ns, __ATOMIC_RELAXED);
+
+    for (bucket = 0; cur && (bucket < HAL_DISPATCH_HIST_BUCKETS - 1); bucket++) {
+        cur >>= 1;
+    }
+    __atomic_fetch_add(&st->latency_hist[bucket], 1, __ATOMIC_RELAXED);
+
+    cur = __atomic_load_n(&st->latency_ns_max, __ATOMIC_RELAXED);
+    while ((ns > cur) && !__atomic_compare_exchange_n(&st->latency_ns_max, &cur, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+
+    cur = __atomic_load_n(&st->latency_ns_min, __ATOMIC_RELAXED);
+    while (((0 == cur) || (ns < cur))
+           && !__atomic_compare_exchange_n(&st->latency_ns_min, &cur, ns ? ns : 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+}
+
+static int queue_push(hal_dispatch_fn fn, void* args, uint64_t stamp)
+{
+    struct dispatch_cell* cell;
+    uint64_t              pos, seq;
+    int64_t               diff;
+
+    pos = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &queue[pos & QUEUE_MASK];
+        seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int64_t)(seq - pos);
+        if (0 == diff) {
+            if (__atomic_compare_exchange_n(&queue_head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (0 > diff) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->fn    = fn;
+    cell->args  = args;
+    cell->stamp = stamp;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static int queue_pop(struct dispatch_cell* out)
+{
+    struct dispatch_cell* cell = &queue[queue_tail & QUEUE_MASK];
+
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != queue_tail + 1) {
+        return -1;
+    }
+
+    out->fn    = cell->fn;
+    out->args  = cell->args;
+    out->stamp = cell->stamp;
+    __atomic_store_n(&cell->seq, queue_tail + HAL_DISPATCH_QUEUE_DEPTH, __ATOMIC_RELEASE);
+    queue_tail++;
+
+    return 0;
+}
+
+static void* dispatch_loop(void* args)
+{
+    struct hal_dispatch_stats* st = &dispatch_stats[HAL_DISPATCH_THREAD];
+    struct dispatch_cell       ev;
+    sigset_t                   mask;
+    uint32_t                   batch;
+
+    (void)args;
+
+    /* never interrupted by the very signals it is draining */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    for (;;) {
+        if (0 != sem_wait(&dispatch_sem)) {
+            continue;
+        }
+
+        batch = 0;
+        while (0 == queue_pop(&ev)) {
+            stats_record(st, ev.stamp);
+            ev.fn(ev.args);
+            batch++;
+        }
+        if (0 == batch) {
+            /* semaphore count left over from events an earlier batch already ran */
+            continue;
+        }
+
+        __atomic_fetch_add(&st->batches, 1, __ATOMIC_RELAXED);
+        if (batch > st->max_batch) {
+            st->max_batch = batch;
+        }
+
+        pthread_mutex_lock(&sync_lock);
+        dispatch_done += batch;
+        pthread_cond_broadcast(&sync_cond);
+        pthread_mutex_unlock(&sync_lock);
+    }
+
+    return NULL;
+}
+
+static void dispatch_init(void)
+{
+    pthread_attr_t     attr;
+    struct sched_param param;
+
+    for (int i = 0; i < HAL_DISPATCH_QUEUE_DEPTH; i++) {
+        queue[i].seq = i;
+    }
+
+    if (0 != sem_init(&dispatch_sem, 0, 0)) {
+        printf("[hal_dispatch]: sem_init failed\n");
+        return;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+
+    if (0 != pthread_create(&dispatch_thread, &attr, dispatch_loop, NULL)) {
+        /* no permission for a real-time policy, run at normal priority */
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        if (0 != pthread_create(&dispatch_thread, &attr, dispatch_loop, NULL)) {
+            printf("[hal_dispatch]: create dispatcher thread failed\n");
+            pthread_attr_destroy(&attr);
+            return;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    dispatch_ready = 1;
+}
+
+int hal_dispatch_start(void)
+{
+    pthread_once(&dispatch_once, dispatch_init);
+
+    return dispatch_ready ? 0 : -1;
+}
+
+int hal_dispatch_deliver(hal_dispatch_mode_t mode, hal_dispatch_fn fn, void* args)
+{
+    uint64_t stamp = utils_cpu_ticks();
+    int      saved_errno;
+
+    if (NULL == fn) {
+        return -1;
+    }
+
+    if ((HAL_DISPATCH_THREAD == mode) && dispatch_ready) {
+        if (0 != queue_push(fn, args, stamp)) {
+            __atomic_fetch_add(&dispatch_stats[HAL_DISPATCH_THREAD].dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+
+        saved_errno = errno;
+        sem_post(&dispatch_sem);
+        errno = saved_errno;
+
+        return 0;
+    }
+
+    stats_record(&dispatch_stats[HAL_DISPATCH_SIGNAL], stamp);
+    hal_trace_signal_enter();
+    fn(args);
+    hal_trace_signal_leave();
+
+    return 0;
+}
+
+void hal_dispatch_sync(void)
+{
+    uint64_t target;
+
+    if (!dispatch_ready || pthread_equal(pthread_self(), dispatch_thread)) {
+        return;
+    }
+
+    /*
+     * every push before this call holds a cell below the head, even one still
+     * filling it in, and the dispatcher runs the cells in order
+     */
+    target = __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&sync_lock);
+    while (dispatch_done < target) {
+        pthread_cond_wait(&sync_cond, &sync_lock);
+    }
+    pthread_mutex_unlock(&sync_lock);
+}
+
+int hal_dispatch_get_stats(hal_dispatch_mode_t mode, struct hal_dispatch_stats* stats)
+{
+    if ((HAL_DISPATCH_MODE_MAX <= (unsigned)mode) || (NULL == stats)) {
+        return -1;
+    }
+
+    memcpy(stats, &dispatch_stats[mode], sizeof(*stats));
+
+    return 0;
+}
+
+void hal_dispatch_reset_stats(void) { memset(dispatch_stats, 0x00, sizeof(dispatch_stats)); }
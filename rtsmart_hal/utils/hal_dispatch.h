@@ -0,0 +1,99 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred delivery of driver interrupt callbacks.
+ *
+ * Hard timer and GPIO interrupts arrive as real-time signals. In
+ * HAL_DISPATCH_SIGNAL mode the callback runs inside the signal handler, as it
+ * always did: lowest latency, but the callback must be async-signal-safe. In
+ * HAL_DISPATCH_THREAD mode the handler only pushes the event on a lock-free
+ * queue and posts a semaphore, a high priority dispatcher thread runs the
+ * callbacks in batches, where they may lock, allocate or call into other
+ * libraries.
+ *
+ * The mode is chosen per driver instance, latency statistics are kept per
+ * mode so both can be compared on the same workload.
+ */
+
+#ifndef HAL_DISPATCH_QUEUE_DEPTH
+#define HAL_DISPATCH_QUEUE_DEPTH (256) /* pending events, power of 2 */
+#endif
+
+#define HAL_DISPATCH_HIST_BUCKETS (16) /* log2 latency buckets, [0] < 1us, [n] < 2^n us */
+
+typedef enum {
+    HAL_DISPATCH_SIGNAL = 0,
+    HAL_DISPATCH_THREAD = 1,
+    HAL_DISPATCH_MODE_MAX,
+} hal_dispatch_mode_t;
+
+typedef void (*hal_dispatch_fn)(void* args);
+
+struct hal_dispatch_stats {
+    uint64_t events; /**< callbacks delivered */
+    uint64_t dropped; /**< events lost because the queue was full */
+    uint64_t batches; /**< dispatcher wakeups that found work */
+    uint32_t max_batch; /**< most events run in one wakeup */
+    uint64_t latency_ns_min; /**< signal handler entry to callback entry */
+    uint64_t latency_ns_max;
+    uint64_t latency_ns_sum; /**< divide by events for the mean */
+    uint64_t latency_hist[HAL_DISPATCH_HIST_BUCKETS];
+};
+
+/**
+ * @brief Start the dispatcher thread, called implicitly when an instance
+ *        switches to HAL_DISPATCH_THREAD.
+ * @return 0 on success, -1 if the thread can not be created.
+ */
+int hal_dispatch_start(void);
+
+/**
+ * @brief Deliver a callback in the given mode. Async-signal-safe, meant to be
+ *        called from the driver signal handlers.
+ * @return 0 on success, -1 if the event was dropped.
+ */
+int hal_dispatch_deliver(hal_dispatch_mode_t mode, hal_dispatch_fn fn, void* args);
+
+/**
+ * @brief Wait until every event queued before the call has been run. Drivers
+ *        call it when a callback is unregistered, so no queued call outlives
+ *        it. Returns at once on the dispatcher thread.
+ */
+void hal_dispatch_sync(void);
+
+int  hal_dispatch_get_stats(hal_dispatch_mode_t mode, struct hal_dispatch_stats* stats);
+void hal_dispatch_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
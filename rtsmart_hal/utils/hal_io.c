@@ -0,0 +1,58 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stddef.h>
+
+#include "hal_io.h"
+
+#ifdef HAL_IO_BACKEND
+
+const struct hal_io_ops* hal_io_backend = NULL;
+
+int hal_io_set_backend(const struct hal_io_ops* ops)
+{
+    __atomic_store_n(&hal_io_backend, ops, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+const char* hal_io_get_backend(void)
+{
+    const struct hal_io_ops* ops = __atomic_load_n(&hal_io_backend, __ATOMIC_ACQUIRE);
+
+    return (ops && ops->name) ? ops->name : "libc";
+}
+
+#else
+
+int hal_io_set_backend(const struct hal_io_ops* ops)
+{
+    (void)ops;
+
+    return -1;
+}
+
+const char* hal_io_get_backend(void) { return "libc"; }
+
+#endif
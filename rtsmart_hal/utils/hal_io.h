@@ -0,0 +1,122 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Device node I/O used by the drivers.
+ *
+ * On the board every call goes straight to libc, the wrappers are inline and
+ * cost nothing. A host build defines HAL_IO_BACKEND, then the calls go through
+ * the installed backend, so the same driver code can run against simulated
+ * device nodes (see rtsmart_hal/sim). A backend only has to implement what it
+ * simulates, NULL entries fall back to libc.
+ */
+
+struct hal_io_ops {
+    const char* name;
+
+    int (*open)(const char* path, int flags);
+    int (*close)(int fd);
+    ssize_t (*read)(int fd, void* buf, size_t size);
+    ssize_t (*write)(int fd, const void* buf, size_t size);
+    off_t (*lseek)(int fd, off_t offset, int whence);
+    int (*ioctl)(int fd, unsigned long cmd, void* arg);
+    int (*poll)(struct pollfd* fds, nfds_t nfds, int timeout_ms);
+};
+
+/**
+ * @brief Install an I/O backend, NULL restores libc.
+ * @return 0 on success, -1 if the library was built without HAL_IO_BACKEND.
+ */
+int hal_io_set_backend(const struct hal_io_ops* ops);
+
+/**
+ * @brief Name of the installed backend, "libc" when none is installed.
+ */
+const char* hal_io_get_backend(void);
+
+#ifdef HAL_IO_BACKEND
+
+extern const struct hal_io_ops* hal_io_backend;
+
+#define HAL_IO_CALL(op, libc_call, ...)                                                                                \
+    ((hal_io_backend && hal_io_backend->op) ? hal_io_backend->op(__VA_ARGS__) : libc_call)
+
+static inline int hal_io_open(const char* path, int flags) { return HAL_IO_CALL(open, open(path, flags), path, flags); }
+static inline int hal_io_close(int fd) { return HAL_IO_CALL(close, close(fd), fd); }
+
+static inline ssize_t hal_io_read(int fd, void* buf, size_t size)
+{
+    return HAL_IO_CALL(read, read(fd, buf, size), fd, buf, size);
+}
+
+static inline ssize_t hal_io_write(int fd, const void* buf, size_t size)
+{
+    return HAL_IO_CALL(write, write(fd, buf, size), fd, buf, size);
+}
+
+static inline off_t hal_io_lseek(int fd, off_t offset, int whence)
+{
+    return HAL_IO_CALL(lseek, lseek(fd, offset, whence), fd, offset, whence);
+}
+
+static inline int hal_io_ioctl(int fd, unsigned long cmd, void* arg)
+{
+    return HAL_IO_CALL(ioctl, ioctl(fd, cmd, arg), fd, cmd, arg);
+}
+
+static inline int hal_io_poll(struct pollfd* fds, nfds_t nfds, int timeout_ms)
+{
+    return HAL_IO_CALL(poll, poll(fds, nfds, timeout_ms), fds, nfds, timeout_ms);
+}
+
+#else
+
+static inline int     hal_io_open(const char* path, int flags) { return open(path, flags); }
+static inline int     hal_io_close(int fd) { return close(fd); }
+static inline ssize_t hal_io_read(int fd, void* buf, size_t size) { return read(fd, buf, size); }
+static inline ssize_t hal_io_write(int fd, const void* buf, size_t size) { return write(fd, buf, size); }
+static inline off_t   hal_io_lseek(int fd, off_t offset, int whence) { return lseek(fd, offset, whence); }
+static inline int     hal_io_ioctl(int fd, unsigned long cmd, void* arg) { return ioctl(fd, cmd, arg); }
+
+static inline int hal_io_poll(struct pollfd* fds, nfds_t nfds, int timeout_ms) { return poll(fds, nfds, timeout_ms); }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
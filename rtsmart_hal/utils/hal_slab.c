@@ -0,0 +1,252 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_slab.h"
+
+#define ALIGN_UP(x, a)  (((x) + (a) - 1) & ~((size_t)(a) - 1))
+#define BUF_CLASSES     (HAL_SLAB_BUF_MAX_SHIFT - HAL_SLAB_BUF_MIN_SHIFT + 1)
+#define BUF_HDR_SIZE    ALIGN_UP(sizeof(struct slab_buf_hdr), HAL_SLAB_ALIGN)
+#define BUF_CLASS_SIZE(i) ((size_t)1 << (HAL_SLAB_BUF_MIN_SHIFT + (i)))
+
+/* in front of every buffer, cache is NULL for oversized buffers from malloc */
+struct slab_buf_hdr {
+    struct hal_slab_cache* cache;
+    size_t                 size;
+};
+
+#if HAL_SLAB_STATIC_KB
+static uint8_t slab_arena[HAL_SLAB_STATIC_KB * 1024] __attribute__((aligned(HAL_SLAB_ALIGN)));
+#endif
+static size_t slab_arena_used;
+
+static LIST_HEAD(slab_caches);
+static pthread_mutex_t slab_lock = PTHREAD_MUTEX_INITIALIZER; /* cache list and arena */
+
+/* one static object per class, the arena is mostly for instances */
+static struct hal_slab_cache buf_caches[BUF_CLASSES] = {
+    HAL_SLAB_CACHE_INIT("buf-64", 64, 1),     HAL_SLAB_CACHE_INIT("buf-128", 128, 1),
+    HAL_SLAB_CACHE_INIT("buf-256", 256, 1),   HAL_SLAB_CACHE_INIT("buf-512", 512, 1),
+    HAL_SLAB_CACHE_INIT("buf-1024", 1024, 1), HAL_SLAB_CACHE_INIT("buf-2048", 2048, 1),
+    HAL_SLAB_CACHE_INIT("buf-4096", 4096, 1),
+};
+static uint64_t buf_oversize;
+
+static void slab_push_objs(struct hal_slab_cache* cache, uint8_t* mem, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        void** obj = (void**)(mem + (size_t)i * cache->stats.obj_size);
+
+        *obj             = cache->free_list;
+        cache->free_list = obj;
+    }
+    cache->stats.total += count;
+}
+
+static void slab_setup(struct hal_slab_cache* cache)
+{
+    size_t   obj_size = ALIGN_UP(cache->size ? cache->size : 1, HAL_SLAB_ALIGN);
+    uint32_t reserve  = (HAL_SLAB_RESERVE_DFT == cache->reserve) ? HAL_SLAB_STATIC_OBJS : cache->reserve;
+    uint32_t count;
+
+    pthread_mutex_lock(&slab_lock);
+    if (!cache->ready) {
+        pthread_mutex_lock(&cache->lock);
+        cache->stats.obj_size = obj_size;
+
+#if HAL_SLAB_STATIC_KB
+        /* take what is left of the arena if the full reserve does not fit */
+        count = (sizeof(slab_arena) - slab_arena_used) / obj_size;
+        if (count > reserve) {
+            count = reserve;
+        }
+        if (count) {
+            slab_push_objs(cache, slab_arena + slab_arena_used, count);
+            slab_arena_used += count * obj_size;
+            cache->stats.static_objs = count;
+        }
+#else
+        (void)reserve;
+        (void)count;
+#endif
+        pthread_mutex_unlock(&cache->lock);
+
+        list_add_tail(&cache->node, &slab_caches);
+        __atomic_store_n(&cache->ready, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&slab_lock);
+}
+
+static int slab_grow(struct hal_slab_cache* cache)
+{
+    uint32_t count = HAL_SLAB_CHUNK_BYTES / cache->stats.obj_size;
+    uint8_t* chunk;
+
+    if (0 == count) {
+        count = 1;
+    }
+    if (NULL == (chunk = malloc((size_t)count * cache->stats.obj_size))) {
+        return -1;
+    }
+    slab_push_objs(cache, chunk, count);
+    cache->stats.chunks++;
+
+    return 0;
+}
+
+void* hal_slab_alloc(struct hal_slab_cache* cache)
+{
+    void** obj;
+
+    if (NULL == cache) {
+        return NULL;
+    }
+    if (!__atomic_load_n(&cache->ready, __ATOMIC_ACQUIRE)) {
+        slab_setup(cache);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    if ((NULL == cache->free_list) && (0 != slab_grow(cache))) {
+        cache->stats.failures++;
+        pthread_mutex_unlock(&cache->lock);
+        printf("[hal_slab]: cache %s out of memory\n", cache->name);
+        return NULL;
+    }
+
+    obj              = cache->free_list;
+    cache->free_list = *obj;
+
+    cache->stats.allocs++;
+    if (++cache->stats.in_use > cache->stats.peak) {
+        cache->stats.peak = cache->stats.in_use;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return obj;
+}
+
+void* hal_slab_zalloc(struct hal_slab_cache* cache)
+{
+    void* obj = hal_slab_alloc(cache);
+
+    if (obj) {
+        memset(obj, 0, cache->size);
+    }
+
+    return obj;
+}
+
+void hal_slab_free(struct hal_slab_cache* cache, void* obj)
+{
+    if ((NULL == cache) || (NULL == obj)) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    *(void**)obj     = cache->free_list;
+    cache->free_list = obj;
+
+    cache->stats.frees++;
+    cache->stats.in_use--;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void* hal_slab_buf_alloc(size_t size)
+{
+    struct slab_buf_hdr*   hdr;
+    struct hal_slab_cache* cache = NULL;
+
+    for (int i = 0; i < BUF_CLASSES; i++) {
+        if (size + BUF_HDR_SIZE <= BUF_CLASS_SIZE(i)) {
+            cache = &buf_caches[i];
+            break;
+        }
+    }
+
+    if (cache) {
+        hdr = hal_slab_alloc(cache);
+    } else {
+        hdr = malloc(size + BUF_HDR_SIZE);
+        __atomic_fetch_add(&buf_oversize, 1, __ATOMIC_RELAXED);
+    }
+    if (NULL == hdr) {
+        return NULL;
+    }
+
+    hdr->cache = cache;
+    hdr->size  = size;
+
+    return (uint8_t*)hdr + BUF_HDR_SIZE;
+}
+
+void hal_slab_buf_free(void* buf)
+{
+    struct slab_buf_hdr* hdr;
+
+    if (NULL == buf) {
+        return;
+    }
+
+    hdr = (struct slab_buf_hdr*)((uint8_t*)buf - BUF_HDR_SIZE);
+    if (hdr->cache) {
+        hal_slab_free(hdr->cache, hdr);
+    } else {
+        free(hdr);
+    }
+}
+
+int hal_slab_get_stats(struct hal_slab_cache* cache, struct hal_slab_stats* stats)
+{
+    if ((NULL == cache) || (NULL == stats)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
+void hal_slab_dump_stats(void)
+{
+    struct hal_slab_cache* cache;
+    struct hal_slab_stats  st;
+
+    pthread_mutex_lock(&slab_lock);
+    printf("%-16s %6s %6s %6s %6s %6s %6s %10s %8s\n", "cache", "size", "total", "static", "inuse", "peak", "chunks", "allocs",
+           "failures");
+    list_for_each_entry(cache, &slab_caches, node)
+    {
+        hal_slab_get_stats(cache, &st);
+        printf("%-16s %6u %6u %6u %6u %6u %6u %10llu %8llu\n", cache->name, st.obj_size, st.total, st.static_objs, st.in_use,
+               st.peak, st.chunks, (unsigned long long)st.allocs, (unsigned long long)st.failures);
+    }
+    printf("static arena %zu/%u bytes, %llu oversized buffers from heap\n", slab_arena_used, HAL_SLAB_STATIC_KB * 1024,
+           (unsigned long long)__atomic_load_n(&buf_oversize, __ATOMIC_RELAXED));
+    pthread_mutex_unlock(&slab_lock);
+}
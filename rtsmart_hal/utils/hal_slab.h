@@ -0,0 +1,135 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-size object caches for driver instances and transfer buffers.
+ *
+ * Each object type gets its own cache, defined statically next to the driver
+ * with HAL_SLAB_CACHE_DEFINE(). On first use a cache reserves objects from a
+ * static arena (CONFIG_RT_SMART_HAL_SLAB_STATIC), afterwards it grows by
+ * chunks from the heap. Freed objects go back on the cache free list and are
+ * never returned to the heap, so create/destroy cycles of long running
+ * services neither hit malloc nor fragment it.
+ *
+ * Variable sized buffers come from power of 2 size classes, see
+ * hal_slab_buf_alloc(), anything above the largest class falls back to malloc.
+ */
+
+#ifndef HAL_SLAB_STATIC_KB
+#define HAL_SLAB_STATIC_KB (0) /* static arena size, 0 means heap only */
+#endif
+
+#ifndef HAL_SLAB_STATIC_OBJS
+#define HAL_SLAB_STATIC_OBJS (4) /* objects reserved from the arena per cache */
+#endif
+
+#define HAL_SLAB_ALIGN         (16)
+#define HAL_SLAB_CHUNK_BYTES   (1024) /* heap growth step, at least one object */
+#define HAL_SLAB_RESERVE_DFT   (UINT32_MAX) /* reserve HAL_SLAB_STATIC_OBJS */
+#define HAL_SLAB_BUF_MIN_SHIFT (6) /* smallest buffer class, 64 bytes */
+#define HAL_SLAB_BUF_MAX_SHIFT (12) /* largest buffer class, 4 KiB */
+
+struct hal_slab_stats {
+    uint32_t obj_size; /**< object size after alignment */
+    uint32_t total; /**< objects owned by the cache */
+    uint32_t static_objs; /**< of which from the static arena */
+    uint32_t in_use;
+    uint32_t peak; /**< highest in_use seen */
+    uint32_t chunks; /**< heap chunks allocated */
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t failures; /**< allocations failed, heap exhausted */
+};
+
+struct hal_slab_cache {
+    const char*           name;
+    uint32_t              size; /**< requested object size */
+    uint32_t              reserve; /**< objects wanted from the static arena */
+    int                   ready;
+    pthread_mutex_t       lock;
+    void*                 free_list;
+    struct list_head      node; /**< on the global cache list */
+    struct hal_slab_stats stats;
+};
+
+#define HAL_SLAB_CACHE_INIT(_name, _size, _reserve)                                                                            \
+    {                                                                                                                          \
+        .name = (_name), .size = (_size), .reserve = (_reserve), .ready = 0, .lock = PTHREAD_MUTEX_INITIALIZER,                \
+        .free_list = NULL,                                                                                                     \
+    }
+
+/**
+ * @brief Define a cache for objects of @type, initialized on first allocation.
+ */
+#define HAL_SLAB_CACHE_DEFINE(var, name, type) struct hal_slab_cache var = HAL_SLAB_CACHE_INIT(name, sizeof(type), HAL_SLAB_RESERVE_DFT)
+
+/**
+ * @brief Allocate one object from the cache.
+ * @return The object, contents undefined, NULL if the heap is exhausted.
+ */
+void* hal_slab_alloc(struct hal_slab_cache* cache);
+
+/**
+ * @brief Allocate one zeroed object from the cache.
+ */
+void* hal_slab_zalloc(struct hal_slab_cache* cache);
+
+/**
+ * @brief Return an object to the cache it was allocated from, NULL is ignored.
+ */
+void hal_slab_free(struct hal_slab_cache* cache, void* obj);
+
+/**
+ * @brief Allocate a buffer of @size bytes from the shared size classes.
+ * @return The buffer, HAL_SLAB_ALIGN aligned, NULL on failure.
+ */
+void* hal_slab_buf_alloc(size_t size);
+
+/**
+ * @brief Free a buffer from hal_slab_buf_alloc(), NULL is ignored.
+ */
+void hal_slab_buf_free(void* buf);
+
+int hal_slab_get_stats(struct hal_slab_cache* cache, struct hal_slab_stats* stats);
+
+/**
+ * @brief Print the statistics of every cache in use and of the static arena.
+ */
+void hal_slab_dump_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,382 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+struct hal_trace_event {
+    uint64_t    ts; /**< utils_cpu_ticks() */
+    const char* name;
+    int64_t     arg;
+    uint8_t     ph; /**< hal_trace_phase_t */
+};
+
+struct hal_trace_buf {
+    uint32_t tid;
+    uint32_t mask; /**< capacity - 1 */
+    uint64_t head; /**< written by the owner thread only */
+    int      exited; /**< owner is gone, the buffer may be handed to a new thread */
+    char     name[16];
+
+    struct hal_trace_event events[];
+};
+
+volatile int hal_trace_enabled = 0;
+
+static struct hal_trace_buf* trace_bufs[HAL_TRACE_MAX_THREADS];
+static uint32_t              trace_buf_cnt;
+static uint32_t              trace_tid_next;
+static uint32_t              trace_buf_events = HAL_TRACE_DFT_EVENTS;
+static uint64_t              trace_dropped;
+
+static __thread struct hal_trace_buf* tls_trace_buf;
+static __thread int                   tls_trace_no_buf;
+static __thread volatile int          tls_trace_busy; /**< a record or buffer setup of this thread is running */
+static __thread volatile int          tls_trace_signal; /**< nesting of hal_trace_signal_enter() */
+
+static pthread_key_t  trace_buf_key;
+static pthread_once_t trace_buf_key_once = PTHREAD_ONCE_INIT;
+
+static uint32_t round_up_pow2(uint32_t v)
+{
+    uint32_t r = 1;
+
+    while ((r < v) && (r < (1U << 31))) {
+        r <<= 1;
+    }
+
+    return r;
+}
+
+static void trace_buf_release(void* args)
+{
+    struct hal_trace_buf* buf = (struct hal_trace_buf*)args;
+
+    /* keep the events for the dump until all slots are taken and a new thread needs one */
+    tls_trace_buf    = NULL;
+    tls_trace_no_buf = 1;
+    __atomic_store_n(&buf->exited, 1, __ATOMIC_RELEASE);
+}
+
+static void trace_buf_key_create(void)
+{
+    if (0 != pthread_key_create(&trace_buf_key, trace_buf_release)) {
+        printf("[hal_trace]: create thread key failed, buffers of exited threads are not reused\n");
+    }
+}
+
+static struct hal_trace_buf* trace_buf_reuse(void)
+{
+    uint32_t cnt = __atomic_load_n(&trace_buf_cnt, __ATOMIC_ACQUIRE);
+
+    for (uint32_t i = 0; (i < cnt) && (i < HAL_TRACE_MAX_THREADS); i++) {
+        struct hal_trace_buf* buf    = __atomic_load_n(&trace_bufs[i], __ATOMIC_ACQUIRE);
+        int                   exited = 1;
+
+        if (buf && __atomic_compare_exchange_n(&buf->exited, &exited, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return buf;
+        }
+    }
+
+    return NULL;
+}
+
+static struct hal_trace_buf* trace_buf_get(void)
+{
+    uint32_t              idx;
+    struct hal_trace_buf* buf;
+
+    if (tls_trace_buf) {
+        return tls_trace_buf;
+    }
+
+    if (tls_trace_no_buf) {
+        return NULL;
+    }
+
+    pthread_once(&trace_buf_key_once, trace_buf_key_create);
+
+    if ((HAL_TRACE_MAX_THREADS <= __atomic_load_n(&trace_buf_cnt, __ATOMIC_RELAXED))
+        || (HAL_TRACE_MAX_THREADS <= (idx = __atomic_fetch_add(&trace_buf_cnt, 1, __ATOMIC_RELAXED)))) {
+        if (NULL == (buf = trace_buf_reuse())) {
+            tls_trace_no_buf = 1;
+            return NULL;
+        }
+        /* the previous owner's events are dropped, its ring size is kept */
+        buf->tid = __atomic_add_fetch(&trace_tid_next, 1, __ATOMIC_RELAXED);
+        snprintf(buf->name, sizeof(buf->name), "thread%u", buf->tid);
+        __atomic_store_n(&buf->head, 0, __ATOMIC_RELEASE);
+    } else {
+        /* hal_trace_set_thread_name() may set up a buffer before hal_trace_start() */
+        uint32_t events = round_up_pow2(trace_buf_events);
+
+        buf = calloc(1, sizeof(*buf) + events * sizeof(struct hal_trace_event));
+        if (NULL == buf) {
+            tls_trace_no_buf = 1;
+            return NULL;
+        }
+        buf->tid  = __atomic_add_fetch(&trace_tid_next, 1, __ATOMIC_RELAXED);
+        buf->mask = events - 1;
+        snprintf(buf->name, sizeof(buf->name), "thread%u", buf->tid);
+
+        /* publish, dump only looks at slots below trace_buf_cnt that are non-NULL */
+        __atomic_store_n(&trace_bufs[idx], buf, __ATOMIC_RELEASE);
+    }
+    tls_trace_buf = buf;
+    pthread_setspecific(trace_buf_key, buf);
+
+    return buf;
+}
+
+void hal_trace_signal_enter(void) { tls_trace_signal++; }
+
+void hal_trace_signal_leave(void) { tls_trace_signal--; }
+
+/*
+ * Only the owner thread writes its ring, the one thing that can interleave is
+ * a signal handler on the same thread. It drops its event while the thread is
+ * inside a record, and never sets up a buffer, calloc() is not signal safe.
+ */
+void _hal_trace_record(hal_trace_phase_t ph, const char* name, int64_t arg)
+{
+    uint64_t                head;
+    struct hal_trace_buf*   buf;
+    struct hal_trace_event* ev;
+
+    if (tls_trace_busy) {
+        __atomic_fetch_add(&trace_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    tls_trace_busy = 1;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    if ((NULL == (buf = tls_trace_buf)) && !tls_trace_signal) {
+        buf = trace_buf_get();
+    }
+
+    if (NULL == buf) {
+        __atomic_fetch_add(&trace_dropped, 1, __ATOMIC_RELAXED);
+    } else {
+        head = __atomic_load_n(&buf->head, __ATOMIC_RELAXED);
+        ev   = &buf->events[head & buf->mask];
+
+        ev->ts   = utils_cpu_ticks();
+        ev->name = name;
+        ev->arg  = arg;
+        ev->ph   = (uint8_t)ph;
+
+        __atomic_store_n(&buf->head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    tls_trace_busy = 0;
+}
+
+/**
+ * @brief Start recording trace points
+ *
+ * @param events_per_thread Ring buffer size for threads that start recording
+ *        from now on, rounded up to a power of 2; 0 keeps the current size,
+ *        HAL_TRACE_DFT_EVENTS at first, which is rounded up the same way.
+ * @return 0 on success
+ */
+int hal_trace_start(uint32_t events_per_thread)
+{
+    /* the ring index is masked, a size from the config may not be a power of 2 */
+    trace_buf_events = round_up_pow2(events_per_thread ? events_per_thread : trace_buf_events);
+
+    __atomic_store_n(&hal_trace_enabled, 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+void hal_trace_stop(void) { __atomic_store_n(&hal_trace_enabled, 0, __ATOMIC_RELEASE); }
+
+/**
+ * @brief Discard all recorded events
+ * @note Only call while no thread is recording, e.g. after hal_trace_stop().
+ */
+void hal_trace_reset(void)
+{
+    uint32_t cnt = __atomic_load_n(&trace_buf_cnt, __ATOMIC_ACQUIRE);
+
+    for (uint32_t i = 0; (i < cnt) && (i < HAL_TRACE_MAX_THREADS); i++) {
+        struct hal_trace_buf* buf = __atomic_load_n(&trace_bufs[i], __ATOMIC_ACQUIRE);
+        if (buf) {
+            __atomic_store_n(&buf->head, 0, __ATOMIC_RELEASE);
+        }
+    }
+    __atomic_store_n(&trace_dropped, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Name the calling thread in the dumped trace
+ */
+void hal_trace_set_thread_name(const char* name)
+{
+    struct hal_trace_buf* buf;
+
+    if ((NULL == name) || tls_trace_busy) {
+        return;
+    }
+    tls_trace_busy = 1;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    if (NULL != (buf = trace_buf_get())) {
+        strncpy(buf->name, name, sizeof(buf->name) - 1);
+        buf->name[sizeof(buf->name) - 1] = '\0';
+    }
+
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    tls_trace_busy = 0;
+}
+
+void hal_trace_get_stats(struct hal_trace_stats* stats)
+{
+    uint32_t cnt;
+
+    if (NULL == stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    cnt = __atomic_load_n(&trace_buf_cnt, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; (i < cnt) && (i < HAL_TRACE_MAX_THREADS); i++) {
+        struct hal_trace_buf* buf = __atomic_load_n(&trace_bufs[i], __ATOMIC_ACQUIRE);
+        if (NULL == buf) {
+            continue;
+        }
+        uint64_t head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+
+        stats->threads++;
+        stats->recorded += head;
+        if (head > ((uint64_t)buf->mask + 1)) {
+            stats->overwritten += head - ((uint64_t)buf->mask + 1);
+        }
+    }
+    stats->dropped = __atomic_load_n(&trace_dropped, __ATOMIC_RELAXED);
+}
+
+static void dump_json_string(FILE* fp, const char* str)
+{
+    fputc('"', fp);
+    for (; str && *str; str++) {
+        if (('"' == *str) || ('\\' == *str)) {
+            fputc('\\', fp);
+            fputc(*str, fp);
+        } else if ((unsigned char)*str < 0x20) {
+            fprintf(fp, "\\u%04x", *str);
+        } else {
+            fputc(*str, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static int dump_buf(FILE* fp, struct hal_trace_buf* buf, int pid, int first)
+{
+    uint64_t cap = (uint64_t)buf->mask + 1;
+    uint64_t head, tail, check;
+
+    head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    tail = (head > cap) ? (head - cap) : 0;
+
+    fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",", pid,
+            buf->tid);
+    dump_json_string(fp, buf->name);
+    fprintf(fp, "}}");
+
+    for (uint64_t i = tail; i < head; i++) {
+        struct hal_trace_event ev = buf->events[i & buf->mask];
+
+        /* the owner may still be recording, skip slots it already reused */
+        check = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+        if ((check > cap) && (i < (check - cap))) {
+            continue;
+        }
+
+        uint64_t ns = utils_cpu_ticks_to_ns(ev.ts);
+
+        fprintf(fp, ",\n{\"name\":");
+        dump_json_string(fp, ev.name);
+        fprintf(fp, ",\"cat\":\"hal\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%u", ev.ph,
+                (unsigned long long)(ns / 1000), (unsigned long long)(ns % 1000), pid, buf->tid);
+
+        if (HAL_TRACE_PH_INSTANT == ev.ph) {
+            fprintf(fp, ",\"s\":\"t\",\"args\":{\"arg\":%lld}", (long long)ev.arg);
+        } else if (HAL_TRACE_PH_COUNTER == ev.ph) {
+            fprintf(fp, ",\"args\":{\"value\":%lld}", (long long)ev.arg);
+        }
+        fprintf(fp, "}");
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write all recorded events as Chrome trace / Perfetto JSON
+ *
+ * @param path Output file, open it with chrome://tracing or ui.perfetto.dev
+ * @return 0 on success, -1 on failure
+ */
+int hal_trace_dump(const char* path)
+{
+    FILE*    fp;
+    uint32_t cnt;
+    int      pid   = (int)getpid();
+    int      first = 1;
+
+    if (NULL == path) {
+        return -1;
+    }
+
+    if (NULL == (fp = fopen(path, "w"))) {
+        printf("[hal_trace]: open %s failed\n", path);
+        return -1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    cnt = __atomic_load_n(&trace_buf_cnt, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; (i < cnt) && (i < HAL_TRACE_MAX_THREADS); i++) {
+        struct hal_trace_buf* buf = __atomic_load_n(&trace_bufs[i], __ATOMIC_ACQUIRE);
+        if (buf) {
+            dump_buf(fp, buf, pid, first);
+            first = 0;
+        }
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lightweight event tracing on top of utils_cpu_ticks().
+ *
+ * Every thread records into its own ring buffer, so recording is a couple of
+ * stores without locks or syscalls. The trace points compile to nothing unless
+ * HAL_TRACE_ENABLE is defined (CONFIG_RT_SMART_HAL_TRACE), and are skipped at
+ * runtime until hal_trace_start() is called.
+ *
+ * Event names are stored by pointer, so they must be string literals or
+ * otherwise outlive the dump.
+ *
+ * Trace points are async-signal-safe inside hal_trace_signal_enter() and
+ * hal_trace_signal_leave(), which hal_dispatch_deliver() puts around signal
+ * mode callbacks: there a thread only records into a buffer it already has,
+ * and an event interrupting a record of the same thread is dropped. Both
+ * count as dropped. Other signal handlers must bracket their trace points
+ * the same way.
+ */
+
+#ifndef HAL_TRACE_DFT_EVENTS
+#define HAL_TRACE_DFT_EVENTS (4096) /* events per thread, rounded up to a power of 2 */
+#endif
+
+#define HAL_TRACE_MAX_THREADS (64)
+
+typedef enum {
+    HAL_TRACE_PH_BEGIN   = 'B',
+    HAL_TRACE_PH_END     = 'E',
+    HAL_TRACE_PH_INSTANT = 'i',
+    HAL_TRACE_PH_COUNTER = 'C',
+} hal_trace_phase_t;
+
+struct hal_trace_stats {
+    uint32_t threads; /**< thread buffers, an exited thread's buffer is reused once all are taken */
+    uint64_t recorded; /**< events recorded, including overwritten ones */
+    uint64_t overwritten; /**< events lost to ring buffer wrap around */
+    uint64_t dropped; /**< events dropped, no buffer for the thread */
+};
+
+extern volatile int hal_trace_enabled;
+
+int  hal_trace_start(uint32_t events_per_thread);
+void hal_trace_stop(void);
+void hal_trace_reset(void);
+
+void hal_trace_set_thread_name(const char* name);
+
+void hal_trace_signal_enter(void);
+void hal_trace_signal_leave(void);
+
+void _hal_trace_record(hal_trace_phase_t ph, const char* name, int64_t arg);
+
+int  hal_trace_dump(const char* path);
+void hal_trace_get_stats(struct hal_trace_stats* stats);
+
+static inline __attribute__((always_inline)) void hal_trace_record(hal_trace_phase_t ph, const char* name, int64_t arg)
+{
+    if (__atomic_load_n(&hal_trace_enabled, __ATOMIC_RELAXED)) {
+        _hal_trace_record(ph, name, arg);
+    }
+}
+
+static inline __attribute__((always_inline)) void _hal_trace_scope_end(const char** name)
+{
+    hal_trace_record(HAL_TRACE_PH_END, *name, 0);
+}
+
+#if defined(HAL_TRACE_ENABLE)
+
+#define HAL_TRACE_BEGIN(name)        hal_trace_record(HAL_TRACE_PH_BEGIN, (name), 0)
+#define HAL_TRACE_END(name)          hal_trace_record(HAL_TRACE_PH_END, (name), 0)
+#define HAL_TRACE_INSTANT(name, arg) hal_trace_record(HAL_TRACE_PH_INSTANT, (name), (int64_t)(arg))
+#define HAL_TRACE_COUNTER(name, val) hal_trace_record(HAL_TRACE_PH_COUNTER, (name), (int64_t)(val))
+
+#define _HAL_TRACE_CONCAT(a, b) a##b
+#define _HAL_TRACE_VAR(line)    _HAL_TRACE_CONCAT(_hal_trace_scope_, line)
+
+/* begin event now, end event when the enclosing scope is left */
+#define HAL_TRACE_SCOPE(name)                                                                                                  \
+    const char* _HAL_TRACE_VAR(__LINE__) __attribute__((cleanup(_hal_trace_scope_end))) = (name);                              \
+    HAL_TRACE_BEGIN(_HAL_TRACE_VAR(__LINE__))
+
+#define HAL_TRACE_FUNC() HAL_TRACE_SCOPE(__func__)
+
+#else
+
+#define HAL_TRACE_BEGIN(name)        do { } while (0)
+#define HAL_TRACE_END(name)          do { } while (0)
+#define HAL_TRACE_INSTANT(name, arg) do { } while (0)
+#define HAL_TRACE_COUNTER(name, val) do { } while (0)
+#define HAL_TRACE_SCOPE(name)        do { } while (0)
+#define HAL_TRACE_FUNC()             do { } while (0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,13 +24,264 @@
  */
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
 #include "hal_utils.h"
+#include "list.h"
+
+/** condition waits *********************************************************/
+/**
+ * @brief CLOCK_MONOTONIC deadline @ns from now for utils_cond_wait()
+ */
+void utils_cond_deadline(struct timespec* ts, uint64_t ns)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ns / 1000000000ULL;
+    ts->tv_nsec += ns % 1000000000ULL;
+    if (1000000000L <= ts->tv_nsec) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief Wait on @cond with @lock held until @deadline, NULL waits forever
+ *
+ * @return 0 when woken, ETIMEDOUT once @deadline passed
+ */
+int utils_cond_wait(pthread_cond_t* cond, pthread_mutex_t* lock, const struct timespec* deadline)
+{
+    if (NULL == deadline) {
+        return pthread_cond_wait(cond, lock);
+    }
+
+    return pthread_cond_timedwait(cond, lock, deadline);
+}
+
+/** memory map cache ********************************************************/
+#define MEM_PAGE_MASK ((uint64_t)UTILS_MEM_PAGE_SIZE - 1)
+
+struct mem_region {
+    struct list_head node;
+
+    uint64_t phys; /**< page aligned physical address */
+    size_t   size; /**< page aligned length */
+    void*    virt; /**< mapped virtual address */
+    int      ref_cnt;
+};
+
+static LIST_HEAD(mem_region_list);
+static pthread_mutex_t mem_region_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int  mem_fd = -1;
+static char mem_dev[64] = UTILS_MEM_DFT_DEV;
+
+static uint64_t mem_map_hits, mem_map_misses;
+
+static int mem_dev_open(void)
+{
+    if (0 > mem_fd) {
+        if (0 > (mem_fd = open(mem_dev, O_RDWR | O_SYNC))) {
+            printf("[hal_utils]: open %s failed\n", mem_dev);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* caller must hold mem_region_lock */
+static void mem_region_trim_locked(void)
+{
+    struct mem_region *region, *n;
+
+    list_for_each_entry_safe(region, n, &mem_region_list, node)
+    {
+        if (0x00 == region->ref_cnt) {
+            list_del(&region->node);
+            munmap(region->virt, region->size);
+            free(region);
+        }
+    }
+
+    if (list_empty(&mem_region_list) && (0 <= mem_fd)) {
+        close(mem_fd);
+        mem_fd = -1;
+    }
+}
+
+/**
+ * @brief Get a mapping of a physical memory range
+ *
+ * Mappings are shared by all callers in the process and looked up by physical
+ * page, so mapping the same register block again only bumps a reference count.
+ * Released mappings stay cached until utils_mem_map_trim() is called.
+ *
+ * @param phys Physical address, need not be page aligned
+ * @param size Length of the range in bytes, 0 is treated as 1
+ * @return Virtual address corresponding to phys, or NULL on failure
+ */
+volatile void* utils_mem_map_get(uint64_t phys, size_t size)
+{
+    uint64_t           page_phys, page_end;
+    size_t             map_size;
+    void*              virt;
+    struct mem_region* region;
+
+    if (0x00 == size) {
+        size = 1;
+    }
+
+    page_phys = phys & ~MEM_PAGE_MASK;
+    page_end  = (phys + size + MEM_PAGE_MASK) & ~MEM_PAGE_MASK;
+    map_size  = (size_t)(page_end - page_phys);
+
+    pthread_mutex_lock(&mem_region_lock);
+
+    list_for_each_entry(region, &mem_region_list, node)
+    {
+        if ((region->phys <= page_phys) && ((region->phys + region->size) >= page_end)) {
+            region->ref_cnt++;
+            mem_map_hits++;
+
+            pthread_mutex_unlock(&mem_region_lock);
+            return (volatile void*)((uintptr_t)region->virt + (uintptr_t)(phys - region->phys));
+        }
+    }
+
+    if (0x00 != mem_dev_open()) {
+        pthread_mutex_unlock(&mem_region_lock);
+        return NULL;
+    }
+
+    if (NULL == (region = malloc(sizeof(*region)))) {
+        printf("[hal_utils]: malloc mem region failed\n");
+        pthread_mutex_unlock(&mem_region_lock);
+        return NULL;
+    }
+
+    virt = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, (off_t)page_phys);
+    if (MAP_FAILED == virt) {
+        printf("[hal_utils]: mmap 0x%llx size %zu failed\n", (unsigned long long)page_phys, map_size);
+        free(region);
+        pthread_mutex_unlock(&mem_region_lock);
+        return NULL;
+    }
+
+    region->phys    = page_phys;
+    region->size    = map_size;
+    region->virt    = virt;
+    region->ref_cnt = 1;
+    list_add_tail(&region->node, &mem_region_list);
+    mem_map_misses++;
+
+    pthread_mutex_unlock(&mem_region_lock);
+
+    return (volatile void*)((uintptr_t)virt + (uintptr_t)(phys - page_phys));
+}
+
+/**
+ * @brief Release a mapping got by utils_mem_map_get()
+ *
+ * @param addr Any address inside the mapped range
+ */
+void utils_mem_map_put(volatile void* addr)
+{
+    uintptr_t          va = (uintptr_t)addr;
+    struct mem_region* region;
+
+    if (NULL == addr) {
+        return;
+    }
+
+    pthread_mutex_lock(&mem_region_lock);
+
+    list_for_each_entry(region, &mem_region_list, node)
+    {
+        if ((va >= (uintptr_t)region->virt) && (va < ((uintptr_t)region->virt + region->size))) {
+            if (0 < region->ref_cnt) {
+                region->ref_cnt--;
+            }
+            pthread_mutex_unlock(&mem_region_lock);
+            return;
+        }
+    }
+
+    pthread_mutex_unlock(&mem_region_lock);
+
+    printf("[hal_utils]: put unknown mapping %p\n", (void*)va);
+}
+
+/**
+ * @brief Unmap all idle mappings, close the memory device if nothing is left
+ */
+void utils_mem_map_trim(void)
+{
+    pthread_mutex_lock(&mem_region_lock);
+    mem_region_trim_locked();
+    pthread_mutex_unlock(&mem_region_lock);
+}
+
+/**
+ * @brief Change the device backing the mapping cache
+ *
+ * Used to run against a file-backed stand-in for /dev/mem, the file offset
+ * is treated as the physical address.
+ *
+ * @param path Device or file path, NULL to restore /dev/mem
+ * @return 0 on success, -1 if mappings are still in use
+ */
+int utils_mem_map_set_device(const char* path)
+{
+    pthread_mutex_lock(&mem_region_lock);
+
+    mem_region_trim_locked();
+
+    if (!list_empty(&mem_region_list)) {
+        pthread_mutex_unlock(&mem_region_lock);
+        printf("[hal_utils]: mem map still in use\n");
+        return -1;
+    }
+
+    strncpy(mem_dev, path ? path : UTILS_MEM_DFT_DEV, sizeof(mem_dev) - 1);
+    mem_dev[sizeof(mem_dev) - 1] = '\0';
+
+    pthread_mutex_unlock(&mem_region_lock);
+
+    return 0;
+}
+
+void utils_mem_map_get_stats(struct utils_mem_map_stats* stats)
+{
+    struct mem_region* region;
+
+    if (NULL == stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&mem_region_lock);
+
+    list_for_each_entry(region, &mem_region_list, node)
+    {
+        stats->regions++;
+        stats->mapped_bytes += region->size;
+        if (region->ref_cnt) {
+            stats->busy_regions++;
+        }
+    }
+    stats->hits   = mem_map_hits;
+    stats->misses = mem_map_misses;
+
+    pthread_mutex_unlock(&mem_region_lock);
+}
 
 /**
  * @brief Map a memory region from /dev/mem
@@ -38,54 +289,38 @@
  * @param map Pointer to the utils_memory_map structure
  * @param target The target address to map
  * @return Pointer to the mapped memory region, or NULL on failure
- * @note The mapped memory region is 4096 bytes in size.
+ * @note The page containing target is mapped through the mapping cache,
+ *       the page stays accessible until utils_unmap_memory() is called.
  */
 volatile uint32_t* utils_map_memory(struct utils_memory_map* map, uint32_t target)
 {
+    volatile void* page;
+
     if (map == NULL)
         return NULL;
 
-    if (map->base != NULL) {
-        munmap(map->base, 4096);
-        map->base = NULL;
-    }
-    if (map->fd >= 0) {
-        close(map->fd);
-        map->fd = -1;
-    }
-
-    map->fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if (map->fd < 0) {
-        printf("open /dev/mem failed\n");
-        return NULL;
-    }
+    utils_unmap_memory(map);
 
-    map->base = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, (target & ~(4096 - 1)));
-    if (map->base == MAP_FAILED) {
-        printf("mmap /dev/mem failed\n");
-        close(map->fd);
-        map->fd = -1;
+    if (NULL == (page = utils_mem_map_get(target & ~MEM_PAGE_MASK, UTILS_MEM_PAGE_SIZE))) {
         return NULL;
     }
+    map->base = (void*)page;
 
-    return (volatile uint32_t*)((uintptr_t)map->base + (target & (4096 - 1)));
+    return (volatile uint32_t*)((uintptr_t)page + (target & MEM_PAGE_MASK));
 }
 
 /**
- * @brief Unmap the memory region and close the file descriptor
+ * @brief Release the mapping got by utils_map_memory()
  *
  * @param map Pointer to the utils_memory_map structure
  */
 void utils_unmap_memory(struct utils_memory_map* map)
 {
     if (map->base != NULL) {
-        munmap(map->base, 4096);
+        utils_mem_map_put(map->base);
         map->base = NULL;
     }
-    if (map->fd >= 0) {
-        close(map->fd);
-        map->fd = -1;
-    }
+    map->fd = -1;
 }
 
 /**
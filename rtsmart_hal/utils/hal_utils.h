@@ -24,9 +24,13 @@
  */
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#include <pthread.h>
+#include <time.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,41 +41,77 @@ extern "C" {
 static __inline __attribute__((__always_inline__)) uint64_t utils_cpu_ticks(void)
 {
     uint64_t tick;
+#if defined(__riscv)
     __asm__ __volatile__("rdtime %0" : "=r"(tick));
+#else
+    /* host build, emulate the 27MHz timebase with the monotonic clock */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    tick = ((uint64_t)ts.tv_sec * CPU_TICKS_PER_SECOND) + (((uint64_t)ts.tv_nsec * 27) / 1000);
+#endif
     return tick;
 }
 
 static __inline __attribute__((__always_inline__)) uint64_t utils_cpu_ticks_ms(void)
 {
-    uint64_t time;
-    __asm__ __volatile__("rdtime %0" : "=r"(time));
-    return (time / (CPU_TICKS_PER_SECOND / 1000));
+    return (utils_cpu_ticks() / (CPU_TICKS_PER_SECOND / 1000));
 }
 
 static __inline __attribute__((__always_inline__)) uint64_t utils_cpu_ticks_us(void)
 {
-    uint64_t time;
-    __asm__ __volatile__("rdtime %0" : "=r"(time));
-    return (time / (CPU_TICKS_PER_SECOND / 1000000));
+    return (utils_cpu_ticks() / (CPU_TICKS_PER_SECOND / 1000000));
+}
+
+static __inline __attribute__((__always_inline__)) uint64_t utils_cpu_ticks_to_ns(uint64_t tick)
+{
+    /* split so the multiply does not overflow after ~11 minutes of ticks */
+    return (tick / CPU_TICKS_PER_SECOND) * 1000000000ULL + ((tick % CPU_TICKS_PER_SECOND) * 1000000000ULL) / CPU_TICKS_PER_SECOND;
+}
+
+static __inline __attribute__((__always_inline__)) uint64_t utils_ns_to_cpu_ticks(uint64_t ns)
+{
+    return (ns / 1000000000ULL) * CPU_TICKS_PER_SECOND + ((ns % 1000000000ULL) * CPU_TICKS_PER_SECOND) / 1000000000ULL;
 }
 
 static __inline __attribute__((__always_inline__)) uint64_t utils_cpu_ticks_ns(void)
 {
-    uint64_t time;
-    __asm__ __volatile__("rdtime %0" : "=r"(time));
-    return (time * 1000000000ULL) / CPU_TICKS_PER_SECOND;
+    return utils_cpu_ticks_to_ns(utils_cpu_ticks());
 }
 
+/** condition waits *********************************************************/
+/* for conditions created on CLOCK_MONOTONIC, see pthread_condattr_setclock() */
+void utils_cond_deadline(struct timespec* ts, uint64_t ns);
+int  utils_cond_wait(pthread_cond_t* cond, pthread_mutex_t* lock, const struct timespec* deadline);
+
 /** memory map **************************************************************/
+#define UTILS_MEM_PAGE_SIZE (4096)
+#define UTILS_MEM_DFT_DEV   "/dev/mem"
+
 struct utils_memory_map {
-    int   fd; /**< file descriptor */
-    void* base; /**< base address of mapped memory */
+    int   fd; /**< unused, kept for compatibility, always -1 */
+    void* base; /**< page base of the cached mapping */
+};
+
+struct utils_mem_map_stats {
+    uint32_t regions; /**< number of mapped regions, busy and idle */
+    uint32_t busy_regions; /**< regions with a non-zero reference count */
+    size_t   mapped_bytes; /**< total bytes currently mapped */
+    uint64_t hits; /**< lookups served by an existing mapping */
+    uint64_t misses; /**< lookups that created a new mapping */
 };
 
 volatile uint32_t* utils_map_memory(struct utils_memory_map* map, uint32_t target);
 
 void utils_unmap_memory(struct utils_memory_map* map);
 
+/* process-wide, refcounted register mapping cache, keyed by physical page */
+volatile void* utils_mem_map_get(uint64_t phys, size_t size);
+void           utils_mem_map_put(volatile void* addr);
+
+void utils_mem_map_trim(void);
+int  utils_mem_map_set_device(const char* path);
+void utils_mem_map_get_stats(struct utils_mem_map_stats* stats);
+
 int utils_reboot(void);
 int utils_reboot_to_bootloader(void);
 
@@ -2,6 +2,9 @@
 #ifndef LIST_H
 #define LIST_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /*
  * Copied from include/linux/...
  */
@@ -121,4 +124,225 @@ static inline void list_del(struct list_head* entry)
     entry->next = (struct list_head*)LIST_POISON1;
     entry->prev = (struct list_head*)LIST_POISON2;
 }
+
+/**
+ * list_del_init - deletes entry from list and reinitialize it.
+ * @entry: the element to delete from the list.
+ */
+static inline void list_del_init(struct list_head* entry)
+{
+    __list_del(entry->prev, entry->next);
+    INIT_LIST_HEAD(entry);
+}
+
+/**
+ * list_replace - replace old entry by new one
+ * @old : the element to be replaced
+ * @new : the new element to insert
+ *
+ * If @old was empty, it will be overwritten.
+ */
+static inline void list_replace(struct list_head* old, struct list_head* _new)
+{
+    _new->next       = old->next;
+    _new->next->prev = _new;
+    _new->prev       = old->prev;
+    _new->prev->next = _new;
+}
+
+/**
+ * list_replace_init - replace old entry by new one and initialize the old one
+ * @old : the element to be replaced
+ * @new : the new element to insert
+ */
+static inline void list_replace_init(struct list_head* old, struct list_head* _new)
+{
+    list_replace(old, _new);
+    INIT_LIST_HEAD(old);
+}
+
+/*
+ * Double linked lists with a single pointer list head.
+ * Mostly useful for hash tables where the two pointer list head is
+ * too wasteful.
+ * You lose the ability to access the tail in O(1).
+ */
+struct hlist_head {
+    struct hlist_node* first;
+};
+
+struct hlist_node {
+    struct hlist_node *next, **pprev;
+};
+
+#define HLIST_HEAD_INIT { .first = NULL }
+#define HLIST_HEAD(name) struct hlist_head name = { .first = NULL }
+#define INIT_HLIST_HEAD(ptr) ((ptr)->first = NULL)
+
+static inline void INIT_HLIST_NODE(struct hlist_node* h)
+{
+    h->next  = NULL;
+    h->pprev = NULL;
+}
+
+/**
+ * hlist_unhashed - Has node been removed from list and reinitialized?
+ * @h: Node to be checked
+ */
+static inline int hlist_unhashed(const struct hlist_node* h) { return !h->pprev; }
+
+/**
+ * hlist_empty - Is the specified hlist_head structure an empty hlist?
+ * @h: Structure to check.
+ */
+static inline int hlist_empty(const struct hlist_head* h) { return !h->first; }
+
+static inline void __hlist_del(struct hlist_node* n)
+{
+    struct hlist_node*  next  = n->next;
+    struct hlist_node** pprev = n->pprev;
+
+    *pprev = next;
+    if (next) {
+        next->pprev = pprev;
+    }
+}
+
+/**
+ * hlist_del - Delete the specified hlist_node from its list
+ * @n: Node to delete.
+ *
+ * Note that this function leaves the node in hashed state.  Use
+ * hlist_del_init() or similar instead to unhash @n.
+ */
+static inline void hlist_del(struct hlist_node* n)
+{
+    __hlist_del(n);
+    n->next  = (struct hlist_node*)LIST_POISON1;
+    n->pprev = (struct hlist_node**)LIST_POISON2;
+}
+
+/**
+ * hlist_del_init - Delete the specified hlist_node from its list and initialize
+ * @n: Node to delete.
+ *
+ * Note that this function leaves the node in unhashed state.
+ */
+static inline void hlist_del_init(struct hlist_node* n)
+{
+    if (!hlist_unhashed(n)) {
+        __hlist_del(n);
+        INIT_HLIST_NODE(n);
+    }
+}
+
+/**
+ * hlist_add_head - add a new entry at the beginning of the hlist
+ * @n: new entry to be added
+ * @h: hlist head to add it after
+ *
+ * Insert a new entry after the specified head.
+ * This is good for implementing stacks.
+ */
+static inline void hlist_add_head(struct hlist_node* n, struct hlist_head* h)
+{
+    struct hlist_node* first = h->first;
+
+    n->next = first;
+    if (first) {
+        first->pprev = &n->next;
+    }
+    h->first = n;
+    n->pprev = &h->first;
+}
+
+#define hlist_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define hlist_entry_safe(ptr, type, member)                                                                                    \
+    ({                                                                                                                         \
+        typeof(ptr) ____ptr = (ptr);                                                                                           \
+        ____ptr ? hlist_entry(____ptr, type, member) : NULL;                                                                   \
+    })
+
+/**
+ * hlist_for_each_entry	- iterate over list of given type
+ * @pos:	the type * to use as a loop cursor.
+ * @head:	the head for your list.
+ * @member:	the name of the hlist_node within the struct.
+ */
+#define hlist_for_each_entry(pos, head, member)                                                                                \
+    for (pos = hlist_entry_safe((head)->first, typeof(*(pos)), member); pos;                                                   \
+         pos = hlist_entry_safe((pos)->member.next, typeof(*(pos)), member))
+
+/**
+ * hlist_for_each_entry_safe - iterate over list of given type safe against removal of list entry
+ * @pos:	the type * to use as a loop cursor.
+ * @n:		a &struct hlist_node to use as temporary storage
+ * @head:	the head for your list.
+ * @member:	the name of the hlist_node within the struct.
+ */
+#define hlist_for_each_entry_safe(pos, n, head, member)                                                                        \
+    for (pos = hlist_entry_safe((head)->first, typeof(*pos), member); pos && ({                                                \
+             n = pos->member.next;                                                                                             \
+             1;                                                                                                                \
+         });                                                                                                                   \
+         pos = hlist_entry_safe(n, typeof(*pos), member))
+
+/*
+ * Fixed size hash tables of hlist buckets, from include/linux/hash.h and
+ * include/linux/hashtable.h. The table size is a power of 2.
+ */
+#define GOLDEN_RATIO_32 0x61C88647
+#define GOLDEN_RATIO_64 0x61C8864680B583EBull
+
+static inline uint32_t hash_32(uint32_t val, unsigned int bits) { return (val * GOLDEN_RATIO_32) >> (32 - bits); }
+
+static inline uint32_t hash_64(uint64_t val, unsigned int bits) { return (uint32_t)((val * GOLDEN_RATIO_64) >> (64 - bits)); }
+
+#define hash_ptr(ptr, bits) hash_64((uint64_t)(uintptr_t)(ptr), bits)
+
+#define DEFINE_HASHTABLE(name, bits) struct hlist_head name[1 << (bits)] = { [0 ...((1 << (bits)) - 1)] = HLIST_HEAD_INIT }
+
+#define HASH_SIZE(name) (sizeof(name) / sizeof((name)[0]))
+
+/* 32 bit keys use the cheaper multiply */
+#define hash_min(val, bits) (sizeof(val) <= 4 ? hash_32(val, bits) : hash_64(val, bits))
+
+static inline void __hash_init(struct hlist_head* ht, unsigned int sz)
+{
+    for (unsigned int i = 0; i < sz; i++) {
+        INIT_HLIST_HEAD(&ht[i]);
+    }
+}
+
+/**
+ * hash_init - initialize a hash table
+ * @hashtable: hashtable to be initialized
+ */
+#define hash_init(hashtable) __hash_init(hashtable, HASH_SIZE(hashtable))
+
+/**
+ * hash_add - add an object to a hashtable
+ * @hashtable: hashtable to add to
+ * @node: the &struct hlist_node of the object to be added
+ * @key: the key of the object to be added
+ */
+#define hash_add(hashtable, node, key) hlist_add_head(node, &hashtable[hash_min(key, __builtin_ctz(HASH_SIZE(hashtable)))])
+
+/**
+ * hash_del - remove an object from a hashtable
+ * @node: &struct hlist_node of the object to remove
+ */
+static inline void hash_del(struct hlist_node* node) { hlist_del_init(node); }
+
+/**
+ * hash_for_each_possible - iterate over all possible objects hashing to the
+ * same bucket
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the hlist_node within the struct
+ * @key: the key of the objects to iterate over
+ */
+#define hash_for_each_possible(name, obj, member, key)                                                                         \
+    hlist_for_each_entry(obj, &name[hash_min(key, __builtin_ctz(HASH_SIZE(name)))], member)
 #endif
@@ -0,0 +1,134 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "min_heap.h"
+
+static inline void heap_place(struct min_heap* heap, uint32_t i, struct min_heap_node* node)
+{
+    heap->nodes[i] = node;
+    node->index    = i;
+}
+
+static void heap_sift_up(struct min_heap* heap, uint32_t i)
+{
+    struct min_heap_node* node = heap->nodes[i];
+    uint32_t              parent;
+
+    while (i) {
+        parent = (i - 1) / 2;
+        if (!heap->less(node, heap->nodes[parent])) {
+            break;
+        }
+        heap_place(heap, i, heap->nodes[parent]);
+        i = parent;
+    }
+    heap_place(heap, i, node);
+}
+
+static void heap_sift_down(struct min_heap* heap, uint32_t i)
+{
+    struct min_heap_node* node = heap->nodes[i];
+    uint32_t              child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if ((child + 1 < heap->size) && heap->less(heap->nodes[child + 1], heap->nodes[child])) {
+            child++;
+        }
+        if (!heap->less(heap->nodes[child], node)) {
+            break;
+        }
+        heap_place(heap, i, heap->nodes[child]);
+        i = child;
+    }
+    heap_place(heap, i, node);
+}
+
+static void heap_fix(struct min_heap* heap, uint32_t i)
+{
+    if (i && heap->less(heap->nodes[i], heap->nodes[(i - 1) / 2])) {
+        heap_sift_up(heap, i);
+    } else {
+        heap_sift_down(heap, i);
+    }
+}
+
+void min_heap_init(struct min_heap* heap, struct min_heap_node** storage, uint32_t capacity, min_heap_less_fn less)
+{
+    heap->nodes    = storage;
+    heap->size     = 0;
+    heap->capacity = capacity;
+    heap->less     = less;
+}
+
+int min_heap_push(struct min_heap* heap, struct min_heap_node* node)
+{
+    if ((heap->size >= heap->capacity) || min_heap_node_queued(node)) {
+        return -1;
+    }
+
+    heap->nodes[heap->size] = node;
+    node->index             = heap->size++;
+    heap_sift_up(heap, node->index);
+
+    return 0;
+}
+
+struct min_heap_node* min_heap_pop(struct min_heap* heap)
+{
+    struct min_heap_node* top = min_heap_peek(heap);
+
+    if (top) {
+        min_heap_remove(heap, top);
+    }
+
+    return top;
+}
+
+void min_heap_remove(struct min_heap* heap, struct min_heap_node* node)
+{
+    uint32_t              i = node->index;
+    struct min_heap_node* last;
+
+    if ((i >= heap->size) || (heap->nodes[i] != node)) {
+        return;
+    }
+
+    last = heap->nodes[--heap->size];
+    if (i != heap->size) {
+        heap_place(heap, i, last);
+        heap_fix(heap, i);
+    }
+    node->index = MIN_HEAP_NODE_UNQUEUED;
+}
+
+void min_heap_update(struct min_heap* heap, struct min_heap_node* node)
+{
+    if ((node->index < heap->size) && (heap->nodes[node->index] == node)) {
+        heap_fix(heap, node->index);
+    }
+}
@@ -0,0 +1,92 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Indexed binary min-heap.
+ *
+ * Nodes are embedded in the caller's objects and remember their slot, so
+ * besides push/pop an arbitrary node can be removed or re-keyed in
+ * O(log n). The slot array is provided by the caller, the heap never
+ * allocates.
+ */
+
+#define MIN_HEAP_NODE_UNQUEUED (UINT32_MAX)
+
+struct min_heap_node {
+    uint32_t index; /* slot in the heap, MIN_HEAP_NODE_UNQUEUED when not queued */
+};
+
+/* return non-zero when @a orders before @b */
+typedef int (*min_heap_less_fn)(const struct min_heap_node* a, const struct min_heap_node* b);
+
+struct min_heap {
+    struct min_heap_node** nodes;
+    uint32_t               size;
+    uint32_t               capacity;
+    min_heap_less_fn       less;
+};
+
+#define min_heap_entry(ptr, type, member) container_of(ptr, type, member)
+
+static inline void min_heap_node_init(struct min_heap_node* node) { node->index = MIN_HEAP_NODE_UNQUEUED; }
+
+static inline int min_heap_node_queued(const struct min_heap_node* node) { return MIN_HEAP_NODE_UNQUEUED != node->index; }
+
+static inline int min_heap_empty(const struct min_heap* heap) { return 0 == heap->size; }
+
+static inline struct min_heap_node* min_heap_peek(const struct min_heap* heap)
+{
+    return heap->size ? heap->nodes[0] : NULL;
+}
+
+void min_heap_init(struct min_heap* heap, struct min_heap_node** storage, uint32_t capacity, min_heap_less_fn less);
+
+/**
+ * @brief Queue @node.
+ * @return 0 on success, -1 if the heap is full or @node is already queued.
+ */
+int min_heap_push(struct min_heap* heap, struct min_heap_node* node);
+
+struct min_heap_node* min_heap_pop(struct min_heap* heap);
+
+void min_heap_remove(struct min_heap* heap, struct min_heap_node* node);
+
+/**
+ * @brief Restore the order after the key of a queued @node changed.
+ */
+void min_heap_update(struct min_heap* heap, struct min_heap_node* node);
+
+#ifdef __cplusplus
+}
+#endif
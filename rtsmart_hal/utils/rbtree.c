@@ -0,0 +1,308 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rbtree.h"
+
+static inline int rb_is_red(const struct rb_node* node) { return node && (RB_RED == node->rb_color); }
+
+static inline int rb_is_black(const struct rb_node* node) { return !rb_is_red(node); }
+
+static inline void rb_change_child(struct rb_node* old, struct rb_node* _new, struct rb_node* parent, struct rb_root* root)
+{
+    if (NULL == parent) {
+        root->rb_node = _new;
+    } else if (parent->rb_left == old) {
+        parent->rb_left = _new;
+    } else {
+        parent->rb_right = _new;
+    }
+}
+
+static void rb_rotate_left(struct rb_node* node, struct rb_root* root)
+{
+    struct rb_node* right = node->rb_right;
+
+    node->rb_right = right->rb_left;
+    if (right->rb_left) {
+        right->rb_left->rb_parent = node;
+    }
+    right->rb_parent = node->rb_parent;
+    rb_change_child(node, right, node->rb_parent, root);
+    right->rb_left  = node;
+    node->rb_parent = right;
+}
+
+static void rb_rotate_right(struct rb_node* node, struct rb_root* root)
+{
+    struct rb_node* left = node->rb_left;
+
+    node->rb_left = left->rb_right;
+    if (left->rb_right) {
+        left->rb_right->rb_parent = node;
+    }
+    left->rb_parent = node->rb_parent;
+    rb_change_child(node, left, node->rb_parent, root);
+    left->rb_right  = node;
+    node->rb_parent = left;
+}
+
+void rb_insert_color(struct rb_node* node, struct rb_root* root)
+{
+    struct rb_node *parent, *gparent, *uncle;
+
+    while (rb_is_red(parent = node->rb_parent)) {
+        /* a red parent is never the root, so the grandparent exists */
+        gparent = parent->rb_parent;
+
+        if (parent == gparent->rb_left) {
+            uncle = gparent->rb_right;
+            if (rb_is_red(uncle)) {
+                uncle->rb_color   = RB_BLACK;
+                parent->rb_color  = RB_BLACK;
+                gparent->rb_color = RB_RED;
+                node              = gparent;
+                continue;
+            }
+            if (node == parent->rb_right) {
+                rb_rotate_left(parent, root);
+                node   = parent;
+                parent = node->rb_parent;
+            }
+            parent->rb_color  = RB_BLACK;
+            gparent->rb_color = RB_RED;
+            rb_rotate_right(gparent, root);
+        } else {
+            uncle = gparent->rb_left;
+            if (rb_is_red(uncle)) {
+                uncle->rb_color   = RB_BLACK;
+                parent->rb_color  = RB_BLACK;
+                gparent->rb_color = RB_RED;
+                node              = gparent;
+                continue;
+            }
+            if (node == parent->rb_left) {
+                rb_rotate_right(parent, root);
+                node   = parent;
+                parent = node->rb_parent;
+            }
+            parent->rb_color  = RB_BLACK;
+            gparent->rb_color = RB_RED;
+            rb_rotate_left(gparent, root);
+        }
+    }
+
+    root->rb_node->rb_color = RB_BLACK;
+}
+
+/* @node (possibly NULL) replaced a black node under @parent and is one black short */
+static void rb_erase_color(struct rb_node* node, struct rb_node* parent, struct rb_root* root)
+{
+    struct rb_node* sibling;
+
+    while ((node != root->rb_node) && rb_is_black(node)) {
+        if (parent->rb_left == node) {
+            sibling = parent->rb_right;
+            if (rb_is_red(sibling)) {
+                sibling->rb_color = RB_BLACK;
+                parent->rb_color  = RB_RED;
+                rb_rotate_left(parent, root);
+                sibling = parent->rb_right;
+            }
+            if (rb_is_black(sibling->rb_left) && rb_is_black(sibling->rb_right)) {
+                sibling->rb_color = RB_RED;
+                node              = parent;
+                parent            = node->rb_parent;
+                continue;
+            }
+            if (rb_is_black(sibling->rb_right)) {
+                sibling->rb_left->rb_color = RB_BLACK;
+                sibling->rb_color          = RB_RED;
+                rb_rotate_right(sibling, root);
+                sibling = parent->rb_right;
+            }
+            sibling->rb_color           = parent->rb_color;
+            parent->rb_color            = RB_BLACK;
+            sibling->rb_right->rb_color = RB_BLACK;
+            rb_rotate_left(parent, root);
+        } else {
+            sibling = parent->rb_left;
+            if (rb_is_red(sibling)) {
+                sibling->rb_color = RB_BLACK;
+                parent->rb_color  = RB_RED;
+                rb_rotate_right(parent, root);
+                sibling = parent->rb_left;
+            }
+            if (rb_is_black(sibling->rb_left) && rb_is_black(sibling->rb_right)) {
+                sibling->rb_color = RB_RED;
+                node              = parent;
+                parent            = node->rb_parent;
+                continue;
+            }
+            if (rb_is_black(sibling->rb_left)) {
+                sibling->rb_right->rb_color = RB_BLACK;
+                sibling->rb_color           = RB_RED;
+                rb_rotate_left(sibling, root);
+                sibling = parent->rb_left;
+            }
+            sibling->rb_color          = parent->rb_color;
+            parent->rb_color           = RB_BLACK;
+            sibling->rb_left->rb_color = RB_BLACK;
+            rb_rotate_right(parent, root);
+        }
+        node = root->rb_node;
+        break;
+    }
+
+    if (node) {
+        node->rb_color = RB_BLACK;
+    }
+}
+
+void rb_erase(struct rb_node* node, struct rb_root* root)
+{
+    struct rb_node *child, *parent, *successor;
+    int             color;
+
+    if (NULL == node->rb_left) {
+        child = node->rb_right;
+    } else if (NULL == node->rb_right) {
+        child = node->rb_left;
+    } else {
+        /* two children, the in order successor takes the place of @node */
+        successor = node->rb_right;
+        while (successor->rb_left) {
+            successor = successor->rb_left;
+        }
+
+        child  = successor->rb_right;
+        parent = successor->rb_parent;
+        color  = successor->rb_color;
+
+        if (parent == node) {
+            parent = successor;
+        } else {
+            if (child) {
+                child->rb_parent = parent;
+            }
+            parent->rb_left           = child;
+            successor->rb_right       = node->rb_right;
+            node->rb_right->rb_parent = successor;
+        }
+
+        rb_change_child(node, successor, node->rb_parent, root);
+        successor->rb_parent     = node->rb_parent;
+        successor->rb_color      = node->rb_color;
+        successor->rb_left       = node->rb_left;
+        node->rb_left->rb_parent = successor;
+
+        goto rebalance;
+    }
+
+    parent = node->rb_parent;
+    color  = node->rb_color;
+    if (child) {
+        child->rb_parent = parent;
+    }
+    rb_change_child(node, child, parent, root);
+
+rebalance:
+    RB_CLEAR_NODE(node);
+    if (RB_BLACK == color) {
+        rb_erase_color(child, parent, root);
+    }
+}
+
+struct rb_node* rb_first(const struct rb_root* root)
+{
+    struct rb_node* node = root->rb_node;
+
+    if (NULL == node) {
+        return NULL;
+    }
+    while (node->rb_left) {
+        node = node->rb_left;
+    }
+
+    return node;
+}
+
+struct rb_node* rb_last(const struct rb_root* root)
+{
+    struct rb_node* node = root->rb_node;
+
+    if (NULL == node) {
+        return NULL;
+    }
+    while (node->rb_right) {
+        node = node->rb_right;
+    }
+
+    return node;
+}
+
+struct rb_node* rb_next(const struct rb_node* node)
+{
+    struct rb_node* parent;
+
+    if (RB_EMPTY_NODE(node)) {
+        return NULL;
+    }
+
+    if (node->rb_right) {
+        node = node->rb_right;
+        while (node->rb_left) {
+            node = node->rb_left;
+        }
+        return (struct rb_node*)node;
+    }
+
+    while ((parent = node->rb_parent) && (node == parent->rb_right)) {
+        node = parent;
+    }
+
+    return parent;
+}
+
+struct rb_node* rb_prev(const struct rb_node* node)
+{
+    struct rb_node* parent;
+
+    if (RB_EMPTY_NODE(node)) {
+        return NULL;
+    }
+
+    if (node->rb_left) {
+        node = node->rb_left;
+        while (node->rb_right) {
+            node = node->rb_right;
+        }
+        return (struct rb_node*)node;
+    }
+
+    while ((parent = node->rb_parent) && (node == parent->rb_left)) {
+        node = parent;
+    }
+
+    return parent;
+}
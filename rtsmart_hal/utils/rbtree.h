@@ -0,0 +1,98 @@
+/* Copyright (c) 2025, Canaan Bright Sight Co., Ltd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include "list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Intrusive red-black tree with the include/linux/rbtree.h interface.
+ *
+ * The tree does no allocation and knows nothing about keys: callers walk
+ * down from the root themselves to find the link for a new node, then call
+ * rb_link_node() and rb_insert_color() to rebalance, e.g.
+ *
+ *     struct rb_node **link = &root->rb_node, *parent = NULL;
+ *
+ *     while (*link) {
+ *         parent = *link;
+ *         if (key < rb_entry(parent, struct item, node)->key)
+ *             link = &parent->rb_left;
+ *         else
+ *             link = &parent->rb_right;
+ *     }
+ *     rb_link_node(&item->node, parent, link);
+ *     rb_insert_color(&item->node, root);
+ */
+
+#define RB_RED   (0)
+#define RB_BLACK (1)
+
+struct rb_node {
+    struct rb_node* rb_parent;
+    struct rb_node* rb_left;
+    struct rb_node* rb_right;
+    int             rb_color;
+};
+
+struct rb_root {
+    struct rb_node* rb_node;
+};
+
+#define RB_ROOT ((struct rb_root) { NULL })
+
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define RB_EMPTY_ROOT(root) (NULL == (root)->rb_node)
+
+/* a node pointing at itself is not in any tree */
+#define RB_EMPTY_NODE(node) ((node)->rb_parent == (node))
+#define RB_CLEAR_NODE(node) ((node)->rb_parent = (node))
+
+static inline void rb_link_node(struct rb_node* node, struct rb_node* parent, struct rb_node** link)
+{
+    node->rb_parent = parent;
+    node->rb_left   = NULL;
+    node->rb_right  = NULL;
+    node->rb_color  = RB_RED;
+
+    *link = node;
+}
+
+void rb_insert_color(struct rb_node* node, struct rb_root* root);
+void rb_erase(struct rb_node* node, struct rb_root* root);
+
+/* in order traversal, O(log n) worst case, O(1) amortized */
+struct rb_node* rb_first(const struct rb_root* root);
+struct rb_node* rb_last(const struct rb_root* root);
+struct rb_node* rb_next(const struct rb_node* node);
+struct rb_node* rb_prev(const struct rb_node* node);
+
+#ifdef __cplusplus
+}
+#endif
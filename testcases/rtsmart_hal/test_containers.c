@@ -0,0 +1,408 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_utils.h"
+#include "list.h"
+#include "min_heap.h"
+#include "rbtree.h"
+
+#define TEST_ITEMS   (10000)
+#define HASH_BITS    (12)
+#define BENCH_OPS    (1000) /* operations timed per structure and size */
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct item {
+    uint32_t             key;
+    struct list_head     list;
+    struct hlist_node    hash;
+    struct rb_node       rb;
+    struct min_heap_node heap;
+};
+
+static uint32_t rand_key(void) { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+
+static struct item* alloc_items(int n)
+{
+    struct item* items = calloc(n, sizeof(*items));
+
+    for (int i = 0; items && (i < n); i++) {
+        items[i].key = rand_key();
+        INIT_HLIST_NODE(&items[i].hash);
+        RB_CLEAR_NODE(&items[i].rb);
+        min_heap_node_init(&items[i].heap);
+    }
+
+    return items;
+}
+
+/** rbtree helpers ************************************************************/
+static void rb_insert_item(struct rb_root* root, struct item* it)
+{
+    struct rb_node **link = &root->rb_node, *parent = NULL;
+
+    while (*link) {
+        parent = *link;
+        if (it->key < rb_entry(parent, struct item, rb)->key) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+        }
+    }
+    rb_link_node(&it->rb, parent, link);
+    rb_insert_color(&it->rb, root);
+}
+
+static struct item* rb_find_item(struct rb_root* root, uint32_t key)
+{
+    struct rb_node* node = root->rb_node;
+
+    while (node) {
+        struct item* it = rb_entry(node, struct item, rb);
+
+        if (key < it->key) {
+            node = node->rb_left;
+        } else if (key > it->key) {
+            node = node->rb_right;
+        } else {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+/* black height of the subtree, -1 if any red-black property is broken */
+static int rb_check(const struct rb_node* node, const struct rb_node* parent)
+{
+    int left, right;
+
+    if (NULL == node) {
+        return 1;
+    }
+    if (node->rb_parent != parent) {
+        return -1;
+    }
+    if ((RB_RED == node->rb_color)
+        && ((node->rb_left && (RB_RED == node->rb_left->rb_color)) || (node->rb_right && (RB_RED == node->rb_right->rb_color)))) {
+        return -1;
+    }
+
+    left  = rb_check(node->rb_left, node);
+    right = rb_check(node->rb_right, node);
+    if ((0 > left) || (left != right)) {
+        return -1;
+    }
+
+    return left + (RB_BLACK == node->rb_color);
+}
+
+static int heap_less(const struct min_heap_node* a, const struct min_heap_node* b)
+{
+    return min_heap_entry(a, struct item, heap)->key < min_heap_entry(b, struct item, heap)->key;
+}
+
+/** functional tests **********************************************************/
+static int test_hash(void)
+{
+    static DEFINE_HASHTABLE(table, HASH_BITS);
+    struct item*            items = alloc_items(TEST_ITEMS);
+    struct item*            pos;
+    int                     found = 0, gone = 0;
+
+    printf("\n=== Testing hlist hash table ===\n");
+
+    TEST_ASSERT(items != NULL, "Allocate items");
+
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        items[i].key = i * 7919;
+        hash_add(table, &items[i].hash, items[i].key);
+    }
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        hash_for_each_possible(table, pos, hash, items[i].key) {
+            if (pos->key == items[i].key) {
+                found++;
+                break;
+            }
+        }
+    }
+    TEST_ASSERT(found == TEST_ITEMS, "Every key found");
+
+    for (int i = 0; i < TEST_ITEMS; i += 2) {
+        hash_del(&items[i].hash);
+    }
+    for (int i = 0; i < TEST_ITEMS; i += 2) {
+        hash_for_each_possible(table, pos, hash, items[i].key) {
+            if (pos->key == items[i].key) {
+                gone--;
+            }
+        }
+        gone++;
+    }
+    TEST_ASSERT(gone == TEST_ITEMS / 2 && hlist_unhashed(&items[0].hash), "Deleted keys are gone");
+
+    for (int i = 1; i < TEST_ITEMS; i += 2) {
+        hash_del(&items[i].hash);
+    }
+    free(items);
+
+    return 0;
+}
+
+static int test_rbtree(void)
+{
+    struct rb_root  root  = RB_ROOT;
+    struct item*    items = alloc_items(TEST_ITEMS);
+    struct rb_node* node;
+    uint32_t        last;
+    int             cnt, ordered;
+
+    printf("\n=== Testing red-black tree ===\n");
+
+    TEST_ASSERT(items != NULL, "Allocate items");
+
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        rb_insert_item(&root, &items[i]);
+    }
+    TEST_ASSERT(rb_check(root.rb_node, NULL) > 0 && RB_BLACK == root.rb_node->rb_color, "Balanced after insert");
+
+    cnt = 0, ordered = 1, last = 0;
+    for (node = rb_first(&root); node; node = rb_next(node), cnt++) {
+        ordered &= (rb_entry(node, struct item, rb)->key >= last);
+        last = rb_entry(node, struct item, rb)->key;
+    }
+    TEST_ASSERT(cnt == TEST_ITEMS && ordered, "In order walk forward");
+
+    cnt = 0, ordered = 1, last = UINT32_MAX;
+    for (node = rb_last(&root); node; node = rb_prev(node), cnt++) {
+        ordered &= (rb_entry(node, struct item, rb)->key <= last);
+        last = rb_entry(node, struct item, rb)->key;
+    }
+    TEST_ASSERT(cnt == TEST_ITEMS && ordered, "In order walk backward");
+
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        if (rb_find_item(&root, items[i].key) == NULL) {
+            ordered = 0;
+        }
+    }
+    TEST_ASSERT(ordered, "Every key found");
+
+    /* churn: erase random nodes and put them back with new keys */
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        struct item* it = &items[rand() % TEST_ITEMS];
+
+        rb_erase(&it->rb, &root);
+        it->key = rand_key();
+        rb_insert_item(&root, it);
+    }
+    TEST_ASSERT(rb_check(root.rb_node, NULL) > 0, "Balanced after erase and reinsert");
+
+    /* erase all in a scattered order, checking the invariants along the way */
+    ordered = 1;
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        rb_erase(&items[(i * 7) % TEST_ITEMS].rb, &root);
+        if ((0 == (i % 1000)) && (0 > rb_check(root.rb_node, NULL))) {
+            ordered = 0;
+        }
+    }
+    TEST_ASSERT(ordered, "Balanced while erasing");
+    TEST_ASSERT(RB_EMPTY_ROOT(&root) && RB_EMPTY_NODE(&items[0].rb), "Erase all");
+
+    free(items);
+
+    return 0;
+}
+
+static int test_heap(void)
+{
+    struct min_heap        heap;
+    struct min_heap_node** slots = calloc(TEST_ITEMS, sizeof(*slots));
+    struct item*           items = alloc_items(TEST_ITEMS);
+    struct min_heap_node*  node;
+    uint32_t               last  = 0;
+    int                    ordered = 1, cnt = 0;
+
+    printf("\n=== Testing indexed min-heap ===\n");
+
+    TEST_ASSERT(items != NULL && slots != NULL, "Allocate items");
+
+    min_heap_init(&heap, slots, TEST_ITEMS, heap_less);
+    for (int i = 0; i < TEST_ITEMS; i++) {
+        min_heap_push(&heap, &items[i].heap);
+    }
+    TEST_ASSERT(heap.size == TEST_ITEMS, "Push all");
+    TEST_ASSERT(0 != min_heap_push(&heap, &items[0].heap), "Queued node refused");
+
+    /* remove a third, re-key a third */
+    for (int i = 0; i < TEST_ITEMS; i += 3) {
+        min_heap_remove(&heap, &items[i].heap);
+    }
+    for (int i = 1; i < TEST_ITEMS; i += 3) {
+        items[i].key = rand_key();
+        min_heap_update(&heap, &items[i].heap);
+    }
+    TEST_ASSERT(!min_heap_node_queued(&items[0].heap), "Removed node unqueued");
+
+    while ((node = min_heap_pop(&heap))) {
+        ordered &= (min_heap_entry(node, struct item, heap)->key >= last);
+        last = min_heap_entry(node, struct item, heap)->key;
+        cnt++;
+    }
+    TEST_ASSERT(ordered && cnt == TEST_ITEMS - (TEST_ITEMS + 2) / 3, "Pop in key order");
+
+    free(items);
+    free(slots);
+
+    return 0;
+}
+
+/** benchmarks ****************************************************************/
+static uint64_t ns_per_op(uint64_t ticks, int ops) { return ticks * 1000000000ULL / CPU_TICKS_PER_SECOND / ops; }
+
+static int bench(int n)
+{
+    LIST_HEAD(list);
+    LIST_HEAD(sorted);
+    struct hlist_head*     table;
+    struct rb_root         root = RB_ROOT;
+    struct min_heap        heap;
+    struct min_heap_node** slots;
+    struct item *          items, *extra, *pos;
+    uint32_t               bits = 1;
+    uint64_t               start, t_list, t_hash, t_rb, q_list, q_heap, q_rb;
+    volatile int           hits = 0;
+
+    while ((1U << bits) < (uint32_t)n) {
+        bits++;
+    }
+
+    items = alloc_items(n);
+    extra = alloc_items(BENCH_OPS);
+    table = calloc(1U << bits, sizeof(*table));
+    slots = calloc(n + BENCH_OPS, sizeof(*slots));
+    TEST_ASSERT(items && extra && table && slots, "Allocate benchmark items");
+
+    min_heap_init(&heap, slots, n + BENCH_OPS, heap_less);
+    for (int i = 0; i < n; i++) {
+        list_add_tail(&items[i].list, &list);
+        hlist_add_head(&items[i].hash, &table[hash_32(items[i].key, bits)]);
+        rb_insert_item(&root, &items[i]);
+        min_heap_push(&heap, &items[i].heap);
+    }
+
+    /* lookup of present keys */
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        uint32_t key = items[(i * 7919) % n].key;
+        list_for_each_entry(pos, &list, list) {
+            if (pos->key == key) {
+                hits++;
+                break;
+            }
+        }
+    }
+    t_list = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        uint32_t key = items[(i * 7919) % n].key;
+        hlist_for_each_entry(pos, &table[hash_32(key, bits)], hash) {
+            if (pos->key == key) {
+                hits++;
+                break;
+            }
+        }
+    }
+    t_hash = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        hits += (NULL != rb_find_item(&root, items[(i * 7919) % n].key));
+    }
+    t_rb = utils_cpu_ticks() - start;
+
+    /* priority queue: insert a new deadline, then take the earliest */
+    for (struct rb_node* node = rb_first(&root); node; node = rb_next(node)) {
+        pos = rb_entry(node, struct item, rb);
+        list_del(&pos->list);
+        list_add_tail(&pos->list, &sorted);
+    }
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        struct item* it = &extra[i];
+        list_for_each_entry(pos, &sorted, list) {
+            if (pos->key > it->key) {
+                break;
+            }
+        }
+        __list_add(&it->list, pos->list.prev, &pos->list);
+        pos = list_entry(sorted.next, struct item, list);
+        list_del_init(&pos->list);
+        list_add_tail(&pos->list, &list);
+    }
+    q_list = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        min_heap_push(&heap, &extra[i].heap);
+        min_heap_pop(&heap);
+    }
+    q_heap = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        rb_insert_item(&root, &extra[i]);
+        rb_erase(rb_first(&root), &root);
+    }
+    q_rb = utils_cpu_ticks() - start;
+
+    printf("\n=== Benchmark %d entries, %d operations ===\n", n, BENCH_OPS);
+    printf("lookup     list %8llu ns  hash %6llu ns  rbtree %6llu ns\n", (unsigned long long)ns_per_op(t_list, BENCH_OPS),
+           (unsigned long long)ns_per_op(t_hash, BENCH_OPS), (unsigned long long)ns_per_op(t_rb, BENCH_OPS));
+    printf("insert+min list %8llu ns  heap %6llu ns  rbtree %6llu ns\n", (unsigned long long)ns_per_op(q_list, BENCH_OPS),
+           (unsigned long long)ns_per_op(q_heap, BENCH_OPS), (unsigned long long)ns_per_op(q_rb, BENCH_OPS));
+
+    TEST_ASSERT(hits == 3 * BENCH_OPS, "Every benchmark lookup hit");
+
+    free(items);
+    free(extra);
+    free(table);
+    free(slots);
+
+    return 0;
+}
+
+int main(void)
+{
+    printf("Starting Container Tests\n");
+
+    srand(1);
+    test_hash();
+    test_rbtree();
+    test_heap();
+
+    bench(10000);
+    bench(100000);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,239 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_timer.h"
+#include "hal_dispatch.h"
+
+/* the drivers take SIGRTMIN + 1 .. SIGRTMIN + 15 (timers, gpio irqs and gpio events) */
+#define TEST_SIG        (SIGRTMAX - 1)
+#define TEST_EVENTS     (2000)
+#define TEST_TIMER_ID   (0)
+#define TEST_TIMER_IRQS (50)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static hal_dispatch_mode_t sig_mode;
+static atomic_int          fired;
+static atomic_int          off_main;
+static pthread_t           main_thread;
+static pthread_mutex_t     cb_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int          gate;
+
+static void callback(void* args)
+{
+    (void)args;
+
+    if (!pthread_equal(pthread_self(), main_thread)) {
+        atomic_fetch_add(&off_main, 1);
+    }
+    if (HAL_DISPATCH_THREAD == sig_mode) {
+        /* not allowed in signal context, fine on the dispatcher thread */
+        pthread_mutex_lock(&cb_lock);
+        free(malloc(64));
+        pthread_mutex_unlock(&cb_lock);
+    }
+    atomic_fetch_add(&fired, 1);
+}
+
+static void blocking_callback(void* args)
+{
+    (void)args;
+
+    while (atomic_load(&gate)) {
+        usleep(100);
+    }
+    atomic_fetch_add(&fired, 1);
+}
+
+static void sig_handler(int sig, siginfo_t* si, void* uc)
+{
+    (void)sig;
+    (void)uc;
+
+    hal_dispatch_deliver(sig_mode, callback, si->si_ptr);
+}
+
+static void print_stats(const char* name, hal_dispatch_mode_t mode)
+{
+    struct hal_dispatch_stats st;
+
+    hal_dispatch_get_stats(mode, &st);
+    printf("%-7s: events %llu, dropped %llu, batches %llu (max %u), latency min %llu avg %llu max %llu ns\n", name,
+           (unsigned long long)st.events, (unsigned long long)st.dropped, (unsigned long long)st.batches, st.max_batch,
+           (unsigned long long)st.latency_ns_min, (unsigned long long)(st.events ? st.latency_ns_sum / st.events : 0),
+           (unsigned long long)st.latency_ns_max);
+    printf("         us histogram:");
+    for (int i = 0; i < HAL_DISPATCH_HIST_BUCKETS; i++) {
+        printf(" %llu", (unsigned long long)st.latency_hist[i]);
+    }
+    printf("\n");
+}
+
+static int run_signals(hal_dispatch_mode_t mode)
+{
+    union sigval val = { .sival_ptr = NULL };
+
+    sig_mode = mode;
+    atomic_store(&fired, 0);
+    atomic_store(&off_main, 0);
+
+    for (int i = 0; i < TEST_EVENTS; i++) {
+        while (0 != sigqueue(getpid(), TEST_SIG, val)) {
+            usleep(10);
+        }
+        if (0 == (i % 64)) {
+            usleep(100);
+        }
+    }
+    hal_dispatch_sync();
+
+    return atomic_load(&fired);
+}
+
+static int test_modes(void)
+{
+    struct hal_dispatch_stats st;
+    struct sigaction          sa;
+
+    printf("\n=== Testing signal and thread delivery ===\n");
+
+    main_thread = pthread_self();
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_flags     = SA_SIGINFO;
+    sa.sa_sigaction = sig_handler;
+    sigemptyset(&sa.sa_mask);
+    TEST_ASSERT(0 == sigaction(TEST_SIG, &sa, NULL), "Install test signal handler");
+
+    TEST_ASSERT(0 == hal_dispatch_start(), "Start dispatcher thread");
+    hal_dispatch_reset_stats();
+
+    TEST_ASSERT(TEST_EVENTS == run_signals(HAL_DISPATCH_SIGNAL), "Signal mode delivers every event");
+    TEST_ASSERT(TEST_EVENTS == run_signals(HAL_DISPATCH_THREAD), "Thread mode delivers every event");
+    TEST_ASSERT(TEST_EVENTS == atomic_load(&off_main), "Thread mode runs callbacks off the signalled thread");
+
+    hal_dispatch_get_stats(HAL_DISPATCH_SIGNAL, &st);
+    TEST_ASSERT(TEST_EVENTS == st.events, "Signal mode statistics");
+    hal_dispatch_get_stats(HAL_DISPATCH_THREAD, &st);
+    TEST_ASSERT(TEST_EVENTS == st.events && 0 == st.dropped, "Thread mode statistics");
+    TEST_ASSERT(st.batches <= st.events && st.latency_ns_min <= st.latency_ns_max, "Latency recorded");
+
+    print_stats("signal", HAL_DISPATCH_SIGNAL);
+    print_stats("thread", HAL_DISPATCH_THREAD);
+
+    return 0;
+}
+
+static int test_overflow(void)
+{
+    struct hal_dispatch_stats st;
+    int                       posted = 0;
+
+    printf("\n=== Testing queue overflow ===\n");
+
+    hal_dispatch_reset_stats();
+    atomic_store(&fired, 0);
+    atomic_store(&gate, 1);
+
+    /* the first event parks the dispatcher, the rest pile up behind it */
+    for (int i = 0; i < HAL_DISPATCH_QUEUE_DEPTH * 2; i++) {
+        if (0 == hal_dispatch_deliver(HAL_DISPATCH_THREAD, blocking_callback, NULL)) {
+            posted++;
+        }
+    }
+    atomic_store(&gate, 0);
+    hal_dispatch_sync();
+
+    hal_dispatch_get_stats(HAL_DISPATCH_THREAD, &st);
+    TEST_ASSERT(st.dropped > 0, "Full queue drops instead of blocking the handler");
+    TEST_ASSERT(posted == atomic_load(&fired) && (uint64_t)posted + st.dropped == HAL_DISPATCH_QUEUE_DEPTH * 2,
+                "Every accepted event ran once");
+
+    return 0;
+}
+
+static atomic_int timer_irqs;
+
+static void timer_callback(void* args)
+{
+    (void)args;
+    atomic_fetch_add(&timer_irqs, 1);
+}
+
+static int run_hard_timer(hal_dispatch_mode_t mode)
+{
+    drv_hard_timer_inst_t* timer = NULL;
+
+    if (0 != drv_hard_timer_inst_create(TEST_TIMER_ID, &timer)) {
+        return -1;
+    }
+
+    atomic_store(&timer_irqs, 0);
+    drv_hard_timer_set_mode(timer, HWTIMER_MODE_PERIOD);
+    drv_hard_timer_set_period(timer, 10);
+    drv_hard_timer_set_dispatch(timer, mode);
+    drv_hard_timer_register_irq(timer, timer_callback, NULL);
+    drv_hard_timer_start(timer);
+
+    for (int i = 0; (i < 2000) && (atomic_load(&timer_irqs) < TEST_TIMER_IRQS); i++) {
+        usleep(1000);
+    }
+
+    drv_hard_timer_stop(timer);
+    drv_hard_timer_unregister_irq(timer);
+    drv_hard_timer_inst_destroy(&timer);
+
+    return atomic_load(&timer_irqs);
+}
+
+static int test_hard_timer(void)
+{
+    printf("\n=== Comparing delivery modes on hwtimer%d ===\n", TEST_TIMER_ID);
+
+    if (0 != access("/dev/hwtimer0", F_OK)) {
+        printf("no hard timer, skipped\n");
+        return 0;
+    }
+
+    hal_dispatch_reset_stats();
+    TEST_ASSERT(TEST_TIMER_IRQS <= run_hard_timer(HAL_DISPATCH_SIGNAL), "Hard timer irqs in signal mode");
+    TEST_ASSERT(TEST_TIMER_IRQS <= run_hard_timer(HAL_DISPATCH_THREAD), "Hard timer irqs in thread mode");
+
+    print_stats("signal", HAL_DISPATCH_SIGNAL);
+    print_stats("thread", HAL_DISPATCH_THREAD);
+
+    return 0;
+}
+
+int main(void)
+{
+    printf("Starting IRQ Dispatcher Tests\n");
+
+    test_modes();
+    test_overflow();
+    test_hard_timer();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
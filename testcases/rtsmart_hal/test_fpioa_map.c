@@ -0,0 +1,223 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "drv_fpioa.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_fpioa_map [loops]
+ *
+ * Remuxes pins 3~12 and 42/54/60, every register is saved first and restored
+ * at the end. The console uart (pins 38/39) is not touched. The benchmark
+ * compares the indexed lookups and a one pass map apply against the per pin
+ * drv_fpioa_set_pin_func() bring-up.
+ */
+
+#define DFT_LOOPS (10000)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint32_t saved_regs[FPIOA_PIN_MAX_NUM];
+
+static const fpioa_pin_map_t board_map[] = {
+    { 3, UART1_TXD }, { 4, UART1_RXD }, { 5, UART2_TXD }, { 6, UART2_RXD }, { 7, IIC4_SCL },
+    { 8, IIC4_SDA },  { 11, GPIO11 },   { 12, GPIO12 },   { 42, PWM0 },
+};
+
+static void save_regs(void)
+{
+    for (int pin = 0; pin < FPIOA_PIN_MAX_NUM; pin++) {
+        drv_fpioa_get_pin_cfg(pin, &saved_regs[pin]);
+    }
+}
+
+static void restore_regs(void)
+{
+    for (int pin = 0; pin < FPIOA_PIN_MAX_NUM; pin++) {
+        drv_fpioa_set_pin_cfg(pin, saved_regs[pin]);
+    }
+}
+
+static int map_matches(const fpioa_pin_map_t* map, size_t count)
+{
+    fpioa_func_t func;
+
+    for (size_t i = 0; i < count; i++) {
+        if ((0x00 != drv_fpioa_get_pin_func(map[i].pin, &func)) || (func != map[i].func)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int test_lookups(void)
+{
+    int pins[FPIOA_PIN_FUNC_ALT_NUM];
+
+    printf("\n=== Testing indexed lookups ===\n");
+
+    TEST_ASSERT(drv_fpioa_get_func_cfg(UART1_TXD) && UART1_TXD == drv_fpioa_get_func_cfg(UART1_TXD)->func,
+                "Function description found");
+    TEST_ASSERT(0x18F == drv_fpioa_get_func_cfg(GPIO5)->cfg, "GPIO default description");
+    TEST_ASSERT(NULL == drv_fpioa_get_func_cfg(TEST_PIN0) && NULL == drv_fpioa_get_func_cfg(FUNC_MAX),
+                "No description for reserved functions");
+
+    TEST_ASSERT(3 == drv_fpioa_func_available_pins(UART1_TXD, pins) && 3 == pins[0] && 9 == pins[1] && 40 == pins[2],
+                "UART1_TXD pins in order");
+    TEST_ASSERT(1 == drv_fpioa_func_available_pins(GPIO20, pins) && 20 == pins[0], "GPIO20 only on pin 20");
+    TEST_ASSERT(0 == drv_fpioa_func_available_pins(FUNC_MAX, pins), "Invalid function has no pins");
+
+    TEST_ASSERT(0 == drv_fpioa_set_pin_func(60, PWM0) && 60 == drv_fpioa_find_pin_by_func(PWM0), "Find PWM0 on pin 60");
+    TEST_ASSERT(0 == drv_fpioa_set_pin_func(54, PWM0) && 54 == drv_fpioa_find_pin_by_func(PWM0),
+                "Moving PWM0 releases pin 60");
+    TEST_ASSERT(0 == drv_fpioa_set_pin_func(54, GPIO54) && 0 > drv_fpioa_find_pin_by_func(PWM0), "PWM0 unmapped");
+
+    return 0;
+}
+
+static int test_map(void)
+{
+    fpioa_map_conflict_t conflicts[8];
+    uint32_t             before[FPIOA_PIN_MAX_NUM], reg;
+    int                  same = 1;
+
+    const fpioa_pin_map_t bad_map[] = {
+        { 3, UART1_TXD }, // 0
+        { 3, UART1_TXD }, // 1 repeated, accepted
+        { 4, UART2_TXD }, // 2 pin 4 can not carry it
+        { 9, UART1_TXD }, // 3 function twice
+        { 5, UART2_TXD }, // 4
+        { 5, GPIO5 }, // 5 pin twice
+        { 64, GPIO0 }, // 6 bad pin
+        { 7, GPIO8 }, // 7 GPIO of another pin
+    };
+
+    printf("\n=== Testing pin map ===\n");
+
+    for (int pin = 0; pin < FPIOA_PIN_MAX_NUM; pin++) {
+        drv_fpioa_get_pin_cfg(pin, &before[pin]);
+    }
+
+    TEST_ASSERT(5 == drv_fpioa_map_check(bad_map, ARRAY_SIZE(bad_map), 0, conflicts, ARRAY_SIZE(conflicts)),
+                "Five conflicts found");
+    TEST_ASSERT(FPIOA_MAP_UNSUPPORTED == conflicts[0].kind && 2 == conflicts[0].index, "Unsupported function");
+    TEST_ASSERT(FPIOA_MAP_FUNC_TWICE == conflicts[1].kind && 3 == conflicts[1].index && 0 == conflicts[1].other,
+                "Function on two pins");
+    TEST_ASSERT(FPIOA_MAP_PIN_TWICE == conflicts[2].kind && 5 == conflicts[2].index && 4 == conflicts[2].other,
+                "Pin given two functions");
+    TEST_ASSERT(FPIOA_MAP_BAD_PIN == conflicts[3].kind && 6 == conflicts[3].index, "Pin out of range");
+    TEST_ASSERT(FPIOA_MAP_UNSUPPORTED == conflicts[4].kind && 7 == conflicts[4].index, "GPIO of another pin");
+    TEST_ASSERT(0 > drv_fpioa_map_apply(bad_map, ARRAY_SIZE(bad_map), 0), "Conflicting map refused");
+
+    for (int pin = 0; pin < FPIOA_PIN_MAX_NUM; pin++) {
+        drv_fpioa_get_pin_cfg(pin, &reg);
+        same &= (reg == before[pin]);
+    }
+    TEST_ASSERT(same, "Refused map wrote nothing");
+
+    TEST_ASSERT(0 == drv_fpioa_map_check(board_map, ARRAY_SIZE(board_map), 0, NULL, 0), "Board map is clean");
+    TEST_ASSERT(0 < drv_fpioa_map_apply(board_map, ARRAY_SIZE(board_map), 0), "Apply board map");
+    TEST_ASSERT(map_matches(board_map, ARRAY_SIZE(board_map)), "Every pin carries its function");
+    TEST_ASSERT(0 == drv_fpioa_map_apply(board_map, ARRAY_SIZE(board_map), 0), "Applying again writes nothing");
+
+    /* move UART1_TXD from pin 3 to pin 9, pin 3 is not in the new map */
+    const fpioa_pin_map_t move_map[] = { { 9, UART1_TXD } };
+
+    TEST_ASSERT(1 == drv_fpioa_map_check(move_map, 1, FPIOA_MAP_STRICT, conflicts, 1)
+                    && FPIOA_MAP_FUNC_MOVED == conflicts[0].kind && 3 == conflicts[0].other,
+                "Strict check reports the move");
+    TEST_ASSERT(0 > drv_fpioa_map_apply(move_map, 1, FPIOA_MAP_STRICT), "Strict apply refuses the move");
+    TEST_ASSERT(2 == drv_fpioa_map_apply(move_map, 1, 0), "Apply moves the function");
+    TEST_ASSERT(9 == drv_fpioa_find_pin_by_func(UART1_TXD), "Function now on pin 9");
+    drv_fpioa_get_pin_cfg(3, &reg);
+    TEST_ASSERT(0 == (reg & ~0x80000200U), "Released pin left on GPIO, drive off");
+
+    return 0;
+}
+
+static int bench(int loops)
+{
+    int      pins[FPIOA_PIN_FUNC_ALT_NUM];
+    uint64_t start, t_cfg, t_pins, t_find, t_set, t_map;
+
+    printf("\n=== Benchmark, %d loops ===\n", loops);
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_fpioa_get_func_cfg(CTRL_O2_3D);
+    }
+    t_cfg = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_fpioa_func_available_pins(UART3_RXD, pins);
+    }
+    t_pins = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_fpioa_find_pin_by_func(IIC4_SDA);
+    }
+    t_find = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        for (size_t j = 0; j < ARRAY_SIZE(board_map); j++) {
+            drv_fpioa_set_pin_func(board_map[j].pin, board_map[j].func);
+        }
+    }
+    t_set = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_fpioa_map_apply(board_map, ARRAY_SIZE(board_map), 0);
+    }
+    t_map = utils_cpu_ticks() - start;
+
+    printf("get_func_cfg          : %llu ns\n", (unsigned long long)(t_cfg * 1000000000ULL / CPU_TICKS_PER_SECOND / loops));
+    printf("func_available_pins   : %llu ns\n", (unsigned long long)(t_pins * 1000000000ULL / CPU_TICKS_PER_SECOND / loops));
+    printf("find_pin_by_func      : %llu ns\n", (unsigned long long)(t_find * 1000000000ULL / CPU_TICKS_PER_SECOND / loops));
+    printf("%zu x set_pin_func     : %llu ns\n", ARRAY_SIZE(board_map),
+           (unsigned long long)(t_set * 1000000000ULL / CPU_TICKS_PER_SECOND / loops));
+    printf("map_apply (%zu entries) : %llu ns\n", ARRAY_SIZE(board_map),
+           (unsigned long long)(t_map * 1000000000ULL / CPU_TICKS_PER_SECOND / loops));
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = (1 < argc) ? atoi(argv[1]) : DFT_LOOPS;
+
+    printf("Starting FPIOA Pin Map Tests\n");
+
+    save_regs();
+    test_lookups();
+    test_map();
+    bench((0 < loops) ? loops : DFT_LOOPS);
+    restore_regs();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
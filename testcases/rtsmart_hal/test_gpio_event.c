@@ -0,0 +1,412 @@
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_gpio.h"
+#include "hal_sim.h"
+#include "hal_utils.h"
+
+/*
+ * Host only, edges are injected on the simulated /dev/gpio.
+ *
+ * Usage:
+ *   test_gpio_event [rounds]
+ *
+ * All 64 irq capable pins feed one event queue. The benchmark injects @rounds
+ * edges on every pin, reading the queue in batches, and reports the cost of
+ * one edge from the signal to the reader.
+ */
+
+#define DFT_ROUNDS  (200)
+#define QUEUE_DEPTH (256)
+#define SMALL_DEPTH (16)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static drv_gpio_inst_t* pins[GPIO_IRQ_MAX_NUM];
+
+/* signals may land on another thread, wait until every edge was accounted */
+static int wait_accounted(drv_gpio_event_t* evq, uint64_t expect)
+{
+    gpio_event_stats_t st;
+
+    for (int i = 0; i < 1000; i++) {
+        drv_gpio_event_get_stats(evq, &st);
+        if ((st.events + st.overflows + st.filtered) >= expect) {
+            return 0;
+        }
+        usleep(1000);
+    }
+
+    return -1;
+}
+
+static int setup_pins(void)
+{
+    int ok = 1;
+
+    for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+        drv_fpioa_set_pin_func(i, GPIO0 + i);
+        hal_sim_gpio_inject(i, 0);
+        ok &= (0 == drv_gpio_inst_create(i, &pins[i])) && (0 == drv_gpio_mode_set(pins[i], GPIO_DM_INPUT));
+    }
+    TEST_ASSERT(ok, "Create 64 input pins");
+
+    return 0;
+}
+
+static void release_pins(void)
+{
+    for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+        hal_sim_gpio_inject(i, -1);
+        drv_gpio_inst_destroy(&pins[i]);
+    }
+}
+
+static int test_all_pins(void)
+{
+    drv_gpio_event_t*  evq = NULL;
+    gpio_event_t       ev[QUEUE_DEPTH];
+    gpio_event_stats_t st;
+    struct pollfd      pfd;
+    uint64_t           seen = 0, start;
+    int                n, ok = 1;
+
+    printf("\n=== Testing 64 pins on one queue ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_event_create(100, &evq), "Create event queue");
+    for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+        ok &= (0 == drv_gpio_event_add(evq, pins[i], GPIO_PE_BOTH, 0, 0));
+    }
+    TEST_ASSERT(ok, "Add all 64 irq pins");
+    TEST_ASSERT(0 != drv_gpio_event_add(evq, pins[3], GPIO_PE_RISING, 0, 0), "Pin added twice rejected");
+    TEST_ASSERT(0 != drv_gpio_unregister_irq(pins[3]), "Callback unregister refuses an event pin");
+
+    pfd.fd     = drv_gpio_event_fd(evq);
+    pfd.events = POLLIN;
+    TEST_ASSERT(0 == poll(&pfd, 1, 0), "Empty queue does not poll readable");
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+        hal_sim_gpio_inject(i, 1);
+    }
+    TEST_ASSERT(0 == wait_accounted(evq, GPIO_IRQ_MAX_NUM), "Every edge accounted");
+    TEST_ASSERT(1 == poll(&pfd, 1, 0), "Queue polls readable");
+
+    n = drv_gpio_event_read(evq, ev, 40, 0);
+    n += drv_gpio_event_read(evq, ev + n, QUEUE_DEPTH - n, 0);
+    TEST_ASSERT(GPIO_IRQ_MAX_NUM == n, "Read 64 events in two batches");
+    for (int i = 0; i < n; i++) {
+        ok &= (1 == ev[i].level) && !ev[i].flags && (ev[i].ticks >= start) && (ev[i].ticks <= utils_cpu_ticks());
+        seen |= 1ULL << ev[i].pin;
+    }
+    TEST_ASSERT(ok && (~0ULL == seen), "One rising event per pin with level and timestamp");
+    TEST_ASSERT(0 == poll(&pfd, 1, 0), "Drained queue does not poll readable");
+    TEST_ASSERT(0 == drv_gpio_event_read(evq, ev, QUEUE_DEPTH, 10), "Read times out on an empty queue");
+
+    hal_sim_gpio_inject(5, 0);
+    TEST_ASSERT(0 == wait_accounted(evq, GPIO_IRQ_MAX_NUM + 1), "Falling edge accounted");
+    TEST_ASSERT(1 == drv_gpio_event_read(evq, ev, QUEUE_DEPTH, 100) && 5 == ev[0].pin && 0 == ev[0].level,
+                "Falling edge reports level LOW");
+
+    TEST_ASSERT(0 == drv_gpio_event_remove(evq, pins[5]), "Remove pin");
+    hal_sim_gpio_inject(5, 1);
+    TEST_ASSERT(0 == drv_gpio_event_read(evq, ev, QUEUE_DEPTH, 10), "Removed pin reports nothing");
+    TEST_ASSERT(0 != drv_gpio_event_remove(evq, pins[5]), "Remove twice rejected");
+
+    drv_gpio_event_get_stats(evq, &st);
+    TEST_ASSERT(65 == st.events && 65 == st.read && 0 == st.overflows && 64 == st.max_depth, "Statistics");
+
+    drv_gpio_event_destroy(&evq);
+    TEST_ASSERT(NULL == evq && GPIO_PE_MAX == pins[0]->curr_irq_mode, "Destroy detaches the pins");
+
+    for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+        hal_sim_gpio_inject(i, 0);
+    }
+
+    return 0;
+}
+
+static int test_overflow(void)
+{
+    drv_gpio_event_t*  evq = NULL;
+    gpio_event_t       ev[SMALL_DEPTH * 2];
+    gpio_event_stats_t st;
+    int                n, ok = 1;
+
+    printf("\n=== Testing overflow ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_event_create(SMALL_DEPTH, &evq), "Create small queue");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[10], GPIO_PE_BOTH, 0, 0), "Add pin");
+
+    for (int i = 0; i < 40; i++) {
+        hal_sim_gpio_inject(10, !(i & 1));
+    }
+    TEST_ASSERT(0 == wait_accounted(evq, 40), "Every edge accounted");
+    drv_gpio_event_get_stats(evq, &st);
+    TEST_ASSERT(SMALL_DEPTH == st.events && (40 - SMALL_DEPTH) == st.overflows && SMALL_DEPTH == st.max_depth,
+                "Full ring counts the lost edges");
+
+    n = drv_gpio_event_read(evq, ev, SMALL_DEPTH * 2, 0);
+    for (int i = 0; i < n; i++) {
+        ok &= (ev[i].level == !(i & 1));
+    }
+    TEST_ASSERT(SMALL_DEPTH == n && ok, "Oldest events kept in order");
+
+    hal_sim_gpio_inject(10, 1);
+    TEST_ASSERT(1 == drv_gpio_event_read(evq, ev, SMALL_DEPTH, 100) && (GPIO_EVENT_F_OVERFLOW & ev[0].flags),
+                "Next event flags the overflow");
+    hal_sim_gpio_inject(10, 0);
+    TEST_ASSERT(1 == drv_gpio_event_read(evq, ev, SMALL_DEPTH, 100) && !ev[0].flags, "Flag reported once");
+
+    drv_gpio_event_destroy(&evq);
+    hal_sim_gpio_inject(10, 0);
+
+    return 0;
+}
+
+static int test_filter(void)
+{
+    drv_gpio_event_t*  evq = NULL;
+    gpio_event_t       ev[16];
+    gpio_event_stats_t st;
+
+    printf("\n=== Testing user space debounce ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_event_create(64, &evq), "Create queue");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[20], GPIO_PE_RISING, 0, 50000), "Add pin with 50ms filter");
+
+    for (int i = 0; i < 10; i++) {
+        hal_sim_gpio_inject(20, 1);
+        hal_sim_gpio_inject(20, 0);
+    }
+    TEST_ASSERT(0 == wait_accounted(evq, 10), "Every edge accounted");
+    drv_gpio_event_get_stats(evq, &st);
+    TEST_ASSERT(1 == st.events && 9 == st.filtered, "Bounces dropped");
+
+    usleep(60000);
+    hal_sim_gpio_inject(20, 1);
+    TEST_ASSERT(2 == drv_gpio_event_read(evq, ev, 16, 100) && 20 == ev[1].pin, "Edge after the window accepted");
+    TEST_ASSERT((ev[1].ticks - ev[0].ticks) >= CPU_TICKS_PER_SECOND / 20, "Timestamps span the gap");
+
+    drv_gpio_event_destroy(&evq);
+    hal_sim_gpio_inject(20, 0);
+
+    /* both edges keep the level through filtered edges, it is never read back in the handler */
+    TEST_ASSERT(0 == drv_gpio_event_create(64, &evq), "Create queue");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[20], GPIO_PE_BOTH, 0, 50000), "Add both edge pin with filter");
+    hal_sim_gpio_inject(20, 1);
+    hal_sim_gpio_inject(20, 0);
+    hal_sim_gpio_inject(20, 1);
+    TEST_ASSERT(0 == wait_accounted(evq, 3), "Every edge accounted");
+    usleep(60000);
+    hal_sim_gpio_inject(20, 0);
+    TEST_ASSERT(2 == drv_gpio_event_read(evq, ev, 16, 100) && 1 == ev[0].level && 0 == ev[1].level,
+                "Level follows the filtered edges");
+
+    drv_gpio_event_destroy(&evq);
+    hal_sim_gpio_inject(20, 0);
+
+    return 0;
+}
+
+static volatile int cb_count;
+
+static void cb_handler(void* args) { __atomic_add_fetch(&cb_count, 1, __ATOMIC_RELAXED); }
+
+static int test_shared_signal(void)
+{
+    int ok = 1;
+
+    printf("\n=== Testing callback irqs sharing signals ===\n");
+
+    /* nine registrations wrap the signal numbers, pin 0 and pin 8 share one */
+    for (int i = 0; i < 9; i++) {
+        ok &= (0 == drv_gpio_register_irq(pins[i], GPIO_PE_RISING, 0, cb_handler, NULL));
+        ok &= (0 == drv_gpio_enable_irq(pins[i]));
+    }
+    TEST_ASSERT(ok, "Register nine callback irqs");
+    TEST_ASSERT(pins[0]->signo == pins[8]->signo, "Signal shared");
+
+    drv_gpio_unregister_irq(pins[0]);
+    cb_count = 0;
+    hal_sim_gpio_inject(8, 1);
+    for (int i = 0; (i < 100) && !cb_count; i++) {
+        usleep(1000);
+    }
+    TEST_ASSERT(1 == cb_count, "Unregistering one pin keeps the other delivering");
+
+    for (int i = 0; i < 9; i++) {
+        drv_gpio_unregister_irq(pins[i]);
+    }
+    hal_sim_gpio_inject(8, 0);
+
+    return 0;
+}
+
+static int test_destroy_pending(void)
+{
+    drv_gpio_event_t*  evq   = NULL;
+    drv_gpio_event_t*  other = NULL;
+    gpio_event_t       ev[SMALL_DEPTH];
+    gpio_event_stats_t st;
+    sigset_t           set, old;
+    int                n;
+
+    printf("\n=== Testing destroy with edges still queued ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_event_create(SMALL_DEPTH, &evq), "Create queue");
+    TEST_ASSERT(0 == drv_gpio_event_create(SMALL_DEPTH, &other), "Create second queue");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[30], GPIO_PE_BOTH, 0, 0), "Add pin to first queue");
+    TEST_ASSERT(0 == drv_gpio_event_add(other, pins[31], GPIO_PE_BOTH, 0, 0), "Add pin to second queue");
+
+    /* keep the edge signals pending, this is the only thread taking them */
+    sigemptyset(&set);
+    for (int sig = SIGRTMIN; sig <= SIGRTMAX; sig++) {
+        sigaddset(&set, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    for (int i = 0; i < 4; i++) {
+        hal_sim_gpio_inject(30, !(i & 1));
+        hal_sim_gpio_inject(31, !(i & 1));
+    }
+    drv_gpio_event_destroy(&evq);
+
+    /* the slab hands the same memory to the next queue */
+    TEST_ASSERT(0 == drv_gpio_event_create(SMALL_DEPTH, &evq), "Create queue again");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[30], GPIO_PE_BOTH, 0, 0), "Add the same pin again");
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    n = drv_gpio_event_read(evq, ev, SMALL_DEPTH, 10);
+    drv_gpio_event_get_stats(evq, &st);
+    TEST_ASSERT(0 == n && 0 == st.events, "Edges queued for a destroyed queue are dropped");
+
+    n = drv_gpio_event_read(other, ev, SMALL_DEPTH, 10);
+    TEST_ASSERT(4 == n && 31 == ev[0].pin, "Edges of other queues still delivered");
+
+    drv_gpio_event_destroy(&evq);
+    drv_gpio_event_destroy(&other);
+    hal_sim_gpio_inject(30, 0);
+    hal_sim_gpio_inject(31, 0);
+
+    return 0;
+}
+
+static int test_stale_generation(void)
+{
+    drv_gpio_event_t*  evq = NULL;
+    gpio_event_t       ev[SMALL_DEPTH];
+    sigset_t           set, old;
+
+    printf("\n=== Testing edges queued before a pin was re-added ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_event_create(SMALL_DEPTH, &evq), "Create queue");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[40], GPIO_PE_RISING, 0, 0), "Add pin");
+
+    sigemptyset(&set);
+    for (int sig = SIGRTMIN; sig <= SIGRTMAX; sig++) {
+        sigaddset(&set, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    hal_sim_gpio_inject(40, 1);
+    hal_sim_gpio_inject(40, 0);
+    hal_sim_gpio_inject(40, 1);
+
+    /* same queue, same slot, only the generation tells the old signals apart */
+    TEST_ASSERT(0 == drv_gpio_event_remove(evq, pins[40]), "Remove pin with edges pending");
+    TEST_ASSERT(0 == drv_gpio_event_add(evq, pins[40], GPIO_PE_FALLING, 0, 0), "Add it back");
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    TEST_ASSERT(0 == drv_gpio_event_read(evq, ev, SMALL_DEPTH, 10), "Edges of the old registration dropped");
+
+    hal_sim_gpio_inject(40, 0);
+    TEST_ASSERT(1 == drv_gpio_event_read(evq, ev, SMALL_DEPTH, 100) && 40 == ev[0].pin && 0 == ev[0].level,
+                "New registration delivers");
+
+    drv_gpio_event_destroy(&evq);
+
+    return 0;
+}
+
+static int bench(int rounds)
+{
+    drv_gpio_event_t*  evq = NULL;
+    gpio_event_t       ev[QUEUE_DEPTH];
+    gpio_event_stats_t st;
+    uint64_t           start, total = 0, batches = 0;
+    int                n;
+
+    printf("\n=== Event benchmark, %d edges on each of 64 pins ===\n", rounds);
+
+    TEST_ASSERT(0 == drv_gpio_event_create(QUEUE_DEPTH, &evq), "Create queue");
+    for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+        drv_gpio_event_add(evq, pins[i], GPIO_PE_BOTH, 0, 0);
+    }
+
+    start = utils_cpu_ticks();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < GPIO_IRQ_MAX_NUM; i++) {
+            hal_sim_gpio_inject(i, !(r & 1));
+        }
+        while (0 < (n = drv_gpio_event_read(evq, ev, QUEUE_DEPTH, 0))) {
+            total += n;
+            batches++;
+        }
+    }
+    wait_accounted(evq, (uint64_t)rounds * GPIO_IRQ_MAX_NUM);
+    while (0 < (n = drv_gpio_event_read(evq, ev, QUEUE_DEPTH, 10))) {
+        total += n;
+        batches++;
+    }
+    start = utils_cpu_ticks() - start;
+
+    drv_gpio_event_get_stats(evq, &st);
+    printf("events %llu, overflows %llu, batches %llu, max depth %u, %llu ns/edge\n", (unsigned long long)total,
+           (unsigned long long)st.overflows, (unsigned long long)batches, st.max_depth,
+           (unsigned long long)(start * 1000000000ULL / CPU_TICKS_PER_SECOND / (total ? total : 1)));
+    TEST_ASSERT((uint64_t)rounds * GPIO_IRQ_MAX_NUM == total + st.overflows, "No edge unaccounted");
+
+    drv_gpio_event_destroy(&evq);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = (1 < argc) ? atoi(argv[1]) : DFT_ROUNDS;
+
+    printf("Starting GPIO Event Tests\n");
+
+    if (0x00 == setup_pins()) {
+        test_all_pins();
+        test_overflow();
+        test_filter();
+        test_shared_signal();
+        test_destroy_pending();
+        test_stale_generation();
+        bench((0 < rounds) ? rounds : DFT_ROUNDS);
+    }
+    release_pins();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_gpio.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_gpio_port [first_pin] [loops]
+ *
+ * Pins first_pin..first_pin+31 are muxed to GPIO and driven as outputs, only
+ * run it where nothing else is wired to them. The benchmark toggles 1, 8 and
+ * 32 pins @loops times, once through per-pin instances and once through a
+ * port, and reports the cost of one update of all pins.
+ */
+
+#define DFT_FIRST_PIN (32)
+#define DFT_LOOPS     (10000)
+#define BENCH_MAX     (32)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static uint64_t pin_mask(int first, int count)
+{
+    return ((64 == count) ? ~0ULL : ((1ULL << count) - 1)) << first;
+}
+
+static void mux_pins(int first, int count)
+{
+    for (int i = first; i < first + count; i++) {
+        drv_fpioa_set_pin_func(i, GPIO0 + i);
+    }
+}
+
+/* lowest free descriptor, the next one open() hands out */
+static int next_fd(void)
+{
+    int fd = dup(0);
+
+    if (0 <= fd) {
+        close(fd);
+    }
+
+    return fd;
+}
+
+/* run first, the device must not be open yet */
+static int test_reopen(int first)
+{
+    drv_gpio_port_t* port = NULL;
+    uint64_t         mask = pin_mask(first, 8);
+    uint64_t         value;
+    int              fd;
+
+    printf("\n=== Testing device open, close and reopen ===\n");
+
+    /* the fpioa device stays open once used */
+    mux_pins(first, 8);
+    fd = next_fd();
+    TEST_ASSERT(0 == drv_gpio_port_create(mask, GPIO_DM_OUTPUT, &port), "Open with the first port");
+    TEST_ASSERT(fd != next_fd(), "Device holds a descriptor");
+    drv_gpio_port_destroy(&port);
+    TEST_ASSERT(fd == next_fd(), "Last close releases the descriptor");
+
+    TEST_ASSERT(0 == drv_gpio_port_create(mask, GPIO_DM_OUTPUT, &port), "Reopen with a new port");
+    TEST_ASSERT(0 == drv_gpio_port_write(port, mask, 0x5AULL << first)
+                    && 0 == drv_gpio_port_read(port, mask, &value) && (0x5AULL << first) == value,
+                "Reopened device works");
+    drv_gpio_port_destroy(&port);
+    TEST_ASSERT(fd == next_fd(), "Closed again");
+
+    return 0;
+}
+
+static int test_port_ops(int first)
+{
+    drv_gpio_port_t* port = NULL;
+    uint64_t         mask = pin_mask(first, 8);
+    uint64_t         value;
+
+    printf("\n=== Testing port operations on GPIO%d~GPIO%d ===\n", first, first + 7);
+
+    mux_pins(first, 8);
+    TEST_ASSERT(0 == drv_gpio_port_create(mask, GPIO_DM_OUTPUT, &port), "Create 8 pin port");
+    printf("port requests %s\n", port->native ? "go to the kernel in one call" : "are emulated per pin");
+
+    TEST_ASSERT(0 == drv_gpio_port_write(port, mask, 0xA5ULL << first), "Write 0xA5");
+    TEST_ASSERT(0 == drv_gpio_port_read(port, mask, &value) && (0xA5ULL << first) == value, "Read back 0xA5");
+
+    TEST_ASSERT(0 == drv_gpio_port_set(port, 0x0FULL << first), "Set low nibble");
+    TEST_ASSERT(0 == drv_gpio_port_read(port, mask, &value) && (0xAFULL << first) == value, "Read back 0xAF");
+
+    TEST_ASSERT(0 == drv_gpio_port_clear(port, 0xF0ULL << first), "Clear high nibble");
+    TEST_ASSERT(0 == drv_gpio_port_read(port, mask, &value) && (0x0FULL << first) == value, "Read back 0x0F");
+
+    TEST_ASSERT(0 == drv_gpio_port_toggle(port, mask), "Toggle all");
+    TEST_ASSERT(0 == drv_gpio_port_read(port, mask, &value) && (0xF0ULL << first) == value, "Read back 0xF0");
+
+    TEST_ASSERT(0 == drv_gpio_port_write(port, 0x3CULL << first, 0x55ULL << first), "Masked write");
+    TEST_ASSERT(0 == drv_gpio_port_read(port, mask, &value) && (0xD4ULL << first) == value, "Only masked pins changed");
+
+    TEST_ASSERT(0 == drv_gpio_port_read(port, 0x01ULL << first, &value) && 0 == value, "Read subset");
+    TEST_ASSERT(0 != drv_gpio_port_set(port, 1ULL << (first + 8)), "Pin outside the port rejected");
+    TEST_ASSERT(0 != drv_gpio_port_set(port, 0), "Empty mask rejected");
+
+    drv_gpio_port_destroy(&port);
+    TEST_ASSERT(NULL == port, "Destroy port");
+
+    return 0;
+}
+
+static int bench(int first, int loops)
+{
+    static const int counts[] = { 1, 8, 32 };
+    drv_gpio_inst_t* pins[BENCH_MAX] = { NULL };
+    drv_gpio_port_t* port = NULL;
+    uint64_t         start, t_pin, t_port;
+
+    printf("\n=== Toggle benchmark, %d updates ===\n", loops);
+    printf("pins  per-pin ns/update  port ns/update  speedup\n");
+
+    mux_pins(first, BENCH_MAX);
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int n = counts[c];
+
+        for (int i = 0; i < n; i++) {
+            TEST_ASSERT(0 == drv_gpio_inst_create(first + i, &pins[i]), "Create pin instance");
+            drv_gpio_mode_set(pins[i], GPIO_DM_OUTPUT);
+        }
+        start = utils_cpu_ticks();
+        for (int l = 0; l < loops; l++) {
+            for (int i = 0; i < n; i++) {
+                drv_gpio_toggle(pins[i]);
+            }
+        }
+        t_pin = utils_cpu_ticks() - start;
+        for (int i = 0; i < n; i++) {
+            drv_gpio_inst_destroy(&pins[i]);
+        }
+
+        TEST_ASSERT(0 == drv_gpio_port_create(pin_mask(first, n), GPIO_DM_OUTPUT, &port), "Create port");
+        start = utils_cpu_ticks();
+        for (int l = 0; l < loops; l++) {
+            drv_gpio_port_toggle(port, port->mask);
+        }
+        t_port = utils_cpu_ticks() - start;
+        drv_gpio_port_destroy(&port);
+
+        printf("%4d  %17llu  %14llu  %6.1fx\n", n,
+               (unsigned long long)(t_pin * 1000000000ULL / CPU_TICKS_PER_SECOND / loops),
+               (unsigned long long)(t_port * 1000000000ULL / CPU_TICKS_PER_SECOND / loops),
+               t_port ? (double)t_pin / t_port : 0.0);
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int first = (1 < argc) ? atoi(argv[1]) : DFT_FIRST_PIN;
+    int loops = (2 < argc) ? atoi(argv[2]) : DFT_LOOPS;
+
+    printf("Starting GPIO Port Tests\n");
+
+    if ((0 > first) || (GPIO_PORT_MAX_NUM - BENCH_MAX < first) || (0 >= loops)) {
+        printf("first_pin must be 0~%d and loops positive\n", GPIO_PORT_MAX_NUM - BENCH_MAX);
+        return -1;
+    }
+
+    test_reopen(first);
+    test_port_ops(first);
+    bench(first, loops);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
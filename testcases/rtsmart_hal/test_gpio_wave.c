@@ -0,0 +1,161 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_gpio.h"
+#include "drv_gpio_wave.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_gpio_wave [first_pin] [period_us]
+ *
+ * Pins first_pin..first_pin+7 are muxed to GPIO and driven as outputs, only
+ * run it where nothing else is wired to them. Captures read the outputs back.
+ * The benchmark plays 100 periods of a square wave once through the waveform
+ * engine and once with drv_gpio_value_set() and usleep(), and compares how
+ * late the edges came.
+ */
+
+#define DFT_FIRST_PIN (32)
+#define DFT_PERIOD_US (1000)
+#define BENCH_PERIODS (100)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static void print_result(const char* name, const gpio_wave_result_t* res)
+{
+    printf("%s: %u requests, %u captures, elapsed %llu ns of %llu, late max %llu ns (entry %u) mean %llu ns, "
+           "request max %llu ns\n",
+           name, res->steps, res->captures, (unsigned long long)res->elapsed_ns, (unsigned long long)res->duration_ns,
+           (unsigned long long)res->late_ns_max, res->worst_step, (unsigned long long)res->late_ns_mean,
+           (unsigned long long)res->request_ns_max);
+}
+
+static int test_schedule(int first)
+{
+    drv_gpio_port_t*   port = NULL;
+    drv_gpio_wave_t*   wave = NULL;
+    gpio_wave_result_t res;
+    uint64_t           mask = 0xFFULL << first;
+    uint64_t           samples[8];
+
+    printf("\n=== Testing schedule on GPIO%d~GPIO%d ===\n", first, first + 7);
+
+    for (int i = first; i < first + 8; i++) {
+        drv_fpioa_set_pin_func(i, GPIO0 + i);
+    }
+    TEST_ASSERT(0 == drv_gpio_port_create(mask, GPIO_DM_OUTPUT, &port), "Create port");
+    TEST_ASSERT(0 == drv_gpio_wave_create(port, 16, &wave), "Create schedule");
+
+    /* added out of order, the two writes at 20us merge into one request */
+    TEST_ASSERT(0 == drv_gpio_wave_add_capture(wave, 30000, mask), "Add capture");
+    TEST_ASSERT(0 == drv_gpio_wave_add_write(wave, 20000, 0x0FULL << first, 0x05ULL << first), "Add low nibble write");
+    TEST_ASSERT(0 == drv_gpio_wave_add_write(wave, 0, mask, 0), "Add clear");
+    TEST_ASSERT(0 == drv_gpio_wave_add_write(wave, 20000, 0xF0ULL << first, 0xA0ULL << first), "Add high nibble write");
+    TEST_ASSERT(0 == drv_gpio_wave_add_capture(wave, 10000, mask), "Add early capture");
+    TEST_ASSERT(0 == drv_gpio_wave_add_write(wave, 40000, 0x01ULL << first, 0), "Add late write");
+    TEST_ASSERT(0 == drv_gpio_wave_add_capture(wave, 40000, mask), "Add capture after write at same time");
+    TEST_ASSERT(0 != drv_gpio_wave_add_write(wave, 0, 1ULL << (first + 8), 0), "Pin outside the port rejected");
+
+    TEST_ASSERT(0 == drv_gpio_wave_compile(wave) && 6 == wave->num_steps, "Compile merges the writes");
+    TEST_ASSERT(0 != drv_gpio_wave_add_write(wave, 50000, mask, 0), "Compiled schedule is closed");
+
+    TEST_ASSERT(0 == drv_gpio_wave_run(wave, samples, 8, &res), "Run schedule");
+    print_result("schedule", &res);
+    TEST_ASSERT(6 == res.steps && 3 == res.captures, "Every entry ran");
+    TEST_ASSERT(0 == samples[0], "Capture before the writes");
+    TEST_ASSERT((0xA5ULL << first) == samples[1], "Merged write captured");
+    TEST_ASSERT((0xA4ULL << first) == samples[2], "Capture follows the write due with it");
+    TEST_ASSERT(res.elapsed_ns >= res.duration_ns && 40000 == res.duration_ns, "Timing reported");
+
+    TEST_ASSERT(0 == drv_gpio_wave_run(wave, samples, 1, &res) && 1 == res.captures, "Rerun keeps samples bounded");
+
+    TEST_ASSERT(0 == drv_gpio_wave_clear(wave) && 0 == drv_gpio_wave_add_write(wave, 0, mask, mask), "Clear reopens");
+
+    drv_gpio_wave_destroy(&wave);
+    TEST_ASSERT(NULL == wave, "Destroy schedule");
+    drv_gpio_port_destroy(&port);
+
+    return 0;
+}
+
+static int bench(int first, int period_us)
+{
+    drv_gpio_port_t*   port = NULL;
+    drv_gpio_inst_t*   pin  = NULL;
+    drv_gpio_wave_t*   wave = NULL;
+    gpio_wave_result_t res;
+    uint64_t           bit   = 1ULL << first;
+    uint64_t           half  = (uint64_t)period_us * 500;
+    uint64_t           start, due, late, late_max = 0, late_sum = 0;
+
+    printf("\n=== Square wave benchmark, %d periods of %d us ===\n", BENCH_PERIODS, period_us);
+
+    drv_fpioa_set_pin_func(first, GPIO0 + first);
+    TEST_ASSERT(0 == drv_gpio_port_create(bit, GPIO_DM_OUTPUT, &port), "Create port");
+    TEST_ASSERT(0 == drv_gpio_wave_create(port, BENCH_PERIODS * 2, &wave), "Create schedule");
+    for (int i = 0; i < BENCH_PERIODS * 2; i++) {
+        drv_gpio_wave_add_write(wave, i * half, bit, (i & 1) ? 0 : bit);
+    }
+    TEST_ASSERT(0 == drv_gpio_wave_run(wave, NULL, 0, &res), "Run square wave");
+    print_result("engine", &res);
+    drv_gpio_wave_destroy(&wave);
+    drv_gpio_port_destroy(&port);
+
+    TEST_ASSERT(0 == drv_gpio_inst_create(first, &pin), "Create pin instance");
+    drv_gpio_mode_set(pin, GPIO_DM_OUTPUT);
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_PERIODS * 2; i++) {
+        due  = start + (uint64_t)i * half * CPU_TICKS_PER_SECOND / 1000000000ULL;
+        late = utils_cpu_ticks() - due;
+        drv_gpio_value_set(pin, (i & 1) ? GPIO_PV_LOW : GPIO_PV_HIGH);
+        late_sum += late;
+        late_max = (late > late_max) ? late : late_max;
+        usleep(period_us / 2);
+    }
+    drv_gpio_inst_destroy(&pin);
+
+    printf("usleep: late max %llu ns mean %llu ns\n",
+           (unsigned long long)(late_max * 1000000000ULL / CPU_TICKS_PER_SECOND),
+           (unsigned long long)(late_sum / (BENCH_PERIODS * 2) * 1000000000ULL / CPU_TICKS_PER_SECOND));
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int first     = (1 < argc) ? atoi(argv[1]) : DFT_FIRST_PIN;
+    int period_us = (2 < argc) ? atoi(argv[2]) : DFT_PERIOD_US;
+
+    printf("Starting GPIO Waveform Tests\n");
+
+    if ((0 > first) || (GPIO_PORT_MAX_NUM - 8 < first) || (2 > period_us)) {
+        printf("first_pin must be 0~%d and period_us at least 2\n", GPIO_PORT_MAX_NUM - 8);
+        return -1;
+    }
+
+    test_schedule(first);
+    bench(first, period_us);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,583 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_gpio.h"
+#include "drv_timer.h"
+#include "hal_dispatch.h"
+#include "hal_utils.h"
+
+/*
+ * cyclictest-style wakeup latency analyzer for the HAL callback paths.
+ *
+ * Usage: test_irq_latency [options]
+ *   -m <mode>     hres   soft timer, nanosecond period, absolute deadlines (default)
+ *                 soft   soft timer, millisecond period on the timing wheel
+ *                 posix  POSIX timer on CLOCK_MONOTONIC, TIMER_ABSTIME, signal delivery
+ *                 hard   hard timer 0
+ *                 gpio   GPIO loopback, -g <out>,<in> pins wired together
+ *   -i <us>       interval, default 1000 (soft/hard round it to milliseconds)
+ *   -l <loops>    samples, default 1000
+ *   -d <mode>     signal|thread irq delivery for hard and gpio, default signal
+ *   -S <load>     stress while measuring, any of cpu,mem,io separated by commas
+ *   -j <threads>  stress threads per load, default 2
+ *   -H <us>       histogram range, default 200
+ *   -g <out,in>   loopback pins for -m gpio
+ *
+ * hres, posix and gpio know the exact deadline (or edge time) of every
+ * event and report true latency. soft and hard timers are armed relative to
+ * an instant the tool can not observe, their latency is measured against the
+ * schedule anchored at the first expiry, so it shows jitter rather than the
+ * absolute offset.
+ *
+ * Only hres, soft and posix need no hardware, they run on a Linux host too.
+ */
+
+#define DFT_INTERVAL_US (1000)
+#define DFT_LOOPS       (1000)
+#define DFT_HIST_US     (200)
+#define DFT_STRESS_JOBS (2)
+#define STRESS_MEM_SIZE (8 * 1024 * 1024)
+#define STRESS_IO_FILE  "irq_latency.io"
+#define POSIX_TIMER_SIG (SIGRTMAX - 2) /* clear of the timer and gpio driver signals */
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct latency_ctx {
+    const char*         mode;
+    uint64_t            interval_ns;
+    int                 loops;
+    int                 anchored; /* latency against the first expiry, deadline unknown */
+    hal_dispatch_mode_t dispatch;
+
+    uint64_t            start_ns; /* first deadline when known */
+    atomic_int          count;
+    uint32_t            overruns;
+    int64_t*            samples;
+
+    /* mode specific handles */
+    drv_soft_timer_inst_t* soft;
+    timer_t                posix;
+    drv_gpio_inst_t*       gpio_out;
+    volatile uint64_t      edge_ns;
+};
+
+static struct latency_ctx ctx;
+static volatile int       stress_running;
+
+/** sample recording **********************************************************/
+static void record(uint64_t now_ns, uint32_t overruns)
+{
+    int      n = atomic_load_explicit(&ctx.count, memory_order_relaxed);
+    uint64_t expected;
+
+    if (n >= ctx.loops) {
+        return;
+    }
+
+    ctx.overruns = overruns;
+    if (ctx.anchored && (0 == n)) {
+        ctx.start_ns = now_ns;
+    }
+    expected       = ctx.start_ns + (uint64_t)(n + overruns) * ctx.interval_ns;
+    ctx.samples[n] = (int64_t)(now_ns - expected);
+    atomic_store_explicit(&ctx.count, n + 1, memory_order_release);
+}
+
+static void soft_callback(void* args)
+{
+    (void)args;
+    record(utils_cpu_ticks_ns(), drv_soft_timer_get_overrun(ctx.soft));
+}
+
+static void hard_callback(void* args)
+{
+    (void)args;
+    record(utils_cpu_ticks_ns(), 0);
+}
+
+static void posix_handler(int sig, siginfo_t* si, void* uc)
+{
+    static uint32_t overruns;
+
+    (void)sig;
+    (void)si;
+    (void)uc;
+
+    overruns += timer_getoverrun(ctx.posix);
+    record(utils_cpu_ticks_ns(), overruns);
+}
+
+/* the driving timer toggles the output, the input irq measures how long the edge took to reach us */
+static void gpio_toggle_callback(void* args)
+{
+    (void)args;
+    ctx.edge_ns = utils_cpu_ticks_ns();
+    drv_gpio_toggle(ctx.gpio_out);
+}
+
+static void gpio_edge_callback(void* args)
+{
+    uint64_t now = utils_cpu_ticks_ns();
+    int      n   = atomic_load_explicit(&ctx.count, memory_order_relaxed);
+
+    (void)args;
+
+    if (n < ctx.loops) {
+        ctx.samples[n] = (int64_t)(now - ctx.edge_ns);
+        atomic_store_explicit(&ctx.count, n + 1, memory_order_release);
+    }
+}
+
+/** stress load ***************************************************************/
+static void* stress_cpu(void* args)
+{
+    volatile double x = 1.0;
+
+    (void)args;
+    while (stress_running) {
+        for (int i = 0; i < 100000; i++) {
+            x = x * 1.0000001 + 0.5;
+        }
+    }
+
+    return NULL;
+}
+
+static void* stress_mem(void* args)
+{
+    uint8_t* a = malloc(STRESS_MEM_SIZE);
+    uint8_t* b = malloc(STRESS_MEM_SIZE);
+
+    (void)args;
+    if (a && b) {
+        memset(a, 0x5a, STRESS_MEM_SIZE);
+        while (stress_running) {
+            memcpy(b, a, STRESS_MEM_SIZE);
+            memcpy(a, b, STRESS_MEM_SIZE);
+        }
+    }
+    free(a);
+    free(b);
+
+    return NULL;
+}
+
+static void* stress_io(void* args)
+{
+    char    path[64];
+    uint8_t buf[4096];
+    int     fd;
+
+    snprintf(path, sizeof(path), STRESS_IO_FILE ".%d", (int)(intptr_t)args);
+    memset(buf, 0xa5, sizeof(buf));
+
+    while (stress_running) {
+        if (0 > (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644))) {
+            break;
+        }
+        for (int i = 0; (i < 256) && stress_running; i++) {
+            if (sizeof(buf) != write(fd, buf, sizeof(buf))) {
+                break;
+            }
+        }
+        fsync(fd);
+        close(fd);
+    }
+    unlink(path);
+
+    return NULL;
+}
+
+static int stress_start(const char* loads, int jobs, pthread_t* threads, int max_threads)
+{
+    int cnt = 0;
+
+    if (NULL == loads) {
+        return 0;
+    }
+
+    stress_running = 1;
+    for (int j = 0; j < jobs; j++) {
+        if (strstr(loads, "cpu") && (cnt < max_threads)) {
+            pthread_create(&threads[cnt++], NULL, stress_cpu, NULL);
+        }
+        if (strstr(loads, "mem") && (cnt < max_threads)) {
+            pthread_create(&threads[cnt++], NULL, stress_mem, NULL);
+        }
+        if (strstr(loads, "io") && (cnt < max_threads)) {
+            pthread_create(&threads[cnt++], NULL, stress_io, (void*)(intptr_t)j);
+        }
+    }
+    printf("stress: %s, %d threads\n", loads, cnt);
+
+    return cnt;
+}
+
+static void stress_stop(pthread_t* threads, int cnt)
+{
+    stress_running = 0;
+    for (int i = 0; i < cnt; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/** measurement backends ******************************************************/
+static int arm_soft(int hres)
+{
+    struct timespec ts;
+
+    if (0 != drv_soft_timer_create(&ctx.soft)) {
+        return -1;
+    }
+    drv_soft_timer_set_mode(ctx.soft, HWTIMER_MODE_PERIOD);
+    drv_soft_timer_register_irq(ctx.soft, soft_callback, NULL);
+
+    if (!hres) {
+        ctx.anchored = 1;
+        drv_soft_timer_set_period(ctx.soft, (int)(ctx.interval_ns / 1000000ULL));
+        return drv_soft_timer_start(ctx.soft);
+    }
+
+    drv_soft_timer_set_period_ns(ctx.soft, ctx.interval_ns);
+    ctx.start_ns = utils_cpu_ticks_ns() + 10000000ULL;
+
+    /* utils_cpu_ticks_ns() and CLOCK_MONOTONIC have different origins, convert the deadline */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t mono = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec + (ctx.start_ns - utils_cpu_ticks_ns());
+    ts.tv_sec     = mono / 1000000000ULL;
+    ts.tv_nsec    = mono % 1000000000ULL;
+
+    return drv_soft_timer_start_abs(ctx.soft, &ts);
+}
+
+static void disarm_soft(void)
+{
+    if (NULL == ctx.soft) {
+        return;
+    }
+    drv_soft_timer_stop(ctx.soft);
+    drv_soft_timer_destroy(&ctx.soft);
+}
+
+static int arm_posix(void)
+{
+    struct sigaction  sa;
+    struct sigevent   sev;
+    struct itimerspec its;
+    struct timespec   ts;
+    uint64_t          mono;
+
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_flags     = SA_SIGINFO;
+    sa.sa_sigaction = posix_handler;
+    sigemptyset(&sa.sa_mask);
+    if (0 != sigaction(POSIX_TIMER_SIG, &sa, NULL)) {
+        return -1;
+    }
+
+    memset(&sev, 0x00, sizeof(sev));
+    sev.sigev_notify          = SIGEV_SIGNAL;
+    sev.sigev_signo           = POSIX_TIMER_SIG;
+    sev.sigev_value.sival_ptr = &ctx;
+    if (0 != timer_create(CLOCK_MONOTONIC, &sev, &ctx.posix)) {
+        return -1;
+    }
+
+    ctx.start_ns = utils_cpu_ticks_ns() + 10000000ULL;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    mono = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec + (ctx.start_ns - utils_cpu_ticks_ns());
+
+    its.it_value.tv_sec     = mono / 1000000000ULL;
+    its.it_value.tv_nsec    = mono % 1000000000ULL;
+    its.it_interval.tv_sec  = ctx.interval_ns / 1000000000ULL;
+    its.it_interval.tv_nsec = ctx.interval_ns % 1000000000ULL;
+
+    return timer_settime(ctx.posix, TIMER_ABSTIME, &its, NULL);
+}
+
+static void disarm_posix(void)
+{
+    timer_delete(ctx.posix);
+    signal(POSIX_TIMER_SIG, SIG_IGN);
+}
+
+static drv_hard_timer_inst_t* hard_timer;
+
+static int arm_hard(void)
+{
+    ctx.anchored = 1;
+
+    if (0 != drv_hard_timer_inst_create(0, &hard_timer)) {
+        return -1;
+    }
+    drv_hard_timer_set_mode(hard_timer, HWTIMER_MODE_PERIOD);
+    drv_hard_timer_set_period(hard_timer, (uint32_t)(ctx.interval_ns / 1000000ULL));
+    drv_hard_timer_set_dispatch(hard_timer, ctx.dispatch);
+    drv_hard_timer_register_irq(hard_timer, hard_callback, NULL);
+
+    return drv_hard_timer_start(hard_timer);
+}
+
+static void disarm_hard(void)
+{
+    drv_hard_timer_stop(hard_timer);
+    drv_hard_timer_unregister_irq(hard_timer);
+    drv_hard_timer_inst_destroy(&hard_timer);
+}
+
+static drv_gpio_inst_t* gpio_in;
+
+static int arm_gpio(int out_pin, int in_pin)
+{
+    if ((0 > out_pin) || (0 > in_pin)) {
+        printf("gpio mode needs -g <out>,<in>\n");
+        return -1;
+    }
+
+    if ((0 != drv_gpio_inst_create(out_pin, &ctx.gpio_out)) || (0 != drv_gpio_inst_create(in_pin, &gpio_in))) {
+        return -1;
+    }
+    drv_gpio_mode_set(ctx.gpio_out, GPIO_DM_OUTPUT);
+    drv_gpio_value_set(ctx.gpio_out, GPIO_PV_LOW);
+    drv_gpio_mode_set(gpio_in, GPIO_DM_INPUT);
+    drv_gpio_set_dispatch(gpio_in, ctx.dispatch);
+    if (0 != drv_gpio_register_irq(gpio_in, GPIO_PE_BOTH, 10, gpio_edge_callback, NULL)) {
+        return -1;
+    }
+    drv_gpio_enable_irq(gpio_in);
+
+    if (0 != drv_soft_timer_create(&ctx.soft)) {
+        return -1;
+    }
+    drv_soft_timer_set_mode(ctx.soft, HWTIMER_MODE_PERIOD);
+    drv_soft_timer_set_period_ns(ctx.soft, ctx.interval_ns);
+    drv_soft_timer_register_irq(ctx.soft, gpio_toggle_callback, NULL);
+
+    return drv_soft_timer_start(ctx.soft);
+}
+
+static void disarm_gpio(void)
+{
+    disarm_soft();
+    drv_gpio_disable_irq(gpio_in);
+    drv_gpio_unregister_irq(gpio_in);
+    drv_gpio_inst_destroy(&gpio_in);
+    drv_gpio_inst_destroy(&ctx.gpio_out);
+}
+
+/** report ********************************************************************/
+static int cmp_sample(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static void report(int n, int hist_us)
+{
+    int64_t   min, max, sum = 0;
+    uint64_t* hist;
+    uint64_t  over = 0;
+
+    if (0 == n) {
+        return;
+    }
+
+    if (ctx.anchored) {
+        /* the anchor itself may have been late, shift so the best sample is zero */
+        min = ctx.samples[0];
+        for (int i = 1; i < n; i++) {
+            min = (ctx.samples[i] < min) ? ctx.samples[i] : min;
+        }
+        for (int i = 0; i < n; i++) {
+            ctx.samples[i] -= min;
+        }
+    }
+
+    qsort(ctx.samples, n, sizeof(ctx.samples[0]), cmp_sample);
+    min = ctx.samples[0];
+    max = ctx.samples[n - 1];
+    for (int i = 0; i < n; i++) {
+        sum += ctx.samples[i];
+    }
+
+    printf("\n# mode %s, interval %llu us, samples %d, overruns %u%s\n", ctx.mode,
+           (unsigned long long)(ctx.interval_ns / 1000), n, ctx.overruns, ctx.anchored ? ", anchored at first expiry" : "");
+    printf("# latency us: min %.1f avg %.1f max %.1f\n", min / 1000.0, sum / 1000.0 / n, max / 1000.0);
+    printf("# percentile us: p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f\n", ctx.samples[n / 2] / 1000.0,
+           ctx.samples[(int)(n * 0.9)] / 1000.0, ctx.samples[(int)(n * 0.99)] / 1000.0,
+           ctx.samples[(int)(n * 0.999)] / 1000.0);
+
+    hist = calloc(hist_us, sizeof(*hist));
+    if (NULL == hist) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        int64_t us = ctx.samples[i] / 1000;
+
+        if (us < 0) {
+            us = 0;
+        }
+        if (us >= hist_us) {
+            over++;
+        } else {
+            hist[us]++;
+        }
+    }
+
+    printf("# histogram: latency us, count\n");
+    for (int i = 0; i < hist_us; i++) {
+        if (hist[i]) {
+            printf("%06d %llu\n", i, (unsigned long long)hist[i]);
+        }
+    }
+    printf("# overflows %llu\n", (unsigned long long)over);
+    free(hist);
+}
+
+static int check_run(int ret, int n)
+{
+    printf("\n");
+    TEST_ASSERT(0 == ret, "Arm measurement source");
+    TEST_ASSERT(n == ctx.loops, "Collected every sample");
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* mode     = "hres";
+    const char* stress   = NULL;
+    int         interval = DFT_INTERVAL_US;
+    int         jobs     = DFT_STRESS_JOBS;
+    int         hist_us  = DFT_HIST_US;
+    int         out_pin = -1, in_pin = -1;
+    int         opt, ret, stress_cnt, n;
+    pthread_t   stress_threads[32];
+    uint64_t    deadline_ms;
+
+    memset(&ctx, 0x00, sizeof(ctx));
+    ctx.loops    = DFT_LOOPS;
+    ctx.dispatch = HAL_DISPATCH_SIGNAL;
+
+    while (-1 != (opt = getopt(argc, argv, "m:i:l:d:S:j:H:g:"))) {
+        switch (opt) {
+        case 'm':
+            mode = optarg;
+            break;
+        case 'i':
+            interval = atoi(optarg);
+            break;
+        case 'l':
+            ctx.loops = atoi(optarg);
+            break;
+        case 'd':
+            ctx.dispatch = strcmp(optarg, "thread") ? HAL_DISPATCH_SIGNAL : HAL_DISPATCH_THREAD;
+            break;
+        case 'S':
+            stress = optarg;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            break;
+        case 'H':
+            hist_us = atoi(optarg);
+            break;
+        case 'g':
+            sscanf(optarg, "%d,%d", &out_pin, &in_pin);
+            break;
+        default:
+            printf("usage: %s [-m hres|soft|posix|hard|gpio] [-i us] [-l loops] [-d signal|thread] "
+                   "[-S cpu,mem,io] [-j threads] [-H us] [-g out,in]\n",
+                   argv[0]);
+            return -1;
+        }
+    }
+
+    if ((0 >= interval) || (0 >= ctx.loops) || (0 >= hist_us)) {
+        printf("invalid arguments\n");
+        return -1;
+    }
+    if (!strcmp(mode, "soft") || !strcmp(mode, "hard")) {
+        /* these paths only take milliseconds */
+        interval = ((interval + 999) / 1000) * 1000;
+    }
+
+    ctx.mode        = mode;
+    ctx.interval_ns = (uint64_t)interval * 1000ULL;
+    ctx.samples     = calloc(ctx.loops, sizeof(ctx.samples[0]));
+    if (NULL == ctx.samples) {
+        printf("malloc samples failed\n");
+        return -1;
+    }
+
+    printf("Starting IRQ Latency Analyzer\n");
+    stress_cnt = stress_start(stress, jobs, stress_threads, sizeof(stress_threads) / sizeof(stress_threads[0]));
+
+    if (!strcmp(mode, "hres")) {
+        ret = arm_soft(1);
+    } else if (!strcmp(mode, "soft")) {
+        ret = arm_soft(0);
+    } else if (!strcmp(mode, "posix")) {
+        ret = arm_posix();
+    } else if (!strcmp(mode, "hard")) {
+        ret = arm_hard();
+    } else if (!strcmp(mode, "gpio")) {
+        ret = arm_gpio(out_pin, in_pin);
+    } else {
+        printf("unknown mode %s\n", mode);
+        ret = -1;
+    }
+
+    if (0 == ret) {
+        /* signals cut usleep short, so wait against the clock rather than counting sleeps */
+        deadline_ms = utils_cpu_ticks_ms() + (uint64_t)ctx.loops * interval / 1000 * 2 + 1000;
+        while ((atomic_load(&ctx.count) < ctx.loops) && (utils_cpu_ticks_ms() < deadline_ms)) {
+            usleep(10000);
+        }
+    }
+
+    if (!strcmp(mode, "hres") || !strcmp(mode, "soft")) {
+        disarm_soft();
+    } else if (!strcmp(mode, "posix")) {
+        disarm_posix();
+    } else if (!strcmp(mode, "hard")) {
+        disarm_hard();
+    } else if (!strcmp(mode, "gpio")) {
+        disarm_gpio();
+    }
+    stress_stop(stress_threads, stress_cnt);
+
+    n = atomic_load(&ctx.count);
+    report(n, hist_us);
+    free(ctx.samples);
+
+    check_run(ret, n);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,203 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_mem_map              run against /dev/mem (read only accesses)
+ *   test_mem_map <file>       run against a file-backed stand-in for /dev/mem,
+ *                             the file is created and offsets are physical addresses
+ */
+
+#define TEST_FILE_SIZE  (64 * UTILS_MEM_PAGE_SIZE)
+#define BENCH_LOOPS     (10000)
+#define CHIPID_REG_ADDR (0x91213300UL)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static int prepare_mem_file(const char* path)
+{
+    int      fd;
+    uint32_t pattern[UTILS_MEM_PAGE_SIZE / sizeof(uint32_t)];
+
+    if (0 > (fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644))) {
+        printf("create %s failed\n", path);
+        return -1;
+    }
+
+    /* each word holds its own offset, so reads can be checked */
+    for (off_t page = 0; page < TEST_FILE_SIZE; page += UTILS_MEM_PAGE_SIZE) {
+        for (size_t i = 0; i < sizeof(pattern) / sizeof(pattern[0]); i++) {
+            pattern[i] = (uint32_t)(page + i * sizeof(uint32_t));
+        }
+        if (sizeof(pattern) != write(fd, pattern, sizeof(pattern))) {
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+
+    return 0;
+}
+
+static int test_file_backed(const char* path)
+{
+    struct utils_mem_map_stats stats;
+    volatile uint32_t *        a, *b, *c, *d;
+
+    printf("\n=== Testing mapping cache on %s ===\n", path);
+
+    TEST_ASSERT(0 == prepare_mem_file(path), "Prepare file-backed memory");
+    TEST_ASSERT(0 == utils_mem_map_set_device(path), "Switch mapping device");
+
+    a = utils_mem_map_get(0x1010, 4);
+    TEST_ASSERT(a != NULL && *a == 0x1010, "Map single register");
+
+    b = utils_mem_map_get(0x1ff0, 16);
+    TEST_ASSERT(b != NULL && *b == 0x1ff0, "Map register on the same page");
+    TEST_ASSERT((uintptr_t)b - (uintptr_t)a == 0xfe0, "Same page shares one mapping");
+
+    c = utils_mem_map_get(0x3ff8, 16);
+    TEST_ASSERT(c != NULL && c[0] == 0x3ff8 && c[2] == 0x4000, "Map range crossing a page boundary");
+
+    utils_mem_map_get_stats(&stats);
+    TEST_ASSERT(stats.regions == 2 && stats.hits == 1 && stats.misses == 2, "Cache statistics after lookups");
+
+    *a = 0xdeadbeef;
+    utils_mem_map_put(a);
+    utils_mem_map_put(b);
+    utils_mem_map_put(c);
+
+    utils_mem_map_get_stats(&stats);
+    TEST_ASSERT(stats.regions == 2 && stats.busy_regions == 0, "Released regions stay cached");
+
+    d = utils_mem_map_get(0x1010, 4);
+    TEST_ASSERT(d == a && *d == 0xdeadbeef, "Idle mapping reused");
+    TEST_ASSERT(0 != utils_mem_map_set_device(NULL), "Switch device refused while mapped");
+    utils_mem_map_put(d);
+
+    utils_mem_map_trim();
+    utils_mem_map_get_stats(&stats);
+    TEST_ASSERT(stats.regions == 0 && stats.mapped_bytes == 0, "Trim unmaps idle regions");
+
+    d = utils_mem_map_get(0x1010, 4);
+    TEST_ASSERT(d != NULL && *d == 0xdeadbeef, "Write reached backing file");
+    utils_mem_map_put(d);
+
+    struct utils_memory_map map = { .fd = -1, .base = NULL };
+    a = utils_map_memory(&map, 0x2204);
+    TEST_ASSERT(a != NULL && *a == 0x2204, "Legacy utils_map_memory");
+    utils_unmap_memory(&map);
+    TEST_ASSERT(map.base == NULL && map.fd == -1, "Legacy utils_unmap_memory");
+
+    utils_mem_map_trim();
+    TEST_ASSERT(0 == utils_mem_map_set_device(NULL), "Restore mapping device");
+
+    return 0;
+}
+
+static int test_dev_mem(void)
+{
+    uint8_t id0[32], id1[32];
+
+    printf("\n=== Testing mapping cache on %s ===\n", UTILS_MEM_DFT_DEV);
+
+    TEST_ASSERT(0 == utils_read_chipid(id0), "Read chip id");
+    TEST_ASSERT(0 == utils_read_chipid(id1), "Read chip id again");
+    TEST_ASSERT(0 == memcmp(id0, id1, sizeof(id0)), "Chip id stable");
+
+    printf("chip id: ");
+    for (size_t i = 0; i < sizeof(id0); i++) {
+        printf("%02x", id0[i]);
+    }
+    printf("\n");
+
+    return 0;
+}
+
+static void bench_map(uint64_t phys)
+{
+    uint64_t          start, cached, uncached;
+    volatile uint32_t sink = 0;
+    int               fd, done;
+    void*             base;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_LOOPS; i++) {
+        volatile uint32_t* reg = utils_mem_map_get(phys, 4);
+        if (NULL == reg) {
+            return;
+        }
+        sink += *reg;
+        utils_mem_map_put(reg);
+    }
+    cached = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (done = 0; done < BENCH_LOOPS; done++) {
+        /* what every register access cost before the cache */
+        if (0 > (fd = open(UTILS_MEM_DFT_DEV, O_RDWR | O_SYNC))) {
+            break;
+        }
+        base = mmap(NULL, UTILS_MEM_PAGE_SIZE, PROT_READ, MAP_SHARED, fd, phys & ~(uint64_t)(UTILS_MEM_PAGE_SIZE - 1));
+        if (MAP_FAILED != base) {
+            sink += *(volatile uint32_t*)((uintptr_t)base + (phys & (UTILS_MEM_PAGE_SIZE - 1)));
+            munmap(base, UTILS_MEM_PAGE_SIZE);
+        }
+        close(fd);
+    }
+    uncached = utils_cpu_ticks() - start;
+
+    printf("\n=== Benchmark (%d register reads) ===\n", BENCH_LOOPS);
+    printf("cached   : %llu ns/read\n",
+           (unsigned long long)(cached * 1000000000ULL / CPU_TICKS_PER_SECOND / BENCH_LOOPS));
+    if (0 == done) {
+        printf("uncached : n/a, open %s failed\n", UTILS_MEM_DFT_DEV);
+    } else {
+        printf("uncached : %llu ns/read (%d reads)\n",
+               (unsigned long long)(uncached * 1000000000ULL / CPU_TICKS_PER_SECOND / done), done);
+    }
+    (void)sink;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret;
+
+    printf("Starting Memory Map Cache Tests\n");
+
+    if (1 < argc) {
+        ret = test_file_backed(argv[1]);
+    } else {
+        ret = test_dev_mem();
+        if (0 == ret) {
+            bench_map(CHIPID_REG_ADDR);
+        }
+    }
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return (ret || test_failed) ? -1 : 0;
+}
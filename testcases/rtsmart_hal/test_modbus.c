@@ -0,0 +1,320 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_modbus.h"
+#include "drv_uart.h"
+#include "hal_sim.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_modbus [rounds]
+ *
+ * Host only: simulated slaves 1~4 answer on uart1, paced at the 115200 baud
+ * the uart is configured with. The benchmark reads 32 small register blocks
+ * per round, once with one transaction per block, once through a coalesced
+ * poll plan, and once the naive way with a fixed sleep between request and
+ * response, and reports transactions and blocks per second.
+ */
+
+#define MODBUS_UART   (1)
+#define FIRST_SLAVE   (1)
+#define NUM_SLAVES    (4)
+#define NUM_REGS      (200)
+#define SIM_BAUD      (115200)
+#define TIMEOUT_MS    (100)
+#define DFT_ROUNDS    (20)
+#define BENCH_ITEMS   (32)
+#define NAIVE_WAIT_US (5000)
+#define GAP_US        (40000) // between the 21ms t1.5 wait and the 45ms a 125 register answer had before
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static struct hal_sim_modbus* slaves = NULL;
+static drv_uart_inst_t*       uart   = NULL;
+static drv_modbus_t*          mb     = NULL;
+
+static void fill_regs(void)
+{
+    for (int s = FIRST_SLAVE; s < FIRST_SLAVE + NUM_SLAVES; s++) {
+        uint16_t* regs = hal_sim_modbus_regs(slaves, s);
+
+        for (int i = 0; i < NUM_REGS; i++) {
+            regs[i] = (s << 8) | i;
+        }
+    }
+}
+
+static int regs_match(uint8_t slave, uint16_t addr, const uint16_t* regs, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (regs[i] != ((slave << 8) | (addr + i))) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int test_helpers(void)
+{
+    const uint8_t req[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+    uint32_t      t15, t35;
+
+    printf("\n=== Testing CRC and frame timing ===\n");
+
+    TEST_ASSERT(0xCDC5 == drv_modbus_crc16(req, sizeof(req)), "CRC of 01 03 00 00 00 0A is C5 CD");
+    TEST_ASSERT(0xFFFF == drv_modbus_crc16(req, 0), "CRC of nothing is the seed");
+
+    drv_modbus_frame_timing(9600, &t15, &t35);
+    TEST_ASSERT(1719 == t15 && 4011 == t35, "9600 baud: t1.5 and t3.5 from the character time");
+    drv_modbus_frame_timing(19200, &t15, &t35);
+    TEST_ASSERT(860 == t15 && 2006 == t35, "19200 baud still character based");
+    drv_modbus_frame_timing(115200, &t15, &t35);
+    TEST_ASSERT(750 == t15 && 1750 == t35, "Fixed silences above 19200 baud");
+
+    TEST_ASSERT(0 == drv_modbus_create(uart, TIMEOUT_MS, &mb), "Create master");
+    TEST_ASSERT(SIM_BAUD == mb->baud_rate && 750 == mb->t15_us && 1750 == mb->t35_us, "Timing from the uart config");
+
+    return 0;
+}
+
+static int test_transactions(void)
+{
+    uint16_t regs[MODBUS_MAX_READ_REGS], values[3] = { 0x1111, 0x2222, 0x3333 };
+
+    printf("\n=== Testing transactions ===\n");
+
+    fill_regs();
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 2, MODBUS_FC_READ_HOLDING, 10, 8, regs), "Read holding registers");
+    TEST_ASSERT(regs_match(2, 10, regs, 8), "Holding register values");
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 4, MODBUS_FC_READ_INPUT, 0, 125, regs), "Read 125 input registers");
+    TEST_ASSERT(regs_match(4, 0, regs, 125), "Input register values");
+
+    TEST_ASSERT(0 == drv_modbus_write_register(mb, 1, 5, 0xBEEF), "Write single register");
+    TEST_ASSERT(0xBEEF == hal_sim_modbus_regs(slaves, 1)[5], "Slave got the value");
+    TEST_ASSERT(0 == drv_modbus_write_registers(mb, 3, 20, 3, values), "Write multiple registers");
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 3, MODBUS_FC_READ_HOLDING, 20, 3, regs)
+                    && 0 == memcmp(regs, values, sizeof(values)),
+                "Read back written registers");
+
+    TEST_ASSERT(0 == drv_modbus_write_register(mb, 0, 7, 0x0707), "Broadcast write returns at once");
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 4, MODBUS_FC_READ_HOLDING, 7, 1, regs) && 0x0707 == regs[0],
+                "Broadcast reached the slaves");
+
+    TEST_ASSERT(MODBUS_ERR_EXCEPTION == drv_modbus_read_registers(mb, 1, MODBUS_FC_READ_HOLDING, 190, 20, regs)
+                    && 0x02 == mb->exception,
+                "Illegal address exception");
+    TEST_ASSERT(MODBUS_ERR_PARAM == drv_modbus_read_registers(mb, 1, MODBUS_FC_READ_HOLDING, 0, 126, regs),
+                "Too many registers refused");
+    TEST_ASSERT(MODBUS_ERR_PARAM == drv_modbus_read_registers(mb, 1, MODBUS_FC_WRITE_SINGLE, 0, 1, regs),
+                "Read with a write function refused");
+
+    /* t3.5 plus the line time of the rest would still wait this out, t1.5 does not */
+    fill_regs();
+    hal_sim_modbus_set_gap(slaves, 20, GAP_US);
+    TEST_ASSERT(MODBUS_ERR_FRAME == drv_modbus_read_registers(mb, 4, MODBUS_FC_READ_INPUT, 0, 125, regs),
+                "Silence over t1.5 inside the answer breaks the frame");
+    hal_sim_modbus_set_gap(slaves, 0, 0);
+    usleep(2 * GAP_US);
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 4, MODBUS_FC_READ_INPUT, 0, 125, regs) && regs_match(4, 0, regs, 125),
+                "Next answer without the gap");
+
+    hal_sim_modbus_set_dead(slaves, 2, 1);
+    TEST_ASSERT(MODBUS_ERR_TIMEOUT == drv_modbus_read_registers(mb, 2, MODBUS_FC_READ_HOLDING, 0, 1, regs),
+                "Dead slave times out");
+    hal_sim_modbus_set_dead(slaves, 2, 0);
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 2, MODBUS_FC_READ_HOLDING, 0, 1, regs), "Slave back");
+
+    return 0;
+}
+
+static int test_poll(void)
+{
+    drv_modbus_poll_t* poll = NULL;
+    modbus_stats_t     stats;
+    uint16_t           regs[7][16];
+    modbus_poll_item_t items[] = {
+        { 1, MODBUS_FC_READ_HOLDING, 150, 10, regs[0], 0 }, // far from the rest of slave 1
+        { 3, MODBUS_FC_READ_HOLDING, 0, 4, regs[1], 0 },
+        { 1, MODBUS_FC_READ_HOLDING, 4, 4, regs[2], 0 }, // touches the next one
+        { 1, MODBUS_FC_READ_HOLDING, 0, 4, regs[3], 0 },
+        { 3, MODBUS_FC_READ_HOLDING, 100, 4, regs[4], 0 },
+        { 1, MODBUS_FC_READ_HOLDING, 10, 2, regs[5], 0 }, // 2 registers gap
+        { 2, MODBUS_FC_READ_INPUT, 30, 16, regs[6], 0 },
+    };
+
+    printf("\n=== Testing poll round ===\n");
+
+    fill_regs();
+    TEST_ASSERT(0 == drv_modbus_poll_create(mb, items, 7, 4, &poll), "Create poll plan");
+    TEST_ASSERT(5 == drv_modbus_poll_requests(poll), "Seven items merged into five requests");
+
+    drv_modbus_reset_stats(mb);
+    TEST_ASSERT(0 == drv_modbus_poll_round(poll), "Round without failures");
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT(0 == items[i].status && regs_match(items[i].slave, items[i].addr, items[i].regs, items[i].count),
+                    "Item values");
+    }
+    drv_modbus_get_stats(mb, &stats);
+    TEST_ASSERT(5 == stats.transactions && 5 == stats.ok, "One transaction per request");
+
+    drv_modbus_reset_stats(mb);
+    TEST_ASSERT(0 == drv_modbus_read_registers(mb, 1, MODBUS_FC_READ_HOLDING, 0, 1, regs[0])
+                    && 0 == drv_modbus_write_register(mb, 0, 199, 0),
+                "One read and one broadcast");
+    drv_modbus_get_stats(mb, &stats);
+    TEST_ASSERT(2 == stats.ok && stats.rtt_ns_max == stats.rtt_ns_mean, "Broadcast adds no round trip sample");
+
+    hal_sim_modbus_set_dead(slaves, 3, 1);
+    drv_modbus_reset_stats(mb);
+    TEST_ASSERT(2 == drv_modbus_poll_round(poll), "Two items of the dead slave fail");
+    TEST_ASSERT(MODBUS_ERR_TIMEOUT == items[1].status && MODBUS_ERR_SKIPPED == items[4].status,
+                "First request timed out, the second skipped");
+    drv_modbus_get_stats(mb, &stats);
+    TEST_ASSERT(4 == stats.transactions && 1 == stats.timeouts && 1 == stats.skipped, "Only one timeout paid");
+    hal_sim_modbus_set_dead(slaves, 3, 0);
+
+    drv_modbus_poll_destroy(&poll);
+    TEST_ASSERT(NULL == poll, "Destroy poll plan");
+    TEST_ASSERT(0 != drv_modbus_poll_create(mb, items, 0, 0, &poll), "Empty plan refused");
+
+    return 0;
+}
+
+/* request, fixed sleep, read whatever arrived */
+static int naive_read(uint8_t slave, uint16_t addr, uint16_t count, uint16_t* regs)
+{
+    uint8_t  adu[8] = { slave, MODBUS_FC_READ_HOLDING, addr >> 8, addr & 0xFF, count >> 8, count & 0xFF };
+    uint8_t  rsp[MODBUS_ADU_MAX];
+    uint16_t crc = drv_modbus_crc16(adu, 6);
+    size_t   got = 0, n;
+
+    adu[6] = crc & 0xFF;
+    adu[7] = crc >> 8;
+    drv_uart_write(uart, adu, sizeof(adu));
+    usleep(NAIVE_WAIT_US);
+    while ((got < 5U + 2 * count) && (0 < drv_uart_poll(uart, TIMEOUT_MS))) {
+        n = drv_uart_read(uart, rsp + got, 5 + 2 * count - got);
+        if (((size_t)-1 == n) || ((size_t)-2 == n)) {
+            break;
+        }
+        got += n;
+    }
+    for (int i = 0; i < count; i++) {
+        regs[i] = (rsp[3 + 2 * i] << 8) | rsp[4 + 2 * i];
+    }
+
+    return (got == 5U + 2 * count) ? 0 : -1;
+}
+
+static void print_rate(const char* name, uint64_t ticks, uint64_t transactions, int blocks)
+{
+    double sec = (double)ticks / CPU_TICKS_PER_SECOND;
+
+    printf("%-12s: %6.0f transactions/s %7.0f blocks/s\n", name, transactions / sec, blocks / sec);
+}
+
+static int bench(int rounds)
+{
+    drv_modbus_poll_t* poll = NULL;
+    modbus_poll_item_t items[BENCH_ITEMS];
+    modbus_stats_t     stats;
+    uint16_t           regs[BENCH_ITEMS][4];
+    uint64_t           start, ticks;
+    int                ok = 1;
+
+    printf("\n=== Benchmark, %d rounds of %d blocks of 4 registers on %d slaves ===\n", rounds, BENCH_ITEMS,
+           NUM_SLAVES);
+
+    fill_regs();
+    for (int i = 0; i < BENCH_ITEMS; i++) {
+        items[i] = (modbus_poll_item_t) { FIRST_SLAVE + i % NUM_SLAVES, MODBUS_FC_READ_HOLDING,
+                                          (uint16_t)(i / NUM_SLAVES * 4), 4, regs[i], 0 };
+    }
+
+    drv_modbus_reset_stats(mb);
+    start = utils_cpu_ticks();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < BENCH_ITEMS; i++) {
+            ok &= (0 == drv_modbus_read_registers(mb, items[i].slave, items[i].func, items[i].addr, 4, regs[i]));
+        }
+    }
+    ticks = utils_cpu_ticks() - start;
+    drv_modbus_get_stats(mb, &stats);
+    print_rate("per block", ticks, stats.transactions, rounds * BENCH_ITEMS);
+    printf("rtt max %llu ns mean %llu ns\n", (unsigned long long)stats.rtt_ns_max,
+           (unsigned long long)stats.rtt_ns_mean);
+    TEST_ASSERT(ok, "Per block reads");
+
+    TEST_ASSERT(0 == drv_modbus_poll_create(mb, items, BENCH_ITEMS, 0, &poll) && NUM_SLAVES == drv_modbus_poll_requests(poll),
+                "One request per slave");
+    drv_modbus_reset_stats(mb);
+    start = utils_cpu_ticks();
+    for (int r = 0; r < rounds; r++) {
+        ok &= (0 == drv_modbus_poll_round(poll));
+    }
+    ticks = utils_cpu_ticks() - start;
+    drv_modbus_get_stats(mb, &stats);
+    print_rate("poll plan", ticks, stats.transactions, rounds * BENCH_ITEMS);
+    drv_modbus_poll_destroy(&poll);
+    TEST_ASSERT(ok && regs_match(items[BENCH_ITEMS - 1].slave, items[BENCH_ITEMS - 1].addr, regs[BENCH_ITEMS - 1], 4),
+                "Poll rounds");
+
+    start = utils_cpu_ticks();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < BENCH_ITEMS; i++) {
+            ok &= (0 == naive_read(items[i].slave, items[i].addr, 4, regs[i]));
+        }
+    }
+    ticks = utils_cpu_ticks() - start;
+    print_rate("fixed sleep", ticks, (uint64_t)rounds * BENCH_ITEMS, rounds * BENCH_ITEMS);
+    TEST_ASSERT(ok, "Fixed sleep reads");
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = (1 < argc) ? atoi(argv[1]) : DFT_ROUNDS;
+
+    printf("Starting Modbus RTU Tests\n");
+
+    slaves = hal_sim_modbus_create(MODBUS_UART, FIRST_SLAVE, NUM_SLAVES, NUM_REGS, SIM_BAUD);
+    if ((NULL == slaves) || (0x00 != drv_uart_inst_create(MODBUS_UART, &uart))) {
+        printf("setup simulated slaves on uart%d failed\n", MODBUS_UART);
+        return -1;
+    }
+
+    if (0x00 == test_helpers()) {
+        test_transactions();
+        test_poll();
+        bench((0 < rounds) ? rounds : DFT_ROUNDS);
+    }
+
+    drv_modbus_destroy(&mb);
+    drv_uart_inst_destroy(&uart);
+    hal_sim_modbus_destroy(slaves);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,459 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+#include "hal_utils.h"
+#include "nor_kv.h"
+#include "w25qxx.h"
+
+/*
+ * Usage:
+ *   test_nor_kv [image_dir]
+ *
+ * Host only. The store runs on a simulated W25Q32 on spi0 behind cs 5, kept
+ * in image_dir/test_nor_kv.img (default /tmp). Power cuts are injected by a
+ * block interface that stops programming part way through a record. The
+ * benchmark gives the flash its typical busy times scaled down by 10 and
+ * compares updates through the store with rewriting a whole sector per
+ * update, then mounts from a checkpoint and from a full log scan.
+ */
+
+#define DFT_IMAGE_DIR "/tmp"
+
+#define NOR_SPI    (0)
+#define NOR_CS     (5)
+#define NOR_SIZE   (4 * 1024 * 1024)
+#define NOR_JEDEC  (0xEF4016)
+#define KV_SECTORS (64)
+
+/* W25Q32JV typical page program and sector erase, scaled by 1/10 */
+#define BENCH_PROG_US  (40)
+#define BENCH_ERASE_US (4500)
+#define BENCH_KEYS     (200)
+#define BENCH_UPDATES  (6000)
+#define BENCH_REWRITES (100)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static struct hal_sim_nor* nor;
+static w25qxx_t*           flash;
+static struct nor_kv_flash region;
+
+/* passes calls to the region until the program budget runs out, the cut one programs half its bytes */
+struct cut_flash {
+    int budget;
+    int cut;
+};
+
+static struct cut_flash cut;
+
+static int cut_read(void* ctx, uint32_t addr, void* buf, size_t len) { return region.read(region.ctx, addr, buf, len); }
+
+static int cut_prog(void* ctx, uint32_t addr, const void* buf, size_t len)
+{
+    if (cut.cut) {
+        return -1;
+    }
+    if (0 == cut.budget--) {
+        cut.cut = 1;
+        region.prog(region.ctx, addr, buf, len / 2);
+        return -1;
+    }
+
+    return region.prog(region.ctx, addr, buf, len);
+}
+
+static int cut_erase(void* ctx, uint32_t addr, size_t len) { return cut.cut ? -1 : region.erase(region.ctx, addr, len); }
+
+static int cut_sync(void* ctx) { return region.sync(region.ctx); }
+
+static void set_config(struct nor_kv_config* cfg, uint32_t max_keys, uint32_t ckpt_sectors, uint32_t gc_free)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->max_keys        = max_keys;
+    cfg->ckpt_sectors    = ckpt_sectors;
+    cfg->gc_free_sectors = gc_free;
+}
+
+static int check_value(nor_kv_t* kv, const char* key, uint32_t expect)
+{
+    uint32_t val = 0;
+
+    return (sizeof(val) == nor_kv_get(kv, key, &val, sizeof(val))) && (val == expect);
+}
+
+static int check_face(nor_kv_t* kv, const char* key, uint32_t expect)
+{
+    uint32_t val[25];
+
+    return (sizeof(val) == nor_kv_get(kv, key, val, sizeof(val))) && (val[0] == expect) && (val[24] == expect);
+}
+
+static int test_basic(void)
+{
+    struct nor_kv_config cfg;
+    nor_kv_t*            kv = NULL;
+    nor_kv_stats_t       stats;
+    char                 key[80], buf[64];
+    static uint8_t       big[NOR_KV_VALUE_MAX + 1];
+
+    printf("\n=== Testing put, get and delete ===\n");
+
+    set_config(&cfg, 64, 1, 0);
+    TEST_ASSERT(0 == nor_kv_format(&region), "Format");
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount empty");
+
+    TEST_ASSERT(0 == nor_kv_put(kv, "cal/gyro", "offset=12", 9), "Put");
+    TEST_ASSERT(9 == nor_kv_get(kv, "cal/gyro", buf, sizeof(buf)) && 0 == memcmp(buf, "offset=12", 9), "Get");
+    TEST_ASSERT(0 == nor_kv_put(kv, "cal/gyro", "offset=-3", 9), "Overwrite");
+    TEST_ASSERT(9 == nor_kv_get(kv, "cal/gyro", buf, 4) && 0 == memcmp(buf, "offs", 4), "Short buffer gets a prefix");
+    TEST_ASSERT(0 == nor_kv_put(kv, "empty", NULL, 0) && 0 == nor_kv_get(kv, "empty", NULL, 0), "Empty value");
+    TEST_ASSERT(-5 == nor_kv_get(kv, "missing", buf, sizeof(buf)), "Missing key");
+
+    memset(key, 'k', sizeof(key) - 1);
+    key[sizeof(key) - 1] = 0;
+    TEST_ASSERT(-1 == nor_kv_put(kv, key, "x", 1), "Long key refused");
+    TEST_ASSERT(-1 == nor_kv_put(kv, "big", big, sizeof(big)), "Large value refused");
+    TEST_ASSERT(0 == nor_kv_put(kv, "big", big, NOR_KV_VALUE_MAX), "Largest value stored");
+
+    TEST_ASSERT(0 == nor_kv_delete(kv, "cal/gyro") && -5 == nor_kv_get(kv, "cal/gyro", buf, sizeof(buf)), "Delete");
+    TEST_ASSERT(-5 == nor_kv_delete(kv, "cal/gyro"), "Delete twice");
+
+    for (int i = 0; i < 62; i++) {
+        snprintf(key, sizeof(key), "counter/%d", i);
+        nor_kv_put(kv, key, &i, sizeof(i));
+    }
+    TEST_ASSERT(-4 == nor_kv_put(kv, "one/too/many", "x", 1), "Index full");
+    TEST_ASSERT(0 == nor_kv_put(kv, "counter/7", "x", 1), "Existing key still updates");
+
+    nor_kv_get_stats(kv, &stats);
+    TEST_ASSERT(64 == stats.keys && !stats.mount_from_ckpt, "Stats count the keys");
+    nor_kv_unmount(&kv);
+    TEST_ASSERT(NULL == kv, "Unmount");
+
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount again");
+    nor_kv_get_stats(kv, &stats);
+    TEST_ASSERT(stats.mount_from_ckpt && 0 == stats.mount_records && 64 == stats.keys, "Index from the checkpoint");
+    TEST_ASSERT(check_value(kv, "counter/61", 61) && 1 == nor_kv_get(kv, "counter/7", buf, sizeof(buf))
+                    && -5 == nor_kv_get(kv, "cal/gyro", buf, sizeof(buf)),
+                "Values survive");
+    nor_kv_unmount(&kv);
+
+    return 0;
+}
+
+static int test_gc(void)
+{
+    struct nor_kv_config cfg;
+    nor_kv_t*            kv = NULL;
+    nor_kv_stats_t       stats;
+    char                 key[32];
+    uint32_t             val[25];
+    int                  bad = 0;
+
+    printf("\n=== Testing garbage collection ===\n");
+
+    set_config(&cfg, 128, 1, 0);
+    nor_kv_format(&region);
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount");
+
+    /* 50 keys of 100 byte values rewritten 150 times, the log wraps 3 times */
+    for (uint32_t round = 0; round < 150; round++) {
+        for (int i = 0; i < 50; i++) {
+            if (3 == i && 5 < round) {
+                continue;
+            }
+            snprintf(key, sizeof(key), "face/%d", i);
+            for (int w = 0; w < 25; w++) {
+                val[w] = round * 1000 + i;
+            }
+            if (nor_kv_put(kv, key, val, sizeof(val))) {
+                bad++;
+            }
+        }
+        if (1 == round) {
+            nor_kv_put(kv, "static/serial", "K230-0001", 9);
+        }
+        if (5 == round) {
+            nor_kv_delete(kv, "face/3");
+        }
+    }
+    TEST_ASSERT(0 == bad, "Every put fits");
+
+    nor_kv_get_stats(kv, &stats);
+    printf("gc %llu sectors, copied %llu bytes, log %llu bytes for %llu user bytes, erase counts %u~%u\n",
+           (unsigned long long)stats.gc_runs, (unsigned long long)stats.gc_copied_bytes,
+           (unsigned long long)stats.log_bytes, (unsigned long long)stats.user_bytes, stats.erase_min,
+           stats.erase_max);
+    TEST_ASSERT(stats.gc_runs > 2 * stats.log_sectors, "Log wrapped");
+    TEST_ASSERT(stats.erase_max - stats.erase_min <= 1, "Wear level within one erase");
+    TEST_ASSERT(check_face(kv, "face/49", 149049) && -5 == nor_kv_get(kv, "face/3", val, sizeof(val)),
+                "Values after GC");
+    TEST_ASSERT(9 == nor_kv_get(kv, "static/serial", key, sizeof(key)) && 0 == memcmp(key, "K230-0001", 9),
+                "Static value moved along");
+
+    /* without the checkpoint slots the next mount scans the log */
+    nor_kv_unmount(&kv);
+    w25qxx_erase(flash, region.offset, 2 * W25QXX_SECTOR_SIZE);
+
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount by scanning");
+    nor_kv_get_stats(kv, &stats);
+    TEST_ASSERT(!stats.mount_from_ckpt && 50 == stats.keys && 0 < stats.mount_records, "Scan rebuilds the index");
+    TEST_ASSERT(check_face(kv, "face/0", 149000) && -5 == nor_kv_get(kv, "face/3", val, sizeof(val)),
+                "Delete survives GC of older sectors");
+    nor_kv_unmount(&kv);
+
+    /* the GC thread keeps sectors erased ahead of the puts */
+    set_config(&cfg, 128, 1, 8);
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount with the GC thread");
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "face/%d", i % 50);
+        nor_kv_put(kv, key, val, sizeof(val));
+    }
+    for (int i = 0; i < 100; i++) {
+        nor_kv_get_stats(kv, &stats);
+        if (8 <= stats.free_sectors) {
+            break;
+        }
+        usleep(10000);
+    }
+    TEST_ASSERT(8 <= stats.free_sectors, "Thread freed sectors");
+    nor_kv_unmount(&kv);
+
+    return 0;
+}
+
+static int test_power_cut(void)
+{
+    struct nor_kv_config cfg;
+    struct nor_kv_flash  cutting;
+    nor_kv_t*            kv = NULL;
+    char                 key[32];
+    int                  lost = 0, torn = 0, runs = 0;
+
+    printf("\n=== Testing power cuts ===\n");
+
+    cutting.ctx         = &cut;
+    cutting.offset      = region.offset;
+    cutting.size        = region.size;
+    cutting.sector_size = region.sector_size;
+    cutting.read        = cut_read;
+    cutting.prog        = cut_prog;
+    cutting.erase       = cut_erase;
+    cutting.sync        = cut_sync;
+
+    set_config(&cfg, 64, 1, 0);
+    nor_kv_format(&region);
+
+    /* every run counts up 20 keys until the cut, the next run checks and continues */
+    uint32_t count[20] = { 0 };
+
+    for (int budget = 3; budget < 1200; budget += 37, runs++) {
+        int i = 0, ok;
+
+        cut.budget = budget;
+        cut.cut    = 0;
+        if (nor_kv_mount(&cutting, &cfg, &kv)) {
+            lost++;
+            continue;
+        }
+        for (;; i = (i + 1) % 20) {
+            uint32_t next = count[i] + 1;
+
+            snprintf(key, sizeof(key), "cnt/%d", i);
+            if (nor_kv_put(kv, key, &next, sizeof(next))) {
+                break;
+            }
+            count[i] = next;
+        }
+        nor_kv_unmount(&kv);
+
+        /* the torn put may or may not have made it */
+        cut.cut = 0;
+        if (nor_kv_mount(&region, &cfg, &kv)) {
+            lost++;
+            continue;
+        }
+        for (int k = 0; k < 20; k++) {
+            snprintf(key, sizeof(key), "cnt/%d", k);
+            ok = (0 == count[k]) ? (-5 == nor_kv_get(kv, key, NULL, 0)) : check_value(kv, key, count[k]);
+            if (!ok && k == i && check_value(kv, key, count[k] + 1)) {
+                count[k]++;
+                torn++;
+                ok = 1;
+            }
+            lost += !ok;
+        }
+        nor_kv_unmount(&kv);
+    }
+    printf("%d cuts, %d torn puts found committed\n", runs, torn);
+    TEST_ASSERT(0 == lost, "No committed value lost");
+
+    /* checkpoint, GC erases sectors it lists, cut before the unmount writes a new one */
+    nor_kv_stats_t stats;
+    uint32_t       val[25];
+    int            gc = 0;
+
+    nor_kv_format(&region);
+    cut.budget = 1 << 30;
+    cut.cut    = 0;
+    TEST_ASSERT(0 == nor_kv_mount(&cutting, &cfg, &kv), "Mount for the checkpoint cut");
+    nor_kv_put(kv, "static/serial", "K230-0001", 9);
+    for (uint32_t round = 0; round < 10; round++) {
+        for (int i = 0; i < 20; i++) {
+            snprintf(key, sizeof(key), "face/%d", i);
+            memset(val, 0, sizeof(val));
+            val[0] = val[24] = round * 1000 + i;
+            nor_kv_put(kv, key, val, sizeof(val));
+        }
+        if (4 == round) {
+            TEST_ASSERT(0 == nor_kv_checkpoint(kv), "Checkpoint");
+        }
+    }
+    while (gc < 2 && 0 == nor_kv_gc(kv)) {
+        gc++;
+    }
+    nor_kv_put(kv, "after/gc", "x", 1);
+    cut.budget = 0;
+    nor_kv_put(kv, "face/0", val, sizeof(val));
+    nor_kv_unmount(&kv);
+    TEST_ASSERT(2 == gc, "GC erased sectors the checkpoint lists");
+
+    cut.cut = 0;
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount after the cut");
+    nor_kv_get_stats(kv, &stats);
+    TEST_ASSERT(22 == stats.keys, "No stale entries from the checkpoint");
+    TEST_ASSERT(check_face(kv, "face/0", 9000) && check_face(kv, "face/19", 9019)
+                    && 9 == nor_kv_get(kv, "static/serial", key, sizeof(key)) && 0 == memcmp(key, "K230-0001", 9)
+                    && 1 == nor_kv_get(kv, "after/gc", NULL, 0),
+                "Values moved by GC survive");
+    nor_kv_unmount(&kv);
+
+    return 0;
+}
+
+static int bench(void)
+{
+    struct nor_kv_config cfg;
+    nor_kv_t*            kv = NULL;
+    nor_kv_stats_t       stats;
+    char                 key[32];
+    uint8_t              val[32], sector[W25QXX_SECTOR_SIZE];
+    uint64_t             start, t_kv, t_raw;
+    struct hal_sim_nor_stats before, after;
+
+    printf("\n=== Benchmark, busy times %u us program, %u us sector erase ===\n", BENCH_PROG_US, BENCH_ERASE_US);
+
+    set_config(&cfg, 256, 2, 0);
+    nor_kv_format(&region);
+    hal_sim_nor_set_timing(nor, BENCH_PROG_US, BENCH_ERASE_US, BENCH_ERASE_US * 3, 0);
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount");
+
+    hal_sim_nor_get_stats(nor, &before);
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_UPDATES; i++) {
+        snprintf(key, sizeof(key), "param/%d", i % BENCH_KEYS);
+        memset(val, i, sizeof(val));
+        nor_kv_put(kv, key, val, sizeof(val));
+    }
+    nor_kv_sync(kv);
+    t_kv = utils_cpu_ticks() - start;
+    hal_sim_nor_get_stats(nor, &after);
+    printf("store        : %8.0f updates/s, %.3f erases per update\n",
+           (double)BENCH_UPDATES * CPU_TICKS_PER_SECOND / t_kv, (double)(after.erases - before.erases) / BENCH_UPDATES);
+    nor_kv_unmount(&kv);
+
+    /* the old way, read, erase and rewrite the sector holding the value */
+    hal_sim_nor_get_stats(nor, &before);
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_REWRITES; i++) {
+        uint32_t addr = (KV_SECTORS + i % 4) * W25QXX_SECTOR_SIZE;
+
+        w25qxx_read(flash, addr, sector, sizeof(sector));
+        memset(sector + (i % 100) * 32, i, 32);
+        w25qxx_erase(flash, addr, sizeof(sector));
+        w25qxx_write(flash, addr, sector, sizeof(sector));
+    }
+    w25qxx_sync(flash);
+    t_raw = utils_cpu_ticks() - start;
+    hal_sim_nor_get_stats(nor, &after);
+    printf("sector write : %8.0f updates/s, %.3f erases per update\n",
+           (double)BENCH_REWRITES * CPU_TICKS_PER_SECOND / t_raw,
+           (double)(after.erases - before.erases) / BENCH_REWRITES);
+    TEST_ASSERT(t_kv / BENCH_UPDATES < t_raw / BENCH_REWRITES, "Store updates faster");
+
+    hal_sim_nor_set_timing(nor, 0, 0, 0, 0);
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount from the checkpoint");
+    nor_kv_get_stats(kv, &stats);
+    printf("checkpoint   : mount %u us, %u records replayed, %u keys\n", stats.mount_us, stats.mount_records,
+           stats.keys);
+    nor_kv_unmount(&kv);
+
+    w25qxx_erase(flash, region.offset, 2 * cfg.ckpt_sectors * W25QXX_SECTOR_SIZE);
+    TEST_ASSERT(0 == nor_kv_mount(&region, &cfg, &kv), "Mount by scanning");
+    nor_kv_get_stats(kv, &stats);
+    printf("log scan     : mount %u us, %u records replayed, %u keys\n", stats.mount_us, stats.mount_records,
+           stats.keys);
+    TEST_ASSERT(BENCH_KEYS == stats.keys, "Both mounts see every key");
+    nor_kv_unmount(&kv);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char*          dir = (1 < argc) ? argv[1] : DFT_IMAGE_DIR;
+    char                 path[256];
+    struct w25qxx_config fcfg;
+
+    printf("Starting NOR Key-Value Store Tests\n");
+
+    snprintf(path, sizeof(path), "%s/test_nor_kv.img", dir);
+    nor = hal_sim_nor_create(path, NOR_SIZE, NOR_JEDEC);
+    if (!nor || hal_sim_spi_attach(NOR_SPI, NOR_CS, hal_sim_nor_dev(nor))) {
+        printf("simulated flash missing\n");
+        return -1;
+    }
+
+    memset(&fcfg, 0, sizeof(fcfg));
+    fcfg.spi_id        = NOR_SPI;
+    fcfg.cs_pin        = NOR_CS;
+    fcfg.baudrate      = 50 * 1000 * 1000;
+    fcfg.data_lines    = 4;
+    fcfg.cache_sectors = 16;
+    if (w25qxx_create(&fcfg, &flash) || nor_kv_flash_w25qxx(&region, flash, 0, KV_SECTORS * W25QXX_SECTOR_SIZE)) {
+        printf("open flash fail\n");
+        return -1;
+    }
+
+    test_basic();
+    test_gc();
+    test_power_cut();
+    bench();
+
+    w25qxx_destroy(&flash);
+    hal_sim_spi_detach(hal_sim_nor_dev(nor));
+    hal_sim_nor_destroy(nor);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,365 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_sbus.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_sbus_rx [frames]
+ *
+ * Needs UART2 TX/RX (pins 11/12) wired to UART3 RX/TX (pins 51/50) like
+ * test_uart, on the host the simulator crosses the two ptys. uart2 sends,
+ * uart3 receives. The benchmark decodes @frames frames with the word based
+ * codec and with the bit by bit loop it replaced, pushes a stream through
+ * the parser, and measures how many bytes and frames the parser needs to
+ * lock again after random garbage and after single flipped bits.
+ */
+
+#define UART2_TX_PIN 11
+#define UART2_RX_PIN 12
+#define UART3_TX_PIN 50
+#define UART3_RX_PIN 51
+
+#define DFT_FRAMES    (200000)
+#define RESYNC_TRIALS (2000)
+#define BYTE_US       (120) // 12 bit characters at 100000 baud
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static sbus_dev_t tx = NULL;
+static sbus_dev_t rx = NULL;
+
+/* the per channel loops drv_sbus.c used before, kept as reference */
+static void ref_encode(const uint16_t* ch, uint8_t flags, uint8_t* frame)
+{
+    frame[0] = 0x0F;
+    memset(&frame[1], 0, 22);
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        uint16_t val      = ch[i] & 0x7FF;
+        int      byte_pos = 1 + (i * 11) / 8;
+        int      bit_pos  = (i * 11) % 8;
+
+        frame[byte_pos] |= (val << bit_pos) & 0xFF;
+        frame[byte_pos + 1] |= (val >> (8 - bit_pos)) & 0xFF;
+        if (bit_pos > 5) {
+            frame[byte_pos + 2] |= (val >> (16 - bit_pos)) & 0xFF;
+        }
+    }
+    frame[23] = flags;
+    frame[24] = 0x00;
+}
+
+static void ref_decode(const uint8_t* frame, uint16_t* ch)
+{
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        int byte_pos = 1 + (i * 11) / 8;
+        int bit_pos  = (i * 11) % 8;
+
+        ch[i] = (frame[byte_pos] >> bit_pos) | (frame[byte_pos + 1] << (8 - bit_pos));
+        if (bit_pos > 5) {
+            ch[i] |= (frame[byte_pos + 2] << (16 - bit_pos));
+        }
+        ch[i] &= 0x07FF;
+    }
+}
+
+static void random_channels(uint16_t* ch)
+{
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        ch[i] = rand() & 0x7FF;
+    }
+}
+
+static void make_frame(uint8_t* frame, uint16_t base, uint8_t flags)
+{
+    uint16_t    ch[SBUS_CHANNEL_NUM];
+    sbus_flag_t f;
+
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        ch[i] = (base + i * 100) & 0x7FF;
+    }
+    f.val = flags;
+    sbus_pack_frame(ch, f, frame);
+}
+
+static int test_codec(void)
+{
+    uint8_t     frame[SBUS_FRAME_SIZE], ref[SBUS_FRAME_SIZE];
+    uint16_t    ch[SBUS_CHANNEL_NUM], out[SBUS_CHANNEL_NUM];
+    sbus_flag_t flags = { .val = 0x0A }, got;
+    int         same  = 1;
+
+    printf("\n=== Testing frame codec ===\n");
+
+    for (int n = 0; n < 10000; n++) {
+        random_channels(ch);
+        sbus_pack_frame(ch, flags, frame);
+        ref_encode(ch, flags.val, ref);
+        same &= (0 == memcmp(frame, ref, sizeof(frame)));
+        same &= (0 == sbus_unpack_frame(frame, out, &got)) && (0 == memcmp(ch, out, sizeof(ch)));
+        ref_decode(frame, out);
+        same &= (0 == memcmp(ch, out, sizeof(ch)));
+    }
+    TEST_ASSERT(same, "Word codec matches the bit loop on random frames");
+    TEST_ASSERT(0x0A == got.val && got.bit.ch18 && got.bit.failsafe && !got.bit.frame_lost, "Flags decoded");
+
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        ch[i] = 0xFFFF;
+    }
+    sbus_pack_frame(ch, flags, frame);
+    sbus_unpack_frame(frame, out, NULL);
+    TEST_ASSERT(0x7FF == out[0] && 0x7FF == out[15] && 0x0F == frame[0] && 0x00 == frame[24],
+                "Out of range values masked to 11 bits");
+
+    frame[24] = 0x24;
+    TEST_ASSERT(0 == sbus_unpack_frame(frame, out, NULL), "SBUS2 end byte accepted");
+    frame[24] = 0x44;
+    TEST_ASSERT(0 != sbus_unpack_frame(frame, out, NULL), "Bad end byte refused");
+    frame[24] = 0x00;
+    frame[0]  = 0x0E;
+    TEST_ASSERT(0 != sbus_unpack_frame(frame, out, NULL), "Bad start byte refused");
+
+    return 0;
+}
+
+static int test_parser(void)
+{
+    uint8_t         stream[8 * SBUS_FRAME_SIZE];
+    sbus_frame_t    latest;
+    sbus_rx_stats_t stats;
+    int             frames = 0;
+
+    printf("\n=== Testing streaming parser ===\n");
+
+    sbus_rx_reset_stats(rx);
+    TEST_ASSERT(-1 == sbus_rx_get_latest(rx, &latest, 0), "Nothing before the first frame");
+
+    for (int i = 0; i < 3; i++) {
+        make_frame(&stream[i * SBUS_FRAME_SIZE], 100 * i, 0);
+    }
+    TEST_ASSERT(3 == sbus_rx_feed(rx, stream, 3 * SBUS_FRAME_SIZE), "Three frames in one chunk");
+    TEST_ASSERT(0 == sbus_rx_get_latest(rx, &latest, 0) && 3 == latest.count && 200 == latest.channels[0]
+                    && 1700 == latest.channels[15],
+                "Latest frame published");
+
+    make_frame(stream, 1000, 0x04);
+    for (int i = 0; i < SBUS_FRAME_SIZE; i++) {
+        frames += sbus_rx_feed(rx, &stream[i], 1);
+    }
+    TEST_ASSERT(1 == frames && 0 == sbus_rx_get_latest(rx, &latest, 0) && latest.flags.bit.frame_lost,
+                "Frame fed byte by byte");
+
+    /* garbage, a frame with a broken end byte, then two good frames */
+    memset(stream, 0x55, 7);
+    make_frame(&stream[7], 300, 0);
+    stream[7 + 24] = 0x99;
+    make_frame(&stream[7 + SBUS_FRAME_SIZE], 400, 0x08);
+    make_frame(&stream[7 + 2 * SBUS_FRAME_SIZE], 500, 0);
+    TEST_ASSERT(2 == sbus_rx_feed(rx, stream, 7 + 3 * SBUS_FRAME_SIZE), "Parser recovers after a broken frame");
+    TEST_ASSERT(0 == sbus_rx_get_latest(rx, &latest, 0) && 500 == latest.channels[0] && 6 == latest.count,
+                "Values after resync");
+
+    sbus_rx_get_stats(rx, &stats);
+    TEST_ASSERT(6 == stats.frames && 1 == stats.bad_frames && 1 == stats.frame_lost && 1 == stats.failsafe,
+                "Frame counters");
+    TEST_ASSERT(7 + SBUS_FRAME_SIZE == stats.dropped, "Garbage and the broken frame dropped");
+
+    return 0;
+}
+
+static int test_live(void)
+{
+    uint16_t        ch[SBUS_CHANNEL_NUM];
+    sbus_frame_t    latest;
+    sbus_rx_stats_t stats;
+    int             ok = 1;
+
+    printf("\n=== Testing uart2 -> uart3 receive ===\n");
+
+    TEST_ASSERT(0 == sbus_rx_start(rx), "Start receiver thread");
+    TEST_ASSERT(0 > sbus_rx_feed(rx, NULL, 0), "Feeding refused while the thread runs");
+
+    for (int n = 0; n < 20; n++) {
+        for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+            ch[i] = 172 + n * 50 + i;
+        }
+        sbus_set_all_channels(tx, ch);
+        ok &= (0 == sbus_send_frame(tx));
+        usleep(7000);
+    }
+    usleep(20000);
+    TEST_ASSERT(ok, "Sent 20 frames every 7 ms");
+
+    TEST_ASSERT(0 == sbus_rx_get_latest(rx, &latest, 100), "Fresh frame received");
+    TEST_ASSERT(0 == memcmp(ch, latest.channels, sizeof(ch)), "Latest channels match the last frame sent");
+    TEST_ASSERT(6 + 20 == latest.count, "Every frame received");
+
+    usleep(50000);
+    TEST_ASSERT(-2 == sbus_rx_get_latest(rx, &latest, 20), "Frame goes stale without traffic");
+
+    /* the thread applies the reset, the frame count keeps going */
+    sbus_rx_reset_stats(rx);
+    sbus_rx_get_stats(rx, &stats);
+    TEST_ASSERT(0 == stats.frames && 0 == stats.bytes, "Reset shows at once while the thread runs");
+    for (int n = 0; n < 3; n++) {
+        ok &= (0 == sbus_send_frame(tx));
+        usleep(7000);
+    }
+    usleep(20000);
+    sbus_rx_get_stats(rx, &stats);
+    TEST_ASSERT(ok && 3 == stats.frames && 3 * SBUS_FRAME_SIZE == stats.bytes, "Counters restart after the reset");
+    TEST_ASSERT(0 == sbus_rx_get_latest(rx, &latest, 100) && 6 + 20 + 3 == latest.count,
+                "Frame count not repeated after the reset");
+
+    return 0;
+}
+
+static int bench(int frames)
+{
+    uint8_t*        stream = malloc((size_t)frames * SBUS_FRAME_SIZE);
+    uint16_t        ch[SBUS_CHANNEL_NUM];
+    sbus_rx_stats_t stats;
+    uint64_t        start, t_word, t_ref, t_parse, bytes = 0, lost = 0;
+    uint32_t        sink = 0;
+
+    printf("\n=== Benchmark, %d frames ===\n", frames);
+
+    TEST_ASSERT(stream, "Alloc stream");
+    for (int i = 0; i < frames; i++) {
+        make_frame(&stream[(size_t)i * SBUS_FRAME_SIZE], i, 0);
+    }
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < frames; i++) {
+        sbus_unpack_frame(&stream[(size_t)i * SBUS_FRAME_SIZE], ch, NULL);
+        sink += ch[i & 15];
+    }
+    t_word = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < frames; i++) {
+        ref_decode(&stream[(size_t)i * SBUS_FRAME_SIZE], ch);
+        sink += ch[i & 15];
+    }
+    t_ref = utils_cpu_ticks() - start;
+
+    sbus_rx_reset_stats(rx);
+    start = utils_cpu_ticks();
+    for (int i = 0; i < frames; i += 40) {
+        int n = (frames - i < 40) ? (frames - i) : 40;
+
+        sbus_rx_feed(rx, &stream[(size_t)i * SBUS_FRAME_SIZE], (size_t)n * SBUS_FRAME_SIZE);
+    }
+    t_parse = utils_cpu_ticks() - start;
+    sbus_rx_get_stats(rx, &stats);
+
+    printf("unpack word : %6llu ns/frame %5.1f Mframes/s\n",
+           (unsigned long long)(t_word * 1000000000ULL / CPU_TICKS_PER_SECOND / frames),
+           (double)frames * CPU_TICKS_PER_SECOND / t_word / 1e6);
+    printf("unpack loop : %6llu ns/frame %5.1f Mframes/s\n",
+           (unsigned long long)(t_ref * 1000000000ULL / CPU_TICKS_PER_SECOND / frames),
+           (double)frames * CPU_TICKS_PER_SECOND / t_ref / 1e6);
+    printf("parser      : %6llu ns/frame %5.1f MB/s (checksum %u)\n",
+           (unsigned long long)(t_parse * 1000000000ULL / CPU_TICKS_PER_SECOND / frames),
+           (double)frames * SBUS_FRAME_SIZE * CPU_TICKS_PER_SECOND / t_parse / 1e6, sink & 0xFF);
+    TEST_ASSERT((uint64_t)frames == stats.frames, "Parser decoded every frame");
+
+    /*
+     * random garbage in front of a clean stream: stream bytes lost before the
+     * first real frame, and frames built from garbage that passed the checks
+     */
+    for (int t = 0; t < RESYNC_TRIALS; t++) {
+        sbus_frame_t latest;
+        uint8_t      junk[64];
+        int          n = 1 + rand() % sizeof(junk), fed = 0;
+
+        for (int i = 0; i < n; i++) {
+            junk[i] = rand();
+        }
+        sbus_rx_feed(rx, junk, n);
+        while (fed < 8 * SBUS_FRAME_SIZE) {
+            if (sbus_rx_feed(rx, &stream[fed++], 1)) {
+                sbus_rx_get_latest(rx, &latest, 0);
+                if ((latest.channels[0] + 100) == latest.channels[1]) {
+                    break;
+                }
+                lost++;
+            }
+        }
+        bytes += fed - SBUS_FRAME_SIZE;
+    }
+    printf("after garbage      : %.1f stream bytes lost, %.2f ms at 100000 baud, %llu false frames in %d trials\n",
+           (double)bytes / RESYNC_TRIALS, (double)bytes / RESYNC_TRIALS * BYTE_US / 1000, (unsigned long long)lost,
+           RESYNC_TRIALS);
+    TEST_ASSERT(bytes < (uint64_t)RESYNC_TRIALS * SBUS_FRAME_SIZE, "Locks within a frame on average");
+    lost = 0;
+
+    /* one flipped bit per 10 frames */
+    sbus_rx_reset_stats(rx);
+    for (int t = 0; t < RESYNC_TRIALS; t++) {
+        uint8_t burst[10 * SBUS_FRAME_SIZE];
+
+        memcpy(burst, stream, sizeof(burst));
+        burst[rand() % sizeof(burst)] ^= 1 << (rand() % 8);
+        lost += 10 - sbus_rx_feed(rx, burst, sizeof(burst));
+    }
+    sbus_rx_get_stats(rx, &stats);
+    printf("single bit errors  : %.2f frames lost per error, %llu bad frames\n", (double)lost / RESYNC_TRIALS,
+           (unsigned long long)stats.bad_frames);
+
+    free(stream);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int frames = (1 < argc) ? atoi(argv[1]) : DFT_FRAMES;
+
+    printf("Starting SBUS Receive Tests\n");
+
+    drv_fpioa_set_pin_func(UART2_TX_PIN, UART2_TXD);
+    drv_fpioa_set_pin_func(UART2_RX_PIN, UART2_RXD);
+    drv_fpioa_set_pin_func(UART3_TX_PIN, UART3_TXD);
+    drv_fpioa_set_pin_func(UART3_RX_PIN, UART3_RXD);
+
+    tx = sbus_create(2);
+    rx = sbus_create(3);
+    if (!tx || !rx) {
+        printf("create sbus on uart2/uart3 failed\n");
+        return -1;
+    }
+
+    test_codec();
+    test_parser();
+    test_live();
+    sbus_rx_stop(rx);
+    bench((0 < frames) ? frames : DFT_FRAMES);
+
+    sbus_destroy(tx);
+    sbus_destroy(rx);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
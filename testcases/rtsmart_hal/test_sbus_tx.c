@@ -0,0 +1,269 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_sbus.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_sbus_tx [period_us] [seconds]
+ *
+ * Needs UART2 TX/RX (pins 11/12) wired to UART3 RX/TX (pins 51/50) like
+ * test_uart, on the host the simulator crosses the two ptys. uart2 sends
+ * every @period_us (7000 by default) while a writer thread replaces all
+ * channels every 100 us, uart3 checks that no frame mixes two updates. The benchmark
+ * compares the period jitter and drift of the scheduled transmitter with a
+ * sbus_send_frame() + usleep() loop.
+ */
+
+#define UART2_TX_PIN 11
+#define UART2_RX_PIN 12
+#define UART3_TX_PIN 50
+#define UART3_RX_PIN 51
+
+#define DFT_PERIOD_US (7000)
+#define DFT_SECONDS   (2)
+#define WRITER_US     (100)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static sbus_dev_t tx = NULL;
+static sbus_dev_t rx = NULL;
+
+static volatile int writer_stop;
+static uint64_t     writer_updates;
+
+/* every update sets all channels to one value, a torn frame shows two */
+static void* writer_thread(void* args)
+{
+    uint16_t    ch[SBUS_CHANNEL_NUM];
+    sbus_flag_t flags = { .val = 0 };
+
+    (void)args;
+
+    for (uint16_t v = 0; !writer_stop; v = (v + 1) & 0x7FF) {
+        for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+            ch[i] = v;
+        }
+        flags.bit.ch17 = v & 1;
+        sbus_update(tx, ch, &flags);
+        writer_updates++;
+        usleep(WRITER_US);
+    }
+
+    return NULL;
+}
+
+static void print_stats(const char* name, const sbus_tx_stats_t* st)
+{
+    printf("%s: %llu frames, %llu updates taken, %llu overruns, period %llu ns min %llu max %llu mean %llu, "
+           "jitter max %llu ns, late max %llu ns\n",
+           name, (unsigned long long)st->frames, (unsigned long long)st->updates, (unsigned long long)st->overruns,
+           (unsigned long long)st->period_ns, (unsigned long long)st->period_ns_min,
+           (unsigned long long)st->period_ns_max, (unsigned long long)st->period_ns_mean,
+           (unsigned long long)st->jitter_ns_max, (unsigned long long)st->late_ns_max);
+}
+
+static int test_snapshot(void)
+{
+    uint16_t     ch[SBUS_CHANNEL_NUM] = { 0 };
+    sbus_flag_t  flags                = { .val = 0 }, got;
+    sbus_frame_t latest;
+
+    printf("\n=== Testing snapshot updates ===\n");
+
+    TEST_ASSERT(0 == sbus_rx_start(rx), "Start receiver");
+
+    ch[3] = 1500;
+    flags.bit.failsafe = 1;
+    TEST_ASSERT(0 == sbus_update(tx, ch, &flags), "Update channels and flags together");
+    TEST_ASSERT(0 == sbus_set_channel(tx, 4, 1600) && 0 != sbus_set_channel(tx, 16, 0), "Single channel update");
+    sbus_get_flags(tx, &got);
+    TEST_ASSERT(got.bit.failsafe && !got.bit.frame_lost, "Flags read back before sending");
+
+    TEST_ASSERT(0 == sbus_send_frame(tx), "Manual send");
+    usleep(20000);
+    TEST_ASSERT(0 == sbus_rx_get_latest(rx, &latest, 0) && 1500 == latest.channels[3] && 1600 == latest.channels[4]
+                    && latest.flags.bit.failsafe,
+                "Both updates in one frame");
+
+    flags.val = 0;
+    sbus_set_flags(tx, &flags);
+    sbus_get_flags(tx, &got);
+    TEST_ASSERT(0 == got.val, "Flags cleared");
+
+    return 0;
+}
+
+static int test_periodic(uint32_t period_us, int seconds)
+{
+    pthread_t       writer;
+    sbus_frame_t    latest;
+    sbus_tx_stats_t st;
+    uint16_t        zero[SBUS_CHANNEL_NUM] = { 0 };
+    sbus_flag_t     no_flags               = { .val = 0 };
+    uint32_t        last = 0, seen = 0, torn = 0;
+    uint64_t        end;
+    int64_t         drift;
+
+    printf("\n=== Testing periodic transmitter, %u us for %d s ===\n", period_us, seconds);
+
+    /* every frame from here on carries one value on all channels */
+    sbus_update(tx, zero, &no_flags);
+
+    if (0 == sbus_rx_get_latest(rx, &latest, 0)) {
+        last = latest.count;
+    }
+
+    TEST_ASSERT(0 != sbus_tx_start(tx, 1000), "Period shorter than a frame refused");
+    TEST_ASSERT(0 == sbus_tx_start(tx, period_us), "Start transmitter");
+    TEST_ASSERT(0 != sbus_send_frame(tx), "Manual send refused while scheduled");
+
+    writer_stop = 0;
+    pthread_create(&writer, NULL, writer_thread, NULL);
+
+    end = utils_cpu_ticks() + (uint64_t)seconds * CPU_TICKS_PER_SECOND;
+    while (utils_cpu_ticks() < end) {
+        if ((0 == sbus_rx_get_latest(rx, &latest, 0)) && (latest.count != last)) {
+            last = latest.count;
+            seen++;
+            for (int i = 1; i < SBUS_CHANNEL_NUM; i++) {
+                torn += (latest.channels[i] != latest.channels[0]);
+            }
+            torn += (latest.flags.bit.ch17 != (latest.channels[0] & 1));
+        }
+        usleep(500);
+    }
+
+    writer_stop = 1;
+    pthread_join(writer, NULL);
+    sbus_tx_get_stats(tx, &st);
+    sbus_tx_stop(tx);
+
+    print_stats("scheduled", &st);
+    printf("writer made %llu updates, receiver checked %u frames\n", (unsigned long long)writer_updates, seen);
+
+    TEST_ASSERT(0 == torn, "No frame mixes two updates");
+    TEST_ASSERT(seen > st.frames * 3 / 4, "Receiver saw the frames");
+    TEST_ASSERT(st.frames + st.overruns >= (uint64_t)seconds * 1000000 / period_us - 2
+                    && st.frames + st.overruns <= (uint64_t)seconds * 1000000 / period_us + 2,
+                "One frame per slot");
+    drift = (int64_t)st.period_ns_mean - (int64_t)st.period_ns;
+    TEST_ASSERT(-20000 < drift && drift < 20000, "Mean period on the nominal grid");
+
+    return 0;
+}
+
+static int test_reset(uint32_t period_us)
+{
+    sbus_tx_stats_t st;
+
+    printf("\n=== Testing stats reset while scheduled ===\n");
+
+    TEST_ASSERT(0 == sbus_tx_start(tx, period_us), "Start transmitter");
+    usleep(period_us * 10);
+    sbus_tx_get_stats(tx, &st);
+    TEST_ASSERT(st.frames >= 5, "Frames counted");
+
+    /* the transmitter keeps sending while the counters are zeroed */
+    sbus_tx_reset_stats(tx);
+    sbus_tx_get_stats(tx, &st);
+    TEST_ASSERT(st.frames <= 1 && st.overruns <= 1, "Reset takes effect at once");
+
+    usleep(period_us * 10);
+    sbus_tx_get_stats(tx, &st);
+    sbus_tx_stop(tx);
+    print_stats("after reset", &st);
+    TEST_ASSERT(st.frames >= 5 && st.frames <= 12, "Counting restarts after reset");
+    TEST_ASSERT(st.period_ns_min > 0 && st.period_ns_min <= st.period_ns_max, "New period series after reset");
+
+    return 0;
+}
+
+static int bench(uint32_t period_us, int seconds)
+{
+    uint64_t start, now, last = 0, sum = 0, min = UINT64_MAX, max = 0;
+    int      frames = (int)((uint64_t)seconds * 1000000 / period_us);
+
+    printf("\n=== sbus_send_frame() + usleep(%u) loop for %d s ===\n", period_us, seconds);
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < frames; i++) {
+        now = utils_cpu_ticks();
+        sbus_send_frame(tx);
+        if (i) {
+            sum += now - last;
+            min = (now - last < min) ? now - last : min;
+            max = (now - last > max) ? now - last : max;
+        }
+        last = now;
+        usleep(period_us);
+    }
+
+    printf("usleep loop: %d frames in %llu ms, period min %llu ns max %llu mean %llu, drift %lld us over the run\n",
+           frames, (unsigned long long)((utils_cpu_ticks() - start) * 1000 / CPU_TICKS_PER_SECOND),
+           (unsigned long long)(min * 1000000000ULL / CPU_TICKS_PER_SECOND),
+           (unsigned long long)(max * 1000000000ULL / CPU_TICKS_PER_SECOND),
+           (unsigned long long)(sum / (frames - 1) * 1000000000ULL / CPU_TICKS_PER_SECOND),
+           (long long)(sum * 1000000 / CPU_TICKS_PER_SECOND) - (long long)(frames - 1) * period_us);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int period_us = (1 < argc) ? atoi(argv[1]) : DFT_PERIOD_US;
+    int seconds   = (2 < argc) ? atoi(argv[2]) : DFT_SECONDS;
+
+    printf("Starting SBUS Periodic Transmit Tests\n");
+
+    if ((3000 > period_us) || (0 >= seconds)) {
+        printf("period_us must be at least 3000 and seconds positive\n");
+        return -1;
+    }
+
+    drv_fpioa_set_pin_func(UART2_TX_PIN, UART2_TXD);
+    drv_fpioa_set_pin_func(UART2_RX_PIN, UART2_RXD);
+    drv_fpioa_set_pin_func(UART3_TX_PIN, UART3_TXD);
+    drv_fpioa_set_pin_func(UART3_RX_PIN, UART3_RXD);
+
+    tx = sbus_create(2);
+    rx = sbus_create(3);
+    if (!tx || !rx) {
+        printf("create sbus on uart2/uart3 failed\n");
+        return -1;
+    }
+
+    if (0 == test_snapshot()) {
+        test_periodic(period_us, seconds);
+        test_reset(period_us);
+        bench(period_us, seconds);
+    }
+
+    sbus_destroy(tx);
+    sbus_destroy(rx);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
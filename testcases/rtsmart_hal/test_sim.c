@@ -0,0 +1,450 @@
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_adc.h"
+#include "drv_gpio.h"
+#include "drv_i2c.h"
+#include "drv_spi.h"
+#include "drv_uart.h"
+#include "hal_io.h"
+#include "hal_sim.h"
+#include "hal_utils.h"
+
+/*
+ * Host only, build with Makefile.host.
+ *
+ * Runs the unmodified drivers against the device node simulator and the
+ * default board of hal_sim_board_setup(), then measures the cost of the
+ * simulated SPI and UART paths.
+ */
+
+#define TEST_UART_LOOP  (1)
+#define TEST_GPIO_PIN   (30)
+#define TEST_NOR_CS     (11)
+#define TEST_LCD_CS     (19)
+#define TEST_LCD_DC     (20)
+#define TEST_EEPROM     (0x50)
+#define TEST_SOFT_I2C   (5)
+#define BENCH_SPI_BYTES (1024 * 1024)
+#define BENCH_UART_SIZE (64 * 1024)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static size_t uart_read_timeout(drv_uart_inst_t* uart, uint8_t* buf, size_t size, int timeout_ms)
+{
+    size_t got = 0;
+
+    while ((got < size) && (0 < drv_uart_poll(uart, timeout_ms))) {
+        got += drv_uart_read(uart, buf + got, size - got);
+    }
+
+    return got;
+}
+
+static size_t peer_read_timeout(int fd, uint8_t* buf, size_t size, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    size_t        got = 0;
+    ssize_t       len;
+
+    while ((got < size) && (0 < poll(&pfd, 1, timeout_ms))) {
+        if (0 >= (len = read(fd, buf + got, size - got))) {
+            break;
+        }
+        got += len;
+    }
+
+    return got;
+}
+
+static int test_uart(void)
+{
+    drv_uart_inst_t*      uart2 = NULL;
+    drv_uart_inst_t*      uart3 = NULL;
+    drv_uart_inst_t*      uart  = NULL;
+    struct uart_configure cfg   = { .baud_rate = 921600, .data_bits = 8, .stop_bits = 1, .parity = 2, .bufsz = 4096 };
+    struct uart_configure curr;
+    const uint8_t         hello[] = "hello sim";
+    uint8_t               buf[32];
+    int                   peer;
+
+    printf("\n=== Testing simulated UART ===\n");
+
+    TEST_ASSERT(0 == drv_uart_inst_create(TEST_UART_LOOP, &uart), "Open uart through the sim");
+    TEST_ASSERT(0 <= (peer = hal_sim_uart_peer(TEST_UART_LOOP)), "Get pty peer");
+
+    TEST_ASSERT(0 == drv_uart_set_config(uart, &cfg), "Set config");
+    TEST_ASSERT(0 == drv_uart_get_config(uart, &curr), "Get config");
+    TEST_ASSERT(921600 == curr.baud_rate && 2 == curr.parity, "Config round trip");
+
+    TEST_ASSERT(sizeof(hello) == drv_uart_write(uart, hello, sizeof(hello)), "Write to uart");
+    TEST_ASSERT(sizeof(hello) == peer_read_timeout(peer, buf, sizeof(hello), 100), "Peer receives");
+    TEST_ASSERT(0 == memcmp(buf, hello, sizeof(hello)), "Peer data matches");
+
+    TEST_ASSERT(sizeof(hello) == write(peer, hello, sizeof(hello)), "Peer writes");
+    usleep(10000);
+    TEST_ASSERT(sizeof(hello) == drv_uart_recv_available(uart), "Bytes available");
+    TEST_ASSERT(sizeof(hello) == uart_read_timeout(uart, buf, sizeof(hello), 100), "Uart receives");
+    TEST_ASSERT(0 == memcmp(buf, hello, sizeof(hello)), "Uart data matches");
+    drv_uart_inst_destroy(&uart);
+
+    TEST_ASSERT(0 == drv_uart_inst_create(2, &uart2) && 0 == drv_uart_inst_create(3, &uart3), "Open crossed uart2/uart3");
+    TEST_ASSERT(sizeof(hello) == drv_uart_write(uart2, hello, sizeof(hello)), "uart2 writes");
+    TEST_ASSERT(sizeof(hello) == uart_read_timeout(uart3, buf, sizeof(hello), 100), "uart3 receives");
+    TEST_ASSERT(sizeof(hello) == drv_uart_write(uart3, hello, sizeof(hello)), "uart3 writes");
+    TEST_ASSERT(sizeof(hello) == uart_read_timeout(uart2, buf, sizeof(hello), 100), "uart2 receives");
+    drv_uart_inst_destroy(&uart2);
+    drv_uart_inst_destroy(&uart3);
+
+    return 0;
+}
+
+static volatile int gpio_irq_count;
+
+static void gpio_irq_handler(void* args) { __atomic_add_fetch((int*)args, 1, __ATOMIC_RELAXED); }
+
+static int test_gpio(void)
+{
+    drv_gpio_inst_t* gpio = NULL;
+
+    printf("\n=== Testing simulated GPIO ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_inst_create(TEST_GPIO_PIN, &gpio), "Create gpio instance");
+
+    TEST_ASSERT(0 == drv_gpio_mode_set(gpio, GPIO_DM_OUTPUT), "Set output mode");
+    TEST_ASSERT(GPIO_DM_OUTPUT == drv_gpio_mode_get(gpio) && GPIO_DM_OUTPUT == hal_sim_gpio_get_mode(TEST_GPIO_PIN),
+                "Mode visible to the sim");
+    drv_gpio_value_set(gpio, GPIO_PV_HIGH);
+    TEST_ASSERT(1 == hal_sim_gpio_get(TEST_GPIO_PIN), "Output HIGH on the pin");
+    drv_gpio_value_set(gpio, GPIO_PV_LOW);
+    TEST_ASSERT(0 == hal_sim_gpio_get(TEST_GPIO_PIN), "Output LOW on the pin");
+
+    TEST_ASSERT(0 == drv_gpio_mode_set(gpio, GPIO_DM_INPUT_PULLUP), "Set pull up input");
+    TEST_ASSERT(GPIO_PV_HIGH == drv_gpio_value_get(gpio), "Floating pull up reads HIGH");
+    hal_sim_gpio_inject(TEST_GPIO_PIN, 0);
+    TEST_ASSERT(GPIO_PV_LOW == drv_gpio_value_get(gpio), "Injected LOW is read");
+
+    TEST_ASSERT(0 == drv_gpio_register_irq(gpio, GPIO_PE_RISING, 0, gpio_irq_handler, (void*)&gpio_irq_count),
+                "Register rising irq");
+    TEST_ASSERT(0 == drv_gpio_set_irq(gpio, 1), "Enable irq");
+    for (int i = 0; i < 10; i++) {
+        hal_sim_gpio_inject(TEST_GPIO_PIN, 1);
+        hal_sim_gpio_inject(TEST_GPIO_PIN, 0);
+    }
+    for (int i = 0; (i < 100) && (10 > gpio_irq_count); i++) {
+        usleep(1000);
+    }
+    TEST_ASSERT(10 == hal_sim_gpio_irq_count(TEST_GPIO_PIN), "Sim raised one irq per rising edge");
+    TEST_ASSERT(10 == gpio_irq_count, "Callback ran per rising edge");
+
+    drv_gpio_unregister_irq(gpio);
+    hal_sim_gpio_inject(TEST_GPIO_PIN, -1);
+    drv_gpio_inst_destroy(&gpio);
+
+    return 0;
+}
+
+static int test_gpio_port(void)
+{
+    drv_gpio_port_t* port = NULL;
+    uint64_t         mask = 0xFFULL << TEST_GPIO_PIN;
+    uint64_t         irqs = hal_sim_gpio_irq_count(-1);
+    uint64_t         value;
+
+    printf("\n=== Testing simulated GPIO port ===\n");
+
+    TEST_ASSERT(0 == drv_gpio_port_create(mask, GPIO_DM_OUTPUT, &port) && port->native, "Port request answered");
+    TEST_ASSERT(0 == drv_gpio_port_write(port, mask, 0x5AULL << TEST_GPIO_PIN), "Port write");
+    TEST_ASSERT(0 == hal_sim_gpio_get(TEST_GPIO_PIN) && 1 == hal_sim_gpio_get(TEST_GPIO_PIN + 1), "Pins follow the port");
+    drv_gpio_port_destroy(&port);
+
+    /* an older kernel rejects the request, the driver goes pin by pin */
+    hal_sim_gpio_port_enable(0);
+    TEST_ASSERT(0 == drv_gpio_port_create(mask, GPIO_DM_OUTPUT, &port) && !port->native, "Fallback detected");
+    TEST_ASSERT(0x5AULL << TEST_GPIO_PIN == port->out, "Output latch seeded from the pins");
+    TEST_ASSERT(0 == drv_gpio_port_toggle(port, mask), "Emulated toggle");
+    TEST_ASSERT(0 == drv_gpio_port_read(port, mask, &value) && (0xA5ULL << TEST_GPIO_PIN) == value, "Emulated read");
+    drv_gpio_port_destroy(&port);
+    hal_sim_gpio_port_enable(1);
+
+    TEST_ASSERT(irqs == hal_sim_gpio_irq_count(-1), "No irq without a registered pin");
+
+    return 0;
+}
+
+static int nor_cmd(drv_spi_inst_t spi, const uint8_t* tx, uint8_t* rx, size_t len)
+{
+    return (int)len == drv_spi_transfer(spi, tx, rx, len, true) ? 0 : -1;
+}
+
+static int nor_wait(drv_spi_inst_t spi)
+{
+    uint8_t tx[2] = { 0x05, 0x00 }, rx[2];
+
+    for (int i = 0; i < 10000; i++) {
+        if ((0x00 == nor_cmd(spi, tx, rx, 2)) && !(rx[1] & 0x01)) {
+            return 0;
+        }
+        usleep(100);
+    }
+
+    return -1;
+}
+
+static int test_spi_nor(void)
+{
+    drv_spi_inst_t spi = NULL;
+    uint8_t        jedec[4] = { 0x9f }, id[4];
+    uint8_t        wren[1]  = { 0x06 };
+    uint8_t        prog[4 + 16] = { 0x02, 0x00, 0x10, 0x00 };
+    uint8_t        erase[4]     = { 0x20, 0x00, 0x10, 0x00 };
+    uint8_t        rd[4 + 16]   = { 0x03, 0x00, 0x10, 0x00 }, rx[4 + 16];
+    uint8_t*       mem          = hal_sim_nor_mem(hal_sim_board_nor(0));
+    int            same         = 1;
+
+    printf("\n=== Testing simulated SPI NOR ===\n");
+
+    TEST_ASSERT(NULL != mem, "Board has a nor at cs 11");
+    TEST_ASSERT(0 == drv_spi_inst_create(2, true, SPI_HAL_MODE_0, 10 * 1000 * 1000, 8, TEST_NOR_CS, SPI_HAL_DATA_LINE_1, &spi),
+                "Create spi instance");
+
+    TEST_ASSERT(0 == nor_cmd(spi, jedec, id, sizeof(jedec)), "Read JEDEC id");
+    TEST_ASSERT(0xEF == id[1] && 0x40 == id[2] && 0x18 == id[3], "JEDEC id is W25Q128");
+
+    for (int i = 0; i < 16; i++) {
+        prog[4 + i] = i * 3;
+    }
+    TEST_ASSERT(0 == nor_cmd(spi, prog, rx, sizeof(prog)) && 0 == nor_wait(spi), "Program without WEL");
+    TEST_ASSERT(0xff == mem[0x1000], "Ignored without write enable");
+
+    TEST_ASSERT(0 == nor_cmd(spi, wren, rx, 1) && 0 == nor_cmd(spi, prog, rx, sizeof(prog)) && 0 == nor_wait(spi),
+                "Page program");
+    TEST_ASSERT(0 == nor_cmd(spi, rd, rx, sizeof(rd)), "Read back");
+    for (int i = 0; i < 16; i++) {
+        same &= (rx[4 + i] == prog[4 + i]) && (mem[0x1000 + i] == prog[4 + i]);
+    }
+    TEST_ASSERT(same, "Flash holds the programmed page");
+
+    TEST_ASSERT(0 == nor_cmd(spi, wren, rx, 1) && 0 == nor_cmd(spi, erase, rx, sizeof(erase)) && 0 == nor_wait(spi),
+                "Sector erase");
+    TEST_ASSERT(0 == nor_cmd(spi, rd, rx, sizeof(rd)) && 0xff == rx[4] && 0xff == rx[19], "Sector reads erased");
+
+    drv_spi_inst_destroy(&spi);
+
+    return 0;
+}
+
+static int lcd_cmd(drv_spi_inst_t spi, drv_gpio_inst_t* dc, uint8_t cmd, const uint8_t* data, size_t len)
+{
+    drv_gpio_value_set(dc, GPIO_PV_LOW);
+    if (1 != drv_spi_write(spi, &cmd, 1, !len)) {
+        return -1;
+    }
+    if (len) {
+        drv_gpio_value_set(dc, GPIO_PV_HIGH);
+        if ((int)len != drv_spi_write(spi, data, len, true)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_spi_lcd(void)
+{
+    struct hal_sim_lcd*      lcd = hal_sim_board_lcd();
+    struct hal_sim_lcd_stats st;
+    drv_spi_inst_t           spi = NULL;
+    drv_gpio_inst_t*         dc  = NULL;
+    const uint8_t            caset[4] = { 0, 10, 0, 13 }, raset[4] = { 0, 20, 0, 21 };
+    uint8_t                  pixels[4 * 2 * 2];
+
+    printf("\n=== Testing simulated ST7789 ===\n");
+
+    TEST_ASSERT(NULL != lcd, "Board has an lcd on spi1");
+    TEST_ASSERT(0 == drv_gpio_inst_create(TEST_LCD_DC, &dc) && 0 == drv_gpio_mode_set(dc, GPIO_DM_OUTPUT), "DC pin");
+    TEST_ASSERT(0 == drv_spi_inst_create(1, true, SPI_HAL_MODE_0, 40 * 1000 * 1000, 8, TEST_LCD_CS, SPI_HAL_DATA_LINE_1, &spi),
+                "Create spi instance");
+
+    for (size_t i = 0; i < sizeof(pixels); i += 2) {
+        pixels[i]     = 0xF8; /* red, big endian RGB565 */
+        pixels[i + 1] = 0x00;
+    }
+
+    TEST_ASSERT(0 == lcd_cmd(spi, dc, 0x11, NULL, 0) && 0 == lcd_cmd(spi, dc, 0x29, NULL, 0), "Sleep out, display on");
+    TEST_ASSERT(hal_sim_lcd_display_on(lcd), "Display is on");
+    TEST_ASSERT(0 == lcd_cmd(spi, dc, 0x2A, caset, 4) && 0 == lcd_cmd(spi, dc, 0x2B, raset, 4), "Set window");
+    TEST_ASSERT(0 == lcd_cmd(spi, dc, 0x2C, pixels, sizeof(pixels)), "Write RAM");
+
+    TEST_ASSERT(0xF800 == hal_sim_lcd_pixel(lcd, 10, 20) && 0xF800 == hal_sim_lcd_pixel(lcd, 13, 21), "Window filled");
+    TEST_ASSERT(0xF800 != hal_sim_lcd_pixel(lcd, 14, 20) && 0xF800 != hal_sim_lcd_pixel(lcd, 10, 22), "Outside untouched");
+    hal_sim_lcd_get_stats(lcd, &st);
+    TEST_ASSERT(8 <= st.pixels, "Pixel statistics");
+
+    drv_spi_inst_destroy(&spi);
+    drv_gpio_inst_destroy(&dc);
+
+    return 0;
+}
+
+static int test_i2c(void)
+{
+    static uint8_t         eeprom_regs[256];
+    struct hal_sim_i2c_dev eeprom = {
+        .name = "24c02", .addr = TEST_EEPROM, .regs = eeprom_regs, .size = sizeof(eeprom_regs), .addr_bytes = 1,
+    };
+    drv_i2c_inst_t* i2c = NULL;
+    uint8_t         wr[4] = { 0x10, 0xde, 0xad, 0xbe }, reg = 0x10, rd[3] = { 0 };
+    i2c_msg_t       msgs[2];
+
+    printf("\n=== Testing simulated I2C ===\n");
+
+    TEST_ASSERT(0 == drv_i2c_inst_create(TEST_SOFT_I2C, 100000, 1000, 30, 31, &i2c), "Create soft i2c bus");
+    TEST_ASSERT(NULL != hal_sim_find("/dev/i2c5"), "Misc device added the bus node");
+    TEST_ASSERT(0 == hal_sim_i2c_attach(TEST_SOFT_I2C, &eeprom), "Attach eeprom");
+
+    msgs[0] = (i2c_msg_t) { .addr = TEST_EEPROM, .flags = DRV_I2C_WR, .len = sizeof(wr), .buf = wr };
+    TEST_ASSERT(0 == drv_i2c_transfer(i2c, msgs, 1), "Write registers");
+    TEST_ASSERT(0xde == eeprom_regs[0x10] && 0xbe == eeprom_regs[0x12], "Register file updated");
+
+    msgs[0] = (i2c_msg_t) { .addr = TEST_EEPROM, .flags = DRV_I2C_WR, .len = 1, .buf = &reg };
+    msgs[1] = (i2c_msg_t) { .addr = TEST_EEPROM, .flags = DRV_I2C_RD, .len = sizeof(rd), .buf = rd };
+    TEST_ASSERT(0 == drv_i2c_transfer(i2c, msgs, 2), "Write pointer, read registers");
+    TEST_ASSERT(0 == memcmp(rd, wr + 1, sizeof(rd)), "Read back matches");
+
+    msgs[0].addr = TEST_EEPROM + 1;
+    TEST_ASSERT(0 != drv_i2c_transfer(i2c, msgs, 1), "Absent address NAKs");
+
+    hal_sim_i2c_detach(&eeprom);
+    drv_i2c_inst_destroy(&i2c);
+    TEST_ASSERT(NULL == hal_sim_find("/dev/i2c5"), "Soft bus node removed");
+
+    return 0;
+}
+
+static int test_adc(void)
+{
+    const uint16_t table[] = { 100, 200, 300 };
+    uint32_t       uv;
+
+    printf("\n=== Testing simulated ADC ===\n");
+
+    TEST_ASSERT(0 == drv_adc_init(), "Init adc");
+
+    hal_sim_adc_set_wave(3, HAL_SIM_WAVE_CONST, 1000, 1000, 0, 0);
+    TEST_ASSERT(1000 == drv_adc_read(3), "Constant level");
+    uv = drv_adc_read_uv(3, 1800000);
+    TEST_ASSERT(439000 < uv && 440000 > uv, "Level scaled to microvolt");
+
+    hal_sim_adc_set_table(4, table, 3, 1000000);
+    TEST_ASSERT(100 == drv_adc_read(4), "Table plays first sample");
+
+    hal_sim_adc_set_wave(5, HAL_SIM_WAVE_CONST, 2000, 2000, 0, 20);
+    uv = drv_adc_read(5);
+    TEST_ASSERT(1980 <= uv && 2020 >= uv, "Noise stays in band");
+
+    drv_adc_deinit();
+
+    return 0;
+}
+
+static int bench(void)
+{
+    drv_spi_inst_t           spi = NULL;
+    drv_uart_inst_t*         uart = NULL;
+    struct hal_sim_spi_stats st;
+    uint8_t*                 buf = malloc(BENCH_UART_SIZE);
+    uint64_t                 start, t_spi, t_uart;
+    size_t                   sent = 0, got = 0;
+    int                      peer;
+
+    printf("\n=== Benchmark ===\n");
+
+    TEST_ASSERT(NULL != buf, "Allocate buffer");
+    TEST_ASSERT(0 == drv_spi_inst_create(2, true, SPI_HAL_MODE_0, 50 * 1000 * 1000, 8, TEST_NOR_CS, SPI_HAL_DATA_LINE_1, &spi),
+                "Create spi instance");
+    hal_sim_spi_get_stats(2, &st);
+    uint64_t wire_ns = st.wire_ns;
+
+    buf[0] = 0x03;
+    buf[1] = buf[2] = buf[3] = 0;
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_SPI_BYTES / 4096; i++) {
+        drv_spi_transfer(spi, buf, buf + 4096, 4096, true);
+    }
+    t_spi = utils_cpu_ticks() - start;
+    hal_sim_spi_get_stats(2, &st);
+    drv_spi_inst_destroy(&spi);
+
+    TEST_ASSERT(0 == drv_uart_inst_create(TEST_UART_LOOP, &uart) && 0 <= (peer = hal_sim_uart_peer(TEST_UART_LOOP)),
+                "Open uart");
+    memset(buf, 0x5a, BENCH_UART_SIZE);
+    start = utils_cpu_ticks();
+    while (got < BENCH_UART_SIZE) {
+        if (sent < BENCH_UART_SIZE) {
+            sent += drv_uart_write(uart, buf + sent, BENCH_UART_SIZE - sent);
+        }
+        struct pollfd pfd = { .fd = peer, .events = POLLIN };
+        ssize_t       n;
+
+        if ((0 >= poll(&pfd, 1, 100)) || (0 >= (n = read(peer, buf, BENCH_UART_SIZE - got)))) {
+            break;
+        }
+        got += n;
+    }
+    t_uart = utils_cpu_ticks() - start;
+    drv_uart_inst_destroy(&uart);
+    free(buf);
+    TEST_ASSERT(BENCH_UART_SIZE == got, "All uart bytes delivered");
+
+    printf("spi  : %llu KB/s host, wire time %llu us for %d KB at 50MHz\n",
+           (unsigned long long)(BENCH_SPI_BYTES / 1024 * (uint64_t)CPU_TICKS_PER_SECOND / (t_spi ? t_spi : 1)),
+           (unsigned long long)((st.wire_ns - wire_ns) / 1000), BENCH_SPI_BYTES / 1024);
+    printf("uart : %llu KB/s through the pty\n",
+           (unsigned long long)(BENCH_UART_SIZE / 1024 * (uint64_t)CPU_TICKS_PER_SECOND / (t_uart ? t_uart : 1)));
+
+    return 0;
+}
+
+int main(void)
+{
+    printf("Starting HAL Simulation Tests, backend %s\n", hal_io_get_backend());
+
+    if (0x00 != strcmp("sim", hal_io_get_backend())) {
+        printf("Simulator not active\n");
+        return -1;
+    }
+
+    test_uart();
+    test_gpio();
+    test_gpio_port();
+    test_spi_nor();
+    test_spi_lcd();
+    test_i2c();
+    test_adc();
+    bench();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,230 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_slab.h"
+#include "hal_utils.h"
+
+#define TEST_THREADS (4)
+#define TEST_LOOPS   (100000)
+#define BENCH_LOOPS  (1000000)
+#define BENCH_LIVE   (64) /* objects kept alive while cycling, like open instances */
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct test_obj {
+    void*    base;
+    int      id;
+    uint8_t  payload[36];
+};
+
+static HAL_SLAB_CACHE_DEFINE(obj_cache, "test_obj", struct test_obj);
+static HAL_SLAB_CACHE_DEFINE(mt_cache, "test_mt", struct test_obj);
+
+static int test_cache(void)
+{
+    struct hal_slab_stats st;
+    struct test_obj*      objs[100];
+    struct test_obj*      again;
+    int                   distinct = 1;
+
+    printf("\n=== Testing object cache ===\n");
+
+    for (int i = 0; i < 100; i++) {
+        objs[i] = hal_slab_zalloc(&obj_cache);
+        if ((NULL == objs[i]) || (0 != ((uintptr_t)objs[i] % HAL_SLAB_ALIGN)) || objs[i]->id) {
+            distinct = 0;
+            break;
+        }
+        objs[i]->id = i + 1;
+    }
+    TEST_ASSERT(distinct, "Zeroed aligned objects");
+
+    for (int i = 0; i < 100; i++) {
+        distinct &= (objs[i]->id == i + 1);
+    }
+    TEST_ASSERT(distinct, "Objects do not overlap");
+
+    hal_slab_get_stats(&obj_cache, &st);
+    TEST_ASSERT(st.in_use == 100 && st.peak == 100 && st.total >= 100, "Usage statistics");
+    TEST_ASSERT(st.obj_size == 48 && st.static_objs <= st.total, "Object size rounded to alignment");
+#ifdef CONFIG_RT_SMART_HAL_SLAB_STATIC
+    TEST_ASSERT(st.static_objs == CONFIG_RT_SMART_HAL_SLAB_STATIC_OBJS, "Objects reserved from static arena");
+#endif
+
+    hal_slab_free(&obj_cache, objs[50]);
+    again = hal_slab_alloc(&obj_cache);
+    TEST_ASSERT(again == objs[50], "Freed object reused first");
+
+    for (int i = 0; i < 100; i++) {
+        hal_slab_free(&obj_cache, objs[i]);
+    }
+    hal_slab_free(&obj_cache, NULL);
+
+    uint32_t total = st.total;
+    for (int i = 0; i < 100; i++) {
+        objs[i] = hal_slab_alloc(&obj_cache);
+    }
+    for (int i = 0; i < 100; i++) {
+        hal_slab_free(&obj_cache, objs[i]);
+    }
+    hal_slab_get_stats(&obj_cache, &st);
+    TEST_ASSERT(st.in_use == 0 && st.total == total && st.allocs == st.frees, "Create/destroy cycles do not grow the cache");
+
+    return 0;
+}
+
+static int test_buffers(void)
+{
+    uint8_t* small = hal_slab_buf_alloc(10);
+    uint8_t* mid   = hal_slab_buf_alloc(3000);
+    uint8_t* big   = hal_slab_buf_alloc(64 * 1024);
+    uint8_t* reuse;
+
+    printf("\n=== Testing buffer size classes ===\n");
+
+    TEST_ASSERT(small && mid && big, "Allocate small, class sized and oversized buffers");
+    TEST_ASSERT(0 == ((uintptr_t)small % HAL_SLAB_ALIGN) && 0 == ((uintptr_t)mid % HAL_SLAB_ALIGN), "Buffers aligned");
+
+    memset(small, 0x11, 10);
+    memset(mid, 0x22, 3000);
+    memset(big, 0x33, 64 * 1024);
+    TEST_ASSERT(small[9] == 0x11 && mid[0] == 0x22 && mid[2999] == 0x22 && big[65535] == 0x33, "Buffers usable over full size");
+
+    hal_slab_buf_free(mid);
+    reuse = hal_slab_buf_alloc(2500);
+    TEST_ASSERT(reuse == mid, "Same class buffer reused");
+
+    hal_slab_buf_free(reuse);
+    hal_slab_buf_free(small);
+    hal_slab_buf_free(big);
+    hal_slab_buf_free(NULL);
+
+    return 0;
+}
+
+static void* mt_worker(void* args)
+{
+    struct test_obj* live[8] = { NULL };
+
+    for (int i = 0; i < TEST_LOOPS; i++) {
+        int slot = i & 7;
+
+        if (live[slot]) {
+            if (live[slot]->id != (int)(intptr_t)args) {
+                return (void*)1;
+            }
+            hal_slab_free(&mt_cache, live[slot]);
+        }
+        live[slot]     = hal_slab_alloc(&mt_cache);
+        live[slot]->id = (int)(intptr_t)args;
+    }
+    for (int i = 0; i < 8; i++) {
+        hal_slab_free(&mt_cache, live[i]);
+    }
+
+    return NULL;
+}
+
+static int test_threads(void)
+{
+    pthread_t             threads[TEST_THREADS];
+    struct hal_slab_stats st;
+    void*                 ret;
+    int                   ok = 1;
+
+    printf("\n=== Testing concurrent allocation ===\n");
+
+    for (int i = 0; i < TEST_THREADS; i++) {
+        pthread_create(&threads[i], NULL, mt_worker, (void*)(intptr_t)(i + 1));
+    }
+    for (int i = 0; i < TEST_THREADS; i++) {
+        pthread_join(threads[i], &ret);
+        ok &= (NULL == ret);
+    }
+    TEST_ASSERT(ok, "No object handed out twice");
+
+    hal_slab_get_stats(&mt_cache, &st);
+    TEST_ASSERT(st.in_use == 0 && st.allocs == (uint64_t)TEST_THREADS * TEST_LOOPS, "Balanced statistics");
+    TEST_ASSERT(st.peak <= TEST_THREADS * 8 && st.failures == 0, "Peak bounded by live objects");
+
+    return 0;
+}
+
+static void bench(void)
+{
+    void*    live[BENCH_LIVE];
+    uint64_t start, t_slab, t_malloc, t_buf;
+
+    for (int i = 0; i < BENCH_LIVE; i++) {
+        live[i] = hal_slab_alloc(&obj_cache);
+    }
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_LOOPS; i++) {
+        hal_slab_free(&obj_cache, live[i % BENCH_LIVE]);
+        live[i % BENCH_LIVE] = hal_slab_alloc(&obj_cache);
+    }
+    t_slab = utils_cpu_ticks() - start;
+    for (int i = 0; i < BENCH_LIVE; i++) {
+        hal_slab_free(&obj_cache, live[i]);
+    }
+
+    for (int i = 0; i < BENCH_LIVE; i++) {
+        live[i] = malloc(sizeof(struct test_obj));
+    }
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_LOOPS; i++) {
+        free(live[i % BENCH_LIVE]);
+        live[i % BENCH_LIVE] = malloc(sizeof(struct test_obj));
+    }
+    t_malloc = utils_cpu_ticks() - start;
+    for (int i = 0; i < BENCH_LIVE; i++) {
+        free(live[i]);
+    }
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < BENCH_LOOPS; i++) {
+        /* a 300 LED ws2812 frame */
+        hal_slab_buf_free(hal_slab_buf_alloc(900 + 40));
+    }
+    t_buf = utils_cpu_ticks() - start;
+
+    printf("\n=== Benchmark (%d alloc/free pairs) ===\n", BENCH_LOOPS);
+    printf("slab object : %llu ns\n", (unsigned long long)(t_slab * 1000000000ULL / CPU_TICKS_PER_SECOND / BENCH_LOOPS));
+    printf("malloc      : %llu ns\n", (unsigned long long)(t_malloc * 1000000000ULL / CPU_TICKS_PER_SECOND / BENCH_LOOPS));
+    printf("slab buffer : %llu ns\n", (unsigned long long)(t_buf * 1000000000ULL / CPU_TICKS_PER_SECOND / BENCH_LOOPS));
+}
+
+int main(void)
+{
+    printf("Starting HAL Slab Tests\n");
+
+    test_cache();
+    test_buffers();
+    test_threads();
+    bench();
+
+    printf("\n");
+    hal_slab_dump_stats();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
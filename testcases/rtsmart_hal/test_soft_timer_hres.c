@@ -0,0 +1,187 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_timer.h"
+
+#define LOOP_PERIOD_US (500) /* 2kHz control loop */
+#define LOOP_SECONDS   (2)
+#define LOOP_TICKS     (LOOP_SECONDS * 1000000 / LOOP_PERIOD_US)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct loop_ctx {
+    atomic_int count;
+    uint64_t   first_ns;
+    uint64_t   last_ns;
+    int        stall_at; /* callback index that blocks for a while, -1 for none */
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void loop_callback(void* args)
+{
+    struct loop_ctx* ctx = args;
+    int              n   = atomic_fetch_add(&ctx->count, 1);
+
+    ctx->last_ns = now_ns();
+    if (0 == n) {
+        ctx->first_ns = ctx->last_ns;
+    }
+    if (n == ctx->stall_at) {
+        usleep(LOOP_PERIOD_US * 10);
+    }
+}
+
+static int test_period_validation(void)
+{
+    drv_soft_timer_inst_t* timer = NULL;
+
+    printf("\n=== Testing nanosecond period validation ===\n");
+
+    TEST_ASSERT(0 == drv_soft_timer_create(&timer), "Create soft timer");
+    TEST_ASSERT(0 != drv_soft_timer_set_period_ns(timer, DRV_SOFT_TIMER_MIN_PERIOD_NS - 1), "Reject too short period");
+    TEST_ASSERT(0 == drv_soft_timer_set_period_us(timer, LOOP_PERIOD_US), "Set microsecond period");
+    TEST_ASSERT(0 != drv_soft_timer_start_abs(timer, NULL), "Reject missing deadline");
+    drv_soft_timer_destroy(&timer);
+
+    return 0;
+}
+
+static int test_drift_free(void)
+{
+    drv_soft_timer_inst_t* timer = NULL;
+    struct loop_ctx        ctx;
+    struct timespec        start;
+    uint64_t               start_ns, expect_ns, err_ns;
+
+    printf("\n=== Testing %dus periodic timer for %ds ===\n", LOOP_PERIOD_US, LOOP_SECONDS);
+
+    memset(&ctx, 0x00, sizeof(ctx));
+    ctx.stall_at = -1;
+
+    TEST_ASSERT(0 == drv_soft_timer_create(&timer), "Create soft timer");
+    drv_soft_timer_set_mode(timer, HWTIMER_MODE_PERIOD);
+    drv_soft_timer_set_period_us(timer, LOOP_PERIOD_US);
+    drv_soft_timer_register_irq(timer, loop_callback, &ctx);
+
+    /* first deadline on an absolute, round boundary 10ms ahead */
+    start_ns      = (now_ns() / 1000000ULL + 10) * 1000000ULL;
+    start.tv_sec  = start_ns / 1000000000ULL;
+    start.tv_nsec = start_ns % 1000000000ULL;
+    TEST_ASSERT(0 == drv_soft_timer_start_abs(timer, &start), "Start at absolute deadline");
+
+    while (atomic_load(&ctx.count) < LOOP_TICKS) {
+        usleep(10000);
+    }
+    drv_soft_timer_stop(timer);
+
+    TEST_ASSERT(ctx.first_ns >= start_ns, "First expiry not before the deadline");
+
+    /* the n-th expiry must sit on start + n * period, whatever the lateness of earlier ones */
+    expect_ns = start_ns + (uint64_t)(atomic_load(&ctx.count) - 1 + drv_soft_timer_get_overrun(timer)) * LOOP_PERIOD_US * 1000ULL;
+    err_ns    = ctx.last_ns - expect_ns;
+    printf("callbacks %d, overruns %u, last expiry %lld ns after its deadline\n", atomic_load(&ctx.count),
+           drv_soft_timer_get_overrun(timer), (long long)err_ns);
+    TEST_ASSERT((int64_t)err_ns >= 0 && err_ns < 2000000ULL, "No accumulated drift");
+
+    drv_soft_timer_destroy(&timer);
+
+    return 0;
+}
+
+static int test_overrun(void)
+{
+    drv_soft_timer_inst_t* timer = NULL;
+    struct loop_ctx        ctx;
+
+    printf("\n=== Testing overrun counter ===\n");
+
+    memset(&ctx, 0x00, sizeof(ctx));
+    ctx.stall_at = 5;
+
+    TEST_ASSERT(0 == drv_soft_timer_create(&timer), "Create soft timer");
+    drv_soft_timer_set_mode(timer, HWTIMER_MODE_PERIOD);
+    drv_soft_timer_set_period_us(timer, LOOP_PERIOD_US);
+    drv_soft_timer_register_irq(timer, loop_callback, &ctx);
+    TEST_ASSERT(0 == drv_soft_timer_start(timer), "Start periodic timer");
+
+    while (atomic_load(&ctx.count) < 50) {
+        usleep(1000);
+    }
+    drv_soft_timer_stop(timer);
+
+    printf("overruns %u\n", drv_soft_timer_get_overrun(timer));
+    TEST_ASSERT(drv_soft_timer_get_overrun(timer) >= 8, "Stalled callback counted as overruns");
+
+    drv_soft_timer_destroy(&timer);
+
+    return 0;
+}
+
+static int test_past_deadline(void)
+{
+    drv_soft_timer_inst_t* timer = NULL;
+    struct loop_ctx        ctx;
+    struct timespec        ts;
+
+    printf("\n=== Testing deadline in the past ===\n");
+
+    memset(&ctx, 0x00, sizeof(ctx));
+    ctx.stall_at = -1;
+
+    TEST_ASSERT(0 == drv_soft_timer_create(&timer), "Create soft timer");
+    drv_soft_timer_set_mode(timer, HWTIMER_MODE_ONESHOT);
+    drv_soft_timer_register_irq(timer, loop_callback, &ctx);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec -= 1;
+    TEST_ASSERT(0 == drv_soft_timer_start_abs(timer, &ts), "Start with past deadline");
+    usleep(20000);
+    TEST_ASSERT(1 == atomic_load(&ctx.count), "Past deadline fires at once");
+
+    drv_soft_timer_stop(timer);
+    drv_soft_timer_destroy(&timer);
+
+    return 0;
+}
+
+int main(void)
+{
+    printf("Starting Soft Timer High Resolution Tests\n");
+
+    test_period_validation();
+    test_drift_free();
+    test_overrun();
+    test_past_deadline();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,229 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "drv_timer.h"
+#include "hal_utils.h"
+
+#define TEST_TIMERS     (64)
+#define BENCH_SECONDS   (3)
+#define BENCH_MIN_MS    (10)
+#define BENCH_MAX_MS    (100)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct fire_record {
+    atomic_int count;
+    uint64_t   start_ns;
+    uint64_t   fired_ns;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record_callback(void* args)
+{
+    struct fire_record* rec = args;
+
+    if (0 == atomic_fetch_add(&rec->count, 1)) {
+        rec->fired_ns = now_ns();
+    }
+}
+
+static atomic_uint bench_fired;
+
+static void bench_callback(void* args)
+{
+    (void)args;
+    atomic_fetch_add_explicit(&bench_fired, 1, memory_order_relaxed);
+}
+
+static int test_many_instances(void)
+{
+    drv_soft_timer_inst_t* timers[TEST_TIMERS] = { NULL };
+    struct fire_record     recs[TEST_TIMERS];
+    int                    created = 0, fired = 0, early = 0, leaked = 0;
+
+    printf("\n=== Testing concurrent oneshot timers ===\n");
+
+    memset(recs, 0x00, sizeof(recs));
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        if (0 == drv_soft_timer_create(&timers[i])) {
+            created++;
+        }
+        drv_soft_timer_set_mode(timers[i], HWTIMER_MODE_ONESHOT);
+        drv_soft_timer_set_period(timers[i], 20 + i * 5);
+        drv_soft_timer_register_irq(timers[i], record_callback, &recs[i]);
+    }
+    TEST_ASSERT(created == TEST_TIMERS, "Create soft timers without instance limit");
+
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        recs[i].start_ns = now_ns();
+        drv_soft_timer_start(timers[i]);
+    }
+
+    /* odd timers are cancelled before they expire */
+    for (int i = 1; i < TEST_TIMERS; i += 2) {
+        drv_soft_timer_stop(timers[i]);
+    }
+
+    usleep((20 + TEST_TIMERS * 5 + 50) * 1000);
+
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        if (i & 1) {
+            leaked += atomic_load(&recs[i].count);
+            continue;
+        }
+        fired += atomic_load(&recs[i].count);
+        if (recs[i].fired_ns - recs[i].start_ns < (uint64_t)(20 + i * 5) * 1000000ULL) {
+            early++;
+        }
+    }
+    TEST_ASSERT(leaked == 0, "Stopped timers do not fire");
+    TEST_ASSERT(fired == TEST_TIMERS / 2, "Every armed timer fired exactly once");
+    TEST_ASSERT(early == 0, "No timer fired before its period");
+
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        drv_soft_timer_stop(timers[i]);
+        drv_soft_timer_destroy(&timers[i]);
+    }
+
+    return 0;
+}
+
+static int test_cascade(void)
+{
+    drv_soft_timer_inst_t* timer = NULL;
+    drv_soft_timer_stats_t stats;
+    struct fire_record     rec;
+
+    printf("\n=== Testing wheel cascade ===\n");
+
+    memset(&rec, 0x00, sizeof(rec));
+    drv_soft_timer_reset_stats();
+
+    /* beyond the 64 ticks of level 0, so it has to be cascaded down */
+    TEST_ASSERT(0 == drv_soft_timer_create(&timer), "Create soft timer");
+    drv_soft_timer_set_period(timer, 300);
+    drv_soft_timer_register_irq(timer, record_callback, &rec);
+    rec.start_ns = now_ns();
+    TEST_ASSERT(0 == drv_soft_timer_start(timer), "Start long oneshot timer");
+
+    usleep(400 * 1000);
+
+    drv_soft_timer_get_stats(&stats);
+    TEST_ASSERT(1 == atomic_load(&rec.count), "Long timer fired once");
+    TEST_ASSERT(rec.fired_ns - rec.start_ns >= 300 * 1000000ULL, "Long timer not early");
+    TEST_ASSERT(stats.cascaded >= 1, "Long timer was cascaded");
+    TEST_ASSERT(stats.active == 0, "No timer left armed");
+
+    drv_soft_timer_stop(timer);
+    drv_soft_timer_destroy(&timer);
+
+    return 0;
+}
+
+static int bench_wheel(int count)
+{
+    drv_soft_timer_inst_t** timers;
+    drv_soft_timer_stats_t  stats;
+    uint64_t                start, arm, cancel;
+    uint64_t                expected = 0;
+
+    printf("\n=== Benchmark %d periodic timers, %d-%dms, %ds ===\n", count, BENCH_MIN_MS, BENCH_MAX_MS, BENCH_SECONDS);
+
+    timers = calloc(count, sizeof(*timers));
+    TEST_ASSERT(timers != NULL, "Allocate timer table");
+
+    srand(count);
+    for (int i = 0; i < count; i++) {
+        int period = BENCH_MIN_MS + rand() % (BENCH_MAX_MS - BENCH_MIN_MS + 1);
+
+        if (0 != drv_soft_timer_create(&timers[i])) {
+            break;
+        }
+        drv_soft_timer_set_mode(timers[i], HWTIMER_MODE_PERIOD);
+        drv_soft_timer_set_period(timers[i], period);
+        drv_soft_timer_register_irq(timers[i], bench_callback, NULL);
+        expected += BENCH_SECONDS * 1000 / period;
+    }
+
+    atomic_store(&bench_fired, 0);
+    drv_soft_timer_reset_stats();
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < count; i++) {
+        drv_soft_timer_start(timers[i]);
+    }
+    arm = utils_cpu_ticks() - start;
+
+    sleep(BENCH_SECONDS);
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < count; i++) {
+        drv_soft_timer_stop(timers[i]);
+    }
+    cancel = utils_cpu_ticks() - start;
+
+    drv_soft_timer_get_stats(&stats);
+
+    for (int i = 0; i < count; i++) {
+        drv_soft_timer_destroy(&timers[i]);
+    }
+    free(timers);
+
+    printf("arm       : %llu ns/timer\n", (unsigned long long)(arm * 1000000000ULL / CPU_TICKS_PER_SECOND / count));
+    printf("cancel    : %llu ns/timer\n", (unsigned long long)(cancel * 1000000000ULL / CPU_TICKS_PER_SECOND / count));
+    printf("expired   : %llu (expected ~%llu)\n", (unsigned long long)stats.expired, (unsigned long long)expected);
+    printf("wakeups   : %llu, cascaded %llu, overruns %llu\n", (unsigned long long)stats.wakeups,
+           (unsigned long long)stats.cascaded, (unsigned long long)stats.overruns);
+    if (stats.expired) {
+        printf("dispatch  : %llu ns/timer\n", (unsigned long long)(stats.busy_ns / stats.expired));
+        printf("jitter    : avg %llu us, max %llu us\n", (unsigned long long)(stats.late_ns_sum / stats.expired / 1000),
+               (unsigned long long)(stats.late_ns_max / 1000));
+    }
+
+    TEST_ASSERT(stats.expired + stats.overruns >= expected * 9 / 10, "Periodic timers kept their rate");
+    TEST_ASSERT(atomic_load(&bench_fired) == stats.expired, "Every expiry dispatched its callback");
+
+    return 0;
+}
+
+int main(void)
+{
+    printf("Starting Soft Timer Wheel Tests\n");
+
+    test_many_instances();
+    test_cascade();
+    bench_wheel(1000);
+    bench_wheel(10000);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,291 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "drv_fpioa.h"
+#include "drv_spi.h"
+#include "drv_spi_queue.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_spi_chain [spi_id] [cs_pin] [loops]
+ *
+ * Needs a W25Qxx on spi_id (default 2, QSPI1 on pins 21/40/41) behind cs_pin
+ * (default 11), like test_spi_wq128. Only ids, status and data are read, the
+ * flash is not written. The benchmark issues a command byte followed by a
+ * short read the current way (one drv_spi_transfer() per segment), as one
+ * chained drv_spi_transfer_segments() call and through the async queue.
+ */
+
+#define DFT_SPI_ID   (2)
+#define DFT_CS_PIN   (11)
+#define DFT_LOOPS    (2000)
+#define SPI_BAUDRATE (10 * 1000 * 1000)
+
+#define CMD_READ_SR1   0x05
+#define CMD_READ_DATA  0x03
+#define CMD_READ_JEDEC 0x9F
+
+#define QUEUE_DEPTH (64)
+#define QUEUE_POOL  (QUEUE_DEPTH * 4) // more than can be in flight, a slot is done before it is reused
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static uint32_t jedec_id;
+
+struct jedec_read {
+    drv_spi_xfer_t xfer;
+    drv_spi_seg_t  segs[2];
+    uint8_t        cmd, id[3];
+    int            index;
+};
+
+static struct jedec_read pool[QUEUE_POOL];
+static int               next_index, out_of_order, resubmits;
+static drv_spi_queue_t*  queue;
+
+static void set_seg(drv_spi_seg_t* seg, const void* tx, void* rx, size_t len, bool cs_change)
+{
+    seg->tx        = tx;
+    seg->rx        = rx;
+    seg->len       = len;
+    seg->cs_change = cs_change;
+}
+
+static uint32_t read_jedec_calls(drv_spi_inst_t spi)
+{
+    uint8_t cmd = CMD_READ_JEDEC, id[3] = { 0 };
+
+    drv_spi_write(spi, &cmd, 1, false);
+    drv_spi_read(spi, id, 3, true);
+
+    return (id[0] << 16) | (id[1] << 8) | id[2];
+}
+
+static void jedec_prepare(struct jedec_read* r, drv_spi_inst_t spi, int index)
+{
+    r->cmd                 = CMD_READ_JEDEC;
+    r->index               = index;
+    r->segs[0].tx          = &r->cmd;
+    r->segs[0].rx          = NULL;
+    r->segs[0].len         = 1;
+    r->segs[0].cs_change   = false;
+    r->segs[1].tx          = NULL;
+    r->segs[1].rx          = r->id;
+    r->segs[1].len         = 3;
+    r->segs[1].cs_change   = true;
+    r->xfer.inst           = spi;
+    r->xfer.segs           = r->segs;
+    r->xfer.count          = 2;
+    r->xfer.user           = r;
+    memset(r->id, 0, sizeof(r->id));
+}
+
+static void jedec_done(drv_spi_xfer_t* xfer, int result)
+{
+    struct jedec_read* r = xfer->user;
+
+    if ((r->index != next_index++) || (4 != result) || (jedec_id != (uint32_t)((r->id[0] << 16) | (r->id[1] << 8) | r->id[2]))) {
+        out_of_order++;
+    }
+}
+
+/* submits itself again from the queue thread until it ran 10 times */
+static void resubmit_done(drv_spi_xfer_t* xfer, int result)
+{
+    if ((4 == result) && (10 > ++resubmits)) {
+        drv_spi_queue_submit(queue, xfer, 0);
+    }
+}
+
+static int test_chain(drv_spi_inst_t spi)
+{
+    uint8_t       cmd[4] = { CMD_READ_DATA, 0, 0, 0 }, sr_cmd = CMD_READ_SR1, id_cmd = CMD_READ_JEDEC;
+    uint8_t       a[64], b[64], sr[10], id[3];
+    drv_spi_seg_t segs[20];
+
+    printf("\n=== Testing chained transfers ===\n");
+
+    jedec_id = read_jedec_calls(spi);
+    printf("JEDEC ID: 0x%06X\n", jedec_id);
+    TEST_ASSERT(0 != jedec_id && 0xFFFFFF != jedec_id, "Flash answers the per call path");
+
+    set_seg(&segs[0], &id_cmd, NULL, 1, false);
+    set_seg(&segs[1], NULL, id, 3, true);
+    TEST_ASSERT(4 == drv_spi_transfer_segments(spi, segs, 2), "Chained JEDEC read");
+    TEST_ASSERT(jedec_id == (uint32_t)((id[0] << 16) | (id[1] << 8) | id[2]), "Same id through the chain");
+
+    memset(a, 0, sizeof(a));
+    memset(b, 0x5A, sizeof(b));
+    drv_spi_write(spi, cmd, sizeof(cmd), false);
+    drv_spi_read(spi, a, sizeof(a), true);
+    set_seg(&segs[0], cmd, NULL, sizeof(cmd), false);
+    set_seg(&segs[1], NULL, b, sizeof(b), true);
+    TEST_ASSERT(4 + sizeof(b) == drv_spi_transfer_segments(spi, segs, 2), "Chained data read");
+    TEST_ASSERT(0 == memcmp(a, b, sizeof(a)), "Chained read matches the per call read");
+
+    /* ten status reads, each in its own cs frame, more segments than fit on the stack */
+    for (int i = 0; i < 10; i++) {
+        set_seg(&segs[2 * i], &sr_cmd, NULL, 1, false);
+        set_seg(&segs[2 * i + 1], NULL, &sr[i], 1, true);
+    }
+    TEST_ASSERT(SPI_HAL_CHAIN_SEGS < 20 && 20 == drv_spi_transfer_segments(spi, segs, 20), "Long chain of frames");
+
+    /* an empty last segment still ends the frame */
+    set_seg(&segs[0], &id_cmd, NULL, 1, false);
+    set_seg(&segs[1], NULL, id, 3, false);
+    set_seg(&segs[2], NULL, NULL, 0, true);
+    TEST_ASSERT(4 == drv_spi_transfer_segments(spi, segs, 3), "Empty segment skipped");
+    TEST_ASSERT(jedec_id == read_jedec_calls(spi), "Its cs release reached the bus");
+
+    TEST_ASSERT(0 > drv_spi_transfer_segments(spi, segs, 0), "No segments rejected");
+    TEST_ASSERT(0 > drv_spi_transfer_segments(NULL, segs, 1), "No instance rejected");
+
+    return 0;
+}
+
+static int test_queue(drv_spi_inst_t spi)
+{
+    spi_queue_stats_t stats;
+    struct jedec_read r;
+
+    printf("\n=== Testing async queue ===\n");
+
+    TEST_ASSERT(0 == drv_spi_queue_create(QUEUE_DEPTH, &queue), "Create queue");
+
+    next_index   = 0;
+    out_of_order = 0;
+    for (int i = 0; i < 100; i++) {
+        jedec_prepare(&pool[i], spi, i);
+        pool[i].xfer.done = jedec_done;
+        if (0x00 != drv_spi_queue_submit(queue, &pool[i].xfer, -1)) {
+            break;
+        }
+    }
+    TEST_ASSERT(0 == drv_spi_queue_flush(queue, 1000), "Queue drained");
+    TEST_ASSERT(100 == next_index && 0 == out_of_order, "Callbacks in order with the right ids");
+
+    drv_spi_queue_get_stats(queue, &stats);
+    printf("submitted %llu completed %llu in %llu ioctls, max queued %u\n", (unsigned long long)stats.submitted,
+           (unsigned long long)stats.completed, (unsigned long long)stats.ioctls, stats.max_queued);
+    TEST_ASSERT(100 == stats.completed && 0 == stats.errors && 400 == stats.bytes, "Stats count every transfer");
+
+    jedec_prepare(&r, spi, 0);
+    r.xfer.done = resubmit_done;
+    resubmits   = 0;
+    TEST_ASSERT(0 == drv_spi_queue_submit(queue, &r.xfer, 0), "Submit self resubmitting transfer");
+    TEST_ASSERT(0 == drv_spi_queue_flush(queue, 1000) && 10 == resubmits, "Callback submits again");
+
+    r.xfer.count = 0;
+    TEST_ASSERT(-1 == drv_spi_queue_submit(queue, &r.xfer, 0), "Empty transfer rejected");
+
+    drv_spi_queue_destroy(&queue);
+    TEST_ASSERT(NULL == queue, "Destroy queue");
+
+    return 0;
+}
+
+static uint64_t rate(int loops, uint64_t ticks) { return ticks ? (uint64_t)loops * CPU_TICKS_PER_SECOND / ticks : 0; }
+
+static int bench(drv_spi_inst_t spi, int loops)
+{
+    spi_queue_stats_t stats;
+    uint8_t           cmd = CMD_READ_SR1, sr[4];
+    drv_spi_seg_t     segs[2] = { { &cmd, NULL, 1, false }, { NULL, sr, sizeof(sr), true } };
+    uint64_t          start, t_calls, t_chain, t_queue;
+
+    printf("\n=== Benchmark, %d command + %zu byte reads ===\n", loops, sizeof(sr));
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_spi_transfer(spi, &cmd, NULL, 1, false);
+        drv_spi_transfer(spi, NULL, sr, sizeof(sr), true);
+    }
+    t_calls = utils_cpu_ticks() - start;
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_spi_transfer_segments(spi, segs, 2);
+    }
+    t_chain = utils_cpu_ticks() - start;
+
+    TEST_ASSERT(0 == drv_spi_queue_create(QUEUE_DEPTH, &queue), "Create queue");
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        struct jedec_read* r = &pool[i % QUEUE_POOL];
+
+        jedec_prepare(r, spi, i);
+        r->xfer.done = NULL;
+        drv_spi_queue_submit(queue, &r->xfer, -1);
+    }
+    drv_spi_queue_flush(queue, -1);
+    t_queue = utils_cpu_ticks() - start;
+    drv_spi_queue_get_stats(queue, &stats);
+    drv_spi_queue_destroy(&queue);
+
+    printf("per segment calls : %8llu transfers/s, 2 ioctls each\n", (unsigned long long)rate(loops, t_calls));
+    printf("chained           : %8llu transfers/s, 1 ioctl each\n", (unsigned long long)rate(loops, t_chain));
+    printf("async queue       : %8llu transfers/s, %llu ioctls, latency max %llu ns mean %llu ns\n",
+           (unsigned long long)rate(loops, t_queue), (unsigned long long)stats.ioctls,
+           (unsigned long long)stats.latency_ns_max, (unsigned long long)stats.latency_ns_mean);
+    TEST_ASSERT((uint64_t)loops == stats.completed && 0 == stats.errors, "Queued benchmark transfers completed");
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    drv_spi_inst_t spi    = NULL;
+    int            spi_id = (1 < argc) ? atoi(argv[1]) : DFT_SPI_ID;
+    int            cs_pin = (2 < argc) ? atoi(argv[2]) : DFT_CS_PIN;
+    int            loops  = (3 < argc) ? atoi(argv[3]) : DFT_LOOPS;
+
+    printf("Starting SPI Chain Tests\n");
+
+    if (0 == spi_id) {
+        drv_fpioa_set_pin_func(15, OSPI_CLK);
+        drv_fpioa_set_pin_func(16, OSPI_D0);
+        drv_fpioa_set_pin_func(17, OSPI_D1);
+    } else if (1 == spi_id) {
+        drv_fpioa_set_pin_func(15, QSPI0_CLK);
+        drv_fpioa_set_pin_func(16, QSPI0_D0);
+        drv_fpioa_set_pin_func(17, QSPI0_D1);
+    } else if (2 == spi_id) {
+        drv_fpioa_set_pin_func(21, QSPI1_CLK);
+        drv_fpioa_set_pin_func(40, QSPI1_D0);
+        drv_fpioa_set_pin_func(41, QSPI1_D1);
+    }
+
+    if (0x00 != drv_spi_inst_create(spi_id, true, SPI_HAL_MODE_0, SPI_BAUDRATE, 8, cs_pin, SPI_HAL_DATA_LINE_1, &spi)) {
+        printf("create spi%d instance failed\n", spi_id);
+        return -1;
+    }
+
+    test_chain(spi);
+    test_queue(spi);
+    bench(spi, (0 < loops) ? loops : DFT_LOOPS);
+
+    drv_spi_inst_destroy(&spi);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,457 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_spi.h"
+#include "drv_spi_queue.h"
+#include "drv_spi_sched.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_spi_sched [loops]
+ *
+ * Needs the two W25Qxx of test_spi_wq128 on spi2 (QSPI1 on pins 21/40/41),
+ * one behind cs 14 clocked at 10 MHz standing in for a display (priority 0)
+ * and one behind cs 11 at 1 MHz standing in for a background logger
+ * (priority 3). Only ids and data are read, the flashes are not written.
+ * The benchmark interleaves both instances through the FIFO queue and the
+ * scheduler and compares chains, config switches and how long the urgent
+ * transfers waited behind the logger.
+ */
+
+#define SPI_ID     (2)
+#define FAST_CS    (14)
+#define SLOW_CS    (11)
+#define DFT_LOOPS  (2000)
+#define POOL_SIZE  (512)
+
+#define CMD_READ_DATA  0x03
+#define CMD_READ_JEDEC 0x9F
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct job {
+    drv_spi_xfer_t xfer;
+    drv_spi_seg_t  segs[2];
+    uint8_t        cmd[4];
+    uint8_t        data[256];
+    char           tag; // 'F' fast device, 'S' slow device
+    int            seq;
+    volatile int   busy;
+};
+
+static drv_spi_inst_t fast, slow;
+static uint32_t       jedec_id;
+
+/* completion log */
+static char         done_tag[256];
+static int          done_seq[256];
+static volatile int done_num;
+static int          bad_results;
+
+/* held in the gate callback until released, so the queue fills up behind it */
+static volatile int gate_closed;
+
+/* urgent transfer latency in the benchmark */
+static uint64_t lat_max, lat_sum, lat_cnt;
+
+static void job_jedec(struct job* j, drv_spi_inst_t inst, char tag, int seq, bool close)
+{
+    memset(j->data, 0, 3);
+    j->cmd[0]            = CMD_READ_JEDEC;
+    j->tag               = tag;
+    j->seq               = seq;
+    j->segs[0].tx        = j->cmd;
+    j->segs[0].rx        = NULL;
+    j->segs[0].len       = 1;
+    j->segs[0].cs_change = false;
+    j->segs[1].tx        = NULL;
+    j->segs[1].rx        = j->data;
+    j->segs[1].len       = 3;
+    j->segs[1].cs_change = close;
+    j->xfer.inst         = inst;
+    j->xfer.segs         = j->segs;
+    j->xfer.count        = 2;
+    j->xfer.done         = NULL;
+    j->xfer.user         = j;
+}
+
+static void job_read(struct job* j, drv_spi_inst_t inst, char tag, int seq, size_t len)
+{
+    job_jedec(j, inst, tag, seq, true);
+    j->cmd[0]       = CMD_READ_DATA;
+    j->cmd[1]       = 0;
+    j->cmd[2]       = 0;
+    j->cmd[3]       = 0;
+    j->segs[0].len  = 4;
+    j->segs[1].len  = len;
+}
+
+static uint32_t job_id(const struct job* j) { return (j->data[0] << 16) | (j->data[1] << 8) | j->data[2]; }
+
+static void log_done(drv_spi_xfer_t* xfer, int result)
+{
+    struct job* j = xfer->user;
+
+    if ((0 > result) || ((CMD_READ_JEDEC == j->cmd[0]) && j->segs[1].cs_change && (jedec_id != job_id(j)))) {
+        bad_results++;
+    }
+    if (done_num < (int)sizeof(done_tag)) {
+        done_tag[done_num] = j->tag;
+        done_seq[done_num] = j->seq;
+    }
+    done_num++;
+}
+
+static void gate_done(drv_spi_xfer_t* xfer, int result)
+{
+    while (gate_closed) {
+        usleep(100);
+    }
+}
+
+static void bench_done(drv_spi_xfer_t* xfer, int result)
+{
+    struct job* j = xfer->user;
+
+    if ('F' == j->tag) {
+        uint64_t lat = utils_cpu_ticks() - xfer->ticks;
+
+        lat_sum += lat;
+        lat_cnt++;
+        lat_max = (lat > lat_max) ? lat : lat_max;
+    }
+    bad_results += (0 > result);
+    j->busy = 0;
+}
+
+static void log_reset(void)
+{
+    done_num    = 0;
+    bad_results = 0;
+}
+
+/* the per instance sequence numbers completed in order */
+static int log_in_order(char tag)
+{
+    int expect = 0;
+
+    for (int i = 0; i < done_num && i < (int)sizeof(done_tag); i++) {
+        if (done_tag[i] == tag && done_seq[i] != expect++) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int test_grouping(drv_spi_sched_t* sched)
+{
+    static struct job jobs[33];
+    spi_sched_stats_t stats;
+
+    printf("\n=== Testing grouping by device ===\n");
+
+    log_reset();
+    gate_closed = 1;
+    job_jedec(&jobs[32], fast, 'G', 0, true);
+    jobs[32].xfer.done = gate_done;
+    TEST_ASSERT(0 == drv_spi_sched_submit(sched, &jobs[32].xfer, 0, -1), "Submit gate");
+    usleep(10000);
+    drv_spi_sched_reset_stats(sched);
+
+    for (int i = 0; i < 16; i++) {
+        job_jedec(&jobs[2 * i], fast, 'F', i, true);
+        job_jedec(&jobs[2 * i + 1], slow, 'S', i, true);
+        jobs[2 * i].xfer.done     = log_done;
+        jobs[2 * i + 1].xfer.done = log_done;
+        drv_spi_sched_submit(sched, &jobs[2 * i].xfer, 2, -1);
+        drv_spi_sched_submit(sched, &jobs[2 * i + 1].xfer, 2, -1);
+    }
+    gate_closed = 0;
+    TEST_ASSERT(0 == drv_spi_sched_flush(sched, 1000), "Interleaved transfers drained");
+    TEST_ASSERT(32 == done_num && 0 == bad_results, "Every transfer read the id");
+    TEST_ASSERT(log_in_order('F') && log_in_order('S'), "Order kept per device");
+
+    drv_spi_sched_get_stats(sched, &stats);
+    printf("32 interleaved transfers: %llu chains, %llu config switches\n", (unsigned long long)stats.chains,
+           (unsigned long long)stats.config_switches);
+    TEST_ASSERT(2 == stats.chains && 1 == stats.config_switches, "One chain per device, one switch");
+
+    return 0;
+}
+
+static int test_priority(drv_spi_sched_t* sched)
+{
+    static struct job jobs[10];
+    spi_sched_stats_t stats;
+
+    printf("\n=== Testing priorities ===\n");
+
+    log_reset();
+    gate_closed = 1;
+    job_jedec(&jobs[9], slow, 'G', 0, true);
+    jobs[9].xfer.done = gate_done;
+    drv_spi_sched_submit(sched, &jobs[9].xfer, 3, -1);
+    usleep(10000);
+
+    for (int i = 0; i < 8; i++) {
+        job_jedec(&jobs[i], slow, 'S', i, true);
+        jobs[i].xfer.done = log_done;
+        drv_spi_sched_submit(sched, &jobs[i].xfer, 3, -1);
+    }
+    job_jedec(&jobs[8], fast, 'F', 0, true);
+    jobs[8].xfer.done = log_done;
+    TEST_ASSERT(0 == drv_spi_sched_submit(sched, &jobs[8].xfer, 0, -1), "Submit urgent transfer last");
+    gate_closed = 0;
+    TEST_ASSERT(0 == drv_spi_sched_flush(sched, 1000) && 9 == done_num, "Queue drained");
+    TEST_ASSERT('F' == done_tag[0], "Urgent transfer overtook the logger");
+
+    drv_spi_sched_get_stats(sched, &stats);
+    TEST_ASSERT(1 <= stats.prio[0].completed && 8 <= stats.prio[3].completed, "Counted per priority");
+    TEST_ASSERT(0 == stats.queued && 9 <= stats.max_queued, "Queue depth counted");
+
+    TEST_ASSERT(-1 == drv_spi_sched_submit(sched, &jobs[0].xfer, SPI_SCHED_PRIO_NUM, 0), "Bad priority rejected");
+
+    return 0;
+}
+
+static int test_aging(void)
+{
+    static struct job       jobs[6];
+    struct spi_sched_config cfg   = { 0 };
+    drv_spi_sched_t*        sched = NULL;
+    spi_sched_stats_t       stats;
+
+    printf("\n=== Testing promotion of waiting transfers ===\n");
+
+    cfg.max_wait_us[3] = 1000;
+    TEST_ASSERT(0 == drv_spi_sched_create(SPI_ID, &cfg, &sched), "Create scheduler with 1 ms limit at priority 3");
+
+    log_reset();
+    gate_closed = 1;
+    job_jedec(&jobs[5], fast, 'G', 0, true);
+    jobs[5].xfer.done = gate_done;
+    drv_spi_sched_submit(sched, &jobs[5].xfer, 0, -1);
+    usleep(10000);
+
+    job_jedec(&jobs[0], slow, 'S', 0, true);
+    jobs[0].xfer.done = log_done;
+    drv_spi_sched_submit(sched, &jobs[0].xfer, 3, -1);
+    for (int i = 1; i < 5; i++) {
+        job_jedec(&jobs[i], fast, 'F', i - 1, true);
+        jobs[i].xfer.done = log_done;
+        drv_spi_sched_submit(sched, &jobs[i].xfer, 0, -1);
+    }
+    usleep(5000);
+    gate_closed = 0;
+    TEST_ASSERT(0 == drv_spi_sched_flush(sched, 1000) && 5 == done_num, "Queue drained");
+    TEST_ASSERT('S' == done_tag[0], "Overdue logger transfer ran first");
+
+    drv_spi_sched_get_stats(sched, &stats);
+    TEST_ASSERT(1 == stats.promotions, "Promotion counted");
+
+    drv_spi_sched_destroy(&sched);
+    TEST_ASSERT(NULL == sched, "Destroy scheduler");
+
+    return 0;
+}
+
+static int test_frame(drv_spi_sched_t* sched)
+{
+    static struct job jobs[3];
+
+    printf("\n=== Testing open cs frames ===\n");
+
+    log_reset();
+    /* command byte only, the frame stays open */
+    job_jedec(&jobs[0], slow, 'S', 0, true);
+    jobs[0].xfer.count     = 1;
+    jobs[0].xfer.done      = log_done;
+    TEST_ASSERT(0 == drv_spi_sched_submit(sched, &jobs[0].xfer, 3, -1) && 0 == drv_spi_sched_flush(sched, 1000),
+                "Frame opened");
+
+    job_jedec(&jobs[1], fast, 'F', 0, true);
+    jobs[1].xfer.done = log_done;
+    drv_spi_sched_submit(sched, &jobs[1].xfer, 0, -1);
+    usleep(5000);
+    TEST_ASSERT(1 == done_num, "Urgent transfer waits for the frame");
+
+    /* the id bytes end the frame */
+    job_jedec(&jobs[2], slow, 'S', 1, true);
+    jobs[2].segs[0]   = jobs[2].segs[1];
+    jobs[2].xfer.count = 1;
+    jobs[2].xfer.done = log_done;
+    drv_spi_sched_submit(sched, &jobs[2].xfer, 3, -1);
+    TEST_ASSERT(0 == drv_spi_sched_flush(sched, 1000) && 3 == done_num, "Queue drained");
+    TEST_ASSERT('S' == done_tag[1] && 'F' == done_tag[2], "Frame ended before the bus moved on");
+    TEST_ASSERT(jedec_id == job_id(&jobs[2]) && jedec_id == job_id(&jobs[1]), "Both read the id");
+
+    return 0;
+}
+
+static int test_sched(void)
+{
+    drv_spi_inst_t    other = NULL;
+    drv_spi_sched_t*  sched = NULL;
+    struct job        j;
+    uint8_t           cmd = CMD_READ_JEDEC, id[3];
+
+    printf("\n=== Testing scheduler ===\n");
+
+    drv_spi_write(fast, &cmd, 1, false);
+    drv_spi_read(fast, id, 3, true);
+    jedec_id = (id[0] << 16) | (id[1] << 8) | id[2];
+    printf("JEDEC ID: 0x%06X\n", jedec_id);
+
+    TEST_ASSERT(-1 == drv_spi_sched_create(SPI_HAL_MAX_DEVICES, NULL, &sched), "Bad bus rejected");
+    TEST_ASSERT(0 == drv_spi_sched_create(SPI_ID, NULL, &sched), "Create scheduler");
+    TEST_ASSERT(SPI_ID == drv_spi_get_id(fast), "Instance reports its bus");
+
+    if (0x00 == drv_spi_inst_create((SPI_ID + 1) % SPI_HAL_MAX_DEVICES, true, SPI_HAL_MODE_0, 1000000, 8, -1,
+                                    SPI_HAL_DATA_LINE_1, &other)) {
+        job_jedec(&j, other, 'O', 0, true);
+        TEST_ASSERT(-1 == drv_spi_sched_submit(sched, &j.xfer, 0, 0), "Instance of another bus rejected");
+        drv_spi_inst_destroy(&other);
+    }
+
+    test_grouping(sched);
+    test_priority(sched);
+    test_frame(sched);
+
+    drv_spi_sched_destroy(&sched);
+    TEST_ASSERT(NULL == sched, "Destroy scheduler");
+
+    test_aging();
+
+    return 0;
+}
+
+static struct job pool[POOL_SIZE];
+
+static struct job* pool_get(int i)
+{
+    struct job* j = &pool[i % POOL_SIZE];
+
+    while (j->busy) {
+        usleep(10);
+    }
+    j->busy = 1;
+
+    return j;
+}
+
+/* every 8th transfer urgent to the fast device, the rest 256 byte logger reads */
+static struct job* bench_job(int i)
+{
+    struct job* j = pool_get(i);
+
+    if (0 == (i & 7)) {
+        job_jedec(j, fast, 'F', i, true);
+    } else {
+        job_read(j, slow, 'S', i, 256);
+    }
+    j->xfer.done = bench_done;
+
+    return j;
+}
+
+static int bench(int loops)
+{
+    drv_spi_queue_t*  queue = NULL;
+    drv_spi_sched_t*  sched = NULL;
+    spi_queue_stats_t qs;
+    spi_sched_stats_t ss;
+    uint64_t          start, t_queue, t_sched;
+    uint64_t          q_lat_max, q_lat_mean;
+
+    printf("\n=== Benchmark, %d transfers, 1 in 8 urgent ===\n", loops);
+
+    lat_max = lat_sum = lat_cnt = 0;
+    bad_results                 = 0;
+    TEST_ASSERT(0 == drv_spi_queue_create(64, &queue), "Create FIFO queue");
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_spi_queue_submit(queue, &bench_job(i)->xfer, -1);
+    }
+    drv_spi_queue_flush(queue, -1);
+    t_queue = utils_cpu_ticks() - start;
+    drv_spi_queue_get_stats(queue, &qs);
+    drv_spi_queue_destroy(&queue);
+    q_lat_max  = lat_max;
+    q_lat_mean = lat_cnt ? lat_sum / lat_cnt : 0;
+
+    lat_max = lat_sum = lat_cnt = 0;
+    TEST_ASSERT(0 == drv_spi_sched_create(SPI_ID, NULL, &sched), "Create scheduler");
+    start = utils_cpu_ticks();
+    for (int i = 0; i < loops; i++) {
+        drv_spi_sched_submit(sched, &bench_job(i)->xfer, (0 == (i & 7)) ? 0 : 3, -1);
+    }
+    drv_spi_sched_flush(sched, -1);
+    t_sched = utils_cpu_ticks() - start;
+    drv_spi_sched_get_stats(sched, &ss);
+    drv_spi_sched_destroy(&sched);
+
+    printf("fifo queue : %6llu transfers/s, %5llu chains, every chain a switch, urgent latency max %llu ns mean %llu ns\n",
+           (unsigned long long)((uint64_t)loops * CPU_TICKS_PER_SECOND / (t_queue ? t_queue : 1)),
+           (unsigned long long)qs.ioctls, (unsigned long long)(q_lat_max * 1000000000ULL / CPU_TICKS_PER_SECOND),
+           (unsigned long long)(q_lat_mean * 1000000000ULL / CPU_TICKS_PER_SECOND));
+    printf("scheduler  : %6llu transfers/s, %5llu chains, %5llu switches, urgent latency max %llu ns mean %llu ns\n",
+           (unsigned long long)((uint64_t)loops * CPU_TICKS_PER_SECOND / (t_sched ? t_sched : 1)),
+           (unsigned long long)ss.chains, (unsigned long long)ss.config_switches,
+           (unsigned long long)(lat_max * 1000000000ULL / CPU_TICKS_PER_SECOND),
+           (unsigned long long)(lat_cnt ? lat_sum / lat_cnt * 1000000000ULL / CPU_TICKS_PER_SECOND : 0));
+    printf("scheduler  : urgent wait max %llu ns, logger wait max %llu ns, bus busy %u.%u%%\n",
+           (unsigned long long)ss.prio[0].wait_ns_max, (unsigned long long)ss.prio[3].wait_ns_max,
+           ss.util_permille / 10, ss.util_permille % 10);
+    TEST_ASSERT((uint64_t)loops == ss.completed && 0 == bad_results, "Benchmark transfers completed");
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = (1 < argc) ? atoi(argv[1]) : DFT_LOOPS;
+
+    printf("Starting SPI Scheduler Tests\n");
+
+    drv_fpioa_set_pin_func(21, QSPI1_CLK);
+    drv_fpioa_set_pin_func(40, QSPI1_D0);
+    drv_fpioa_set_pin_func(41, QSPI1_D1);
+
+    if ((0x00 != drv_spi_inst_create(SPI_ID, true, SPI_HAL_MODE_0, 10 * 1000 * 1000, 8, FAST_CS, SPI_HAL_DATA_LINE_1, &fast))
+        || (0x00 != drv_spi_inst_create(SPI_ID, true, SPI_HAL_MODE_0, 1000 * 1000, 8, SLOW_CS, SPI_HAL_DATA_LINE_1, &slow))) {
+        printf("create spi%d instances failed\n", SPI_ID);
+        return -1;
+    }
+
+    test_sched();
+    bench((0 < loops) ? loops : DFT_LOOPS);
+
+    drv_spi_inst_destroy(&fast);
+    drv_spi_inst_destroy(&slow);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
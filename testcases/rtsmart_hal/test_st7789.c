@@ -0,0 +1,458 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+#include "hal_utils.h"
+#include "st7789.h"
+
+/*
+ * Usage:
+ *   test_st7789 [render_ms]
+ *
+ * Host only. Drives the simulated ST7789 of the board (spi1, cs 19, dc 20,
+ * 320x240) and checks every update against a model of the screen. The
+ * benchmark paces the bus at 50 MHz and compares full screen frames single
+ * and double buffered, with render_ms (default 10) of drawing per frame,
+ * against small widget updates sent as dirty windows, and the byte at a time
+ * RGB888 conversion against the library's.
+ */
+
+#define DFT_RENDER_MS (10)
+
+#define LCD_SPI    (1)
+#define LCD_CS     (19)
+#define LCD_DC     (20)
+#define LCD_WIDTH  (320)
+#define LCD_HEIGHT (240)
+
+#define SPI_BAUDRATE  (50 * 1000 * 1000)
+#define FULL_FRAMES   (15)
+#define WIDGET_FRAMES (200)
+#define CONVERT_LOOPS (50)
+
+#define COLOR_RED   0xF800
+#define COLOR_GREEN 0x07E0
+#define COLOR_BLUE  0x001F
+#define COLOR_WHITE 0xFFFF
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static uint16_t model[LCD_HEIGHT][LCD_WIDTH];
+static uint8_t  screen[LCD_HEIGHT * LCD_WIDTH * 3];
+static uint8_t  out[LCD_HEIGHT * LCD_WIDTH * 2];
+
+static uint16_t rgb888_to_rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+static void set_config(struct st7789_config* cfg, int double_buffer)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->spi_id        = LCD_SPI;
+    cfg->cs_pin        = LCD_CS;
+    cfg->dc_pin        = LCD_DC;
+    cfg->rst_pin       = -1;
+    cfg->bl_pin        = -1;
+    cfg->baudrate      = SPI_BAUDRATE;
+    cfg->width         = LCD_WIDTH;
+    cfg->height        = LCD_HEIGHT;
+    cfg->vflip         = 1;
+    cfg->double_buffer = double_buffer;
+}
+
+static void model_fill(int x, int y, int w, int h, uint16_t color)
+{
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) {
+            if ((0 <= i) && (i < LCD_WIDTH) && (0 <= j) && (j < LCD_HEIGHT)) {
+                model[j][i] = color;
+            }
+        }
+    }
+}
+
+static void fill(st7789_t* lcd, int x, int y, int w, int h, uint16_t color)
+{
+    st7789_fill_rect(lcd, x, y, w, h, color);
+    model_fill(x, y, w, h, color);
+}
+
+/* @w x @h RGB888 or BGR888 pixels, @pitch bytes per row */
+static void gradient(uint8_t* p, int w, int h, size_t pitch, int bgr, int seed)
+{
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            uint8_t* px = p + j * pitch + i * 3;
+
+            px[bgr ? 2 : 0] = (i * 7 + seed) & 0xFF;
+            px[1]           = (j * 5 + seed * 3) & 0xFF;
+            px[bgr ? 0 : 2] = (i * j + seed) & 0xFF;
+        }
+    }
+}
+
+static void model_blit(int x, int y, int w, int h, const uint8_t* p, size_t pitch, int bgr)
+{
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            const uint8_t* px = p + j * pitch + i * 3;
+
+            model_fill(x + i, y + j, 1, 1, rgb888_to_rgb565(px[bgr ? 2 : 0], px[1], px[bgr ? 0 : 2]));
+        }
+    }
+}
+
+static int panel_mismatches(struct hal_sim_lcd* sim)
+{
+    int bad = 0;
+
+    for (int y = 0; y < LCD_HEIGHT; y++) {
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            bad += (hal_sim_lcd_pixel(sim, x, y) != model[y][x]);
+        }
+    }
+
+    return bad;
+}
+
+static int test_convert(void)
+{
+    uint8_t  src[67 * 3], dst[67 * 2 + 2];
+    uint16_t src565[67];
+    int      ok = 1;
+
+    printf("\n=== Testing pixel conversion ===\n");
+
+    for (size_t i = 0; i < sizeof(src); i++) {
+        src[i] = (uint8_t)(i * 37 + 11);
+    }
+    for (int i = 0; i < 67; i++) {
+        src565[i] = (uint16_t)(i * 1021 + 7);
+    }
+
+    for (int fmt = ST7789_PIXEL_RGB565; fmt <= ST7789_PIXEL_BGR888; fmt++) {
+        for (int n = 0; n <= 67; n++) {
+            memset(dst, 0xA5, sizeof(dst));
+            st7789_convert(dst, (ST7789_PIXEL_RGB565 == fmt) ? (const void*)src565 : (const void*)src, n, fmt);
+            for (int i = 0; i < n; i++) {
+                const uint8_t* px = &src[i * 3];
+                uint16_t       c  = (ST7789_PIXEL_RGB565 == fmt) ? src565[i]
+                                    : (ST7789_PIXEL_RGB888 == fmt) ? rgb888_to_rgb565(px[0], px[1], px[2])
+                                                                   : rgb888_to_rgb565(px[2], px[1], px[0]);
+
+                ok &= (dst[i * 2] == (c >> 8)) && (dst[i * 2 + 1] == (c & 0xFF));
+            }
+            ok &= (0xA5 == dst[n * 2]) && (0xA5 == dst[n * 2 + 1]);
+        }
+    }
+    TEST_ASSERT(ok, "RGB565, RGB888 and BGR888 to panel order for 0~67 pixels");
+
+    return 0;
+}
+
+static int test_dirty(struct hal_sim_lcd* sim)
+{
+    struct st7789_config     cfg;
+    struct hal_sim_lcd_stats lstats;
+    st7789_t*                lcd = NULL;
+    st7789_stats_t           stats;
+    static uint8_t           src[48][80 * 3];
+    uint64_t                 ram_writes;
+    int                      w, h;
+
+    printf("\n=== Testing dirty windows ===\n");
+
+    set_config(&cfg, 0);
+    cfg.width = 400;
+    TEST_ASSERT(0 > st7789_create(&cfg, &lcd), "Wider than the controller refused");
+
+    set_config(&cfg, 0);
+    memset(model, 0, sizeof(model));
+    TEST_ASSERT(0 == st7789_create(&cfg, &lcd), "Create single buffered");
+    TEST_ASSERT(0 == st7789_get_size(lcd, &w, &h) && LCD_WIDTH == w && LCD_HEIGHT == h, "Size as configured");
+    TEST_ASSERT(hal_sim_lcd_display_on(sim), "Display on");
+    TEST_ASSERT(0xA0 == hal_sim_lcd_madctl(sim), "MADCTL landscape with vflip");
+
+    /* leftovers of an earlier run on the panel */
+    st7789_flush(lcd);
+    st7789_get_stats(lcd, &stats);
+    TEST_ASSERT(1 == stats.windows && LCD_WIDTH * LCD_HEIGHT == stats.pixels, "First flush clears the screen");
+    TEST_ASSERT(0 == panel_mismatches(sim), "Panel black");
+
+    st7789_reset_stats(lcd);
+    fill(lcd, 10, 10, 20, 20, COLOR_RED);
+    fill(lcd, 250, 180, 30, 30, COLOR_BLUE);
+    TEST_ASSERT(0 == st7789_flush(lcd), "Flush two distant rectangles");
+    st7789_get_stats(lcd, &stats);
+    TEST_ASSERT(2 == stats.windows && 400 + 900 == stats.pixels, "Two windows, only their pixels");
+    TEST_ASSERT(0 == panel_mismatches(sim), "Panel matches");
+
+    st7789_reset_stats(lcd);
+    fill(lcd, 100, 100, 20, 10, COLOR_GREEN);
+    fill(lcd, 120, 100, 20, 10, COLOR_WHITE);
+    fill(lcd, 50, 50, 40, 40, COLOR_RED);
+    fill(lcd, 60, 60, 10, 10, COLOR_BLUE);
+    st7789_flush(lcd);
+    st7789_get_stats(lcd, &stats);
+    TEST_ASSERT(2 == stats.windows && 2 == stats.merges && 400 + 1600 == stats.pixels,
+                "Neighbours and a covered rectangle merge");
+    TEST_ASSERT(0 == panel_mismatches(sim), "Panel matches");
+
+    st7789_reset_stats(lcd);
+    for (int i = 0; i < 40; i++) {
+        fill(lcd, (i % 8) * 40 + 3, (i / 8) * 48 + 5, 8, 8, COLOR_WHITE);
+    }
+    st7789_flush(lcd);
+    st7789_get_stats(lcd, &stats);
+    TEST_ASSERT(ST7789_MAX_DIRTY == stats.windows && 40 * 64 < stats.pixels, "More dots than windows fold together");
+    TEST_ASSERT(0 == panel_mismatches(sim), "Panel matches");
+
+    st7789_reset_stats(lcd);
+    fill(lcd, -10, -10, 20, 20, COLOR_GREEN);
+    fill(lcd, 310, 230, 50, 50, COLOR_GREEN);
+    fill(lcd, 400, 10, 10, 10, COLOR_GREEN);
+    st7789_flush(lcd);
+    st7789_get_stats(lcd, &stats);
+    TEST_ASSERT(2 == stats.windows && 200 == stats.pixels, "Clipped to the screen");
+    TEST_ASSERT(0 == panel_mismatches(sim), "Panel matches");
+
+    gradient(&src[0][0], 80, 48, sizeof(src[0]), 0, 1);
+    TEST_ASSERT(0 == st7789_blit(lcd, 200, 20, 64, 48, src, sizeof(src[0]), ST7789_PIXEL_RGB888), "Blit with pitch");
+    model_blit(200, 20, 64, 48, &src[0][0], sizeof(src[0]), 0);
+    st7789_blit(lcd, 290, 220, 80, 48, src, sizeof(src[0]), ST7789_PIXEL_RGB888);
+    model_blit(290, 220, 80, 48, &src[0][0], sizeof(src[0]), 0);
+    st7789_blit(lcd, -20, 100, 80, 20, src, sizeof(src[0]), ST7789_PIXEL_RGB888);
+    model_blit(-20, 100, 80, 20, &src[0][0], sizeof(src[0]), 0);
+    st7789_flush(lcd);
+    TEST_ASSERT(0 == panel_mismatches(sim), "Clipped blits match");
+
+    hal_sim_lcd_get_stats(sim, &lstats);
+    ram_writes = lstats.ram_writes;
+    TEST_ASSERT(0 == st7789_flush(lcd), "Flush with nothing dirty");
+    hal_sim_lcd_get_stats(sim, &lstats);
+    TEST_ASSERT(ram_writes == lstats.ram_writes, "Nothing sent");
+
+    st7789_destroy(&lcd);
+    TEST_ASSERT(NULL == lcd, "Destroy");
+
+    return 0;
+}
+
+static int test_double(struct hal_sim_lcd* sim)
+{
+    struct st7789_config cfg;
+    st7789_t*            lcd = NULL;
+    st7789_stats_t       stats;
+    uint8_t*             fb;
+    int                  ok = 1;
+
+    printf("\n=== Testing double buffering ===\n");
+
+    set_config(&cfg, 1);
+    TEST_ASSERT(0 == st7789_create(&cfg, &lcd), "Create double buffered");
+    memset(model, 0, sizeof(model));
+    fb = st7789_get_framebuffer(lcd);
+    TEST_ASSERT(0 == st7789_flush(lcd) && fb != st7789_get_framebuffer(lcd), "Flush swaps the framebuffers");
+
+    /* a square moving over a bar drawn once, every frame only changes a bit */
+    fill(lcd, 0, 100, LCD_WIDTH, 20, COLOR_BLUE);
+    for (int i = 0; i < 12; i++) {
+        if (i) {
+            fill(lcd, (i - 1) * 20, 90, 16, 10, 0);
+            fill(lcd, (i - 1) * 20, 100, 16, 6, COLOR_BLUE);
+        }
+        fill(lcd, i * 20, 90, 16, 16, COLOR_RED);
+        ok &= (0 == st7789_flush(lcd));
+    }
+    TEST_ASSERT(ok, "Flush 12 frames");
+    TEST_ASSERT(0 == st7789_wait(lcd), "Wait for the last frame");
+    TEST_ASSERT(0 == panel_mismatches(sim), "Panel shows the last frame");
+
+    st7789_get_stats(lcd, &stats);
+    TEST_ASSERT(13 == stats.frames && 0 < stats.copied_pixels, "Every frame sent, both framebuffers kept in step");
+
+    /* the frame after a swap starts out as the one sent */
+    fill(lcd, 5, 5, 4, 4, COLOR_GREEN);
+    st7789_flush(lcd);
+    fill(lcd, 300, 5, 4, 4, COLOR_GREEN);
+    st7789_flush(lcd);
+    st7789_wait(lcd);
+    TEST_ASSERT(0 == panel_mismatches(sim), "Nothing older comes back");
+
+    /* the error of a frame still on the bus is not lost to a command */
+    fill(lcd, 100, 100, 8, 8, COLOR_RED);
+    hal_sim_spi_fail(LCD_SPI, 1);
+    TEST_ASSERT(0 == st7789_flush(lcd), "Flush hands the frame over");
+    TEST_ASSERT(-2 == st7789_command(lcd, 0x29, NULL, 0), "Command reports the failed frame");
+    TEST_ASSERT(0 == st7789_command(lcd, 0x29, NULL, 0) && 0 == st7789_wait(lcd), "Error reported once");
+
+    st7789_destroy(&lcd);
+
+    return 0;
+}
+
+static int test_lvgl(struct hal_sim_lcd* sim)
+{
+    struct st7789_config cfg;
+    st7789_t*            lcd = NULL;
+    static uint8_t       area[30][40 * 3];
+
+    printf("\n=== Testing LVGL flush ===\n");
+
+    set_config(&cfg, 1);
+    TEST_ASSERT(0 == st7789_create(&cfg, &lcd), "Create double buffered");
+    memset(model, 0, sizeof(model));
+
+    /* partial render mode, px_map holds just the area, two areas per frame */
+    gradient(&area[0][0], 40, 30, sizeof(area[0]), 1, 9);
+    TEST_ASSERT(0 == st7789_lvgl_flush(lcd, 5, 200, 44, 229, &area[0][0], 0, ST7789_PIXEL_BGR888, 0),
+                "Partial area, not last");
+    model_blit(5, 200, 40, 30, &area[0][0], sizeof(area[0]), 1);
+    TEST_ASSERT(0 == st7789_lvgl_flush(lcd, 60, 200, 79, 209, &area[0][0], 0, ST7789_PIXEL_BGR888, 1),
+                "Partial area, last");
+    model_blit(60, 200, 20, 10, &area[0][0], 20 * 3, 1);
+    st7789_wait(lcd);
+    TEST_ASSERT(0 == panel_mismatches(sim), "Partial mode frame on the panel");
+
+    /* direct mode, px_map is the whole screen */
+    gradient(screen, LCD_WIDTH, LCD_HEIGHT, LCD_WIDTH * 3, 1, 3);
+    TEST_ASSERT(0 == st7789_lvgl_flush(lcd, 150, 60, 189, 99, screen, LCD_WIDTH * 3, ST7789_PIXEL_BGR888, 1),
+                "Direct mode area");
+    model_blit(150, 60, 40, 40, screen + 60 * LCD_WIDTH * 3 + 150 * 3, LCD_WIDTH * 3, 1);
+    st7789_wait(lcd);
+    TEST_ASSERT(0 == panel_mismatches(sim), "Direct mode frame on the panel");
+
+    st7789_destroy(&lcd);
+
+    return 0;
+}
+
+static double bench_frames(st7789_t* lcd, int frames, int full, int render_ms)
+{
+    uint64_t start = utils_cpu_ticks();
+
+    for (int i = 0; i < frames; i++) {
+        if (full) {
+            gradient(screen, LCD_WIDTH, LCD_HEIGHT, LCD_WIDTH * 3, 0, i);
+            usleep(render_ms * 1000);
+            st7789_blit(lcd, 0, 0, LCD_WIDTH, LCD_HEIGHT, screen, 0, ST7789_PIXEL_RGB888);
+        } else {
+            /* a 64x32 counter box and its moving marker */
+            st7789_fill_rect(lcd, 240, 8, 64, 32, COLOR_BLUE);
+            st7789_fill_rect(lcd, 240 + (i % 48), 16, 16, 16, (uint16_t)(i * 2731));
+        }
+        st7789_flush(lcd);
+    }
+    st7789_wait(lcd);
+
+    return (double)frames * CPU_TICKS_PER_SECOND / (utils_cpu_ticks() - start);
+}
+
+static int bench(int render_ms)
+{
+    struct st7789_config cfg;
+    st7789_t*            lcd = NULL;
+    st7789_stats_t       stats;
+    uint64_t             start, naive, fast;
+    double               fps_single, fps_double, fps_widget;
+
+    printf("\n=== Benchmark at %d MHz, %d ms render per full frame ===\n", SPI_BAUDRATE / 1000000, render_ms);
+
+    gradient(screen, LCD_WIDTH, LCD_HEIGHT, LCD_WIDTH * 3, 0, 5);
+    start = utils_cpu_ticks();
+    for (int n = 0; n < CONVERT_LOOPS; n++) {
+        for (int i = 0; i < LCD_WIDTH * LCD_HEIGHT; i++) {
+            uint16_t c = rgb888_to_rgb565(screen[i * 3], screen[i * 3 + 1], screen[i * 3 + 2]);
+
+            out[i * 2]     = c >> 8;
+            out[i * 2 + 1] = c & 0xFF;
+        }
+        __asm__ volatile("" ::: "memory");
+    }
+    naive = utils_cpu_ticks() - start;
+    start = utils_cpu_ticks();
+    for (int n = 0; n < CONVERT_LOOPS; n++) {
+        st7789_convert(out, screen, LCD_WIDTH * LCD_HEIGHT, ST7789_PIXEL_RGB888);
+        __asm__ volatile("" ::: "memory");
+    }
+    fast = utils_cpu_ticks() - start;
+    printf("RGB888 convert, per pixel   : %7.1f Mpixel/s\n",
+           (double)CONVERT_LOOPS * LCD_WIDTH * LCD_HEIGHT * CPU_TICKS_PER_SECOND / naive / 1e6);
+    printf("RGB888 convert, 4 per step  : %7.1f Mpixel/s\n",
+           (double)CONVERT_LOOPS * LCD_WIDTH * LCD_HEIGHT * CPU_TICKS_PER_SECOND / fast / 1e6);
+
+    hal_sim_spi_set_pacing(LCD_SPI, 1);
+
+    set_config(&cfg, 0);
+    TEST_ASSERT(0 == st7789_create(&cfg, &lcd), "Create single buffered");
+    st7789_flush(lcd);
+    fps_single = bench_frames(lcd, FULL_FRAMES, 1, render_ms);
+    st7789_destroy(&lcd);
+
+    set_config(&cfg, 1);
+    TEST_ASSERT(0 == st7789_create(&cfg, &lcd), "Create double buffered");
+    st7789_flush(lcd);
+    st7789_wait(lcd);
+    st7789_reset_stats(lcd);
+    fps_double = bench_frames(lcd, FULL_FRAMES, 1, render_ms);
+    st7789_get_stats(lcd, &stats);
+    printf("full screen, single buffered: %7.1f fps\n", fps_single);
+    printf("full screen, double buffered: %7.1f fps, %llu us on the bus, %llu us waited per frame\n", fps_double,
+           (unsigned long long)(stats.tx_ns / stats.frames / 1000),
+           (unsigned long long)(stats.wait_ns / stats.frames / 1000));
+
+    st7789_reset_stats(lcd);
+    fps_widget = bench_frames(lcd, WIDGET_FRAMES, 0, 0);
+    st7789_get_stats(lcd, &stats);
+    st7789_destroy(&lcd);
+    printf("64x32 widget, dirty windows : %7.1f fps, %llu pixels and %llu windows per frame\n", fps_widget,
+           (unsigned long long)(stats.pixels / stats.frames), (unsigned long long)(stats.windows / stats.frames));
+
+    hal_sim_spi_set_pacing(LCD_SPI, 0);
+
+    TEST_ASSERT(fps_widget > fps_single * 5, "Widget updates beat full frames");
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int                 render_ms = (1 < argc) ? atoi(argv[1]) : DFT_RENDER_MS;
+    struct hal_sim_lcd* sim       = hal_sim_board_lcd();
+
+    printf("Starting ST7789 Library Tests\n");
+
+    if (!sim) {
+        printf("simulated lcd missing\n");
+        return -1;
+    }
+
+    test_convert();
+    test_dirty(sim);
+    test_double(sim);
+    test_lvgl(sim);
+    bench((0 <= render_ms) ? render_ms : DFT_RENDER_MS);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,253 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* force the trace points on for this test, regardless of the HAL config */
+#ifndef HAL_TRACE_ENABLE
+#define HAL_TRACE_ENABLE
+#endif
+
+#include "hal_dispatch.h"
+#include "hal_trace.h"
+#include "hal_utils.h"
+
+#define TEST_THREADS      (4)
+#define TEST_LOOPS        (1000)
+#define TEST_BENCH_EVENTS (100000)
+#define TEST_TRACE_FILE   "/tmp/hal_trace.json"
+
+// 测试结果统计
+static int test_passed = 0;
+static int test_failed = 0;
+
+// 测试宏
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static void traced_work(int i)
+{
+    HAL_TRACE_FUNC();
+
+    if (0 == (i % 100)) {
+        HAL_TRACE_INSTANT("checkpoint", i);
+    }
+}
+
+static void* worker(void* args)
+{
+    char name[16];
+
+    snprintf(name, sizeof(name), "worker%d", (int)(intptr_t)args);
+    hal_trace_set_thread_name(name);
+
+    for (int i = 0; i < TEST_LOOPS; i++) {
+        traced_work(i);
+        HAL_TRACE_COUNTER("loop", i);
+    }
+
+    return NULL;
+}
+
+static int test_record_and_dump(void)
+{
+    pthread_t              threads[TEST_THREADS];
+    struct hal_trace_stats stats;
+    char                   line[256];
+    FILE*                  fp;
+    int                    begins = 0, ends = 0;
+
+    printf("\n=== Testing trace record and dump ===\n");
+
+    TEST_ASSERT(0 == hal_trace_start(TEST_LOOPS * 4), "Start tracing");
+
+    for (int i = 0; i < TEST_THREADS; i++) {
+        pthread_create(&threads[i], NULL, worker, (void*)(intptr_t)i);
+    }
+    for (int i = 0; i < TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    hal_trace_stop();
+
+    hal_trace_get_stats(&stats);
+    /* begin + end + counter per loop, one instant every 100 loops */
+    TEST_ASSERT(stats.threads == TEST_THREADS, "One buffer per thread");
+    TEST_ASSERT(stats.recorded == TEST_THREADS * (TEST_LOOPS * 3 + TEST_LOOPS / 100), "All events recorded");
+    TEST_ASSERT(stats.overwritten == 0 && stats.dropped == 0, "No events lost");
+
+    /* stopped, nothing is recorded */
+    uint64_t recorded = stats.recorded;
+    traced_work(0);
+    hal_trace_get_stats(&stats);
+    TEST_ASSERT(stats.recorded == recorded, "Disabled trace points record nothing");
+
+    TEST_ASSERT(0 == hal_trace_dump(TEST_TRACE_FILE), "Dump chrome trace");
+
+    fp = fopen(TEST_TRACE_FILE, "r");
+    TEST_ASSERT(fp != NULL, "Open dumped trace");
+    while (fgets(line, sizeof(line), fp)) {
+        if (strstr(line, "\"ph\":\"B\"")) {
+            begins++;
+        } else if (strstr(line, "\"ph\":\"E\"")) {
+            ends++;
+        }
+    }
+    fclose(fp);
+    TEST_ASSERT(begins == TEST_THREADS * TEST_LOOPS && begins == ends, "Begin and end events balanced");
+
+    hal_trace_reset();
+    hal_trace_get_stats(&stats);
+    TEST_ASSERT(stats.recorded == 0, "Reset discards events");
+
+    return 0;
+}
+
+static void* short_worker(void* args)
+{
+    HAL_TRACE_INSTANT("short", (intptr_t)args);
+
+    return NULL;
+}
+
+static void traced_callback(void* args)
+{
+    HAL_TRACE_INSTANT("callback", (intptr_t)args);
+}
+
+static void traced_signal(int signo)
+{
+    hal_trace_signal_enter();
+    HAL_TRACE_INSTANT("signal", signo);
+    hal_trace_signal_leave();
+}
+
+static void* signal_worker(void* args)
+{
+    struct hal_trace_stats* stats = args;
+
+    /* a signal mode callback of a thread without a buffer must not allocate one */
+    hal_dispatch_deliver(HAL_DISPATCH_SIGNAL, traced_callback, NULL);
+    hal_trace_get_stats(&stats[0]);
+
+    HAL_TRACE_INSTANT("thread", 0);
+    hal_dispatch_deliver(HAL_DISPATCH_SIGNAL, traced_callback, (void*)1);
+    raise(SIGUSR1);
+    hal_trace_get_stats(&stats[1]);
+
+    return NULL;
+}
+
+static int test_signal_context(void)
+{
+    pthread_t              thread;
+    struct hal_trace_stats base, stats[2];
+
+    printf("\n=== Testing trace points in signal context ===\n");
+
+    signal(SIGUSR1, traced_signal);
+    hal_trace_start(16);
+    hal_trace_get_stats(&base);
+    pthread_create(&thread, NULL, signal_worker, stats);
+    pthread_join(thread, NULL);
+    hal_trace_stop();
+    signal(SIGUSR1, SIG_DFL);
+
+    TEST_ASSERT(stats[0].threads == base.threads && stats[0].dropped == base.dropped + 1,
+                "No buffer set up in a signal mode callback, its event is dropped");
+    TEST_ASSERT(stats[1].threads == base.threads + 1 && stats[1].recorded == base.recorded + 3
+                    && stats[1].dropped == stats[0].dropped,
+                "Callback and signal handler record into the existing buffer");
+
+    hal_trace_reset();
+
+    return 0;
+}
+
+static int test_thread_recycle(void)
+{
+    pthread_t              thread;
+    struct hal_trace_stats stats;
+
+    printf("\n=== Testing buffer reuse after thread exit ===\n");
+
+    hal_trace_start(16);
+
+    /* more threads than buffers, each one exits before the next starts */
+    for (int i = 0; i < HAL_TRACE_MAX_THREADS * 2; i++) {
+        pthread_create(&thread, NULL, short_worker, (void*)(intptr_t)i);
+        pthread_join(thread, NULL);
+    }
+    hal_trace_stop();
+
+    hal_trace_get_stats(&stats);
+    TEST_ASSERT(stats.threads <= HAL_TRACE_MAX_THREADS, "Buffers stay bounded");
+    TEST_ASSERT(stats.dropped == 0, "Exited threads hand their buffers on");
+
+    TEST_ASSERT(0 == hal_trace_dump(TEST_TRACE_FILE), "Dump trace with reused buffers");
+
+    hal_trace_reset();
+
+    return 0;
+}
+
+static int test_overhead(void)
+{
+    struct hal_trace_stats stats;
+    uint64_t               start, off, on;
+
+    printf("\n=== Measuring trace point overhead ===\n");
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < TEST_BENCH_EVENTS; i++) {
+        HAL_TRACE_INSTANT("bench", i);
+    }
+    off = utils_cpu_ticks() - start;
+
+    hal_trace_start(0);
+    start = utils_cpu_ticks();
+    for (int i = 0; i < TEST_BENCH_EVENTS; i++) {
+        HAL_TRACE_INSTANT("bench", i);
+    }
+    on = utils_cpu_ticks() - start;
+    hal_trace_stop();
+
+    hal_trace_get_stats(&stats);
+    TEST_ASSERT(stats.overwritten > 0, "Ring buffer wraps instead of blocking");
+
+    printf("disabled : %llu ns/event\n",
+           (unsigned long long)(off * 1000000000ULL / CPU_TICKS_PER_SECOND / TEST_BENCH_EVENTS));
+    printf("enabled  : %llu ns/event\n",
+           (unsigned long long)(on * 1000000000ULL / CPU_TICKS_PER_SECOND / TEST_BENCH_EVENTS));
+
+    hal_trace_reset();
+
+    return 0;
+}
+
+int main(void)
+{
+    printf("Starting HAL Trace Tests\n");
+
+    test_record_and_dump();
+    test_signal_context();
+    test_thread_recycle();
+    test_overhead();
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
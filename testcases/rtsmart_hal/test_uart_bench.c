@@ -0,0 +1,349 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_uart.h"
+#include "drv_uart_bench.h"
+
+/*
+ * UART throughput and round trip benchmark.
+ *
+ * Usage: test_uart_bench [options]
+ *   -a <port>     sending port, a uart id or a device path, default 2
+ *   -b <port>     receiving and echoing port, default 3, "none" when the far
+ *                 end of -a echoes by itself (loopback plug, remote echo)
+ *   -B <baud>     line rate, default 115200
+ *   -s <sizes>    message sizes, default 1,16,64,256,1024,4096
+ *   -z <sizes>    driver buffer sizes to sweep with drv_uart_configure_buffer_size(),
+ *                 default 0 (keep the current one), uart ids only
+ *   -t <ms>       line time per throughput point, default 500
+ *   -n <count>    round trips per size, default 100
+ *   -f <format>   text, json (one object per line) or csv, default text
+ *   -o <file>     write the results there instead of stdout
+ *
+ * The default ports are UART2 TX/RX (pins 11/12) wired to UART3 RX/TX (pins
+ * 51/50) like test_uart, on the host the simulator crosses the two ptys. A
+ * throughput point streams the bytes the line carries in -t at -B baud,
+ * checking every byte. cpu is process cpu time per wall time, all threads.
+ */
+
+#define UART2_TX_PIN 11
+#define UART2_RX_PIN 12
+#define UART3_TX_PIN 50
+#define UART3_RX_PIN 51
+
+#define DFT_BAUD     (115200)
+#define DFT_SIZES    "1,16,64,256,1024,4096"
+#define DFT_BUFSZ    "0"
+#define DFT_TIME_MS  (500)
+#define DFT_RTT      (100)
+#define TIMEOUT_MS   (2000)
+#define MAX_POINTS   (16)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+enum { FMT_TEXT, FMT_JSON, FMT_CSV };
+
+static struct {
+    const char* port_a;
+    const char* port_b;
+    uint32_t    baud;
+    uint32_t    sizes[MAX_POINTS], bufsz[MAX_POINTS];
+    int         num_sizes, num_bufsz;
+    int         time_ms;
+    int         rtt_count;
+    int         format;
+    FILE*       out;
+} opts;
+
+static drv_uart_inst_t* port_a = NULL;
+static drv_uart_inst_t* port_b = NULL;
+
+static int parse_list(const char* arg, uint32_t* list)
+{
+    int n = 0;
+
+    for (const char* p = arg; p && *p && (n < MAX_POINTS); p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+        list[n++] = strtoul(p, NULL, 0);
+    }
+
+    return n;
+}
+
+static int port_id(const char* port)
+{
+    char* end;
+    long  id = strtol(port, &end, 0);
+
+    return ('\0' == *end) ? (int)id : -1;
+}
+
+static int open_port(const char* port, drv_uart_inst_t** inst)
+{
+    struct uart_configure cfg;
+    int                   id = port_id(port);
+
+    if (0x00 != ((0 <= id) ? drv_uart_inst_create(id, inst) : drv_uart_inst_create_usb(port, inst))) {
+        return -1;
+    }
+    drv_uart_get_config(*inst, &cfg);
+    cfg.baud_rate = opts.baud;
+
+    return drv_uart_set_config(*inst, &cfg);
+}
+
+static void close_ports(void)
+{
+    if (port_a) {
+        drv_uart_inst_destroy(&port_a);
+    }
+    if (port_b) {
+        drv_uart_inst_destroy(&port_b);
+    }
+}
+
+/* buffer size 0 keeps what the driver has, -2 when the driver refuses the size */
+static int open_ports(uint32_t bufsz)
+{
+    close_ports();
+
+    if (bufsz) {
+        if ((0 > port_id(opts.port_a)) || (0x00 != drv_uart_configure_buffer_size(port_id(opts.port_a), bufsz))) {
+            return -2;
+        }
+        if (opts.port_b && (0 <= port_id(opts.port_b))
+            && (0x00 != drv_uart_configure_buffer_size(port_id(opts.port_b), bufsz))) {
+            return -2;
+        }
+    }
+
+    if (0x00 != open_port(opts.port_a, &port_a)) {
+        return -1;
+    }
+    if (opts.port_b && (0x00 != open_port(opts.port_b, &port_b))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void emit_tput(uint32_t bufsz, const uart_bench_tput_t* r)
+{
+    static int header;
+    uint64_t   line = opts.baud / 10; // 10 bit characters
+
+    switch (opts.format) {
+    case FMT_JSON:
+        fprintf(opts.out,
+                "{\"test\":\"throughput\",\"port_a\":\"%s\",\"port_b\":\"%s\",\"baud\":%u,\"bufsz\":%u,\"msg_size\":%u,"
+                "\"bytes\":%llu,\"elapsed_ns\":%llu,\"bytes_per_sec\":%llu,\"writes\":%llu,\"write_waits\":%llu,"
+                "\"reads\":%llu,\"polls\":%llu,\"errors\":%llu,\"cpu_permille\":%d}\n",
+                opts.port_a, opts.port_b ? opts.port_b : "none", opts.baud, bufsz, r->msg_size,
+                (unsigned long long)r->bytes, (unsigned long long)r->elapsed_ns, (unsigned long long)r->bytes_per_sec,
+                (unsigned long long)r->writes, (unsigned long long)r->write_waits, (unsigned long long)r->reads,
+                (unsigned long long)r->polls, (unsigned long long)r->errors, r->cpu_permille);
+        break;
+    case FMT_CSV:
+        if (!header++) {
+            fprintf(opts.out, "throughput,baud,bufsz,msg_size,bytes,elapsed_ns,bytes_per_sec,writes,write_waits,reads,"
+                              "polls,errors,cpu_permille\n");
+        }
+        fprintf(opts.out, "throughput,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%d\n", opts.baud, bufsz,
+                r->msg_size, (unsigned long long)r->bytes, (unsigned long long)r->elapsed_ns,
+                (unsigned long long)r->bytes_per_sec, (unsigned long long)r->writes,
+                (unsigned long long)r->write_waits, (unsigned long long)r->reads, (unsigned long long)r->polls,
+                (unsigned long long)r->errors, r->cpu_permille);
+        break;
+    default:
+        fprintf(opts.out,
+                "throughput bufsz %5u msg %5u: %8llu B/s (%3llu%% of line), %6llu writes %6llu waits %6llu reads "
+                "%6llu polls, cpu %d.%d%%\n",
+                bufsz, r->msg_size, (unsigned long long)r->bytes_per_sec,
+                (unsigned long long)(r->bytes_per_sec * 100 / line), (unsigned long long)r->writes,
+                (unsigned long long)r->write_waits, (unsigned long long)r->reads, (unsigned long long)r->polls,
+                r->cpu_permille / 10, (0 > r->cpu_permille) ? 0 : r->cpu_permille % 10);
+        break;
+    }
+}
+
+static void emit_rtt(uint32_t bufsz, const uart_bench_rtt_t* r)
+{
+    static int header;
+
+    switch (opts.format) {
+    case FMT_JSON:
+        fprintf(opts.out,
+                "{\"test\":\"rtt\",\"port_a\":\"%s\",\"port_b\":\"%s\",\"baud\":%u,\"bufsz\":%u,\"msg_size\":%u,"
+                "\"count\":%u,\"timeouts\":%u,\"errors\":%u,\"min_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,"
+                "\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu,\"mean_ns\":%llu,\"cpu_permille\":%d}\n",
+                opts.port_a, opts.port_b ? opts.port_b : "none", opts.baud, bufsz, r->msg_size, r->count, r->timeouts,
+                r->errors, (unsigned long long)r->rtt_ns_min, (unsigned long long)r->rtt_ns_p50,
+                (unsigned long long)r->rtt_ns_p90, (unsigned long long)r->rtt_ns_p99,
+                (unsigned long long)r->rtt_ns_p999, (unsigned long long)r->rtt_ns_max,
+                (unsigned long long)r->rtt_ns_mean, r->cpu_permille);
+        break;
+    case FMT_CSV:
+        if (!header++) {
+            fprintf(opts.out, "rtt,baud,bufsz,msg_size,count,timeouts,errors,min_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,"
+                              "mean_ns,cpu_permille\n");
+        }
+        fprintf(opts.out, "rtt,%u,%u,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%d\n", opts.baud, bufsz,
+                r->msg_size, r->count, r->timeouts, r->errors, (unsigned long long)r->rtt_ns_min,
+                (unsigned long long)r->rtt_ns_p50, (unsigned long long)r->rtt_ns_p90,
+                (unsigned long long)r->rtt_ns_p99, (unsigned long long)r->rtt_ns_p999,
+                (unsigned long long)r->rtt_ns_max, (unsigned long long)r->rtt_ns_mean, r->cpu_permille);
+        break;
+    default:
+        fprintf(opts.out,
+                "rtt        bufsz %5u msg %5u: %4u trips, p50 %8llu ns p90 %8llu p99 %8llu p99.9 %8llu max %8llu, "
+                "cpu %d.%d%%\n",
+                bufsz, r->msg_size, r->count, (unsigned long long)r->rtt_ns_p50, (unsigned long long)r->rtt_ns_p90,
+                (unsigned long long)r->rtt_ns_p99, (unsigned long long)r->rtt_ns_p999,
+                (unsigned long long)r->rtt_ns_max, r->cpu_permille / 10,
+                (0 > r->cpu_permille) ? 0 : r->cpu_permille % 10);
+        break;
+    }
+    fflush(opts.out);
+}
+
+static int run_point(uint32_t bufsz, uint32_t size)
+{
+    uart_bench_tput_t tput;
+    uart_bench_rtt_t  rtt;
+    uint64_t          total = (uint64_t)opts.baud / 10 * opts.time_ms / 1000;
+    char              msg[64];
+
+    total = (total < size) ? size : total;
+    snprintf(msg, sizeof(msg), "Throughput, %u byte messages", size);
+    TEST_ASSERT(0 == drv_uart_bench_throughput(port_a, port_b ? port_b : port_a, size, total, TIMEOUT_MS, &tput)
+                    && 0 == tput.errors && total == tput.bytes,
+                msg);
+    emit_tput(bufsz, &tput);
+
+    snprintf(msg, sizeof(msg), "Round trips, %u byte messages", size);
+    TEST_ASSERT(0 == drv_uart_bench_rtt(port_a, port_b, size, opts.rtt_count, TIMEOUT_MS, &rtt)
+                    && (uint32_t)opts.rtt_count == rtt.count && 0 == rtt.errors,
+                msg);
+    emit_rtt(bufsz, &rtt);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* out_path = NULL;
+    int         opt, ret;
+
+    opts.port_a    = "2";
+    opts.port_b    = "3";
+    opts.baud      = DFT_BAUD;
+    opts.time_ms   = DFT_TIME_MS;
+    opts.rtt_count = DFT_RTT;
+    opts.format    = FMT_TEXT;
+    opts.num_sizes = parse_list(DFT_SIZES, opts.sizes);
+    opts.num_bufsz = parse_list(DFT_BUFSZ, opts.bufsz);
+
+    while (-1 != (opt = getopt(argc, argv, "a:b:B:s:z:t:n:f:o:"))) {
+        switch (opt) {
+        case 'a':
+            opts.port_a = optarg;
+            break;
+        case 'b':
+            opts.port_b = strcmp(optarg, "none") ? optarg : NULL;
+            break;
+        case 'B':
+            opts.baud = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            opts.num_sizes = parse_list(optarg, opts.sizes);
+            break;
+        case 'z':
+            opts.num_bufsz = parse_list(optarg, opts.bufsz);
+            break;
+        case 't':
+            opts.time_ms = atoi(optarg);
+            break;
+        case 'n':
+            opts.rtt_count = atoi(optarg);
+            break;
+        case 'f':
+            opts.format = !strcmp(optarg, "json") ? FMT_JSON : !strcmp(optarg, "csv") ? FMT_CSV : FMT_TEXT;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            printf("usage: %s [-a port] [-b port|none] [-B baud] [-s sizes] [-z bufsz] [-t ms] [-n count] "
+                   "[-f text|json|csv] [-o file]\n",
+                   argv[0]);
+            return -1;
+        }
+    }
+
+    if ((0x00 == opts.baud) || (0 >= opts.time_ms) || (0 >= opts.rtt_count) || (0 == opts.num_sizes)
+        || (0 == opts.num_bufsz)) {
+        printf("invalid arguments\n");
+        return -1;
+    }
+
+    opts.out = out_path ? fopen(out_path, "w") : stdout;
+    if (NULL == opts.out) {
+        printf("open %s failed\n", out_path);
+        return -1;
+    }
+
+    printf("Starting UART Benchmark\n");
+
+    if (!strcmp(opts.port_a, "2") && opts.port_b && !strcmp(opts.port_b, "3")) {
+        drv_fpioa_set_pin_func(UART2_TX_PIN, UART2_TXD);
+        drv_fpioa_set_pin_func(UART2_RX_PIN, UART2_RXD);
+        drv_fpioa_set_pin_func(UART3_TX_PIN, UART3_TXD);
+        drv_fpioa_set_pin_func(UART3_RX_PIN, UART3_RXD);
+    }
+
+    for (int z = 0; z < opts.num_bufsz; z++) {
+        printf("\n=== %s -> %s, %u baud, buffer size %u ===\n", opts.port_a, opts.port_b ? opts.port_b : "echo",
+               opts.baud, opts.bufsz[z]);
+
+        ret = open_ports(opts.bufsz[z]);
+        if (-2 == ret) {
+            /* the host simulator has no rt-device buffers to resize */
+            printf("[SKIP] buffer size %u not supported here\n", opts.bufsz[z]);
+            continue;
+        } else if (0x00 != ret) {
+            printf("[FAIL] open ports with buffer size %u\n", opts.bufsz[z]);
+            test_failed++;
+            continue;
+        }
+        for (int i = 0; i < opts.num_sizes; i++) {
+            run_point(opts.bufsz[z], opts.sizes[i]);
+        }
+    }
+    close_ports();
+
+    if (out_path) {
+        fclose(opts.out);
+    }
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,352 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_uart.h"
+#include "drv_uart_stream.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_uart_stream [lines]
+ *
+ * Needs UART2 TX/RX (pins 11/12) wired to UART3 RX/TX (pins 51/50) like
+ * test_uart, the host simulator crosses them already. uart2 writes, uart3 is
+ * framed by the stream, once opened as /dev/uart3 and once through the
+ * CDC/LTE path. The benchmark pushes @lines 64 byte lines through a stream
+ * with a reader thread and prints its counters.
+ */
+
+#define UART2_TX_PIN 11
+#define UART2_RX_PIN 12
+#define UART3_TX_PIN 50
+#define UART3_RX_PIN 51
+
+#define DFT_LINES  (2000)
+#define LINE_SIZE  (64)
+#define TIMEOUT_MS (200)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static drv_uart_inst_t* tx = NULL;
+
+static int send_all(const void* data, size_t size)
+{
+    const uint8_t* p = data;
+    size_t         sent = 0, n;
+
+    while (sent < size) {
+        n = drv_uart_write(tx, p + sent, size - sent);
+        if ((size_t)-1 == n || (size_t)-2 == n || 0 == n) {
+            usleep(100);
+            continue;
+        }
+        sent += n;
+    }
+
+    return 0;
+}
+
+static int frame_is(const uart_frame_t* frame, const void* data, size_t len)
+{
+    return (frame->len == len) && (0 == memcmp(frame->data, data, len));
+}
+
+static size_t cobs_encode(const uint8_t* in, size_t len, uint8_t* out)
+{
+    size_t  code_at = 0, o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (0x00 == in[i]) {
+            out[code_at] = code;
+            code_at      = o++;
+            code         = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if (0xFF == ++code) {
+            out[code_at] = code;
+            code_at      = o++;
+            code         = 1;
+        }
+    }
+    out[code_at] = code;
+    out[o++]     = 0x00;
+
+    return o;
+}
+
+static int test_delim(drv_uart_inst_t* rx)
+{
+    struct uart_stream_config cfg = { .max_frame = 16, .framer = { .type = UART_FRAMER_DELIM, .delim = '\n' } };
+    drv_uart_stream_t*        s   = NULL;
+    uart_frame_t              frame;
+    uart_stream_stats_t       stats;
+    char                      junk[40];
+
+    printf("\n=== Testing delimiter framer ===\n");
+
+    TEST_ASSERT(0 == drv_uart_stream_create(rx, &cfg, &s), "Create stream");
+
+    send_all("hello\nworld\n\nabc", 16);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, "hello", 5), "First line");
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, "world", 5),
+                "Second line held with the first");
+    TEST_ASSERT(0 == drv_uart_stream_release(s, &frame), "Release both");
+    TEST_ASSERT(0 == drv_uart_stream_next(s, &frame, 20), "Empty line skipped, partial line waits");
+
+    send_all("def\n", 4);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, "abcdef", 6),
+                "Line split across writes");
+    drv_uart_stream_release(s, &frame);
+
+    memset(junk, 'x', sizeof(junk));
+    send_all(junk, sizeof(junk));
+    send_all("\nok\n", 4);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, "ok", 2),
+                "Oversize line dropped, next line found");
+    drv_uart_stream_release(s, &frame);
+
+    TEST_ASSERT(0 == drv_uart_stream_get_stats(s, &stats), "Get stats");
+    TEST_ASSERT(4 == stats.frames && 1 == stats.errors && sizeof(junk) == stats.dropped, "Frames and drops counted");
+    TEST_ASSERT(sizeof(junk) + 24 == stats.rx_bytes, "Every byte counted");
+
+    drv_uart_stream_destroy(&s);
+    TEST_ASSERT(NULL == s, "Destroy stream");
+
+    return 0;
+}
+
+static int test_length(drv_uart_inst_t* rx)
+{
+    /* 0xA5, 16 bit big endian payload size, payload, 1 byte checksum */
+    struct uart_stream_config cfg = {
+        .max_frame = 64,
+        .framer    = { .type = UART_FRAMER_LENGTH, .len_size = 2, .len_big_endian = 1, .len_offset = 1, .len_adjust = 1 },
+    };
+    struct uart_stream_config bad_cfg = { .framer = { .type = UART_FRAMER_LENGTH, .len_size = 3 } };
+    drv_uart_stream_t*        s       = NULL;
+    uart_frame_t              frame;
+    uart_stream_stats_t       stats;
+
+    const uint8_t data[] = {
+        0xA5, 0x00, 0x03, 'a', 'b', 'c', 0x11, // 7 byte frame
+        0xA5, 0x10, 0x00, // length 4096, not a header
+        0xA5, 0x00, 0x00, 0x22, // empty payload
+    };
+
+    printf("\n=== Testing length prefixed framer ===\n");
+
+    TEST_ASSERT(0 != drv_uart_stream_create(rx, &bad_cfg, &s), "Bad length field size refused");
+    TEST_ASSERT(0 == drv_uart_stream_create(rx, &cfg, &s), "Create stream");
+
+    send_all(data, sizeof(data));
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, data, 7), "Frame keeps header");
+    drv_uart_stream_release(s, &frame);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, data + 10, 4),
+                "Resynced past the bad header");
+    drv_uart_stream_release(s, &frame);
+
+    drv_uart_stream_get_stats(s, &stats);
+    TEST_ASSERT(3 == stats.errors && 3 == stats.dropped, "Bad header bytes dropped one by one");
+
+    drv_uart_stream_destroy(&s);
+
+    return 0;
+}
+
+static int test_cobs(drv_uart_inst_t* rx)
+{
+    struct uart_stream_config cfg = { .max_frame = 300, .framer = { .type = UART_FRAMER_COBS } };
+    drv_uart_stream_t*        s   = NULL;
+    uart_frame_t              frame;
+    uart_stream_stats_t       stats;
+    uint8_t                   plain[260], enc[270];
+    size_t                    n;
+
+    const uint8_t bad[] = { 0x05, 'a', 0x00 };
+
+    printf("\n=== Testing COBS framer ===\n");
+
+    TEST_ASSERT(0 == drv_uart_stream_create(rx, &cfg, &s), "Create stream");
+
+    for (size_t i = 0; i < sizeof(plain); i++) {
+        plain[i] = (i % 7) ? (uint8_t)i : 0x00;
+    }
+
+    send_all("\0", 1);
+    n = cobs_encode(plain, 10, enc);
+    send_all(enc, n);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, plain, 10), "Short frame decoded");
+    drv_uart_stream_release(s, &frame);
+
+    send_all(bad, sizeof(bad));
+    n = cobs_encode(plain, sizeof(plain), enc);
+    send_all(enc, n);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, plain, sizeof(plain)),
+                "Frame longer than a COBS block decoded, bad one skipped");
+    drv_uart_stream_release(s, &frame);
+
+    drv_uart_stream_get_stats(s, &stats);
+    TEST_ASSERT(2 == stats.frames && 1 == stats.errors, "Bad frame counted");
+
+    drv_uart_stream_destroy(&s);
+
+    return 0;
+}
+
+static int test_wrap(drv_uart_inst_t* rx)
+{
+    /* 24 byte frames through a 64 byte ring, most of them wrap */
+    struct uart_stream_config cfg = { .buf_size = 64, .max_frame = 24, .framer = { .type = UART_FRAMER_FIXED, .size = 24 } };
+    struct uart_stream_config small_cfg = { .buf_size = 16, .max_frame = 24 };
+    drv_uart_stream_t*        s         = NULL;
+    uart_frame_t              frame, first;
+    uint8_t                   data[24];
+    int                       good = 1;
+
+    printf("\n=== Testing fixed framer and ring wrap ===\n");
+
+    TEST_ASSERT(0 != drv_uart_stream_create(rx, &small_cfg, &s), "Frame larger than the ring refused");
+    TEST_ASSERT(0 == drv_uart_stream_create(rx, &cfg, &s), "Create stream");
+
+    for (int i = 0; i < 32; i++) {
+        for (size_t j = 0; j < sizeof(data); j++) {
+            data[j] = (uint8_t)(i * 24 + j);
+        }
+        send_all(data, sizeof(data));
+        good &= (1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS)) && frame_is(&frame, data, sizeof(data));
+        drv_uart_stream_release(s, &frame);
+    }
+    TEST_ASSERT(good, "32 frames intact across the wrap");
+
+    /* two frames fit, the third waits in the driver until they are released */
+    send_all(data, sizeof(data));
+    send_all(data, sizeof(data));
+    send_all(data, sizeof(data));
+    usleep(20 * 1000);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &first, TIMEOUT_MS), "Hold first frame");
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS), "Hold second frame");
+    TEST_ASSERT(0 == drv_uart_stream_next(s, &frame, 20), "Ring full while frames are held");
+    TEST_ASSERT(frame_is(&first, data, sizeof(data)), "Held frame untouched");
+    drv_uart_stream_release(s, &frame);
+    TEST_ASSERT(1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS) && frame_is(&frame, data, sizeof(data)),
+                "Third frame after release");
+    drv_uart_stream_release(s, &frame);
+
+    drv_uart_stream_destroy(&s);
+
+    return 0;
+}
+
+static int bench(drv_uart_inst_t* rx, int lines)
+{
+    struct uart_stream_config cfg = {
+        .buf_size = 16384, .thread = 1, .framer = { .type = UART_FRAMER_DELIM, .delim = '\n' }
+    };
+    drv_uart_stream_t*  s = NULL;
+    uart_frame_t        frame;
+    uart_stream_stats_t stats;
+    char                line[LINE_SIZE + 8];
+    int                 got = 0, order = 1;
+    uint64_t            start, ticks;
+
+    printf("\n=== Reader thread benchmark, %d lines of %d bytes ===\n", lines, LINE_SIZE);
+
+    TEST_ASSERT(0 == drv_uart_stream_create(rx, &cfg, &s), "Create stream with reader thread");
+    TEST_ASSERT(0 != drv_uart_stream_fill(s), "Fill refused with a reader thread");
+
+    start = utils_cpu_ticks();
+    for (int i = 0; i < lines; i++) {
+        snprintf(line, sizeof(line), "%08d:%054d\n", i, 0);
+        send_all(line, LINE_SIZE);
+        while (1 == drv_uart_stream_next(s, &frame, 0)) {
+            order &= (LINE_SIZE - 1 == frame.len) && (got == atoi((const char*)frame.data));
+            drv_uart_stream_release(s, &frame);
+            got++;
+        }
+    }
+    while ((got < lines) && (1 == drv_uart_stream_next(s, &frame, TIMEOUT_MS))) {
+        order &= (LINE_SIZE - 1 == frame.len) && (got == atoi((const char*)frame.data));
+        drv_uart_stream_release(s, &frame);
+        got++;
+    }
+    ticks = utils_cpu_ticks() - start;
+
+    TEST_ASSERT(lines == got && order, "Every line in order");
+
+    drv_uart_stream_get_stats(s, &stats);
+    printf("%llu bytes in %llu reads, %llu frames, %llu us total, %llu B/s\n", (unsigned long long)stats.rx_bytes,
+           (unsigned long long)stats.reads, (unsigned long long)stats.frames,
+           (unsigned long long)(ticks * 1000000ULL / CPU_TICKS_PER_SECOND), (unsigned long long)stats.rx_bps);
+    printf("latency max %llu ns mean %llu ns, ring high water %u, stalls %llu\n",
+           (unsigned long long)stats.latency_ns_max, (unsigned long long)stats.latency_ns_mean, stats.max_fill,
+           (unsigned long long)stats.stalls);
+
+    drv_uart_stream_destroy(&s);
+    TEST_ASSERT(NULL == s, "Destroy stops the reader thread");
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    struct uart_configure cfg   = { .baud_rate = 921600, .data_bits = DATA_BITS_8, .stop_bits = STOP_BITS_1, .parity = PARITY_NONE };
+    drv_uart_inst_t*      rx    = NULL;
+    int                   lines = (1 < argc) ? atoi(argv[1]) : DFT_LINES;
+
+    printf("Starting UART Stream Tests\n");
+
+    drv_fpioa_set_pin_func(UART2_TX_PIN, UART2_TXD);
+    drv_fpioa_set_pin_func(UART2_RX_PIN, UART2_RXD);
+    drv_fpioa_set_pin_func(UART3_TX_PIN, UART3_TXD);
+    drv_fpioa_set_pin_func(UART3_RX_PIN, UART3_RXD);
+
+    if ((0 != drv_uart_inst_create(2, &tx)) || (0 != drv_uart_inst_create(3, &rx))) {
+        printf("open uart2/uart3 failed\n");
+        return -1;
+    }
+    drv_uart_set_config(tx, &cfg);
+    drv_uart_set_config(rx, &cfg);
+
+    test_delim(rx);
+    test_length(rx);
+    test_cobs(rx);
+    test_wrap(rx);
+
+    /* the same port through the CDC/LTE device path */
+    drv_uart_inst_destroy(&rx);
+    if (0 == drv_uart_inst_create_usb("/dev/uart3", &rx)) {
+        drv_uart_set_config(rx, &cfg);
+        bench(rx, (0 < lines) ? lines : DFT_LINES);
+    } else {
+        printf("open /dev/uart3 as a cdc device failed\n");
+        test_failed++;
+    }
+
+    drv_uart_inst_destroy(&rx);
+    drv_uart_inst_destroy(&tx);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
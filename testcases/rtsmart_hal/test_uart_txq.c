@@ -0,0 +1,317 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_fpioa.h"
+#include "drv_uart.h"
+#include "drv_uart_txq.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_uart_txq [total_kib]
+ *
+ * Needs UART2 TX/RX (pins 11/12) wired to UART3 RX/TX (pins 51/50) like
+ * test_uart, on the host the simulator crosses the two ptys. uart2 writes
+ * through the queue, a reader thread drains uart3. The benchmark sends
+ * @total_kib KiB as 16 byte and as 4 KiB messages, once with one
+ * drv_uart_write() per message and once through a coalescing queue.
+ */
+
+#define UART2_TX_PIN 11
+#define UART2_RX_PIN 12
+#define UART3_TX_PIN 50
+#define UART3_RX_PIN 51
+
+#define DFT_TOTAL_KIB (1024)
+#define CAPTURE_SIZE  (1024)
+#define TIMEOUT_MS    (500)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static drv_uart_inst_t* tx = NULL;
+static drv_uart_inst_t* rx = NULL;
+
+/* reader thread state, received bytes are counted, the first CAPTURE_SIZE kept */
+static pthread_t         reader;
+static volatile int      reader_stop;
+static volatile uint64_t received;
+static uint8_t           capture[CAPTURE_SIZE];
+
+static void* reader_thread(void* args)
+{
+    uint8_t buf[4096];
+    size_t  n;
+
+    while (!reader_stop) {
+        if (0 >= drv_uart_poll(rx, 50)) {
+            continue;
+        }
+        n = drv_uart_read(rx, buf, sizeof(buf));
+        if (((size_t)-1 == n) || ((size_t)-2 == n) || (0 == n)) {
+            continue;
+        }
+        if (CAPTURE_SIZE > received) {
+            memcpy(capture + received, buf, (CAPTURE_SIZE - received < n) ? (CAPTURE_SIZE - received) : n);
+        }
+        __atomic_add_fetch(&received, n, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static void reader_reset(void)
+{
+    __atomic_store_n(&received, 0, __ATOMIC_RELEASE);
+    memset(capture, 0, sizeof(capture));
+}
+
+static int wait_received(uint64_t count, int timeout_ms)
+{
+    uint64_t until = utils_cpu_ticks_ms() + timeout_ms;
+
+    while (__atomic_load_n(&received, __ATOMIC_ACQUIRE) < count) {
+        if (utils_cpu_ticks_ms() > until) {
+            return 0;
+        }
+        usleep(100);
+    }
+
+    return 1;
+}
+
+static int test_writev(void)
+{
+    struct uart_txq_config cfg = { 0 };
+    drv_uart_txq_t*        q   = NULL;
+    uint8_t                payload[100];
+    char                   expect[110];
+
+    printf("\n=== Testing scatter-gather write ===\n");
+
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = 'a' + i % 26;
+    }
+    struct iovec iov[] = {
+        { .iov_base = "head:", .iov_len = 5 },
+        { .iov_base = payload, .iov_len = sizeof(payload) },
+        { .iov_base = ":tail", .iov_len = 5 },
+    };
+    memcpy(expect, "head:", 5);
+    memcpy(expect + 5, payload, sizeof(payload));
+    memcpy(expect + 105, ":tail", 5);
+
+    reader_reset();
+    TEST_ASSERT(0 == drv_uart_txq_create(tx, &cfg, &q), "Create queue");
+    TEST_ASSERT(110 == drv_uart_txq_writev(q, iov, 3, -1), "Queue three buffers");
+    TEST_ASSERT(wait_received(110, TIMEOUT_MS) && 0 == memcmp(capture, expect, 110), "Buffers arrive in order");
+    TEST_ASSERT(0 == drv_uart_txq_writev(q, iov, 0, -1), "Empty message");
+
+    drv_uart_txq_destroy(&q);
+    TEST_ASSERT(NULL == q, "Destroy queue");
+
+    return 0;
+}
+
+static int test_coalesce(void)
+{
+    struct uart_txq_config cfg = { .coalesce_us = 20000, .coalesce_bytes = 1024 };
+    drv_uart_txq_t*        q   = NULL;
+    uart_txq_stats_t       stats;
+    uint64_t               start;
+    char                   msg[16];
+
+    printf("\n=== Testing coalescing ===\n");
+
+    reader_reset();
+    TEST_ASSERT(0 == drv_uart_txq_create(tx, &cfg, &q), "Create queue with a 20 ms window");
+    for (int i = 0; i < 10; i++) {
+        snprintf(msg, sizeof(msg), "message %06d\n", i);
+        drv_uart_txq_write(q, msg, 16, -1);
+    }
+    TEST_ASSERT(wait_received(160, TIMEOUT_MS) && 0 == memcmp(capture + 144, "message 000009\n", 16),
+                "Messages arrive");
+    drv_uart_txq_flush(q, TIMEOUT_MS);
+    drv_uart_txq_get_stats(q, &stats);
+    TEST_ASSERT(10 == stats.messages && 1 == stats.writes, "Ten messages in one driver write");
+    TEST_ASSERT(10000000 <= stats.latency_ns_max, "First message held for the window");
+
+    /* 1 s window, the byte threshold sends */
+    cfg.coalesce_us    = 1000000;
+    cfg.coalesce_bytes = 64;
+    reader_reset();
+    TEST_ASSERT(0 == drv_uart_txq_create(tx, &cfg, &q), "Recreate with a 64 byte threshold");
+    for (int i = 0; i < 4; i++) {
+        drv_uart_txq_write(q, "0123456789abcdef", 16, -1);
+    }
+    TEST_ASSERT(wait_received(64, 200), "Threshold sends before the window ends");
+
+    /* flush does not wait for the window either */
+    reader_reset();
+    start = utils_cpu_ticks_ms();
+    drv_uart_txq_write(q, "0123456789abcdef", 16, -1);
+    TEST_ASSERT(0 == drv_uart_txq_flush(q, 200) && 200 > utils_cpu_ticks_ms() - start, "Flush sends at once");
+    TEST_ASSERT(wait_received(16, 200), "Flushed bytes arrive");
+
+    drv_uart_txq_destroy(&q);
+
+    return 0;
+}
+
+static int test_backpressure(void)
+{
+    struct uart_txq_config cfg = { .buf_size = 64, .coalesce_us = 1000000 };
+    drv_uart_txq_t*        q   = NULL;
+    uart_txq_stats_t       stats;
+    uint8_t                data[200];
+
+    printf("\n=== Testing back-pressure ===\n");
+
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+
+    reader_reset();
+    TEST_ASSERT(0 == drv_uart_txq_create(tx, &cfg, &q), "Create 64 byte queue");
+    TEST_ASSERT(64 == drv_uart_txq_write(q, data, sizeof(data), 0), "Full queue takes what fits");
+    TEST_ASSERT(136 == drv_uart_txq_write(q, data + 64, sizeof(data) - 64, -1), "Blocking write waits for room");
+    /* the last 8 bytes are below the threshold and wait for the window */
+    TEST_ASSERT(0 == drv_uart_txq_flush(q, TIMEOUT_MS) && wait_received(200, TIMEOUT_MS) && 0 == memcmp(capture, data, sizeof(data)), "Every byte in order");
+
+    drv_uart_txq_get_stats(q, &stats);
+    TEST_ASSERT(1 == stats.timeouts && 0 < stats.waits && 64 == stats.max_queued, "Back-pressure counted");
+
+    drv_uart_txq_destroy(&q);
+
+    return 0;
+}
+
+static uint64_t run_direct(const uint8_t* msg, size_t size, size_t count)
+{
+    uint64_t start = utils_cpu_ticks();
+    size_t   sent, n;
+
+    reader_reset();
+    for (size_t i = 0; i < count; i++) {
+        for (sent = 0; sent < size; sent += n) {
+            n = drv_uart_write(tx, msg + sent, size - sent);
+            if (((size_t)-1 == n) || ((size_t)-2 == n)) {
+                n = 0;
+                usleep(10);
+            }
+        }
+    }
+    wait_received(size * count, 10000);
+
+    return utils_cpu_ticks() - start;
+}
+
+static uint64_t run_queue(const uint8_t* msg, size_t size, size_t count, uart_txq_stats_t* stats)
+{
+    struct uart_txq_config cfg = { .buf_size = 65536, .max_msgs = 1024, .coalesce_us = 1000, .coalesce_bytes = 4096 };
+    drv_uart_txq_t*        q   = NULL;
+    uint64_t               start;
+
+    reader_reset();
+    if (0 != drv_uart_txq_create(tx, &cfg, &q)) {
+        return 0;
+    }
+    start = utils_cpu_ticks();
+    for (size_t i = 0; i < count; i++) {
+        drv_uart_txq_write(q, msg, size, -1);
+    }
+    wait_received(size * count, 10000);
+    start = utils_cpu_ticks() - start;
+
+    drv_uart_txq_flush(q, TIMEOUT_MS);
+    drv_uart_txq_get_stats(q, stats);
+    drv_uart_txq_destroy(&q);
+
+    return start;
+}
+
+static int bench(size_t total)
+{
+    static const size_t sizes[] = { 16, 4096 };
+    static uint8_t      msg[4096];
+    uart_txq_stats_t    stats;
+    uint64_t            t_direct, t_queue;
+    size_t              count;
+
+    printf("\n=== Write benchmark, %zu KiB per run ===\n", total / 1024);
+    printf("size   msgs     direct us  queue us  speedup  driver writes  latency mean/max us\n");
+
+    memset(msg, 'x', sizeof(msg));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        count    = total / sizes[s];
+        t_direct = run_direct(msg, sizes[s], count);
+        TEST_ASSERT(sizes[s] * count == received, "Direct writes delivered");
+        t_queue = run_queue(msg, sizes[s], count, &stats);
+        TEST_ASSERT(sizes[s] * count == received && count == stats.messages, "Queued writes delivered");
+
+        printf("%4zu  %6zu  %10llu  %8llu  %6.1fx  %13llu  %llu/%llu\n", sizes[s], count,
+               (unsigned long long)(t_direct * 1000000ULL / CPU_TICKS_PER_SECOND),
+               (unsigned long long)(t_queue * 1000000ULL / CPU_TICKS_PER_SECOND),
+               t_queue ? (double)t_direct / t_queue : 0.0, (unsigned long long)stats.writes,
+               (unsigned long long)(stats.latency_ns_mean / 1000), (unsigned long long)(stats.latency_ns_max / 1000));
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    struct uart_configure cfg = { .baud_rate = 921600, .data_bits = DATA_BITS_8, .stop_bits = STOP_BITS_1, .parity = PARITY_NONE };
+    int                   kib = (1 < argc) ? atoi(argv[1]) : DFT_TOTAL_KIB;
+
+    printf("Starting UART TX Queue Tests\n");
+
+    drv_fpioa_set_pin_func(UART2_TX_PIN, UART2_TXD);
+    drv_fpioa_set_pin_func(UART2_RX_PIN, UART2_RXD);
+    drv_fpioa_set_pin_func(UART3_TX_PIN, UART3_TXD);
+    drv_fpioa_set_pin_func(UART3_RX_PIN, UART3_RXD);
+
+    if ((0 != drv_uart_inst_create(2, &tx)) || (0 != drv_uart_inst_create(3, &rx))) {
+        printf("open uart2/uart3 failed\n");
+        return -1;
+    }
+    drv_uart_set_config(tx, &cfg);
+    drv_uart_set_config(rx, &cfg);
+
+    if (0 != pthread_create(&reader, NULL, reader_thread, NULL)) {
+        printf("create reader thread failed\n");
+        return -1;
+    }
+
+    test_writev();
+    test_coalesce();
+    test_backpressure();
+    bench((size_t)((0 < kib) ? kib : DFT_TOTAL_KIB) * 1024);
+
+    reader_stop = 1;
+    pthread_join(reader, NULL);
+    drv_uart_inst_destroy(&rx);
+    drv_uart_inst_destroy(&tx);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,189 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal_umutex.h"
+#include "hal_utils.h"
+
+/*
+ * Usage:
+ *   test_umutex [loops] [work]
+ *
+ * Contention benchmark of hal_umutex against pthread_mutex with 1 to 8
+ * threads, every thread takes the lock @loops times and spins @work
+ * iterations inside it. On the board pthread_mutex is the k230_syscalls
+ * override (or the pmutex syscall with CONFIG_RT_SMART_HAL_FAST_MUTEX off),
+ * on a Linux host the slow path sleeps on the Linux futex.
+ */
+
+#define TEST_MAX_THREADS (8)
+#define DFT_LOOPS        (200000)
+#define DFT_WORK         (20)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+struct bench_ctx {
+    int                use_pthread;
+    int                loops;
+    int                work;
+    struct hal_umutex  um;
+    pthread_mutex_t    pm;
+    pthread_barrier_t  start;
+    volatile uint64_t  counter;
+};
+
+static void critical_work(struct bench_ctx* ctx)
+{
+    ctx->counter++;
+    for (volatile int i = 0; i < ctx->work; i++) { }
+}
+
+static void* bench_worker(void* args)
+{
+    struct bench_ctx* ctx = args;
+
+    pthread_barrier_wait(&ctx->start);
+
+    if (ctx->use_pthread) {
+        for (int i = 0; i < ctx->loops; i++) {
+            pthread_mutex_lock(&ctx->pm);
+            critical_work(ctx);
+            pthread_mutex_unlock(&ctx->pm);
+        }
+    } else {
+        for (int i = 0; i < ctx->loops; i++) {
+            hal_umutex_lock(&ctx->um);
+            critical_work(ctx);
+            hal_umutex_unlock(&ctx->um);
+        }
+    }
+
+    return NULL;
+}
+
+static uint64_t bench_run(struct bench_ctx* ctx, int threads)
+{
+    pthread_t tid[TEST_MAX_THREADS];
+    uint64_t  start;
+
+    ctx->counter = 0;
+    pthread_barrier_init(&ctx->start, NULL, threads + 1);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, bench_worker, ctx);
+    }
+
+    pthread_barrier_wait(&ctx->start);
+    start = utils_cpu_ticks();
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    start = utils_cpu_ticks() - start;
+    pthread_barrier_destroy(&ctx->start);
+
+    return start;
+}
+
+static int test_semantics(void)
+{
+    struct hal_umutex m = HAL_UMUTEX_INITIALIZER;
+    struct timespec   at;
+    uint64_t          start;
+
+    printf("\n=== Testing lock semantics ===\n");
+
+    TEST_ASSERT(0 == hal_umutex_trylock(&m), "Trylock free mutex");
+    TEST_ASSERT(EBUSY == hal_umutex_trylock(&m), "Trylock held mutex");
+
+    clock_gettime(CLOCK_MONOTONIC, &at);
+    at.tv_nsec += 20000000;
+    if (at.tv_nsec >= 1000000000) {
+        at.tv_nsec -= 1000000000;
+        at.tv_sec++;
+    }
+    start = utils_cpu_ticks();
+    TEST_ASSERT(ETIMEDOUT == hal_umutex_timedlock(&m, &at), "Timedlock on held mutex times out");
+    TEST_ASSERT((utils_cpu_ticks() - start) >= CPU_TICKS_PER_SECOND / 100, "Timedlock waited for the deadline");
+    TEST_ASSERT(0 != m.lock, "Timed out waiter leaves the lock held");
+
+    hal_umutex_unlock(&m);
+    TEST_ASSERT(0 == m.lock, "Unlock releases");
+    TEST_ASSERT(0 == hal_umutex_timedlock(&m, &at), "Timedlock free mutex");
+    hal_umutex_unlock(&m);
+
+    return 0;
+}
+
+static int test_contention(int loops, int work)
+{
+    struct bench_ctx*       ctx = calloc(1, sizeof(*ctx));
+    struct hal_umutex_stats st;
+    uint64_t                t_um, t_pm;
+
+    printf("\n=== Contention benchmark, %d locks per thread, %d work ===\n", loops, work);
+
+    TEST_ASSERT(ctx != NULL, "Allocate context");
+    pthread_mutex_init(&ctx->pm, NULL);
+    ctx->loops = loops;
+    ctx->work  = work;
+
+    printf("threads  hal_umutex ns/lock  pthread_mutex ns/lock  spin_acquired  futex_waits  futex_wakes\n");
+    for (int threads = 1; threads <= TEST_MAX_THREADS; threads *= 2) {
+        hal_umutex_reset_stats();
+        ctx->use_pthread = 0;
+        t_um             = bench_run(ctx, threads);
+        TEST_ASSERT(ctx->counter == (uint64_t)threads * loops, "No lost updates under hal_umutex");
+        hal_umutex_get_stats(&st);
+
+        ctx->use_pthread = 1;
+        t_pm             = bench_run(ctx, threads);
+
+        printf("%7d  %18llu  %21llu  %13llu  %11llu  %11llu\n", threads,
+               (unsigned long long)(t_um * 1000000000ULL / CPU_TICKS_PER_SECOND / ((uint64_t)threads * loops)),
+               (unsigned long long)(t_pm * 1000000000ULL / CPU_TICKS_PER_SECOND / ((uint64_t)threads * loops)),
+               (unsigned long long)st.spin_acquired, (unsigned long long)st.futex_waits, (unsigned long long)st.futex_wakes);
+
+        if (1 == threads) {
+            TEST_ASSERT(0 == st.futex_waits && 0 == st.futex_wakes, "Uncontended locks stay in user space");
+        }
+    }
+    TEST_ASSERT(0 == ctx->um.lock, "Mutex left unlocked");
+
+    pthread_mutex_destroy(&ctx->pm);
+    free(ctx);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = (1 < argc) ? atoi(argv[1]) : DFT_LOOPS;
+    int work  = (2 < argc) ? atoi(argv[2]) : DFT_WORK;
+
+    printf("Starting User Space Mutex Tests\n");
+
+    test_semantics();
+    test_contention((0 < loops) ? loops : DFT_LOOPS, (0 <= work) ? work : DFT_WORK);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}
@@ -0,0 +1,292 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drv_spi.h"
+#include "hal_sim.h"
+#include "hal_utils.h"
+#include "w25qxx.h"
+
+/*
+ * Usage:
+ *   test_w25qxx [image_dir]
+ *
+ * Host only. Runs the library against the simulated W25Q128 of the board
+ * (spi2, cs 11) and a W25Q256 created on spi0 behind cs 5, both backed by
+ * image files in image_dir (default /tmp) so the contents can be inspected
+ * after the run. Data is checked against the simulated flash array. The
+ * benchmark paces the bus at the configured clock and compares single, dual
+ * and quad reads, cached and uncached.
+ */
+
+#define DFT_IMAGE_DIR "/tmp"
+
+#define NOR128_SPI  (2)
+#define NOR128_CS   (11)
+#define NOR256_SPI  (0)
+#define NOR256_CS   (5)
+#define NOR256_SIZE (32 * 1024 * 1024)
+
+#define SPI_BAUDRATE   (50 * 1000 * 1000)
+#define BENCH_BAUDRATE (20 * 1000 * 1000)
+#define BENCH_BYTES    (256 * 1024)
+
+static int test_passed = 0;
+static int test_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("[FAIL] %s:%d - %s\n", __func__, __LINE__, msg); \
+        test_failed++; \
+        return -1; \
+    } else { \
+        printf("[PASS] %s\n", msg); \
+        test_passed++; \
+    } \
+} while(0)
+
+static uint8_t buf[BENCH_BYTES], ref[BENCH_BYTES];
+
+static void set_config(struct w25qxx_config* cfg, int spi_id, int cs_pin, uint8_t lines, w25qxx_read_mode_t mode,
+                       uint32_t cache_sectors)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->spi_id        = spi_id;
+    cfg->cs_pin        = cs_pin;
+    cfg->baudrate      = SPI_BAUDRATE;
+    cfg->data_lines    = lines;
+    cfg->read_mode     = mode;
+    cfg->cache_sectors = cache_sectors;
+}
+
+static void fill_pattern(uint8_t* p, size_t len, uint32_t seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        p[i] = seed >> 16;
+    }
+}
+
+static int test_geometry(struct hal_sim_nor* nor128, struct hal_sim_nor* nor256)
+{
+    struct w25qxx_config cfg;
+    w25qxx_t*            flash = NULL;
+    w25qxx_info_t        info;
+    uint8_t              uid[8];
+
+    printf("\n=== Testing geometry ===\n");
+
+    set_config(&cfg, NOR128_SPI, NOR128_CS, 4, W25QXX_READ_AUTO, 0);
+    TEST_ASSERT(0 == w25qxx_create(&cfg, &flash), "Open W25Q128");
+    TEST_ASSERT(0 == w25qxx_get_info(flash, &info), "Get info");
+    TEST_ASSERT(0xEF4018 == info.jedec_id && (16U << 20) == info.size && 3 == info.addr_bytes,
+                "16 MiB with 3 byte addresses");
+    TEST_ASSERT(W25QXX_READ_QUAD == info.read_mode, "Four lines pick quad reads");
+    TEST_ASSERT(0 == w25qxx_read_unique_id(flash, uid), "Read unique id");
+    TEST_ASSERT(0 > w25qxx_read(flash, info.size - 16, buf, 32), "Read past the end refused");
+    TEST_ASSERT(0 > w25qxx_erase(flash, 100, W25QXX_SECTOR_SIZE), "Unaligned erase refused");
+    w25qxx_destroy(&flash);
+    TEST_ASSERT(NULL == flash, "Close W25Q128");
+
+    set_config(&cfg, NOR128_SPI, NOR128_CS, 1, W25QXX_READ_QUAD, 0);
+    TEST_ASSERT(0 > w25qxx_create(&cfg, &flash), "Quad reads need four lines");
+    set_config(&cfg, NOR128_SPI, NOR128_CS + 1, 1, W25QXX_READ_AUTO, 0);
+    TEST_ASSERT(-2 == w25qxx_create(&cfg, &flash), "Nothing behind another cs");
+
+    set_config(&cfg, NOR256_SPI, NOR256_CS, 2, W25QXX_READ_AUTO, 0);
+    TEST_ASSERT(0 == w25qxx_create(&cfg, &flash), "Open W25Q256");
+    w25qxx_get_info(flash, &info);
+    TEST_ASSERT(NOR256_SIZE == info.size && 4 == info.addr_bytes && W25QXX_READ_DUAL == info.read_mode,
+                "32 MiB with 4 byte addresses, dual reads");
+
+    /* the top 16 MiB are only reachable with 4 byte addresses */
+    fill_pattern(ref, 2 * W25QXX_SECTOR_SIZE, 256);
+    TEST_ASSERT(0 == w25qxx_erase(flash, NOR256_SIZE - 2 * W25QXX_SECTOR_SIZE, 2 * W25QXX_SECTOR_SIZE),
+                "Erase the last two sectors");
+    TEST_ASSERT(0 == w25qxx_write(flash, NOR256_SIZE - 2 * W25QXX_SECTOR_SIZE, ref, 2 * W25QXX_SECTOR_SIZE),
+                "Write them");
+    TEST_ASSERT(0 == w25qxx_sync(flash), "Sync");
+    TEST_ASSERT(0 == memcmp(hal_sim_nor_mem(nor256) + NOR256_SIZE - 2 * W25QXX_SECTOR_SIZE, ref,
+                            2 * W25QXX_SECTOR_SIZE),
+                "Data landed above 16 MiB");
+    TEST_ASSERT(0xFF == hal_sim_nor_mem(nor256)[(16U << 20) - 2 * W25QXX_SECTOR_SIZE], "Nothing wrapped to 16 MiB");
+    TEST_ASSERT(0 == w25qxx_read(flash, NOR256_SIZE - 2 * W25QXX_SECTOR_SIZE, buf, 2 * W25QXX_SECTOR_SIZE)
+                    && 0 == memcmp(buf, ref, 2 * W25QXX_SECTOR_SIZE),
+                "Read back");
+    w25qxx_destroy(&flash);
+
+    (void)nor128;
+
+    return 0;
+}
+
+static int test_data(struct hal_sim_nor* nor)
+{
+    struct w25qxx_config cfg;
+    w25qxx_t*            flash = NULL;
+    w25qxx_stats_t       stats;
+    uint8_t*             mem  = hal_sim_nor_mem(nor);
+    uint32_t             base = 0x100000;
+
+    printf("\n=== Testing read, write and erase ===\n");
+
+    set_config(&cfg, NOR128_SPI, NOR128_CS, 4, W25QXX_READ_AUTO, 8);
+    TEST_ASSERT(0 == w25qxx_create(&cfg, &flash), "Open with an 8 sector cache");
+
+    /* a 64K block and two sectors: one block erase, two sector erases */
+    TEST_ASSERT(0 == w25qxx_erase(flash, base, W25QXX_BLOCK_SIZE + 2 * W25QXX_SECTOR_SIZE), "Erase 72 KiB");
+    w25qxx_sync(flash);
+    TEST_ASSERT(0xFF == mem[base] && 0xFF == mem[base + W25QXX_BLOCK_SIZE + 2 * W25QXX_SECTOR_SIZE - 1], "Range erased");
+
+    /* unaligned start and length cross pages and sectors */
+    fill_pattern(ref, 3 * W25QXX_SECTOR_SIZE, 1);
+    memset(ref + W25QXX_SECTOR_SIZE, 0xFF, 2 * W25QXX_PAGE_SIZE);
+    w25qxx_reset_stats(flash);
+    TEST_ASSERT(0 == w25qxx_write(flash, base + 100, ref, 3 * W25QXX_SECTOR_SIZE - 200), "Unaligned write");
+    w25qxx_sync(flash);
+    TEST_ASSERT(0 == memcmp(mem + base + 100, ref, 3 * W25QXX_SECTOR_SIZE - 200), "Flash holds the data");
+    w25qxx_get_stats(flash, &stats);
+    TEST_ASSERT(0 < stats.pages_skipped, "All 0xFF pages skipped");
+
+    /* a partial read fills the cache, reading it again hits */
+    w25qxx_reset_stats(flash);
+    TEST_ASSERT(0 == w25qxx_read(flash, base + 300, buf, 1000) && 0 == memcmp(buf, ref + 200, 1000), "Partial read");
+    TEST_ASSERT(0 == w25qxx_read(flash, base + 2000, buf, 500) && 0 == memcmp(buf, ref + 1900, 500), "Cached read");
+    w25qxx_get_stats(flash, &stats);
+    TEST_ASSERT(1 == stats.cache_misses && 1 == stats.cache_hits && W25QXX_SECTOR_SIZE == stats.read_bytes,
+                "Second read served by the cache");
+
+    /* writes and erases keep the cached sector in step with the chip */
+    memset(ref, 0x0F, 16);
+    TEST_ASSERT(0 == w25qxx_write(flash, base + 4000, ref, 16), "Program into a cached sector");
+    TEST_ASSERT(0 == w25qxx_read(flash, base + 4000, buf, 16) && 0 == memcmp(buf, mem + base + 4000, 16),
+                "Cache follows the program");
+    TEST_ASSERT(0 == w25qxx_erase(flash, base, W25QXX_SECTOR_SIZE), "Erase the cached sector");
+    TEST_ASSERT(0 == w25qxx_read(flash, base + 300, buf, 16) && 0xFF == buf[0] && 0xFF == buf[15],
+                "Cache follows the erase");
+
+    /* whole sectors go straight to the buffer in one command */
+    w25qxx_reset_stats(flash);
+    TEST_ASSERT(0 == w25qxx_read(flash, base + W25QXX_SECTOR_SIZE, buf, 8 * W25QXX_SECTOR_SIZE)
+                    && 0 == memcmp(buf, mem + base + W25QXX_SECTOR_SIZE, 8 * W25QXX_SECTOR_SIZE),
+                "Whole sector read");
+    w25qxx_get_stats(flash, &stats);
+    TEST_ASSERT(1 == stats.read_cmds, "One command for the run");
+
+    w25qxx_destroy(&flash);
+
+    return 0;
+}
+
+static int test_busy(struct hal_sim_nor* nor)
+{
+    struct w25qxx_config cfg;
+    w25qxx_t*            flash = NULL;
+    w25qxx_stats_t       stats;
+    uint64_t             start;
+
+    printf("\n=== Testing busy waits ===\n");
+
+    hal_sim_nor_set_timing(nor, 300, 20000, 60000, 0);
+    set_config(&cfg, NOR128_SPI, NOR128_CS, 4, W25QXX_READ_AUTO, 0);
+    TEST_ASSERT(0 == w25qxx_create(&cfg, &flash), "Open");
+
+    for (int i = 0; i < 4; i++) {
+        w25qxx_erase(flash, 0x200000 + i * W25QXX_SECTOR_SIZE, W25QXX_SECTOR_SIZE);
+    }
+    fill_pattern(ref, 64 * W25QXX_PAGE_SIZE, 7);
+    w25qxx_reset_stats(flash);
+    start = utils_cpu_ticks();
+    TEST_ASSERT(0 == w25qxx_write(flash, 0x200000, ref, 64 * W25QXX_PAGE_SIZE), "Write 64 pages");
+    TEST_ASSERT(0 == w25qxx_sync(flash), "Sync");
+    start = utils_cpu_ticks() - start;
+    w25qxx_get_stats(flash, &stats);
+    printf("64 pages in %llu us, %llu polls, program %u us, sector erase %u us\n",
+           (unsigned long long)(start * 1000000ULL / CPU_TICKS_PER_SECOND), (unsigned long long)stats.busy_polls,
+           stats.prog_us_avg, stats.erase_us_avg);
+    TEST_ASSERT(300 <= stats.prog_us_avg && 20000 <= stats.erase_us_avg, "Learned busy times");
+    TEST_ASSERT(stats.busy_polls < 64 * 8, "Few polls per page");
+    TEST_ASSERT(0 == w25qxx_read(flash, 0x200000, buf, 64 * W25QXX_PAGE_SIZE)
+                    && 0 == memcmp(buf, ref, 64 * W25QXX_PAGE_SIZE),
+                "Data intact");
+
+    w25qxx_destroy(&flash);
+    hal_sim_nor_set_timing(nor, 0, 0, 0, 0);
+
+    return 0;
+}
+
+static int bench_one(const char* name, uint8_t lines, w25qxx_read_mode_t mode, uint32_t cache_sectors)
+{
+    struct w25qxx_config cfg;
+    w25qxx_t*            flash = NULL;
+    uint64_t             start, ticks;
+
+    set_config(&cfg, NOR128_SPI, NOR128_CS, lines, mode, cache_sectors);
+    cfg.baudrate = BENCH_BAUDRATE;
+    TEST_ASSERT(0 == w25qxx_create(&cfg, &flash), name);
+
+    /* timed on the second pass, with a cache it is served from memory */
+    for (int pass = 0; pass < 2; pass++) {
+        start = utils_cpu_ticks();
+        for (size_t off = 0; off < BENCH_BYTES; off += 512) {
+            w25qxx_read(flash, off, buf + off, 512);
+        }
+        ticks = utils_cpu_ticks() - start;
+    }
+    w25qxx_destroy(&flash);
+
+    printf("%-24s: %7.2f MB/s\n", name, (double)BENCH_BYTES * CPU_TICKS_PER_SECOND / ticks / 1e6);
+
+    return 0;
+}
+
+static int bench(void)
+{
+    printf("\n=== Read benchmark, %d KiB in 512 byte reads at %d MHz ===\n", BENCH_BYTES / 1024,
+           BENCH_BAUDRATE / 1000000);
+
+    hal_sim_spi_set_pacing(NOR128_SPI, 1);
+    bench_one("single, no cache", 1, W25QXX_READ_FAST, 0);
+    bench_one("dual, no cache", 2, W25QXX_READ_DUAL, 0);
+    bench_one("quad, no cache", 4, W25QXX_READ_QUAD, 0);
+    bench_one("quad, 64 sector cache", 4, W25QXX_READ_QUAD, 64);
+    hal_sim_spi_set_pacing(NOR128_SPI, 0);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char*         dir = (1 < argc) ? argv[1] : DFT_IMAGE_DIR;
+    char                path[256];
+    struct hal_sim_nor* nor128 = hal_sim_board_nor(0);
+    struct hal_sim_nor* nor256;
+
+    printf("Starting W25Qxx Library Tests\n");
+
+    snprintf(path, sizeof(path), "%s/test_w25qxx_q256.img", dir);
+    unlink(path);
+    nor256 = hal_sim_nor_create(path, NOR256_SIZE, 0xEF4019);
+    if (!nor128 || !nor256 || hal_sim_spi_attach(NOR256_SPI, NOR256_CS, hal_sim_nor_dev(nor256))) {
+        printf("simulated flash missing\n");
+        return -1;
+    }
+
+    test_geometry(nor128, nor256);
+    test_data(nor128);
+    test_busy(nor128);
+    bench();
+
+    hal_sim_spi_detach(hal_sim_nor_dev(nor256));
+    hal_sim_nor_destroy(nor256);
+
+    printf("\n=== Test Summary ===\n");
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_failed);
+    printf("===================\n");
+
+    return test_failed ? -1 : 0;
+}